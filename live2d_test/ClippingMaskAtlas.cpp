@@ -0,0 +1,406 @@
+#include "ClippingMaskAtlas.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+#include "Live2DModel.h"
+#include "SimdMath.h"
+
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imgui/imstb_rectpack.h"
+
+namespace D3D
+{
+    namespace
+    {
+        // Regions are packed this much larger than their masks so they can grow a little...
+        const float REGION_SLACK = 1.125f;
+
+        // ...and are repacked when a mask needs this much more than its region holds.
+        const float REPACK_GROWTH = 1.25f;
+
+        // Area of the atlas the first packing attempt aims to fill, every failed attempt
+        // shrinks the masks by PACK_SHRINK until they are down to a pixel, which takes less
+        // than MAX_PACK_ATTEMPTS from any start that fits the atlas. Past that only the padding
+        // is left, so the masks do not fit at any size and the atlas grows, when allowed.
+        const float PACK_FILL = 0.85f;
+        const float PACK_SHRINK = 0.9f;
+        const uint32_t MAX_PACK_ATTEMPTS = 128;
+
+        const float MIN_EXTENT = 1e-4f;
+
+        // Sets whose meshes have no vertices keep the inverted bounds they start with.
+        inline bool IsEmpty(const float* bounds)
+        {
+            return bounds[0] > bounds[2];
+        }
+
+        // Widens a mask that is a point or a line to MIN_EXTENT around its center. Far from the
+        // origin MIN_EXTENT can be below one ulp, so the extent is kept at a few ulps of the
+        // center as well, otherwise it rounds back to zero and the region scale turns infinite.
+        inline void ClampExtent(float& minimum, float& maximum)
+        {
+            if (maximum - minimum >= MIN_EXTENT)
+            {
+                return;
+            }
+
+            float center = 0.5f * minimum + 0.5f * maximum;
+            float half_extent = (std::max)(0.5f * MIN_EXTENT, std::fabs(center) * 4.0f * FLT_EPSILON);
+            minimum = center - half_extent;
+            maximum = center + half_extent;
+        }
+
+        inline uint64_t HashMeshes(const uint32_t* meshes, uint32_t count)
+        {
+            uint64_t hash = 14695981039346656037ull;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                hash = (hash ^ meshes[i]) * 1099511628211ull;
+            }
+
+            return hash;
+        }
+    }
+
+    void ClippingMaskAtlas::Clear()
+    {
+        mask_sets_.clear();
+        set_meshes_.clear();
+        set_mask_meshes_.clear();
+        set_map_.clear();
+        mask_meshes_.clear();
+        mask_mesh_map_.clear();
+        mesh_bounds_.clear();
+        set_bounds_.clear();
+        regions_.clear();
+        resolution_scale_ = 1.0f;
+        unplaced_count_ = 0;
+        layout_dirty_ = true;
+    }
+
+    void ClippingMaskAtlas::SetAtlasSize(uint32_t width, uint32_t height)
+    {
+        assert(width > 0 && width <= 0xffff && height > 0 && height <= 0xffff);
+
+        atlas_width_ = width;
+        atlas_height_ = height;
+        layout_dirty_ = true;
+    }
+
+    void ClippingMaskAtlas::SetMaxAtlasSize(uint32_t width, uint32_t height)
+    {
+        assert(width <= 0xffff && height <= 0xffff);
+
+        max_atlas_width_ = width;
+        max_atlas_height_ = height;
+        layout_dirty_ = true;
+    }
+
+    uint32_t ClippingMaskAtlas::GetAtlasWidth() const
+    {
+        return atlas_width_;
+    }
+
+    uint32_t ClippingMaskAtlas::GetAtlasHeight() const
+    {
+        return atlas_height_;
+    }
+
+    void ClippingMaskAtlas::SetPixelsPerUnit(float pixels_per_unit)
+    {
+        pixels_per_unit_ = pixels_per_unit;
+        layout_dirty_ = true;
+    }
+
+    void ClippingMaskAtlas::SetPadding(uint32_t padding)
+    {
+        padding_ = padding;
+        layout_dirty_ = true;
+    }
+
+    uint32_t ClippingMaskAtlas::AddMaskSet(const uint32_t* mask_meshes, uint32_t count)
+    {
+        assert(count > 0);
+
+        std::vector<uint32_t> meshes(mask_meshes, mask_meshes + count);
+        std::sort(meshes.begin(), meshes.end());
+        meshes.erase(std::unique(meshes.begin(), meshes.end()), meshes.end());
+        count = static_cast<uint32_t>(meshes.size());
+
+        uint64_t hash = HashMeshes(meshes.data(), count);
+        auto it = set_map_.find(hash);
+        uint32_t mask_set = it != set_map_.end() ? it->second : UINT32_MAX;
+        while (mask_set != UINT32_MAX)
+        {
+            const MaskSet& other = mask_sets_[mask_set];
+            if (other.mesh_count == count && std::equal(meshes.begin(), meshes.end(), set_meshes_.begin() + other.mesh_offset))
+            {
+                return mask_set;
+            }
+
+            mask_set = other.next;
+        }
+
+        MaskSet set{};
+        set.mesh_offset = static_cast<uint32_t>(set_meshes_.size());
+        set.mesh_count = count;
+        set.next = it != set_map_.end() ? it->second : UINT32_MAX;
+
+        for (uint32_t mesh : meshes)
+        {
+            auto mask_mesh = mask_mesh_map_.emplace(mesh, static_cast<uint32_t>(mask_meshes_.size())).first;
+            if (mask_mesh->second == mask_meshes_.size())
+            {
+                mask_meshes_.push_back(mesh);
+            }
+
+            set_meshes_.push_back(mesh);
+            set_mask_meshes_.push_back(mask_mesh->second);
+        }
+
+        mask_set = GetMaskSetCount();
+        set_map_[hash] = mask_set;
+        mask_sets_.push_back(set);
+        regions_.emplace_back();
+        layout_dirty_ = true;
+
+        return mask_set;
+    }
+
+    uint32_t ClippingMaskAtlas::GetMaskSetCount() const
+    {
+        return static_cast<uint32_t>(mask_sets_.size());
+    }
+
+    const uint32_t* ClippingMaskAtlas::GetMaskSetMeshes(uint32_t mask_set, uint32_t& count) const
+    {
+        const MaskSet& set = mask_sets_[mask_set];
+        count = set.mesh_count;
+        return set_meshes_.data() + set.mesh_offset;
+    }
+
+    bool ClippingMaskAtlas::Update(const Live2DModel& model, const ArtMeshVertex* vertices)
+    {
+        uint32_t mask_mesh_count = static_cast<uint32_t>(mask_meshes_.size());
+        mesh_bounds_.resize(mask_mesh_count * 4);
+        for (uint32_t i = 0; i < mask_mesh_count; i++)
+        {
+            uint32_t mesh = mask_meshes_[i];
+            const ArtMeshVertex* vertex = vertices + model.GetArtMeshVertexOffset(mesh);
+            uint32_t vertex_count = model.GetArtMeshVertexCount(mesh);
+
+            // A vertex is one x, y, u, v register, only the x and y lanes are kept.
+            Simd::Float4 minimum = Simd::Set1(FLT_MAX);
+            Simd::Float4 maximum = Simd::Set1(-FLT_MAX);
+            for (uint32_t j = 0; j < vertex_count; j++)
+            {
+                Simd::Float4 v = Simd::Load(&vertex[j].x);
+                minimum = Simd::Min(minimum, v);
+                maximum = Simd::Max(maximum, v);
+            }
+
+            float lanes[8];
+            Simd::Store(lanes, minimum);
+            Simd::Store(lanes + 4, maximum);
+            float* bounds = &mesh_bounds_[i * 4];
+            bounds[0] = lanes[0];
+            bounds[1] = lanes[1];
+            bounds[2] = lanes[4];
+            bounds[3] = lanes[5];
+        }
+
+        uint32_t set_count = GetMaskSetCount();
+        set_bounds_.resize(set_count * 4);
+        float scale = pixels_per_unit_ * resolution_scale_;
+        for (uint32_t i = 0; i < set_count; i++)
+        {
+            const MaskSet& set = mask_sets_[i];
+            float* bounds = &set_bounds_[i * 4];
+            bounds[0] = bounds[1] = FLT_MAX;
+            bounds[2] = bounds[3] = -FLT_MAX;
+            for (uint32_t j = 0; j < set.mesh_count; j++)
+            {
+                const float* mesh = &mesh_bounds_[set_mask_meshes_[set.mesh_offset + j] * 4];
+                bounds[0] = (std::min)(bounds[0], mesh[0]);
+                bounds[1] = (std::min)(bounds[1], mesh[1]);
+                bounds[2] = (std::max)(bounds[2], mesh[2]);
+                bounds[3] = (std::max)(bounds[3], mesh[3]);
+            }
+
+            if (IsEmpty(bounds))
+            {
+                continue;
+            }
+
+            ClampExtent(bounds[0], bounds[2]);
+            ClampExtent(bounds[1], bounds[3]);
+
+            // Masks that did not fit at all stay without a region until the next repack.
+            const ClipMaskRegion& region = regions_[i];
+            float inner_width = static_cast<float>(region.width - (std::min)(region.width, 2 * padding_));
+            float inner_height = static_cast<float>(region.height - (std::min)(region.height, 2 * padding_));
+            if (region.width != 0 && ((bounds[2] - bounds[0]) * scale > inner_width * REPACK_GROWTH ||
+                (bounds[3] - bounds[1]) * scale > inner_height * REPACK_GROWTH))
+            {
+                layout_dirty_ = true;
+            }
+        }
+
+        bool repacked = layout_dirty_;
+        if (layout_dirty_)
+        {
+            Pack();
+            layout_dirty_ = false;
+        }
+
+        // Stretch every mask over the inside of its region, v grows downwards. Empty and
+        // unplaced masks map everything to the atlas corner.
+        float inv_atlas_width = 1.0f / atlas_width_;
+        float inv_atlas_height = 1.0f / atlas_height_;
+        for (uint32_t i = 0; i < set_count; i++)
+        {
+            const float* bounds = &set_bounds_[i * 4];
+            ClipMaskRegion& region = regions_[i];
+            if (region.width == 0 || IsEmpty(bounds))
+            {
+                region.scale_x = region.scale_y = 0.0f;
+                region.offset_x = region.offset_y = 0.0f;
+                continue;
+            }
+
+            float inner_width = static_cast<float>(region.width - (std::min)(region.width, 2 * padding_));
+            float inner_height = static_cast<float>(region.height - (std::min)(region.height, 2 * padding_));
+
+            region.scale_x = inner_width * inv_atlas_width / (bounds[2] - bounds[0]);
+            region.scale_y = -inner_height * inv_atlas_height / (bounds[3] - bounds[1]);
+            region.offset_x = (region.x + padding_) * inv_atlas_width - bounds[0] * region.scale_x;
+            region.offset_y = (region.y + padding_) * inv_atlas_height - bounds[3] * region.scale_y;
+        }
+
+        return repacked;
+    }
+
+    const ClipMaskRegion& ClippingMaskAtlas::GetRegion(uint32_t mask_set) const
+    {
+        return regions_[mask_set];
+    }
+
+    float ClippingMaskAtlas::GetResolutionScale() const
+    {
+        return resolution_scale_;
+    }
+
+    uint32_t ClippingMaskAtlas::GetUnplacedCount() const
+    {
+        return unplaced_count_;
+    }
+
+    float ClippingMaskAtlas::GetUtilization() const
+    {
+        double area = 0.0;
+        for (const ClipMaskRegion& region : regions_)
+        {
+            area += static_cast<double>(region.width) * region.height;
+        }
+
+        return static_cast<float>(area / (static_cast<double>(atlas_width_) * atlas_height_));
+    }
+
+    bool ClippingMaskAtlas::Pack()
+    {
+        unplaced_count_ = 0;
+        uint32_t set_count = GetMaskSetCount();
+        if (set_count == 0)
+        {
+            return true;
+        }
+
+        // Masks at full resolution, slack included. Empty ones take no space.
+        std::vector<float> sizes(set_count * 2);
+        double full_area = 0.0;
+        float largest_size = 0.0f;
+        for (uint32_t i = 0; i < set_count; i++)
+        {
+            const float* bounds = &set_bounds_[i * 4];
+            if (IsEmpty(bounds))
+            {
+                sizes[i * 2] = sizes[i * 2 + 1] = 0.0f;
+                continue;
+            }
+
+            sizes[i * 2] = (bounds[2] - bounds[0]) * pixels_per_unit_ * REGION_SLACK;
+            sizes[i * 2 + 1] = (bounds[3] - bounds[1]) * pixels_per_unit_ * REGION_SLACK;
+            full_area += static_cast<double>(sizes[i * 2] + 2 * padding_) * (sizes[i * 2 + 1] + 2 * padding_);
+            largest_size = (std::max)(largest_size, (std::max)(sizes[i * 2], sizes[i * 2 + 1]));
+        }
+
+        std::vector<stbrp_node> nodes;
+        std::vector<stbrp_rect> rects(set_count);
+        bool packed = false;
+        float scale = 1.0f;
+        for (;;)
+        {
+            double atlas_area = static_cast<double>(atlas_width_) * atlas_height_;
+            scale = full_area > 0.0 ? static_cast<float>((std::min)(1.0, std::sqrt(PACK_FILL * atlas_area / full_area))) : 1.0f;
+            nodes.resize(atlas_width_);
+
+            for (uint32_t attempt = 0; attempt < MAX_PACK_ATTEMPTS; attempt++)
+            {
+                scale *= attempt > 0 ? PACK_SHRINK : 1.0f;
+                for (uint32_t i = 0; i < set_count; i++)
+                {
+                    bool empty = sizes[i * 2] == 0.0f;
+                    float width = empty ? 0.0f : ::ceilf(sizes[i * 2] * scale) + 2 * padding_;
+                    float height = empty ? 0.0f : ::ceilf(sizes[i * 2 + 1] * scale) + 2 * padding_;
+
+                    rects[i].id = static_cast<int>(i);
+                    rects[i].w = static_cast<stbrp_coord>((std::min)(width, static_cast<float>(atlas_width_)));
+                    rects[i].h = static_cast<stbrp_coord>((std::min)(height, static_cast<float>(atlas_height_)));
+                }
+
+                stbrp_context context;
+                stbrp_init_target(&context, static_cast<int>(atlas_width_), static_cast<int>(atlas_height_), nodes.data(), static_cast<int>(nodes.size()));
+                packed = stbrp_pack_rects(&context, rects.data(), static_cast<int>(set_count)) != 0;
+                if (packed || largest_size * scale <= 1.0f)
+                {
+                    break;
+                }
+            }
+
+            // Double the shorter side up to the maximum size and start over.
+            if (packed || (atlas_width_ >= max_atlas_width_ && atlas_height_ >= max_atlas_height_))
+            {
+                break;
+            }
+
+            bool grow_width = atlas_width_ < max_atlas_width_ && (atlas_width_ <= atlas_height_ || atlas_height_ >= max_atlas_height_);
+            if (grow_width)
+            {
+                atlas_width_ = (std::min)(atlas_width_ * 2, max_atlas_width_);
+            }
+            else
+            {
+                atlas_height_ = (std::min)(atlas_height_ * 2, max_atlas_height_);
+            }
+        }
+
+        // Left over masks get no region and are not drawn, GetUnplacedCount reports them.
+        for (uint32_t i = 0; i < set_count; i++)
+        {
+            ClipMaskRegion& region = regions_[i];
+            bool placed = rects[i].was_packed && rects[i].w != 0;
+            region.x = placed ? rects[i].x : 0;
+            region.y = placed ? rects[i].y : 0;
+            region.width = placed ? rects[i].w : 0;
+            region.height = placed ? rects[i].h : 0;
+            unplaced_count_ += !rects[i].was_packed ? 1 : 0;
+        }
+
+        resolution_scale_ = scale;
+        return packed;
+    }
+};
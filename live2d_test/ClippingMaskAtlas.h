@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace D3D
+{
+    class Live2DModel;
+    struct ArtMeshVertex;
+
+    // Where a mask set is drawn in the atlas. Model space positions map to atlas texture
+    // coordinates as u = x * scale_x + offset_x, v = y * scale_y + offset_y, which is used both
+    // to render the mask meshes into the atlas and to sample it when drawing the masked parts.
+    struct ClipMaskRegion
+    {
+        uint32_t x = 0;                                     // pixels, padding included
+        uint32_t y = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        float scale_x = 0.0f;
+        float scale_y = 0.0f;
+        float offset_x = 0.0f;
+        float offset_y = 0.0f;
+    };
+
+    // Clipping masks of one Live2DModel packed into a single atlas texture, so every mask is
+    // rendered in one pass instead of a stencil pass per masked part. Parts masked by the same
+    // art meshes share one mask set. Every Update fits each set's region to the current bounds
+    // of its meshes; the atlas is only repacked, with stb_rect_pack, when sets are added or a
+    // mask has grown well past its region, otherwise it is just sampled at a lower resolution.
+    // When the masks do not fit at full resolution they are all scaled down evenly, and when
+    // they do not fit at all the atlas grows up to SetMaxAtlasSize. Mask sets whose meshes
+    // have no vertices get no region.
+    class ClippingMaskAtlas
+    {
+    public:
+        void Clear();
+
+        void SetAtlasSize(uint32_t width, uint32_t height);
+
+        // Largest size a repack may grow the atlas to, by doubling its shorter side. 0, the
+        // default, keeps the size SetAtlasSize gave. The atlas does not shrink back by itself.
+        void SetMaxAtlasSize(uint32_t width, uint32_t height);
+        uint32_t GetAtlasWidth() const;
+        uint32_t GetAtlasHeight() const;
+
+        void SetPixelsPerUnit(float pixels_per_unit);      // full resolution, in model space
+        void SetPadding(uint32_t padding);
+
+        // The mask set of a part masked by mask_meshes, in any order.
+        uint32_t AddMaskSet(const uint32_t* mask_meshes, uint32_t count);
+
+        uint32_t GetMaskSetCount() const;
+        const uint32_t* GetMaskSetMeshes(uint32_t mask_set, uint32_t& count) const;
+
+        // vertices are the model's from Live2DModel::Update. Returns true when the atlas was
+        // repacked and every region moved, the atlas size may have changed then.
+        bool Update(const Live2DModel& model, const ArtMeshVertex* vertices);
+
+        const ClipMaskRegion& GetRegion(uint32_t mask_set) const;
+
+        // Resolution of the masks relative to full, 1 when everything fits.
+        float GetResolutionScale() const;
+
+        // Mask sets the last repack found no room for even at the largest atlas size, their
+        // regions are empty until a later repack places them.
+        uint32_t GetUnplacedCount() const;
+
+        // Part of the atlas covered by regions.
+        float GetUtilization() const;
+
+    private:
+        struct MaskSet
+        {
+            uint32_t mesh_offset;                           // into set_meshes_
+            uint32_t mesh_count;
+            uint32_t next;                                  // with the same hash
+        };
+
+        bool Pack();
+
+        uint32_t                                            atlas_width_ = 1024;
+        uint32_t                                            atlas_height_ = 1024;
+        uint32_t                                            max_atlas_width_ = 0;
+        uint32_t                                            max_atlas_height_ = 0;
+        float                                               pixels_per_unit_ = 256.0f;
+        uint32_t                                            padding_ = 2;
+
+        std::vector<MaskSet>                                mask_sets_;
+        std::vector<uint32_t>                               set_meshes_;
+        std::vector<uint32_t>                               set_mask_meshes_; // into mask_meshes_
+        std::unordered_map<uint64_t, uint32_t>              set_map_;       // hash to first set
+
+        // Meshes used by any set, bounds computed once per Update.
+        std::vector<uint32_t>                               mask_meshes_;
+        std::unordered_map<uint32_t, uint32_t>              mask_mesh_map_; // art mesh to mask_meshes_
+        std::vector<float>                                  mesh_bounds_;   // min x, min y, max x, max y
+
+        std::vector<float>                                  set_bounds_;
+        std::vector<ClipMaskRegion>                         regions_;
+        float                                               resolution_scale_ = 1.0f;
+        uint32_t                                            unplaced_count_ = 0;
+        bool                                                layout_dirty_ = true;
+    };
+};
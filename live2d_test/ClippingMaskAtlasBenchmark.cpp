@@ -0,0 +1,78 @@
+#include "ClippingMaskAtlas.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "Live2DModel.h"
+#include "TestHarness.h"
+
+using namespace D3D;
+
+namespace
+{
+    float Random(uint32_t& seed)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / 16777216.0f;
+    }
+}
+
+// Milliseconds to repack the atlas and to update it without a repack, over the number of mask
+// sets, with the atlas size, resolution scale and the part of the atlas the regions cover after
+// packing. Masks are rectangles of 0.05 to 0.5 model units, 13 to 128 pixels at the default
+// resolution, every fourth set masked by two of them. The atlas starts at 1024 x 1024 for every
+// repack and only grows, up to 4096 x 4096, once the masks do not fit even scaled down.
+int main()
+{
+    std::printf("%-6s %11s %7s %9s %9s %10s %10s\n", "sets", "atlas", "scale", "used %", "unplaced", "repack ms", "update ms");
+
+    for (uint32_t set_count : { 16u, 64u, 256u, 1024u, 4096u })
+    {
+        uint32_t seed = 9;
+        Live2DModel model;
+        std::vector<ArtMeshVertex> vertices;
+        for (uint32_t i = 0; i < set_count; i++)
+        {
+            ArtMeshDesc desc;
+            desc.positions.assign(8, 0.0f);
+            desc.uvs.assign(8, 0.0f);
+            desc.opacities.push_back(1.0f);
+            model.AddArtMesh(desc);
+
+            // The second mask of a set overlaps the first.
+            float x = i % 4 == 3 ? vertices.back().x - 0.1f : Random(seed) * 8.0f;
+            float y = i % 4 == 3 ? vertices.back().y - 0.1f : Random(seed) * 8.0f;
+            float width = 0.05f + 0.45f * Random(seed);
+            float height = 0.05f + 0.45f * Random(seed);
+            vertices.push_back({ x, y, 0.0f, 0.0f });
+            vertices.push_back({ x + width, y, 0.0f, 0.0f });
+            vertices.push_back({ x, y + height, 0.0f, 0.0f });
+            vertices.push_back({ x + width, y + height, 0.0f, 0.0f });
+        }
+
+        ClippingMaskAtlas atlas;
+        atlas.SetMaxAtlasSize(4096, 4096);
+        for (uint32_t i = 0; i < set_count; i++)
+        {
+            uint32_t meshes[] = { i, i - 1 };
+            atlas.AddMaskSet(meshes, i % 4 == 3 ? 2 : 1);
+        }
+
+        auto repack = [&]()
+        {
+            atlas.SetAtlasSize(1024, 1024);
+            atlas.Update(model, vertices.data());
+        };
+
+        repack();
+        uint32_t repeat = (std::max)(4096u / set_count, 4u);
+        double repack_ms = D3D::Test::MeasureMilliseconds(repeat, repack);
+        double update_ms = D3D::Test::MeasureMilliseconds(repeat * 10, [&]() { atlas.Update(model, vertices.data()); });
+
+        std::printf("%-6u %5ux%-5u %7.3f %9.1f %9u %10.3f %10.4f\n", set_count, atlas.GetAtlasWidth(), atlas.GetAtlasHeight(), atlas.GetResolutionScale(),
+            atlas.GetUtilization() * 100.0f, atlas.GetUnplacedCount(), repack_ms, update_ms);
+    }
+
+    return 0;
+}
@@ -0,0 +1,169 @@
+#include "ClippingMaskAtlas.h"
+
+#include <cmath>
+#include <vector>
+
+#include "Live2DModel.h"
+#include "TestHarness.h"
+
+using namespace D3D;
+
+namespace
+{
+    // Art meshes of the given vertex counts. Their vertices come from the test, not from
+    // Live2DModel::Update, so the keyform positions do not matter.
+    void BuildModel(Live2DModel& model, const std::vector<uint32_t>& vertex_counts)
+    {
+        for (uint32_t vertex_count : vertex_counts)
+        {
+            ArtMeshDesc desc;
+            desc.positions.assign(vertex_count * 2, 0.0f);
+            desc.uvs.assign(vertex_count * 2, 0.0f);
+            desc.opacities.push_back(1.0f);
+            model.AddArtMesh(desc);
+        }
+    }
+
+    bool IsFinite(const ClipMaskRegion& region)
+    {
+        return std::isfinite(region.scale_x) && std::isfinite(region.scale_y) && std::isfinite(region.offset_x) && std::isfinite(region.offset_y);
+    }
+
+    // Every placed region lies inside the atlas and no two of them overlap.
+    bool IsValidLayout(const ClippingMaskAtlas& atlas)
+    {
+        uint32_t set_count = atlas.GetMaskSetCount();
+        for (uint32_t i = 0; i < set_count; i++)
+        {
+            const ClipMaskRegion& a = atlas.GetRegion(i);
+            if (!IsFinite(a) || a.x + a.width > atlas.GetAtlasWidth() || a.y + a.height > atlas.GetAtlasHeight())
+            {
+                return false;
+            }
+
+            for (uint32_t j = i + 1; j < set_count && a.width != 0; j++)
+            {
+                const ClipMaskRegion& b = atlas.GetRegion(j);
+                if (b.width != 0 && a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height)
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    void TestDegenerateMasks()
+    {
+        // An art mesh without vertices, one collapsed to a point far from the origin, one to a
+        // vertical line, and a unit square.
+        Live2DModel model;
+        BuildModel(model, { 0, 3, 2, 4 });
+        std::vector<ArtMeshVertex> vertices =
+        {
+            { 1e6f, -3e5f, 0.0f, 0.0f }, { 1e6f, -3e5f, 0.0f, 0.0f }, { 1e6f, -3e5f, 0.0f, 0.0f },
+            { 0.5f, 0.0f, 0.0f, 0.0f }, { 0.5f, 2.0f, 0.0f, 0.0f },
+            { 0.0f, 0.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 0.0f, 0.0f },
+        };
+
+        ClippingMaskAtlas atlas;
+        uint32_t meshes[] = { 0, 1, 2, 3 };
+        uint32_t empty = atlas.AddMaskSet(&meshes[0], 1);
+        uint32_t point = atlas.AddMaskSet(&meshes[1], 1);
+        uint32_t line = atlas.AddMaskSet(&meshes[2], 1);
+        uint32_t square = atlas.AddMaskSet(&meshes[3], 1);
+        uint32_t square_and_empty_meshes[] = { 3, 0 };
+        uint32_t square_and_empty = atlas.AddMaskSet(square_and_empty_meshes, 2);
+
+        TEST_CHECK(atlas.Update(model, vertices.data()));
+        TEST_CHECK(atlas.GetUnplacedCount() == 0);
+        TEST_CHECK(IsValidLayout(atlas));
+
+        // No region and a zero mapping for the empty set, finite ones for the point and line.
+        const ClipMaskRegion& empty_region = atlas.GetRegion(empty);
+        TEST_CHECK(empty_region.width == 0 && empty_region.scale_x == 0.0f && empty_region.scale_y == 0.0f);
+        TEST_CHECK(atlas.GetRegion(point).width != 0 && atlas.GetRegion(line).width != 0);
+
+        // The empty mesh adds nothing to the square's bounds.
+        const ClipMaskRegion& a = atlas.GetRegion(square);
+        const ClipMaskRegion& b = atlas.GetRegion(square_and_empty);
+        TEST_CHECK(a.width == b.width && a.height == b.height && a.scale_x == b.scale_x && a.scale_y == b.scale_y);
+
+        // The square's corners land on the inside of its region, v growing downwards.
+        float padding = 2.0f;
+        TEST_CHECK(std::fabs(a.offset_x * 1024.0f - (a.x + padding)) < 1e-3f);
+        TEST_CHECK(std::fabs((a.scale_x + a.offset_x) * 1024.0f - (a.x + a.width - padding)) < 1e-3f);
+        TEST_CHECK(std::fabs((a.scale_y + a.offset_y) * 1024.0f - (a.y + padding)) < 1e-3f);
+
+        // Nothing moved, so no repack.
+        TEST_CHECK(!atlas.Update(model, vertices.data()));
+    }
+
+    void TestAtlasGrowth()
+    {
+        // 300 separate masks padded to at least 9 x 9 pixels cannot share a 64 x 64 atlas at
+        // any resolution.
+        const uint32_t mask_count = 300;
+        Live2DModel model;
+        BuildModel(model, std::vector<uint32_t>(mask_count, 2));
+        std::vector<ArtMeshVertex> vertices;
+        for (uint32_t i = 0; i < mask_count; i++)
+        {
+            vertices.push_back({ static_cast<float>(i), 0.0f, 0.0f, 0.0f });
+            vertices.push_back({ static_cast<float>(i) + 0.5f, 0.25f, 0.0f, 0.0f });
+        }
+
+        ClippingMaskAtlas atlas;
+        atlas.SetAtlasSize(64, 64);
+        atlas.SetPadding(4);
+        for (uint32_t i = 0; i < mask_count; i++)
+        {
+            atlas.AddMaskSet(&i, 1);
+        }
+
+        // Without room to grow the failure is reported and the unplaced masks get no region.
+        TEST_CHECK(atlas.Update(model, vertices.data()));
+        uint32_t unplaced = atlas.GetUnplacedCount();
+        TEST_CHECK(unplaced > 0 && unplaced < mask_count);
+        TEST_CHECK(atlas.GetAtlasWidth() == 64 && atlas.GetAtlasHeight() == 64);
+        TEST_CHECK(IsValidLayout(atlas));
+
+        uint32_t empty_regions = 0;
+        for (uint32_t i = 0; i < mask_count; i++)
+        {
+            empty_regions += atlas.GetRegion(i).width == 0 ? 1 : 0;
+        }
+
+        TEST_CHECK(empty_regions == unplaced);
+
+        // A cleared atlas has no mask sets left to be unplaced.
+        ClippingMaskAtlas cleared;
+        cleared.SetAtlasSize(64, 64);
+        cleared.SetPadding(4);
+        for (uint32_t i = 0; i < mask_count; i++)
+        {
+            cleared.AddMaskSet(&i, 1);
+        }
+
+        cleared.Update(model, vertices.data());
+        TEST_CHECK(cleared.GetUnplacedCount() == unplaced);
+        cleared.Clear();
+        TEST_CHECK(cleared.GetUnplacedCount() == 0 && cleared.GetMaskSetCount() == 0);
+
+        // Allowing a larger atlas repacks into it.
+        atlas.SetMaxAtlasSize(512, 256);
+        TEST_CHECK(atlas.Update(model, vertices.data()));
+        TEST_CHECK(atlas.GetUnplacedCount() == 0);
+        TEST_CHECK(atlas.GetAtlasWidth() > 64 && atlas.GetAtlasWidth() <= 512 && atlas.GetAtlasHeight() <= 256);
+        TEST_CHECK(IsValidLayout(atlas));
+        TEST_CHECK(atlas.GetRegion(mask_count - 1).width != 0);
+    }
+}
+
+int main()
+{
+    TestDegenerateMasks();
+    TestAtlasGrowth();
+    return D3D::Test::Finish("ClippingMaskAtlasTests");
+}
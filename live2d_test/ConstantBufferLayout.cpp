@@ -0,0 +1,327 @@
+#include "ConstantBufferLayout.h"
+
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+
+namespace D3D
+{
+    ConstantBufferLayout::ConstantBufferLayout(const std::string& name) :
+        name_(name)
+    {
+    }
+
+    void ConstantBufferLayout::AddReflectedField(const std::string& name, uint32_t offset, uint32_t size, const ShaderVariableType& type)
+    {
+        ConstantBufferField field;
+        field.name = name;
+        field.offset = offset;
+        field.size = size;
+        field.type = type;
+
+        field_index_map_[name] = static_cast<uint32_t>(fields_.size());
+        fields_.push_back(field);
+
+        size_ = (std::max)(size_, (offset + size + REGISTER_SIZE_ - 1) & ~(REGISTER_SIZE_ - 1));
+    }
+
+    uint32_t ConstantBufferLayout::AppendField(const std::string& name, const ShaderVariableType& type)
+    {
+        assert(type.var_class != kStructVariable);
+
+        uint32_t cursor{ 0 };
+        if (!fields_.empty())
+        {
+            cursor = fields_.back().offset + fields_.back().size;
+        }
+
+        uint32_t offset = GetPackedOffset(cursor, type);
+        AddReflectedField(name, offset, GetPackedSize(type), type);
+
+        return offset;
+    }
+
+    void ConstantBufferLayout::SetSize(uint32_t size)
+    {
+        size_ = size;
+    }
+
+    const std::string& ConstantBufferLayout::GetName() const
+    {
+        return name_;
+    }
+
+    uint32_t ConstantBufferLayout::GetSize() const
+    {
+        return size_;
+    }
+
+    const std::vector<ConstantBufferField>& ConstantBufferLayout::GetFields() const
+    {
+        return fields_;
+    }
+
+    const ConstantBufferField* ConstantBufferLayout::FindField(const std::string& name) const
+    {
+        auto find_it = field_index_map_.find(name);
+        if (find_it == field_index_map_.end())
+        {
+            return nullptr;
+        }
+
+        return &fields_[find_it->second];
+    }
+
+    bool ConstantBufferLayout::Validate(const CppFieldDesc* cpp_fields, uint32_t count, uint32_t cpp_struct_size, std::string* error) const
+    {
+        std::stringstream error_stream;
+        bool ret{ true };
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            auto& cpp_field = cpp_fields[i];
+            auto field = FindField(cpp_field.name);
+            if (field == nullptr)
+            {
+                error_stream << name_ << "." << cpp_field.name << ": not found in cbuffer\n";
+                ret = false;
+                continue;
+            }
+
+            if (field->offset != cpp_field.offset)
+            {
+                error_stream << name_ << "." << cpp_field.name << ": C++ offset " << cpp_field.offset << " != HLSL offset " << field->offset << "\n";
+                ret = false;
+            }
+
+            if (field->size != cpp_field.size)
+            {
+                error_stream << name_ << "." << cpp_field.name << ": C++ size " << cpp_field.size << " != HLSL size " << field->size << "\n";
+                ret = false;
+            }
+
+            uint32_t register_offset = cpp_field.offset % REGISTER_SIZE_;
+            if (register_offset != 0 && register_offset + cpp_field.size > REGISTER_SIZE_)
+            {
+                error_stream << name_ << "." << cpp_field.name << ": straddles a 16 byte register at offset " << cpp_field.offset << "\n";
+                ret = false;
+            }
+        }
+
+        if (cpp_struct_size > size_)
+        {
+            error_stream << name_ << ": C++ struct size " << cpp_struct_size << " exceeds cbuffer size " << size_ << "\n";
+            ret = false;
+        }
+
+        if (error != nullptr)
+        {
+            *error = error_stream.str();
+        }
+
+        return ret;
+    }
+
+    uint32_t ConstantBufferLayout::GetPackedSize(const ShaderVariableType& type)
+    {
+        uint32_t register_count{ 1 };
+        uint32_t last_components{ 1 };
+
+        switch (type.var_class)
+        {
+            case kScalarVariable:
+                register_count = 1;
+                last_components = 1;
+            break;
+
+            case kVectorVariable:
+                register_count = 1;
+                last_components = type.columns;
+            break;
+
+            case kRowMajorMatrix:
+                register_count = type.rows;
+                last_components = type.columns;
+            break;
+
+            case kColumnMajorMatrix:
+                register_count = type.columns;
+                last_components = type.rows;
+            break;
+
+            default:
+                assert(0);
+            break;
+        }
+
+        uint32_t element_size = (register_count - 1) * REGISTER_SIZE_ + last_components * sizeof(float);
+        if (type.elements == 0)
+        {
+            return element_size;
+        }
+
+        // Every array element starts on a new register, only the last one is tightly packed.
+        return (type.elements - 1) * register_count * REGISTER_SIZE_ + element_size;
+    }
+
+    uint32_t ConstantBufferLayout::GetPackedOffset(uint32_t cursor, const ShaderVariableType& type)
+    {
+        uint32_t size = GetPackedSize(type);
+        uint32_t aligned_cursor = (cursor + REGISTER_SIZE_ - 1) & ~(REGISTER_SIZE_ - 1);
+
+        // Arrays, matrices and structs always start on a register boundary.
+        if (type.elements > 0 || size > REGISTER_SIZE_ || type.var_class == kStructVariable)
+        {
+            return aligned_cursor;
+        }
+
+        // Anything else may share a register, as long as it does not cross into the next one.
+        if ((cursor % REGISTER_SIZE_) + size > REGISTER_SIZE_)
+        {
+            return aligned_cursor;
+        }
+
+        return cursor;
+    }
+
+    void DirtyRangeTracker::MarkDirty(uint32_t begin, uint32_t end)
+    {
+        if (begin >= end)
+        {
+            return;
+        }
+
+        // First range that ends at or after begin, adjacent ranges are merged as well.
+        auto first = std::lower_bound(ranges_.begin(), ranges_.end(), begin, [](const Range& range, uint32_t value)
+        {
+            return range.end < value;
+        });
+
+        auto last = first;
+        while (last != ranges_.end() && last->begin <= end)
+        {
+            begin = (std::min)(begin, last->begin);
+            end = (std::max)(end, last->end);
+            ++last;
+        }
+
+        Range merged;
+        merged.begin = begin;
+        merged.end = end;
+
+        if (first == last)
+        {
+            ranges_.insert(first, merged);
+        }
+        else
+        {
+            *first = merged;
+            ranges_.erase(first + 1, last);
+        }
+    }
+
+    void DirtyRangeTracker::Clear()
+    {
+        ranges_.clear();
+    }
+
+    bool DirtyRangeTracker::Empty() const
+    {
+        return ranges_.empty();
+    }
+
+    uint32_t DirtyRangeTracker::GetDirtyByteCount() const
+    {
+        uint32_t count{ 0 };
+        for (auto& range : ranges_)
+        {
+            count += range.end - range.begin;
+        }
+
+        return count;
+    }
+
+    const std::vector<DirtyRangeTracker::Range>& DirtyRangeTracker::GetRanges() const
+    {
+        return ranges_;
+    }
+
+    void ConstantBufferWriter::Initialize(const ConstantBufferLayout& layout, uint8_t* mapped_data, uint32_t slot_stride, uint32_t slot_count)
+    {
+        assert(slot_stride >= layout.GetSize() && slot_count > 0);
+
+        layout_ = layout;
+        mapped_data_ = mapped_data;
+        slot_stride_ = slot_stride;
+        slot_count_ = slot_count;
+        cur_slot_ = 0;
+
+        shadow_.assign(layout.GetSize(), 0);
+        slot_pending_ranges_.assign(slot_count, DirtyRangeTracker());
+        written_ranges_.Clear();
+
+        for (uint32_t i = 0; i < slot_count_; i++)
+        {
+            ::memset(mapped_data_ + static_cast<uint64_t>(i) * slot_stride_, 0, layout.GetSize());
+        }
+    }
+
+    bool ConstantBufferWriter::WriteBytes(uint32_t offset, const void* data, uint32_t size)
+    {
+        assert(offset + size <= shadow_.size());
+
+        if (::memcmp(shadow_.data() + offset, data, size) == 0)
+        {
+            return false;
+        }
+
+        ::memcpy(shadow_.data() + offset, data, size);
+        ::memcpy(mapped_data_ + GetCurrentSlotOffset() + offset, data, size);
+        written_ranges_.MarkDirty(offset, offset + size);
+
+        for (uint32_t i = 0; i < slot_count_; i++)
+        {
+            if (i != cur_slot_)
+            {
+                slot_pending_ranges_[i].MarkDirty(offset, offset + size);
+            }
+        }
+
+        return true;
+    }
+
+    void ConstantBufferWriter::NextSlot()
+    {
+        cur_slot_ = (cur_slot_ + 1) % slot_count_;
+        written_ranges_.Clear();
+
+        auto& pending = slot_pending_ranges_[cur_slot_];
+        uint8_t* slot_data = mapped_data_ + GetCurrentSlotOffset();
+        for (auto& range : pending.GetRanges())
+        {
+            ::memcpy(slot_data + range.begin, shadow_.data() + range.begin, range.end - range.begin);
+        }
+
+        pending.Clear();
+    }
+
+    uint32_t ConstantBufferWriter::GetCurrentSlot() const
+    {
+        return cur_slot_;
+    }
+
+    uint64_t ConstantBufferWriter::GetCurrentSlotOffset() const
+    {
+        return static_cast<uint64_t>(cur_slot_) * slot_stride_;
+    }
+
+    const ConstantBufferLayout& ConstantBufferWriter::GetLayout() const
+    {
+        return layout_;
+    }
+
+    const DirtyRangeTracker& ConstantBufferWriter::GetWrittenRanges() const
+    {
+        return written_ranges_;
+    }
+};
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace D3D
+{
+    enum ShaderVariableClass { kScalarVariable, kVectorVariable, kRowMajorMatrix, kColumnMajorMatrix, kStructVariable };
+
+    struct ShaderVariableType
+    {
+        ShaderVariableClass var_class = kScalarVariable;
+        uint32_t rows = 1;
+        uint32_t columns = 1;
+        uint32_t elements = 0;      // 0 means the variable is not an array
+    };
+
+    struct ConstantBufferField
+    {
+        std::string name;
+        uint32_t offset = 0;
+        uint32_t size = 0;
+        ShaderVariableType type;
+    };
+
+    // C++ side description of one member of a struct mirrored into a cbuffer.
+    struct CppFieldDesc
+    {
+        const char* name = nullptr;
+        uint32_t offset = 0;
+        uint32_t size = 0;
+    };
+
+    #define CBUFFER_CPP_FIELD(type, member, hlsl_name) \
+        D3D::CppFieldDesc{ hlsl_name, static_cast<uint32_t>(offsetof(type, member)), static_cast<uint32_t>(sizeof(static_cast<type*>(nullptr)->member)) }
+
+    class ConstantBufferLayout
+    {
+    public:
+        static const uint32_t REGISTER_SIZE_ = 16;
+
+        ConstantBufferLayout() = default;
+        explicit ConstantBufferLayout(const std::string& name);
+
+        // Adds a field with an offset taken from shader reflection.
+        void AddReflectedField(const std::string& name, uint32_t offset, uint32_t size, const ShaderVariableType& type);
+
+        // Appends a field after the last one, placing it with the HLSL cbuffer packing rules.
+        uint32_t AppendField(const std::string& name, const ShaderVariableType& type);
+
+        void SetSize(uint32_t size);
+
+        const std::string& GetName() const;
+        uint32_t GetSize() const;
+        const std::vector<ConstantBufferField>& GetFields() const;
+        const ConstantBufferField* FindField(const std::string& name) const;
+
+        // Checks a C++ mirror struct against this layout: every C++ field has to exist with
+        // the same offset and size, and must not straddle a 16 byte register.
+        bool Validate(const CppFieldDesc* cpp_fields, uint32_t count, uint32_t cpp_struct_size, std::string* error = nullptr) const;
+
+        static uint32_t GetPackedSize(const ShaderVariableType& type);
+        static uint32_t GetPackedOffset(uint32_t cursor, const ShaderVariableType& type);
+
+    private:
+        std::string                                         name_;
+        uint32_t                                            size_ = 0;
+        std::vector<ConstantBufferField>                    fields_;
+        std::unordered_map<std::string, uint32_t>           field_index_map_;
+    };
+
+    // Keeps a sorted list of non overlapping [begin, end) byte ranges.
+    class DirtyRangeTracker
+    {
+    public:
+        struct Range
+        {
+            uint32_t begin = 0;
+            uint32_t end = 0;
+        };
+
+        void MarkDirty(uint32_t begin, uint32_t end);
+        void Clear();
+
+        bool Empty() const;
+        uint32_t GetDirtyByteCount() const;
+        const std::vector<Range>& GetRanges() const;
+
+    private:
+        std::vector<Range>                                  ranges_;
+    };
+
+    template<typename T>
+    struct ConstantFieldHandle
+    {
+        static const uint32_t INVALID_OFFSET_ = 0xffffffff;
+
+        uint32_t offset = INVALID_OFFSET_;
+
+        bool IsValid() const
+        {
+            return offset != INVALID_OFFSET_;
+        }
+    };
+
+    // Writes cbuffer fields straight into persistently mapped upload memory. A CPU shadow copy
+    // lets unchanged values be skipped and lets the slots of a frame ring catch up with only
+    // the bytes that were written while they were in flight.
+    class ConstantBufferWriter
+    {
+    public:
+        ConstantBufferWriter() = default;
+
+        void Initialize(const ConstantBufferLayout& layout, uint8_t* mapped_data, uint32_t slot_stride, uint32_t slot_count = 1);
+
+        template<typename T>
+        ConstantFieldHandle<T> GetField(const std::string& name) const
+        {
+            ConstantFieldHandle<T> handle;
+            auto field = layout_.FindField(name);
+            if (field != nullptr && field->size == sizeof(T))
+            {
+                handle.offset = field->offset;
+            }
+
+            return handle;
+        }
+
+        template<typename T>
+        bool Write(ConstantFieldHandle<T> handle, const T& value)
+        {
+            if (!handle.IsValid())
+            {
+                return false;
+            }
+
+            return WriteBytes(handle.offset, &value, sizeof(T));
+        }
+
+        // Returns false when the bytes were already up to date and nothing was written.
+        bool WriteBytes(uint32_t offset, const void* data, uint32_t size);
+
+        // Moves to the next slot of the ring and replays the writes that slot has missed.
+        void NextSlot();
+
+        uint32_t GetCurrentSlot() const;
+        uint64_t GetCurrentSlotOffset() const;
+        const ConstantBufferLayout& GetLayout() const;
+        const DirtyRangeTracker& GetWrittenRanges() const;
+
+    private:
+        ConstantBufferLayout                                layout_;
+        uint8_t*                                            mapped_data_ = nullptr;
+        uint32_t                                            slot_stride_ = 0;
+        uint32_t                                            slot_count_ = 0;
+        uint32_t                                            cur_slot_ = 0;
+        std::vector<uint8_t>                                shadow_;
+        std::vector<DirtyRangeTracker>                      slot_pending_ranges_;
+        DirtyRangeTracker                                   written_ranges_;
+    };
+};
@@ -0,0 +1,213 @@
+#include "ConstantBufferLayout.h"
+
+#include <cstring>
+
+#include "TestHarness.h"
+
+using namespace D3D;
+
+namespace
+{
+    struct alignas(16) Matrix4
+    {
+        float m[16];
+    };
+
+    // Mirrors the layout the Append test builds.
+    struct ObjectConstants
+    {
+        Matrix4 model_mat;
+        Matrix4 view_mat;
+        uint32_t flags;
+        float tex_scale[2];
+        float pad;
+        float color[3];
+    };
+
+    const ShaderVariableType MATRIX_TYPE{ kColumnMajorMatrix, 4, 4, 0 };
+    const ShaderVariableType UINT_TYPE{ kScalarVariable, 1, 1, 0 };
+    const ShaderVariableType FLOAT2_TYPE{ kVectorVariable, 1, 2, 0 };
+    const ShaderVariableType FLOAT3_TYPE{ kVectorVariable, 1, 3, 0 };
+    const ShaderVariableType FLOAT_ARRAY_TYPE{ kScalarVariable, 1, 1, 3 };
+
+    ConstantBufferLayout CreateObjectLayout()
+    {
+        ConstantBufferLayout layout("ObjectConstants");
+        layout.AppendField("MODEL_MAT", MATRIX_TYPE);
+        layout.AppendField("VIEW_MAT", MATRIX_TYPE);
+        layout.AppendField("FLAGS", UINT_TYPE);
+        layout.AppendField("TEX_SCALE", FLOAT2_TYPE);
+        layout.AppendField("COLOR", FLOAT3_TYPE);
+        return layout;
+    }
+
+    void TestPacking()
+    {
+        TEST_CHECK(ConstantBufferLayout::GetPackedSize(MATRIX_TYPE) == 64);
+        TEST_CHECK(ConstantBufferLayout::GetPackedSize(FLOAT3_TYPE) == 12);
+        TEST_CHECK(ConstantBufferLayout::GetPackedSize(ShaderVariableType{ kRowMajorMatrix, 3, 4, 0 }) == 48);
+        TEST_CHECK(ConstantBufferLayout::GetPackedSize(ShaderVariableType{ kColumnMajorMatrix, 3, 4, 0 }) == 60);
+
+        // Array elements take a register each, only the last one is packed tightly.
+        TEST_CHECK(ConstantBufferLayout::GetPackedSize(FLOAT_ARRAY_TYPE) == 36);
+
+        TEST_CHECK(ConstantBufferLayout::GetPackedOffset(4, FLOAT2_TYPE) == 4);
+        TEST_CHECK(ConstantBufferLayout::GetPackedOffset(8, FLOAT3_TYPE) == 16);
+        TEST_CHECK(ConstantBufferLayout::GetPackedOffset(4, FLOAT_ARRAY_TYPE) == 16);
+        TEST_CHECK(ConstantBufferLayout::GetPackedOffset(4, MATRIX_TYPE) == 16);
+
+        auto layout = CreateObjectLayout();
+        TEST_CHECK(layout.FindField("MODEL_MAT")->offset == 0);
+        TEST_CHECK(layout.FindField("VIEW_MAT")->offset == 64);
+        TEST_CHECK(layout.FindField("FLAGS")->offset == 128);
+        TEST_CHECK(layout.FindField("TEX_SCALE")->offset == 132);
+        TEST_CHECK(layout.FindField("COLOR")->offset == 144);
+        TEST_CHECK(layout.FindField("MISSING") == nullptr);
+        TEST_CHECK(layout.GetSize() == 160);
+    }
+
+    void TestValidate()
+    {
+        auto layout = CreateObjectLayout();
+
+        const CppFieldDesc fields[] =
+        {
+            CBUFFER_CPP_FIELD(ObjectConstants, model_mat, "MODEL_MAT"),
+            CBUFFER_CPP_FIELD(ObjectConstants, view_mat, "VIEW_MAT"),
+            CBUFFER_CPP_FIELD(ObjectConstants, flags, "FLAGS"),
+            CBUFFER_CPP_FIELD(ObjectConstants, tex_scale, "TEX_SCALE"),
+            CBUFFER_CPP_FIELD(ObjectConstants, color, "COLOR"),
+        };
+
+        std::string error;
+        TEST_CHECK(layout.Validate(fields, 5, sizeof(ObjectConstants), &error));
+        TEST_CHECK(error.empty());
+
+        // A field the shader does not have.
+        CppFieldDesc missing[] = { { "MISSING", 0, 4 } };
+        TEST_CHECK(!layout.Validate(missing, 1, sizeof(ObjectConstants), &error));
+        TEST_CHECK(error.find("not found") != std::string::npos);
+
+        CppFieldDesc wrong_offset[] = { { "COLOR", 148, 12 } };
+        TEST_CHECK(!layout.Validate(wrong_offset, 1, sizeof(ObjectConstants), &error));
+        TEST_CHECK(error.find("offset") != std::string::npos);
+
+        CppFieldDesc wrong_size[] = { { "TEX_SCALE", 132, 12 } };
+        TEST_CHECK(!layout.Validate(wrong_size, 1, sizeof(ObjectConstants), &error));
+        TEST_CHECK(error.find("size") != std::string::npos);
+
+        // A float3 at offset 8 runs into the next register, which HLSL never does.
+        ConstantBufferLayout straddling("Straddling");
+        straddling.AddReflectedField("COLOR", 8, 12, FLOAT3_TYPE);
+        CppFieldDesc straddling_field[] = { { "COLOR", 8, 12 } };
+        TEST_CHECK(!straddling.Validate(straddling_field, 1, 20, &error));
+        TEST_CHECK(error.find("straddles") != std::string::npos);
+
+        TEST_CHECK(!layout.Validate(fields, 5, layout.GetSize() + 16, &error));
+        TEST_CHECK(error.find("exceeds") != std::string::npos);
+    }
+
+    void TestDirtyRangeTracker()
+    {
+        DirtyRangeTracker tracker;
+        TEST_CHECK(tracker.Empty());
+
+        // Empty ranges are ignored.
+        tracker.MarkDirty(8, 8);
+        TEST_CHECK(tracker.Empty());
+
+        tracker.MarkDirty(32, 48);
+        tracker.MarkDirty(0, 16);
+        tracker.MarkDirty(64, 80);
+        TEST_CHECK(tracker.GetRanges().size() == 3);
+        TEST_CHECK(tracker.GetRanges()[0].begin == 0 && tracker.GetRanges()[0].end == 16);
+        TEST_CHECK(tracker.GetRanges()[1].begin == 32 && tracker.GetRanges()[1].end == 48);
+        TEST_CHECK(tracker.GetDirtyByteCount() == 48);
+
+        // Adjacent ranges merge.
+        tracker.MarkDirty(16, 20);
+        TEST_CHECK(tracker.GetRanges().size() == 3);
+        TEST_CHECK(tracker.GetRanges()[0].end == 20);
+
+        // Contained ranges change nothing.
+        tracker.MarkDirty(34, 40);
+        TEST_CHECK(tracker.GetRanges().size() == 3);
+        TEST_CHECK(tracker.GetDirtyByteCount() == 52);
+
+        // One range over several merges them all.
+        tracker.MarkDirty(10, 70);
+        TEST_CHECK(tracker.GetRanges().size() == 1);
+        TEST_CHECK(tracker.GetRanges()[0].begin == 0 && tracker.GetRanges()[0].end == 80);
+
+        tracker.Clear();
+        TEST_CHECK(tracker.Empty() && tracker.GetDirtyByteCount() == 0);
+
+        // Against a byte mask over random ranges.
+        bool dirty[256] = {};
+        uint32_t seed = 1;
+        for (uint32_t i = 0; i < 200; i++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            uint32_t begin = (seed >> 8) % 256;
+            seed = seed * 1664525u + 1013904223u;
+            uint32_t end = (std::min)(begin + (seed >> 8) % 24, 256u);
+            tracker.MarkDirty(begin, end);
+            for (uint32_t b = begin; b < end; b++)
+            {
+                dirty[b] = true;
+            }
+        }
+
+        uint32_t dirty_count = 0;
+        for (bool b : dirty)
+        {
+            dirty_count += b ? 1 : 0;
+        }
+
+        TEST_CHECK(tracker.GetDirtyByteCount() == dirty_count);
+
+        auto& ranges = tracker.GetRanges();
+        for (size_t i = 0; i < ranges.size(); i++)
+        {
+            TEST_CHECK(ranges[i].begin < ranges[i].end);
+            TEST_CHECK(i == 0 || ranges[i - 1].end < ranges[i].begin);
+            TEST_CHECK(dirty[ranges[i].begin] && (ranges[i].begin == 0 || !dirty[ranges[i].begin - 1]));
+        }
+    }
+
+    void TestWriter()
+    {
+        auto layout = CreateObjectLayout();
+        const uint32_t slot_stride = 256;
+        uint8_t mapped[slot_stride * 2];
+        ::memset(mapped, 0xcd, sizeof(mapped));
+
+        ConstantBufferWriter writer;
+        writer.Initialize(layout, mapped, slot_stride, 2);
+
+        auto flags = writer.GetField<uint32_t>("FLAGS");
+        TEST_CHECK(flags.IsValid());
+        TEST_CHECK(!writer.GetField<float>("MODEL_MAT").IsValid());
+
+        // Unchanged values are skipped.
+        TEST_CHECK(writer.Write(flags, 5u));
+        TEST_CHECK(!writer.Write(flags, 5u));
+        TEST_CHECK(writer.GetWrittenRanges().GetDirtyByteCount() == 4);
+
+        // The other slot catches up when the ring reaches it.
+        writer.NextSlot();
+        uint32_t value = 0;
+        ::memcpy(&value, mapped + slot_stride + 128, sizeof(value));
+        TEST_CHECK(value == 5);
+        TEST_CHECK(writer.GetWrittenRanges().Empty());
+    }
+}
+
+int main()
+{
+    TestPacking();
+    TestValidate();
+    TestDirtyRangeTracker();
+    TestWriter();
+    return D3D::Test::Finish("ConstantBufferLayoutTests");
+}
@@ -10,7 +10,7 @@ namespace D3D
     using namespace Microsoft::WRL;
     using namespace DirectX;
 
-    const std::vector<std::string> SEMANTIC_NAMES = { "POSITION", "NORMAL", "TANGENT", "TEXCOORD" };
+    const std::vector<std::string> SEMANTIC_NAMES = { "POSITION", "NORMAL", "TANGENT", "TEXCOORD", "INSTANCE_MODEL" };
 
     D3D12BoundResourceManager::D3D12BoundResourceManager()
     {
@@ -20,8 +20,9 @@ namespace D3D
     {
     }
 
-    void D3D12BoundResourceManager::Initialize(ID3DBlob *const shader_arr[5])
+    void D3D12BoundResourceManager::Initialize(ID3DBlob *const shader_arr[5], const VertexFormatDesc& vertex_format)
     {
+        vertex_format_ = vertex_format;
         InitializeBoundResource(shader_arr);
         InitializeDescriptorHeap();
         InitializeRootSignature();
@@ -29,45 +30,66 @@ namespace D3D
 
     D3D12_CPU_DESCRIPTOR_HANDLE D3D12BoundResourceManager::GetDescriptorHandle(const std::string& res_name, uint32_t index)
     {
-        auto find_it = resource_bind_map_.find(res_name);
-        if (find_it == resource_bind_map_.end())
+        D3D12_DESCRIPTOR_RANGE_TYPE range_type{};
+        uint32_t slot{};
+        if (!GetDescriptorSlot(res_name, index, &range_type, &slot))
         {
             return {};
         }
 
-        auto& res_bind = find_it->second;
-        auto& descriptor_range_desc = res_bind.descriptor_range_desc;
+        // SRV/UAV/CBV tables are versioned, their views go through BindShaderResourceView and BindConstantBufferView.
+        ThrowIfFalse(range_type == D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER);
 
-        if (index >= descriptor_range_desc->bind_count)
+        DescriptorHeap dx_descriptor_heap(sampler_heap_.Get());
+        return dx_descriptor_heap.GetCpuHandle(slot);
+    }
+
+    bool D3D12BoundResourceManager::BindShaderResourceView(const std::string& res_name, uint32_t index, ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC& desc)
+    {
+        D3D12_DESCRIPTOR_RANGE_TYPE range_type{};
+        uint32_t slot{};
+        if (!GetDescriptorSlot(res_name, index, &range_type, &slot) || range_type != D3D12_DESCRIPTOR_RANGE_TYPE_SRV)
         {
-            return {};
+            return false;
         }
 
-        switch (descriptor_range_desc->range_type)
+        srv_uav_cbv_table_.SetView(slot, DescriptorView::Create(kSrvView, resource, desc));
+        return true;
+    }
+
+    bool D3D12BoundResourceManager::BindConstantBufferView(const std::string& res_name, uint32_t index, const D3D12_CONSTANT_BUFFER_VIEW_DESC& desc)
+    {
+        D3D12_DESCRIPTOR_RANGE_TYPE range_type{};
+        uint32_t slot{};
+        if (!GetDescriptorSlot(res_name, index, &range_type, &slot) || range_type != D3D12_DESCRIPTOR_RANGE_TYPE_CBV)
         {
-            case D3D12_DESCRIPTOR_RANGE_TYPE_SRV:
-            case D3D12_DESCRIPTOR_RANGE_TYPE_UAV:
-            case D3D12_DESCRIPTOR_RANGE_TYPE_CBV:
-            {
-                DescriptorHeap dx_descriptor_heap(srv_uav_cbv_heap_.Get());
-                return dx_descriptor_heap.GetCpuHandle(descriptor_range_desc->root_signature_offset + res_bind.bind_desc.BindPoint + index);
-            }
-            break;
+            return false;
+        }
 
-            case D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER:
-            {
-                DescriptorHeap dx_descriptor_heap(sampler_heap_.Get());
-                return dx_descriptor_heap.GetCpuHandle(descriptor_range_desc->root_signature_offset + res_bind.bind_desc.BindPoint + index);
-            }
-            break;
+        srv_uav_cbv_table_.SetView(slot, DescriptorView::Create(kCbvView, nullptr, desc));
+        return true;
+    }
 
-            default:
-                ThrowIfFailed(0);
-            break;
+    void D3D12BoundResourceManager::CommitDescriptorTable(uint64_t frame_fence_value, uint64_t completed_fence_value)
+    {
+        if (srv_uav_cbv_heap_ == nullptr)
+        {
+            return;
         }
 
-        ThrowIfFailed(0);
-        return {};
+        srv_uav_cbv_allocator_.Reclaim(completed_fence_value);
+        srv_uav_cbv_table_.Commit(&heap_device_, frame_fence_value);
+    }
+
+    const ConstantBufferLayout* D3D12BoundResourceManager::GetConstantBufferLayout(const std::string& cbuffer_name)
+    {
+        auto find_it = cbuffer_layout_map_.find(cbuffer_name);
+        if (find_it == cbuffer_layout_map_.end())
+        {
+            return nullptr;
+        }
+
+        return &find_it->second;
     }
 
     bool D3D12BoundResourceManager::BindDefaultSampler(const std::string& sampler_name, uint32_t index, DefaultSamplerType default_sampler)
@@ -93,11 +115,50 @@ namespace D3D
         return sampler_heap_.Get();
     }
 
+    D3D12_GPU_DESCRIPTOR_HANDLE D3D12BoundResourceManager::GetSrvUavCbvTableGpuHandle()
+    {
+        ThrowIfFalse(srv_uav_cbv_table_.GetHeapIndex() != DescriptorTableAllocator::INVALID_INDEX_);
+
+        DescriptorHeap dx_descriptor_heap(srv_uav_cbv_heap_.Get());
+        return dx_descriptor_heap.GetGpuHandle(srv_uav_cbv_table_.GetHeapIndex());
+    }
+
+    bool D3D12BoundResourceManager::GetDescriptorSlot(const std::string& res_name, uint32_t index, D3D12_DESCRIPTOR_RANGE_TYPE* range_type, uint32_t* slot)
+    {
+        auto find_it = resource_bind_map_.find(res_name);
+        if (find_it == resource_bind_map_.end())
+        {
+            return false;
+        }
+
+        auto& res_bind = find_it->second;
+        auto& descriptor_range_desc = res_bind.descriptor_range_desc;
+
+        if (index >= descriptor_range_desc->bind_count)
+        {
+            return false;
+        }
+
+        *range_type = descriptor_range_desc->range_type;
+        *slot = descriptor_range_desc->root_signature_offset + res_bind.bind_desc.BindPoint - descriptor_range_desc->bind_point + index;
+        return true;
+    }
+
     const std::vector<D3D12_INPUT_ELEMENT_DESC>& D3D12BoundResourceManager::GetInputElemDescArray()
     {
         return input_elements_;
     }
 
+    uint32_t D3D12BoundResourceManager::GetVertexStreamMask() const
+    {
+        return input_layout_.stream_mask;
+    }
+
+    uint32_t D3D12BoundResourceManager::GetInstanceSlot() const
+    {
+        return input_layout_.instance_slot;
+    }
+
     ID3D12RootSignature* D3D12BoundResourceManager::GetRootSignature()
     {
         return root_signature_.Get();
@@ -105,26 +166,73 @@ namespace D3D
 
     std::vector<D3D12_INPUT_ELEMENT_DESC> D3D12BoundResourceManager::ParserVsInputParamters(const std::vector<D3D12_SIGNATURE_PARAMETER_DESC>& input_paramters)
     {
-        std::vector<D3D12_INPUT_ELEMENT_DESC> vec_input_elements;
-
-        uint32_t offset{ 0 };
+        std::vector<VertexInputParameter> parameters;
         for (auto& paramter : input_paramters)
+        {
+            // System values such as SV_InstanceID are generated, not fetched.
+            if (paramter.SystemValueType != D3D_NAME_UNDEFINED)
+            {
+                continue;
+            }
+
+            VertexInputParameter parameter;
+            parameter.semantic_name = SwitchSemanticName(paramter.SemanticName);
+            parameter.semantic_index = paramter.SemanticIndex;
+            parameters.push_back(parameter);
+        }
+
+        ThrowIfFalse(vertex_format_.BuildInputLayout(parameters.data(), static_cast<uint32_t>(parameters.size()), input_layout_));
+
+        std::vector<D3D12_INPUT_ELEMENT_DESC> vec_input_elements;
+        for (auto& element : input_layout_.elements)
         {
             D3D12_INPUT_ELEMENT_DESC input_elem_desc{};
-            input_elem_desc.SemanticName = SwitchSemanticName(paramter.SemanticName);
-            input_elem_desc.SemanticIndex = paramter.SemanticIndex;
-            input_elem_desc.Format = GetDxgiFormatFromSemanticName(paramter.SemanticName);
-            input_elem_desc.InputSlot = 0;
-            input_elem_desc.AlignedByteOffset = offset;
-            input_elem_desc.InputSlotClass = D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA;
-            input_elem_desc.InstanceDataStepRate = 0;
-            offset += GetDxgiFormatTypeLength(input_elem_desc.Format);
+            input_elem_desc.SemanticName = element.semantic_name;
+            input_elem_desc.SemanticIndex = element.semantic_index;
+            input_elem_desc.Format = GetDxgiFormat(element.format);
+            input_elem_desc.InputSlot = element.slot;
+            input_elem_desc.AlignedByteOffset = element.offset;
+            input_elem_desc.InputSlotClass = element.per_instance ? D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA : D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA;
+            input_elem_desc.InstanceDataStepRate = element.per_instance ? 1 : 0;
             vec_input_elements.push_back(input_elem_desc);
         }
 
         return vec_input_elements;
     }
 
+    void D3D12BoundResourceManager::ParserConstantBuffers(ID3D12ShaderReflection* shader_reflect, const D3D12_SHADER_DESC& shader_desc)
+    {
+        for (uint32_t c = 0; c < shader_desc.ConstantBuffers; c++)
+        {
+            auto cbuffer_reflect = shader_reflect->GetConstantBufferByIndex(c);
+
+            D3D12_SHADER_BUFFER_DESC cbuffer_desc{};
+            ThrowIfFailed(cbuffer_reflect->GetDesc(&cbuffer_desc));
+
+            if (cbuffer_desc.Type != D3D_CT_CBUFFER || cbuffer_layout_map_.count(cbuffer_desc.Name) != 0)
+            {
+                continue;
+            }
+
+            ConstantBufferLayout layout(cbuffer_desc.Name);
+            for (uint32_t v = 0; v < cbuffer_desc.Variables; v++)
+            {
+                auto var_reflect = cbuffer_reflect->GetVariableByIndex(v);
+
+                D3D12_SHADER_VARIABLE_DESC var_desc{};
+                ThrowIfFailed(var_reflect->GetDesc(&var_desc));
+
+                D3D12_SHADER_TYPE_DESC type_desc{};
+                ThrowIfFailed(var_reflect->GetType()->GetDesc(&type_desc));
+
+                layout.AddReflectedField(var_desc.Name, var_desc.StartOffset, var_desc.Size, GetShaderVariableType(type_desc));
+            }
+            layout.SetSize(cbuffer_desc.Size);
+
+            cbuffer_layout_map_.emplace(cbuffer_desc.Name, std::move(layout));
+        }
+    }
+
     void D3D12BoundResourceManager::InitializeBoundResource(ID3DBlob *const shader_arr[5])
     {
         std::array<TmpBindPointData, 4> tmp_bind_data;
@@ -153,6 +261,8 @@ namespace D3D
                 input_elements_ = ParserVsInputParamters(input_paramters_);
             }
 
+            ParserConstantBuffers(vs_shader_reflect.Get(), shader_desc);
+
             for (uint32_t r = 0; r < shader_desc.BoundResources; r++)
             {
                 D3D12_SHADER_INPUT_BIND_DESC bound_resource_desc{};
@@ -181,7 +291,17 @@ namespace D3D
             bound_point_map_[D3D12_DESCRIPTOR_RANGE_TYPE_UAV].bind_count +
             bound_point_map_[D3D12_DESCRIPTOR_RANGE_TYPE_CBV].bind_count;
 
-        srv_uav_cbv_heap_ = D3D12Manager::CreateDescriptorHeap(srv_uav_cbv_count, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE);
+        if (srv_uav_cbv_count > 0)
+        {
+            // Room for several versions of the table, so a changed view never overwrites descriptors in flight.
+            uint32_t heap_size = srv_uav_cbv_count * DESCRIPTOR_TABLE_VERSION_COUNT_;
+            srv_uav_cbv_heap_ = D3D12Manager::CreateDescriptorHeap(heap_size, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE);
+            srv_uav_cbv_cpu_heap_ = D3D12Manager::CreateDescriptorHeap(heap_size, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, D3D12_DESCRIPTOR_HEAP_FLAG_NONE);
+
+            srv_uav_cbv_allocator_.Initialize(heap_size);
+            srv_uav_cbv_table_.Initialize(&srv_uav_cbv_allocator_, srv_uav_cbv_count);
+            heap_device_.Initialize(srv_uav_cbv_cpu_heap_.Get(), srv_uav_cbv_heap_.Get());
+        }
 
         if (bound_point_map_[D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER].bind_count > 0)
         {
@@ -220,23 +340,30 @@ namespace D3D
         root_signature_ = D3D12Manager::CreateRootSignature(root_paramter, paramter_count);
     }
 
-    DXGI_FORMAT D3D12BoundResourceManager::GetDxgiFormatFromSemanticName(const std::string& semnatic_name)
+    DXGI_FORMAT D3D12BoundResourceManager::GetDxgiFormat(VertexElementFormat format)
     {
-        if (semnatic_name.find("POSITION") != std::string::npos)
-        {
-            return DXGI_FORMAT_R32G32B32_FLOAT;
-        }
-        else if (semnatic_name.find("NORMAL") != std::string::npos)
-        {
-            return DXGI_FORMAT_R32G32B32_FLOAT;
-        }
-        else if (semnatic_name.find("TANGENT") != std::string::npos)
-        {
-            return DXGI_FORMAT_R32G32B32_FLOAT;
-        }
-        else if (semnatic_name.find("TEXCOORD") != std::string::npos)
+        switch (format)
         {
+        case kVertexFloat2:
             return DXGI_FORMAT_R32G32_FLOAT;
+
+        case kVertexFloat3:
+            return DXGI_FORMAT_R32G32B32_FLOAT;
+
+        case kVertexHalf2:
+            return DXGI_FORMAT_R16G16_FLOAT;
+
+        case kVertexHalf4:
+            return DXGI_FORMAT_R16G16B16A16_FLOAT;
+
+        case kVertexSnorm16x4:
+            return DXGI_FORMAT_R16G16B16A16_SNORM;
+
+        case kVertexOctahedral16:
+            return DXGI_FORMAT_R16G16_SNORM;
+
+        case kVertexFloat4:
+            return DXGI_FORMAT_R32G32B32A32_FLOAT;
         }
 
         ThrowIfFalse(0);
@@ -336,6 +463,84 @@ namespace D3D
         return it->c_str();
     }
 
+    void D3D12BoundResourceManager::HeapDevice::Initialize(ID3D12DescriptorHeap* cpu_heap, ID3D12DescriptorHeap* gpu_heap)
+    {
+        cpu_heap_ = cpu_heap;
+        gpu_heap_ = gpu_heap;
+    }
+
+    void D3D12BoundResourceManager::HeapDevice::WriteDescriptor(const DescriptorView& view, uint32_t heap_index)
+    {
+        auto device = D3D12Manager::GetDevice();
+        DescriptorHeap dx_cpu_heap(cpu_heap_);
+        DescriptorHeap dx_gpu_heap(gpu_heap_);
+        auto cpu_handle = dx_cpu_heap.GetCpuHandle(heap_index);
+
+        switch (view.type)
+        {
+            case kSrvView:
+                device->CreateShaderResourceView(static_cast<ID3D12Resource*>(view.resource), &view.GetDesc<D3D12_SHADER_RESOURCE_VIEW_DESC>(), cpu_handle);
+            break;
+
+            case kUavView:
+                device->CreateUnorderedAccessView(static_cast<ID3D12Resource*>(view.resource), nullptr, &view.GetDesc<D3D12_UNORDERED_ACCESS_VIEW_DESC>(), cpu_handle);
+            break;
+
+            case kCbvView:
+                device->CreateConstantBufferView(&view.GetDesc<D3D12_CONSTANT_BUFFER_VIEW_DESC>(), cpu_handle);
+            break;
+
+            default:
+                ThrowIfFalse(0);
+            break;
+        }
+
+        device->CopyDescriptorsSimple(1, dx_gpu_heap.GetCpuHandle(heap_index), cpu_handle, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    }
+
+    void D3D12BoundResourceManager::HeapDevice::CopyDescriptors(uint32_t dest_heap_index, uint32_t src_heap_index, uint32_t count)
+    {
+        auto device = D3D12Manager::GetDevice();
+        DescriptorHeap dx_cpu_heap(cpu_heap_);
+        DescriptorHeap dx_gpu_heap(gpu_heap_);
+
+        device->CopyDescriptorsSimple(count, dx_cpu_heap.GetCpuHandle(dest_heap_index), dx_cpu_heap.GetCpuHandle(src_heap_index), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+        device->CopyDescriptorsSimple(count, dx_gpu_heap.GetCpuHandle(dest_heap_index), dx_cpu_heap.GetCpuHandle(src_heap_index), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    }
+
+    ShaderVariableType D3D12BoundResourceManager::GetShaderVariableType(const D3D12_SHADER_TYPE_DESC& type_desc)
+    {
+        ShaderVariableType var_type;
+        var_type.rows = type_desc.Rows;
+        var_type.columns = type_desc.Columns;
+        var_type.elements = type_desc.Elements;
+
+        switch (type_desc.Class)
+        {
+            case D3D_SVC_SCALAR:
+                var_type.var_class = kScalarVariable;
+            break;
+
+            case D3D_SVC_VECTOR:
+                var_type.var_class = kVectorVariable;
+            break;
+
+            case D3D_SVC_MATRIX_ROWS:
+                var_type.var_class = kRowMajorMatrix;
+            break;
+
+            case D3D_SVC_MATRIX_COLUMNS:
+                var_type.var_class = kColumnMajorMatrix;
+            break;
+
+            default:
+                var_type.var_class = kStructVariable;
+            break;
+        }
+
+        return var_type;
+    }
+
     D3D12_SAMPLER_DESC D3D12BoundResourceManager::GetDefaultSamplerDesc(DefaultSamplerType default_sampler)
     {
         switch (default_sampler)
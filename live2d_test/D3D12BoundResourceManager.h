@@ -1,6 +1,9 @@
 #pragma once
 
 #include "D3D12Manager.h"
+#include "ConstantBufferLayout.h"
+#include "DescriptorTableCache.h"
+#include "VertexFormat.h"
 #include "d3dcompiler.h"
 #include <unordered_map>
 #include <array>
@@ -12,21 +15,47 @@ namespace D3D
     public:
         enum DefaultSamplerType { kPointWrap, kPointClamp, kLinearWrap, kLinearClamp, kAnisotropicWrap, kAnisotropicClamp };
 
+        static const uint32_t DESCRIPTOR_TABLE_VERSION_COUNT_ = 8;
+
         D3D12BoundResourceManager();
         ~D3D12BoundResourceManager();
 
-        void Initialize(ID3DBlob *const shader_arr[5]);
+        // The input layout of the vertex shader is read from vertex_format, per instance inputs
+        // keep their fixed formats and use the slot after the vertex streams.
+        void Initialize(ID3DBlob *const shader_arr[5], const VertexFormatDesc& vertex_format = VertexFormatDesc::Full());
 
         D3D12_CPU_DESCRIPTOR_HANDLE GetDescriptorHandle(const std::string &res_name, uint32_t index);
+        bool BindShaderResourceView(const std::string& res_name, uint32_t index, ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC& desc);
+        bool BindConstantBufferView(const std::string& res_name, uint32_t index, const D3D12_CONSTANT_BUFFER_VIEW_DESC& desc);
+        void CommitDescriptorTable(uint64_t frame_fence_value, uint64_t completed_fence_value);
+        const ConstantBufferLayout* GetConstantBufferLayout(const std::string& cbuffer_name);
         bool BindDefaultSampler(const std::string& sampler_name, uint32_t index, DefaultSamplerType default_sampler);
 
         ID3D12DescriptorHeap* GetSrvUavCbvDescriptorHeap();
         ID3D12DescriptorHeap* GetSampleDescriptorHeap();
+        D3D12_GPU_DESCRIPTOR_HANDLE GetSrvUavCbvTableGpuHandle();
 
         const std::vector<D3D12_INPUT_ELEMENT_DESC>& GetInputElemDescArray();
+        uint32_t GetVertexStreamMask() const;               // streams of vertex_format to bind
+        uint32_t GetInstanceSlot() const;
         ID3D12RootSignature* GetRootSignature();
 
     private:
+        // Writes views into a CPU only heap and copies them into the shader visible heap,
+        // copy sources must not be shader visible.
+        class HeapDevice : public DescriptorHeapDevice
+        {
+        public:
+            void Initialize(ID3D12DescriptorHeap* cpu_heap, ID3D12DescriptorHeap* gpu_heap);
+
+            void WriteDescriptor(const DescriptorView& view, uint32_t heap_index) override;
+            void CopyDescriptors(uint32_t dest_heap_index, uint32_t src_heap_index, uint32_t count) override;
+
+        private:
+            ID3D12DescriptorHeap*                           cpu_heap_ = nullptr;
+            ID3D12DescriptorHeap*                           gpu_heap_ = nullptr;
+        };
+
         struct TmpBindPointData
         {
             uint32_t max_bind_point = 0;
@@ -49,26 +78,37 @@ namespace D3D
         };
 
         using ShaderInputBindMap = std::unordered_map<std::string, ResourceBindInfo>;
+        using ConstantBufferLayoutMap = std::unordered_map<std::string, ConstantBufferLayout>;
         using RangeBindPointDescArray = std::array<DescriptorRangeBindPointDesc, 4>;
 
         std::vector<D3D12_SIGNATURE_PARAMETER_DESC>         input_paramters_;
         std::vector<D3D12_INPUT_ELEMENT_DESC>               input_elements_;
+        VertexFormatDesc                                    vertex_format_;
+        VertexInputLayout                                   input_layout_;
         ShaderInputBindMap                                  resource_bind_map_;
         RangeBindPointDescArray                             bound_point_map_;
+        ConstantBufferLayoutMap                             cbuffer_layout_map_;
 
         Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>        srv_uav_cbv_heap_;
+        Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>        srv_uav_cbv_cpu_heap_;
+        DescriptorTableAllocator                            srv_uav_cbv_allocator_;
+        VersionedDescriptorTable                            srv_uav_cbv_table_;
+        HeapDevice                                          heap_device_;
         Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>        sampler_heap_;
         Microsoft::WRL::ComPtr<ID3D12RootSignature>         root_signature_;
 
-        static DXGI_FORMAT GetDxgiFormatFromSemanticName(const std::string& semnatic_name);
+        static DXGI_FORMAT GetDxgiFormat(VertexElementFormat format);
         static std::string GetShaderResourceIdentify(const std::string& raw_name);
         static D3D12_DESCRIPTOR_RANGE_TYPE GetDescriptorRangeType(D3D_SHADER_INPUT_TYPE shader_input_type);
         static void UpdateResourceBoundPoint(TmpBindPointData& resource_bound_desc, DescriptorRangeBindPointDesc& shader_bind_desc, const D3D12_SHADER_INPUT_BIND_DESC& shader_input_desc);
         static std::vector<D3D12_DESCRIPTOR_RANGE> GenerateDescriptorRange(RangeBindPointDescArray& range_bind_array);
         static const char* SwitchSemanticName(const std::string& semantic_name);
         static D3D12_SAMPLER_DESC GetDefaultSamplerDesc(DefaultSamplerType default_sampler);
+        static ShaderVariableType GetShaderVariableType(const D3D12_SHADER_TYPE_DESC& type_desc);
 
+        bool GetDescriptorSlot(const std::string& res_name, uint32_t index, D3D12_DESCRIPTOR_RANGE_TYPE* range_type, uint32_t* slot);
         std::vector<D3D12_INPUT_ELEMENT_DESC> ParserVsInputParamters(const std::vector<D3D12_SIGNATURE_PARAMETER_DESC>& input_paramters);
+        void ParserConstantBuffers(ID3D12ShaderReflection* shader_reflect, const D3D12_SHADER_DESC& shader_desc);
         void InitializeBoundResource(ID3DBlob *const shader_arr[5]);
         void InitializeDescriptorHeap();
         void InitializeRootSignature();
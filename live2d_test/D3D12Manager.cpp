@@ -754,6 +754,21 @@ namespace D3D
         return desc;
     }
 
+    D3D12_BLEND_DESC D3D12Manager::TransparentBlendDesc(D3D12_BLEND src_blend, D3D12_BLEND dest_blend)
+    {
+        D3D12_BLEND_DESC desc = DefaultBlendDesc();
+        D3D12_RENDER_TARGET_BLEND_DESC& target = desc.RenderTarget[0];
+        target.BlendEnable = true;
+        target.SrcBlend = src_blend;
+        target.DestBlend = dest_blend;
+        target.BlendOp = D3D12_BLEND_OP_ADD;
+        target.SrcBlendAlpha = D3D12_BLEND_ONE;
+        target.DestBlendAlpha = D3D12_BLEND_INV_SRC_ALPHA;
+        target.BlendOpAlpha = D3D12_BLEND_OP_ADD;
+
+        return desc;
+    }
+
     D3D12_RENDER_TARGET_BLEND_DESC D3D12Manager::DefaultRenderTargetBlendDesc()
     {
         static D3D12_RENDER_TARGET_BLEND_DESC desc =
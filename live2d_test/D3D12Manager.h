@@ -103,6 +103,9 @@ namespace D3D
 
         static D3D12_RENDER_TARGET_BLEND_DESC DefaultRenderTargetBlendDesc();
 
+        // Blending on the first render target, alpha always accumulates as ONE, INV_SRC_ALPHA.
+        static D3D12_BLEND_DESC TransparentBlendDesc(D3D12_BLEND src_blend, D3D12_BLEND dest_blend);
+
         static D3D12_DEPTH_STENCIL_DESC DefaultDepthStencilDesc();
 
         static D3D12_DEPTH_STENCILOP_DESC DefaultDepthStencilopDesc();
@@ -1,11 +1,15 @@
 #include "D3D12Renderer.h"
 
+#include <cassert>
 #include <iostream>
 
 #include "DirectXTK/DescriptorHeap.h"
 #include "DirectXColors.h"
 #include "D3DUtil.h"
 #include "ImGuiProxy.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "TaskScheduler.h"
 #include <functional>
 
 
@@ -16,6 +20,86 @@ namespace D3D
 
     GeometryGenerator D3D12Renderer::GEO_GENERATOR_;
 
+    namespace
+    {
+        enum MeshId { kBoxMesh, kSphereMesh, kMeshCount };
+
+        const uint32_t DEFAULT_MATERIAL = 0;
+        const uint32_t MIN_INSTANCE_CAPACITY = 256;
+        const float MIN_LOD_SCALE = 1e-6f;
+
+        const float BOX_SIZE = 5.0f;
+        const uint32_t BOX_SUBDIVISION_COUNT = 0;
+        const float SPHERE_RADIUS = 2.5f;
+        const uint32_t SPHERE_SLICE_COUNT = 20;
+        const uint32_t SPHERE_STACK_COUNT = 20;
+        const uint32_t SPHERE_LOD_COUNT = 4;
+        const bool OPTIMIZE_OVERDRAW = true;
+
+        // The parameters above go into the content version by themselves, bump the revision when
+        // a change to the generator code alters the meshes.
+        const char MESH_CACHE_PATH[] = "scene_meshes.mesh";
+        const uint32_t MESH_GENERATOR_REVISION = 1;
+
+        const uint32_t FNV_OFFSET_BASIS = 2166136261u;
+        const uint32_t FNV_PRIME = 16777619u;
+
+        uint32_t HashBytes(uint32_t hash, const void* data, size_t size)
+        {
+            auto bytes = static_cast<const uint8_t*>(data);
+            for (size_t i = 0; i < size; i++)
+            {
+                hash ^= bytes[i];
+                hash *= FNV_PRIME;
+            }
+
+            return hash;
+        }
+
+        uint32_t GetMeshCacheContentVersion()
+        {
+            const uint32_t counts[] = { MESH_GENERATOR_REVISION, sizeof(GeometryGenerator::Vertex), kMeshCount,
+                BOX_SUBDIVISION_COUNT, SPHERE_SLICE_COUNT, SPHERE_STACK_COUNT, SPHERE_LOD_COUNT, OPTIMIZE_OVERDRAW ? 1u : 0u, MeshOptimizer::CACHE_SIZE };
+            const float sizes[] = { BOX_SIZE, SPHERE_RADIUS };
+
+            uint32_t hash = FNV_OFFSET_BASIS;
+            hash = HashBytes(hash, counts, sizeof(counts));
+            hash = HashBytes(hash, sizes, sizeof(sizes));
+            return hash;
+        }
+
+        // The renderer draws GeometryGenerator vertices as they are, one mesh per MeshId.
+        bool IsSceneMeshCache(const MeshCacheReader& cache, uint32_t content_version)
+        {
+            auto& header = cache.GetHeader();
+            if (header.content_version != content_version || header.stream_count != 1 ||
+                header.strides[0] != sizeof(GeometryGenerator::Vertex) || cache.GetSubmeshCount() == 0 || cache.GetSubmesh(0).lod_level != 0)
+            {
+                return false;
+            }
+
+            VertexFormatDesc format = cache.GetFormat();
+            VertexFormatDesc full = VertexFormatDesc::Full();
+            const VertexElementDesc* elements[] = { &format.position, &format.normal, &format.tangent, &format.texcoord };
+            const VertexElementDesc* full_elements[] = { &full.position, &full.normal, &full.tangent, &full.texcoord };
+            for (uint32_t e = 0; e < VertexFormatDesc::ELEMENT_COUNT; e++)
+            {
+                if (elements[e]->format != full_elements[e]->format || elements[e]->offset != full_elements[e]->offset)
+                {
+                    return false;
+                }
+            }
+
+            uint32_t mesh_count = 0;
+            for (uint32_t i = 0; i < cache.GetSubmeshCount(); i++)
+            {
+                mesh_count += cache.GetSubmesh(i).lod_level == 0 ? 1 : 0;
+            }
+
+            return mesh_count == kMeshCount;
+        }
+    }
+
     D3D12Renderer::D3D12Renderer(HWND hwnd) :
         window_handle_(hwnd),
         im_input_(hwnd)
@@ -109,13 +193,11 @@ namespace D3D
         camera_.SetLens(0.25f * XM_PI, AspectRatio(), 1.0f, 1000.0f);
         camera_.LookAt(XMFLOAT3{ 0.0f, 0.0f, -10.0f }, XMFLOAT3{ 0.0f, 0.0f, 0.0f }, XMFLOAT3{0.0f, 1.0f, 0.0f});
 
-        const_buffer_ = D3D12Manager::CreateBuffer(D3D12_HEAP_TYPE_UPLOAD, CalcConstantBufferByteSize(sizeof ObjectConstants));
-
-        model_.SetOriention({ 0.5f, 0.5f, 0.0f });
-
         timer_.Start();
 
+        InitConstantBuffer();
         InitVertexIndexBuffer();
+        InitInstances();
         InitImageResource();
         InitLight();
         InitResourceBinding();
@@ -138,34 +220,38 @@ namespace D3D
 
         im_input_.HandleInput();
 
+        auto xm_world_trans = XMMatrixTranslation(0.0f, 0.0f, 0.0f);
+        auto xm_world_scalar = XMMatrixScaling(1.0f, 1.0f, 1.0f);
+        auto world_mat = xm_world_trans * xm_world_scalar;
+
+        // Only the fields whose value changed are written into the mapped constant buffer.
+        XMFLOAT4X4 field_mat{};
+        XMStoreFloat4x4(&field_mat, world_mat);
+        object_cb_writer_.Write(object_cb_fields_.world_mat, field_mat);
+
         if (camera_.IsViewMatrixDirty())
         {
             camera_.UpdateViewMatrix();
 
-            auto xm_world_trans = XMMatrixTranslation(0.0f, 0.0f, 0.0f);
-            auto xm_world_scalar = XMMatrixScaling(1.0f, 1.0f, 1.0f);
-            auto world_mat = xm_world_trans * xm_world_scalar;
-
             auto view = camera_.GetView();
             auto proj = camera_.GetProj();
             auto view_proj = view * proj;
 
-            ObjectConstants obj_constants;
-            obj_constants.local_mat = model_.GetModelMatrix4x4();
+            XMStoreFloat4x4(&field_mat, XMMatrixTranspose(view));
+            object_cb_writer_.Write(object_cb_fields_.view_mat, field_mat);
 
-            XMStoreFloat4x4(&obj_constants.world_mat, world_mat);
-            XMStoreFloat4x4(&obj_constants.model_mat, XMMatrixTranspose(model_.GetModelMatrix() * world_mat));
-            XMStoreFloat4x4(&obj_constants.view_mat, XMMatrixTranspose(view));
-            XMStoreFloat4x4(&obj_constants.proj_mat, XMMatrixTranspose(proj));
-            XMStoreFloat4x4(&obj_constants.view_proj_mat, XMMatrixTranspose(view_proj));
-            XMStoreFloat4x4(&obj_constants.texture_transform, XMMatrixScaling(1.0f, 1.0f, 1.0f));
+            XMStoreFloat4x4(&field_mat, XMMatrixTranspose(proj));
+            object_cb_writer_.Write(object_cb_fields_.proj_mat, field_mat);
 
-            void* map_data{};
-            const_buffer_->Map(0, nullptr, &map_data);
-            ::memcpy(map_data, &obj_constants, sizeof(ObjectConstants));
-            const_buffer_->Unmap(0, nullptr);
+            XMStoreFloat4x4(&field_mat, XMMatrixTranspose(view_proj));
+            object_cb_writer_.Write(object_cb_fields_.view_proj_mat, field_mat);
         }
 
+        // Culls against the camera, so it runs once the view matrix is current.
+        UpdateInstances(world_mat);
+
+        UpdateLight();
+
         skybox_pass_.Update(camera_);
     }
 
@@ -174,6 +260,9 @@ namespace D3D
         ThrowIfFailed(command_list_alloc_->Reset());
         ThrowIfFailed(command_list_->Reset(command_list_alloc_.Get(), pipe_line_state_.Get()));
 
+        // This frame is fenced with the next value signaled by FlushCommandQueue.
+        bound_resource_manager_.CommitDescriptorTable(fence_value_ + 1, fence_->GetCompletedValue());
+
         int back_index = GetCurrentRenderTargetIndex();
         auto cur_back_buffer = back_target_buffer_[back_index];
         auto cur_back_buffer_view = DescriptorHeap(rtv_heap_.Get()).GetCpuHandle(back_index);
@@ -193,7 +282,9 @@ namespace D3D
         command_list_->ClearRenderTargetView(cur_back_buffer_view, Colors::LightSteelBlue, 0, nullptr);
         command_list_->ClearDepthStencilView(cur_depth_stencil_view, D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
 
+        // One interleaved vertex stream, instances in the slot the input layout put them in.
         command_list_->IASetVertexBuffers(0, 1, &vertex_buffer_view_);
+        command_list_->IASetVertexBuffers(bound_resource_manager_.GetInstanceSlot(), 1, &instance_buffer_view_);
         command_list_->IASetIndexBuffer(&index_buffer_view_);
         command_list_->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
@@ -205,12 +296,17 @@ namespace D3D
             bound_resource_manager_.GetSampleDescriptorHeap()
         };
         command_list_->SetDescriptorHeaps(_countof(heap), heap);
-        command_list_->SetGraphicsRootDescriptorTable(0, bound_resource_manager_.GetSrvUavCbvDescriptorHeap()->GetGPUDescriptorHandleForHeapStart());
+        command_list_->SetGraphicsRootDescriptorTable(0, bound_resource_manager_.GetSrvUavCbvTableGpuHandle());
         command_list_->SetGraphicsRootDescriptorTable(1, bound_resource_manager_.GetSampleDescriptorHeap()->GetGPUDescriptorHandleForHeapStart());
 
         command_list_->OMSetRenderTargets(1, &cur_back_buffer_view, true, &cur_depth_stencil_view);
 
-        command_list_->DrawIndexedInstanced(mesh_data_.Indices16.size(), 1, 0, 0, 0);
+        // Instances are batched by level of detail, batch.mesh_id indexes lod_ranges_.
+        for (auto& batch : instance_batcher_.GetBatches())
+        {
+            auto& lod = lod_ranges_[batch.mesh_id];
+            command_list_->DrawIndexedInstanced(lod.index_count, batch.instance_count, lod.start_index, lod.base_vertex, batch.first_instance);
+        }
 
         skybox_pass_.PopulateCommandList(command_list_.Get());
 
@@ -262,30 +358,261 @@ namespace D3D
 
     void D3D12Renderer::InitVertexIndexBuffer()
     {
-        mesh_data_ = GEO_GENERATOR_.CreateBox(5.0f, 5.0f, 5.0f, 0);
+        // Meshes come from the cache file while it matches the content version. Otherwise they
+        // are generated, written out for the next start and read back from memory, so both
+        // cases upload through the same path.
+        uint32_t content_version = GetMeshCacheContentVersion();
+        MeshCacheReader mesh_cache;
+        std::vector<uint8_t> mesh_cache_image;
+        if (!mesh_cache.Open(MESH_CACHE_PATH, true) || !IsSceneMeshCache(mesh_cache, content_version))
+        {
+            // A stale cache may still be mapped, which keeps Write from replacing it.
+            mesh_cache.Close();
+
+            // The box has nothing to drop and keeps a single level, mesh order is MeshId. Every
+            // level is reordered for the vertex cache once here, so loading the cache costs nothing.
+            MeshOptimizer mesh_optimizer;
+            auto box = GEO_GENERATOR_.CreateBox(BOX_SIZE, BOX_SIZE, BOX_SIZE, BOX_SUBDIVISION_COUNT);
+            mesh_optimizer.Optimize(box, OPTIMIZE_OVERDRAW);
+
+            auto sphere_lods = GeneratorLods::CreateSphere(GEO_GENERATOR_, SPHERE_RADIUS, SPHERE_SLICE_COUNT, SPHERE_STACK_COUNT, SPHERE_LOD_COUNT);
+            for (auto& lod : sphere_lods)
+            {
+                mesh_optimizer.Optimize(lod.mesh, OPTIMIZE_OVERDRAW);
+            }
+
+            MeshCacheWriter writer;
+            writer.AddMesh(box);
+            writer.AddLodChain(sphere_lods);
 
-        uint32_t vertices_size = mesh_data_.Vertices.size() * sizeof(GeometryGenerator::Vertex);
-        uint32_t indices_size = mesh_data_.Indices16.size() * sizeof(uint16_t);
-        uint64_t upload_buffer_length = (std::max)(vertices_size, indices_size) * 1.5;
+            if (!writer.Write(MESH_CACHE_PATH, content_version))
+            {
+                std::string error = std::string("cannot write mesh cache ") + MESH_CACHE_PATH + "\n";
+                ::OutputDebugStringA(error.c_str());
+            }
+
+            writer.Serialize(content_version, mesh_cache_image);
+            ThrowIfFalse(mesh_cache.Open(mesh_cache_image.data(), mesh_cache_image.size()) && IsSceneMeshCache(mesh_cache, content_version));
+        }
+
+        // All meshes share one vertex and one index buffer, every level of detail is a range of
+        // its own.
+        for (uint32_t i = 0; i < mesh_cache.GetSubmeshCount(); i++)
+        {
+            auto& submesh = mesh_cache.GetSubmesh(i);
+            if (submesh.lod_level == 0)
+            {
+                MeshRange mesh;
+                mesh.first_lod = static_cast<uint32_t>(lod_ranges_.size());
+                mesh.bounding_radius = submesh.bounding_radius;
+                meshes_.push_back(mesh);
+            }
+
+            meshes_.back().lod_count++;
+
+            LodRange range;
+            range.index_count = submesh.index_count;
+            range.start_index = submesh.start_index;
+            range.base_vertex = static_cast<int32_t>(submesh.base_vertex);
+            lod_ranges_.push_back(range);
+            lod_errors_.push_back(submesh.lod_error);
+        }
+
+        // The copy queue reads straight from the mapped file, so the cache stays open until the
+        // uploads are done.
+        bool use_32bit_indices = mesh_cache.GetHeader().index_size == sizeof(uint32_t);
+        uint32_t vertices_size = static_cast<uint32_t>(mesh_cache.GetSectionSize(kMeshCacheVertexStream0));
+        uint32_t indices_size = static_cast<uint32_t>(mesh_cache.GetSectionSize(kMeshCacheIndices));
 
         vertex_buffer_ = D3D12Manager::CreateBuffer(D3D12_HEAP_TYPE_DEFAULT, vertices_size);
         index_buffer_ = D3D12Manager::CreateBuffer(D3D12_HEAP_TYPE_DEFAULT, indices_size);
 
-        D3D12Manager::PostUploadBufferTask(vertex_buffer_.Get(), 0, mesh_data_.Vertices.data(), vertices_size);
+        D3D12Manager::PostUploadBufferTask(vertex_buffer_.Get(), 0, const_cast<void*>(mesh_cache.GetSection(kMeshCacheVertexStream0)), vertices_size);
 
         vertex_buffer_view_.BufferLocation = vertex_buffer_->GetGPUVirtualAddress();
         vertex_buffer_view_.SizeInBytes = vertices_size;
         vertex_buffer_view_.StrideInBytes = sizeof(GeometryGenerator::Vertex);
 
-        auto last_copy_id = D3D12Manager::PostUploadBufferTask(index_buffer_.Get(), 0, mesh_data_.Indices16.data(), indices_size);
+        auto last_copy_id = D3D12Manager::PostUploadBufferTask(index_buffer_.Get(), 0, const_cast<void*>(mesh_cache.GetSection(kMeshCacheIndices)), indices_size);
 
         index_buffer_view_.BufferLocation = index_buffer_->GetGPUVirtualAddress();
-        index_buffer_view_.Format = DXGI_FORMAT_R16_UINT;
+        index_buffer_view_.Format = use_32bit_indices ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT;
         index_buffer_view_.SizeInBytes = indices_size;
 
         D3D12Manager::WaitCopyTask(last_copy_id);
     }
 
+    void D3D12Renderer::InitInstances()
+    {
+        Model model;
+        model.SetRotationRollPitchYaw({ 0.7071f, 0.7071f, 0.0f });
+        AddInstance(kBoxMesh, DEFAULT_MATERIAL, model);
+
+        // A field of small props under the main box.
+        const int32_t PROP_GRID_SIZE = 16;
+        const float PROP_SPACING = 3.0f;
+        for (int32_t z = 0; z < PROP_GRID_SIZE; z++)
+        {
+            for (int32_t x = 0; x < PROP_GRID_SIZE; x++)
+            {
+                Model prop;
+                prop.SetScale({ 0.2f, 0.2f, 0.2f });
+                prop.SetLocation({ (x - PROP_GRID_SIZE / 2) * PROP_SPACING, -6.0f, (z - PROP_GRID_SIZE / 2) * PROP_SPACING });
+                AddInstance((x + z) % 2 == 0 ? kBoxMesh : kSphereMesh, DEFAULT_MATERIAL, prop);
+            }
+        }
+    }
+
+    uint32_t D3D12Renderer::AddInstance(uint32_t mesh_id, uint32_t material_id, const Model& model)
+    {
+        assert(mesh_id < meshes_.size());
+
+        models_.push_back(model);
+        model_mesh_ids_.push_back(mesh_id);
+        model_material_ids_.push_back(material_id);
+        model_lods_.push_back(0);
+
+        return static_cast<uint32_t>(models_.size() - 1);
+    }
+
+    void D3D12Renderer::UpdateInstances(const XMMATRIX& world_mat)
+    {
+        const uint32_t INSTANCE_GRAIN_SIZE = 256;
+
+        uint32_t instance_count = static_cast<uint32_t>(models_.size());
+        instance_matrices_.resize(instance_count);
+        instance_bound_x_.resize(instance_count);
+        instance_bound_y_.resize(instance_count);
+        instance_bound_z_.resize(instance_count);
+        instance_bound_radius_.resize(instance_count);
+        visible_instances_.resize(instance_count);
+
+        Model::UpdateModelMatrices(models_.data(), instance_count);
+
+        lod_selector_.SetProjection(camera_.GetFovY(), static_cast<float>(client_height_));
+        XMFLOAT3 camera_pos = camera_.GetPosition3f();
+
+        // Final matrices plus a bounding sphere per instance: the mesh sphere moved by the translation
+        // row and scaled by the longest axis. The level of detail is picked from the distance to that
+        // sphere, brought back into mesh units by the same scale.
+        auto& scheduler = TaskScheduler::GetScheduler();
+        scheduler.ParallelFor(instance_count, INSTANCE_GRAIN_SIZE, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t i = begin; i < end; i++)
+            {
+                XMMATRIX instance_mat = models_[i].GetModelMatrix() * world_mat;
+                XMStoreFloat4x4(&instance_matrices_[i], instance_mat);
+
+                float max_scale_sq = (std::max)((std::max)(
+                    XMVectorGetX(XMVector3LengthSq(instance_mat.r[0])),
+                    XMVectorGetX(XMVector3LengthSq(instance_mat.r[1]))),
+                    XMVectorGetX(XMVector3LengthSq(instance_mat.r[2])));
+
+                auto& matrix = instance_matrices_[i];
+                instance_bound_x_[i] = matrix._41;
+                instance_bound_y_[i] = matrix._42;
+                instance_bound_z_[i] = matrix._43;
+                auto& mesh = meshes_[model_mesh_ids_[i]];
+                float scale = sqrtf(max_scale_sq);
+                instance_bound_radius_[i] = mesh.bounding_radius * scale;
+
+                float dx = matrix._41 - camera_pos.x;
+                float dy = matrix._42 - camera_pos.y;
+                float dz = matrix._43 - camera_pos.z;
+                float distance = (sqrtf(dx * dx + dy * dy + dz * dz) - instance_bound_radius_[i]) / (std::max)(scale, MIN_LOD_SCALE);
+                model_lods_[i] = lod_selector_.Select(&lod_errors_[mesh.first_lod], mesh.lod_count, distance, model_lods_[i]);
+            }
+        });
+
+        XMFLOAT4X4 view_proj{};
+        XMStoreFloat4x4(&view_proj, camera_.GetView() * camera_.GetProj());
+        auto frustum = Frustum::FromViewProj(&view_proj._11);
+        visible_instance_count_ = frustum_culler_.CullSpheres(frustum, instance_bound_x_.data(), instance_bound_y_.data(), instance_bound_z_.data(),
+            instance_bound_radius_.data(), instance_count, visible_instances_.data(), &scheduler);
+
+        // Batches follow the visible set, so they are rebuilt every frame.
+        instance_batcher_.Clear();
+        instance_batcher_.Reserve(visible_instance_count_);
+        for (uint32_t v = 0; v < visible_instance_count_; v++)
+        {
+            uint32_t i = visible_instances_[v];
+            instance_batcher_.AddInstance(meshes_[model_mesh_ids_[i]].first_lod + model_lods_[i], model_material_ids_[i], i);
+        }
+
+        instance_batcher_.Build();
+
+        // The GPU is idle between frames, so the instance buffer is rewritten in place and only recreated to grow.
+        if (instance_buffer_ == nullptr || visible_instance_count_ > instance_capacity_)
+        {
+            instance_capacity_ = (std::max)(instance_capacity_, MIN_INSTANCE_CAPACITY);
+            while (instance_capacity_ < visible_instance_count_)
+            {
+                instance_capacity_ *= 2;
+            }
+
+            instance_buffer_ = D3D12Manager::CreateBuffer(D3D12_HEAP_TYPE_UPLOAD, sizeof(XMFLOAT4X4) * instance_capacity_);
+            ThrowIfFailed(instance_buffer_->Map(0, nullptr, reinterpret_cast<void**>(&instance_map_data_)));
+
+            instance_buffer_view_.BufferLocation = instance_buffer_->GetGPUVirtualAddress();
+            instance_buffer_view_.SizeInBytes = sizeof(XMFLOAT4X4) * instance_capacity_;
+            instance_buffer_view_.StrideInBytes = sizeof(XMFLOAT4X4);
+        }
+
+        // Instances are written in batch order, so every batch is one contiguous range of the buffer.
+        auto& instance_order = instance_batcher_.GetInstanceOrder();
+        scheduler.ParallelFor(visible_instance_count_, INSTANCE_GRAIN_SIZE, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t i = begin; i < end; i++)
+            {
+                instance_map_data_[i] = instance_matrices_[instance_order[i]];
+            }
+        });
+    }
+
+    void D3D12Renderer::InitConstantBuffer()
+    {
+        auto layout = bound_resource_manager_.GetConstantBufferLayout("VS_MatrixBuffer");
+        ThrowIfFalse(layout != nullptr);
+
+        const CppFieldDesc cpp_fields[] =
+        {
+            CBUFFER_CPP_FIELD(ObjectConstants, local_mat, "LOCAL_MAT"),
+            CBUFFER_CPP_FIELD(ObjectConstants, world_mat, "WORLD_MAT"),
+            CBUFFER_CPP_FIELD(ObjectConstants, model_mat, "MODEL_MAT"),
+            CBUFFER_CPP_FIELD(ObjectConstants, view_mat, "VIEW_MAT"),
+            CBUFFER_CPP_FIELD(ObjectConstants, proj_mat, "PROJ_MAT"),
+            CBUFFER_CPP_FIELD(ObjectConstants, view_proj_mat, "VIEW_PROJ_MAT"),
+            CBUFFER_CPP_FIELD(ObjectConstants, texture_transform, "TEX_TRANSFORM"),
+        };
+
+        std::string layout_error;
+        if (!layout->Validate(cpp_fields, _countof(cpp_fields), sizeof(ObjectConstants), &layout_error))
+        {
+            ::OutputDebugStringA(layout_error.c_str());
+            ThrowIfFalse(0);
+        }
+
+        auto buffer_size = CalcConstantBufferByteSize(layout->GetSize());
+        const_buffer_ = D3D12Manager::CreateBuffer(D3D12_HEAP_TYPE_UPLOAD, buffer_size);
+
+        // Upload heap buffers may stay mapped for their whole lifetime.
+        uint8_t* map_data{};
+        ThrowIfFailed(const_buffer_->Map(0, nullptr, reinterpret_cast<void**>(&map_data)));
+        object_cb_writer_.Initialize(*layout, map_data, buffer_size);
+
+        object_cb_fields_.local_mat = object_cb_writer_.GetField<XMFLOAT4X4>("LOCAL_MAT");
+        object_cb_fields_.world_mat = object_cb_writer_.GetField<XMFLOAT4X4>("WORLD_MAT");
+        object_cb_fields_.model_mat = object_cb_writer_.GetField<XMFLOAT4X4>("MODEL_MAT");
+        object_cb_fields_.view_mat = object_cb_writer_.GetField<XMFLOAT4X4>("VIEW_MAT");
+        object_cb_fields_.proj_mat = object_cb_writer_.GetField<XMFLOAT4X4>("PROJ_MAT");
+        object_cb_fields_.view_proj_mat = object_cb_writer_.GetField<XMFLOAT4X4>("VIEW_PROJ_MAT");
+        object_cb_fields_.texture_transform = object_cb_writer_.GetField<XMFLOAT4X4>("TEX_TRANSFORM");
+
+        XMFLOAT4X4 tex_transform{};
+        XMStoreFloat4x4(&tex_transform, XMMatrixScaling(1.0f, 1.0f, 1.0f));
+        object_cb_writer_.Write(object_cb_fields_.texture_transform, tex_transform);
+    }
+
     void D3D12Renderer::InitImageResource()
     {
         image_resource_ = WICImage::LoadImageFormFile(L"./test.jpeg");
@@ -325,14 +652,59 @@ namespace D3D
 
     void D3D12Renderer::InitLight()
     {
-        auto buffer_size = CalcConstantBufferByteSize(sizeof(LightConstBuffer));
+        auto layout = bound_resource_manager_.GetConstantBufferLayout("LightConstBuffer");
+        ThrowIfFalse(layout != nullptr);
+
+        const CppFieldDesc cpp_fields[] =
+        {
+            CBUFFER_CPP_FIELD(LightConstBuffer, directional_light_num, "DIRECTIONAL_LIGHT_NUM"),
+            CBUFFER_CPP_FIELD(LightConstBuffer, point_light_num, "POINT_LIGHT_NUM"),
+            CBUFFER_CPP_FIELD(LightConstBuffer, cluster_tile_size, "CLUSTER_TILE_SIZE"),
+            CBUFFER_CPP_FIELD(LightConstBuffer, cluster_dim, "CLUSTER_DIM"),
+            CBUFFER_CPP_FIELD(LightConstBuffer, cluster_z_scale, "CLUSTER_Z_SCALE"),
+            CBUFFER_CPP_FIELD(LightConstBuffer, cluster_z_bias, "CLUSTER_Z_BIAS"),
+        };
+
+        std::string layout_error;
+        if (!layout->Validate(cpp_fields, _countof(cpp_fields), sizeof(LightConstBuffer), &layout_error))
+        {
+            ::OutputDebugStringA(layout_error.c_str());
+            ThrowIfFalse(0);
+        }
+
+        auto buffer_size = CalcConstantBufferByteSize(layout->GetSize());
         const_light_gpu_buffer_ = D3D12Manager::CreateBuffer(D3D12_HEAP_TYPE_UPLOAD, buffer_size);
 
-        LightConstBuffer* light_const_ptr{};
-        const_light_gpu_buffer_->Map(0, nullptr, reinterpret_cast<void**>(&light_const_ptr));
-        light_const_ptr->directional_light_num = 1;
-        light_const_ptr->point_light_num = 0;
-        const_light_gpu_buffer_->Unmap(0, nullptr);
+        uint8_t* light_map_data{};
+        ThrowIfFailed(const_light_gpu_buffer_->Map(0, nullptr, reinterpret_cast<void**>(&light_map_data)));
+        light_cb_writer_.Initialize(*layout, light_map_data, buffer_size);
+
+        light_cb_fields_.directional_light_num = light_cb_writer_.GetField<uint32_t>("DIRECTIONAL_LIGHT_NUM");
+        light_cb_fields_.point_light_num = light_cb_writer_.GetField<uint32_t>("POINT_LIGHT_NUM");
+        light_cb_fields_.cluster_tile_size = light_cb_writer_.GetField<XMUINT2>("CLUSTER_TILE_SIZE");
+        light_cb_fields_.cluster_dim = light_cb_writer_.GetField<XMUINT3>("CLUSTER_DIM");
+        light_cb_fields_.cluster_z_scale = light_cb_writer_.GetField<float>("CLUSTER_Z_SCALE");
+        light_cb_fields_.cluster_z_bias = light_cb_writer_.GetField<float>("CLUSTER_Z_BIAS");
+
+        light_cb_writer_.Write(light_cb_fields_.directional_light_num, 1u);
+        light_cb_writer_.Write(light_cb_fields_.point_light_num, 0u);
+
+        light_manager_.Initialize();
+
+        // A ring of coloured point lights around the box.
+        const uint32_t POINT_LIGHT_COUNT = 8;
+        for (uint32_t i = 0; i < POINT_LIGHT_COUNT; i++)
+        {
+            float angle = XM_2PI * i / POINT_LIGHT_COUNT;
+
+            PointLight point_light;
+            point_light.position = { 6.0f * cosf(angle), 2.0f, 6.0f * sinf(angle) };
+            point_light.color = { 0.5f + 0.5f * cosf(angle), 0.5f + 0.5f * sinf(angle), 0.5f };
+            point_light.k_const = 1.0f;
+            point_light.k_linear = 0.35f;
+            point_light.quadratic = 0.44f;
+            light_manager_.AddPointLight(point_light);
+        }
 
         directional_light_gpu_buffer_ = D3D12Manager::CreateBuffer(D3D12_HEAP_TYPE_UPLOAD, sizeof DirectionalLight);
 
@@ -343,6 +715,22 @@ namespace D3D
         map_ptr->color = { 1.0f, 0.0f, 0.0f };
     }
 
+    void D3D12Renderer::UpdateLight()
+    {
+        if (light_manager_.Update(camera_, client_width_, client_height_))
+        {
+            light_manager_.BindResource(bound_resource_manager_);
+        }
+
+        auto& cluster_builder = light_manager_.GetClusterBuilder();
+        auto& cluster_config = cluster_builder.GetConfig();
+        light_cb_writer_.Write(light_cb_fields_.point_light_num, light_manager_.GetPointLightCount());
+        light_cb_writer_.Write(light_cb_fields_.cluster_tile_size, XMUINT2{ cluster_builder.GetTileSizeX(), cluster_builder.GetTileSizeY() });
+        light_cb_writer_.Write(light_cb_fields_.cluster_dim, XMUINT3{ cluster_config.tile_count_x, cluster_config.tile_count_y, cluster_config.slice_count });
+        light_cb_writer_.Write(light_cb_fields_.cluster_z_scale, cluster_builder.GetSliceScale());
+        light_cb_writer_.Write(light_cb_fields_.cluster_z_bias, cluster_builder.GetSliceBias());
+    }
+
     void D3D12Renderer::InitResourceBinding()
     {
         D3D12_SHADER_RESOURCE_VIEW_DESC dir_light_desc{};
@@ -353,7 +741,7 @@ namespace D3D
         dir_light_desc.Buffer.NumElements = 1;
         dir_light_desc.Buffer.StructureByteStride = sizeof(DirectionalLight);
         dir_light_desc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
-        D3D12Manager::GetDevice()->CreateShaderResourceView(directional_light_gpu_buffer_.Get(), &dir_light_desc, bound_resource_manager_.GetDescriptorHandle("DIRECTIONAL_LIGHT_BUFFER", 0));
+        bound_resource_manager_.BindShaderResourceView("DIRECTIONAL_LIGHT_BUFFER", 0, directional_light_gpu_buffer_.Get(), dir_light_desc);
         //D3D12Manager::GetDevice()->CreateShaderResourceView(directional_light_gpu_buffer_.Get(), &dir_light_desc, dx_cbv_heap.GetCpuHandle(0));
 
         D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc{};
@@ -364,19 +752,21 @@ namespace D3D
         srv_desc.Texture2D.MipLevels = texture_->GetDesc().MipLevels;
         srv_desc.Texture2D.PlaneSlice = 0;
         srv_desc.Texture2D.ResourceMinLODClamp = 0.0f;
-        D3D12Manager::GetDevice()->CreateShaderResourceView(texture_.Get(), &srv_desc, bound_resource_manager_.GetDescriptorHandle("TEXTURE", 0));
+        bound_resource_manager_.BindShaderResourceView("TEXTURE", 0, texture_.Get(), srv_desc);
+
+        light_manager_.BindResource(bound_resource_manager_);
         //D3D12Manager::GetDevice()->CreateShaderResourceView(texture_.Get(), &srv_desc, dx_cbv_heap.GetCpuHandle(2));
 
         D3D12_CONSTANT_BUFFER_VIEW_DESC const_buff_view{};
         const_buff_view.BufferLocation = const_buffer_->GetGPUVirtualAddress();
-        const_buff_view.SizeInBytes = CalcConstantBufferByteSize(sizeof ObjectConstants);
+        const_buff_view.SizeInBytes = CalcConstantBufferByteSize(object_cb_writer_.GetLayout().GetSize());
 
-        D3D12Manager::GetDevice()->CreateConstantBufferView(&const_buff_view, bound_resource_manager_.GetDescriptorHandle("VS_MatrixBuffer", 0));
+        bound_resource_manager_.BindConstantBufferView("VS_MatrixBuffer", 0, const_buff_view);
         //D3D12Manager::GetDevice()->CreateConstantBufferView(&const_buff_view, dx_cbv_heap.GetCpuHandle(3));
 
         const_buff_view.BufferLocation = const_light_gpu_buffer_->GetGPUVirtualAddress();
-        const_buff_view.SizeInBytes = CalcConstantBufferByteSize(sizeof LightConstBuffer);
-        D3D12Manager::GetDevice()->CreateConstantBufferView(&const_buff_view, bound_resource_manager_.GetDescriptorHandle("LightConstBuffer", 0));
+        const_buff_view.SizeInBytes = CalcConstantBufferByteSize(light_cb_writer_.GetLayout().GetSize());
+        bound_resource_manager_.BindConstantBufferView("LightConstBuffer", 0, const_buff_view);
         //D3D12Manager::GetDevice()->CreateConstantBufferView(&const_buff_view, dx_cbv_heap.GetCpuHandle(4));
 
         bound_resource_manager_.BindDefaultSampler("SAMPLER", 0, D3D12BoundResourceManager::kLinearWrap);
@@ -418,6 +808,16 @@ namespace D3D
         ImGui::Spacing();
 
         ImGui::InputFloat("Camera Speed", &camera_move_speed_, 0.1f, 1.0f, "%.1f");
+        ImGui::Spacing();
+
+        float lod_pixel_error = lod_selector_.GetPixelError();
+        if (ImGui::SliderFloat("LOD Pixel Error", &lod_pixel_error, 0.25f, 16.0f, "%.2f"))
+        {
+            lod_selector_.SetThreshold(lod_pixel_error);
+        }
+        ImGui::Spacing();
+
+        ImGui::Text("Visible Instances: %u / %u, Draws: %u", visible_instance_count_, static_cast<uint32_t>(models_.size()), static_cast<uint32_t>(instance_batcher_.GetBatches().size()));
 
         ImGui::End();
 
@@ -9,9 +9,14 @@
 #include "WICImage.h"
 #include "GeometryGenerator.h"
 #include "DirectionalLight.h"
+#include "LightManager.h"
+#include "InstanceBatcher.h"
+#include "FrustumCulling.h"
+#include "MeshLod.h"
 #include "Model.h"
 #include "GameTimer.h"
 #include "D3D12BoundResourceManager.h"
+#include "ConstantBufferLayout.h"
 
 #include "ImmediateInput.h"
 #include "SkyBoxPass.h"
@@ -52,14 +57,59 @@ namespace D3D
         {
             uint32_t directional_light_num;
             uint32_t point_light_num;
+            DirectX::XMUINT2 cluster_tile_size;
+            DirectX::XMUINT3 cluster_dim;
+            float cluster_z_scale;
+            float cluster_z_bias;
         };
 #pragma pack(pop)
 
+        struct ObjectConstantFields
+        {
+            ConstantFieldHandle<DirectX::XMFLOAT4X4> local_mat;
+            ConstantFieldHandle<DirectX::XMFLOAT4X4> world_mat;
+            ConstantFieldHandle<DirectX::XMFLOAT4X4> model_mat;
+            ConstantFieldHandle<DirectX::XMFLOAT4X4> view_mat;
+            ConstantFieldHandle<DirectX::XMFLOAT4X4> proj_mat;
+            ConstantFieldHandle<DirectX::XMFLOAT4X4> view_proj_mat;
+            ConstantFieldHandle<DirectX::XMFLOAT4X4> texture_transform;
+        };
+
+        struct LightConstantFields
+        {
+            ConstantFieldHandle<uint32_t> directional_light_num;
+            ConstantFieldHandle<uint32_t> point_light_num;
+            ConstantFieldHandle<DirectX::XMUINT2> cluster_tile_size;
+            ConstantFieldHandle<DirectX::XMUINT3> cluster_dim;
+            ConstantFieldHandle<float> cluster_z_scale;
+            ConstantFieldHandle<float> cluster_z_bias;
+        };
+
+        // One level of detail in the shared vertex and index buffers.
+        struct LodRange
+        {
+            uint32_t index_count = 0;
+            uint32_t start_index = 0;
+            int32_t base_vertex = 0;
+        };
+
+        struct MeshRange
+        {
+            uint32_t first_lod = 0;             // into lod_ranges_ and lod_errors_
+            uint32_t lod_count = 0;
+            float bounding_radius = 0.0f;       // around the mesh origin, of level 0
+        };
+
         int GetCurrentRenderTargetIndex();
         void FlushCommandQueue();
         void InitVertexIndexBuffer();
+        void InitConstantBuffer();
         void InitImageResource();
         void InitLight();
+        void UpdateLight();
+        void InitInstances();
+        uint32_t AddInstance(uint32_t mesh_id, uint32_t material_id, const Model& model);
+        void UpdateInstances(const DirectX::XMMATRIX& world_mat);
         void InitResourceBinding();
         void DrawDebugWindow(ID3D12GraphicsCommandList *cmd);
 
@@ -92,15 +142,40 @@ namespace D3D
         D3D12_INDEX_BUFFER_VIEW                             index_buffer_view_{};
         Microsoft::WRL::ComPtr<ID3D12Resource>              index_buffer_;
         Microsoft::WRL::ComPtr<ID3D12Resource>              const_buffer_;
+        ConstantBufferWriter                                object_cb_writer_;
+        ObjectConstantFields                                object_cb_fields_;
 
-        LightConstBuffer                                    const_light_buffer_;
         Microsoft::WRL::ComPtr<ID3D12Resource>              const_light_gpu_buffer_;
+        ConstantBufferWriter                                light_cb_writer_;
+        LightConstantFields                                 light_cb_fields_;
 
         DirectionalLight                                    dir_light_;
         Microsoft::WRL::ComPtr<ID3D12Resource>              directional_light_gpu_buffer_;
+        LightManager                                        light_manager_;
 
         static GeometryGenerator                            GEO_GENERATOR_;
-        GeometryGenerator::MeshData                         mesh_data_;
+        std::vector<MeshRange>                              meshes_;
+        std::vector<LodRange>                               lod_ranges_;
+        std::vector<float>                                  lod_errors_;
+        LodSelector                                         lod_selector_;
+
+        std::vector<Model>                                  models_;
+        std::vector<uint32_t>                               model_mesh_ids_;
+        std::vector<uint32_t>                               model_material_ids_;
+        std::vector<uint32_t>                               model_lods_;        // last selected level
+        InstanceBatcher                                     instance_batcher_;
+        FrustumCuller                                       frustum_culler_;
+        std::vector<DirectX::XMFLOAT4X4>                    instance_matrices_;
+        std::vector<float>                                  instance_bound_x_;
+        std::vector<float>                                  instance_bound_y_;
+        std::vector<float>                                  instance_bound_z_;
+        std::vector<float>                                  instance_bound_radius_;
+        std::vector<uint32_t>                               visible_instances_;
+        uint32_t                                            visible_instance_count_ = 0;
+        Microsoft::WRL::ComPtr<ID3D12Resource>              instance_buffer_;
+        DirectX::XMFLOAT4X4*                                instance_map_data_ = nullptr;
+        uint32_t                                            instance_capacity_ = 0;
+        D3D12_VERTEX_BUFFER_VIEW                            instance_buffer_view_{};
 
         Microsoft::WRL::ComPtr<ID3DBlob>                    vs_shader_;
         Microsoft::WRL::ComPtr<ID3DBlob>                    ps_shader_;
@@ -111,7 +186,6 @@ namespace D3D
         Camera                                              camera_;
         float                                               camera_move_speed_ = 10.0f;
         Microsoft::WRL::ComPtr<IWICBitmapSource>            image_resource_;
-        Model                                               model_;
         GameTimer                                           timer_;
         float                                               tick_ = 0.0f;
 
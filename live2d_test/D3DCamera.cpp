@@ -1,5 +1,7 @@
 #include "D3DCamera.h"
 
+#include <cassert>
+
 using namespace DirectX;
 
 Camera::Camera()
@@ -1,6 +1,6 @@
 #pragma once
 
-#include "DirectXMath.h"
+#include "PortableMath.h"
 #include "MathHelper.h"
 
 class Camera
@@ -10,8 +10,8 @@
 
 namespace D3D
 {
-    #define STRUCT_ALIGN_16	__declspec(align(16))
-    #define STRUCT_ALIGN(v)	__declspec(align(v))
+    #define STRUCT_ALIGN_16	alignas(16)
+    #define STRUCT_ALIGN(v)	alignas(v)
 
     uint32_t GetDxgiFormatTypeLength(DXGI_FORMAT format);
 
@@ -0,0 +1,153 @@
+#include "Live2DModel.h"
+
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "TaskScheduler.h"
+#include "TestHarness.h"
+
+using namespace D3D;
+
+namespace
+{
+    const uint32_t MODEL_COUNT = 100;
+    const uint32_t MESHES_PER_MODEL = 50;
+
+    float Random(uint32_t& seed)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / 16777216.0f;
+    }
+
+    // A body warp, a head rotation inside it and art meshes of 16 to 256 vertices spread over
+    // both, each bound to one of eight expression parameters with three keys.
+    void BuildModel(Live2DModel& model, uint32_t& seed)
+    {
+        for (uint32_t p = 0; p < 10; p++)
+        {
+            model.AddParameter(-1.0f, 1.0f, 0.0f);
+        }
+
+        WarpDeformerDesc warp;
+        warp.rows = 3;
+        warp.columns = 3;
+        KeyformAxis axis;
+        axis.parameter = 0;
+        axis.keys = { -1.0f, 1.0f };
+        warp.binding.axes.push_back(axis);
+        for (uint32_t keyform = 0; keyform < 2; keyform++)
+        {
+            for (uint32_t point = 0; point < 16; point++)
+            {
+                warp.points.push_back((point % 4) / 3.0f + 0.05f * Random(seed));
+                warp.points.push_back((point / 4) / 3.0f + 0.05f * Random(seed));
+            }
+        }
+
+        warp.opacities = { 1.0f, 1.0f };
+        uint32_t body = model.AddWarpDeformer(warp);
+
+        RotationDeformerDesc rotation;
+        rotation.parent = body;
+        axis.parameter = 1;
+        rotation.binding.axes.push_back(axis);
+        RotationKeyform keyform;
+        keyform.origin_x = 0.5f;
+        keyform.origin_y = 0.8f;
+        keyform.scale = 0.3f;
+        keyform.angle = -15.0f;
+        rotation.keyforms.push_back(keyform);
+        keyform.angle = 15.0f;
+        rotation.keyforms.push_back(keyform);
+        uint32_t head = model.AddRotationDeformer(rotation);
+
+        for (uint32_t m = 0; m < MESHES_PER_MODEL; m++)
+        {
+            ArtMeshDesc desc;
+            desc.parent = m % 2 == 0 ? body : head;
+            uint32_t vertex_count = 16u << (m % 5);
+            axis.parameter = 2 + m % 8;
+            axis.keys = { -1.0f, 0.0f, 1.0f };
+            desc.binding.axes.push_back(axis);
+            for (uint32_t i = 0; i < 3 * vertex_count * 2; i++)
+            {
+                desc.positions.push_back(Random(seed));
+            }
+
+            desc.uvs.assign(vertex_count * 2, 0.5f);
+            desc.opacities = { 1.0f, 1.0f, 0.5f };
+            model.AddArtMesh(desc);
+        }
+    }
+}
+
+// Milliseconds per frame for 100 models of 50 art meshes each, every parameter animated so
+// that all meshes are evaluated again every frame. One Update call per model, serial and with
+// each model spreading its meshes across the scheduler, against one DeformerEngine::Update for
+// all of them. Worker count 0 runs without a scheduler.
+int main()
+{
+    uint32_t seed = 6;
+    std::vector<std::unique_ptr<Live2DModel>> models;
+    std::vector<std::vector<ArtMeshVertex>> vertices(MODEL_COUNT);
+    std::vector<Live2DModel*> model_pointers;
+    std::vector<ArtMeshVertex*> destinations;
+    uint32_t vertex_count = 0;
+    for (uint32_t m = 0; m < MODEL_COUNT; m++)
+    {
+        models.emplace_back(new Live2DModel());
+        BuildModel(*models[m], seed);
+        vertices[m].resize(models[m]->GetVertexCount());
+        model_pointers.push_back(models[m].get());
+        destinations.push_back(vertices[m].data());
+        vertex_count += models[m]->GetVertexCount();
+    }
+
+    std::printf("%u models, %u art meshes, %u vertices\n", MODEL_COUNT, MODEL_COUNT * MESHES_PER_MODEL, vertex_count);
+    std::printf("%-8s %14s %14s\n", "workers", "model.Update", "engine.Update");
+
+    uint32_t frame = 0;
+    auto animate = [&]()
+    {
+        for (uint32_t m = 0; m < MODEL_COUNT; m++)
+        {
+            for (uint32_t p = 0; p < models[m]->GetParameterCount(); p++)
+            {
+                models[m]->SetParameter(p, std::sin(frame * 0.1f + m + p));
+            }
+        }
+
+        frame++;
+    };
+
+    DeformerEngine engine;
+    for (uint32_t worker_count : { 0u, 1u, 2u, 4u, 8u })
+    {
+        std::unique_ptr<TaskScheduler> scheduler;
+        if (worker_count > 0)
+        {
+            scheduler.reset(new TaskScheduler(worker_count));
+        }
+
+        double model_ms = D3D::Test::MeasureMilliseconds(20, [&]()
+        {
+            animate();
+            for (uint32_t m = 0; m < MODEL_COUNT; m++)
+            {
+                models[m]->Update(destinations[m], scheduler.get());
+            }
+        });
+
+        double engine_ms = D3D::Test::MeasureMilliseconds(20, [&]()
+        {
+            animate();
+            engine.Update(model_pointers.data(), destinations.data(), MODEL_COUNT, scheduler.get());
+        });
+
+        std::printf("%-8u %14.3f %14.3f\n", worker_count, model_ms, engine_ms);
+    }
+
+    return 0;
+}
@@ -0,0 +1,281 @@
+#include "DescriptorTableCache.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace D3D
+{
+    namespace
+    {
+        const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+        const uint64_t FNV_PRIME = 1099511628211ull;
+
+        uint64_t HashBytes(uint64_t hash, const void* data, size_t size)
+        {
+            auto bytes = static_cast<const uint8_t*>(data);
+            for (size_t i = 0; i < size; i++)
+            {
+                hash ^= bytes[i];
+                hash *= FNV_PRIME;
+            }
+
+            return hash;
+        }
+    }
+
+    uint64_t DescriptorView::Hash() const
+    {
+        uint64_t hash = FNV_OFFSET_BASIS;
+        uint32_t view_type = type;
+        hash = HashBytes(hash, &view_type, sizeof(view_type));
+        hash = HashBytes(hash, &resource, sizeof(resource));
+        hash = HashBytes(hash, desc, desc_size);
+        return hash;
+    }
+
+    bool DescriptorView::Equals(const DescriptorView& other) const
+    {
+        return type == other.type && resource == other.resource && desc_size == other.desc_size && ::memcmp(desc, other.desc, desc_size) == 0;
+    }
+
+    void DescriptorTableAllocator::Initialize(uint32_t heap_size)
+    {
+        heap_size_ = heap_size;
+        free_ranges_.clear();
+        retired_ranges_.clear();
+
+        Range range;
+        range.begin = 0;
+        range.count = heap_size;
+        free_ranges_.push_back(range);
+    }
+
+    uint32_t DescriptorTableAllocator::Allocate(uint32_t count)
+    {
+        for (auto it = free_ranges_.begin(); it != free_ranges_.end(); ++it)
+        {
+            if (it->count >= count)
+            {
+                uint32_t heap_index = it->begin;
+                it->begin += count;
+                it->count -= count;
+                if (it->count == 0)
+                {
+                    free_ranges_.erase(it);
+                }
+
+                return heap_index;
+            }
+        }
+
+        return INVALID_INDEX_;
+    }
+
+    void DescriptorTableAllocator::Retire(uint32_t heap_index, uint32_t count, uint64_t fence_value)
+    {
+        RetiredRange retired;
+        retired.range.begin = heap_index;
+        retired.range.count = count;
+        retired.fence_value = fence_value;
+        retired_ranges_.push_back(retired);
+    }
+
+    void DescriptorTableAllocator::Reclaim(uint64_t completed_fence_value)
+    {
+        auto it = retired_ranges_.begin();
+        while (it != retired_ranges_.end())
+        {
+            if (it->fence_value <= completed_fence_value)
+            {
+                Free(it->range);
+                it = retired_ranges_.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    uint32_t DescriptorTableAllocator::GetHeapSize() const
+    {
+        return heap_size_;
+    }
+
+    uint32_t DescriptorTableAllocator::GetFreeCount() const
+    {
+        uint32_t count{ 0 };
+        for (auto& range : free_ranges_)
+        {
+            count += range.count;
+        }
+
+        return count;
+    }
+
+    uint32_t DescriptorTableAllocator::GetRetiredCount() const
+    {
+        uint32_t count{ 0 };
+        for (auto& retired : retired_ranges_)
+        {
+            count += retired.range.count;
+        }
+
+        return count;
+    }
+
+    void DescriptorTableAllocator::Free(const Range& range)
+    {
+        auto it = std::lower_bound(free_ranges_.begin(), free_ranges_.end(), range.begin, [](const Range& free_range, uint32_t begin)
+        {
+            return free_range.begin < begin;
+        });
+
+        it = free_ranges_.insert(it, range);
+
+        // Merge with the following range, then with the preceding one.
+        auto next = it + 1;
+        if (next != free_ranges_.end() && it->begin + it->count == next->begin)
+        {
+            it->count += next->count;
+            free_ranges_.erase(next);
+        }
+
+        if (it != free_ranges_.begin())
+        {
+            auto prev = it - 1;
+            if (prev->begin + prev->count == it->begin)
+            {
+                prev->count += it->count;
+                free_ranges_.erase(it);
+            }
+        }
+    }
+
+    void VersionedDescriptorTable::Initialize(DescriptorTableAllocator* allocator, uint32_t descriptor_count)
+    {
+        allocator_ = allocator;
+        views_.assign(descriptor_count, DescriptorView());
+        view_hashes_.assign(descriptor_count, 0);
+        committed_views_.assign(descriptor_count, DescriptorView());
+        committed_hashes_.assign(descriptor_count, 0);
+        committed_set_hash_ = 0;
+        heap_index_ = DescriptorTableAllocator::INVALID_INDEX_;
+        version_ = 0;
+        dirty_ = true;
+    }
+
+    void VersionedDescriptorTable::SetView(uint32_t slot, const DescriptorView& view)
+    {
+        assert(slot < views_.size());
+
+        views_[slot] = view;
+        view_hashes_[slot] = view.Hash();
+        dirty_ = true;
+    }
+
+    uint32_t VersionedDescriptorTable::Commit(DescriptorHeapDevice* device, uint64_t frame_fence_value)
+    {
+        if (!dirty_)
+        {
+            return heap_index_;
+        }
+
+        dirty_ = false;
+
+        uint64_t set_hash = FNV_OFFSET_BASIS;
+        for (auto view_hash : view_hashes_)
+        {
+            set_hash = HashBytes(set_hash, &view_hash, sizeof(view_hash));
+        }
+
+        uint32_t descriptor_count = static_cast<uint32_t>(views_.size());
+        bool has_version = heap_index_ != DescriptorTableAllocator::INVALID_INDEX_;
+        if (has_version && set_hash == committed_set_hash_)
+        {
+            uint32_t slot{ 0 };
+            while (slot < descriptor_count && IsCommitted(slot))
+            {
+                slot++;
+            }
+
+            if (slot == descriptor_count)
+            {
+                return heap_index_;
+            }
+        }
+
+        uint32_t new_heap_index = allocator_->Allocate(descriptor_count);
+        if (new_heap_index == DescriptorTableAllocator::INVALID_INDEX_)
+        {
+            // Out of space: keep the old version bound and retry on the next commit.
+            assert(0);
+            dirty_ = true;
+            return heap_index_;
+        }
+
+        // Unchanged slots are copied from the previous version in runs, changed ones are rewritten.
+        uint32_t slot{ 0 };
+        while (slot < descriptor_count)
+        {
+            if (has_version && IsCommitted(slot))
+            {
+                uint32_t run_end = slot + 1;
+                while (run_end < descriptor_count && IsCommitted(run_end))
+                {
+                    run_end++;
+                }
+
+                device->CopyDescriptors(new_heap_index + slot, heap_index_ + slot, run_end - slot);
+                slot = run_end;
+            }
+            else
+            {
+                if (views_[slot].resource != nullptr || views_[slot].desc_size != 0)
+                {
+                    device->WriteDescriptor(views_[slot], new_heap_index + slot);
+                }
+
+                slot++;
+            }
+        }
+
+        if (has_version)
+        {
+            allocator_->Retire(heap_index_, descriptor_count, frame_fence_value);
+        }
+
+        heap_index_ = new_heap_index;
+        committed_views_ = views_;
+        committed_hashes_ = view_hashes_;
+        committed_set_hash_ = set_hash;
+        version_++;
+
+        return heap_index_;
+    }
+
+    uint32_t VersionedDescriptorTable::GetHeapIndex() const
+    {
+        return heap_index_;
+    }
+
+    uint32_t VersionedDescriptorTable::GetDescriptorCount() const
+    {
+        return static_cast<uint32_t>(views_.size());
+    }
+
+    uint32_t VersionedDescriptorTable::GetVersion() const
+    {
+        return version_;
+    }
+
+    uint64_t VersionedDescriptorTable::GetBoundSetHash() const
+    {
+        return committed_set_hash_;
+    }
+
+    bool VersionedDescriptorTable::IsCommitted(uint32_t slot) const
+    {
+        return view_hashes_[slot] == committed_hashes_[slot] && views_[slot].Equals(committed_views_[slot]);
+    }
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace D3D
+{
+    enum DescriptorViewType { kSrvView, kUavView, kCbvView, kSamplerView };
+
+    // Everything needed to (re)create one descriptor: the view type, the resource and a copy
+    // of the view description. The description bytes are opaque here, the device interprets them.
+    struct DescriptorView
+    {
+        static const uint32_t DESC_CAPACITY_ = 64;
+
+        DescriptorViewType type = kSrvView;
+        void* resource = nullptr;
+        uint32_t desc_size = 0;
+        uint8_t desc[DESC_CAPACITY_] = {};
+
+        template<typename TDesc>
+        static DescriptorView Create(DescriptorViewType type, void* resource, const TDesc& view_desc)
+        {
+            static_assert(sizeof(TDesc) <= DESC_CAPACITY_, "view description is too large");
+
+            DescriptorView view;
+            view.type = type;
+            view.resource = resource;
+            view.desc_size = sizeof(TDesc);
+            ::memcpy(view.desc, &view_desc, sizeof(TDesc));
+            return view;
+        }
+
+        template<typename TDesc>
+        const TDesc& GetDesc() const
+        {
+            return *reinterpret_cast<const TDesc*>(desc);
+        }
+
+        uint64_t Hash() const;
+
+        // Same type, resource and description bytes.
+        bool Equals(const DescriptorView& other) const;
+    };
+
+    // The descriptor operations the table cache needs, so it can run against a real device or a mock.
+    class DescriptorHeapDevice
+    {
+    public:
+        virtual ~DescriptorHeapDevice() {}
+
+        virtual void WriteDescriptor(const DescriptorView& view, uint32_t heap_index) = 0;
+        virtual void CopyDescriptors(uint32_t dest_heap_index, uint32_t src_heap_index, uint32_t count) = 0;
+    };
+
+    // First fit allocator of descriptor ranges inside one heap. Freed ranges only become
+    // reusable once the GPU has passed the fence value they were retired with.
+    class DescriptorTableAllocator
+    {
+    public:
+        static const uint32_t INVALID_INDEX_ = 0xffffffff;
+
+        void Initialize(uint32_t heap_size);
+
+        uint32_t Allocate(uint32_t count);
+        void Retire(uint32_t heap_index, uint32_t count, uint64_t fence_value);
+        void Reclaim(uint64_t completed_fence_value);
+
+        uint32_t GetHeapSize() const;
+        uint32_t GetFreeCount() const;
+        uint32_t GetRetiredCount() const;
+
+    private:
+        struct Range
+        {
+            uint32_t begin = 0;
+            uint32_t count = 0;
+        };
+
+        struct RetiredRange
+        {
+            Range range;
+            uint64_t fence_value = 0;
+        };
+
+        void Free(const Range& range);
+
+        uint32_t                                            heap_size_ = 0;
+        std::vector<Range>                                  free_ranges_;
+        std::vector<RetiredRange>                           retired_ranges_;
+    };
+
+    // A descriptor table whose contents are never overwritten while the GPU may read them.
+    // Changing a view produces a new version of the table in a fresh heap range: changed slots
+    // are written, unchanged ones are copied from the previous version, and the previous range
+    // is retired on the frame fence. Committing an unchanged bound set writes nothing.
+    class VersionedDescriptorTable
+    {
+    public:
+        void Initialize(DescriptorTableAllocator* allocator, uint32_t descriptor_count);
+
+        void SetView(uint32_t slot, const DescriptorView& view);
+
+        // Returns the heap index of the version that should be bound for this frame.
+        uint32_t Commit(DescriptorHeapDevice* device, uint64_t frame_fence_value);
+
+        uint32_t GetHeapIndex() const;
+        uint32_t GetDescriptorCount() const;
+        uint32_t GetVersion() const;
+        uint64_t GetBoundSetHash() const;
+
+    private:
+        // Equal hashes only say a slot probably did not change, the views decide.
+        bool IsCommitted(uint32_t slot) const;
+
+        DescriptorTableAllocator*                           allocator_ = nullptr;
+        std::vector<DescriptorView>                         views_;
+        std::vector<uint64_t>                               view_hashes_;
+        std::vector<DescriptorView>                         committed_views_;
+        std::vector<uint64_t>                               committed_hashes_;
+        uint64_t                                            committed_set_hash_ = 0;
+        uint32_t                                            heap_index_ = DescriptorTableAllocator::INVALID_INDEX_;
+        uint32_t                                            version_ = 0;
+        bool                                                dirty_ = false;
+    };
+};
@@ -0,0 +1,169 @@
+#include "DescriptorTableCache.h"
+
+#include "TestHarness.h"
+
+using namespace D3D;
+
+namespace
+{
+    // Counts what the table asks of the device instead of touching a heap.
+    class MockDevice : public DescriptorHeapDevice
+    {
+    public:
+        void WriteDescriptor(const DescriptorView& view, uint32_t heap_index) override
+        {
+            write_count++;
+        }
+
+        void CopyDescriptors(uint32_t dest_heap_index, uint32_t src_heap_index, uint32_t count) override
+        {
+            copy_count += count;
+            copy_call_count++;
+        }
+
+        void Reset()
+        {
+            write_count = 0;
+            copy_count = 0;
+            copy_call_count = 0;
+        }
+
+        uint32_t write_count = 0;
+        uint32_t copy_count = 0;
+        uint32_t copy_call_count = 0;
+    };
+
+    struct TextureDesc
+    {
+        uint32_t format;
+        uint32_t mip_levels;
+    };
+
+    DescriptorView CreateView(void* resource, uint32_t format)
+    {
+        return DescriptorView::Create(kSrvView, resource, TextureDesc{ format, 1 });
+    }
+
+    void TestAllocator()
+    {
+        DescriptorTableAllocator allocator;
+        allocator.Initialize(16);
+
+        TEST_CHECK(allocator.Allocate(4) == 0);
+        TEST_CHECK(allocator.Allocate(4) == 4);
+        TEST_CHECK(allocator.Allocate(16) == DescriptorTableAllocator::INVALID_INDEX_);
+
+        // Retired ranges wait for their fence.
+        allocator.Retire(0, 4, 10);
+        TEST_CHECK(allocator.GetRetiredCount() == 4 && allocator.GetFreeCount() == 8);
+        allocator.Reclaim(9);
+        TEST_CHECK(allocator.GetRetiredCount() == 4);
+        allocator.Reclaim(10);
+        TEST_CHECK(allocator.GetRetiredCount() == 0 && allocator.GetFreeCount() == 12);
+
+        // Freed neighbours merge back into one range.
+        allocator.Retire(4, 4, 11);
+        allocator.Reclaim(11);
+        TEST_CHECK(allocator.Allocate(16) == 0);
+    }
+
+    void TestWriteCounts()
+    {
+        DescriptorTableAllocator allocator;
+        allocator.Initialize(64);
+
+        VersionedDescriptorTable table;
+        table.Initialize(&allocator, 4);
+
+        MockDevice device;
+        int resources[4] = {};
+
+        // Empty slots are not written.
+        table.SetView(0, CreateView(&resources[0], 1));
+        table.SetView(1, CreateView(&resources[1], 1));
+        uint32_t first_index = table.Commit(&device, 1);
+        TEST_CHECK(device.write_count == 2 && device.copy_count == 0);
+        TEST_CHECK(table.GetVersion() == 1);
+
+        table.SetView(2, CreateView(&resources[2], 1));
+        table.SetView(3, CreateView(&resources[3], 1));
+        uint32_t full_index = table.Commit(&device, 2);
+        TEST_CHECK(full_index != first_index && table.GetVersion() == 2);
+        TEST_CHECK(device.write_count == 4 && device.copy_count == 2);
+
+        // Committing without a change does nothing.
+        device.Reset();
+        TEST_CHECK(table.Commit(&device, 3) == full_index);
+        TEST_CHECK(device.write_count == 0 && device.copy_count == 0);
+
+        // Setting the views that are already bound does not make a new version either.
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            table.SetView(i, CreateView(&resources[i], 1));
+        }
+
+        TEST_CHECK(table.Commit(&device, 4) == full_index);
+        TEST_CHECK(device.write_count == 0 && device.copy_count == 0 && table.GetVersion() == 2);
+
+        // One changed slot is written, the unchanged ones are copied in two runs.
+        table.SetView(2, CreateView(&resources[2], 2));
+        uint32_t changed_index = table.Commit(&device, 5);
+        TEST_CHECK(changed_index != full_index && table.GetVersion() == 3);
+        TEST_CHECK(device.write_count == 1 && device.copy_count == 3 && device.copy_call_count == 2);
+
+        // A new resource with the same description is a change as well.
+        device.Reset();
+        int other_resource = 0;
+        table.SetView(0, CreateView(&other_resource, 1));
+        table.Commit(&device, 6);
+        TEST_CHECK(device.write_count == 1 && device.copy_count == 3 && device.copy_call_count == 1);
+
+        // Old versions go back to the allocator once their frame is done.
+        TEST_CHECK(allocator.GetRetiredCount() == 4 * 3);
+        allocator.Reclaim(6);
+        TEST_CHECK(allocator.GetRetiredCount() == 0 && allocator.GetFreeCount() == 64 - 4);
+    }
+
+    void TestRing()
+    {
+        // A table changed every frame keeps fitting while frames complete.
+        DescriptorTableAllocator allocator;
+        allocator.Initialize(16);
+
+        VersionedDescriptorTable table;
+        table.Initialize(&allocator, 4);
+
+        MockDevice device;
+        int resource = 0;
+        for (uint32_t frame = 1; frame < 100; frame++)
+        {
+            table.SetView(0, CreateView(&resource, frame));
+            uint32_t heap_index = table.Commit(&device, frame);
+            TEST_CHECK(heap_index != DescriptorTableAllocator::INVALID_INDEX_ && heap_index + 4 <= 16);
+            allocator.Reclaim(frame - 1);
+        }
+
+        TEST_CHECK(table.GetVersion() == 99);
+        TEST_CHECK(device.write_count == 99);
+    }
+
+    void TestViewKeys()
+    {
+        int resource = 0;
+        auto view = CreateView(&resource, 3);
+        TEST_CHECK(view.Equals(CreateView(&resource, 3)));
+        TEST_CHECK(view.Hash() == CreateView(&resource, 3).Hash());
+        TEST_CHECK(!view.Equals(CreateView(&resource, 4)));
+        TEST_CHECK(!view.Equals(CreateView(nullptr, 3)));
+        TEST_CHECK(!view.Equals(DescriptorView::Create(kUavView, &resource, TextureDesc{ 3, 1 })));
+    }
+}
+
+int main()
+{
+    TestAllocator();
+    TestWriteCounts();
+    TestRing();
+    TestViewKeys();
+    return D3D::Test::Finish("DescriptorTableCacheTests");
+}
@@ -0,0 +1,296 @@
+#include "FrustumCulling.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#include "SimdMath.h"
+#include "TaskScheduler.h"
+
+namespace D3D
+{
+    namespace
+    {
+        // Multiple of the eight volumes handled per iteration.
+        const uint32_t CULL_CHUNK_SIZE = 4096;
+
+        struct SimdPlanes
+        {
+            Simd::Float8 a[Frustum::kPlaneCount];
+            Simd::Float8 b[Frustum::kPlaneCount];
+            Simd::Float8 c[Frustum::kPlaneCount];
+            Simd::Float8 d[Frustum::kPlaneCount];
+            Simd::Float8 abs_a[Frustum::kPlaneCount];
+            Simd::Float8 abs_b[Frustum::kPlaneCount];
+            Simd::Float8 abs_c[Frustum::kPlaneCount];
+        };
+
+        void LoadPlanes(const Frustum& frustum, SimdPlanes& planes)
+        {
+            for (uint32_t p = 0; p < Frustum::kPlaneCount; p++)
+            {
+                auto& plane = frustum.GetPlane(p);
+                planes.a[p] = Simd::Set1x8(plane.a);
+                planes.b[p] = Simd::Set1x8(plane.b);
+                planes.c[p] = Simd::Set1x8(plane.c);
+                planes.d[p] = Simd::Set1x8(plane.d);
+                planes.abs_a[p] = Simd::Set1x8(std::fabs(plane.a));
+                planes.abs_b[p] = Simd::Set1x8(std::fabs(plane.b));
+                planes.abs_c[p] = Simd::Set1x8(std::fabs(plane.c));
+            }
+        }
+
+        inline Simd::Float8 PlaneDistance(const SimdPlanes& planes, uint32_t p, Simd::Float8 x, Simd::Float8 y, Simd::Float8 z)
+        {
+            return Simd::MulAdd(planes.a[p], x, Simd::MulAdd(planes.b[p], y, Simd::MulAdd(planes.c[p], z, planes.d[p])));
+        }
+
+        inline uint32_t SphereMask(const SimdPlanes& planes, const float* x, const float* y, const float* z, const float* r)
+        {
+            Simd::Float8 cx = Simd::Load8(x);
+            Simd::Float8 cy = Simd::Load8(y);
+            Simd::Float8 cz = Simd::Load8(z);
+            Simd::Float8 neg_r = Simd::Sub(Simd::Zero8(), Simd::Load8(r));
+
+            Simd::Float8 inside = Simd::CmpGe(PlaneDistance(planes, 0, cx, cy, cz), neg_r);
+            for (uint32_t p = 1; p < Frustum::kPlaneCount; p++)
+            {
+                inside = Simd::And(inside, Simd::CmpGe(PlaneDistance(planes, p, cx, cy, cz), neg_r));
+            }
+
+            return Simd::MoveMask(inside);
+        }
+
+        inline uint32_t BoxMask(const SimdPlanes& planes, const float* x, const float* y, const float* z, const float* ex, const float* ey, const float* ez)
+        {
+            Simd::Float8 cx = Simd::Load8(x);
+            Simd::Float8 cy = Simd::Load8(y);
+            Simd::Float8 cz = Simd::Load8(z);
+            Simd::Float8 hx = Simd::Load8(ex);
+            Simd::Float8 hy = Simd::Load8(ey);
+            Simd::Float8 hz = Simd::Load8(ez);
+            Simd::Float8 zero = Simd::Zero8();
+
+            // The box is outside a plane only when its most positive corner is behind it.
+            Simd::Float8 inside = Simd::CmpGe(zero, zero);
+            for (uint32_t p = 0; p < Frustum::kPlaneCount; p++)
+            {
+                Simd::Float8 radius = Simd::MulAdd(planes.abs_a[p], hx, Simd::MulAdd(planes.abs_b[p], hy, Simd::Mul(planes.abs_c[p], hz)));
+                inside = Simd::And(inside, Simd::CmpGe(Simd::Add(PlaneDistance(planes, p, cx, cy, cz), radius), zero));
+            }
+
+            return Simd::MoveMask(inside);
+        }
+
+        // Column 3 plus or minus column j, column j being (m[0][j], m[1][j], m[2][j], m[3][j]).
+        FrustumPlane CombineColumns(const float view_proj[16], uint32_t j, float sign)
+        {
+            FrustumPlane plane;
+            plane.a = view_proj[3] + sign * view_proj[j];
+            plane.b = view_proj[7] + sign * view_proj[4 + j];
+            plane.c = view_proj[11] + sign * view_proj[8 + j];
+            plane.d = view_proj[15] + sign * view_proj[12 + j];
+            return plane;
+        }
+
+        inline uint32_t AppendVisible(uint32_t mask, uint32_t base_index, uint32_t* visible_indices, uint32_t visible_count)
+        {
+            while (mask != 0)
+            {
+                uint32_t lane{ 0 };
+                while (((mask >> lane) & 1) == 0)
+                {
+                    lane++;
+                }
+
+                mask &= mask - 1;
+                visible_indices[visible_count++] = base_index + lane;
+            }
+
+            return visible_count;
+        }
+
+        uint32_t CullSphereRange(const SimdPlanes& planes, const float* x, const float* y, const float* z, const float* r, uint32_t begin, uint32_t end, uint32_t* visible_indices)
+        {
+            uint32_t visible_count{ 0 };
+            uint32_t i = begin;
+            for (; i + 8 <= end; i += 8)
+            {
+                uint32_t mask = SphereMask(planes, x + i, y + i, z + i, r + i);
+                visible_count = AppendVisible(mask, i, visible_indices, visible_count);
+            }
+
+            // The tail goes through the same kernel on zero padded copies.
+            if (i < end)
+            {
+                float tail[4][8] = {};
+                uint32_t tail_count = end - i;
+                for (uint32_t t = 0; t < tail_count; t++)
+                {
+                    tail[0][t] = x[i + t];
+                    tail[1][t] = y[i + t];
+                    tail[2][t] = z[i + t];
+                    tail[3][t] = r[i + t];
+                }
+
+                uint32_t mask = SphereMask(planes, tail[0], tail[1], tail[2], tail[3]) & ((1u << tail_count) - 1);
+                visible_count = AppendVisible(mask, i, visible_indices, visible_count);
+            }
+
+            return visible_count;
+        }
+
+        uint32_t CullBoxRange(const SimdPlanes& planes, const float* x, const float* y, const float* z, const float* ex, const float* ey, const float* ez, uint32_t begin, uint32_t end, uint32_t* visible_indices)
+        {
+            uint32_t visible_count{ 0 };
+            uint32_t i = begin;
+            for (; i + 8 <= end; i += 8)
+            {
+                uint32_t mask = BoxMask(planes, x + i, y + i, z + i, ex + i, ey + i, ez + i);
+                visible_count = AppendVisible(mask, i, visible_indices, visible_count);
+            }
+
+            if (i < end)
+            {
+                float tail[6][8] = {};
+                uint32_t tail_count = end - i;
+                for (uint32_t t = 0; t < tail_count; t++)
+                {
+                    tail[0][t] = x[i + t];
+                    tail[1][t] = y[i + t];
+                    tail[2][t] = z[i + t];
+                    tail[3][t] = ex[i + t];
+                    tail[4][t] = ey[i + t];
+                    tail[5][t] = ez[i + t];
+                }
+
+                uint32_t mask = BoxMask(planes, tail[0], tail[1], tail[2], tail[3], tail[4], tail[5]) & ((1u << tail_count) - 1);
+                visible_count = AppendVisible(mask, i, visible_indices, visible_count);
+            }
+
+            return visible_count;
+        }
+    }
+
+    Frustum Frustum::FromViewProj(const float view_proj[16])
+    {
+        Frustum frustum;
+        frustum.planes_[kLeftPlane] = CombineColumns(view_proj, 0, 1.0f);
+        frustum.planes_[kRightPlane] = CombineColumns(view_proj, 0, -1.0f);
+        frustum.planes_[kBottomPlane] = CombineColumns(view_proj, 1, 1.0f);
+        frustum.planes_[kTopPlane] = CombineColumns(view_proj, 1, -1.0f);
+        frustum.planes_[kFarPlane] = CombineColumns(view_proj, 2, -1.0f);
+
+        // Clip depth starts at 0, so the near plane is the z column alone.
+        frustum.planes_[kNearPlane].a = view_proj[2];
+        frustum.planes_[kNearPlane].b = view_proj[6];
+        frustum.planes_[kNearPlane].c = view_proj[10];
+        frustum.planes_[kNearPlane].d = view_proj[14];
+
+        for (auto& plane : frustum.planes_)
+        {
+            float length = std::sqrt(plane.a * plane.a + plane.b * plane.b + plane.c * plane.c);
+            if (length > 0.0f)
+            {
+                plane.a /= length;
+                plane.b /= length;
+                plane.c /= length;
+                plane.d /= length;
+            }
+        }
+
+        return frustum;
+    }
+
+    const FrustumPlane& Frustum::GetPlane(uint32_t index) const
+    {
+        assert(index < kPlaneCount);
+
+        return planes_[index];
+    }
+
+    bool Frustum::IntersectsSphere(float center_x, float center_y, float center_z, float radius) const
+    {
+        for (auto& plane : planes_)
+        {
+            if (plane.a * center_x + plane.b * center_y + plane.c * center_z + plane.d < -radius)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool Frustum::IntersectsBox(float center_x, float center_y, float center_z, float extent_x, float extent_y, float extent_z) const
+    {
+        for (auto& plane : planes_)
+        {
+            float radius = std::fabs(plane.a) * extent_x + std::fabs(plane.b) * extent_y + std::fabs(plane.c) * extent_z;
+            if (plane.a * center_x + plane.b * center_y + plane.c * center_z + plane.d + radius < 0.0f)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    template<typename TCullFunc>
+    uint32_t FrustumCuller::CullChunks(uint32_t count, uint32_t* visible_indices, TaskScheduler* scheduler, const TCullFunc& cull_func)
+    {
+        if (scheduler == nullptr || count <= CULL_CHUNK_SIZE)
+        {
+            return cull_func(0, count, visible_indices);
+        }
+
+        // Every chunk compacts into its own slice of the scratch list, the slices are joined in order afterwards.
+        uint32_t chunk_count = (count + CULL_CHUNK_SIZE - 1) / CULL_CHUNK_SIZE;
+        chunk_indices_.resize(count);
+        chunk_counts_.resize(chunk_count);
+
+        scheduler->ParallelFor(chunk_count, 1, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t chunk = begin; chunk < end; chunk++)
+            {
+                uint32_t chunk_begin = chunk * CULL_CHUNK_SIZE;
+                uint32_t chunk_end = (std::min)(chunk_begin + CULL_CHUNK_SIZE, count);
+                chunk_counts_[chunk] = cull_func(chunk_begin, chunk_end, chunk_indices_.data() + chunk_begin);
+            }
+        });
+
+        uint32_t visible_count{ 0 };
+        for (uint32_t chunk = 0; chunk < chunk_count; chunk++)
+        {
+            ::memcpy(visible_indices + visible_count, chunk_indices_.data() + chunk * CULL_CHUNK_SIZE, chunk_counts_[chunk] * sizeof(uint32_t));
+            visible_count += chunk_counts_[chunk];
+        }
+
+        return visible_count;
+    }
+
+    uint32_t FrustumCuller::CullSpheres(const Frustum& frustum, const float* center_x, const float* center_y, const float* center_z, const float* radius,
+        uint32_t count, uint32_t* visible_indices, TaskScheduler* scheduler)
+    {
+        SimdPlanes planes;
+        LoadPlanes(frustum, planes);
+
+        return CullChunks(count, visible_indices, scheduler, [&](uint32_t begin, uint32_t end, uint32_t* out_indices)
+        {
+            return CullSphereRange(planes, center_x, center_y, center_z, radius, begin, end, out_indices);
+        });
+    }
+
+    uint32_t FrustumCuller::CullBoxes(const Frustum& frustum, const float* center_x, const float* center_y, const float* center_z,
+        const float* extent_x, const float* extent_y, const float* extent_z, uint32_t count, uint32_t* visible_indices, TaskScheduler* scheduler)
+    {
+        SimdPlanes planes;
+        LoadPlanes(frustum, planes);
+
+        return CullChunks(count, visible_indices, scheduler, [&](uint32_t begin, uint32_t end, uint32_t* out_indices)
+        {
+            return CullBoxRange(planes, center_x, center_y, center_z, extent_x, extent_y, extent_z, begin, end, out_indices);
+        });
+    }
+};
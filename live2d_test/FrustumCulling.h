@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace D3D
+{
+    class TaskScheduler;
+
+    // ax + by + cz + d >= 0 on the inner side, (a, b, c) normalized.
+    struct FrustumPlane
+    {
+        float a = 0.0f;
+        float b = 0.0f;
+        float c = 0.0f;
+        float d = 0.0f;
+    };
+
+    class Frustum
+    {
+    public:
+        enum PlaneIndex { kLeftPlane, kRightPlane, kBottomPlane, kTopPlane, kNearPlane, kFarPlane, kPlaneCount };
+
+        // view_proj is row major with row vectors (clip = p * view_proj) and a [0, 1] clip depth,
+        // as produced by XMStoreFloat4x4(view * proj).
+        static Frustum FromViewProj(const float view_proj[16]);
+
+        const FrustumPlane& GetPlane(uint32_t index) const;
+
+        // Scalar reference tests.
+        bool IntersectsSphere(float center_x, float center_y, float center_z, float radius) const;
+        bool IntersectsBox(float center_x, float center_y, float center_z, float extent_x, float extent_y, float extent_z) const;
+
+    private:
+        FrustumPlane                                        planes_[kPlaneCount];
+    };
+
+    // Culls structure-of-arrays bounding volumes eight at a time, one Simd::Float8 per
+    // coordinate (a single AVX register in AVX2 builds, two SSE ones otherwise), and writes the
+    // indices of the visible ones, in ascending order, into a compact list. Large inputs are
+    // split into chunks across the task scheduler.
+    class FrustumCuller
+    {
+    public:
+        // visible_indices must hold count entries, returns the number written.
+        uint32_t CullSpheres(const Frustum& frustum, const float* center_x, const float* center_y, const float* center_z, const float* radius,
+            uint32_t count, uint32_t* visible_indices, TaskScheduler* scheduler = nullptr);
+
+        uint32_t CullBoxes(const Frustum& frustum, const float* center_x, const float* center_y, const float* center_z,
+            const float* extent_x, const float* extent_y, const float* extent_z, uint32_t count, uint32_t* visible_indices, TaskScheduler* scheduler = nullptr);
+
+    private:
+        template<typename TCullFunc>
+        uint32_t CullChunks(uint32_t count, uint32_t* visible_indices, TaskScheduler* scheduler, const TCullFunc& cull_func);
+
+        std::vector<uint32_t>                               chunk_indices_;
+        std::vector<uint32_t>                               chunk_counts_;
+    };
+};
@@ -0,0 +1,91 @@
+#include "FrustumCulling.h"
+
+#include <vector>
+
+#include "PortableMath.h"
+#include "TaskScheduler.h"
+#include "TestHarness.h"
+
+using namespace D3D;
+using namespace DirectX;
+
+namespace
+{
+    float Random(uint32_t& seed)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / 16777216.0f;
+    }
+}
+
+// Volumes culled per millisecond by the scalar reference tests and the eight wide culler, serial
+// and on a TaskScheduler. Build with -DLIVE2D_SIMD=SSE2, AVX2 or SCALAR to compare backends.
+int main()
+{
+    XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(0.0f, 5.0f, -40.0f, 1.0f), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    XMFLOAT4X4 view_proj;
+    XMStoreFloat4x4(&view_proj, view * XMMatrixPerspectiveFovLH(0.8f, 1.5f, 0.1f, 200.0f));
+    Frustum frustum = Frustum::FromViewProj(&view_proj._11);
+
+    TaskScheduler scheduler;
+    FrustumCuller culler;
+#if defined(SIMD_MATH_AVX)
+    const char* backend = "AVX";
+#elif defined(SIMD_MATH_SCALAR)
+    const char* backend = "scalar";
+#else
+    const char* backend = "SSE/NEON";
+#endif
+    std::printf("Float8 on %s, %u threads\n", backend, scheduler.GetThreadCount());
+    std::printf("%-8s %9s %9s %12s %12s %12s\n", "volume", "count", "visible", "scalar /ms", "simd /ms", "sched /ms");
+
+    for (uint32_t count : { 1000u, 100000u, 1000000u })
+    {
+        uint32_t seed = 7;
+        std::vector<float> streams[6];
+        for (uint32_t i = 0; i < count; i++)
+        {
+            for (uint32_t s = 0; s < 6; s++)
+            {
+                streams[s].push_back(s < 3 ? Random(seed) * 200.0f - 100.0f : Random(seed) * 2.0f);
+            }
+        }
+
+        std::vector<uint32_t> visible(count);
+        uint32_t repeat = 10000000u / count;
+        for (uint32_t box = 0; box < 2; box++)
+        {
+            uint32_t visible_count = 0;
+            double scalar_ms = D3D::Test::MeasureMilliseconds(repeat, [&]()
+            {
+                visible_count = 0;
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    bool inside = box != 0 ? frustum.IntersectsBox(streams[0][i], streams[1][i], streams[2][i], streams[3][i], streams[4][i], streams[5][i])
+                        : frustum.IntersectsSphere(streams[0][i], streams[1][i], streams[2][i], streams[3][i]);
+                    if (inside)
+                    {
+                        visible[visible_count++] = i;
+                    }
+                }
+            });
+
+            auto cull = [&](TaskScheduler* task_scheduler)
+            {
+                return D3D::Test::MeasureMilliseconds(repeat, [&]()
+                {
+                    visible_count = box != 0 ? culler.CullBoxes(frustum, streams[0].data(), streams[1].data(), streams[2].data(), streams[3].data(),
+                        streams[4].data(), streams[5].data(), count, visible.data(), task_scheduler)
+                        : culler.CullSpheres(frustum, streams[0].data(), streams[1].data(), streams[2].data(), streams[3].data(), count, visible.data(), task_scheduler);
+                });
+            };
+
+            double simd_ms = cull(nullptr);
+            double scheduler_ms = cull(&scheduler);
+            std::printf("%-8s %9u %9u %12.0f %12.0f %12.0f\n", box != 0 ? "box" : "sphere", count, visible_count,
+                count / scalar_ms, count / simd_ms, count / scheduler_ms);
+        }
+    }
+
+    return 0;
+}
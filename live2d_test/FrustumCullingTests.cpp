@@ -0,0 +1,115 @@
+#include "FrustumCulling.h"
+
+#include <vector>
+
+#include "PortableMath.h"
+#include "TaskScheduler.h"
+#include "TestHarness.h"
+
+using namespace D3D;
+using namespace DirectX;
+
+namespace
+{
+    float Random(uint32_t& seed)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / 16777216.0f;
+    }
+
+    Frustum CreateFrustum()
+    {
+        XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(3.0f, 4.0f, -30.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 10.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+        XMFLOAT4X4 view_proj;
+        XMStoreFloat4x4(&view_proj, view * XMMatrixPerspectiveFovLH(0.8f, 1.5f, 1.0f, 60.0f));
+        return Frustum::FromViewProj(&view_proj._11);
+    }
+
+    struct Volumes
+    {
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> z;
+        std::vector<float> size[3];                         // radius in size[0] for spheres
+
+        explicit Volumes(uint32_t count)
+        {
+            uint32_t seed = count;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                x.push_back(Random(seed) * 160.0f - 80.0f);
+                y.push_back(Random(seed) * 160.0f - 80.0f);
+                z.push_back(Random(seed) * 160.0f - 80.0f);
+                for (auto& extent : size)
+                {
+                    extent.push_back(Random(seed) * 6.0f);
+                }
+            }
+        }
+    };
+
+    void TestMatchesReference()
+    {
+        // Counts around the eight lane groups and the chunk size, so tails and chunk joins run.
+        Frustum frustum = CreateFrustum();
+        TaskScheduler scheduler(4);
+        FrustumCuller culler;
+        for (uint32_t count : { 0u, 1u, 7u, 8u, 9u, 31u, 4096u, 4103u, 20000u })
+        {
+            Volumes volumes(count);
+            std::vector<uint32_t> expected_spheres;
+            std::vector<uint32_t> expected_boxes;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                if (frustum.IntersectsSphere(volumes.x[i], volumes.y[i], volumes.z[i], volumes.size[0][i]))
+                {
+                    expected_spheres.push_back(i);
+                }
+
+                if (frustum.IntersectsBox(volumes.x[i], volumes.y[i], volumes.z[i], volumes.size[0][i], volumes.size[1][i], volumes.size[2][i]))
+                {
+                    expected_boxes.push_back(i);
+                }
+            }
+
+            for (TaskScheduler* task_scheduler : { static_cast<TaskScheduler*>(nullptr), &scheduler })
+            {
+                std::vector<uint32_t> visible(count);
+                uint32_t visible_count = culler.CullSpheres(frustum, volumes.x.data(), volumes.y.data(), volumes.z.data(), volumes.size[0].data(),
+                    count, visible.data(), task_scheduler);
+                visible.resize(visible_count);
+                TEST_CHECK(visible == expected_spheres);
+
+                visible.resize(count);
+                visible_count = culler.CullBoxes(frustum, volumes.x.data(), volumes.y.data(), volumes.z.data(),
+                    volumes.size[0].data(), volumes.size[1].data(), volumes.size[2].data(), count, visible.data(), task_scheduler);
+                visible.resize(visible_count);
+                TEST_CHECK(visible == expected_boxes);
+            }
+
+            // The volumes spread well past the frustum, some are culled and some are kept.
+            TEST_CHECK(count < 100 || (expected_spheres.size() > 0 && expected_spheres.size() < count));
+        }
+    }
+
+    void TestPlanes()
+    {
+        // Planes face inwards, the point in front of the camera is inside all of them.
+        Frustum frustum = CreateFrustum();
+        TEST_CHECK(frustum.IntersectsSphere(0.0f, 0.0f, 10.0f, 0.0f));
+        TEST_CHECK(!frustum.IntersectsSphere(3.0f, 4.0f, -32.0f, 0.5f));
+        TEST_CHECK(frustum.IntersectsSphere(3.0f, 4.0f, -32.0f, 3.5f));
+        for (uint32_t p = 0; p < Frustum::kPlaneCount; p++)
+        {
+            auto& plane = frustum.GetPlane(p);
+            TEST_CHECK(std::fabs(plane.a * plane.a + plane.b * plane.b + plane.c * plane.c - 1.0f) < 1e-5f);
+        }
+    }
+}
+
+int main()
+{
+    TestPlanes();
+    TestMatchesReference();
+    return D3D::Test::Finish("FrustumCullingTests");
+}
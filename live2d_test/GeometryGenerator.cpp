@@ -3,10 +3,63 @@
 //***************************************************************************************
 
 #include "GeometryGenerator.h"
+#include "TaskScheduler.h"
 #include <algorithm>
 
 using namespace DirectX;
 
+namespace
+{
+    // Rows of vertices or quads are handed to the scheduler in chunks of about this many.
+    const std::uint32_t PARALLEL_GRAIN = 4096;
+
+    // Calls body(begin, end) over the rows [0, rowCount), in parallel chunks when a scheduler is
+    // set and there is enough work. Rows only write their own vertices and indices, so the
+    // result is the same either way.
+    template<typename Function>
+    void ForEachRow(D3D::TaskScheduler* scheduler, std::uint32_t rowCount, std::uint32_t rowSize, Function body)
+    {
+        std::uint32_t grain = (std::max)(PARALLEL_GRAIN / (std::max)(rowSize, 1u), 1u);
+        if(scheduler != nullptr && rowCount > grain)
+            scheduler->ParallelFor(rowCount, grain, body);
+        else if(rowCount > 0)
+            body(0, rowCount);
+    }
+
+    // Calls write with the indices of meshData in the width they are stored in.
+    template<typename Function>
+    void WriteIndices(GeometryGenerator::MeshData& meshData, Function write)
+    {
+        if(meshData.Use32BitIndices)
+            write(meshData.Indices32.data());
+        else
+            write(meshData.Indices16.data());
+    }
+
+    // Splits every triangle of source in four, see Subdivide. With source and destination the
+    // same the split runs in place: going backwards, triangle i only overwrites the indices of
+    // triangles after it, which have been split already.
+    template<typename TSource, typename TDestination>
+    void SplitTriangles(const TSource* source, TDestination* destination, const std::uint32_t* midpoints, std::uint32_t numTris)
+    {
+        for(std::uint32_t i = numTris; i-- > 0;)
+        {
+            TDestination v0 = (TDestination)source[i*3+0];
+            TDestination v1 = (TDestination)source[i*3+1];
+            TDestination v2 = (TDestination)source[i*3+2];
+            TDestination m0 = (TDestination)midpoints[i*3+0];
+            TDestination m1 = (TDestination)midpoints[i*3+1];
+            TDestination m2 = (TDestination)midpoints[i*3+2];
+
+            TDestination* indices = &destination[i*12];
+            indices[0] = v0; indices[1] = m0; indices[2] = m2;
+            indices[3] = m0; indices[4] = m1; indices[5] = m2;
+            indices[6] = m2; indices[7] = m1; indices[8] = v2;
+            indices[9] = m0; indices[10] = v1; indices[11] = m1;
+        }
+    }
+}
+
 GeometryGenerator::MeshData GeometryGenerator::CreateBox(float width, float height, float depth, uint32 numSubdivisions)
 {
     MeshData meshData;
@@ -114,112 +167,122 @@ GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32
 	Vertex topVertex(0.0f, +radius, 0.0f, 0.0f, +1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
 	Vertex bottomVertex(0.0f, -radius, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
 
-	meshData.Vertices.push_back( topVertex );
-
 	float phiStep   = XM_PI/stackCount;
 	float thetaStep = 2.0f*XM_PI/sliceCount;
 
-	// Compute vertices for each stack ring (do not count the poles as rings).
-	for(uint32 i = 1; i <= stackCount-1; ++i)
-	{
-		float phi = i*phiStep;
-
-		// Vertices of ring.
-        for(uint32 j = 0; j <= sliceCount; ++j)
-		{
-			float theta = j*thetaStep;
-
-			Vertex v;
+    uint32 ringVertexCount = sliceCount + 1;
+	uint32 innerRingCount = stackCount - 1;
 
-			// spherical to cartesian
-			v.Position.x = radius*sinf(phi)*cosf(theta);
-			v.Position.y = radius*cosf(phi);
-			v.Position.z = radius*sinf(phi)*sinf(theta);
+	meshData.Vertices.resize(innerRingCount*ringVertexCount + 2);
+	meshData.Vertices.front() = topVertex;
+	meshData.Vertices.back() = bottomVertex;
 
-			// Partial derivative of P with respect to theta
-			v.TangentU.x = -radius*sinf(phi)*sinf(theta);
-			v.TangentU.y = 0.0f;
-			v.TangentU.z = +radius*sinf(phi)*cosf(theta);
+	BuildSliceTable(sliceCount, thetaStep);
 
-			XMVECTOR T = XMLoadFloat3(&v.TangentU);
-			XMStoreFloat3(&v.TangentU, XMVector3Normalize(T));
+	// Compute vertices for each stack ring (do not count the poles as rings).
+	ForEachRow(mScheduler, innerRingCount, ringVertexCount, [&](uint32 begin, uint32 end)
+	{
+		for(uint32 i = begin+1; i <= end; ++i)
+		{
+			float phi = i*phiStep;
+			float ringRadius = radius*sinf(phi);
+			float y = radius*cosf(phi);
+
+			// Vertices of ring.
+			Vertex* ring = &meshData.Vertices[1 + (i-1)*ringVertexCount];
+			for(uint32 j = 0; j <= sliceCount; ++j)
+			{
+				Vertex& v = ring[j];
+
+				// spherical to cartesian
+				v.Position.x = ringRadius*mSliceCos[j];
+				v.Position.y = y;
+				v.Position.z = ringRadius*mSliceSin[j];
+
+				// Partial derivative of P with respect to theta
+				v.TangentU.x = -ringRadius*mSliceSin[j];
+				v.TangentU.y = 0.0f;
+				v.TangentU.z = +ringRadius*mSliceCos[j];
+
+				XMVECTOR T = XMLoadFloat3(&v.TangentU);
+				XMStoreFloat3(&v.TangentU, XMVector3Normalize(T));
+
+				XMVECTOR p = XMLoadFloat3(&v.Position);
+				XMStoreFloat3(&v.Normal, XMVector3Normalize(p));
+
+				v.TexC.x = (j*thetaStep) / XM_2PI;
+				v.TexC.y = phi / XM_PI;
+			}
+		}
+	});
+	meshData.ResizeIndices(sliceCount*6 + (stackCount-2)*sliceCount*6, meshData.Vertices.size());
 
-			XMVECTOR p = XMLoadFloat3(&v.Position);
-			XMStoreFloat3(&v.Normal, XMVector3Normalize(p));
+	WriteIndices(meshData, [&](auto* indices)
+	{
+		uint32 k = 0;
 
-			v.TexC.x = theta / XM_2PI;
-			v.TexC.y = phi / XM_PI;
+		//
+		// Compute indices for top stack.  The top stack was written first to the vertex buffer
+		// and connects the top pole to the first ring.
+		//
 
-			meshData.Vertices.push_back( v );
+		for(uint32 i = 1; i <= sliceCount; ++i)
+		{
+			indices[k++] = 0;
+			indices[k++] = i+1;
+			indices[k++] = i;
 		}
-	}
-
-	meshData.Vertices.push_back( bottomVertex );
-
-	//
-	// Compute indices for top stack.  The top stack was written first to the vertex buffer
-	// and connects the top pole to the first ring.
-	//
 
-    for(uint32 i = 1; i <= sliceCount; ++i)
-	{
-		meshData.Indices16.push_back(0);
-		meshData.Indices16.push_back(i+1);
-		meshData.Indices16.push_back(i);
-	}
-	
-	//
-	// Compute indices for inner stacks (not connected to poles).
-	//
+		//
+		// Compute indices for inner stacks (not connected to poles).
+		//
 
-	// Offset the indices to the index of the first vertex in the first ring.
-	// This is just skipping the top pole vertex.
-    uint32 baseIndex = 1;
-    uint32 ringVertexCount = sliceCount + 1;
-	for(uint32 i = 0; i < stackCount-2; ++i)
-	{
-		for(uint32 j = 0; j < sliceCount; ++j)
+		// Offset the indices to the index of the first vertex in the first ring.
+		// This is just skipping the top pole vertex.
+		uint32 baseIndex = 1;
+		ForEachRow(mScheduler, stackCount-2, sliceCount*6, [&](uint32 begin, uint32 end)
 		{
-			meshData.Indices16.push_back(baseIndex + i*ringVertexCount + j);
-			meshData.Indices16.push_back(baseIndex + i*ringVertexCount + j+1);
-			meshData.Indices16.push_back(baseIndex + (i+1)*ringVertexCount + j);
+			for(uint32 i = begin; i < end; ++i)
+			{
+				uint32 q = k + i*sliceCount*6;
+				for(uint32 j = 0; j < sliceCount; ++j)
+				{
+					indices[q++] = baseIndex + i*ringVertexCount + j;
+					indices[q++] = baseIndex + i*ringVertexCount + j+1;
+					indices[q++] = baseIndex + (i+1)*ringVertexCount + j;
+
+					indices[q++] = baseIndex + (i+1)*ringVertexCount + j;
+					indices[q++] = baseIndex + i*ringVertexCount + j+1;
+					indices[q++] = baseIndex + (i+1)*ringVertexCount + j+1;
+				}
+			}
+		});
+		k += (stackCount-2)*sliceCount*6;
 
-			meshData.Indices16.push_back(baseIndex + (i+1)*ringVertexCount + j);
-			meshData.Indices16.push_back(baseIndex + i*ringVertexCount + j+1);
-			meshData.Indices16.push_back(baseIndex + (i+1)*ringVertexCount + j+1);
-		}
-	}
+		//
+		// Compute indices for bottom stack.  The bottom stack was written last to the vertex buffer
+		// and connects the bottom pole to the bottom ring.
+		//
 
-	//
-	// Compute indices for bottom stack.  The bottom stack was written last to the vertex buffer
-	// and connects the bottom pole to the bottom ring.
-	//
+		// South pole vertex was added last.
+		uint32 southPoleIndex = (uint32)meshData.Vertices.size()-1;
 
-	// South pole vertex was added last.
-	uint32 southPoleIndex = (uint32)meshData.Vertices.size()-1;
+		// Offset the indices to the index of the first vertex in the last ring.
+		baseIndex = southPoleIndex - ringVertexCount;
 
-	// Offset the indices to the index of the first vertex in the last ring.
-	baseIndex = southPoleIndex - ringVertexCount;
-	
-	for(uint32 i = 0; i < sliceCount; ++i)
-	{
-		meshData.Indices16.push_back(southPoleIndex);
-		meshData.Indices16.push_back(baseIndex+i);
-		meshData.Indices16.push_back(baseIndex+i+1);
-	}
+		for(uint32 i = 0; i < sliceCount; ++i)
+		{
+			indices[k++] = southPoleIndex;
+			indices[k++] = baseIndex+i;
+			indices[k++] = baseIndex+i+1;
+		}
+	});
 
     return meshData;
 }
  
 void GeometryGenerator::Subdivide(MeshData& meshData)
 {
-	// Save a copy of the input geometry.
-	MeshData inputCopy = meshData;
-
-
-	meshData.Vertices.resize(0);
-	meshData.Indices16.resize(0);
-
 	//       v1
 	//       *
 	//      / \
@@ -230,48 +293,77 @@ void GeometryGenerator::Subdivide(MeshData& meshData)
 	// *-----*-----*
 	// v0    m2     v2
 
-	uint32 numTris = (uint32)inputCopy.Indices16.size()/3;
-	for(uint32 i = 0; i < numTris; ++i)
+	uint32 numVerts = (uint32)meshData.Vertices.size();
+	uint32 numTris = (uint32)meshData.GetIndexCount()/3;
+
+	// Size the edge table to at most half full for the 3 edges of every triangle.
+	uint32 tableBits = 1;
+	while((1u << tableBits) < numTris*6)
+		++tableBits;
+
+	const std::uint64_t emptyKey = ~0ull;
+	mEdgeKeys.assign(1u << tableBits, emptyKey);
+	mEdgeMidpoints.resize(1u << tableBits);
+	mTriangleMidpoints.resize(numTris*3);
+
+	//
+	// Give every edge one midpoint index, shared by the triangles on both sides.
+	//
+
+	uint32 numEdges = 0;
+	for(uint32 i = 0; i < numTris*3; ++i)
 	{
-		Vertex v0 = inputCopy.Vertices[ inputCopy.Indices16[i*3+0] ];
-		Vertex v1 = inputCopy.Vertices[ inputCopy.Indices16[i*3+1] ];
-		Vertex v2 = inputCopy.Vertices[ inputCopy.Indices16[i*3+2] ];
+		uint32 a = meshData.GetIndex(i);
+		uint32 b = meshData.GetIndex(i % 3 == 2 ? i - 2 : i + 1);
+		std::uint64_t key = (std::uint64_t)std::min(a, b) << 32 | std::max(a, b);
 
-		//
-		// Generate the midpoints.
-		//
+		uint32 slot = (uint32)((key * 0x9E3779B97F4A7C15ull) >> (64 - tableBits));
+		while(mEdgeKeys[slot] != emptyKey && mEdgeKeys[slot] != key)
+			slot = (slot + 1) & ((1u << tableBits) - 1);
 
-        Vertex m0 = MidPoint(v0, v1);
-        Vertex m1 = MidPoint(v1, v2);
-        Vertex m2 = MidPoint(v0, v2);
+		if(mEdgeKeys[slot] == emptyKey)
+		{
+			mEdgeKeys[slot] = key;
+			mEdgeMidpoints[slot] = numVerts + numEdges++;
+		}
 
-		//
-		// Add new geometry.
-		//
+		mTriangleMidpoints[i] = mEdgeMidpoints[slot];
+	}
 
-		meshData.Vertices.push_back(v0); // 0
-		meshData.Vertices.push_back(v1); // 1
-		meshData.Vertices.push_back(v2); // 2
-		meshData.Vertices.push_back(m0); // 3
-		meshData.Vertices.push_back(m1); // 4
-		meshData.Vertices.push_back(m2); // 5
- 
-		meshData.Indices16.push_back(i*6+0);
-		meshData.Indices16.push_back(i*6+3);
-		meshData.Indices16.push_back(i*6+5);
+	//
+	// Add the midpoints after the original vertices.
+	//
+
+	meshData.Vertices.resize(numVerts + numEdges);
+	for(uint32 slot = 0; slot < mEdgeKeys.size(); ++slot)
+	{
+		if(mEdgeKeys[slot] == emptyKey)
+			continue;
 
-		meshData.Indices16.push_back(i*6+3);
-		meshData.Indices16.push_back(i*6+4);
-		meshData.Indices16.push_back(i*6+5);
+		const Vertex& v0 = meshData.Vertices[(uint32)(mEdgeKeys[slot] >> 32)];
+		const Vertex& v1 = meshData.Vertices[(uint32)mEdgeKeys[slot]];
+		meshData.Vertices[mEdgeMidpoints[slot]] = MidPoint(v0, v1);
+	}
 
-		meshData.Indices16.push_back(i*6+5);
-		meshData.Indices16.push_back(i*6+4);
-		meshData.Indices16.push_back(i*6+2);
+	//
+	// Split every triangle in four, in place unless the indices outgrow 16 bits.
+	//
 
-		meshData.Indices16.push_back(i*6+3);
-		meshData.Indices16.push_back(i*6+1);
-		meshData.Indices16.push_back(i*6+4);
+	if(!meshData.Use32BitIndices && MeshData::Needs32BitIndices(meshData.Vertices.size()))
+	{
+		meshData.Indices32.resize(numTris*12);
+		SplitTriangles(meshData.Indices16.data(), meshData.Indices32.data(), mTriangleMidpoints.data(), numTris);
+		meshData.Indices16.clear();
+		meshData.Indices16.shrink_to_fit();
+		meshData.Use32BitIndices = true;
+		return;
 	}
+
+	meshData.ResizeIndices(numTris*12, meshData.Vertices.size());
+	WriteIndices(meshData, [&](auto* indices)
+	{
+		SplitTriangles(indices, indices, mTriangleMidpoints.data(), numTris);
+	});
 }
 
 GeometryGenerator::Vertex GeometryGenerator::MidPoint(const Vertex& v0, const Vertex& v1)
@@ -308,8 +400,8 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGeosphere(float radius, uin
 {
     MeshData meshData;
 
-	// Put a cap on the number of subdivisions.
-    numSubdivisions = std::min<uint32>(numSubdivisions, 6u);
+	// Put a cap on the number of subdivisions, 655362 vertices.
+    numSubdivisions = std::min<uint32>(numSubdivisions, 8u);
 
 	// Approximate a sphere by tessellating an icosahedron.
 
@@ -394,98 +486,129 @@ GeometryGenerator::MeshData GeometryGenerator::CreateCylinder(float bottomRadius
 
 	uint32 ringCount = stackCount+1;
 
-	// Compute vertices for each stack ring starting at the bottom and moving up.
-	for(uint32 i = 0; i < ringCount; ++i)
+	// Add one because we duplicate the first and last vertex per ring
+	// since the texture coordinates are different.
+	uint32 ringVertexCount = sliceCount+1;
+
+	// The caps add a ring and a center vertex each.
+	uint32 numSideVertices = ringCount*ringVertexCount;
+	meshData.Vertices.reserve(numSideVertices + 2*(ringVertexCount+1));
+	meshData.Vertices.resize(numSideVertices);
+
+	float dTheta = 2.0f*XM_PI/sliceCount;
+	BuildSliceTable(sliceCount, dTheta);
+
+	// Cylinder can be parameterized as follows, where we introduce v
+	// parameter that goes in the same direction as the v tex-coord
+	// so that the bitangent goes in the same direction as the v tex-coord.
+	//   Let r0 be the bottom radius and let r1 be the top radius.
+	//   y(v) = h - hv for v in [0,1].
+	//   r(v) = r1 + (r0-r1)v
+	//
+	//   x(t, v) = r(v)*cos(t)
+	//   y(t, v) = h - hv
+	//   z(t, v) = r(v)*sin(t)
+	// 
+	//  dx/dt = -r(v)*sin(t)
+	//  dy/dt = 0
+	//  dz/dt = +r(v)*cos(t)
+	//
+	//  dx/dv = (r0-r1)*cos(t)
+	//  dy/dv = -h
+	//  dz/dv = (r0-r1)*sin(t)
+	//
+	// Neither depends on the ring, so the bottom ring is computed first and
+	// the others copy its tangents and normals.
+	for(uint32 j = 0; j <= sliceCount; ++j)
 	{
-		float y = -0.5f*height + i*stackHeight;
-		float r = bottomRadius + i*radiusStep;
+		Vertex& vertex = meshData.Vertices[j];
 
-		// vertices of ring
-		float dTheta = 2.0f*XM_PI/sliceCount;
-		for(uint32 j = 0; j <= sliceCount; ++j)
+		float c = mSliceCos[j];
+		float s = mSliceSin[j];
+
+		// This is unit length.
+		vertex.TangentU = XMFLOAT3(-s, 0.0f, c);
+
+		float dr = bottomRadius-topRadius;
+		XMFLOAT3 bitangent(dr*c, -height, dr*s);
+
+		XMVECTOR T = XMLoadFloat3(&vertex.TangentU);
+		XMVECTOR B = XMLoadFloat3(&bitangent);
+		XMVECTOR N = XMVector3Normalize(XMVector3Cross(T, B));
+		XMStoreFloat3(&vertex.Normal, N);
+	}
+
+	// Compute vertices for each stack ring starting at the bottom and moving up.
+	ForEachRow(mScheduler, ringCount, ringVertexCount, [&](uint32 begin, uint32 end)
+	{
+		for(uint32 i = begin; i < end; ++i)
 		{
-			Vertex vertex;
-
-			float c = cosf(j*dTheta);
-			float s = sinf(j*dTheta);
-
-			vertex.Position = XMFLOAT3(r*c, y, r*s);
-
-			vertex.TexC.x = (float)j/sliceCount;
-			vertex.TexC.y = 1.0f - (float)i/stackCount;
-
-			// Cylinder can be parameterized as follows, where we introduce v
-			// parameter that goes in the same direction as the v tex-coord
-			// so that the bitangent goes in the same direction as the v tex-coord.
-			//   Let r0 be the bottom radius and let r1 be the top radius.
-			//   y(v) = h - hv for v in [0,1].
-			//   r(v) = r1 + (r0-r1)v
-			//
-			//   x(t, v) = r(v)*cos(t)
-			//   y(t, v) = h - hv
-			//   z(t, v) = r(v)*sin(t)
-			// 
-			//  dx/dt = -r(v)*sin(t)
-			//  dy/dt = 0
-			//  dz/dt = +r(v)*cos(t)
-			//
-			//  dx/dv = (r0-r1)*cos(t)
-			//  dy/dv = -h
-			//  dz/dv = (r0-r1)*sin(t)
-
-			// This is unit length.
-			vertex.TangentU = XMFLOAT3(-s, 0.0f, c);
-
-			float dr = bottomRadius-topRadius;
-			XMFLOAT3 bitangent(dr*c, -height, dr*s);
-
-			XMVECTOR T = XMLoadFloat3(&vertex.TangentU);
-			XMVECTOR B = XMLoadFloat3(&bitangent);
-			XMVECTOR N = XMVector3Normalize(XMVector3Cross(T, B));
-			XMStoreFloat3(&vertex.Normal, N);
-
-			meshData.Vertices.push_back(vertex);
+			float y = -0.5f*height + i*stackHeight;
+			float r = bottomRadius + i*radiusStep;
+
+			// vertices of ring
+			Vertex* ring = &meshData.Vertices[i*ringVertexCount];
+			for(uint32 j = 0; j <= sliceCount; ++j)
+			{
+				Vertex& vertex = ring[j];
+
+				vertex.Position = XMFLOAT3(r*mSliceCos[j], y, r*mSliceSin[j]);
+
+				vertex.TexC.x = (float)j/sliceCount;
+				vertex.TexC.y = 1.0f - (float)i/stackCount;
+
+				if(i != 0)
+				{
+					vertex.TangentU = meshData.Vertices[j].TangentU;
+					vertex.Normal = meshData.Vertices[j].Normal;
+				}
+			}
 		}
-	}
+	});
 
-	// Add one because we duplicate the first and last vertex per ring
-	// since the texture coordinates are different.
-	uint32 ringVertexCount = sliceCount+1;
+	uint32 numSideIndices = stackCount*sliceCount*6;
+	meshData.ResizeIndices(numSideIndices + 2*sliceCount*3, numSideVertices + 2*(ringVertexCount+1));
 
 	// Compute indices for each stack.
-	for(uint32 i = 0; i < stackCount; ++i)
+	WriteIndices(meshData, [&](auto* indices)
 	{
-		for(uint32 j = 0; j < sliceCount; ++j)
+		ForEachRow(mScheduler, stackCount, sliceCount*6, [&](uint32 begin, uint32 end)
 		{
-			meshData.Indices16.push_back(i*ringVertexCount + j);
-			meshData.Indices16.push_back((i+1)*ringVertexCount + j);
-			meshData.Indices16.push_back((i+1)*ringVertexCount + j+1);
-
-			meshData.Indices16.push_back(i*ringVertexCount + j);
-			meshData.Indices16.push_back((i+1)*ringVertexCount + j+1);
-			meshData.Indices16.push_back(i*ringVertexCount + j+1);
-		}
-	}
-
-	BuildCylinderTopCap(bottomRadius, topRadius, height, sliceCount, stackCount, meshData);
-	BuildCylinderBottomCap(bottomRadius, topRadius, height, sliceCount, stackCount, meshData);
+			for(uint32 i = begin; i < end; ++i)
+			{
+				uint32 k = i*sliceCount*6;
+				for(uint32 j = 0; j < sliceCount; ++j)
+				{
+					indices[k++] = i*ringVertexCount + j;
+					indices[k++] = (i+1)*ringVertexCount + j;
+					indices[k++] = (i+1)*ringVertexCount + j+1;
+
+					indices[k++] = i*ringVertexCount + j;
+					indices[k++] = (i+1)*ringVertexCount + j+1;
+					indices[k++] = i*ringVertexCount + j+1;
+				}
+			}
+		});
+	});
+
+	BuildCylinderTopCap(bottomRadius, topRadius, height, sliceCount, stackCount, numSideIndices, meshData);
+	BuildCylinderBottomCap(bottomRadius, topRadius, height, sliceCount, stackCount, numSideIndices + sliceCount*3, meshData);
 
     return meshData;
 }
 
 void GeometryGenerator::BuildCylinderTopCap(float bottomRadius, float topRadius, float height,
-											uint32 sliceCount, uint32 stackCount, MeshData& meshData)
+											uint32 sliceCount, uint32 stackCount, uint32 firstIndex, MeshData& meshData)
 {
 	uint32 baseIndex = (uint32)meshData.Vertices.size();
 
 	float y = 0.5f*height;
-	float dTheta = 2.0f*XM_PI/sliceCount;
 
 	// Duplicate cap ring vertices because the texture coordinates and normals differ.
 	for(uint32 i = 0; i <= sliceCount; ++i)
 	{
-		float x = topRadius*cosf(i*dTheta);
-		float z = topRadius*sinf(i*dTheta);
+		float x = topRadius*mSliceCos[i];
+		float z = topRadius*mSliceSin[i];
 
 		// Scale down by the height to try and make top cap texture coord area
 		// proportional to base.
@@ -501,16 +624,19 @@ void GeometryGenerator::BuildCylinderTopCap(float bottomRadius, float topRadius,
 	// Index of center vertex.
 	uint32 centerIndex = (uint32)meshData.Vertices.size()-1;
 
-	for(uint32 i = 0; i < sliceCount; ++i)
+	WriteIndices(meshData, [&](auto* indices)
 	{
-		meshData.Indices16.push_back(centerIndex);
-		meshData.Indices16.push_back(baseIndex + i+1);
-		meshData.Indices16.push_back(baseIndex + i);
-	}
+		for(uint32 i = 0; i < sliceCount; ++i)
+		{
+			indices[firstIndex + i*3+0] = centerIndex;
+			indices[firstIndex + i*3+1] = baseIndex + i+1;
+			indices[firstIndex + i*3+2] = baseIndex + i;
+		}
+	});
 }
 
 void GeometryGenerator::BuildCylinderBottomCap(float bottomRadius, float topRadius, float height,
-											   uint32 sliceCount, uint32 stackCount, MeshData& meshData)
+											   uint32 sliceCount, uint32 stackCount, uint32 firstIndex, MeshData& meshData)
 {
 	// 
 	// Build bottom cap.
@@ -520,11 +646,10 @@ void GeometryGenerator::BuildCylinderBottomCap(float bottomRadius, float topRadi
 	float y = -0.5f*height;
 
 	// vertices of ring
-	float dTheta = 2.0f*XM_PI/sliceCount;
 	for(uint32 i = 0; i <= sliceCount; ++i)
 	{
-		float x = bottomRadius*cosf(i*dTheta);
-		float z = bottomRadius*sinf(i*dTheta);
+		float x = bottomRadius*mSliceCos[i];
+		float z = bottomRadius*mSliceSin[i];
 
 		// Scale down by the height to try and make top cap texture coord area
 		// proportional to base.
@@ -540,12 +665,15 @@ void GeometryGenerator::BuildCylinderBottomCap(float bottomRadius, float topRadi
 	// Cache the index of center vertex.
 	uint32 centerIndex = (uint32)meshData.Vertices.size()-1;
 
-	for(uint32 i = 0; i < sliceCount; ++i)
+	WriteIndices(meshData, [&](auto* indices)
 	{
-		meshData.Indices16.push_back(centerIndex);
-		meshData.Indices16.push_back(baseIndex + i);
-		meshData.Indices16.push_back(baseIndex + i+1);
-	}
+		for(uint32 i = 0; i < sliceCount; ++i)
+		{
+			indices[firstIndex + i*3+0] = centerIndex;
+			indices[firstIndex + i*3+1] = baseIndex + i;
+			indices[firstIndex + i*3+2] = baseIndex + i+1;
+		}
+	});
 }
 
 GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float depth, uint32 m, uint32 n)
@@ -569,48 +697,74 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float dep
 	float dv = 1.0f / (m-1);
 
 	meshData.Vertices.resize(vertexCount);
-	for(uint32 i = 0; i < m; ++i)
+	ForEachRow(mScheduler, m, n, [&](uint32 begin, uint32 end)
 	{
-		float z = halfDepth - i*dz;
-		for(uint32 j = 0; j < n; ++j)
+		for(uint32 i = begin; i < end; ++i)
 		{
-			float x = -halfWidth + j*dx;
-
-			meshData.Vertices[i*n+j].Position = XMFLOAT3(x, 0.0f, z);
-			meshData.Vertices[i*n+j].Normal   = XMFLOAT3(0.0f, 1.0f, 0.0f);
-			meshData.Vertices[i*n+j].TangentU = XMFLOAT3(1.0f, 0.0f, 0.0f);
-
-			// Stretch texture over grid.
-			meshData.Vertices[i*n+j].TexC.x = j*du;
-			meshData.Vertices[i*n+j].TexC.y = i*dv;
+			float z = halfDepth - i*dz;
+			for(uint32 j = 0; j < n; ++j)
+			{
+				float x = -halfWidth + j*dx;
+
+				meshData.Vertices[i*n+j].Position = XMFLOAT3(x, 0.0f, z);
+				meshData.Vertices[i*n+j].Normal   = XMFLOAT3(0.0f, 1.0f, 0.0f);
+				meshData.Vertices[i*n+j].TangentU = XMFLOAT3(1.0f, 0.0f, 0.0f);
+
+				// Stretch texture over grid.
+				meshData.Vertices[i*n+j].TexC.x = j*du;
+				meshData.Vertices[i*n+j].TexC.y = i*dv;
+			}
 		}
-	}
+	});
  
     //
 	// Create the indices.
 	//
 
-	meshData.Indices16.resize(faceCount*3); // 3 indices per face
+	meshData.ResizeIndices(faceCount*3, vertexCount); // 3 indices per face
 
 	// Iterate over each quad and compute indices.
-	uint32 k = 0;
-	for(uint32 i = 0; i < m-1; ++i)
+	WriteIndices(meshData, [&](auto* indices)
 	{
-		for(uint32 j = 0; j < n-1; ++j)
+		ForEachRow(mScheduler, m-1, (n-1)*6, [&](uint32 begin, uint32 end)
 		{
-			meshData.Indices16[k]   = i*n+j;
-			meshData.Indices16[k+1] = i*n+j+1;
-			meshData.Indices16[k+2] = (i+1)*n+j;
+			for(uint32 i = begin; i < end; ++i)
+			{
+				uint32 k = i*(n-1)*6;
+				for(uint32 j = 0; j < n-1; ++j)
+				{
+					indices[k]   = i*n+j;
+					indices[k+1] = i*n+j+1;
+					indices[k+2] = (i+1)*n+j;
+
+					indices[k+3] = (i+1)*n+j;
+					indices[k+4] = i*n+j+1;
+					indices[k+5] = (i+1)*n+j+1;
+
+					k += 6; // next quad
+				}
+			}
+		});
+	});
 
-			meshData.Indices16[k+3] = (i+1)*n+j;
-			meshData.Indices16[k+4] = i*n+j+1;
-			meshData.Indices16[k+5] = (i+1)*n+j+1;
+    return meshData;
+}
 
-			k += 6; // next quad
-		}
-	}
+void GeometryGenerator::SetTaskScheduler(D3D::TaskScheduler* scheduler)
+{
+    mScheduler = scheduler;
+}
 
-    return meshData;
+void GeometryGenerator::BuildSliceTable(uint32 sliceCount, float dTheta)
+{
+	// Same angles, and so the same values, as evaluating sinf and cosf per vertex.
+	mSliceSin.resize(sliceCount+1);
+	mSliceCos.resize(sliceCount+1);
+	for(uint32 j = 0; j <= sliceCount; ++j)
+	{
+		mSliceSin[j] = sinf(j*dTheta);
+		mSliceCos[j] = cosf(j*dTheta);
+	}
 }
 
 GeometryGenerator::MeshData GeometryGenerator::CreateQuad(float x, float y, float w, float h, float depth)
@@ -15,9 +15,14 @@
 #pragma once
 
 #include <cstdint>
-#include <DirectXMath.h>
+#include "PortableMath.h"
 #include <vector>
 
+namespace D3D
+{
+    class TaskScheduler;
+}
+
 class GeometryGenerator
 {
 public:
@@ -56,22 +61,55 @@ public:
 	struct MeshData
 	{
 		std::vector<Vertex> Vertices;
+
+        // Only one of the two is used: 16 bit indices while they can address every vertex,
+        // 32 bit beyond that. Generators pick the width from their vertex count up front and
+        // write their indices in it directly.
         std::vector<uint16> Indices16;
+        std::vector<uint32> Indices32;
+        bool Use32BitIndices = false;
+
+        static bool Needs32BitIndices(size_t vertexCount)
+        {
+            return vertexCount > 0x10000;
+        }
+
+        // Picks the width for vertexCount vertices, indices already there are kept.
+        void ResizeIndices(size_t indexCount, size_t vertexCount)
+        {
+            if(Needs32BitIndices(vertexCount) && !Use32BitIndices)
+            {
+                Indices32.assign(Indices16.begin(), Indices16.end());
+                Indices16.clear();
+                Indices16.shrink_to_fit();
+                Use32BitIndices = true;
+            }
+
+            if(Use32BitIndices)
+                Indices32.resize(indexCount);
+            else
+                Indices16.resize(indexCount);
+        }
+
+        size_t GetIndexCount() const
+        {
+            return Use32BitIndices ? Indices32.size() : Indices16.size();
+        }
 
-        std::vector<uint32>& GetIndices32()
+        uint32 GetIndexSize() const
         {
-			if(mIndices32.empty())
-			{
-				mIndices32.resize(Indices16.size());
-				for(size_t i = 0; i < Indices16.size(); ++i)
-					mIndices32[i] = static_cast<uint32>(Indices16[i]);
-			}
-
-			return mIndices32;
+            return Use32BitIndices ? sizeof(uint32) : sizeof(uint16);
         }
 
-	private:
-		std::vector<uint32> mIndices32;
+        const void* GetIndexData() const
+        {
+            return Use32BitIndices ? static_cast<const void*>(Indices32.data()) : static_cast<const void*>(Indices16.data());
+        }
+
+        uint32 GetIndex(size_t i) const
+        {
+            return Use32BitIndices ? Indices32[i] : Indices16[i];
+        }
 	};
 
 	///<summary>
@@ -110,10 +148,29 @@ public:
 	///</summary>
     MeshData CreateQuad(float x, float y, float w, float h, float depth);
 
+	///<summary>
+	/// Spreads the rings and rows of CreateSphere, CreateCylinder and CreateGrid over the
+	/// scheduler's threads. The output does not depend on it, null generates serially.
+	///</summary>
+    void SetTaskScheduler(D3D::TaskScheduler* scheduler);
+
 private:
 	void Subdivide(MeshData& meshData);
     Vertex MidPoint(const Vertex& v0, const Vertex& v1);
-    void BuildCylinderTopCap(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, MeshData& meshData);
-    void BuildCylinderBottomCap(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, MeshData& meshData);
+	void BuildSliceTable(uint32 sliceCount, float dTheta);
+    void BuildCylinderTopCap(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, uint32 firstIndex, MeshData& meshData);
+    void BuildCylinderBottomCap(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, uint32 firstIndex, MeshData& meshData);
+
+    // Subdivide scratch, kept so that repeated subdivisions do not allocate. The edge table is
+    // open addressed, keyed by the two vertex indices of an edge.
+    std::vector<std::uint64_t> mEdgeKeys;
+    std::vector<uint32> mEdgeMidpoints;
+    std::vector<uint32> mTriangleMidpoints;
+
+    D3D::TaskScheduler* mScheduler = nullptr;
+
+    // sinf and cosf of every slice angle, shared by all rings of a sphere or cylinder.
+    std::vector<float> mSliceSin;
+    std::vector<float> mSliceCos;
 };
 
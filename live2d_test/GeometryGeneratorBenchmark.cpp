@@ -0,0 +1,92 @@
+#include "GeometryGenerator.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "GeometryGeneratorReference.h"
+#include "TaskScheduler.h"
+#include "TestHarness.h"
+
+// Milliseconds to generate spheres, cylinders and grids of n x n rings or rows: the original
+// one vertex at a time generators, the current ones serially and on a TaskScheduler. Then
+// geospheres of increasing depth, with the original Subdivide that copied the mesh and gave
+// every triangle its own six vertices against the one sharing edge midpoints in place. Last,
+// spheres on both sides of the 16 bit index limit up to 400 x 400, with the index width they
+// were written in and the cost of the 16 to 32 bit conversion pass the renderer used to run.
+int main()
+{
+    D3D::TaskScheduler scheduler;
+    GeometryGenerator serial;
+    GeometryGenerator parallel;
+    parallel.SetTaskScheduler(&scheduler);
+
+    std::printf("%u threads\n", scheduler.GetThreadCount());
+    std::printf("%-9s %6s %10s %12s %10s %10s\n", "shape", "n", "vertices", "original ms", "serial ms", "sched ms");
+
+    const char* shapes[] = { "sphere", "cylinder", "grid" };
+    for (uint32_t shape = 0; shape < 3; shape++)
+    {
+        for (uint32_t n : { 64u, 128u, 256u, 512u, 1024u })
+        {
+            size_t vertex_count = 0;
+            auto generate = [&](GeometryGenerator* generator)
+            {
+                GeometryGenerator::MeshData mesh;
+                if (shape == 0)
+                {
+                    mesh = generator != nullptr ? generator->CreateSphere(1.0f, n, n) : GeometryGeneratorReference::CreateSphere(1.0f, n, n);
+                }
+                else if (shape == 1)
+                {
+                    mesh = generator != nullptr ? generator->CreateCylinder(1.0f, 0.5f, 2.0f, n, n) : GeometryGeneratorReference::CreateCylinder(1.0f, 0.5f, 2.0f, n, n);
+                }
+                else
+                {
+                    mesh = generator != nullptr ? generator->CreateGrid(10.0f, 10.0f, n, n) : GeometryGeneratorReference::CreateGrid(10.0f, 10.0f, n, n);
+                }
+
+                vertex_count = mesh.Vertices.size();
+            };
+
+            uint32_t repeat = (std::max)(4096u / n, 2u);
+            double original_ms = D3D::Test::MeasureMilliseconds(repeat, [&]() { generate(nullptr); });
+            double serial_ms = D3D::Test::MeasureMilliseconds(repeat, [&]() { generate(&serial); });
+            double parallel_ms = D3D::Test::MeasureMilliseconds(repeat, [&]() { generate(&parallel); });
+
+            std::printf("%-9s %6u %10zu %12.3f %10.3f %10.3f\n", shapes[shape], n, vertex_count, original_ms, serial_ms, parallel_ms);
+        }
+    }
+
+    std::printf("\n%-9s %6s %10s %12s %10s %12s\n", "shape", "depth", "vertices", "original ms", "serial ms", "original vtx");
+    for (uint32_t depth = 2; depth <= 6; depth++)
+    {
+        size_t vertex_count = 0;
+        size_t original_vertex_count = 0;
+        uint32_t repeat = 1u << (2 * (7 - depth));
+        double original_ms = D3D::Test::MeasureMilliseconds(repeat, [&]()
+        {
+            original_vertex_count = GeometryGeneratorReference::CreateGeosphere(1.0f, depth).Vertices.size();
+        });
+
+        double serial_ms = D3D::Test::MeasureMilliseconds(repeat, [&]() { vertex_count = serial.CreateGeosphere(1.0f, depth).Vertices.size(); });
+        std::printf("%-9s %6u %10zu %12.3f %10.3f %12zu\n", "geosphere", depth, vertex_count, original_ms, serial_ms, original_vertex_count);
+    }
+
+    std::printf("\n%9s %10s %10s %6s %10s %10s %12s\n", "sphere", "vertices", "indices", "bits", "serial ms", "sched ms", "convert ms");
+    for (uint32_t n : { 255u, 256u, 400u })
+    {
+        GeometryGenerator::MeshData mesh;
+        double serial_ms = D3D::Test::MeasureMilliseconds(10, [&]() { mesh = serial.CreateSphere(1.0f, n, n); });
+        double parallel_ms = D3D::Test::MeasureMilliseconds(10, [&]() { mesh = parallel.CreateSphere(1.0f, n, n); });
+
+        // The same number of 16 bit indices widened one by one into a new buffer.
+        std::vector<uint16_t> indices16(mesh.GetIndexCount());
+        std::vector<uint32_t> indices32;
+        double convert_ms = D3D::Test::MeasureMilliseconds(10, [&]() { indices32.assign(indices16.begin(), indices16.end()); });
+
+        std::printf("%4ux%-4u %10zu %10zu %6u %10.3f %10.3f %12.3f\n", n, n, mesh.Vertices.size(), mesh.GetIndexCount(), mesh.GetIndexSize() * 8, serial_ms, parallel_ms, convert_ms);
+    }
+
+    return 0;
+}
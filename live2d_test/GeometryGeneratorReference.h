@@ -0,0 +1,380 @@
+#pragma once
+
+#include <cmath>
+
+#include "GeometryGenerator.h"
+
+// The sphere, cylinder and grid generators as they were before they were parallelized, and the
+// geosphere with the Subdivide that copied the mesh and rebuilt it with six new vertices per
+// triangle, for the tests to compare against and the benchmarks to time. One vertex and one
+// index at a time with push_back, sinf and cosf per vertex. The indices are written 32 bit so
+// that meshes of more than 65536 vertices stay valid, the originals truncated them.
+namespace GeometryGeneratorReference
+{
+    using Vertex = GeometryGenerator::Vertex;
+    using MeshData = GeometryGenerator::MeshData;
+    using uint32 = GeometryGenerator::uint32;
+
+    inline MeshData CreateSphere(float radius, uint32 sliceCount, uint32 stackCount)
+    {
+        using namespace DirectX;
+
+        MeshData meshData;
+        meshData.Use32BitIndices = true;
+
+        Vertex topVertex(0.0f, +radius, 0.0f, 0.0f, +1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+        Vertex bottomVertex(0.0f, -radius, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+
+        meshData.Vertices.push_back(topVertex);
+
+        float phiStep = XM_PI / stackCount;
+        float thetaStep = 2.0f * XM_PI / sliceCount;
+
+        for (uint32 i = 1; i <= stackCount - 1; ++i)
+        {
+            float phi = i * phiStep;
+            for (uint32 j = 0; j <= sliceCount; ++j)
+            {
+                float theta = j * thetaStep;
+
+                Vertex v;
+                v.Position.x = radius * sinf(phi) * cosf(theta);
+                v.Position.y = radius * cosf(phi);
+                v.Position.z = radius * sinf(phi) * sinf(theta);
+
+                v.TangentU.x = -radius * sinf(phi) * sinf(theta);
+                v.TangentU.y = 0.0f;
+                v.TangentU.z = +radius * sinf(phi) * cosf(theta);
+
+                XMVECTOR T = XMLoadFloat3(&v.TangentU);
+                XMStoreFloat3(&v.TangentU, XMVector3Normalize(T));
+
+                XMVECTOR p = XMLoadFloat3(&v.Position);
+                XMStoreFloat3(&v.Normal, XMVector3Normalize(p));
+
+                v.TexC.x = theta / XM_2PI;
+                v.TexC.y = phi / XM_PI;
+
+                meshData.Vertices.push_back(v);
+            }
+        }
+
+        meshData.Vertices.push_back(bottomVertex);
+
+        for (uint32 i = 1; i <= sliceCount; ++i)
+        {
+            meshData.Indices32.push_back(0);
+            meshData.Indices32.push_back(i + 1);
+            meshData.Indices32.push_back(i);
+        }
+
+        uint32 baseIndex = 1;
+        uint32 ringVertexCount = sliceCount + 1;
+        for (uint32 i = 0; i < stackCount - 2; ++i)
+        {
+            for (uint32 j = 0; j < sliceCount; ++j)
+            {
+                meshData.Indices32.push_back(baseIndex + i * ringVertexCount + j);
+                meshData.Indices32.push_back(baseIndex + i * ringVertexCount + j + 1);
+                meshData.Indices32.push_back(baseIndex + (i + 1) * ringVertexCount + j);
+
+                meshData.Indices32.push_back(baseIndex + (i + 1) * ringVertexCount + j);
+                meshData.Indices32.push_back(baseIndex + i * ringVertexCount + j + 1);
+                meshData.Indices32.push_back(baseIndex + (i + 1) * ringVertexCount + j + 1);
+            }
+        }
+
+        uint32 southPoleIndex = (uint32)meshData.Vertices.size() - 1;
+        baseIndex = southPoleIndex - ringVertexCount;
+        for (uint32 i = 0; i < sliceCount; ++i)
+        {
+            meshData.Indices32.push_back(southPoleIndex);
+            meshData.Indices32.push_back(baseIndex + i);
+            meshData.Indices32.push_back(baseIndex + i + 1);
+        }
+
+        return meshData;
+    }
+
+    inline void BuildCylinderCap(float radius, float height, uint32 sliceCount, bool top, MeshData& meshData)
+    {
+        uint32 baseIndex = (uint32)meshData.Vertices.size();
+        float y = top ? 0.5f * height : -0.5f * height;
+        float ny = top ? 1.0f : -1.0f;
+
+        float dTheta = 2.0f * DirectX::XM_PI / sliceCount;
+        for (uint32 i = 0; i <= sliceCount; ++i)
+        {
+            float x = radius * cosf(i * dTheta);
+            float z = radius * sinf(i * dTheta);
+            float u = x / height + 0.5f;
+            float v = z / height + 0.5f;
+            meshData.Vertices.push_back(Vertex(x, y, z, 0.0f, ny, 0.0f, 1.0f, 0.0f, 0.0f, u, v));
+        }
+
+        meshData.Vertices.push_back(Vertex(0.0f, y, 0.0f, 0.0f, ny, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f));
+
+        uint32 centerIndex = (uint32)meshData.Vertices.size() - 1;
+        for (uint32 i = 0; i < sliceCount; ++i)
+        {
+            meshData.Indices32.push_back(centerIndex);
+            meshData.Indices32.push_back(baseIndex + (top ? i + 1 : i));
+            meshData.Indices32.push_back(baseIndex + (top ? i : i + 1));
+        }
+    }
+
+    inline MeshData CreateCylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount)
+    {
+        using namespace DirectX;
+
+        MeshData meshData;
+        meshData.Use32BitIndices = true;
+
+        float stackHeight = height / stackCount;
+        float radiusStep = (topRadius - bottomRadius) / stackCount;
+
+        uint32 ringCount = stackCount + 1;
+        for (uint32 i = 0; i < ringCount; ++i)
+        {
+            float y = -0.5f * height + i * stackHeight;
+            float r = bottomRadius + i * radiusStep;
+
+            float dTheta = 2.0f * XM_PI / sliceCount;
+            for (uint32 j = 0; j <= sliceCount; ++j)
+            {
+                Vertex vertex;
+
+                float c = cosf(j * dTheta);
+                float s = sinf(j * dTheta);
+
+                vertex.Position = XMFLOAT3(r * c, y, r * s);
+
+                vertex.TexC.x = (float)j / sliceCount;
+                vertex.TexC.y = 1.0f - (float)i / stackCount;
+
+                vertex.TangentU = XMFLOAT3(-s, 0.0f, c);
+
+                float dr = bottomRadius - topRadius;
+                XMFLOAT3 bitangent(dr * c, -height, dr * s);
+
+                XMVECTOR T = XMLoadFloat3(&vertex.TangentU);
+                XMVECTOR B = XMLoadFloat3(&bitangent);
+                XMVECTOR N = XMVector3Normalize(XMVector3Cross(T, B));
+                XMStoreFloat3(&vertex.Normal, N);
+
+                meshData.Vertices.push_back(vertex);
+            }
+        }
+
+        uint32 ringVertexCount = sliceCount + 1;
+        for (uint32 i = 0; i < stackCount; ++i)
+        {
+            for (uint32 j = 0; j < sliceCount; ++j)
+            {
+                meshData.Indices32.push_back(i * ringVertexCount + j);
+                meshData.Indices32.push_back((i + 1) * ringVertexCount + j);
+                meshData.Indices32.push_back((i + 1) * ringVertexCount + j + 1);
+
+                meshData.Indices32.push_back(i * ringVertexCount + j);
+                meshData.Indices32.push_back((i + 1) * ringVertexCount + j + 1);
+                meshData.Indices32.push_back(i * ringVertexCount + j + 1);
+            }
+        }
+
+        BuildCylinderCap(topRadius, height, sliceCount, true, meshData);
+        BuildCylinderCap(bottomRadius, height, sliceCount, false, meshData);
+
+        return meshData;
+    }
+
+    inline MeshData CreateGrid(float width, float depth, uint32 m, uint32 n)
+    {
+        using namespace DirectX;
+
+        MeshData meshData;
+        meshData.Use32BitIndices = true;
+
+        uint32 vertexCount = m * n;
+        uint32 faceCount = (m - 1) * (n - 1) * 2;
+
+        float halfWidth = 0.5f * width;
+        float halfDepth = 0.5f * depth;
+
+        float dx = width / (n - 1);
+        float dz = depth / (m - 1);
+
+        float du = 1.0f / (n - 1);
+        float dv = 1.0f / (m - 1);
+
+        meshData.Vertices.resize(vertexCount);
+        for (uint32 i = 0; i < m; ++i)
+        {
+            float z = halfDepth - i * dz;
+            for (uint32 j = 0; j < n; ++j)
+            {
+                float x = -halfWidth + j * dx;
+
+                meshData.Vertices[i * n + j].Position = XMFLOAT3(x, 0.0f, z);
+                meshData.Vertices[i * n + j].Normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
+                meshData.Vertices[i * n + j].TangentU = XMFLOAT3(1.0f, 0.0f, 0.0f);
+
+                meshData.Vertices[i * n + j].TexC.x = j * du;
+                meshData.Vertices[i * n + j].TexC.y = i * dv;
+            }
+        }
+
+        meshData.Indices32.resize(faceCount * 3);
+
+        uint32 k = 0;
+        for (uint32 i = 0; i < m - 1; ++i)
+        {
+            for (uint32 j = 0; j < n - 1; ++j)
+            {
+                meshData.Indices32[k] = i * n + j;
+                meshData.Indices32[k + 1] = i * n + j + 1;
+                meshData.Indices32[k + 2] = (i + 1) * n + j;
+
+                meshData.Indices32[k + 3] = (i + 1) * n + j;
+                meshData.Indices32[k + 4] = i * n + j + 1;
+                meshData.Indices32[k + 5] = (i + 1) * n + j + 1;
+
+                k += 6;
+            }
+        }
+
+        return meshData;
+    }
+
+    inline Vertex MidPoint(const Vertex& v0, const Vertex& v1)
+    {
+        using namespace DirectX;
+
+        XMVECTOR pos = 0.5f * (XMLoadFloat3(&v0.Position) + XMLoadFloat3(&v1.Position));
+        XMVECTOR normal = XMVector3Normalize(0.5f * (XMLoadFloat3(&v0.Normal) + XMLoadFloat3(&v1.Normal)));
+        XMVECTOR tangent = XMVector3Normalize(0.5f * (XMLoadFloat3(&v0.TangentU) + XMLoadFloat3(&v1.TangentU)));
+        XMVECTOR tex = 0.5f * (XMLoadFloat2(&v0.TexC) + XMLoadFloat2(&v1.TexC));
+
+        Vertex v;
+        XMStoreFloat3(&v.Position, pos);
+        XMStoreFloat3(&v.Normal, normal);
+        XMStoreFloat3(&v.TangentU, tangent);
+        XMStoreFloat2(&v.TexC, tex);
+        return v;
+    }
+
+    // Every triangle becomes four with its own three corners and three midpoints, so edges
+    // shared by two triangles get their midpoint twice and no vertex is shared.
+    inline void Subdivide(MeshData& meshData)
+    {
+        MeshData inputCopy = meshData;
+
+        meshData.Vertices.resize(0);
+        meshData.Indices32.resize(0);
+
+        uint32 numTris = static_cast<uint32>(inputCopy.GetIndexCount()) / 3;
+        for (uint32 i = 0; i < numTris; ++i)
+        {
+            Vertex v0 = inputCopy.Vertices[inputCopy.GetIndex(i * 3 + 0)];
+            Vertex v1 = inputCopy.Vertices[inputCopy.GetIndex(i * 3 + 1)];
+            Vertex v2 = inputCopy.Vertices[inputCopy.GetIndex(i * 3 + 2)];
+
+            Vertex m0 = MidPoint(v0, v1);
+            Vertex m1 = MidPoint(v1, v2);
+            Vertex m2 = MidPoint(v0, v2);
+
+            meshData.Vertices.push_back(v0); // 0
+            meshData.Vertices.push_back(v1); // 1
+            meshData.Vertices.push_back(v2); // 2
+            meshData.Vertices.push_back(m0); // 3
+            meshData.Vertices.push_back(m1); // 4
+            meshData.Vertices.push_back(m2); // 5
+
+            meshData.Indices32.push_back(i * 6 + 0);
+            meshData.Indices32.push_back(i * 6 + 3);
+            meshData.Indices32.push_back(i * 6 + 5);
+
+            meshData.Indices32.push_back(i * 6 + 3);
+            meshData.Indices32.push_back(i * 6 + 4);
+            meshData.Indices32.push_back(i * 6 + 5);
+
+            meshData.Indices32.push_back(i * 6 + 5);
+            meshData.Indices32.push_back(i * 6 + 4);
+            meshData.Indices32.push_back(i * 6 + 2);
+
+            meshData.Indices32.push_back(i * 6 + 3);
+            meshData.Indices32.push_back(i * 6 + 1);
+            meshData.Indices32.push_back(i * 6 + 4);
+        }
+    }
+
+    inline MeshData CreateGeosphere(float radius, uint32 numSubdivisions)
+    {
+        using namespace DirectX;
+
+        MeshData meshData;
+        meshData.Use32BitIndices = true;
+
+        const float X = 0.525731f;
+        const float Z = 0.850651f;
+
+        XMFLOAT3 pos[12] =
+        {
+            XMFLOAT3(-X, 0.0f, Z),  XMFLOAT3(X, 0.0f, Z),
+            XMFLOAT3(-X, 0.0f, -Z), XMFLOAT3(X, 0.0f, -Z),
+            XMFLOAT3(0.0f, Z, X),   XMFLOAT3(0.0f, Z, -X),
+            XMFLOAT3(0.0f, -Z, X),  XMFLOAT3(0.0f, -Z, -X),
+            XMFLOAT3(Z, X, 0.0f),   XMFLOAT3(-Z, X, 0.0f),
+            XMFLOAT3(Z, -X, 0.0f),  XMFLOAT3(-Z, -X, 0.0f)
+        };
+
+        uint32 k[60] =
+        {
+            1,4,0,  4,9,0,  4,5,9,  8,5,4,  1,8,4,
+            1,10,8, 10,3,8, 8,3,5,  3,2,5,  3,7,2,
+            3,10,7, 10,6,7, 6,11,7, 6,0,11, 6,1,0,
+            10,1,6, 11,0,9, 2,11,9, 5,2,9,  11,2,7
+        };
+
+        meshData.Vertices.resize(12);
+        meshData.Indices32.assign(&k[0], &k[60]);
+
+        for (uint32 i = 0; i < 12; ++i)
+        {
+            meshData.Vertices[i].Position = pos[i];
+        }
+
+        for (uint32 i = 0; i < numSubdivisions; ++i)
+        {
+            Subdivide(meshData);
+        }
+
+        for (uint32 i = 0; i < meshData.Vertices.size(); ++i)
+        {
+            XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&meshData.Vertices[i].Position));
+            XMVECTOR p = radius * n;
+
+            XMStoreFloat3(&meshData.Vertices[i].Position, p);
+            XMStoreFloat3(&meshData.Vertices[i].Normal, n);
+
+            float theta = atan2f(meshData.Vertices[i].Position.z, meshData.Vertices[i].Position.x);
+            if (theta < 0.0f)
+            {
+                theta += XM_2PI;
+            }
+
+            float phi = acosf(meshData.Vertices[i].Position.y / radius);
+
+            meshData.Vertices[i].TexC.x = theta / XM_2PI;
+            meshData.Vertices[i].TexC.y = phi / XM_PI;
+
+            meshData.Vertices[i].TangentU.x = -radius * sinf(phi) * sinf(theta);
+            meshData.Vertices[i].TangentU.y = 0.0f;
+            meshData.Vertices[i].TangentU.z = +radius * sinf(phi) * cosf(theta);
+
+            XMVECTOR T = XMLoadFloat3(&meshData.Vertices[i].TangentU);
+            XMStoreFloat3(&meshData.Vertices[i].TangentU, XMVector3Normalize(T));
+        }
+
+        return meshData;
+    }
+}
@@ -0,0 +1,281 @@
+#include "GeometryGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+#include "GeometryGeneratorReference.h"
+#include "TaskScheduler.h"
+#include "TestHarness.h"
+
+namespace
+{
+    // Every edge of a closed mesh is used once in each direction.
+    bool IsClosed(const GeometryGenerator::MeshData& mesh)
+    {
+        std::unordered_map<uint64_t, uint32_t> edge_counts;
+        for (size_t i = 0; i < mesh.GetIndexCount(); i += 3)
+        {
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                uint64_t a = mesh.GetIndex(i + k);
+                uint64_t b = mesh.GetIndex(i + (k + 1) % 3);
+                edge_counts[(a << 32) | b]++;
+            }
+        }
+
+        for (auto& edge : edge_counts)
+        {
+            uint64_t reverse = (edge.first << 32) | (edge.first >> 32);
+            auto find_it = edge_counts.find(reverse);
+            if (edge.second != 1 || find_it == edge_counts.end() || find_it->second != 1)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Truncated indices point at far away vertices, so triangles of a fine mesh get long edges.
+    float GetMaxEdgeLength(const GeometryGenerator::MeshData& mesh)
+    {
+        float max_length = 0.0f;
+        for (size_t i = 0; i < mesh.GetIndexCount(); i += 3)
+        {
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                auto& a = mesh.Vertices[mesh.GetIndex(i + k)].Position;
+                auto& b = mesh.Vertices[mesh.GetIndex(i + (k + 1) % 3)].Position;
+                float dx = a.x - b.x;
+                float dy = a.y - b.y;
+                float dz = a.z - b.z;
+                max_length = (std::max)(max_length, std::sqrt(dx * dx + dy * dy + dz * dz));
+            }
+        }
+
+        return max_length;
+    }
+
+    void CheckIndexWidth(const GeometryGenerator::MeshData& mesh, size_t vertex_count, bool use_32bit_indices, float max_edge_length)
+    {
+        TEST_CHECK(mesh.Vertices.size() == vertex_count);
+        TEST_CHECK(mesh.Use32BitIndices == use_32bit_indices);
+        TEST_CHECK(use_32bit_indices ? mesh.Indices16.empty() : mesh.Indices32.empty());
+        TEST_CHECK(mesh.GetIndexSize() == (use_32bit_indices ? 4u : 2u));
+
+        uint32_t max_index = 0;
+        for (size_t i = 0; i < mesh.GetIndexCount(); i++)
+        {
+            max_index = (std::max)(max_index, mesh.GetIndex(i));
+        }
+
+        TEST_CHECK(max_index == vertex_count - 1);
+        TEST_CHECK(GetMaxEdgeLength(mesh) < max_edge_length);
+    }
+
+    void TestResizeIndices()
+    {
+        // 16 bit indices address up to 65536 vertices.
+        TEST_CHECK(!GeometryGenerator::MeshData::Needs32BitIndices(65535));
+        TEST_CHECK(!GeometryGenerator::MeshData::Needs32BitIndices(65536));
+        TEST_CHECK(GeometryGenerator::MeshData::Needs32BitIndices(65537));
+
+        GeometryGenerator::MeshData mesh;
+        mesh.ResizeIndices(3, 65536);
+        TEST_CHECK(!mesh.Use32BitIndices && mesh.Indices16.size() == 3);
+        mesh.Indices16[0] = 0;
+        mesh.Indices16[1] = 65534;
+        mesh.Indices16[2] = 65535;
+
+        // Widening keeps the indices already written.
+        mesh.ResizeIndices(6, 65537);
+        TEST_CHECK(mesh.Use32BitIndices && mesh.Indices16.empty() && mesh.Indices32.size() == 6);
+        TEST_CHECK(mesh.GetIndex(1) == 65534 && mesh.GetIndex(2) == 65535);
+
+        // Once 32 bit, a mesh stays 32 bit.
+        mesh.ResizeIndices(3, 3);
+        TEST_CHECK(mesh.Use32BitIndices && mesh.Indices32.size() == 3);
+    }
+
+    void TestIndexWidthBoundary()
+    {
+        GeometryGenerator generator;
+
+        // Grids of m x n vertices, cells are 1 / 256 wide.
+        CheckIndexWidth(generator.CreateGrid(1.0f, 1.0f, 255, 257), 65535, false, 0.02f);
+        CheckIndexWidth(generator.CreateGrid(1.0f, 1.0f, 256, 256), 65536, false, 0.02f);
+        CheckIndexWidth(generator.CreateGrid(1.0f, 1.0f, 257, 256), 65792, true, 0.02f);
+
+        // Spheres have 2 + (stacks - 1) * (slices + 1) vertices.
+        CheckIndexWidth(generator.CreateSphere(1.0f, 5040, 14), 65535, false, 0.25f);
+        CheckIndexWidth(generator.CreateSphere(1.0f, 32766, 3), 65536, false, 1.5f);
+        CheckIndexWidth(generator.CreateSphere(1.0f, 256, 256), 65537, true, 0.05f);
+
+        auto cylinder = generator.CreateCylinder(1.0f, 0.5f, 2.0f, 600, 200);
+        CheckIndexWidth(cylinder, cylinder.Vertices.size(), true, 1.1f);
+        TEST_CHECK(cylinder.Vertices.size() > 65536);
+    }
+
+    bool IsBitIdentical(const GeometryGenerator::MeshData& a, const GeometryGenerator::MeshData& b)
+    {
+        return a.Vertices.size() == b.Vertices.size() && a.Use32BitIndices == b.Use32BitIndices && a.GetIndexCount() == b.GetIndexCount() &&
+            ::memcmp(a.Vertices.data(), b.Vertices.data(), a.Vertices.size() * sizeof(GeometryGenerator::Vertex)) == 0 &&
+            ::memcmp(a.GetIndexData(), b.GetIndexData(), a.GetIndexCount() * a.GetIndexSize()) == 0;
+    }
+
+    bool IsNear(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b, float tolerance)
+    {
+        return std::fabs(a.x - b.x) <= tolerance && std::fabs(a.y - b.y) <= tolerance && std::fabs(a.z - b.z) <= tolerance;
+    }
+
+    // The same triangles as the reference, vertices within tolerance of its sinf and cosf per
+    // vertex.
+    bool MatchesReference(const GeometryGenerator::MeshData& mesh, const GeometryGenerator::MeshData& reference, float tolerance)
+    {
+        if (mesh.Vertices.size() != reference.Vertices.size() || mesh.GetIndexCount() != reference.GetIndexCount())
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < mesh.GetIndexCount(); i++)
+        {
+            if (mesh.GetIndex(i) != reference.GetIndex(i))
+            {
+                return false;
+            }
+        }
+
+        for (size_t i = 0; i < mesh.Vertices.size(); i++)
+        {
+            auto& a = mesh.Vertices[i];
+            auto& b = reference.Vertices[i];
+            if (!IsNear(a.Position, b.Position, tolerance) || !IsNear(a.Normal, b.Normal, tolerance) || !IsNear(a.TangentU, b.TangentU, tolerance) ||
+                std::fabs(a.TexC.x - b.TexC.x) > tolerance || std::fabs(a.TexC.y - b.TexC.y) > tolerance)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void TestMatchesReference()
+    {
+        D3D::TaskScheduler scheduler(4);
+        GeometryGenerator serial;
+        GeometryGenerator parallel;
+        parallel.SetTaskScheduler(&scheduler);
+
+        const float tolerance = 1e-5f;
+        const uint32_t resolutions[] = { 3, 8, 33, 100, 257 };
+        for (uint32_t n : resolutions)
+        {
+            auto sphere = GeometryGeneratorReference::CreateSphere(1.5f, n, n / 2 + 2);
+            TEST_CHECK(MatchesReference(serial.CreateSphere(1.5f, n, n / 2 + 2), sphere, tolerance));
+            TEST_CHECK(MatchesReference(parallel.CreateSphere(1.5f, n, n / 2 + 2), sphere, tolerance));
+
+            auto cylinder = GeometryGeneratorReference::CreateCylinder(2.0f, 1.0f, 3.0f, n, n);
+            TEST_CHECK(MatchesReference(serial.CreateCylinder(2.0f, 1.0f, 3.0f, n, n), cylinder, tolerance));
+            TEST_CHECK(MatchesReference(parallel.CreateCylinder(2.0f, 1.0f, 3.0f, n, n), cylinder, tolerance));
+
+            auto grid = GeometryGeneratorReference::CreateGrid(10.0f, 7.0f, n, n + 1);
+            TEST_CHECK(MatchesReference(serial.CreateGrid(10.0f, 7.0f, n, n + 1), grid, tolerance));
+            TEST_CHECK(MatchesReference(parallel.CreateGrid(10.0f, 7.0f, n, n + 1), grid, tolerance));
+        }
+
+        // Past 65536 vertices, where the originals truncated their indices.
+        TEST_CHECK(MatchesReference(parallel.CreateSphere(1.0f, 300, 300), GeometryGeneratorReference::CreateSphere(1.0f, 300, 300), tolerance));
+    }
+
+    void TestParallelMatchesSerial()
+    {
+        // More workers than this machine may have threads, so chunks still interleave.
+        D3D::TaskScheduler scheduler(4);
+        GeometryGenerator serial;
+        GeometryGenerator parallel;
+        parallel.SetTaskScheduler(&scheduler);
+
+        const uint32_t resolutions[] = { 3, 8, 33, 100, 257, 1024 };
+        for (uint32_t n : resolutions)
+        {
+            TEST_CHECK(IsBitIdentical(serial.CreateSphere(1.5f, n, n), parallel.CreateSphere(1.5f, n, n)));
+            TEST_CHECK(IsBitIdentical(serial.CreateSphere(0.5f, n, n / 2 + 2), parallel.CreateSphere(0.5f, n, n / 2 + 2)));
+            TEST_CHECK(IsBitIdentical(serial.CreateCylinder(2.0f, 1.0f, 3.0f, n, n), parallel.CreateCylinder(2.0f, 1.0f, 3.0f, n, n)));
+            TEST_CHECK(IsBitIdentical(serial.CreateGrid(10.0f, 7.0f, n, n + 1), parallel.CreateGrid(10.0f, 7.0f, n, n + 1)));
+        }
+
+        // The shapes that do not run in parallel give the same results with a scheduler set.
+        TEST_CHECK(IsBitIdentical(serial.CreateGeosphere(1.0f, 5), parallel.CreateGeosphere(1.0f, 5)));
+        TEST_CHECK(IsBitIdentical(serial.CreateBox(1.0f, 2.0f, 3.0f, 2), parallel.CreateBox(1.0f, 2.0f, 3.0f, 2)));
+
+        // Repeated runs through the same scheduler stay identical.
+        auto first = parallel.CreateSphere(1.0f, 512, 512);
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            TEST_CHECK(IsBitIdentical(first, parallel.CreateSphere(1.0f, 512, 512)));
+        }
+    }
+
+    void TestGeosphereCounts()
+    {
+        GeometryGenerator generator;
+        for (uint32_t depth = 0; depth <= 8; depth++)
+        {
+            auto mesh = generator.CreateGeosphere(2.0f, depth);
+
+            // Subdividing shares edge midpoints, V - E + F = 2 gives 10 * 4^d + 2 vertices.
+            size_t expected_vertex_count = 10 * (size_t(1) << (2 * depth)) + 2;
+            size_t expected_triangle_count = 20 * (size_t(1) << (2 * depth));
+            TEST_CHECK(mesh.Vertices.size() == expected_vertex_count);
+            TEST_CHECK(mesh.GetIndexCount() == expected_triangle_count * 3);
+            TEST_CHECK(mesh.Use32BitIndices == GeometryGenerator::MeshData::Needs32BitIndices(expected_vertex_count));
+
+            uint32_t max_index = 0;
+            for (size_t i = 0; i < mesh.GetIndexCount(); i++)
+            {
+                max_index = (std::max)(max_index, mesh.GetIndex(i));
+            }
+
+            TEST_CHECK(max_index == expected_vertex_count - 1);
+
+            if (depth <= 5)
+            {
+                TEST_CHECK(IsClosed(mesh));
+            }
+
+            bool on_sphere = true;
+            for (auto& vertex : mesh.Vertices)
+            {
+                auto& p = vertex.Position;
+                on_sphere = on_sphere && std::fabs(std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z) - 2.0f) < 1e-5f;
+            }
+
+            TEST_CHECK(on_sphere);
+        }
+
+        // Depths beyond the cap give the depth 8 mesh.
+        TEST_CHECK(generator.CreateGeosphere(1.0f, 12).Vertices.size() == 10 * (size_t(1) << 16) + 2);
+    }
+
+    void TestSubdividedBox()
+    {
+        // Each face is subdivided on its own, midpoints are shared inside a face only.
+        GeometryGenerator generator;
+        auto mesh = generator.CreateBox(1.0f, 2.0f, 3.0f, 3);
+        TEST_CHECK(mesh.GetIndexCount() == 6 * 2 * 64 * 3);
+        TEST_CHECK(mesh.Vertices.size() == 6 * 81);
+    }
+}
+
+int main()
+{
+    TestResizeIndices();
+    TestIndexWidthBoundary();
+    TestGeosphereCounts();
+    TestSubdividedBox();
+    TestParallelMatchesSerial();
+    TestMatchesReference();
+    return D3D::Test::Finish("GeometryGeneratorTests");
+}
@@ -0,0 +1,80 @@
+#include "InstanceBatcher.h"
+
+namespace D3D
+{
+    uint64_t InstanceBatcher::MakeBatchKey(uint32_t mesh_id, uint32_t material_id)
+    {
+        return (static_cast<uint64_t>(material_id) << 32) | mesh_id;
+    }
+
+    void InstanceBatcher::Clear()
+    {
+        keys_.clear();
+        instance_order_.clear();
+        batches_.clear();
+    }
+
+    void InstanceBatcher::Reserve(uint32_t instance_count)
+    {
+        keys_.reserve(instance_count);
+        instance_order_.reserve(instance_count);
+    }
+
+    void InstanceBatcher::AddInstance(uint32_t mesh_id, uint32_t material_id, uint32_t instance_index)
+    {
+        keys_.push_back(MakeBatchKey(mesh_id, material_id));
+        instance_order_.push_back(instance_index);
+    }
+
+    void InstanceBatcher::Build()
+    {
+        batches_.clear();
+
+        uint32_t count = GetInstanceCount();
+        if (count == 0)
+        {
+            return;
+        }
+
+        sorter_.Sort(keys_.data(), instance_order_.data(), count);
+
+        InstanceBatch batch;
+        batch.mesh_id = static_cast<uint32_t>(keys_[0]);
+        batch.material_id = static_cast<uint32_t>(keys_[0] >> 32);
+        batch.first_instance = 0;
+        batch.instance_count = 1;
+
+        for (uint32_t i = 1; i < count; i++)
+        {
+            if (keys_[i] == keys_[i - 1])
+            {
+                batch.instance_count++;
+                continue;
+            }
+
+            batches_.push_back(batch);
+
+            batch.mesh_id = static_cast<uint32_t>(keys_[i]);
+            batch.material_id = static_cast<uint32_t>(keys_[i] >> 32);
+            batch.first_instance = i;
+            batch.instance_count = 1;
+        }
+
+        batches_.push_back(batch);
+    }
+
+    uint32_t InstanceBatcher::GetInstanceCount() const
+    {
+        return static_cast<uint32_t>(keys_.size());
+    }
+
+    const std::vector<InstanceBatch>& InstanceBatcher::GetBatches() const
+    {
+        return batches_;
+    }
+
+    const std::vector<uint32_t>& InstanceBatcher::GetInstanceOrder() const
+    {
+        return instance_order_;
+    }
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "RadixSort.h"
+
+namespace D3D
+{
+    struct InstanceBatch
+    {
+        uint32_t mesh_id = 0;
+        uint32_t material_id = 0;
+        uint32_t first_instance = 0;        // into GetInstanceOrder() and the instance buffer
+        uint32_t instance_count = 0;
+    };
+
+    // Groups instances that share a mesh and a material into single instanced draws. Instances
+    // are radix sorted by (material, mesh) so material changes stay rare, and instances inside a
+    // batch keep the order they were added in.
+    class InstanceBatcher
+    {
+    public:
+        static uint64_t MakeBatchKey(uint32_t mesh_id, uint32_t material_id);
+
+        void Clear();
+        void Reserve(uint32_t instance_count);
+        void AddInstance(uint32_t mesh_id, uint32_t material_id, uint32_t instance_index);
+
+        void Build();
+
+        uint32_t GetInstanceCount() const;
+        const std::vector<InstanceBatch>& GetBatches() const;
+
+        // Instance indices in draw order, the instance buffer is written in this order.
+        const std::vector<uint32_t>& GetInstanceOrder() const;
+
+    private:
+        std::vector<uint64_t>                               keys_;
+        std::vector<uint32_t>                               instance_order_;
+        std::vector<InstanceBatch>                          batches_;
+        RadixSorter                                         sorter_;
+    };
+};
@@ -0,0 +1,81 @@
+#include "InstanceBatcher.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "TestHarness.h"
+
+using namespace D3D;
+
+namespace
+{
+    uint32_t Next(uint32_t& seed)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return seed >> 8;
+    }
+}
+
+// Milliseconds to batch a frame of instances spread over 64 meshes and 16 materials, added in
+// scene order so that keys are unsorted. Build radix sorts the (material, mesh) keys with their
+// instance indices, the other two columns sort the same pairs with std::stable_sort and
+// std::sort, without grouping them into batches.
+int main()
+{
+    std::printf("%-8s %8s %12s %12s %12s\n", "count", "batches", "Build", "stable_sort", "sort");
+
+    for (uint32_t count : { 10000u, 30000u, 100000u })
+    {
+        uint32_t seed = 9;
+        std::vector<uint32_t> mesh_ids(count), material_ids(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            mesh_ids[i] = Next(seed) % 64;
+            material_ids[i] = Next(seed) % 16;
+        }
+
+        InstanceBatcher batcher;
+        batcher.Reserve(count);
+        double build_ms = D3D::Test::MeasureMilliseconds(20, [&]()
+        {
+            batcher.Clear();
+            for (uint32_t i = 0; i < count; i++)
+            {
+                batcher.AddInstance(mesh_ids[i], material_ids[i], i);
+            }
+
+            batcher.Build();
+        });
+
+        std::vector<std::pair<uint64_t, uint32_t>> pairs(count);
+        auto compare = [](const std::pair<uint64_t, uint32_t>& a, const std::pair<uint64_t, uint32_t>& b)
+        {
+            return a.first < b.first;
+        };
+
+        auto fill = [&]()
+        {
+            for (uint32_t i = 0; i < count; i++)
+            {
+                pairs[i] = std::make_pair(InstanceBatcher::MakeBatchKey(mesh_ids[i], material_ids[i]), i);
+            }
+        };
+
+        double stable_sort_ms = D3D::Test::MeasureMilliseconds(20, [&]()
+        {
+            fill();
+            std::stable_sort(pairs.begin(), pairs.end(), compare);
+        });
+
+        double sort_ms = D3D::Test::MeasureMilliseconds(20, [&]()
+        {
+            fill();
+            std::sort(pairs.begin(), pairs.end(), compare);
+        });
+
+        std::printf("%-8u %8u %12.3f %12.3f %12.3f\n", count, static_cast<uint32_t>(batcher.GetBatches().size()), build_ms, stable_sort_ms, sort_ms);
+    }
+
+    return 0;
+}
@@ -0,0 +1,474 @@
+#include "LightCluster.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#include "SimdMath.h"
+#include "TaskScheduler.h"
+
+namespace D3D
+{
+    namespace
+    {
+        const uint32_t LIGHT_BOUNDS_GRAIN = 256;
+
+        // Padding boxes never overlap anything, so the last group of four tiles needs no special case.
+        const float EMPTY_BOX_MIN = 3.0e38f;
+        const float EMPTY_BOX_MAX = -3.0e38f;
+
+        uint32_t ClampTile(float pixel, uint32_t tile_size, uint32_t tile_count)
+        {
+            float tile = std::floor(pixel / static_cast<float>(tile_size));
+            tile = (std::max)(tile, 0.0f);
+            tile = (std::min)(tile, static_cast<float>(tile_count - 1));
+            return static_cast<uint32_t>(tile);
+        }
+    }
+
+    void LightClusterBuilder::Initialize(const LightClusterConfig& config)
+    {
+        assert(config.tile_count_x > 0 && config.tile_count_y > 0 && config.slice_count > 0);
+
+        config_ = config;
+        row_stride_ = (config_.tile_count_x + 3) & ~3u;
+        bounds_valid_ = false;
+
+        uint32_t box_count = row_stride_ * config_.tile_count_y * config_.slice_count;
+        box_min_x_.assign(box_count, EMPTY_BOX_MIN);
+        box_max_x_.assign(box_count, EMPTY_BOX_MAX);
+        box_min_y_.assign(box_count, EMPTY_BOX_MIN);
+        box_max_y_.assign(box_count, EMPTY_BOX_MAX);
+        slice_min_z_.assign(config_.slice_count, 0.0f);
+        slice_max_z_.assign(config_.slice_count, 0.0f);
+
+        slice_scratch_.assign(config_.slice_count, SliceScratch());
+        cluster_ranges_.assign(GetClusterCount(), LightClusterRange());
+        light_indices_.clear();
+    }
+
+    void LightClusterBuilder::Build(const LightClusterView& view, const float* pos_x, const float* pos_y, const float* pos_z, const float* radius, uint32_t light_count, TaskScheduler* scheduler)
+    {
+        UpdateClusterBounds(view);
+        ::memcpy(view_.view, view.view, sizeof(view_.view));
+
+        view_x_.resize(light_count);
+        view_y_.resize(light_count);
+        view_z_.resize(light_count);
+        light_bounds_.resize(light_count);
+        light_visible_.resize(light_count);
+
+        auto bounds_func = [&](uint32_t begin, uint32_t end)
+        {
+            ComputeLightBounds(begin, end, pos_x, pos_y, pos_z, radius);
+        };
+
+        // Chunks are kept multiples of four so every SIMD group stays inside one chunk.
+        uint32_t group_count = (light_count + 3) / 4;
+        auto group_func = [&](uint32_t begin, uint32_t end)
+        {
+            bounds_func(begin * 4, (std::min)(end * 4, light_count));
+        };
+
+        if (scheduler != nullptr)
+        {
+            scheduler->ParallelFor(group_count, LIGHT_BOUNDS_GRAIN / 4, group_func);
+        }
+        else
+        {
+            group_func(0, group_count);
+        }
+
+        // Bucket the visible lights by depth slice, in ascending light order.
+        uint32_t slice_count = config_.slice_count;
+        slice_light_offsets_.assign(slice_count + 1, 0);
+        for (uint32_t i = 0; i < light_count; i++)
+        {
+            if (light_visible_[i])
+            {
+                for (uint32_t s = light_bounds_[i].slice_min; s <= light_bounds_[i].slice_max; s++)
+                {
+                    slice_light_offsets_[s + 1]++;
+                }
+            }
+        }
+
+        for (uint32_t s = 0; s < slice_count; s++)
+        {
+            slice_light_offsets_[s + 1] += slice_light_offsets_[s];
+        }
+
+        slice_lights_.resize(slice_light_offsets_[slice_count]);
+        std::vector<uint32_t> slice_cursors(slice_light_offsets_.begin(), slice_light_offsets_.end() - 1);
+        for (uint32_t i = 0; i < light_count; i++)
+        {
+            if (light_visible_[i])
+            {
+                for (uint32_t s = light_bounds_[i].slice_min; s <= light_bounds_[i].slice_max; s++)
+                {
+                    slice_lights_[slice_cursors[s]++] = i;
+                }
+            }
+        }
+
+        auto fill_func = [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t s = begin; s < end; s++)
+            {
+                FillSlice(s, radius);
+            }
+        };
+
+        if (scheduler != nullptr)
+        {
+            scheduler->ParallelFor(slice_count, 1, fill_func);
+        }
+        else
+        {
+            fill_func(0, slice_count);
+        }
+
+        // Every slice wrote slice local offsets, rebase them onto the shared index list.
+        std::vector<uint32_t> slice_offsets(slice_count + 1, 0);
+        for (uint32_t s = 0; s < slice_count; s++)
+        {
+            slice_offsets[s + 1] = slice_offsets[s] + static_cast<uint32_t>(slice_scratch_[s].indices.size());
+        }
+
+        light_indices_.resize(slice_offsets[slice_count]);
+
+        uint32_t clusters_per_slice = config_.tile_count_x * config_.tile_count_y;
+        auto merge_func = [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t s = begin; s < end; s++)
+            {
+                auto& scratch = slice_scratch_[s];
+                if (!scratch.indices.empty())
+                {
+                    ::memcpy(light_indices_.data() + slice_offsets[s], scratch.indices.data(), scratch.indices.size() * sizeof(uint32_t));
+                }
+
+                LightClusterRange* ranges = cluster_ranges_.data() + s * clusters_per_slice;
+                for (uint32_t c = 0; c < clusters_per_slice; c++)
+                {
+                    ranges[c].offset += slice_offsets[s];
+                }
+            }
+        };
+
+        if (scheduler != nullptr)
+        {
+            scheduler->ParallelFor(slice_count, 1, merge_func);
+        }
+        else
+        {
+            merge_func(0, slice_count);
+        }
+    }
+
+    const LightClusterConfig& LightClusterBuilder::GetConfig() const
+    {
+        return config_;
+    }
+
+    uint32_t LightClusterBuilder::GetClusterCount() const
+    {
+        return config_.tile_count_x * config_.tile_count_y * config_.slice_count;
+    }
+
+    uint32_t LightClusterBuilder::GetClusterIndex(uint32_t tile_x, uint32_t tile_y, uint32_t slice) const
+    {
+        return (slice * config_.tile_count_y + tile_y) * config_.tile_count_x + tile_x;
+    }
+
+    uint32_t LightClusterBuilder::GetTileSizeX() const
+    {
+        return tile_size_x_;
+    }
+
+    uint32_t LightClusterBuilder::GetTileSizeY() const
+    {
+        return tile_size_y_;
+    }
+
+    float LightClusterBuilder::GetSliceScale() const
+    {
+        return slice_scale_;
+    }
+
+    float LightClusterBuilder::GetSliceBias() const
+    {
+        return slice_bias_;
+    }
+
+    const std::vector<LightClusterRange>& LightClusterBuilder::GetClusterRanges() const
+    {
+        return cluster_ranges_;
+    }
+
+    const std::vector<uint32_t>& LightClusterBuilder::GetLightIndices() const
+    {
+        return light_indices_;
+    }
+
+    void LightClusterBuilder::UpdateClusterBounds(const LightClusterView& view)
+    {
+        if (bounds_valid_
+            && view.proj_scale_x == view_.proj_scale_x
+            && view.proj_scale_y == view_.proj_scale_y
+            && view.near_z == view_.near_z
+            && view.far_z == view_.far_z
+            && view.screen_width == view_.screen_width
+            && view.screen_height == view_.screen_height)
+        {
+            return;
+        }
+
+        assert(view.near_z > 0.0f && view.far_z > view.near_z);
+
+        view_ = view;
+        bounds_valid_ = true;
+
+        uint32_t tile_count_x = config_.tile_count_x;
+        uint32_t tile_count_y = config_.tile_count_y;
+        uint32_t slice_count = config_.slice_count;
+
+        tile_size_x_ = (std::max)((view.screen_width + tile_count_x - 1) / tile_count_x, 1u);
+        tile_size_y_ = (std::max)((view.screen_height + tile_count_y - 1) / tile_count_y, 1u);
+
+        float log_depth_range = std::log(view.far_z / view.near_z);
+        slice_scale_ = slice_count / log_depth_range;
+        slice_bias_ = -(slice_count * std::log(view.near_z)) / log_depth_range;
+
+        for (uint32_t s = 0; s < slice_count; s++)
+        {
+            slice_min_z_[s] = view.near_z * std::pow(view.far_z / view.near_z, static_cast<float>(s) / slice_count);
+            slice_max_z_[s] = view.near_z * std::pow(view.far_z / view.near_z, static_cast<float>(s + 1) / slice_count);
+        }
+
+        float ndc_tile_x = 2.0f * tile_size_x_ / view.screen_width;
+        float ndc_tile_y = 2.0f * tile_size_y_ / view.screen_height;
+
+        // view x = ndc x * z / proj._11, the box has to cover both ends of the depth slice.
+        for (uint32_t s = 0; s < slice_count; s++)
+        {
+            float z0 = slice_min_z_[s];
+            float z1 = slice_max_z_[s];
+
+            for (uint32_t y = 0; y < tile_count_y; y++)
+            {
+                float ndc_top = 1.0f - ndc_tile_y * y;
+                float ndc_bottom = ndc_top - ndc_tile_y;
+                uint32_t row = (s * tile_count_y + y) * row_stride_;
+
+                for (uint32_t x = 0; x < tile_count_x; x++)
+                {
+                    float ndc_left = -1.0f + ndc_tile_x * x;
+                    float ndc_right = ndc_left + ndc_tile_x;
+
+                    box_min_x_[row + x] = (std::min)(ndc_left * z0, ndc_left * z1) / view.proj_scale_x;
+                    box_max_x_[row + x] = (std::max)(ndc_right * z0, ndc_right * z1) / view.proj_scale_x;
+                    box_min_y_[row + x] = (std::min)(ndc_bottom * z0, ndc_bottom * z1) / view.proj_scale_y;
+                    box_max_y_[row + x] = (std::max)(ndc_top * z0, ndc_top * z1) / view.proj_scale_y;
+                }
+            }
+        }
+    }
+
+    void LightClusterBuilder::ComputeLightBounds(uint32_t begin, uint32_t end, const float* pos_x, const float* pos_y, const float* pos_z, const float* radius)
+    {
+        const float* m = view_.view;
+        Simd::Float4 m00 = Simd::Set1(m[0]), m01 = Simd::Set1(m[1]), m02 = Simd::Set1(m[2]);
+        Simd::Float4 m10 = Simd::Set1(m[4]), m11 = Simd::Set1(m[5]), m12 = Simd::Set1(m[6]);
+        Simd::Float4 m20 = Simd::Set1(m[8]), m21 = Simd::Set1(m[9]), m22 = Simd::Set1(m[10]);
+        Simd::Float4 m30 = Simd::Set1(m[12]), m31 = Simd::Set1(m[13]), m32 = Simd::Set1(m[14]);
+
+        Simd::Float4 zero = Simd::Zero();
+        Simd::Float4 one = Simd::Set1(1.0f);
+        Simd::Float4 minus_one = Simd::Set1(-1.0f);
+        Simd::Float4 near_z = Simd::Set1(view_.near_z);
+        Simd::Float4 far_z = Simd::Set1(view_.far_z);
+        Simd::Float4 scale_x = Simd::Set1(view_.proj_scale_x);
+        Simd::Float4 scale_y = Simd::Set1(view_.proj_scale_y);
+
+        float half_width = 0.5f * view_.screen_width;
+        float half_height = 0.5f * view_.screen_height;
+        uint32_t last_slice = config_.slice_count - 1;
+
+        for (uint32_t i = begin; i < end; i += 4)
+        {
+            uint32_t lane_count = (std::min)(end - i, 4u);
+
+            float in_x[4] = {}, in_y[4] = {}, in_z[4] = {}, in_r[4] = {};
+            for (uint32_t lane = 0; lane < lane_count; lane++)
+            {
+                in_x[lane] = pos_x[i + lane];
+                in_y[lane] = pos_y[i + lane];
+                in_z[lane] = pos_z[i + lane];
+                in_r[lane] = radius[i + lane];
+            }
+
+            Simd::Float4 px = Simd::Load(in_x);
+            Simd::Float4 py = Simd::Load(in_y);
+            Simd::Float4 pz = Simd::Load(in_z);
+            Simd::Float4 r = Simd::Load(in_r);
+
+            Simd::Float4 vx = Simd::MulAdd(px, m00, Simd::MulAdd(py, m10, Simd::MulAdd(pz, m20, m30)));
+            Simd::Float4 vy = Simd::MulAdd(px, m01, Simd::MulAdd(py, m11, Simd::MulAdd(pz, m21, m31)));
+            Simd::Float4 vz = Simd::MulAdd(px, m02, Simd::MulAdd(py, m12, Simd::MulAdd(pz, m22, m32)));
+
+            Simd::Float4 z_min = Simd::Sub(vz, r);
+            Simd::Float4 z_max = Simd::Add(vz, r);
+            Simd::Float4 visible = Simd::And(Simd::CmpGe(z_max, near_z), Simd::CmpLe(z_min, far_z));
+            z_min = Simd::Max(z_min, near_z);
+            z_max = Simd::Min(z_max, far_z);
+
+            // The sphere's box projects to its extremes at the near or far end, depending on the side.
+            Simd::Float4 lo_x = Simd::Mul(Simd::Sub(vx, r), scale_x);
+            Simd::Float4 hi_x = Simd::Mul(Simd::Add(vx, r), scale_x);
+            Simd::Float4 lo_y = Simd::Mul(Simd::Sub(vy, r), scale_y);
+            Simd::Float4 hi_y = Simd::Mul(Simd::Add(vy, r), scale_y);
+
+            Simd::Float4 ndc_min_x = Simd::Div(lo_x, Simd::Select(Simd::CmpGe(lo_x, zero), z_max, z_min));
+            Simd::Float4 ndc_max_x = Simd::Div(hi_x, Simd::Select(Simd::CmpGe(hi_x, zero), z_min, z_max));
+            Simd::Float4 ndc_min_y = Simd::Div(lo_y, Simd::Select(Simd::CmpGe(lo_y, zero), z_max, z_min));
+            Simd::Float4 ndc_max_y = Simd::Div(hi_y, Simd::Select(Simd::CmpGe(hi_y, zero), z_min, z_max));
+
+            visible = Simd::And(visible, Simd::And(Simd::CmpGe(ndc_max_x, minus_one), Simd::CmpLe(ndc_min_x, one)));
+            visible = Simd::And(visible, Simd::And(Simd::CmpGe(ndc_max_y, minus_one), Simd::CmpLe(ndc_min_y, one)));
+
+            float out_vx[4], out_vy[4], out_vz[4], out_z_min[4], out_z_max[4];
+            float out_min_x[4], out_max_x[4], out_min_y[4], out_max_y[4];
+            Simd::Store(out_vx, vx);
+            Simd::Store(out_vy, vy);
+            Simd::Store(out_vz, vz);
+            Simd::Store(out_z_min, z_min);
+            Simd::Store(out_z_max, z_max);
+            Simd::Store(out_min_x, ndc_min_x);
+            Simd::Store(out_max_x, ndc_max_x);
+            Simd::Store(out_min_y, ndc_min_y);
+            Simd::Store(out_max_y, ndc_max_y);
+            uint32_t visible_mask = Simd::MoveMask(visible);
+
+            for (uint32_t lane = 0; lane < lane_count; lane++)
+            {
+                uint32_t light = i + lane;
+                view_x_[light] = out_vx[lane];
+                view_y_[light] = out_vy[lane];
+                view_z_[light] = out_vz[lane];
+                light_visible_[light] = (visible_mask >> lane) & 1;
+                if (!light_visible_[light])
+                {
+                    continue;
+                }
+
+                auto& bounds = light_bounds_[light];
+                bounds.tile_min_x = ClampTile((out_min_x[lane] + 1.0f) * half_width, tile_size_x_, config_.tile_count_x);
+                bounds.tile_max_x = ClampTile((out_max_x[lane] + 1.0f) * half_width, tile_size_x_, config_.tile_count_x);
+                bounds.tile_min_y = ClampTile((1.0f - out_max_y[lane]) * half_height, tile_size_y_, config_.tile_count_y);
+                bounds.tile_max_y = ClampTile((1.0f - out_min_y[lane]) * half_height, tile_size_y_, config_.tile_count_y);
+
+                // One extra slice on each side absorbs rounding at slice borders, the box test rejects it if unneeded.
+                float slice_min = std::floor(std::log(out_z_min[lane]) * slice_scale_ + slice_bias_) - 1.0f;
+                float slice_max = std::floor(std::log(out_z_max[lane]) * slice_scale_ + slice_bias_) + 1.0f;
+                bounds.slice_min = static_cast<uint32_t>((std::min)((std::max)(slice_min, 0.0f), static_cast<float>(last_slice)));
+                bounds.slice_max = static_cast<uint32_t>((std::min)((std::max)(slice_max, 0.0f), static_cast<float>(last_slice)));
+            }
+        }
+    }
+
+    void LightClusterBuilder::FillSlice(uint32_t slice, const float* radius)
+    {
+        auto& scratch = slice_scratch_[slice];
+        scratch.pair_cluster.clear();
+        scratch.pair_light.clear();
+
+        uint32_t tile_count_x = config_.tile_count_x;
+        uint32_t tile_count_y = config_.tile_count_y;
+        float z0 = slice_min_z_[slice];
+        float z1 = slice_max_z_[slice];
+        Simd::Float4 zero = Simd::Zero();
+
+        for (uint32_t l = slice_light_offsets_[slice]; l < slice_light_offsets_[slice + 1]; l++)
+        {
+            uint32_t light = slice_lights_[l];
+            auto& bounds = light_bounds_[light];
+
+            float cz = view_z_[light];
+            float dz = (std::max)((std::max)(z0 - cz, 0.0f), cz - z1);
+            float r2 = radius[light] * radius[light];
+            float remain = r2 - dz * dz;
+            if (remain < 0.0f)
+            {
+                continue;
+            }
+
+            Simd::Float4 cx = Simd::Set1(view_x_[light]);
+            Simd::Float4 cy = Simd::Set1(view_y_[light]);
+            Simd::Float4 remain4 = Simd::Set1(remain);
+
+            uint32_t first_x = bounds.tile_min_x & ~3u;
+            for (uint32_t y = bounds.tile_min_y; y <= bounds.tile_max_y; y++)
+            {
+                uint32_t row = (slice * tile_count_y + y) * row_stride_;
+                for (uint32_t x = first_x; x <= bounds.tile_max_x; x += 4)
+                {
+                    Simd::Float4 dx = Simd::Max(Simd::Max(Simd::Sub(Simd::Load(&box_min_x_[row + x]), cx), zero), Simd::Sub(cx, Simd::Load(&box_max_x_[row + x])));
+                    Simd::Float4 dy = Simd::Max(Simd::Max(Simd::Sub(Simd::Load(&box_min_y_[row + x]), cy), zero), Simd::Sub(cy, Simd::Load(&box_max_y_[row + x])));
+                    Simd::Float4 dist2 = Simd::MulAdd(dx, dx, Simd::Mul(dy, dy));
+                    uint32_t hit_mask = Simd::MoveMask(Simd::CmpLe(dist2, remain4));
+
+                    while (hit_mask != 0)
+                    {
+                        uint32_t lane{ 0 };
+                        while (((hit_mask >> lane) & 1) == 0)
+                        {
+                            lane++;
+                        }
+
+                        hit_mask &= hit_mask - 1;
+
+                        uint32_t tile_x = x + lane;
+                        if (tile_x < bounds.tile_min_x || tile_x > bounds.tile_max_x)
+                        {
+                            continue;
+                        }
+
+                        scratch.pair_cluster.push_back(y * tile_count_x + tile_x);
+                        scratch.pair_light.push_back(light);
+                    }
+                }
+            }
+        }
+
+        // Counting sort of the (cluster, light) pairs keeps each cluster's lights in ascending order.
+        uint32_t clusters_per_slice = tile_count_x * tile_count_y;
+        uint32_t max_lights = config_.max_lights_per_cluster;
+        scratch.cluster_counts.assign(clusters_per_slice, 0);
+        for (auto cluster : scratch.pair_cluster)
+        {
+            scratch.cluster_counts[cluster]++;
+        }
+
+        LightClusterRange* ranges = cluster_ranges_.data() + slice * clusters_per_slice;
+        uint32_t offset{ 0 };
+        for (uint32_t c = 0; c < clusters_per_slice; c++)
+        {
+            ranges[c].offset = offset;
+            ranges[c].count = 0;
+            offset += (std::min)(scratch.cluster_counts[c], max_lights);
+        }
+
+        scratch.indices.resize(offset);
+        for (size_t p = 0; p < scratch.pair_cluster.size(); p++)
+        {
+            auto& range = ranges[scratch.pair_cluster[p]];
+            if (range.count < max_lights)
+            {
+                scratch.indices[range.offset + range.count] = scratch.pair_light[p];
+                range.count++;
+            }
+        }
+    }
+};
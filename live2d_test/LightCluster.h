@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace D3D
+{
+    class TaskScheduler;
+
+    struct LightClusterConfig
+    {
+        uint32_t tile_count_x = 16;
+        uint32_t tile_count_y = 9;
+        uint32_t slice_count = 24;
+        uint32_t max_lights_per_cluster = 128;     // bounds the per pixel light loop
+    };
+
+    // Camera data the clusters are built from. view is row major with row vectors
+    // (p_view = p_world * view), as stored by XMStoreFloat4x4.
+    struct LightClusterView
+    {
+        float view[16] = {};
+        float proj_scale_x = 1.0f;                  // proj._11
+        float proj_scale_y = 1.0f;                  // proj._22
+        float near_z = 1.0f;
+        float far_z = 1000.0f;
+        uint32_t screen_width = 1;
+        uint32_t screen_height = 1;
+    };
+
+    struct LightClusterRange
+    {
+        uint32_t offset = 0;
+        uint32_t count = 0;
+    };
+
+    // Assigns point lights to a froxel grid: screen tiles by exponential depth slices.
+    // Lights are bounded on screen four at a time, then every depth slice is filled on its own
+    // thread by testing the light spheres against the view space boxes of its clusters. The
+    // result is a per cluster (offset, count) table into one light index list, in ascending
+    // light order whatever the thread count.
+    class LightClusterBuilder
+    {
+    public:
+        void Initialize(const LightClusterConfig& config);
+
+        // Light positions in world space and influence radii, one array per component.
+        void Build(const LightClusterView& view, const float* pos_x, const float* pos_y, const float* pos_z, const float* radius, uint32_t light_count, TaskScheduler* scheduler = nullptr);
+
+        const LightClusterConfig& GetConfig() const;
+        uint32_t GetClusterCount() const;
+        uint32_t GetClusterIndex(uint32_t tile_x, uint32_t tile_y, uint32_t slice) const;
+        uint32_t GetTileSizeX() const;
+        uint32_t GetTileSizeY() const;
+
+        // slice = log(view_z) * scale + bias
+        float GetSliceScale() const;
+        float GetSliceBias() const;
+
+        const std::vector<LightClusterRange>& GetClusterRanges() const;
+        const std::vector<uint32_t>& GetLightIndices() const;
+
+    private:
+        struct LightBounds
+        {
+            uint32_t tile_min_x = 0;
+            uint32_t tile_max_x = 0;
+            uint32_t tile_min_y = 0;
+            uint32_t tile_max_y = 0;
+            uint32_t slice_min = 0;
+            uint32_t slice_max = 0;
+        };
+
+        struct SliceScratch
+        {
+            std::vector<uint32_t> pair_cluster;
+            std::vector<uint32_t> pair_light;
+            std::vector<uint32_t> cluster_counts;
+            std::vector<uint32_t> indices;
+        };
+
+        void UpdateClusterBounds(const LightClusterView& view);
+        void ComputeLightBounds(uint32_t begin, uint32_t end, const float* pos_x, const float* pos_y, const float* pos_z, const float* radius);
+        void FillSlice(uint32_t slice, const float* radius);
+
+        LightClusterConfig                                  config_;
+        LightClusterView                                    view_;
+        uint32_t                                            tile_size_x_ = 1;
+        uint32_t                                            tile_size_y_ = 1;
+        uint32_t                                            row_stride_ = 0;
+        float                                               slice_scale_ = 0.0f;
+        float                                               slice_bias_ = 0.0f;
+        bool                                                bounds_valid_ = false;
+
+        // View space cluster boxes, x/y per cluster with tile rows padded to a multiple of four, z per slice.
+        std::vector<float>                                  box_min_x_;
+        std::vector<float>                                  box_max_x_;
+        std::vector<float>                                  box_min_y_;
+        std::vector<float>                                  box_max_y_;
+        std::vector<float>                                  slice_min_z_;
+        std::vector<float>                                  slice_max_z_;
+
+        std::vector<float>                                  view_x_;
+        std::vector<float>                                  view_y_;
+        std::vector<float>                                  view_z_;
+        std::vector<LightBounds>                            light_bounds_;
+        std::vector<uint8_t>                                light_visible_;
+        std::vector<uint32_t>                               slice_light_offsets_;
+        std::vector<uint32_t>                               slice_lights_;
+        std::vector<SliceScratch>                           slice_scratch_;
+
+        std::vector<LightClusterRange>                      cluster_ranges_;
+        std::vector<uint32_t>                               light_indices_;
+    };
+};
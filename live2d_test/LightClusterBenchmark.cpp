@@ -0,0 +1,89 @@
+#include "LightCluster.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "PortableMath.h"
+#include "TaskScheduler.h"
+#include "TestHarness.h"
+
+using namespace D3D;
+using namespace DirectX;
+
+namespace
+{
+    float Random(uint32_t& seed)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / 16777216.0f;
+    }
+}
+
+// Milliseconds per Build of the default 16 x 9 x 24 cluster grid at 1080p, over light counts
+// and thread counts. Worker count 0 builds without a scheduler.
+int main()
+{
+    LightClusterView view;
+    XMFLOAT4X4 view_matrix;
+    XMStoreFloat4x4(&view_matrix, XMMatrixLookAtLH(XMVectorSet(0.0f, 5.0f, -20.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 50.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+    std::copy(&view_matrix._11, &view_matrix._11 + 16, view.view);
+
+    XMFLOAT4X4 proj;
+    XMStoreFloat4x4(&proj, XMMatrixPerspectiveFovLH(0.9f, 16.0f / 9.0f, 0.5f, 200.0f));
+    view.proj_scale_x = proj._11;
+    view.proj_scale_y = proj._22;
+    view.near_z = 0.5f;
+    view.far_z = 200.0f;
+    view.screen_width = 1920;
+    view.screen_height = 1080;
+
+    const uint32_t worker_counts[] = { 0, 1, 2, 4, 8 };
+    std::printf("%-8s %12s", "lights", "lights/cl");
+    for (uint32_t worker_count : worker_counts)
+    {
+        std::printf(" %8u w", worker_count);
+    }
+
+    std::printf("\n");
+
+    for (uint32_t light_count : { 256u, 1024u, 4096u, 16384u, 65536u })
+    {
+        uint32_t seed = 17;
+        std::vector<float> x(light_count), y(light_count), z(light_count), radius(light_count);
+        for (uint32_t i = 0; i < light_count; i++)
+        {
+            x[i] = Random(seed) * 300.0f - 150.0f;
+            y[i] = Random(seed) * 40.0f - 10.0f;
+            z[i] = Random(seed) * 220.0f - 20.0f;
+            radius[i] = 0.5f + Random(seed) * Random(seed) * 8.0f;
+        }
+
+        LightClusterBuilder builder;
+        builder.Initialize(LightClusterConfig());
+        builder.Build(view, x.data(), y.data(), z.data(), radius.data(), light_count);
+        std::printf("%-8u %12.2f", light_count, static_cast<double>(builder.GetLightIndices().size()) / builder.GetClusterCount());
+
+        uint32_t repeat = (std::max)(200000u / light_count, 5u);
+        for (uint32_t worker_count : worker_counts)
+        {
+            std::unique_ptr<TaskScheduler> scheduler;
+            if (worker_count > 0)
+            {
+                scheduler.reset(new TaskScheduler(worker_count));
+            }
+
+            double ms = D3D::Test::MeasureMilliseconds(repeat, [&]()
+            {
+                builder.Build(view, x.data(), y.data(), z.data(), radius.data(), light_count, scheduler.get());
+            });
+
+            std::printf(" %10.3f", ms);
+        }
+
+        std::printf("\n");
+    }
+
+    return 0;
+}
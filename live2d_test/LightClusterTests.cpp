@@ -0,0 +1,399 @@
+#include "LightCluster.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "PortableMath.h"
+#include "TaskScheduler.h"
+#include "TestHarness.h"
+
+using namespace D3D;
+using namespace DirectX;
+
+namespace
+{
+    float Random(uint32_t& seed)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / 16777216.0f;
+    }
+
+    struct Lights
+    {
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> z;
+        std::vector<float> radius;
+
+        uint32_t GetCount() const
+        {
+            return static_cast<uint32_t>(x.size());
+        }
+    };
+
+    // Lights all around the camera, including behind it, past the far plane and off screen.
+    Lights MakeLights(uint32_t count, uint32_t seed)
+    {
+        Lights lights;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            lights.x.push_back(Random(seed) * 160.0f - 80.0f);
+            lights.y.push_back(Random(seed) * 60.0f - 30.0f);
+            lights.z.push_back(Random(seed) * 140.0f - 30.0f);
+            lights.radius.push_back(0.2f + Random(seed) * Random(seed) * 12.0f);
+        }
+
+        return lights;
+    }
+
+    LightClusterView MakeView(float fov_y, uint32_t width, uint32_t height)
+    {
+        LightClusterView view;
+        XMMATRIX camera = XMMatrixLookAtLH(XMVectorSet(3.0f, 2.0f, -10.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 40.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+        XMFLOAT4X4 view_matrix;
+        XMStoreFloat4x4(&view_matrix, camera);
+        std::copy(&view_matrix._11, &view_matrix._11 + 16, view.view);
+
+        XMFLOAT4X4 proj;
+        XMStoreFloat4x4(&proj, XMMatrixPerspectiveFovLH(fov_y, static_cast<float>(width) / height, 0.5f, 100.0f));
+        view.proj_scale_x = proj._11;
+        view.proj_scale_y = proj._22;
+        view.near_z = 0.5f;
+        view.far_z = 100.0f;
+        view.screen_width = width;
+        view.screen_height = height;
+        return view;
+    }
+
+    struct Point
+    {
+        double x, y, z;
+    };
+
+    double Distance2(const Point& a, const Point& b)
+    {
+        return (a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y) + (a.z - b.z) * (a.z - b.z);
+    }
+
+    // Squared distance from p to the froxel between depths z0 and z1 whose sides are the planes
+    // x = slope_x[side] * z and y = slope_y[side] * z. The closest point is p itself, lies inside
+    // one of the six faces, or on one of the twelve edges.
+    double FroxelDistance2(const Point& p, double z0, double z1, const double slope_x[2], const double slope_y[2])
+    {
+        const double epsilon = 1e-9;
+        auto inside = [&](const Point& q)
+        {
+            return q.z >= z0 - epsilon && q.z <= z1 + epsilon && q.x >= slope_x[0] * q.z - epsilon && q.x <= slope_x[1] * q.z + epsilon &&
+                q.y >= slope_y[0] * q.z - epsilon && q.y <= slope_y[1] * q.z + epsilon;
+        };
+
+        if (inside(p))
+        {
+            return 0.0;
+        }
+
+        double best = 1e300;
+
+        // Faces, as the planes n . q = d.
+        for (uint32_t side = 0; side < 2; side++)
+        {
+            Point depth_face = { p.x, p.y, side == 0 ? z0 : z1 };
+            if (inside(depth_face))
+            {
+                best = (std::min)(best, Distance2(p, depth_face));
+            }
+
+            // x - slope * z = 0 and y - slope * z = 0.
+            for (uint32_t axis = 0; axis < 2; axis++)
+            {
+                double slope = axis == 0 ? slope_x[side] : slope_y[side];
+                double along = axis == 0 ? p.x : p.y;
+                double t = (along - slope * p.z) / (1.0 + slope * slope);
+                Point q = p;
+                q.z = p.z + t * slope;
+                if (axis == 0)
+                {
+                    q.x = along - t;
+                }
+                else
+                {
+                    q.y = along - t;
+                }
+
+                if (inside(q))
+                {
+                    best = (std::min)(best, Distance2(p, q));
+                }
+            }
+        }
+
+        // Edges between the eight corners, corner bits are x side, y side and depth.
+        Point corners[8];
+        for (uint32_t c = 0; c < 8; c++)
+        {
+            double z = (c & 4) != 0 ? z1 : z0;
+            corners[c] = { slope_x[c & 1] * z, slope_y[(c >> 1) & 1] * z, z };
+        }
+
+        for (uint32_t a = 0; a < 8; a++)
+        {
+            for (uint32_t bit = 1; bit < 8; bit <<= 1)
+            {
+                if ((a & bit) != 0)
+                {
+                    continue;
+                }
+
+                const Point& u = corners[a];
+                const Point& v = corners[a | bit];
+                Point edge = { v.x - u.x, v.y - u.y, v.z - u.z };
+                double length2 = edge.x * edge.x + edge.y * edge.y + edge.z * edge.z;
+                double t = ((p.x - u.x) * edge.x + (p.y - u.y) * edge.y + (p.z - u.z) * edge.z) / length2;
+                t = (std::min)((std::max)(t, 0.0), 1.0);
+                Point q = { u.x + edge.x * t, u.y + edge.y * t, u.z + edge.z * t };
+                best = (std::min)(best, Distance2(p, q));
+            }
+        }
+
+        return best;
+    }
+
+    // Every light against every cluster in double precision, without the screen bounds and slice
+    // buckets the builder narrows the search with. A light whose sphere reaches into the on
+    // screen part of the froxel has to be listed. The builder tests against the froxel's view
+    // space box, so lights that only touch the box may be listed too, but none beyond it. Lights
+    // within rounding of either surface may go either way.
+    void CheckAgainstBruteForce(const LightClusterBuilder& builder, const LightClusterView& view, const Lights& lights)
+    {
+        const LightClusterConfig& config = builder.GetConfig();
+        uint32_t tile_size_x = (view.screen_width + config.tile_count_x - 1) / config.tile_count_x;
+        uint32_t tile_size_y = (view.screen_height + config.tile_count_y - 1) / config.tile_count_y;
+        TEST_CHECK(builder.GetTileSizeX() == tile_size_x);
+        TEST_CHECK(builder.GetTileSizeY() == tile_size_y);
+
+        uint32_t light_count = lights.GetCount();
+        std::vector<double> view_x(light_count);
+        std::vector<double> view_y(light_count);
+        std::vector<double> view_z(light_count);
+        const float* m = view.view;
+        for (uint32_t i = 0; i < light_count; i++)
+        {
+            double x = lights.x[i];
+            double y = lights.y[i];
+            double z = lights.z[i];
+            view_x[i] = x * m[0] + y * m[4] + z * m[8] + m[12];
+            view_y[i] = x * m[1] + y * m[5] + z * m[9] + m[13];
+            view_z[i] = x * m[2] + y * m[6] + z * m[10] + m[14];
+        }
+
+        const auto& ranges = builder.GetClusterRanges();
+        const auto& indices = builder.GetLightIndices();
+        TEST_CHECK(ranges.size() == builder.GetClusterCount());
+
+        double ndc_tile_x = 2.0 * tile_size_x / view.screen_width;
+        double ndc_tile_y = 2.0 * tile_size_y / view.screen_height;
+        double depth_ratio = static_cast<double>(view.far_z) / view.near_z;
+
+        bool in_range = true;
+        bool ascending = true;
+        uint32_t missing = 0;
+        uint32_t extra = 0;
+        uint32_t pair_count = 0;
+        std::vector<uint8_t> listed(light_count);
+        for (uint32_t slice = 0; slice < config.slice_count; slice++)
+        {
+            double z0 = view.near_z * std::pow(depth_ratio, static_cast<double>(slice) / config.slice_count);
+            double z1 = view.near_z * std::pow(depth_ratio, static_cast<double>(slice + 1) / config.slice_count);
+            for (uint32_t tile_y = 0; tile_y < config.tile_count_y; tile_y++)
+            {
+                double ndc_top = 1.0 - ndc_tile_y * tile_y;
+                double ndc_bottom = ndc_top - ndc_tile_y;
+                for (uint32_t tile_x = 0; tile_x < config.tile_count_x; tile_x++)
+                {
+                    double ndc_left = -1.0 + ndc_tile_x * tile_x;
+                    double ndc_right = ndc_left + ndc_tile_x;
+
+                    // The last tiles of a screen that does not divide evenly reach past its edge.
+                    double slope_x[2] = { ndc_left / view.proj_scale_x, (std::min)(ndc_right, 1.0) / view.proj_scale_x };
+                    double slope_y[2] = { (std::max)(ndc_bottom, -1.0) / view.proj_scale_y, ndc_top / view.proj_scale_y };
+                    double min_x = (std::min)(ndc_left * z0, ndc_left * z1) / view.proj_scale_x;
+                    double max_x = (std::max)(ndc_right * z0, ndc_right * z1) / view.proj_scale_x;
+                    double min_y = (std::min)(ndc_bottom * z0, ndc_bottom * z1) / view.proj_scale_y;
+                    double max_y = (std::max)(ndc_top * z0, ndc_top * z1) / view.proj_scale_y;
+
+                    const LightClusterRange& range = ranges[builder.GetClusterIndex(tile_x, tile_y, slice)];
+                    if (range.offset + range.count > indices.size())
+                    {
+                        in_range = false;
+                        continue;
+                    }
+
+                    std::fill(listed.begin(), listed.end(), 0);
+                    for (uint32_t k = 0; k < range.count; k++)
+                    {
+                        uint32_t light = indices[range.offset + k];
+                        ascending = ascending && (k == 0 || light > indices[range.offset + k - 1]);
+                        listed[light] = 1;
+                    }
+
+                    pair_count += range.count;
+                    for (uint32_t i = 0; i < light_count; i++)
+                    {
+                        double dx = (std::max)((std::max)(min_x - view_x[i], 0.0), view_x[i] - max_x);
+                        double dy = (std::max)((std::max)(min_y - view_y[i], 0.0), view_y[i] - max_y);
+                        double dz = (std::max)((std::max)(z0 - view_z[i], 0.0), view_z[i] - z1);
+                        double box_dist2 = dx * dx + dy * dy + dz * dz;
+                        double r2 = static_cast<double>(lights.radius[i]) * lights.radius[i];
+                        double margin = 1e-4 * (1.0 + r2);
+                        if (listed[i] && box_dist2 > r2 + margin)
+                        {
+                            extra++;
+                        }
+                        else if (!listed[i] && box_dist2 < r2 - margin)
+                        {
+                            Point center = { view_x[i], view_y[i], view_z[i] };
+                            missing += FroxelDistance2(center, z0, z1, slope_x, slope_y) < r2 - margin ? 1 : 0;
+                        }
+                    }
+                }
+            }
+        }
+
+        TEST_CHECK(in_range);
+        TEST_CHECK(ascending);
+        TEST_CHECK(missing == 0);
+        TEST_CHECK(extra == 0);
+        TEST_CHECK(pair_count == indices.size());
+    }
+
+    bool IsSameResult(const LightClusterBuilder& a, const LightClusterBuilder& b)
+    {
+        const auto& ranges_a = a.GetClusterRanges();
+        const auto& ranges_b = b.GetClusterRanges();
+        if (ranges_a.size() != ranges_b.size() || a.GetLightIndices() != b.GetLightIndices())
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < ranges_a.size(); i++)
+        {
+            if (ranges_a[i].offset != ranges_b[i].offset || ranges_a[i].count != ranges_b[i].count)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void TestMatchesBruteForce()
+    {
+        LightClusterConfig config;
+        config.max_lights_per_cluster = 4096;
+
+        // 16 x 9 tiles of 80 pixels, and a screen that does not divide into whole tiles.
+        const uint32_t sizes[][2] = { { 1280, 720 }, { 1000, 563 } };
+        for (auto& size : sizes)
+        {
+            LightClusterView view = MakeView(0.9f, size[0], size[1]);
+            Lights lights = MakeLights(1500, size[0]);
+
+            LightClusterBuilder serial;
+            serial.Initialize(config);
+            serial.Build(view, lights.x.data(), lights.y.data(), lights.z.data(), lights.radius.data(), lights.GetCount());
+            CheckAgainstBruteForce(serial, view, lights);
+
+            // The scene has to exercise the test, most clusters see some lights.
+            TEST_CHECK(serial.GetLightIndices().size() > serial.GetClusterCount());
+
+            for (uint32_t worker_count : { 1u, 4u, 8u })
+            {
+                TaskScheduler scheduler(worker_count);
+                LightClusterBuilder threaded;
+                threaded.Initialize(config);
+                threaded.Build(view, lights.x.data(), lights.y.data(), lights.z.data(), lights.radius.data(), lights.GetCount(), &scheduler);
+                TEST_CHECK(IsSameResult(serial, threaded));
+                CheckAgainstBruteForce(threaded, view, lights);
+            }
+        }
+    }
+
+    void TestLightCountTail()
+    {
+        // Counts that leave one to three lanes of the last group of four, and no lights at all.
+        LightClusterConfig config;
+        LightClusterView view = MakeView(1.2f, 640, 360);
+        Lights all_lights = MakeLights(11, 99);
+
+        TaskScheduler scheduler(4);
+        for (uint32_t count = 0; count <= all_lights.GetCount(); count++)
+        {
+            Lights lights = all_lights;
+            lights.x.resize(count);
+            lights.y.resize(count);
+            lights.z.resize(count);
+            lights.radius.resize(count);
+
+            LightClusterBuilder serial;
+            serial.Initialize(config);
+            serial.Build(view, lights.x.data(), lights.y.data(), lights.z.data(), lights.radius.data(), count);
+            CheckAgainstBruteForce(serial, view, lights);
+
+            LightClusterBuilder threaded;
+            threaded.Initialize(config);
+            threaded.Build(view, lights.x.data(), lights.y.data(), lights.z.data(), lights.radius.data(), count, &scheduler);
+            TEST_CHECK(IsSameResult(serial, threaded));
+        }
+    }
+
+    void TestMaxLightsPerCluster()
+    {
+        // A few big lights in front of the camera crowd every cluster, each keeps its lowest ones.
+        LightClusterConfig config;
+        config.max_lights_per_cluster = 3;
+        LightClusterConfig unlimited = config;
+        unlimited.max_lights_per_cluster = 4096;
+
+        LightClusterView view = MakeView(0.9f, 1280, 720);
+        Lights lights = MakeLights(400, 3);
+        for (uint32_t i = 0; i < 8; i++)
+        {
+            lights.x[i] = 0.0f;
+            lights.y[i] = 0.0f;
+            lights.z[i] = 10.0f + i;
+            lights.radius[i] = 200.0f;
+        }
+
+        LightClusterBuilder capped;
+        capped.Initialize(config);
+        capped.Build(view, lights.x.data(), lights.y.data(), lights.z.data(), lights.radius.data(), lights.GetCount());
+
+        LightClusterBuilder full;
+        full.Initialize(unlimited);
+        full.Build(view, lights.x.data(), lights.y.data(), lights.z.data(), lights.radius.data(), lights.GetCount());
+
+        bool first_lights = true;
+        for (uint32_t c = 0; c < capped.GetClusterCount(); c++)
+        {
+            const LightClusterRange& a = capped.GetClusterRanges()[c];
+            const LightClusterRange& b = full.GetClusterRanges()[c];
+            first_lights = first_lights && a.count == (std::min)(b.count, 3u);
+            for (uint32_t k = 0; k < a.count && first_lights; k++)
+            {
+                first_lights = capped.GetLightIndices()[a.offset + k] == full.GetLightIndices()[b.offset + k];
+            }
+        }
+
+        TEST_CHECK(first_lights);
+        TEST_CHECK(capped.GetLightIndices().size() == capped.GetClusterCount() * 3);
+    }
+}
+
+int main()
+{
+    TestMatchesBruteForce();
+    TestLightCountTail();
+    TestMaxLightsPerCluster();
+    return D3D::Test::Finish("LightClusterTests");
+}
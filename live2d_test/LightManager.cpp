@@ -0,0 +1,169 @@
+#include "LightManager.h"
+
+#include <cassert>
+
+#include "D3DUtil.h"
+#include "TaskScheduler.h"
+
+namespace D3D
+{
+    using namespace DirectX;
+
+    void LightManager::Initialize(const LightClusterConfig& config)
+    {
+        cluster_builder_.Initialize(config);
+        cluster_view_valid_ = false;
+        lights_dirty_ = true;
+
+        point_light_buffer_.stride = sizeof(PointLight);
+        cluster_buffer_.stride = sizeof(LightClusterRange);
+        index_buffer_.stride = sizeof(uint32_t);
+
+        Reserve(point_light_buffer_, MIN_BUFFER_CAPACITY_);
+        Reserve(cluster_buffer_, cluster_builder_.GetClusterCount());
+        Reserve(index_buffer_, MIN_BUFFER_CAPACITY_);
+
+        ::memset(cluster_buffer_.mapped_data, 0, static_cast<size_t>(cluster_buffer_.stride) * cluster_buffer_.capacity);
+    }
+
+    uint32_t LightManager::AddPointLight(const PointLight& light)
+    {
+        point_lights_.push_back(light);
+        lights_dirty_ = true;
+        return static_cast<uint32_t>(point_lights_.size() - 1);
+    }
+
+    void LightManager::SetPointLight(uint32_t index, const PointLight& light)
+    {
+        assert(index < point_lights_.size());
+
+        point_lights_[index] = light;
+        lights_dirty_ = true;
+    }
+
+    const PointLight& LightManager::GetPointLight(uint32_t index) const
+    {
+        assert(index < point_lights_.size());
+
+        return point_lights_[index];
+    }
+
+    uint32_t LightManager::GetPointLightCount() const
+    {
+        return static_cast<uint32_t>(point_lights_.size());
+    }
+
+    void LightManager::ClearPointLights()
+    {
+        point_lights_.clear();
+        lights_dirty_ = true;
+    }
+
+    bool LightManager::Update(const Camera& camera, uint32_t screen_width, uint32_t screen_height)
+    {
+        LightClusterView cluster_view;
+        XMFLOAT4X4 view = camera.GetView4x4f();
+        XMFLOAT4X4 proj = camera.GetProj4x4f();
+        ::memcpy(cluster_view.view, &view, sizeof(cluster_view.view));
+        cluster_view.proj_scale_x = proj._11;
+        cluster_view.proj_scale_y = proj._22;
+        cluster_view.near_z = camera.GetNearZ();
+        cluster_view.far_z = camera.GetFarZ();
+        cluster_view.screen_width = screen_width;
+        cluster_view.screen_height = screen_height;
+
+        bool view_changed = !cluster_view_valid_ || ::memcmp(&cluster_view, &cluster_view_, sizeof(LightClusterView)) != 0;
+        if (!view_changed && !lights_dirty_)
+        {
+            return false;
+        }
+
+        cluster_view_ = cluster_view;
+        cluster_view_valid_ = true;
+
+        // The renderer waits for the GPU every frame, so the upload buffers can be rewritten in place.
+        bool buffer_recreated{ false };
+        uint32_t light_count = GetPointLightCount();
+        if (lights_dirty_)
+        {
+            buffer_recreated |= Reserve(point_light_buffer_, light_count);
+            if (light_count > 0)
+            {
+                ::memcpy(point_light_buffer_.mapped_data, point_lights_.data(), sizeof(PointLight) * light_count);
+            }
+
+            light_pos_x_.resize(light_count);
+            light_pos_y_.resize(light_count);
+            light_pos_z_.resize(light_count);
+            light_range_.resize(light_count);
+            for (uint32_t i = 0; i < light_count; i++)
+            {
+                light_pos_x_[i] = point_lights_[i].position.x;
+                light_pos_y_[i] = point_lights_[i].position.y;
+                light_pos_z_[i] = point_lights_[i].position.z;
+                light_range_[i] = point_lights_[i].CalcRange();
+            }
+
+            lights_dirty_ = false;
+        }
+
+        cluster_builder_.Build(cluster_view_, light_pos_x_.data(), light_pos_y_.data(), light_pos_z_.data(), light_range_.data(), light_count, &TaskScheduler::GetScheduler());
+
+        auto& ranges = cluster_builder_.GetClusterRanges();
+        auto& indices = cluster_builder_.GetLightIndices();
+        buffer_recreated |= Reserve(index_buffer_, static_cast<uint32_t>(indices.size()));
+
+        ::memcpy(cluster_buffer_.mapped_data, ranges.data(), sizeof(LightClusterRange) * ranges.size());
+        if (!indices.empty())
+        {
+            ::memcpy(index_buffer_.mapped_data, indices.data(), sizeof(uint32_t) * indices.size());
+        }
+
+        return buffer_recreated;
+    }
+
+    void LightManager::BindResource(D3D12BoundResourceManager& bound_resource_manager)
+    {
+        BindBuffer(bound_resource_manager, "POINT_LIGHT_BUFFER", point_light_buffer_);
+        BindBuffer(bound_resource_manager, "LIGHT_CLUSTER_BUFFER", cluster_buffer_);
+        BindBuffer(bound_resource_manager, "LIGHT_INDEX_BUFFER", index_buffer_);
+    }
+
+    const LightClusterBuilder& LightManager::GetClusterBuilder() const
+    {
+        return cluster_builder_;
+    }
+
+    bool LightManager::Reserve(StructuredUploadBuffer& buffer, uint32_t element_count)
+    {
+        if (buffer.resource != nullptr && element_count <= buffer.capacity)
+        {
+            return false;
+        }
+
+        uint32_t capacity = (std::max)(buffer.capacity, MIN_BUFFER_CAPACITY_);
+        while (capacity < element_count)
+        {
+            capacity *= 2;
+        }
+
+        buffer.resource = D3D12Manager::CreateBuffer(D3D12_HEAP_TYPE_UPLOAD, static_cast<uint64_t>(buffer.stride) * capacity);
+        buffer.capacity = capacity;
+        ThrowIfFailed(buffer.resource->Map(0, nullptr, reinterpret_cast<void**>(&buffer.mapped_data)));
+
+        return true;
+    }
+
+    void LightManager::BindBuffer(D3D12BoundResourceManager& bound_resource_manager, const std::string& name, const StructuredUploadBuffer& buffer)
+    {
+        D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc{};
+        srv_desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        srv_desc.Format = DXGI_FORMAT_UNKNOWN;
+        srv_desc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+        srv_desc.Buffer.FirstElement = 0;
+        srv_desc.Buffer.NumElements = buffer.capacity;
+        srv_desc.Buffer.StructureByteStride = buffer.stride;
+        srv_desc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
+        bound_resource_manager.BindShaderResourceView(name, 0, buffer.resource.Get(), srv_desc);
+    }
+};
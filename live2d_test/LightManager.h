@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+
+#include "D3D12Manager.h"
+#include "D3DCamera.h"
+#include "D3D12BoundResourceManager.h"
+#include "LightCluster.h"
+#include "PointLight.h"
+
+namespace D3D
+{
+    // Owns the point lights of the scene and the structured buffers the pixel shader reads them
+    // from: POINT_LIGHT_BUFFER, LIGHT_CLUSTER_BUFFER ((offset, count) per cluster) and
+    // LIGHT_INDEX_BUFFER. Clusters are only rebuilt when the camera or a light changed.
+    class LightManager
+    {
+    public:
+        void Initialize(const LightClusterConfig& config = LightClusterConfig());
+
+        uint32_t AddPointLight(const PointLight& light);
+        void SetPointLight(uint32_t index, const PointLight& light);
+        const PointLight& GetPointLight(uint32_t index) const;
+        uint32_t GetPointLightCount() const;
+        void ClearPointLights();
+
+        // Returns true when a buffer had to grow, its views then have to be bound again.
+        bool Update(const Camera& camera, uint32_t screen_width, uint32_t screen_height);
+        void BindResource(D3D12BoundResourceManager& bound_resource_manager);
+
+        const LightClusterBuilder& GetClusterBuilder() const;
+
+    private:
+        struct StructuredUploadBuffer
+        {
+            Microsoft::WRL::ComPtr<ID3D12Resource>          resource;
+            uint8_t*                                        mapped_data = nullptr;
+            uint32_t                                        stride = 0;
+            uint32_t                                        capacity = 0;
+        };
+
+        static const uint32_t MIN_BUFFER_CAPACITY_ = 64;
+
+        static bool Reserve(StructuredUploadBuffer& buffer, uint32_t element_count);
+        static void BindBuffer(D3D12BoundResourceManager& bound_resource_manager, const std::string& name, const StructuredUploadBuffer& buffer);
+
+        std::vector<PointLight>                             point_lights_;
+        std::vector<float>                                  light_pos_x_;
+        std::vector<float>                                  light_pos_y_;
+        std::vector<float>                                  light_pos_z_;
+        std::vector<float>                                  light_range_;
+        bool                                                lights_dirty_ = true;
+
+        LightClusterBuilder                                 cluster_builder_;
+        LightClusterView                                    cluster_view_;
+        bool                                                cluster_view_valid_ = false;
+
+        StructuredUploadBuffer                              point_light_buffer_;
+        StructuredUploadBuffer                              cluster_buffer_;
+        StructuredUploadBuffer                              index_buffer_;
+    };
+};
@@ -0,0 +1,675 @@
+#include "Live2DModel.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#include "SimdMath.h"
+#include "TaskScheduler.h"
+
+namespace D3D
+{
+    namespace
+    {
+        const uint32_t SIMD_WIDTH = 4;
+
+        // Art meshes handed out per task, both within one model and across models.
+        const uint32_t MESH_GRAIN_SIZE = 16;
+
+        // Models whose deformers are updated per task.
+        const uint32_t MODEL_GRAIN_SIZE = 4;
+
+        const float DEGREES_TO_RADIANS = 3.14159265358979f / 180.0f;
+
+        // Rotation keyforms and their blended state.
+        enum RotationField { kRotationOriginX, kRotationOriginY, kRotationAngle, kRotationScale, kRotationOpacity, kRotationFieldCount };
+        enum RotationState { kRotationCos = kRotationAngle, kRotationSin = kRotationScale };
+
+        // Weighted sum of blend_count keyforms of keyform_size floats each.
+        void BlendKeyforms(const float* keyforms, uint32_t keyform_size, const uint32_t* blend_keyforms, const float* blend_weights,
+            uint32_t blend_count, float* result)
+        {
+            for (uint32_t i = 0; i < keyform_size; i += SIMD_WIDTH)
+            {
+                uint32_t lane_count = keyform_size - i;
+                Simd::Float4 sum = Simd::Zero();
+                for (uint32_t corner = 0; corner < blend_count; corner++)
+                {
+                    const float* keyform = keyforms + blend_keyforms[corner] * keyform_size;
+                    sum = Simd::MulAdd(Simd::LoadPartial(keyform + i, lane_count), Simd::Set1(blend_weights[corner]), sum);
+                }
+
+                Simd::StorePartial(result + i, sum, lane_count);
+            }
+        }
+
+        // The degree + 1 Bernstein polynomials of t, for four values at a time.
+        inline void BernsteinBasis(Simd::Float4 t, uint32_t degree, Simd::Float4* basis)
+        {
+            Simd::Float4 one = Simd::Set1(1.0f);
+            Simd::Float4 s = Simd::Sub(one, t);
+
+            // basis[i] = t^i, then multiplied by binomial(degree, i) * s^(degree - i) from the top.
+            basis[0] = one;
+            for (uint32_t i = 1; i <= degree; i++)
+            {
+                basis[i] = Simd::Mul(basis[i - 1], t);
+            }
+
+            Simd::Float4 s_power = one;
+            float binomial = 1.0f;
+            for (uint32_t i = degree + 1; i-- > 0;)
+            {
+                basis[i] = Simd::Mul(basis[i], Simd::Mul(s_power, Simd::Set1(binomial)));
+                s_power = Simd::Mul(s_power, s);
+                binomial = binomial * static_cast<float>(i) / static_cast<float>(degree - i + 1);
+            }
+        }
+
+        inline void ApplyWarp(const float* points_x, const float* points_y, uint32_t rows, uint32_t columns, Simd::Float4& x, Simd::Float4& y)
+        {
+            Simd::Float4 basis_u[Live2DModel::MAX_LATTICE_DIVISIONS + 1];
+            Simd::Float4 basis_v[Live2DModel::MAX_LATTICE_DIVISIONS + 1];
+            BernsteinBasis(x, columns, basis_u);
+            BernsteinBasis(y, rows, basis_v);
+
+            Simd::Float4 result_x = Simd::Zero();
+            Simd::Float4 result_y = Simd::Zero();
+            for (uint32_t row = 0; row <= rows; row++)
+            {
+                const float* row_x = points_x + row * (columns + 1);
+                const float* row_y = points_y + row * (columns + 1);
+
+                Simd::Float4 sum_x = Simd::Zero();
+                Simd::Float4 sum_y = Simd::Zero();
+                for (uint32_t column = 0; column <= columns; column++)
+                {
+                    sum_x = Simd::MulAdd(basis_u[column], Simd::Set1(row_x[column]), sum_x);
+                    sum_y = Simd::MulAdd(basis_u[column], Simd::Set1(row_y[column]), sum_y);
+                }
+
+                result_x = Simd::MulAdd(basis_v[row], sum_x, result_x);
+                result_y = Simd::MulAdd(basis_v[row], sum_y, result_y);
+            }
+
+            x = result_x;
+            y = result_y;
+        }
+
+        inline void ApplyRotation(const float* state, Simd::Float4& x, Simd::Float4& y)
+        {
+            Simd::Float4 cos_scale = Simd::Set1(state[kRotationCos]);
+            Simd::Float4 sin_scale = Simd::Set1(state[kRotationSin]);
+
+            Simd::Float4 rx = Simd::MulAdd(x, cos_scale, Simd::Sub(Simd::Set1(state[kRotationOriginX]), Simd::Mul(y, sin_scale)));
+            Simd::Float4 ry = Simd::MulAdd(x, sin_scale, Simd::MulAdd(y, cos_scale, Simd::Set1(state[kRotationOriginY])));
+            x = rx;
+            y = ry;
+        }
+    }
+
+    ArtMeshDesc Live2DModel::ArtMeshFromGeometry(const GeometryGenerator::MeshData& mesh)
+    {
+        ArtMeshDesc desc;
+        desc.positions.reserve(mesh.Vertices.size() * 2);
+        desc.uvs.reserve(mesh.Vertices.size() * 2);
+        for (const auto& vertex : mesh.Vertices)
+        {
+            desc.positions.push_back(vertex.Position.x);
+            desc.positions.push_back(vertex.Position.y);
+            desc.uvs.push_back(vertex.TexC.x);
+            desc.uvs.push_back(vertex.TexC.y);
+        }
+
+        // Art meshes always use 16 bit indices.
+        assert(!mesh.Use32BitIndices);
+        desc.indices = mesh.Indices16;
+        desc.opacities.push_back(1.0f);
+
+        return desc;
+    }
+
+    void Live2DModel::Clear()
+    {
+        parameter_values_.clear();
+        parameter_minimums_.clear();
+        parameter_maximums_.clear();
+        parameter_defaults_.clear();
+        parameter_dirty_.clear();
+
+        deformers_.clear();
+        art_meshes_.clear();
+
+        binding_axes_.clear();
+        binding_keys_.clear();
+        keyform_data_.clear();
+        uv_data_.clear();
+
+        deformer_state_.clear();
+        art_mesh_opacities_.clear();
+        vertex_count_ = 0;
+
+        deformer_dirty_.clear();
+        art_mesh_dirty_.clear();
+        updated_art_mesh_count_ = 0;
+        all_dirty_ = true;
+    }
+
+    uint32_t Live2DModel::AddParameter(float minimum, float maximum, float default_value)
+    {
+        assert(minimum <= default_value && default_value <= maximum);
+
+        parameter_values_.push_back(default_value);
+        parameter_minimums_.push_back(minimum);
+        parameter_maximums_.push_back(maximum);
+        parameter_defaults_.push_back(default_value);
+        parameter_dirty_.push_back(1);
+
+        return GetParameterCount() - 1;
+    }
+
+    uint32_t Live2DModel::AddWarpDeformer(const WarpDeformerDesc& desc)
+    {
+        assert(desc.parent == INVALID_INDEX || desc.parent < GetDeformerCount());
+        assert(desc.rows >= 1 && desc.rows <= MAX_LATTICE_DIVISIONS);
+        assert(desc.columns >= 1 && desc.columns <= MAX_LATTICE_DIVISIONS);
+
+        uint32_t keyform_count = static_cast<uint32_t>(desc.opacities.size());
+        uint32_t point_count = (desc.rows + 1) * (desc.columns + 1);
+        assert(desc.points.size() == static_cast<size_t>(keyform_count) * point_count * 2);
+
+        Deformer deformer{};
+        deformer.type = kWarpDeformer;
+        deformer.parent = desc.parent;
+        deformer.binding = AddBinding(desc.binding, keyform_count);
+        deformer.rows = desc.rows;
+        deformer.columns = desc.columns;
+        deformer.keyform_offset = static_cast<uint32_t>(keyform_data_.size());
+        deformer.keyform_size = point_count * 2 + 1;
+        deformer.state_offset = static_cast<uint32_t>(deformer_state_.size());
+
+        for (uint32_t keyform = 0; keyform < keyform_count; keyform++)
+        {
+            const float* points = desc.points.data() + keyform * point_count * 2;
+            for (uint32_t component = 0; component < 2; component++)
+            {
+                for (uint32_t point = 0; point < point_count; point++)
+                {
+                    keyform_data_.push_back(points[point * 2 + component]);
+                }
+            }
+
+            keyform_data_.push_back(desc.opacities[keyform]);
+        }
+
+        deformer_state_.resize(deformer_state_.size() + deformer.keyform_size);
+        deformer_dirty_.push_back(1);
+        deformers_.push_back(deformer);
+        all_dirty_ = true;
+
+        return GetDeformerCount() - 1;
+    }
+
+    uint32_t Live2DModel::AddRotationDeformer(const RotationDeformerDesc& desc)
+    {
+        assert(desc.parent == INVALID_INDEX || desc.parent < GetDeformerCount());
+
+        uint32_t keyform_count = static_cast<uint32_t>(desc.keyforms.size());
+
+        Deformer deformer{};
+        deformer.type = kRotationDeformer;
+        deformer.parent = desc.parent;
+        deformer.binding = AddBinding(desc.binding, keyform_count);
+        deformer.keyform_offset = static_cast<uint32_t>(keyform_data_.size());
+        deformer.keyform_size = kRotationFieldCount;
+        deformer.state_offset = static_cast<uint32_t>(deformer_state_.size());
+
+        for (const auto& keyform : desc.keyforms)
+        {
+            keyform_data_.push_back(keyform.origin_x);
+            keyform_data_.push_back(keyform.origin_y);
+            keyform_data_.push_back(keyform.angle);
+            keyform_data_.push_back(keyform.scale);
+            keyform_data_.push_back(keyform.opacity);
+        }
+
+        deformer_state_.resize(deformer_state_.size() + deformer.keyform_size);
+        deformer_dirty_.push_back(1);
+        deformers_.push_back(deformer);
+        all_dirty_ = true;
+
+        return GetDeformerCount() - 1;
+    }
+
+    uint32_t Live2DModel::AddArtMesh(const ArtMeshDesc& desc)
+    {
+        assert(desc.parent == INVALID_INDEX || desc.parent < GetDeformerCount());
+
+        uint32_t keyform_count = static_cast<uint32_t>(desc.opacities.size());
+        uint32_t vertex_count = static_cast<uint32_t>(desc.uvs.size() / 2);
+        assert(desc.positions.size() == static_cast<size_t>(keyform_count) * vertex_count * 2);
+
+        ArtMesh mesh{};
+        mesh.parent = desc.parent;
+        mesh.binding = AddBinding(desc.binding, keyform_count);
+        mesh.vertex_offset = vertex_count_;
+        mesh.vertex_count = vertex_count;
+        mesh.keyform_offset = static_cast<uint32_t>(keyform_data_.size());
+        mesh.indices = desc.indices;
+
+        for (uint32_t keyform = 0; keyform < keyform_count; keyform++)
+        {
+            const float* positions = desc.positions.data() + keyform * vertex_count * 2;
+            for (uint32_t component = 0; component < 2; component++)
+            {
+                for (uint32_t vertex = 0; vertex < vertex_count; vertex++)
+                {
+                    keyform_data_.push_back(positions[vertex * 2 + component]);
+                }
+            }
+        }
+
+        mesh.opacity_offset = static_cast<uint32_t>(keyform_data_.size());
+        keyform_data_.insert(keyform_data_.end(), desc.opacities.begin(), desc.opacities.end());
+
+        mesh.uv_offset = static_cast<uint32_t>(uv_data_.size());
+        for (uint32_t component = 0; component < 2; component++)
+        {
+            for (uint32_t vertex = 0; vertex < vertex_count; vertex++)
+            {
+                uv_data_.push_back(desc.uvs[vertex * 2 + component]);
+            }
+        }
+
+        art_meshes_.push_back(std::move(mesh));
+        art_mesh_opacities_.push_back(1.0f);
+        art_mesh_dirty_.push_back(1);
+        vertex_count_ += vertex_count;
+        all_dirty_ = true;
+
+        return GetArtMeshCount() - 1;
+    }
+
+    void Live2DModel::SetParameter(uint32_t parameter, float value)
+    {
+        value = (std::min)((std::max)(value, parameter_minimums_[parameter]), parameter_maximums_[parameter]);
+        if (value != parameter_values_[parameter])
+        {
+            parameter_values_[parameter] = value;
+            parameter_dirty_[parameter] = 1;
+        }
+    }
+
+    float Live2DModel::GetParameter(uint32_t parameter) const
+    {
+        return parameter_values_[parameter];
+    }
+
+    void Live2DModel::ResetParameters()
+    {
+        for (uint32_t parameter = 0; parameter < GetParameterCount(); parameter++)
+        {
+            SetParameter(parameter, parameter_defaults_[parameter]);
+        }
+    }
+
+    uint32_t Live2DModel::GetParameterCount() const
+    {
+        return static_cast<uint32_t>(parameter_values_.size());
+    }
+
+    uint32_t Live2DModel::GetDeformerCount() const
+    {
+        return static_cast<uint32_t>(deformers_.size());
+    }
+
+    uint32_t Live2DModel::GetArtMeshCount() const
+    {
+        return static_cast<uint32_t>(art_meshes_.size());
+    }
+
+    uint32_t Live2DModel::GetVertexCount() const
+    {
+        return vertex_count_;
+    }
+
+    uint32_t Live2DModel::GetArtMeshVertexOffset(uint32_t mesh) const
+    {
+        return art_meshes_[mesh].vertex_offset;
+    }
+
+    uint32_t Live2DModel::GetArtMeshVertexCount(uint32_t mesh) const
+    {
+        return art_meshes_[mesh].vertex_count;
+    }
+
+    const std::vector<uint16_t>& Live2DModel::GetArtMeshIndices(uint32_t mesh) const
+    {
+        return art_meshes_[mesh].indices;
+    }
+
+    float Live2DModel::GetArtMeshOpacity(uint32_t mesh) const
+    {
+        return art_mesh_opacities_[mesh];
+    }
+
+    uint32_t Live2DModel::GetUpdatedArtMeshCount() const
+    {
+        return updated_art_mesh_count_;
+    }
+
+    void Live2DModel::Invalidate()
+    {
+        all_dirty_ = true;
+    }
+
+    void Live2DModel::Update(ArtMeshVertex* destination, TaskScheduler* scheduler)
+    {
+        UpdateDeformers();
+
+        uint32_t mesh_count = GetArtMeshCount();
+        if (scheduler != nullptr && mesh_count > MESH_GRAIN_SIZE)
+        {
+            scheduler->ParallelFor(mesh_count, MESH_GRAIN_SIZE, [this, destination](uint32_t begin, uint32_t end)
+            {
+                UpdateArtMeshes(begin, end, destination);
+            });
+        }
+        else
+        {
+            UpdateArtMeshes(0, mesh_count, destination);
+        }
+    }
+
+    void Live2DModel::UpdateDeformers()
+    {
+        for (uint32_t index = 0; index < GetDeformerCount(); index++)
+        {
+            const Deformer& deformer = deformers_[index];
+            bool dirty = all_dirty_ || IsBindingDirty(deformer.binding) || (deformer.parent != INVALID_INDEX && deformer_dirty_[deformer.parent] != 0);
+            deformer_dirty_[index] = dirty ? 1 : 0;
+            if (!dirty)
+            {
+                continue;
+            }
+
+            KeyformBlend blend;
+            FindKeyforms(deformer.binding, blend);
+
+            float* state = deformer_state_.data() + deformer.state_offset;
+            BlendKeyforms(keyform_data_.data() + deformer.keyform_offset, deformer.keyform_size, blend.keyforms, blend.weights, blend.count, state);
+
+            if (deformer.type == kRotationDeformer)
+            {
+                float angle = state[kRotationAngle] * DEGREES_TO_RADIANS;
+                float scale = state[kRotationScale];
+                state[kRotationCos] = ::cosf(angle) * scale;
+                state[kRotationSin] = ::sinf(angle) * scale;
+            }
+
+            if (deformer.parent != INVALID_INDEX)
+            {
+                const auto& parent = deformers_[deformer.parent];
+                state[deformer.keyform_size - 1] *= deformer_state_[parent.state_offset + parent.keyform_size - 1];
+            }
+        }
+
+        updated_art_mesh_count_ = 0;
+        for (uint32_t mesh = 0; mesh < GetArtMeshCount(); mesh++)
+        {
+            const ArtMesh& art_mesh = art_meshes_[mesh];
+            bool dirty = all_dirty_ || IsBindingDirty(art_mesh.binding) || (art_mesh.parent != INVALID_INDEX && deformer_dirty_[art_mesh.parent] != 0);
+            art_mesh_dirty_[mesh] = dirty ? 1 : 0;
+            updated_art_mesh_count_ += dirty ? 1 : 0;
+        }
+
+        if (!parameter_dirty_.empty())
+        {
+            ::memset(parameter_dirty_.data(), 0, parameter_dirty_.size());
+        }
+
+        all_dirty_ = false;
+    }
+
+    void Live2DModel::UpdateArtMeshes(uint32_t begin, uint32_t end, ArtMeshVertex* destination)
+    {
+        for (uint32_t mesh = begin; mesh < end; mesh++)
+        {
+            if (art_mesh_dirty_[mesh] != 0)
+            {
+                UpdateArtMesh(mesh, destination);
+            }
+        }
+
+        Simd::StreamFence();
+    }
+
+    Live2DModel::Binding Live2DModel::AddBinding(const KeyformBinding& binding, uint32_t keyform_count)
+    {
+        assert(binding.axes.size() <= MAX_BINDING_AXES);
+
+        Binding result{};
+        result.axis_offset = static_cast<uint32_t>(binding_axes_.size());
+        result.axis_count = static_cast<uint32_t>(binding.axes.size());
+
+        uint32_t stride = 1;
+        for (const auto& axis : binding.axes)
+        {
+            assert(axis.parameter < GetParameterCount() && !axis.keys.empty());
+            assert(std::is_sorted(axis.keys.begin(), axis.keys.end()));
+
+            BindingAxis binding_axis{};
+            binding_axis.parameter = axis.parameter;
+            binding_axis.key_offset = static_cast<uint32_t>(binding_keys_.size());
+            binding_axis.key_count = static_cast<uint32_t>(axis.keys.size());
+            binding_axis.stride = stride;
+            binding_axes_.push_back(binding_axis);
+            binding_keys_.insert(binding_keys_.end(), axis.keys.begin(), axis.keys.end());
+
+            stride *= binding_axis.key_count;
+        }
+
+        assert(stride == keyform_count);
+        (void)keyform_count;
+
+        return result;
+    }
+
+    void Live2DModel::FindKeyforms(const Binding& binding, KeyformBlend& blend) const
+    {
+        blend.count = 1;
+        blend.keyforms[0] = 0;
+        blend.weights[0] = 1.0f;
+
+        for (uint32_t axis_index = 0; axis_index < binding.axis_count; axis_index++)
+        {
+            const BindingAxis& axis = binding_axes_[binding.axis_offset + axis_index];
+
+            // Axes hold a handful of keys, a linear scan beats a binary search.
+            const float* keys = binding_keys_.data() + axis.key_offset;
+            float value = parameter_values_[axis.parameter];
+            uint32_t last = axis.key_count - 1;
+            uint32_t first = 0;
+            float weight = 0.0f;
+            if (value >= keys[last])
+            {
+                first = last;
+            }
+            else if (value > keys[0])
+            {
+                while (value >= keys[first + 1])
+                {
+                    first++;
+                }
+
+                weight = (value - keys[first]) / (keys[first + 1] - keys[first]);
+            }
+
+            // A parameter sitting on a key does not split the cell, so the corner count only
+            // doubles for the axes that are actually between two keys.
+            uint32_t count = blend.count;
+            if (weight > 0.0f)
+            {
+                for (uint32_t corner = 0; corner < count; corner++)
+                {
+                    blend.keyforms[count + corner] = blend.keyforms[corner] + (first + 1) * axis.stride;
+                    blend.weights[count + corner] = blend.weights[corner] * weight;
+                    blend.weights[corner] *= 1.0f - weight;
+                }
+
+                blend.count = count * 2;
+            }
+
+            for (uint32_t corner = 0; corner < count; corner++)
+            {
+                blend.keyforms[corner] += first * axis.stride;
+            }
+        }
+    }
+
+    bool Live2DModel::IsBindingDirty(const Binding& binding) const
+    {
+        for (uint32_t axis_index = 0; axis_index < binding.axis_count; axis_index++)
+        {
+            if (parameter_dirty_[binding_axes_[binding.axis_offset + axis_index].parameter] != 0)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void Live2DModel::UpdateArtMesh(uint32_t mesh_index, ArtMeshVertex* destination)
+    {
+        const ArtMesh& mesh = art_meshes_[mesh_index];
+
+        KeyformBlend blend;
+        FindKeyforms(mesh.binding, blend);
+
+        const float* opacities = keyform_data_.data() + mesh.opacity_offset;
+        float opacity = 0.0f;
+        for (uint32_t corner = 0; corner < blend.count; corner++)
+        {
+            opacity += opacities[blend.keyforms[corner]] * blend.weights[corner];
+        }
+
+        if (mesh.parent != INVALID_INDEX)
+        {
+            const auto& parent = deformers_[mesh.parent];
+            opacity *= deformer_state_[parent.state_offset + parent.keyform_size - 1];
+        }
+
+        art_mesh_opacities_[mesh_index] = opacity;
+
+        uint32_t vertex_count = mesh.vertex_count;
+        const float* corner_x[1 << MAX_BINDING_AXES];
+        Simd::Float4 corner_weights[1 << MAX_BINDING_AXES];
+        for (uint32_t corner = 0; corner < blend.count; corner++)
+        {
+            corner_x[corner] = keyform_data_.data() + mesh.keyform_offset + blend.keyforms[corner] * vertex_count * 2;
+            corner_weights[corner] = Simd::Set1(blend.weights[corner]);
+        }
+
+        const float* u = uv_data_.data() + mesh.uv_offset;
+        const float* v = u + vertex_count;
+
+        float* output = reinterpret_cast<float*>(destination + mesh.vertex_offset);
+        bool streaming = (reinterpret_cast<uintptr_t>(output) & 15) == 0;
+
+        for (uint32_t i = 0; i < vertex_count; i += SIMD_WIDTH)
+        {
+            uint32_t lane_count = vertex_count - i;
+            Simd::Float4 x = Simd::Zero();
+            Simd::Float4 y = Simd::Zero();
+            for (uint32_t corner = 0; corner < blend.count; corner++)
+            {
+                x = Simd::MulAdd(Simd::LoadPartial(corner_x[corner] + i, lane_count), corner_weights[corner], x);
+                y = Simd::MulAdd(Simd::LoadPartial(corner_x[corner] + vertex_count + i, lane_count), corner_weights[corner], y);
+            }
+
+            // Up the deformer chain into model space, the parents come from UpdateDeformers.
+            for (uint32_t parent = mesh.parent; parent != INVALID_INDEX; parent = deformers_[parent].parent)
+            {
+                const auto& deformer = deformers_[parent];
+                const float* state = deformer_state_.data() + deformer.state_offset;
+                if (deformer.type == kWarpDeformer)
+                {
+                    uint32_t point_count = (deformer.rows + 1) * (deformer.columns + 1);
+                    ApplyWarp(state, state + point_count, deformer.rows, deformer.columns, x, y);
+                }
+                else
+                {
+                    ApplyRotation(state, x, y);
+                }
+            }
+
+            // Each transposed row is one complete vertex.
+            Simd::Float4 lanes[4] = { x, y, Simd::LoadPartial(u + i, lane_count), Simd::LoadPartial(v + i, lane_count) };
+            Simd::Transpose(lanes[0], lanes[1], lanes[2], lanes[3]);
+
+            float* group = output + i * 4;
+            if (streaming && lane_count >= SIMD_WIDTH)
+            {
+                for (uint32_t lane = 0; lane < SIMD_WIDTH; lane++)
+                {
+                    Simd::StoreStream(group + lane * 4, lanes[lane]);
+                }
+            }
+            else
+            {
+                float vertices[SIMD_WIDTH * 4];
+                for (uint32_t lane = 0; lane < SIMD_WIDTH; lane++)
+                {
+                    Simd::Store(vertices + lane * 4, lanes[lane]);
+                }
+
+                ::memcpy(group, vertices, (std::min)(lane_count, SIMD_WIDTH) * sizeof(ArtMeshVertex));
+            }
+        }
+    }
+
+    void DeformerEngine::Update(Live2DModel* const* models, ArtMeshVertex* const* destinations, uint32_t model_count, TaskScheduler* scheduler)
+    {
+        // Slice every model into runs of meshes so large and small models balance out.
+        mesh_ranges_.clear();
+        for (uint32_t model = 0; model < model_count; model++)
+        {
+            uint32_t mesh_count = models[model]->GetArtMeshCount();
+            for (uint32_t begin = 0; begin < mesh_count; begin += MESH_GRAIN_SIZE)
+            {
+                mesh_ranges_.push_back({ model, begin, (std::min)(begin + MESH_GRAIN_SIZE, mesh_count) });
+            }
+        }
+
+        auto update_deformers = [models](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t model = begin; model < end; model++)
+            {
+                models[model]->UpdateDeformers();
+            }
+        };
+
+        auto update_meshes = [this, models, destinations](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t range = begin; range < end; range++)
+            {
+                const MeshRange& mesh_range = mesh_ranges_[range];
+                models[mesh_range.model]->UpdateArtMeshes(mesh_range.begin, mesh_range.end, destinations[mesh_range.model]);
+            }
+        };
+
+        uint32_t range_count = static_cast<uint32_t>(mesh_ranges_.size());
+        if (scheduler != nullptr)
+        {
+            scheduler->ParallelFor(model_count, MODEL_GRAIN_SIZE, update_deformers);
+            scheduler->ParallelFor(range_count, 1, update_meshes);
+        }
+        else
+        {
+            update_deformers(0, model_count);
+            update_meshes(0, range_count);
+        }
+    }
+};
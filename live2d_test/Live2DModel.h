@@ -0,0 +1,235 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "GeometryGenerator.h"
+
+namespace D3D
+{
+    class TaskScheduler;
+
+    // Final art mesh vertex as written to upload memory, in model space.
+    struct ArtMeshVertex
+    {
+        float x;
+        float y;
+        float u;
+        float v;
+    };
+
+    struct KeyformAxis
+    {
+        uint32_t parameter = 0xffffffff;
+        std::vector<float> keys;                            // ascending
+    };
+
+    // Keyforms of a deformer or art mesh laid out on a grid over one or more parameter axes, the
+    // first axis varying fastest: axes with 3 and 2 keys hold 6 keyforms. Every axis picks the
+    // two keys around its parameter value and the keyforms at the corners of that cell are
+    // blended multilinearly. No axes means one fixed keyform.
+    struct KeyformBinding
+    {
+        std::vector<KeyformAxis> axes;
+    };
+
+    // Bends its children through a grid of control points read as a tensor product Bézier
+    // patch (a free form deformation lattice). Children are placed in the unit square of the
+    // lattice, (0, 0) at the first control point and (1, 1) at the last.
+    struct WarpDeformerDesc
+    {
+        uint32_t parent = 0xffffffff;
+        uint32_t rows = 1;
+        uint32_t columns = 1;
+        KeyformBinding binding;
+        std::vector<float> points;                          // per keyform, (rows + 1) * (columns + 1) x, y pairs, row major
+        std::vector<float> opacities;                       // per keyform
+    };
+
+    struct RotationKeyform
+    {
+        float origin_x = 0.0f;
+        float origin_y = 0.0f;
+        float angle = 0.0f;                                 // degrees, counter clockwise
+        float scale = 1.0f;
+        float opacity = 1.0f;
+    };
+
+    // Rotates and scales its children around the origin, children are placed relative to it.
+    struct RotationDeformerDesc
+    {
+        uint32_t parent = 0xffffffff;
+        KeyformBinding binding;
+        std::vector<RotationKeyform> keyforms;
+    };
+
+    struct ArtMeshDesc
+    {
+        uint32_t parent = 0xffffffff;
+        KeyformBinding binding;
+        std::vector<float> positions;                       // per keyform, x, y pairs in the space of the parent deformer
+        std::vector<float> uvs;                             // u, v pairs
+        std::vector<uint16_t> indices;
+        std::vector<float> opacities;                       // per keyform
+    };
+
+    // A Live2D style 2D model: parameters drive the keyforms of a chain of warp and rotation
+    // deformers and of the art meshes hanging off them. Deformers must be added after their
+    // parent, so the deformer array is always in evaluation order.
+    //
+    // Update first blends the deformer keyforms, then every art mesh blends its own keyforms and
+    // runs its vertices up the deformer chain, four vertices per SIMD iteration. Art meshes are
+    // independent of each other and are spread across the task scheduler. Only the deformers
+    // and art meshes whose parameters changed since the last update, directly or through a
+    // parent deformer, are evaluated again.
+    class Live2DModel
+    {
+    public:
+        static const uint32_t INVALID_INDEX = 0xffffffff;
+        static const uint32_t MAX_LATTICE_DIVISIONS = 8;
+        static const uint32_t MAX_BINDING_AXES = 4;
+
+        // The x, y positions of a generated mesh as a single keyform, with its texture
+        // coordinates and indices. More keyforms can be appended to positions.
+        static ArtMeshDesc ArtMeshFromGeometry(const GeometryGenerator::MeshData& mesh);
+
+        void Clear();
+
+        uint32_t AddParameter(float minimum, float maximum, float default_value);
+        uint32_t AddWarpDeformer(const WarpDeformerDesc& desc);
+        uint32_t AddRotationDeformer(const RotationDeformerDesc& desc);
+        uint32_t AddArtMesh(const ArtMeshDesc& desc);
+
+        // Clamped to the parameter range. Only a changed value makes its keyforms dirty.
+        void SetParameter(uint32_t parameter, float value);
+        float GetParameter(uint32_t parameter) const;
+        void ResetParameters();
+
+        uint32_t GetParameterCount() const;
+        uint32_t GetDeformerCount() const;
+        uint32_t GetArtMeshCount() const;
+
+        // Art mesh vertices are written back to back, in the order the meshes were added.
+        uint32_t GetVertexCount() const;
+        uint32_t GetArtMeshVertexOffset(uint32_t mesh) const;
+        uint32_t GetArtMeshVertexCount(uint32_t mesh) const;
+        const std::vector<uint16_t>& GetArtMeshIndices(uint32_t mesh) const;
+
+        // Valid after Update.
+        float GetArtMeshOpacity(uint32_t mesh) const;
+        uint32_t GetUpdatedArtMeshCount() const;
+
+        // Evaluates everything again on the next update, e.g. after the destination moved.
+        void Invalidate();
+
+        // destination holds GetVertexCount() vertices. It is filled with streaming stores when
+        // it is 16 byte aligned, so it can point straight into an upload heap. Art meshes that
+        // did not change are not written, destination must still hold what the previous update
+        // wrote there, so use one persistently mapped buffer or call Invalidate.
+        void Update(ArtMeshVertex* destination, TaskScheduler* scheduler = nullptr);
+
+        // The two halves of Update, for batching many models. UpdateDeformers also decides which
+        // art meshes are dirty. UpdateArtMeshes may run on different threads for different
+        // meshes once UpdateDeformers returned.
+        void UpdateDeformers();
+        void UpdateArtMeshes(uint32_t begin, uint32_t end, ArtMeshVertex* destination);
+
+    private:
+        enum DeformerType { kWarpDeformer, kRotationDeformer };
+
+        struct BindingAxis
+        {
+            uint32_t parameter;
+            uint32_t key_offset;                            // into binding_keys_
+            uint32_t key_count;
+            uint32_t stride;                                // in keyforms
+        };
+
+        struct Binding
+        {
+            uint32_t axis_offset;                           // into binding_axes_
+            uint32_t axis_count;
+        };
+
+        // The keyforms at the corners of the current cell and their multilinear weights.
+        struct KeyformBlend
+        {
+            uint32_t count;
+            uint32_t keyforms[1 << MAX_BINDING_AXES];
+            float weights[1 << MAX_BINDING_AXES];
+        };
+
+        struct Deformer
+        {
+            DeformerType type;
+            uint32_t parent;
+            Binding binding;
+            uint32_t rows;
+            uint32_t columns;
+            uint32_t keyform_offset;                        // into keyform_data_
+            uint32_t keyform_size;                          // floats per keyform
+            uint32_t state_offset;                          // into deformer_state_
+        };
+
+        struct ArtMesh
+        {
+            uint32_t parent;
+            Binding binding;
+            uint32_t vertex_offset;
+            uint32_t vertex_count;
+            uint32_t keyform_offset;                        // into keyform_data_
+            uint32_t opacity_offset;                        // into keyform_data_
+            uint32_t uv_offset;                             // into uv_data_
+            std::vector<uint16_t> indices;
+        };
+
+        Binding AddBinding(const KeyformBinding& binding, uint32_t keyform_count);
+        void FindKeyforms(const Binding& binding, KeyformBlend& blend) const;
+        bool IsBindingDirty(const Binding& binding) const;
+        void UpdateArtMesh(uint32_t mesh, ArtMeshVertex* destination);
+
+        std::vector<float>                                  parameter_values_;
+        std::vector<float>                                  parameter_minimums_;
+        std::vector<float>                                  parameter_maximums_;
+        std::vector<float>                                  parameter_defaults_;
+        std::vector<uint8_t>                                parameter_dirty_;
+
+        std::vector<Deformer>                               deformers_;
+        std::vector<ArtMesh>                                art_meshes_;
+
+        // Keyform data is stored structure-of-arrays: all x, then all y of a keyform.
+        std::vector<BindingAxis>                            binding_axes_;
+        std::vector<float>                                  binding_keys_;
+        std::vector<float>                                  keyform_data_;
+        std::vector<float>                                  uv_data_;
+
+        // Blended deformer keyforms: warp control points (x then y), or origin, cos * scale,
+        // sin * scale for rotations, followed by the accumulated opacity.
+        std::vector<float>                                  deformer_state_;
+        std::vector<float>                                  art_mesh_opacities_;
+        uint32_t                                            vertex_count_ = 0;
+
+        std::vector<uint8_t>                                deformer_dirty_;
+        std::vector<uint8_t>                                art_mesh_dirty_;
+        uint32_t                                            updated_art_mesh_count_ = 0;
+        bool                                                all_dirty_ = true;
+    };
+
+    // Updates many models per frame, spreading both the deformers and the art meshes of all of
+    // them across the task scheduler.
+    class DeformerEngine
+    {
+    public:
+        void Update(Live2DModel* const* models, ArtMeshVertex* const* destinations, uint32_t model_count, TaskScheduler* scheduler = nullptr);
+
+    private:
+        struct MeshRange
+        {
+            uint32_t model;
+            uint32_t begin;
+            uint32_t end;
+        };
+
+        std::vector<MeshRange>                              mesh_ranges_;
+    };
+};
@@ -0,0 +1,129 @@
+#include "Live2DModel.h"
+
+#include <cstdio>
+#include <vector>
+
+#include "TaskScheduler.h"
+#include "TestHarness.h"
+
+using namespace D3D;
+
+namespace
+{
+    float Random(uint32_t& seed)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / 16777216.0f;
+    }
+
+    const uint32_t PARAMETER_COUNT = 40;
+    const uint32_t ROTATION_COUNT = 20;
+
+    // A character sized model: parameters driving rotation deformers, and art meshes hanging off
+    // them that are bound to one or two parameters of their own with three keys each.
+    void BuildModel(Live2DModel& model, uint32_t mesh_count, uint32_t vertex_count)
+    {
+        uint32_t seed = 4;
+        for (uint32_t p = 0; p < PARAMETER_COUNT; p++)
+        {
+            model.AddParameter(-1.0f, 1.0f, 0.0f);
+        }
+
+        for (uint32_t r = 0; r < ROTATION_COUNT; r++)
+        {
+            RotationDeformerDesc desc;
+            desc.parent = r == 0 ? Live2DModel::INVALID_INDEX : (r - 1) / 4;
+            KeyformAxis axis;
+            axis.parameter = r;
+            axis.keys = { -1.0f, 1.0f };
+            desc.binding.axes.push_back(axis);
+
+            RotationKeyform keyform;
+            keyform.origin_x = Random(seed);
+            keyform.origin_y = Random(seed);
+            keyform.angle = -10.0f;
+            desc.keyforms.push_back(keyform);
+            keyform.angle = 10.0f;
+            desc.keyforms.push_back(keyform);
+            model.AddRotationDeformer(desc);
+        }
+
+        for (uint32_t m = 0; m < mesh_count; m++)
+        {
+            ArtMeshDesc desc;
+            desc.parent = m % ROTATION_COUNT;
+            uint32_t axis_count = 1 + m % 2;
+            uint32_t keyform_count = 1;
+            for (uint32_t a = 0; a < axis_count; a++)
+            {
+                KeyformAxis axis;
+                axis.parameter = ROTATION_COUNT + (m * 3 + a * 7) % (PARAMETER_COUNT - ROTATION_COUNT);
+                axis.keys = { -1.0f, 0.0f, 1.0f };
+                desc.binding.axes.push_back(axis);
+                keyform_count *= 3;
+            }
+
+            for (uint32_t i = 0; i < keyform_count * vertex_count * 2; i++)
+            {
+                desc.positions.push_back(Random(seed));
+            }
+
+            desc.uvs.assign(vertex_count * 2, 0.5f);
+            desc.opacities.assign(keyform_count, 1.0f);
+            model.AddArtMesh(desc);
+        }
+    }
+}
+
+// Milliseconds per frame with every part evaluated each frame (Invalidate before every Update)
+// against updating only the parts whose parameters changed: two art mesh parameters, as a
+// blink and a mouth, or one rotation deformer parameter, as a head turn, which moves the
+// deformer and everything below it.
+int main()
+{
+    TaskScheduler scheduler;
+    std::printf("%u threads\n", scheduler.GetThreadCount());
+    std::printf("%-7s %-9s %-12s %9s %12s %12s\n", "meshes", "vertices", "change", "updated", "serial ms", "sched ms");
+
+    for (uint32_t mesh_count : { 100u, 400u, 1600u })
+    {
+        const uint32_t vertex_count = 128;
+        Live2DModel model;
+        BuildModel(model, mesh_count, vertex_count);
+        std::vector<ArtMeshVertex> vertices(model.GetVertexCount());
+
+        const char* changes[] = { "invalidate", "2 meshes", "head turn" };
+        for (uint32_t change = 0; change < 3; change++)
+        {
+            uint32_t frame = 0;
+            auto run_frame = [&](TaskScheduler* task_scheduler)
+            {
+                float value = (frame++ % 2) != 0 ? 0.5f : -0.5f;
+                if (change == 0)
+                {
+                    model.Invalidate();
+                }
+                else if (change == 1)
+                {
+                    model.SetParameter(ROTATION_COUNT, value);
+                    model.SetParameter(PARAMETER_COUNT - 1, value);
+                }
+                else
+                {
+                    model.SetParameter(1, value);
+                }
+
+                model.Update(vertices.data(), task_scheduler);
+            };
+
+            run_frame(nullptr);
+            uint32_t updated = model.GetUpdatedArtMeshCount();
+            double serial_ms = D3D::Test::MeasureMilliseconds(50, [&]() { run_frame(nullptr); });
+            double scheduler_ms = D3D::Test::MeasureMilliseconds(50, [&]() { run_frame(&scheduler); });
+
+            std::printf("%-7u %-9u %-12s %9u %12.4f %12.4f\n", mesh_count, model.GetVertexCount(), changes[change], updated, serial_ms, scheduler_ms);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,467 @@
+#include "Live2DModel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "TaskScheduler.h"
+#include "TestHarness.h"
+
+using namespace D3D;
+
+namespace
+{
+    float Random(uint32_t& seed)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / 16777216.0f;
+    }
+
+    // Room for the art mesh vertices at a 16 byte aligned address, where Update takes the
+    // streaming stores, or at one that is not, where it takes the plain ones.
+    struct Destination
+    {
+        std::vector<float> storage;
+        ArtMeshVertex* vertices = nullptr;
+
+        Destination(uint32_t vertex_count, bool aligned)
+            : storage(vertex_count * 4 + 8, -12345.0f)
+        {
+            float* base = storage.data();
+            while ((reinterpret_cast<uintptr_t>(base) & 15) != 0)
+            {
+                base++;
+            }
+
+            vertices = reinterpret_cast<ArtMeshVertex*>(aligned ? base : base + 1);
+        }
+    };
+
+    // Blends an art mesh without parent the plain way: for every axis the two keys around its
+    // parameter, clamped at the ends, and all 2^N corners of the cell summed in double, zero
+    // weights included.
+    void BlendReference(const Live2DModel& model, const ArtMeshDesc& desc, std::vector<double>& positions, double& opacity)
+    {
+        uint32_t axis_count = static_cast<uint32_t>(desc.binding.axes.size());
+        uint32_t lower[Live2DModel::MAX_BINDING_AXES] = {};
+        uint32_t upper[Live2DModel::MAX_BINDING_AXES] = {};
+        double weight[Live2DModel::MAX_BINDING_AXES] = {};
+        uint32_t stride[Live2DModel::MAX_BINDING_AXES] = {};
+
+        uint32_t keyform_stride = 1;
+        for (uint32_t a = 0; a < axis_count; a++)
+        {
+            const KeyformAxis& axis = desc.binding.axes[a];
+            double value = model.GetParameter(axis.parameter);
+            uint32_t key_count = static_cast<uint32_t>(axis.keys.size());
+            stride[a] = keyform_stride;
+            keyform_stride *= key_count;
+
+            if (value <= axis.keys.front())
+            {
+                lower[a] = upper[a] = 0;
+            }
+            else if (value >= axis.keys.back())
+            {
+                lower[a] = upper[a] = key_count - 1;
+            }
+            else
+            {
+                uint32_t k = 0;
+                while (value >= axis.keys[k + 1])
+                {
+                    k++;
+                }
+
+                lower[a] = k;
+                upper[a] = k + 1;
+                weight[a] = (value - axis.keys[k]) / (static_cast<double>(axis.keys[k + 1]) - axis.keys[k]);
+            }
+        }
+
+        uint32_t vertex_count = static_cast<uint32_t>(desc.uvs.size() / 2);
+        positions.assign(vertex_count * 2, 0.0);
+        opacity = 0.0;
+        for (uint32_t corner = 0; corner < (1u << axis_count); corner++)
+        {
+            uint32_t keyform = 0;
+            double corner_weight = 1.0;
+            for (uint32_t a = 0; a < axis_count; a++)
+            {
+                bool high = ((corner >> a) & 1) != 0;
+                keyform += (high ? upper[a] : lower[a]) * stride[a];
+                corner_weight *= high ? weight[a] : 1.0 - weight[a];
+            }
+
+            for (uint32_t i = 0; i < vertex_count * 2; i++)
+            {
+                positions[i] += corner_weight * desc.positions[keyform * vertex_count * 2 + i];
+            }
+
+            opacity += corner_weight * desc.opacities[keyform];
+        }
+    }
+
+    // Meshes bound to one to four axes of one to five keys, vertex counts that leave every
+    // partial group of four, parameter values on keys, between them and outside the key range.
+    void TestBlendMatchesReference()
+    {
+        const uint32_t parameter_count = 4;
+        const uint32_t key_counts[] = { 1, 2, 3, 5 };
+
+        for (uint32_t aligned = 0; aligned < 2; aligned++)
+        {
+            uint32_t seed = 21;
+            Live2DModel model;
+            for (uint32_t p = 0; p < parameter_count; p++)
+            {
+                model.AddParameter(-2.0f, 2.0f, 0.0f);
+            }
+
+            std::vector<ArtMeshDesc> descs;
+            for (uint32_t axis_count = 0; axis_count <= Live2DModel::MAX_BINDING_AXES; axis_count++)
+            {
+                for (uint32_t vertex_count = 1; vertex_count <= 9; vertex_count++)
+                {
+                    ArtMeshDesc desc;
+                    uint32_t keyform_count = 1;
+                    for (uint32_t a = 0; a < axis_count; a++)
+                    {
+                        KeyformAxis axis;
+                        axis.parameter = (a + vertex_count) % parameter_count;
+                        uint32_t key_count = key_counts[(a + vertex_count + axis_count) % 4];
+                        for (uint32_t k = 0; k < key_count; k++)
+                        {
+                            // Keys from -1 to 1, the parameters reach past both ends.
+                            axis.keys.push_back(key_count == 1 ? 0.0f : -1.0f + 2.0f * k / (key_count - 1));
+                        }
+
+                        keyform_count *= key_count;
+                        desc.binding.axes.push_back(axis);
+                    }
+
+                    for (uint32_t i = 0; i < keyform_count * vertex_count * 2; i++)
+                    {
+                        desc.positions.push_back(Random(seed) * 20.0f - 10.0f);
+                    }
+
+                    for (uint32_t i = 0; i < vertex_count * 2; i++)
+                    {
+                        desc.uvs.push_back(Random(seed));
+                    }
+
+                    for (uint32_t i = 0; i < keyform_count; i++)
+                    {
+                        desc.opacities.push_back(Random(seed));
+                    }
+
+                    model.AddArtMesh(desc);
+                    descs.push_back(desc);
+                }
+            }
+
+            Destination destination(model.GetVertexCount(), aligned != 0);
+            const float values[] = { -2.0f, -1.0f, -0.7f, -0.5f, 0.0f, 0.25f, 0.5f, 1.0f, 1.5f, 2.0f };
+            bool positions_match = true;
+            bool uvs_match = true;
+            bool opacities_match = true;
+            for (uint32_t frame = 0; frame < 40; frame++)
+            {
+                for (uint32_t p = 0; p < parameter_count; p++)
+                {
+                    model.SetParameter(p, values[(frame * (p + 1) + p * 3) % 10]);
+                }
+
+                model.Update(destination.vertices);
+
+                std::vector<double> positions;
+                double opacity;
+                for (uint32_t mesh = 0; mesh < model.GetArtMeshCount(); mesh++)
+                {
+                    BlendReference(model, descs[mesh], positions, opacity);
+                    const ArtMeshVertex* vertices = destination.vertices + model.GetArtMeshVertexOffset(mesh);
+                    for (uint32_t v = 0; v < model.GetArtMeshVertexCount(mesh); v++)
+                    {
+                        positions_match = positions_match && std::fabs(vertices[v].x - positions[v * 2]) <= 1e-4 &&
+                            std::fabs(vertices[v].y - positions[v * 2 + 1]) <= 1e-4;
+                        uvs_match = uvs_match && vertices[v].u == descs[mesh].uvs[v * 2] && vertices[v].v == descs[mesh].uvs[v * 2 + 1];
+                    }
+
+                    opacities_match = opacities_match && std::fabs(model.GetArtMeshOpacity(mesh) - opacity) <= 1e-5;
+                }
+            }
+
+            TEST_CHECK(positions_match);
+            TEST_CHECK(uvs_match);
+            TEST_CHECK(opacities_match);
+
+            // Nothing past the last vertex is written.
+            const float* end = reinterpret_cast<const float*>(destination.vertices + model.GetVertexCount());
+            TEST_CHECK(end[0] == -12345.0f);
+        }
+    }
+
+    ArtMeshDesc MakeQuad(uint32_t parent, int32_t parameter)
+    {
+        ArtMeshDesc desc;
+        desc.parent = parent;
+        desc.uvs = { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+        desc.indices = { 0, 1, 2, 2, 1, 3 };
+        desc.positions = { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+        desc.opacities = { 1.0f };
+        if (parameter >= 0)
+        {
+            KeyformAxis axis;
+            axis.parameter = static_cast<uint32_t>(parameter);
+            axis.keys = { 0.0f, 1.0f };
+            desc.binding.axes.push_back(axis);
+            desc.positions = { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 2.0f, 0.0f, 0.0f, 2.0f, 2.0f, 2.0f };
+            desc.opacities = { 1.0f, 0.5f };
+        }
+
+        return desc;
+    }
+
+    RotationDeformerDesc MakeRotation(uint32_t parent, int32_t parameter)
+    {
+        RotationDeformerDesc desc;
+        desc.parent = parent;
+        RotationKeyform keyform;
+        desc.keyforms.push_back(keyform);
+        if (parameter >= 0)
+        {
+            KeyformAxis axis;
+            axis.parameter = static_cast<uint32_t>(parameter);
+            axis.keys = { -1.0f, 1.0f };
+            desc.binding.axes.push_back(axis);
+            keyform.angle = 30.0f;
+            desc.keyforms.push_back(keyform);
+        }
+
+        return desc;
+    }
+
+    void TestUpdatedArtMeshCount()
+    {
+        // Parameters 0 and 1 drive rotation deformers, 1's under 0's, 2 and 3 drive meshes,
+        // 4 drives nothing.
+        Live2DModel model;
+        for (uint32_t p = 0; p < 5; p++)
+        {
+            model.AddParameter(-1.0f, 1.0f, 0.0f);
+        }
+
+        const uint32_t none = Live2DModel::INVALID_INDEX;
+        uint32_t r0 = model.AddRotationDeformer(MakeRotation(none, 0));
+        uint32_t r1 = model.AddRotationDeformer(MakeRotation(r0, 1));
+        uint32_t r2 = model.AddRotationDeformer(MakeRotation(none, -1));
+
+        uint32_t m0 = model.AddArtMesh(MakeQuad(r1, 2));            // parameters 0, 1 and 2
+        uint32_t m1 = model.AddArtMesh(MakeQuad(r0, -1));           // parameter 0
+        uint32_t m2 = model.AddArtMesh(MakeQuad(none, 3));          // parameter 3
+        model.AddArtMesh(MakeQuad(r2, -1));                         // never
+        model.AddArtMesh(MakeQuad(none, -1));                       // never
+        uint32_t mesh_count = model.GetArtMeshCount();
+
+        std::vector<ArtMeshVertex> vertices(model.GetVertexCount());
+        model.Update(vertices.data());
+        TEST_CHECK(model.GetUpdatedArtMeshCount() == mesh_count);
+
+        model.Update(vertices.data());
+        TEST_CHECK(model.GetUpdatedArtMeshCount() == 0);
+
+        // Setting the value a parameter already has, or one clamped to it, changes nothing.
+        model.SetParameter(3, 0.0f);
+        model.Update(vertices.data());
+        TEST_CHECK(model.GetUpdatedArtMeshCount() == 0);
+
+        model.SetParameter(3, 1.0f);
+        model.Update(vertices.data());
+        TEST_CHECK(model.GetUpdatedArtMeshCount() == 1);
+        model.SetParameter(3, 5.0f);
+        model.Update(vertices.data());
+        TEST_CHECK(model.GetUpdatedArtMeshCount() == 0);
+
+        model.SetParameter(4, 0.5f);
+        model.Update(vertices.data());
+        TEST_CHECK(model.GetUpdatedArtMeshCount() == 0);
+
+        // Only the changed meshes are written, the others keep what is in the destination.
+        std::vector<ArtMeshVertex> poisoned(vertices.size(), ArtMeshVertex{ -1.0f, -1.0f, -1.0f, -1.0f });
+        auto is_poisoned = [&](uint32_t mesh)
+        {
+            return poisoned[model.GetArtMeshVertexOffset(mesh)].x == -1.0f;
+        };
+
+        model.SetParameter(2, 0.5f);
+        model.Update(poisoned.data());
+        TEST_CHECK(model.GetUpdatedArtMeshCount() == 1);
+        TEST_CHECK(!is_poisoned(m0) && is_poisoned(m1) && is_poisoned(m2));
+
+        // Through the parent deformer of m0.
+        model.SetParameter(1, 0.5f);
+        model.Update(vertices.data());
+        TEST_CHECK(model.GetUpdatedArtMeshCount() == 1);
+
+        // Through the grandparent of m0 and the parent of m1.
+        model.SetParameter(0, -0.5f);
+        model.Update(vertices.data());
+        TEST_CHECK(model.GetUpdatedArtMeshCount() == 2);
+
+        model.SetParameter(0, 0.5f);
+        model.SetParameter(3, -1.0f);
+        model.Update(vertices.data());
+        TEST_CHECK(model.GetUpdatedArtMeshCount() == 3);
+
+        model.Invalidate();
+        model.Update(vertices.data());
+        TEST_CHECK(model.GetUpdatedArtMeshCount() == mesh_count);
+
+        // Sparse updates leave the same vertices as evaluating everything every time.
+        TaskScheduler scheduler(4);
+        std::vector<ArtMeshVertex> full(vertices.size());
+        uint32_t seed = 8;
+        bool same = true;
+        for (uint32_t frame = 0; frame < 50; frame++)
+        {
+            model.SetParameter(frame % 5, Random(seed) * 2.0f - 1.0f);
+            model.Update(vertices.data(), &scheduler);
+            model.Invalidate();
+            model.Update(full.data());
+            for (size_t v = 0; v < full.size(); v++)
+            {
+                same = same && full[v].x == vertices[v].x && full[v].y == vertices[v].y;
+            }
+        }
+
+        TEST_CHECK(same);
+    }
+
+    // A warp lattice with an art mesh under a rotation deformer inside it, evaluated by hand.
+    // The 2 x 2 warp maps the unit square to x = 10 + 4u, y = 20 + 2v while parameter 1 is 0,
+    // at 1 its center control point moves by (4, 8), which moves a point by
+    // (4, 8) * 2u(1 - u) * 2v(1 - v). The rotation turns -90 to 90 degrees over parameter 0
+    // around (0.5, 0.5) at half scale.
+    void BuildChain(Live2DModel& model)
+    {
+        model.AddParameter(-1.0f, 1.0f, 0.0f);
+        model.AddParameter(0.0f, 1.0f, 0.0f);
+
+        WarpDeformerDesc warp;
+        warp.rows = 2;
+        warp.columns = 2;
+        KeyformAxis axis;
+        axis.parameter = 1;
+        axis.keys = { 0.0f, 1.0f };
+        warp.binding.axes.push_back(axis);
+        for (uint32_t keyform = 0; keyform < 2; keyform++)
+        {
+            for (uint32_t row = 0; row <= 2; row++)
+            {
+                for (uint32_t column = 0; column <= 2; column++)
+                {
+                    bool center = keyform == 1 && row == 1 && column == 1;
+                    warp.points.push_back(10.0f + 2.0f * column + (center ? 4.0f : 0.0f));
+                    warp.points.push_back(20.0f + 1.0f * row + (center ? 8.0f : 0.0f));
+                }
+            }
+        }
+
+        warp.opacities = { 1.0f, 0.5f };
+        uint32_t warp_index = model.AddWarpDeformer(warp);
+
+        RotationDeformerDesc rotation;
+        rotation.parent = warp_index;
+        axis.parameter = 0;
+        axis.keys = { -1.0f, 1.0f };
+        rotation.binding.axes.push_back(axis);
+        RotationKeyform keyform;
+        keyform.origin_x = 0.5f;
+        keyform.origin_y = 0.5f;
+        keyform.scale = 0.5f;
+        keyform.angle = -90.0f;
+        rotation.keyforms.push_back(keyform);
+        keyform.angle = 90.0f;
+        keyform.opacity = 0.8f;
+        rotation.keyforms.push_back(keyform);
+        uint32_t rotation_index = model.AddRotationDeformer(rotation);
+
+        ArtMeshDesc mesh;
+        mesh.parent = rotation_index;
+        mesh.positions = { 0.0f, 0.0f, 0.4f, 0.0f, 0.0f, 0.4f, 0.4f, 0.4f, -0.2f, 0.6f };
+        mesh.uvs = { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 0.25f, 0.75f };
+        mesh.opacities = { 0.5f };
+        model.AddArtMesh(mesh);
+    }
+
+    bool MatchesChain(const ArtMeshVertex* vertices, const float* expected)
+    {
+        const float uvs[] = { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 0.25f, 0.75f };
+        bool near = true;
+        for (uint32_t v = 0; v < 5; v++)
+        {
+            near = near && std::fabs(vertices[v].x - expected[v * 2]) <= 1e-4f && std::fabs(vertices[v].y - expected[v * 2 + 1]) <= 1e-4f;
+            near = near && vertices[v].u == uvs[v * 2] && vertices[v].v == uvs[v * 2 + 1];
+        }
+
+        return near;
+    }
+
+    void TestDeformerChain()
+    {
+        // Turned 90 degrees, (x, y) -> (0.5 - 0.5y, 0.5 + 0.5x), through the plain warp.
+        const float turned[] = { 12.0f, 21.0f, 12.0f, 21.4f, 11.2f, 21.0f, 11.2f, 21.4f, 10.8f, 20.8f };
+
+        // Not turned, (x, y) -> (0.5 + 0.5x, 0.5 + 0.5y), through the bulging warp: (0.5, 0.5)
+        // moves by a quarter of the center point, (0.7, 0.5) and (0.5, 0.7) by 0.21 of it,
+        // (0.7, 0.7) by 0.1764 and (0.4, 0.8) by 0.1536.
+        const float bulged[] = { 13.0f, 23.0f, 13.64f, 22.68f, 12.84f, 23.08f, 13.5056f, 22.8112f, 12.2144f, 22.8288f };
+
+        Live2DModel model;
+        BuildChain(model);
+        Destination destination(model.GetVertexCount(), false);
+
+        model.SetParameter(0, 1.0f);
+        model.Update(destination.vertices);
+        TEST_CHECK(MatchesChain(destination.vertices, turned));
+        TEST_CHECK(std::fabs(model.GetArtMeshOpacity(0) - 0.5f * 0.8f) <= 1e-6f);
+
+        // Opacity is the product down the chain, 0.5 of the mesh, 0.9 of the rotation halfway
+        // between its keys and 0.5 of the warp.
+        model.SetParameter(0, 0.0f);
+        model.SetParameter(1, 1.0f);
+        model.Update(destination.vertices);
+        TEST_CHECK(MatchesChain(destination.vertices, bulged));
+        TEST_CHECK(std::fabs(model.GetArtMeshOpacity(0) - 0.5f * 0.9f * 0.5f) <= 1e-6f);
+
+        // The same through DeformerEngine, two models in the two poses, with and without a
+        // scheduler.
+        TaskScheduler scheduler(2);
+        for (TaskScheduler* engine_scheduler : { static_cast<TaskScheduler*>(nullptr), &scheduler })
+        {
+            Live2DModel models[2];
+            BuildChain(models[0]);
+            BuildChain(models[1]);
+            models[0].SetParameter(0, 1.0f);
+            models[1].SetParameter(1, 1.0f);
+
+            Live2DModel* model_pointers[] = { &models[0], &models[1] };
+            Destination aligned(5, true);
+            Destination misaligned(5, false);
+            ArtMeshVertex* destination_pointers[] = { aligned.vertices, misaligned.vertices };
+
+            DeformerEngine engine;
+            engine.Update(model_pointers, destination_pointers, 2, engine_scheduler);
+            TEST_CHECK(MatchesChain(aligned.vertices, turned));
+            TEST_CHECK(MatchesChain(misaligned.vertices, bulged));
+        }
+    }
+}
+
+int main()
+{
+    TestBlendMatchesReference();
+    TestUpdatedArtMeshCount();
+    TestDeformerChain();
+    return D3D::Test::Finish("Live2DModelTests");
+}
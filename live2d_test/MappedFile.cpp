@@ -0,0 +1,144 @@
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace D3D
+{
+    MappedFile::~MappedFile()
+    {
+        Close();
+    }
+
+#if defined(_WIN32)
+    bool MappedFile::Open(const char* path)
+    {
+        Close();
+
+        HANDLE file = ::CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        file_ = file;
+
+        LARGE_INTEGER file_size{};
+        if (!::GetFileSizeEx(file, &file_size) || file_size.QuadPart <= 0 || static_cast<uint64_t>(file_size.QuadPart) > SIZE_MAX)
+        {
+            Close();
+            return false;
+        }
+
+        HANDLE mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr)
+        {
+            Close();
+            return false;
+        }
+
+        mapping_ = mapping;
+
+        void* data = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (data == nullptr)
+        {
+            Close();
+            return false;
+        }
+
+        data_ = static_cast<const uint8_t*>(data);
+        size_ = static_cast<size_t>(file_size.QuadPart);
+        return true;
+    }
+
+    void MappedFile::Close()
+    {
+        if (data_ != nullptr)
+        {
+            ::UnmapViewOfFile(data_);
+        }
+
+        if (mapping_ != nullptr)
+        {
+            ::CloseHandle(mapping_);
+        }
+
+        if (file_ != nullptr)
+        {
+            ::CloseHandle(file_);
+        }
+
+        data_ = nullptr;
+        size_ = 0;
+        mapping_ = nullptr;
+        file_ = nullptr;
+    }
+#else
+    bool MappedFile::Open(const char* path)
+    {
+        Close();
+
+        file_ = ::open(path, O_RDONLY);
+        if (file_ < 0)
+        {
+            return false;
+        }
+
+        struct stat file_stat{};
+        if (::fstat(file_, &file_stat) != 0 || file_stat.st_size <= 0)
+        {
+            Close();
+            return false;
+        }
+
+        void* data = ::mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, file_, 0);
+        if (data == MAP_FAILED)
+        {
+            Close();
+            return false;
+        }
+
+        data_ = static_cast<const uint8_t*>(data);
+        size_ = static_cast<size_t>(file_stat.st_size);
+        return true;
+    }
+
+    void MappedFile::Close()
+    {
+        if (data_ != nullptr)
+        {
+            ::munmap(const_cast<uint8_t*>(data_), size_);
+        }
+
+        if (file_ >= 0)
+        {
+            ::close(file_);
+        }
+
+        data_ = nullptr;
+        size_ = 0;
+        file_ = -1;
+    }
+#endif
+
+    bool MappedFile::IsOpen() const
+    {
+        return data_ != nullptr;
+    }
+
+    const uint8_t* MappedFile::GetData() const
+    {
+        return data_;
+    }
+
+    size_t MappedFile::GetSize() const
+    {
+        return size_;
+    }
+};
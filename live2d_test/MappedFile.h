@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace D3D
+{
+    // Read only view of a whole file, mapped with MapViewOfFile on Windows and mmap elsewhere.
+    // Pages are read in by the OS on first touch, so opening costs the same for any file size.
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        // False when the file is missing, empty or cannot be mapped.
+        bool Open(const char* path);
+        void Close();
+
+        bool IsOpen() const;
+        const uint8_t* GetData() const;
+        size_t GetSize() const;
+
+    private:
+        const uint8_t*                                      data_ = nullptr;
+        size_t                                              size_ = 0;
+#if defined(_WIN32)
+        void*                                               file_ = nullptr;
+        void*                                               mapping_ = nullptr;
+#else
+        int                                                 file_ = -1;
+#endif
+    };
+};
@@ -1,8 +1,10 @@
 #pragma once
 
-#include <Windows.h>
-#include <DirectXMath.h>
+#include <cmath>
 #include <cstdint>
+#include <cstdlib>
+
+#include "PortableMath.h"
 
 class MathHelper
 {
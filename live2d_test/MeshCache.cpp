@@ -0,0 +1,545 @@
+#include "MeshCache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace D3D
+{
+    namespace
+    {
+        static_assert(sizeof(MeshCacheHeader) == 280, "the header is part of the file format");
+        static_assert(sizeof(MeshCacheSubmesh) == 60, "submeshes are part of the file format");
+        static_assert(sizeof(Meshlet) == 16, "meshlets are part of the file format");
+        static_assert(kMeshCacheVertexStream0 + VertexFormatDesc::MAX_STREAM_COUNT == kMeshCacheIndices, "one section per vertex stream");
+
+        // In file order.
+        std::vector<float> MeshletBounds::* const BOUNDS_FIELDS[] =
+        {
+            &MeshletBounds::center_x, &MeshletBounds::center_y, &MeshletBounds::center_z, &MeshletBounds::radius,
+            &MeshletBounds::apex_x, &MeshletBounds::apex_y, &MeshletBounds::apex_z,
+            &MeshletBounds::axis_x, &MeshletBounds::axis_y, &MeshletBounds::axis_z, &MeshletBounds::cutoff,
+        };
+
+        const uint32_t BOUNDS_FIELD_COUNT = sizeof(BOUNDS_FIELDS) / sizeof(BOUNDS_FIELDS[0]);
+
+        inline uint64_t AlignUp(uint64_t value, uint64_t alignment)
+        {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        // Section sizes the counts of a header call for.
+        void GetSectionSizes(const MeshCacheHeader& header, uint64_t sizes[kMeshCacheSectionCount])
+        {
+            sizes[kMeshCacheSubmeshes] = static_cast<uint64_t>(header.submesh_count) * sizeof(MeshCacheSubmesh);
+            for (uint32_t i = 0; i < VertexFormatDesc::MAX_STREAM_COUNT; i++)
+            {
+                sizes[kMeshCacheVertexStream0 + i] = i < header.stream_count ? static_cast<uint64_t>(header.vertex_count) * header.strides[i] : 0;
+            }
+
+            sizes[kMeshCacheIndices] = static_cast<uint64_t>(header.index_count) * header.index_size;
+            sizes[kMeshCacheMeshlets] = static_cast<uint64_t>(header.meshlet_count) * sizeof(Meshlet);
+            sizes[kMeshCacheMeshletVertices] = static_cast<uint64_t>(header.meshlet_vertex_count) * sizeof(uint32_t);
+            sizes[kMeshCacheMeshletTriangles] = static_cast<uint64_t>(header.meshlet_triangle_count) * 3;
+            sizes[kMeshCacheMeshletIndices] = static_cast<uint64_t>(header.meshlet_triangle_count) * 3 * sizeof(uint32_t);
+            sizes[kMeshCacheMeshletBounds] = static_cast<uint64_t>(header.meshlet_count) * BOUNDS_FIELD_COUNT * sizeof(float);
+        }
+    }
+
+    MeshCacheWriter::MeshCacheWriter(const VertexFormatDesc& format) :
+        format_(format)
+    {
+    }
+
+    uint32_t MeshCacheWriter::AddMesh(const GeometryGenerator::MeshData& mesh, uint32_t lod_level, float lod_error, const MeshletData* meshlets)
+    {
+        MeshCacheSubmesh submesh{};
+        submesh.index_count = static_cast<uint32_t>(mesh.GetIndexCount());
+        submesh.start_index = static_cast<uint32_t>(indices_.size());
+        submesh.base_vertex = static_cast<uint32_t>(vertices_.size());
+        submesh.vertex_count = static_cast<uint32_t>(mesh.Vertices.size());
+        submesh.lod_level = lod_level;
+        submesh.lod_error = lod_error;
+        submesh.first_meshlet = static_cast<uint32_t>(meshlets_.meshlets.size());
+
+        if (!mesh.Vertices.empty())
+        {
+            std::fill(std::begin(submesh.bounds_min), std::end(submesh.bounds_min), FLT_MAX);
+            std::fill(std::begin(submesh.bounds_max), std::end(submesh.bounds_max), -FLT_MAX);
+        }
+
+        float max_length_sq = 0.0f;
+        for (auto& vertex : mesh.Vertices)
+        {
+            const float* position = &vertex.Position.x;
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                submesh.bounds_min[k] = (std::min)(submesh.bounds_min[k], position[k]);
+                submesh.bounds_max[k] = (std::max)(submesh.bounds_max[k], position[k]);
+            }
+
+            max_length_sq = (std::max)(max_length_sq, position[0] * position[0] + position[1] * position[1] + position[2] * position[2]);
+        }
+
+        submesh.bounding_radius = sqrtf(max_length_sq);
+
+        vertices_.insert(vertices_.end(), mesh.Vertices.begin(), mesh.Vertices.end());
+        if (mesh.Use32BitIndices)
+        {
+            indices_.insert(indices_.end(), mesh.Indices32.begin(), mesh.Indices32.end());
+        }
+        else
+        {
+            indices_.insert(indices_.end(), mesh.Indices16.begin(), mesh.Indices16.end());
+        }
+
+        use_32bit_indices_ = use_32bit_indices_ || mesh.Use32BitIndices;
+
+        // Meshlet offsets move past the meshlets of the meshes before, their vertices stay
+        // relative to the base vertex like the indices.
+        if (meshlets != nullptr)
+        {
+            uint32_t vertex_base = static_cast<uint32_t>(meshlets_.vertices.size());
+            uint32_t triangle_base = static_cast<uint32_t>(meshlets_.triangles.size() / 3);
+            for (Meshlet meshlet : meshlets->meshlets)
+            {
+                meshlet.vertex_offset += vertex_base;
+                meshlet.triangle_offset += triangle_base;
+                meshlets_.meshlets.push_back(meshlet);
+            }
+
+            meshlets_.vertices.insert(meshlets_.vertices.end(), meshlets->vertices.begin(), meshlets->vertices.end());
+            meshlets_.triangles.insert(meshlets_.triangles.end(), meshlets->triangles.begin(), meshlets->triangles.end());
+            meshlets_.indices.insert(meshlets_.indices.end(), meshlets->indices.begin(), meshlets->indices.end());
+            for (auto field : BOUNDS_FIELDS)
+            {
+                auto& destination = meshlets_.bounds.*field;
+                auto& source = meshlets->bounds.*field;
+                destination.insert(destination.end(), source.begin(), source.end());
+            }
+
+            submesh.meshlet_count = static_cast<uint32_t>(meshlets->meshlets.size());
+        }
+
+        submeshes_.push_back(submesh);
+        return static_cast<uint32_t>(submeshes_.size() - 1);
+    }
+
+    void MeshCacheWriter::AddLodChain(const std::vector<MeshLod>& lods)
+    {
+        for (uint32_t i = 0; i < lods.size(); i++)
+        {
+            AddMesh(lods[i].mesh, i, lods[i].error);
+        }
+    }
+
+    void MeshCacheWriter::Serialize(uint32_t content_version, std::vector<uint8_t>& image) const
+    {
+        MeshCacheHeader header{};
+        header.magic = MeshCacheHeader::MAGIC;
+        header.version = MeshCacheHeader::VERSION;
+        header.header_size = sizeof(MeshCacheHeader);
+        header.content_version = content_version;
+        header.vertex_count = static_cast<uint32_t>(vertices_.size());
+        header.index_count = static_cast<uint32_t>(indices_.size());
+        header.index_size = use_32bit_indices_ ? sizeof(uint32_t) : sizeof(uint16_t);
+        header.submesh_count = static_cast<uint32_t>(submeshes_.size());
+        header.meshlet_count = static_cast<uint32_t>(meshlets_.meshlets.size());
+        header.meshlet_vertex_count = static_cast<uint32_t>(meshlets_.vertices.size());
+        header.meshlet_triangle_count = static_cast<uint32_t>(meshlets_.triangles.size() / 3);
+        header.stream_count = format_.stream_count;
+        std::copy(std::begin(format_.strides), std::end(format_.strides), header.strides);
+
+        const VertexElementDesc* elements[] = { &format_.position, &format_.normal, &format_.tangent, &format_.texcoord };
+        for (uint32_t e = 0; e < VertexFormatDesc::ELEMENT_COUNT; e++)
+        {
+            header.elements[e] = { static_cast<uint32_t>(elements[e]->format), elements[e]->offset, elements[e]->stream };
+        }
+
+        VertexQuantization quantization = VertexCodec::ComputeQuantization(vertices_.data(), header.vertex_count);
+        std::copy(std::begin(quantization.scale), std::end(quantization.scale), header.quantization_scale);
+        std::copy(std::begin(quantization.offset), std::end(quantization.offset), header.quantization_offset);
+
+        uint64_t sizes[kMeshCacheSectionCount];
+        GetSectionSizes(header, sizes);
+
+        uint64_t file_size = sizeof(MeshCacheHeader);
+        for (uint32_t s = 0; s < kMeshCacheSectionCount; s++)
+        {
+            if (sizes[s] != 0)
+            {
+                file_size = AlignUp(file_size, MeshCacheHeader::ALIGNMENT);
+                header.sections[s] = { file_size, sizes[s] };
+                file_size += sizes[s];
+            }
+        }
+
+        header.file_size = file_size;
+
+        // Padding between sections stays zero, so equal meshes give equal files.
+        image.assign(static_cast<size_t>(file_size), 0);
+        auto section_data = [&](MeshCacheSection section)
+        {
+            return image.data() + header.sections[section].offset;
+        };
+
+        ::memcpy(image.data(), &header, sizeof(header));
+        if (!submeshes_.empty())
+        {
+            ::memcpy(section_data(kMeshCacheSubmeshes), submeshes_.data(), sizes[kMeshCacheSubmeshes]);
+        }
+
+        if (!vertices_.empty())
+        {
+            void* streams[VertexFormatDesc::MAX_STREAM_COUNT] = {};
+            for (uint32_t i = 0; i < format_.stream_count; i++)
+            {
+                streams[i] = section_data(static_cast<MeshCacheSection>(kMeshCacheVertexStream0 + i));
+            }
+
+            VertexCodec::Encode(format_, quantization, vertices_.data(), header.vertex_count, streams);
+        }
+
+        if (!indices_.empty())
+        {
+            if (use_32bit_indices_)
+            {
+                ::memcpy(section_data(kMeshCacheIndices), indices_.data(), sizes[kMeshCacheIndices]);
+            }
+            else
+            {
+                uint16_t* indices16 = reinterpret_cast<uint16_t*>(section_data(kMeshCacheIndices));
+                for (size_t i = 0; i < indices_.size(); i++)
+                {
+                    indices16[i] = static_cast<uint16_t>(indices_[i]);
+                }
+            }
+        }
+
+        if (!meshlets_.meshlets.empty())
+        {
+            ::memcpy(section_data(kMeshCacheMeshlets), meshlets_.meshlets.data(), sizes[kMeshCacheMeshlets]);
+            ::memcpy(section_data(kMeshCacheMeshletVertices), meshlets_.vertices.data(), sizes[kMeshCacheMeshletVertices]);
+            ::memcpy(section_data(kMeshCacheMeshletTriangles), meshlets_.triangles.data(), sizes[kMeshCacheMeshletTriangles]);
+            ::memcpy(section_data(kMeshCacheMeshletIndices), meshlets_.indices.data(), sizes[kMeshCacheMeshletIndices]);
+
+            float* bounds = reinterpret_cast<float*>(section_data(kMeshCacheMeshletBounds));
+            for (auto field : BOUNDS_FIELDS)
+            {
+                auto& values = meshlets_.bounds.*field;
+                assert(values.size() == header.meshlet_count);
+                ::memcpy(bounds, values.data(), values.size() * sizeof(float));
+                bounds += header.meshlet_count;
+            }
+        }
+    }
+
+    bool MeshCacheWriter::Write(const char* path, uint32_t content_version) const
+    {
+        std::vector<uint8_t> image;
+        Serialize(content_version, image);
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            return false;
+        }
+
+        file.write(reinterpret_cast<const char*>(image.data()), static_cast<std::streamsize>(image.size()));
+        file.close();
+        return !file.fail();
+    }
+
+    bool MeshCacheReader::Open(const char* path, bool validate_contents)
+    {
+        Close();
+        error_ = "";
+
+        if (!file_.Open(path))
+        {
+            return Fail("cannot map the file");
+        }
+
+        data_ = file_.GetData();
+        size_ = file_.GetSize();
+        return Validate(validate_contents);
+    }
+
+    bool MeshCacheReader::Open(const void* data, size_t size, bool validate_contents)
+    {
+        Close();
+        error_ = "";
+
+        data_ = static_cast<const uint8_t*>(data);
+        size_ = size;
+        return Validate(validate_contents);
+    }
+
+    void MeshCacheReader::Close()
+    {
+        file_.Close();
+        data_ = nullptr;
+        size_ = 0;
+        header_ = nullptr;
+        submeshes_ = nullptr;
+    }
+
+    const char* MeshCacheReader::GetError() const
+    {
+        return error_;
+    }
+
+    const MeshCacheHeader& MeshCacheReader::GetHeader() const
+    {
+        assert(header_ != nullptr);
+        return *header_;
+    }
+
+    uint32_t MeshCacheReader::GetSubmeshCount() const
+    {
+        return header_ != nullptr ? header_->submesh_count : 0;
+    }
+
+    const MeshCacheSubmesh& MeshCacheReader::GetSubmesh(uint32_t index) const
+    {
+        assert(index < GetSubmeshCount());
+        return submeshes_[index];
+    }
+
+    VertexFormatDesc MeshCacheReader::GetFormat() const
+    {
+        assert(header_ != nullptr);
+
+        VertexFormatDesc format = VertexFormatDesc::Full();
+        VertexElementDesc* elements[] = { &format.position, &format.normal, &format.tangent, &format.texcoord };
+        for (uint32_t e = 0; e < VertexFormatDesc::ELEMENT_COUNT; e++)
+        {
+            elements[e]->format = static_cast<VertexElementFormat>(header_->elements[e].format);
+            elements[e]->offset = header_->elements[e].offset;
+            elements[e]->stream = header_->elements[e].stream;
+        }
+
+        std::copy(std::begin(header_->strides), std::end(header_->strides), format.strides);
+        format.stream_count = header_->stream_count;
+        return format;
+    }
+
+    VertexQuantization MeshCacheReader::GetQuantization() const
+    {
+        assert(header_ != nullptr);
+
+        VertexQuantization quantization;
+        std::copy(std::begin(header_->quantization_scale), std::end(header_->quantization_scale), quantization.scale);
+        std::copy(std::begin(header_->quantization_offset), std::end(header_->quantization_offset), quantization.offset);
+        return quantization;
+    }
+
+    const void* MeshCacheReader::GetSection(MeshCacheSection section) const
+    {
+        assert(header_ != nullptr);
+        auto& desc = header_->sections[section];
+        return desc.size != 0 ? data_ + desc.offset : nullptr;
+    }
+
+    uint64_t MeshCacheReader::GetSectionSize(MeshCacheSection section) const
+    {
+        assert(header_ != nullptr);
+        return header_->sections[section].size;
+    }
+
+    void MeshCacheReader::ReadMeshlets(uint32_t submesh, MeshletData& meshlets) const
+    {
+        meshlets = MeshletData();
+
+        auto& desc = GetSubmesh(submesh);
+        if (desc.meshlet_count == 0)
+        {
+            return;
+        }
+
+        // Validate made sure the meshlets of a submesh are packed back to back.
+        const Meshlet* first = static_cast<const Meshlet*>(GetSection(kMeshCacheMeshlets)) + desc.first_meshlet;
+        const Meshlet* last = first + desc.meshlet_count - 1;
+        uint32_t vertex_begin = first->vertex_offset;
+        uint32_t vertex_end = last->vertex_offset + last->vertex_count;
+        uint32_t triangle_begin = first->triangle_offset;
+        uint32_t triangle_end = last->triangle_offset + last->triangle_count;
+
+        meshlets.meshlets.assign(first, last + 1);
+        for (auto& meshlet : meshlets.meshlets)
+        {
+            meshlet.vertex_offset -= vertex_begin;
+            meshlet.triangle_offset -= triangle_begin;
+        }
+
+        const uint32_t* vertices = static_cast<const uint32_t*>(GetSection(kMeshCacheMeshletVertices));
+        const uint8_t* triangles = static_cast<const uint8_t*>(GetSection(kMeshCacheMeshletTriangles));
+        const uint32_t* indices = static_cast<const uint32_t*>(GetSection(kMeshCacheMeshletIndices));
+        meshlets.vertices.assign(vertices + vertex_begin, vertices + vertex_end);
+        meshlets.triangles.assign(triangles + triangle_begin * 3, triangles + triangle_end * 3);
+        meshlets.indices.assign(indices + triangle_begin * 3, indices + triangle_end * 3);
+
+        const float* bounds = static_cast<const float*>(GetSection(kMeshCacheMeshletBounds)) + desc.first_meshlet;
+        for (auto field : BOUNDS_FIELDS)
+        {
+            (meshlets.bounds.*field).assign(bounds, bounds + desc.meshlet_count);
+            bounds += header_->meshlet_count;
+        }
+    }
+
+    bool MeshCacheReader::Validate(bool validate_contents)
+    {
+        if (reinterpret_cast<uintptr_t>(data_) % alignof(MeshCacheHeader) != 0)
+        {
+            return Fail("data is not aligned for the header");
+        }
+
+        if (size_ < sizeof(MeshCacheHeader))
+        {
+            return Fail("file is smaller than the header");
+        }
+
+        header_ = reinterpret_cast<const MeshCacheHeader*>(data_);
+        if (header_->magic != MeshCacheHeader::MAGIC)
+        {
+            return Fail("not a mesh cache");
+        }
+
+        if (header_->version != MeshCacheHeader::VERSION || header_->header_size != sizeof(MeshCacheHeader))
+        {
+            return Fail("unsupported version");
+        }
+
+        if (header_->file_size != size_)
+        {
+            return Fail("file size does not match the header");
+        }
+
+        if (header_->stream_count == 0 || header_->stream_count > VertexFormatDesc::MAX_STREAM_COUNT ||
+            (header_->index_size != sizeof(uint16_t) && header_->index_size != sizeof(uint32_t)))
+        {
+            return Fail("bad vertex or index format");
+        }
+
+        for (auto& element : header_->elements)
+        {
+            if (element.format > kVertexOctahedral16 || element.stream >= header_->stream_count ||
+                element.offset + VertexFormatDesc::GetElementSize(static_cast<VertexElementFormat>(element.format)) > header_->strides[element.stream])
+            {
+                return Fail("bad vertex element");
+            }
+        }
+
+        uint64_t sizes[kMeshCacheSectionCount];
+        GetSectionSizes(*header_, sizes);
+        for (uint32_t s = 0; s < kMeshCacheSectionCount; s++)
+        {
+            auto& section = header_->sections[s];
+            if (section.size != sizes[s])
+            {
+                return Fail("section size does not match its count");
+            }
+
+            if (section.size != 0 && (section.offset % MeshCacheHeader::ALIGNMENT != 0 || section.offset < sizeof(MeshCacheHeader) ||
+                section.offset > size_ || section.size > size_ - section.offset))
+            {
+                return Fail("section outside the file");
+            }
+        }
+
+        submeshes_ = static_cast<const MeshCacheSubmesh*>(GetSection(kMeshCacheSubmeshes));
+
+        // Ranges only, the meshlet headers are small enough to always check.
+        const Meshlet* meshlets = static_cast<const Meshlet*>(GetSection(kMeshCacheMeshlets));
+        for (uint32_t i = 0; i < header_->submesh_count; i++)
+        {
+            auto& submesh = submeshes_[i];
+            if (static_cast<uint64_t>(submesh.start_index) + submesh.index_count > header_->index_count ||
+                static_cast<uint64_t>(submesh.base_vertex) + submesh.vertex_count > header_->vertex_count ||
+                static_cast<uint64_t>(submesh.first_meshlet) + submesh.meshlet_count > header_->meshlet_count ||
+                submesh.index_count % 3 != 0)
+            {
+                return Fail("submesh outside the buffers");
+            }
+
+            uint64_t vertex_end = submesh.meshlet_count != 0 ? meshlets[submesh.first_meshlet].vertex_offset : 0;
+            uint64_t triangle_end = submesh.meshlet_count != 0 ? meshlets[submesh.first_meshlet].triangle_offset : 0;
+            for (uint32_t m = submesh.first_meshlet; m < submesh.first_meshlet + submesh.meshlet_count; m++)
+            {
+                auto& meshlet = meshlets[m];
+                if (meshlet.vertex_offset != vertex_end || meshlet.triangle_offset != triangle_end)
+                {
+                    return Fail("meshlets of a submesh are not packed");
+                }
+
+                vertex_end += meshlet.vertex_count;
+                triangle_end += meshlet.triangle_count;
+            }
+
+            if (vertex_end > header_->meshlet_vertex_count || triangle_end > header_->meshlet_triangle_count)
+            {
+                return Fail("meshlet outside the buffers");
+            }
+        }
+
+        return validate_contents ? ValidateContents() : true;
+    }
+
+    bool MeshCacheReader::ValidateContents()
+    {
+        const void* indices = GetSection(kMeshCacheIndices);
+        const Meshlet* meshlets = static_cast<const Meshlet*>(GetSection(kMeshCacheMeshlets));
+        const uint32_t* meshlet_vertices = static_cast<const uint32_t*>(GetSection(kMeshCacheMeshletVertices));
+        const uint8_t* meshlet_triangles = static_cast<const uint8_t*>(GetSection(kMeshCacheMeshletTriangles));
+        const uint32_t* meshlet_indices = static_cast<const uint32_t*>(GetSection(kMeshCacheMeshletIndices));
+
+        for (uint32_t i = 0; i < header_->submesh_count; i++)
+        {
+            auto& submesh = submeshes_[i];
+
+            uint32_t max_index = 0;
+            for (uint32_t k = submesh.start_index; k < submesh.start_index + submesh.index_count; k++)
+            {
+                uint32_t index = header_->index_size == sizeof(uint16_t) ? static_cast<const uint16_t*>(indices)[k] : static_cast<const uint32_t*>(indices)[k];
+                max_index = (std::max)(max_index, index);
+            }
+
+            if (submesh.index_count != 0 && max_index >= submesh.vertex_count)
+            {
+                return Fail("index outside its submesh");
+            }
+
+            for (uint32_t m = submesh.first_meshlet; m < submesh.first_meshlet + submesh.meshlet_count; m++)
+            {
+                auto& meshlet = meshlets[m];
+                for (uint32_t v = meshlet.vertex_offset; v < meshlet.vertex_offset + meshlet.vertex_count; v++)
+                {
+                    if (meshlet_vertices[v] >= submesh.vertex_count)
+                    {
+                        return Fail("meshlet vertex outside its submesh");
+                    }
+                }
+
+                for (uint32_t t = meshlet.triangle_offset * 3; t < (meshlet.triangle_offset + meshlet.triangle_count) * 3; t++)
+                {
+                    if (meshlet_triangles[t] >= meshlet.vertex_count || meshlet_indices[t] >= submesh.vertex_count)
+                    {
+                        return Fail("meshlet triangle outside its meshlet");
+                    }
+                }
+            }
+        }
+
+        return true;
+    }
+
+    bool MeshCacheReader::Fail(const char* error)
+    {
+        Close();
+        error_ = error;
+        return false;
+    }
+};
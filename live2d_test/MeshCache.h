@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "GeometryGenerator.h"
+#include "MappedFile.h"
+#include "MeshLod.h"
+#include "Meshlet.h"
+#include "VertexFormat.h"
+
+namespace D3D
+{
+    // Binary mesh container. The file is a MeshCacheHeader followed by the sections it lists,
+    // each starting on a MeshCacheHeader::ALIGNMENT boundary. Vertex streams and indices are
+    // stored the way the input assembler reads them, so a mapped file is handed to the upload
+    // path as is. Little endian; all fields are 32 bit except the 64 bit section offsets and
+    // sizes.
+    enum MeshCacheSection
+    {
+        kMeshCacheSubmeshes,                                // MeshCacheSubmesh
+        kMeshCacheVertexStream0,                            // one per VertexFormatDesc stream
+        kMeshCacheVertexStream1,
+        kMeshCacheIndices,                                  // uint16_t or uint32_t, relative to the base vertex
+        kMeshCacheMeshlets,                                 // Meshlet, offsets into the two sections below
+        kMeshCacheMeshletVertices,                          // uint32_t, relative to the base vertex
+        kMeshCacheMeshletTriangles,                         // three uint8_t per triangle
+        kMeshCacheMeshletIndices,                           // three uint32_t per triangle, relative to the base vertex
+        kMeshCacheMeshletBounds,                            // the MeshletBounds arrays one after another
+        kMeshCacheSectionCount,
+    };
+
+    struct MeshCacheSectionDesc
+    {
+        uint64_t offset;                                    // from the start of the file, 0 when empty
+        uint64_t size;
+    };
+
+    struct MeshCacheElement
+    {
+        uint32_t format;                                    // VertexElementFormat
+        uint32_t offset;
+        uint32_t stream;
+    };
+
+    struct MeshCacheHeader
+    {
+        static const uint32_t MAGIC = 0x4853454D;           // "MESH"
+        static const uint32_t VERSION = 1;
+        static const uint32_t ALIGNMENT = 64;
+
+        uint32_t magic;
+        uint32_t version;
+        uint32_t header_size;
+        uint32_t content_version;                           // chosen by the writer, for callers to spot stale files
+        uint64_t file_size;
+        uint32_t vertex_count;
+        uint32_t index_count;
+        uint32_t index_size;                                // 2 or 4
+        uint32_t submesh_count;
+        uint32_t meshlet_count;
+        uint32_t meshlet_vertex_count;
+        uint32_t meshlet_triangle_count;
+        uint32_t stream_count;
+        uint32_t strides[VertexFormatDesc::MAX_STREAM_COUNT];
+        MeshCacheElement elements[VertexFormatDesc::ELEMENT_COUNT];    // position, normal, tangent, texcoord
+        float quantization_scale[3];
+        float quantization_offset[3];
+        MeshCacheSectionDesc sections[kMeshCacheSectionCount];
+    };
+
+    // One mesh or one level of detail of it. Levels of a mesh follow each other, lod_level 0
+    // starts the next mesh.
+    struct MeshCacheSubmesh
+    {
+        uint32_t index_count;
+        uint32_t start_index;
+        uint32_t base_vertex;
+        uint32_t vertex_count;
+        uint32_t lod_level;
+        float lod_error;                                    // MeshLod::error
+        uint32_t first_meshlet;
+        uint32_t meshlet_count;
+        float bounds_min[3];
+        float bounds_max[3];
+        float bounding_radius;                              // around the mesh origin
+    };
+
+    // Collects meshes into one vertex and index buffer and writes them out. Vertices are encoded
+    // into format when written, with one quantization over all meshes. Indices are 32 bit as
+    // soon as one mesh needs it.
+    class MeshCacheWriter
+    {
+    public:
+        explicit MeshCacheWriter(const VertexFormatDesc& format = VertexFormatDesc::Full());
+
+        // meshlets, when given, have to be built on the indices of mesh. Returns the submesh index.
+        uint32_t AddMesh(const GeometryGenerator::MeshData& mesh, uint32_t lod_level = 0, float lod_error = 0.0f, const MeshletData* meshlets = nullptr);
+        void AddLodChain(const std::vector<MeshLod>& lods);
+
+        void Serialize(uint32_t content_version, std::vector<uint8_t>& image) const;
+        bool Write(const char* path, uint32_t content_version) const;
+
+    private:
+        VertexFormatDesc                                    format_;
+        std::vector<GeometryGenerator::Vertex>              vertices_;
+        std::vector<uint32_t>                               indices_;
+        bool                                                use_32bit_indices_ = false;
+        std::vector<MeshCacheSubmesh>                       submeshes_;
+        MeshletData                                         meshlets_;          // offsets over all meshes
+    };
+
+    // Maps a cache and hands out pointers straight into it, nothing is copied or converted. The
+    // pointers stay valid until Close or the next Open, an upload posted from them has to finish
+    // before that.
+    class MeshCacheReader
+    {
+    public:
+        // The header is checked, and that every section has the size its counts give and lies
+        // inside the file. validate_contents also checks every index and meshlet against the
+        // ranges of its submesh, which reads the whole file.
+        bool Open(const char* path, bool validate_contents = false);
+
+        // Same over memory the caller keeps alive, aligned to at least 8 bytes.
+        bool Open(const void* data, size_t size, bool validate_contents = false);
+        void Close();
+
+        // Why the last Open failed.
+        const char* GetError() const;
+
+        const MeshCacheHeader& GetHeader() const;
+        uint32_t GetSubmeshCount() const;
+        const MeshCacheSubmesh& GetSubmesh(uint32_t index) const;
+
+        // Semantic names are the ones VertexFormatDesc::Full uses.
+        VertexFormatDesc GetFormat() const;
+        VertexQuantization GetQuantization() const;
+
+        // Null for empty sections.
+        const void* GetSection(MeshCacheSection section) const;
+        uint64_t GetSectionSize(MeshCacheSection section) const;
+
+        // Copies the meshlets of a submesh out in the layout MeshletBuilder produces.
+        void ReadMeshlets(uint32_t submesh, MeshletData& meshlets) const;
+
+    private:
+        bool Validate(bool validate_contents);
+        bool ValidateContents();
+        bool Fail(const char* error);
+
+        MappedFile                                          file_;
+        const uint8_t*                                      data_ = nullptr;
+        size_t                                              size_ = 0;
+        const MeshCacheHeader*                              header_ = nullptr;
+        const MeshCacheSubmesh*                             submeshes_ = nullptr;
+        const char*                                         error_ = "";
+    };
+};
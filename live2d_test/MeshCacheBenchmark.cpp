@@ -0,0 +1,69 @@
+#include "MeshCache.h"
+
+#include <cstdio>
+#include <vector>
+
+#include "TestHarness.h"
+
+using namespace D3D;
+
+namespace
+{
+    // What a cache holds for one mesh: the mesh, its meshlets and a lod chain of four levels.
+    void Regenerate(uint32_t n, MeshCacheWriter* writer)
+    {
+        GeometryGenerator generator;
+        GeometryGenerator::MeshData sphere = generator.CreateSphere(1.0f, n, n);
+
+        MeshletBuilder builder;
+        MeshletData meshlets;
+        builder.Build(sphere, meshlets);
+
+        MeshSimplifier simplifier;
+        std::vector<MeshLod> lods = simplifier.BuildLodChain(sphere, 4);
+        if (writer != nullptr)
+        {
+            writer->AddMesh(sphere, 0, 0.0f, &meshlets);
+            for (uint32_t i = 1; i < lods.size(); i++)
+            {
+                writer->AddMesh(lods[i].mesh, i, lods[i].error);
+            }
+        }
+    }
+}
+
+// Milliseconds to get a sphere of n x n rings with its meshlets and lod chain: generated,
+// built and simplified again, against opening a cache written from the same data, with only
+// the header and section ranges checked and with every index and meshlet checked. The file is
+// in the OS cache after the first open, so the open columns leave out the disk.
+int main()
+{
+    const char* path = "MeshCacheBenchmark.cache";
+    std::printf("%-6s %10s %10s %14s %10s %14s\n", "n", "vertices", "file KB", "regenerate ms", "open ms", "validate ms");
+
+    for (uint32_t n : { 32u, 64u, 128u, 256u })
+    {
+        MeshCacheWriter writer;
+        Regenerate(n, &writer);
+        if (!writer.Write(path, 1))
+        {
+            std::printf("cannot write %s\n", path);
+            return 1;
+        }
+
+        MeshCacheReader reader;
+        bool opened = reader.Open(path, true);
+        uint32_t vertex_count = opened ? reader.GetHeader().vertex_count : 0;
+        double file_kb = opened ? reader.GetHeader().file_size / 1024.0 : 0.0;
+
+        uint32_t repeat = 512 / n;
+        double regenerate_ms = D3D::Test::MeasureMilliseconds(repeat, [&]() { Regenerate(n, nullptr); });
+        double open_ms = D3D::Test::MeasureMilliseconds(repeat * 20, [&]() { opened = reader.Open(path) && opened; });
+        double validate_ms = D3D::Test::MeasureMilliseconds(repeat * 20, [&]() { opened = reader.Open(path, true) && opened; });
+
+        std::printf("%-6u %10u %10.1f %14.3f %10.4f %14.4f%s\n", n, vertex_count, file_kb, regenerate_ms, open_ms, validate_ms, opened ? "" : " failed");
+    }
+
+    std::remove(path);
+    return 0;
+}
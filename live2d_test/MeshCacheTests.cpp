@@ -0,0 +1,338 @@
+#include "MeshCache.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "TestHarness.h"
+
+using namespace D3D;
+
+namespace
+{
+    typedef GeometryGenerator::Vertex Vertex;
+
+    uint32_t GetIndex(const GeometryGenerator::MeshData& mesh, size_t i)
+    {
+        return mesh.Use32BitIndices ? mesh.Indices32[i] : mesh.Indices16[i];
+    }
+
+    uint32_t GetIndex(const MeshCacheReader& reader, size_t i)
+    {
+        const void* indices = reader.GetSection(kMeshCacheIndices);
+        return reader.GetHeader().index_size == sizeof(uint16_t) ? static_cast<const uint16_t*>(indices)[i] : static_cast<const uint32_t*>(indices)[i];
+    }
+
+    // The vertices and indices of a submesh against the mesh it was written from. Full keeps
+    // every float as it is, so the vertices have to come back bit for bit.
+    bool MatchesMesh(const MeshCacheReader& reader, uint32_t submesh, const GeometryGenerator::MeshData& mesh)
+    {
+        const MeshCacheSubmesh& desc = reader.GetSubmesh(submesh);
+        bool same = desc.vertex_count == mesh.Vertices.size() && desc.index_count == mesh.GetIndexCount();
+        for (size_t i = 0; i < desc.index_count && same; i++)
+        {
+            same = GetIndex(reader, desc.start_index + i) == GetIndex(mesh, i);
+        }
+
+        VertexFormatDesc format = reader.GetFormat();
+        const void* streams[VertexFormatDesc::MAX_STREAM_COUNT] = {};
+        for (uint32_t s = 0; s < format.stream_count; s++)
+        {
+            streams[s] = static_cast<const uint8_t*>(reader.GetSection(static_cast<MeshCacheSection>(kMeshCacheVertexStream0 + s))) +
+                static_cast<size_t>(desc.base_vertex) * format.strides[s];
+        }
+
+        std::vector<Vertex> decoded(desc.vertex_count);
+        VertexCodec::Decode(format, reader.GetQuantization(), streams, desc.vertex_count, decoded.data());
+        return same && (decoded.empty() || ::memcmp(decoded.data(), mesh.Vertices.data(), decoded.size() * sizeof(Vertex)) == 0);
+    }
+
+    bool IsSameMeshlets(const MeshletData& a, const MeshletData& b)
+    {
+        bool same = a.meshlets.size() == b.meshlets.size() && a.vertices == b.vertices && a.triangles == b.triangles && a.indices == b.indices;
+        for (size_t i = 0; i < a.meshlets.size() && same; i++)
+        {
+            same = ::memcmp(&a.meshlets[i], &b.meshlets[i], sizeof(Meshlet)) == 0;
+        }
+
+        return same && a.bounds.center_x == b.bounds.center_x && a.bounds.radius == b.bounds.radius && a.bounds.apex_z == b.bounds.apex_z &&
+            a.bounds.axis_y == b.bounds.axis_y && a.bounds.cutoff == b.bounds.cutoff;
+    }
+
+    void TestIndices16()
+    {
+        GeometryGenerator generator;
+        GeometryGenerator::MeshData meshes[] =
+        {
+            generator.CreateBox(1.0f, 2.0f, 3.0f, 1),
+            generator.CreateSphere(0.5f, 20, 20),
+            generator.CreateCylinder(1.0f, 0.5f, 2.0f, 12, 3),
+        };
+
+        MeshCacheWriter writer;
+        for (auto& mesh : meshes)
+        {
+            writer.AddMesh(mesh);
+        }
+
+        std::vector<uint8_t> image;
+        writer.Serialize(7, image);
+
+        MeshCacheReader reader;
+        TEST_CHECK(reader.Open(image.data(), image.size(), true));
+        TEST_CHECK(reader.GetHeader().content_version == 7 && reader.GetHeader().index_size == sizeof(uint16_t));
+        TEST_CHECK(reader.GetSubmeshCount() == 3);
+        if (reader.GetSubmeshCount() == 3)
+        {
+            for (uint32_t i = 0; i < 3; i++)
+            {
+                TEST_CHECK(MatchesMesh(reader, i, meshes[i]));
+                TEST_CHECK(reader.GetSubmesh(i).meshlet_count == 0 && reader.GetSubmesh(i).lod_level == 0);
+            }
+
+            const MeshCacheSubmesh& box = reader.GetSubmesh(0);
+            TEST_CHECK(box.bounds_min[0] == -0.5f && box.bounds_max[1] == 1.0f && box.bounds_max[2] == 1.5f);
+            TEST_CHECK(reader.GetSubmesh(1).base_vertex == meshes[0].Vertices.size());
+            TEST_CHECK(reader.GetSubmesh(2).start_index == meshes[0].GetIndexCount() + meshes[1].GetIndexCount());
+        }
+
+        // Sections start on the alignment and nothing is written for meshlets.
+        for (uint32_t s = 0; s < kMeshCacheSectionCount; s++)
+        {
+            TEST_CHECK(reader.GetHeader().sections[s].offset % MeshCacheHeader::ALIGNMENT == 0);
+        }
+
+        TEST_CHECK(reader.GetSection(kMeshCacheMeshlets) == nullptr && reader.GetSectionSize(kMeshCacheMeshletBounds) == 0);
+
+        // Equal meshes give equal files.
+        std::vector<uint8_t> again;
+        writer.Serialize(7, again);
+        TEST_CHECK(again == image);
+    }
+
+    void TestIndices32()
+    {
+        // One mesh past 65536 vertices turns the whole index buffer to 32 bit, the small mesh
+        // after it included.
+        GeometryGenerator generator;
+        GeometryGenerator::MeshData grid = generator.CreateGrid(10.0f, 10.0f, 300, 300);
+        GeometryGenerator::MeshData box = generator.CreateBox(1.0f, 1.0f, 1.0f, 0);
+        TEST_CHECK(grid.Use32BitIndices && !box.Use32BitIndices);
+
+        MeshCacheWriter writer(VertexFormatDesc::Full().SplitPosition());
+        writer.AddMesh(grid);
+        writer.AddMesh(box);
+
+        std::vector<uint8_t> image;
+        writer.Serialize(1, image);
+
+        MeshCacheReader reader;
+        TEST_CHECK(reader.Open(image.data(), image.size(), true));
+        TEST_CHECK(reader.GetHeader().index_size == sizeof(uint32_t) && reader.GetHeader().stream_count == 2);
+        TEST_CHECK(reader.GetSubmeshCount() == 2);
+        if (reader.GetSubmeshCount() == 2)
+        {
+            TEST_CHECK(MatchesMesh(reader, 0, grid));
+            TEST_CHECK(MatchesMesh(reader, 1, box));
+            TEST_CHECK(reader.GetSubmesh(1).base_vertex == grid.Vertices.size());
+        }
+
+        VertexFormatDesc format = reader.GetFormat();
+        TEST_CHECK(format.position.stream == 0 && format.texcoord.stream == 1 && format.strides[1] == 32);
+    }
+
+    void TestMeshlets()
+    {
+        GeometryGenerator generator;
+        GeometryGenerator::MeshData meshes[] =
+        {
+            generator.CreateSphere(1.0f, 40, 30),
+            generator.CreateBox(1.0f, 1.0f, 1.0f, 0),
+            generator.CreateGeosphere(2.0f, 3),
+        };
+
+        // The middle mesh goes without meshlets, the others keep theirs relative to themselves.
+        MeshletBuilder builder;
+        MeshletData meshlets[3];
+        MeshCacheWriter writer;
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            if (i != 1)
+            {
+                builder.Build(meshes[i], meshlets[i]);
+            }
+
+            TEST_CHECK(writer.AddMesh(meshes[i], 0, 0.0f, i != 1 ? &meshlets[i] : nullptr) == i);
+        }
+
+        std::vector<uint8_t> image;
+        writer.Serialize(1, image);
+
+        MeshCacheReader reader;
+        TEST_CHECK(reader.Open(image.data(), image.size(), true));
+        TEST_CHECK(reader.GetHeader().meshlet_count == meshlets[0].meshlets.size() + meshlets[2].meshlets.size());
+        TEST_CHECK(reader.GetSubmeshCount() == 3);
+        if (reader.GetSubmeshCount() == 3)
+        {
+            for (uint32_t i = 0; i < 3; i++)
+            {
+                MeshletData read;
+                reader.ReadMeshlets(i, read);
+                TEST_CHECK(MatchesMesh(reader, i, meshes[i]));
+                TEST_CHECK(IsSameMeshlets(read, meshlets[i]));
+            }
+
+            TEST_CHECK(reader.GetSubmesh(2).first_meshlet == meshlets[0].meshlets.size());
+        }
+    }
+
+    void TestLodChain()
+    {
+        GeometryGenerator generator;
+        MeshSimplifier simplifier;
+        std::vector<MeshLod> lods = simplifier.BuildLodChain(generator.CreateSphere(1.0f, 48, 48), 4);
+        TEST_CHECK(lods.size() > 1);
+
+        MeshCacheWriter writer;
+        writer.AddMesh(generator.CreateBox(1.0f, 1.0f, 1.0f, 0));
+        writer.AddLodChain(lods);
+
+        std::vector<uint8_t> image;
+        writer.Serialize(1, image);
+
+        MeshCacheReader reader;
+        TEST_CHECK(reader.Open(image.data(), image.size(), true));
+        TEST_CHECK(reader.GetSubmeshCount() == 1 + lods.size());
+        if (reader.GetSubmeshCount() == 1 + lods.size())
+        {
+            for (uint32_t i = 0; i < lods.size(); i++)
+            {
+                const MeshCacheSubmesh& submesh = reader.GetSubmesh(1 + i);
+                TEST_CHECK(submesh.lod_level == i && submesh.lod_error == lods[i].error);
+                TEST_CHECK(MatchesMesh(reader, 1 + i, lods[i].mesh));
+            }
+
+            TEST_CHECK(reader.GetSubmesh(0).lod_level == 0 && reader.GetSubmesh(2).index_count < reader.GetSubmesh(1).index_count);
+        }
+    }
+
+    void TestFile()
+    {
+        GeometryGenerator generator;
+        GeometryGenerator::MeshData sphere = generator.CreateSphere(1.0f, 16, 16);
+        MeshCacheWriter writer;
+        writer.AddMesh(sphere);
+
+        const char* path = "MeshCacheTests.cache";
+        TEST_CHECK(writer.Write(path, 3));
+
+        MeshCacheReader reader;
+        TEST_CHECK(reader.Open(path, true));
+        TEST_CHECK(reader.GetSubmeshCount() == 1 && reader.GetHeader().content_version == 3);
+        if (reader.GetSubmeshCount() == 1)
+        {
+            TEST_CHECK(MatchesMesh(reader, 0, sphere));
+        }
+
+        reader.Close();
+        TEST_CHECK(reader.GetSubmeshCount() == 0);
+        std::remove(path);
+
+        TEST_CHECK(!reader.Open(path));
+        TEST_CHECK(::strlen(reader.GetError()) != 0);
+    }
+
+    // Copies of a good image with one thing broken, each of which Open has to turn down.
+    void TestRejected()
+    {
+        GeometryGenerator generator;
+        GeometryGenerator::MeshData sphere = generator.CreateSphere(1.0f, 12, 12);
+        MeshletBuilder builder;
+        MeshletData meshlets;
+        builder.Build(sphere, meshlets);
+
+        MeshCacheWriter writer;
+        writer.AddMesh(sphere, 0, 0.0f, &meshlets);
+
+        std::vector<uint8_t> image;
+        writer.Serialize(1, image);
+
+        MeshCacheReader reader;
+        TEST_CHECK(reader.Open(image.data(), image.size(), true));
+        const MeshCacheHeader header = reader.GetHeader();
+
+        auto rejects = [&reader](const std::vector<uint8_t>& broken, bool validate_contents)
+        {
+            bool rejected = !reader.Open(broken.data(), broken.size(), validate_contents);
+            return rejected && ::strlen(reader.GetError()) != 0 && reader.GetSubmeshCount() == 0;
+        };
+
+        // Truncated, in the header and in the last section.
+        TEST_CHECK(rejects(std::vector<uint8_t>(image.begin(), image.begin() + sizeof(MeshCacheHeader) - 1), false));
+        TEST_CHECK(rejects(std::vector<uint8_t>(image.begin(), image.end() - 1), false));
+        TEST_CHECK(!reader.Open(image.data(), 0));
+
+        // Not aligned for the header.
+        std::vector<uint64_t> storage(image.size() / sizeof(uint64_t) + 2);
+        uint8_t* misaligned = reinterpret_cast<uint8_t*>(storage.data()) + 4;
+        ::memcpy(misaligned, image.data(), image.size());
+        TEST_CHECK(!reader.Open(misaligned, image.size()));
+
+        auto patch = [&image](size_t offset, const void* value, size_t size)
+        {
+            std::vector<uint8_t> broken = image;
+            ::memcpy(broken.data() + offset, value, size);
+            return broken;
+        };
+
+        uint32_t wrong = MeshCacheHeader::VERSION + 1;
+        TEST_CHECK(rejects(patch(offsetof(MeshCacheHeader, version), &wrong, sizeof(wrong)), false));
+        wrong = 0x4A4E4B4A;
+        TEST_CHECK(rejects(patch(offsetof(MeshCacheHeader, magic), &wrong, sizeof(wrong)), false));
+        wrong = sizeof(uint8_t);
+        TEST_CHECK(rejects(patch(offsetof(MeshCacheHeader, index_size), &wrong, sizeof(wrong)), false));
+        wrong = header.vertex_count + 1;
+        TEST_CHECK(rejects(patch(offsetof(MeshCacheHeader, vertex_count), &wrong, sizeof(wrong)), false));
+
+        uint64_t past_end = header.file_size;
+        size_t indices_offset = offsetof(MeshCacheHeader, sections) + kMeshCacheIndices * sizeof(MeshCacheSectionDesc);
+        TEST_CHECK(rejects(patch(indices_offset, &past_end, sizeof(past_end)), false));
+        uint64_t unaligned = header.sections[kMeshCacheIndices].offset + 4;
+        TEST_CHECK(rejects(patch(indices_offset, &unaligned, sizeof(unaligned)), false));
+
+        uint32_t too_many = header.index_count + 3;
+        size_t submesh_offset = static_cast<size_t>(header.sections[kMeshCacheSubmeshes].offset);
+        TEST_CHECK(rejects(patch(submesh_offset + offsetof(MeshCacheSubmesh, index_count), &too_many, sizeof(too_many)), false));
+
+        // Indices and meshlets past their submesh only show up when the contents are checked.
+        uint16_t index = static_cast<uint16_t>(sphere.Vertices.size());
+        std::vector<uint8_t> broken = patch(static_cast<size_t>(header.sections[kMeshCacheIndices].offset) + 5 * sizeof(uint16_t), &index, sizeof(index));
+        TEST_CHECK(reader.Open(broken.data(), broken.size(), false));
+        TEST_CHECK(rejects(broken, true));
+
+        uint32_t vertex = static_cast<uint32_t>(sphere.Vertices.size());
+        broken = patch(static_cast<size_t>(header.sections[kMeshCacheMeshletVertices].offset), &vertex, sizeof(vertex));
+        TEST_CHECK(reader.Open(broken.data(), broken.size(), false));
+        TEST_CHECK(rejects(broken, true));
+
+        uint8_t local = static_cast<uint8_t>(meshlets.meshlets[0].vertex_count);
+        broken = patch(static_cast<size_t>(header.sections[kMeshCacheMeshletTriangles].offset), &local, sizeof(local));
+        TEST_CHECK(rejects(broken, true));
+
+        // A failed Open leaves the reader usable for the next one.
+        TEST_CHECK(reader.Open(image.data(), image.size(), true));
+        TEST_CHECK(::strlen(reader.GetError()) == 0 && reader.GetSubmeshCount() == 1);
+    }
+}
+
+int main()
+{
+    TestIndices16();
+    TestIndices32();
+    TestMeshlets();
+    TestLodChain();
+    TestFile();
+    TestRejected();
+    return D3D::Test::Finish("MeshCacheTests");
+}
@@ -0,0 +1,763 @@
+#include "MeshLod.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+namespace D3D
+{
+    namespace
+    {
+        const uint32_t INVALID_VERTEX = 0xffffffff;
+
+        // A simplified level keeping more than this of the triangles of the level before ends the chain.
+        const float MIN_LOD_REDUCTION = 0.95f;
+
+        // Closest distance the selector projects errors at, in mesh units.
+        const float MIN_LOD_DISTANCE = 1e-3f;
+
+        inline const float* GetPosition(const float* positions, uint32_t position_stride, uint32_t vertex)
+        {
+            return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + static_cast<size_t>(vertex) * position_stride);
+        }
+
+        inline float Dot(const float a[3], const float b[3])
+        {
+            return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+        }
+
+        inline void TriangleNormal(const float* p0, const float* p1, const float* p2, float normal[3])
+        {
+            float e0[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            float e1[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            normal[0] = e0[1] * e1[2] - e0[2] * e1[1];
+            normal[1] = e0[2] * e1[0] - e0[0] * e1[2];
+            normal[2] = e0[0] * e1[1] - e0[1] * e1[0];
+        }
+
+        // Ericson's closest point on a triangle, by the Voronoi region of the point.
+        float PointTriangleDistance(const float* p, const float* a, const float* b, const float* c)
+        {
+            float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+            float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+            float ap[3] = { p[0] - a[0], p[1] - a[1], p[2] - a[2] };
+            float bp[3] = { p[0] - b[0], p[1] - b[1], p[2] - b[2] };
+            float cp[3] = { p[0] - c[0], p[1] - c[1], p[2] - c[2] };
+            float d1 = Dot(ab, ap);
+            float d2 = Dot(ac, ap);
+            float d3 = Dot(ab, bp);
+            float d4 = Dot(ac, bp);
+            float d5 = Dot(ab, cp);
+            float d6 = Dot(ac, cp);
+            float va = d3 * d6 - d5 * d4;
+            float vb = d5 * d2 - d1 * d6;
+            float vc = d1 * d4 - d3 * d2;
+
+            float closest[3];
+            if (d1 <= 0.0f && d2 <= 0.0f)
+            {
+                std::copy(a, a + 3, closest);
+            }
+            else if (d3 >= 0.0f && d4 <= d3)
+            {
+                std::copy(b, b + 3, closest);
+            }
+            else if (d6 >= 0.0f && d5 <= d6)
+            {
+                std::copy(c, c + 3, closest);
+            }
+            else if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+            {
+                float t = d1 / (d1 - d3);
+                for (uint32_t k = 0; k < 3; k++) closest[k] = a[k] + t * ab[k];
+            }
+            else if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+            {
+                float t = d2 / (d2 - d6);
+                for (uint32_t k = 0; k < 3; k++) closest[k] = a[k] + t * ac[k];
+            }
+            else if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+            {
+                float t = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+                for (uint32_t k = 0; k < 3; k++) closest[k] = b[k] + t * (c[k] - b[k]);
+            }
+            else
+            {
+                float denominator = 1.0f / (va + vb + vc);
+                float v = vb * denominator;
+                float w = vc * denominator;
+                for (uint32_t k = 0; k < 3; k++) closest[k] = a[k] + ab[k] * v + ac[k] * w;
+            }
+
+            float d[3] = { p[0] - closest[0], p[1] - closest[1], p[2] - closest[2] };
+            return std::sqrt(Dot(d, d));
+        }
+
+        // The triangles as a mesh of their own, with only the vertices they use in input order.
+        GeometryGenerator::MeshData ExtractMesh(const GeometryGenerator::MeshData& mesh, const uint32_t* indices, uint32_t index_count)
+        {
+            std::vector<uint32_t> remap(mesh.Vertices.size(), INVALID_VERTEX);
+            for (uint32_t i = 0; i < index_count; i++)
+            {
+                remap[indices[i]] = 0;
+            }
+
+            GeometryGenerator::MeshData level;
+            for (uint32_t v = 0; v < static_cast<uint32_t>(mesh.Vertices.size()); v++)
+            {
+                if (remap[v] != INVALID_VERTEX)
+                {
+                    remap[v] = static_cast<uint32_t>(level.Vertices.size());
+                    level.Vertices.push_back(mesh.Vertices[v]);
+                }
+            }
+
+            level.ResizeIndices(index_count, level.Vertices.size());
+            for (uint32_t i = 0; i < index_count; i++)
+            {
+                if (level.Use32BitIndices)
+                {
+                    level.Indices32[i] = remap[indices[i]];
+                }
+                else
+                {
+                    level.Indices16[i] = static_cast<uint16_t>(remap[indices[i]]);
+                }
+            }
+
+            return level;
+        }
+
+        // How far the triangles of a mesh around the origin sink below the sphere of radius, from
+        // the deepest triangle plane. Overestimates a little where the point of a triangle closest
+        // to the center lies on an edge.
+        float SphereError(const GeometryGenerator::MeshData& mesh, float radius)
+        {
+            float min_distance = radius;
+            for (size_t i = 0; i + 2 < mesh.GetIndexCount(); i += 3)
+            {
+                const float* p0 = &mesh.Vertices[mesh.GetIndex(i)].Position.x;
+                const float* p1 = &mesh.Vertices[mesh.GetIndex(i + 1)].Position.x;
+                const float* p2 = &mesh.Vertices[mesh.GetIndex(i + 2)].Position.x;
+                float normal[3];
+                TriangleNormal(p0, p1, p2, normal);
+
+                float length = std::sqrt(Dot(normal, normal));
+                if (length > 0.0f)
+                {
+                    min_distance = (std::min)(min_distance, std::fabs(Dot(normal, p0)) / length);
+                }
+            }
+
+            return radius - min_distance;
+        }
+
+        // Levels are expected coarser and coarser, rounding must not make an error smaller.
+        void PushLod(std::vector<MeshLod>& lods, GeometryGenerator::MeshData&& mesh, float error)
+        {
+            MeshLod lod;
+            lod.mesh = std::move(mesh);
+            lod.error = lods.empty() ? error : (std::max)(error, lods.back().error);
+            lods.push_back(std::move(lod));
+        }
+    }
+
+    uint32_t MeshSimplifier::Simplify(const uint16_t* indices, uint32_t index_count, const float* positions, uint32_t position_stride, uint32_t vertex_count,
+        uint32_t target_index_count, float target_error, uint16_t* destination, float* error)
+    {
+        return SimplifyImpl(indices, index_count, positions, position_stride, vertex_count, target_index_count, target_error, destination, error);
+    }
+
+    uint32_t MeshSimplifier::Simplify(const uint32_t* indices, uint32_t index_count, const float* positions, uint32_t position_stride, uint32_t vertex_count,
+        uint32_t target_index_count, float target_error, uint32_t* destination, float* error)
+    {
+        return SimplifyImpl(indices, index_count, positions, position_stride, vertex_count, target_index_count, target_error, destination, error);
+    }
+
+    std::vector<MeshLod> MeshSimplifier::BuildLodChain(const GeometryGenerator::MeshData& mesh, uint32_t max_lod_count, float reduction)
+    {
+        std::vector<MeshLod> lods;
+        if (max_lod_count == 0)
+        {
+            return lods;
+        }
+
+        GeometryGenerator::MeshData level = mesh;
+        PushLod(lods, std::move(level), 0.0f);
+
+        uint32_t index_count = static_cast<uint32_t>(mesh.GetIndexCount());
+        uint32_t vertex_count = static_cast<uint32_t>(mesh.Vertices.size());
+        if (index_count == 0)
+        {
+            return lods;
+        }
+
+        std::vector<uint32_t> source(index_count);
+        for (uint32_t i = 0; i < index_count; i++)
+        {
+            source[i] = mesh.GetIndex(i);
+        }
+
+        // Every level starts over from the full mesh, so its error is measured against it.
+        std::vector<uint32_t> destination(index_count);
+        uint32_t level_index_count = index_count;
+        while (lods.size() < max_lod_count)
+        {
+            uint32_t target_index_count = static_cast<uint32_t>(level_index_count * reduction) / 3 * 3;
+            float error = 0.0f;
+            uint32_t simplified_count = Simplify(source.data(), index_count, &mesh.Vertices[0].Position.x, sizeof(GeometryGenerator::Vertex), vertex_count,
+                target_index_count, FLT_MAX, destination.data(), &error);
+            if (simplified_count == 0 || simplified_count > level_index_count * MIN_LOD_REDUCTION)
+            {
+                break;
+            }
+
+            PushLod(lods, ExtractMesh(mesh, destination.data(), simplified_count), error);
+            level_index_count = simplified_count;
+        }
+
+        return lods;
+    }
+
+    void MeshSimplifier::AddQuadric(Quadric& quadric, const Quadric& other)
+    {
+        quadric.a00 += other.a00;
+        quadric.a11 += other.a11;
+        quadric.a22 += other.a22;
+        quadric.a01 += other.a01;
+        quadric.a02 += other.a02;
+        quadric.a12 += other.a12;
+        quadric.b0 += other.b0;
+        quadric.b1 += other.b1;
+        quadric.b2 += other.b2;
+        quadric.c += other.c;
+        quadric.weight += other.weight;
+    }
+
+    float MeshSimplifier::EvaluateQuadric(const Quadric& quadric, const float* position)
+    {
+        float x = position[0];
+        float y = position[1];
+        float z = position[2];
+        float cost = quadric.a00 * x * x + quadric.a11 * y * y + quadric.a22 * z * z
+            + 2.0f * (quadric.a01 * x * y + quadric.a02 * x * z + quadric.a12 * y * z)
+            + 2.0f * (quadric.b0 * x + quadric.b1 * y + quadric.b2 * z) + quadric.c;
+
+        // Area weighted, so the cost is the mean squared distance to the planes.
+        return quadric.weight > 0.0f ? (std::max)(cost, 0.0f) / quadric.weight : 0.0f;
+    }
+
+    template<typename TIndex>
+    uint32_t MeshSimplifier::SimplifyImpl(const TIndex* indices, uint32_t index_count, const float* positions, uint32_t position_stride, uint32_t vertex_count,
+        uint32_t target_index_count, float target_error, TIndex* destination, float* error)
+    {
+        assert(index_count % 3 == 0);
+
+        // Positions go into the unit cube, so costs do not depend on the size of the mesh.
+        float box_min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+        float box_max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+        for (uint32_t v = 0; v < vertex_count; v++)
+        {
+            const float* p = GetPosition(positions, position_stride, v);
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                box_min[c] = (std::min)(box_min[c], p[c]);
+                box_max[c] = (std::max)(box_max[c], p[c]);
+            }
+        }
+
+        float extent = (std::max)((std::max)(box_max[0] - box_min[0], box_max[1] - box_min[1]), box_max[2] - box_min[2]);
+        float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+        positions_.resize(static_cast<size_t>(vertex_count) * 3);
+        for (uint32_t v = 0; v < vertex_count; v++)
+        {
+            const float* p = GetPosition(positions, position_stride, v);
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                positions_[v * 3 + c] = (p[c] - box_min[c]) * scale;
+            }
+        }
+
+        indices_.assign(indices, indices + index_count);
+        LockBordersAndSeams(vertex_count);
+        ComputeQuadrics(vertex_count);
+
+        float error_limit = target_error < FLT_MAX ? target_error * scale : FLT_MAX;
+        float cost_limit = error_limit < FLT_MAX ? error_limit * error_limit : FLT_MAX;
+        uint32_t triangle_count = index_count / 3;
+        uint32_t target_triangle_count = target_index_count / 3;
+
+        collapse_targets_.resize(vertex_count);
+        collapse_costs_.resize(vertex_count);
+        collapse_remap_.resize(vertex_count);
+        for (uint32_t v = 0; v < vertex_count; v++)
+        {
+            collapse_remap_[v] = v;
+        }
+
+        while (triangle_count > target_triangle_count)
+        {
+            BuildAdjacency(vertex_count);
+
+            // The cheapest edge of every vertex that may move, onto the other end as it is.
+            std::fill(collapse_targets_.begin(), collapse_targets_.end(), INVALID_VERTEX);
+            std::fill(collapse_costs_.begin(), collapse_costs_.end(), FLT_MAX);
+            for (size_t i = 0; i < indices_.size(); i++)
+            {
+                uint32_t from = indices_[i];
+                if (locked_[from] != 0)
+                {
+                    continue;
+                }
+
+                size_t corner = i % 3;
+                for (size_t k = 1; k < 3; k++)
+                {
+                    uint32_t to = indices_[i - corner + (corner + k) % 3];
+                    if (seams_[to] != 0)
+                    {
+                        continue;
+                    }
+
+                    Quadric quadric = quadrics_[from];
+                    AddQuadric(quadric, quadrics_[to]);
+                    float cost = EvaluateQuadric(quadric, &positions_[to * 3]);
+                    if (cost < collapse_costs_[from])
+                    {
+                        collapse_costs_[from] = cost;
+                        collapse_targets_[from] = to;
+                    }
+                }
+            }
+
+            collapse_order_.clear();
+            for (uint32_t v = 0; v < vertex_count; v++)
+            {
+                if (collapse_targets_[v] != INVALID_VERTEX)
+                {
+                    collapse_order_.push_back(v);
+                }
+            }
+
+            std::sort(collapse_order_.begin(), collapse_order_.end(), [this](uint32_t a, uint32_t b)
+            {
+                return collapse_costs_[a] < collapse_costs_[b] || (collapse_costs_[a] == collapse_costs_[b] && a < b);
+            });
+
+            touched_.assign(vertex_count, 0);
+            uint32_t collapsed_count = 0;
+            for (uint32_t from : collapse_order_)
+            {
+                float cost = collapse_costs_[from];
+                uint32_t to = collapse_targets_[from];
+                if (triangle_count <= target_triangle_count || cost > cost_limit)
+                {
+                    break;
+                }
+
+                if (touched_[from] != 0 || touched_[to] != 0 || FlipsTriangle(from, to))
+                {
+                    continue;
+                }
+
+                // Triangles on the edge collapse to a line and are dropped at the end of the pass.
+                const uint32_t* vertex_triangles = vertex_triangles_.data() + triangle_offsets_[from];
+                for (uint32_t j = 0; j < triangle_counts_[from]; j++)
+                {
+                    uint32_t* triangle = &indices_[vertex_triangles[j] * 3];
+                    if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2])
+                    {
+                        continue;
+                    }
+
+                    bool on_edge = triangle[0] == to || triangle[1] == to || triangle[2] == to;
+                    for (uint32_t c = 0; c < 3; c++)
+                    {
+                        triangle[c] = triangle[c] == from ? to : triangle[c];
+                    }
+
+                    triangle_count -= on_edge ? 1 : 0;
+                }
+
+                AddQuadric(quadrics_[to], quadrics_[from]);
+                collapse_remap_[from] = to;
+                touched_[from] = 1;
+                touched_[to] = 1;
+                collapsed_count++;
+            }
+
+            if (collapsed_count == 0)
+            {
+                break;
+            }
+
+            uint32_t write = 0;
+            for (size_t i = 0; i < indices_.size(); i += 3)
+            {
+                uint32_t a = indices_[i];
+                uint32_t b = indices_[i + 1];
+                uint32_t c = indices_[i + 2];
+                if (a != b && b != c && a != c)
+                {
+                    indices_[write++] = a;
+                    indices_[write++] = b;
+                    indices_[write++] = c;
+                }
+            }
+
+            indices_.resize(write);
+        }
+
+        for (size_t i = 0; i < indices_.size(); i++)
+        {
+            destination[i] = static_cast<TIndex>(indices_[i]);
+        }
+
+        if (error != nullptr)
+        {
+            *error = MeasureError(vertex_count) / scale;
+        }
+
+        return static_cast<uint32_t>(indices_.size());
+    }
+
+    void MeshSimplifier::LockBordersAndSeams(uint32_t vertex_count)
+    {
+        // Vertices at one position are welded onto the first of them, a position with more than
+        // one vertex is an attribute seam.
+        sorted_vertices_.resize(vertex_count);
+        for (uint32_t v = 0; v < vertex_count; v++)
+        {
+            sorted_vertices_[v] = v;
+        }
+
+        const float* positions = positions_.data();
+        std::sort(sorted_vertices_.begin(), sorted_vertices_.end(), [positions](uint32_t a, uint32_t b)
+        {
+            const float* pa = &positions[a * 3];
+            const float* pb = &positions[b * 3];
+            if (pa[0] != pb[0]) return pa[0] < pb[0];
+            if (pa[1] != pb[1]) return pa[1] < pb[1];
+            if (pa[2] != pb[2]) return pa[2] < pb[2];
+            return a < b;
+        });
+
+        welded_.resize(vertex_count);
+        seams_.assign(vertex_count, 0);
+        for (uint32_t begin = 0; begin < vertex_count;)
+        {
+            uint32_t first = sorted_vertices_[begin];
+            uint32_t end = begin + 1;
+            while (end < vertex_count && std::equal(&positions[sorted_vertices_[end] * 3], &positions[sorted_vertices_[end] * 3] + 3, &positions[first * 3]))
+            {
+                end++;
+            }
+
+            for (uint32_t i = begin; i < end; i++)
+            {
+                welded_[sorted_vertices_[i]] = first;
+                seams_[sorted_vertices_[i]] = end - begin > 1 ? 1 : 0;
+            }
+
+            begin = end;
+        }
+
+        // Welded edges used by a single triangle are borders, more than two is not a manifold;
+        // both keep their vertices.
+        edge_keys_.resize(indices_.size());
+        for (size_t i = 0; i < indices_.size(); i++)
+        {
+            size_t corner = i % 3;
+            uint32_t a = welded_[indices_[i]];
+            uint32_t b = welded_[indices_[i - corner + (corner + 1) % 3]];
+            edge_keys_[i] = (static_cast<uint64_t>((std::min)(a, b)) << 32) | (std::max)(a, b);
+        }
+
+        std::sort(edge_keys_.begin(), edge_keys_.end());
+
+        locked_.assign(seams_.begin(), seams_.end());
+        for (size_t begin = 0; begin < edge_keys_.size();)
+        {
+            size_t end = begin + 1;
+            while (end < edge_keys_.size() && edge_keys_[end] == edge_keys_[begin])
+            {
+                end++;
+            }
+
+            if (end - begin != 2)
+            {
+                locked_[static_cast<uint32_t>(edge_keys_[begin] >> 32)] = 1;
+                locked_[static_cast<uint32_t>(edge_keys_[begin])] = 1;
+            }
+
+            begin = end;
+        }
+    }
+
+    void MeshSimplifier::ComputeQuadrics(uint32_t vertex_count)
+    {
+        Quadric zero = {};
+        quadrics_.assign(vertex_count, zero);
+        for (size_t i = 0; i < indices_.size(); i += 3)
+        {
+            const float* p0 = &positions_[indices_[i] * 3];
+            const float* p1 = &positions_[indices_[i + 1] * 3];
+            const float* p2 = &positions_[indices_[i + 2] * 3];
+            float n[3];
+            TriangleNormal(p0, p1, p2, n);
+
+            float length = std::sqrt(Dot(n, n));
+            if (length == 0.0f)
+            {
+                continue;
+            }
+
+            n[0] /= length;
+            n[1] /= length;
+            n[2] /= length;
+            float d = -Dot(n, p0);
+            float area = length * 0.5f;
+
+            Quadric plane;
+            plane.a00 = area * n[0] * n[0];
+            plane.a11 = area * n[1] * n[1];
+            plane.a22 = area * n[2] * n[2];
+            plane.a01 = area * n[0] * n[1];
+            plane.a02 = area * n[0] * n[2];
+            plane.a12 = area * n[1] * n[2];
+            plane.b0 = area * n[0] * d;
+            plane.b1 = area * n[1] * d;
+            plane.b2 = area * n[2] * d;
+            plane.c = area * d * d;
+            plane.weight = area;
+
+            AddQuadric(quadrics_[indices_[i]], plane);
+            AddQuadric(quadrics_[indices_[i + 1]], plane);
+            AddQuadric(quadrics_[indices_[i + 2]], plane);
+        }
+    }
+
+    void MeshSimplifier::BuildAdjacency(uint32_t vertex_count)
+    {
+        triangle_counts_.assign(vertex_count, 0);
+        for (uint32_t v : indices_)
+        {
+            triangle_counts_[v]++;
+        }
+
+        triangle_offsets_.resize(vertex_count);
+        uint32_t offset = 0;
+        for (uint32_t v = 0; v < vertex_count; v++)
+        {
+            triangle_offsets_[v] = offset;
+            offset += triangle_counts_[v];
+        }
+
+        vertex_triangles_.resize(indices_.size());
+        for (size_t i = 0; i < indices_.size(); i++)
+        {
+            uint32_t v = indices_[i];
+            vertex_triangles_[triangle_offsets_[v]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        for (uint32_t v = 0; v < vertex_count; v++)
+        {
+            triangle_offsets_[v] -= triangle_counts_[v];
+        }
+    }
+
+    bool MeshSimplifier::FlipsTriangle(uint32_t from, uint32_t to) const
+    {
+        const uint32_t* vertex_triangles = vertex_triangles_.data() + triangle_offsets_[from];
+        for (uint32_t j = 0; j < triangle_counts_[from]; j++)
+        {
+            const uint32_t* triangle = &indices_[vertex_triangles[j] * 3];
+            if (triangle[0] == to || triangle[1] == to || triangle[2] == to ||
+                triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2])
+            {
+                continue;
+            }
+
+            const float* p[3];
+            const float* moved[3];
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                p[c] = &positions_[triangle[c] * 3];
+                moved[c] = triangle[c] == from ? &positions_[to * 3] : p[c];
+            }
+
+            float before[3];
+            float after[3];
+            TriangleNormal(p[0], p[1], p[2], before);
+            TriangleNormal(moved[0], moved[1], moved[2], after);
+            if (Dot(before, after) <= 0.0f)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    float MeshSimplifier::MeasureError(uint32_t vertex_count)
+    {
+        BuildAdjacency(vertex_count);
+        triangle_stamps_.assign(indices_.size() / 3, INVALID_VERTEX);
+
+        // Vertices still in place, or never used, are on the surface already.
+        float max_distance = 0.0f;
+        for (uint32_t v = 0; v < vertex_count; v++)
+        {
+            uint32_t root = v;
+            while (collapse_remap_[root] != root)
+            {
+                root = collapse_remap_[root];
+            }
+
+            if (root == v || triangle_counts_[root] == 0)
+            {
+                continue;
+            }
+
+            // The closest triangle is not always one of the root, its neighbours are searched too.
+            float distance = FLT_MAX;
+            const uint32_t* root_triangles = vertex_triangles_.data() + triangle_offsets_[root];
+            for (uint32_t j = 0; j < triangle_counts_[root]; j++)
+            {
+                const uint32_t* root_triangle = &indices_[root_triangles[j] * 3];
+                for (uint32_t c = 0; c < 3; c++)
+                {
+                    uint32_t neighbour = root_triangle[c];
+                    const uint32_t* vertex_triangles = vertex_triangles_.data() + triangle_offsets_[neighbour];
+                    for (uint32_t k = 0; k < triangle_counts_[neighbour]; k++)
+                    {
+                        uint32_t t = vertex_triangles[k];
+                        if (triangle_stamps_[t] == v)
+                        {
+                            continue;
+                        }
+
+                        triangle_stamps_[t] = v;
+                        const uint32_t* triangle = &indices_[t * 3];
+                        distance = (std::min)(distance, PointTriangleDistance(&positions_[v * 3],
+                            &positions_[triangle[0] * 3], &positions_[triangle[1] * 3], &positions_[triangle[2] * 3]));
+                    }
+                }
+            }
+
+            max_distance = (std::max)(max_distance, distance);
+        }
+
+        return max_distance;
+    }
+
+    std::vector<MeshLod> GeneratorLods::CreateSphere(GeometryGenerator& generator, float radius, uint32_t slice_count, uint32_t stack_count, uint32_t lod_count)
+    {
+        std::vector<MeshLod> lods;
+        for (uint32_t level = 0; level < lod_count; level++)
+        {
+            uint32_t slices = (std::max)(slice_count >> level, 3u);
+            uint32_t stacks = (std::max)(stack_count >> level, 2u);
+            if (level > 0 && slices == (std::max)(slice_count >> (level - 1), 3u) && stacks == (std::max)(stack_count >> (level - 1), 2u))
+            {
+                break;
+            }
+
+            auto mesh = generator.CreateSphere(radius, slices, stacks);
+            float error = SphereError(mesh, radius);
+            PushLod(lods, std::move(mesh), error);
+        }
+
+        return lods;
+    }
+
+    std::vector<MeshLod> GeneratorLods::CreateGeosphere(GeometryGenerator& generator, float radius, uint32_t subdivision_count, uint32_t lod_count)
+    {
+        // CreateGeosphere caps the subdivisions at 6.
+        subdivision_count = (std::min)(subdivision_count, 6u);
+
+        std::vector<MeshLod> lods;
+        for (uint32_t level = 0; level < lod_count && level <= subdivision_count; level++)
+        {
+            auto mesh = generator.CreateGeosphere(radius, subdivision_count - level);
+            float error = SphereError(mesh, radius);
+            PushLod(lods, std::move(mesh), error);
+        }
+
+        return lods;
+    }
+
+    std::vector<MeshLod> GeneratorLods::CreateCylinder(GeometryGenerator& generator, float bottom_radius, float top_radius, float height,
+        uint32_t slice_count, uint32_t stack_count, uint32_t lod_count)
+    {
+        // The sides are straight, only the slices add error: the sagitta of a slice of the wider end.
+        float radius = (std::max)(bottom_radius, top_radius);
+
+        std::vector<MeshLod> lods;
+        for (uint32_t level = 0; level < lod_count; level++)
+        {
+            uint32_t slices = (std::max)(slice_count >> level, 3u);
+            uint32_t stacks = (std::max)(stack_count >> level, 1u);
+            if (level > 0 && slices == (std::max)(slice_count >> (level - 1), 3u) && stacks == (std::max)(stack_count >> (level - 1), 1u))
+            {
+                break;
+            }
+
+            float error = radius * (1.0f - std::cos(DirectX::XM_PI / slices));
+            PushLod(lods, generator.CreateCylinder(bottom_radius, top_radius, height, slices, stacks), error);
+        }
+
+        return lods;
+    }
+
+    void LodSelector::SetProjection(float fov_y, float viewport_height)
+    {
+        pixels_per_unit_ = viewport_height / (2.0f * std::tan(fov_y * 0.5f));
+    }
+
+    void LodSelector::SetThreshold(float pixel_error, float hysteresis)
+    {
+        assert(pixel_error > 0.0f && hysteresis >= 0.0f && hysteresis < 1.0f);
+
+        pixel_error_ = pixel_error;
+        hysteresis_ = hysteresis;
+    }
+
+    float LodSelector::GetPixelError() const
+    {
+        return pixel_error_;
+    }
+
+    float LodSelector::GetScreenError(float error, float distance) const
+    {
+        return error * pixels_per_unit_ / (std::max)(distance, MIN_LOD_DISTANCE);
+    }
+
+    uint32_t LodSelector::Select(const float* lod_errors, uint32_t lod_count, float distance, uint32_t current_lod) const
+    {
+        if (lod_count == 0)
+        {
+            return 0;
+        }
+
+        uint32_t lod = (std::min)(current_lod, lod_count - 1);
+        if (GetScreenError(lod_errors[lod], distance) > pixel_error_)
+        {
+            while (lod > 0 && GetScreenError(lod_errors[lod], distance) > pixel_error_)
+            {
+                lod--;
+            }
+
+            return lod;
+        }
+
+        float coarser_error = pixel_error_ * (1.0f - hysteresis_);
+        while (lod + 1 < lod_count && GetScreenError(lod_errors[lod + 1], distance) <= coarser_error)
+        {
+            lod++;
+        }
+
+        return lod;
+    }
+};
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "GeometryGenerator.h"
+
+namespace D3D
+{
+    // One level of detail. error is the largest distance, in mesh units, from its surface to the
+    // surface it stands for: the input mesh for simplified levels, the exact shape for levels
+    // generated from parameters.
+    struct MeshLod
+    {
+        GeometryGenerator::MeshData mesh;
+        float error = 0.0f;
+    };
+
+    // Edge collapse simplification driven by quadric error metrics (Garland and Heckbert).
+    // Vertices only ever collapse onto a neighbour, so a simplified mesh indexes a subset of the
+    // input vertices and keeps their attributes. Vertices on open borders and on attribute seams,
+    // where several vertices share a position, never move, which keeps outlines and uv layouts
+    // intact. Every pass picks the cheapest edge of each vertex and collapses them in cost order,
+    // skipping those next to a collapse of the same pass and those that would flip a triangle.
+    // Scratch memory is kept between calls.
+    class MeshSimplifier
+    {
+    public:
+        // destination must hold index_count indices, returns the number written. Stops at
+        // target_index_count or before the quadric estimate of the error would pass target_error,
+        // in mesh units. error, when not null, gets the error measured on the result: the largest
+        // distance from an input vertex to the triangles around the vertex it collapsed into.
+        uint32_t Simplify(const uint16_t* indices, uint32_t index_count, const float* positions, uint32_t position_stride, uint32_t vertex_count,
+            uint32_t target_index_count, float target_error, uint16_t* destination, float* error = nullptr);
+        uint32_t Simplify(const uint32_t* indices, uint32_t index_count, const float* positions, uint32_t position_stride, uint32_t vertex_count,
+            uint32_t target_index_count, float target_error, uint32_t* destination, float* error = nullptr);
+
+        // Level 0 is mesh itself, every further level is simplified from it down to about
+        // reduction of the triangles of the level before. The chain ends early once a level no
+        // longer gets smaller. Levels only keep the vertices they use.
+        std::vector<MeshLod> BuildLodChain(const GeometryGenerator::MeshData& mesh, uint32_t max_lod_count, float reduction = 0.5f);
+
+    private:
+        struct Quadric
+        {
+            float a00, a11, a22, a01, a02, a12;
+            float b0, b1, b2;
+            float c;
+            float weight;
+        };
+
+        template<typename TIndex>
+        uint32_t SimplifyImpl(const TIndex* indices, uint32_t index_count, const float* positions, uint32_t position_stride, uint32_t vertex_count,
+            uint32_t target_index_count, float target_error, TIndex* destination, float* error);
+
+        static void AddQuadric(Quadric& quadric, const Quadric& other);
+        static float EvaluateQuadric(const Quadric& quadric, const float* position);
+
+        void LockBordersAndSeams(uint32_t vertex_count);
+        void ComputeQuadrics(uint32_t vertex_count);
+        void BuildAdjacency(uint32_t vertex_count);
+        bool FlipsTriangle(uint32_t from, uint32_t to) const;
+        float MeasureError(uint32_t vertex_count);
+
+        // Per vertex.
+        std::vector<float>                                  positions_;         // scaled into the unit cube
+        std::vector<uint32_t>                               sorted_vertices_;   // by position
+        std::vector<uint32_t>                               welded_;            // first vertex at the same position
+        std::vector<uint8_t>                                seams_;
+        std::vector<uint8_t>                                locked_;            // border or seam
+        std::vector<Quadric>                                quadrics_;
+        std::vector<uint32_t>                               triangle_offsets_;
+        std::vector<uint32_t>                               triangle_counts_;
+        std::vector<uint32_t>                               collapse_targets_;
+        std::vector<float>                                  collapse_costs_;
+        std::vector<uint32_t>                               collapse_order_;
+        std::vector<uint32_t>                               collapse_remap_;    // vertex it collapsed onto
+        std::vector<uint8_t>                                touched_;           // in the current pass
+
+        // Per index.
+        std::vector<uint32_t>                               indices_;
+        std::vector<uint32_t>                               vertex_triangles_;
+
+        // Per triangle.
+        std::vector<uint32_t>                               triangle_stamps_;   // last vertex measured against it
+        std::vector<uint64_t>                               edge_keys_;
+    };
+
+    // Level of detail chains straight from the GeometryGenerator parameters, the tessellation
+    // halves with every level. Errors are measured against the exact shape, so level 0 has a
+    // small error of its own.
+    class GeneratorLods
+    {
+    public:
+        static std::vector<MeshLod> CreateSphere(GeometryGenerator& generator, float radius, uint32_t slice_count, uint32_t stack_count, uint32_t lod_count);
+        static std::vector<MeshLod> CreateGeosphere(GeometryGenerator& generator, float radius, uint32_t subdivision_count, uint32_t lod_count);
+        static std::vector<MeshLod> CreateCylinder(GeometryGenerator& generator, float bottom_radius, float top_radius, float height,
+            uint32_t slice_count, uint32_t stack_count, uint32_t lod_count);
+    };
+
+    // Picks the coarsest level whose error covers at most GetPixelError() pixels on screen. A
+    // coarser level is only taken once its error is below pixel_error * (1 - hysteresis), so
+    // objects close to a switch distance do not flip between two levels every frame.
+    class LodSelector
+    {
+    public:
+        // fov_y in radians as Camera::GetFovY returns it, viewport_height in pixels.
+        void SetProjection(float fov_y, float viewport_height);
+        void SetThreshold(float pixel_error, float hysteresis = 0.25f);
+        float GetPixelError() const;
+
+        // Pixels covered by error at distance.
+        float GetScreenError(float error, float distance) const;
+
+        // lod_errors ascend with the level. distance runs from the camera to the closest point of
+        // the bounds, divided by the scale of the instance so the errors stay in mesh units.
+        uint32_t Select(const float* lod_errors, uint32_t lod_count, float distance, uint32_t current_lod) const;
+
+    private:
+        float                                               pixels_per_unit_ = 1.0f;   // at distance 1
+        float                                               pixel_error_ = 1.0f;
+        float                                               hysteresis_ = 0.25f;
+    };
+};
@@ -0,0 +1,159 @@
+#include "MeshLod.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "PortableMath.h"
+#include "TestHarness.h"
+
+using namespace D3D;
+using namespace DirectX;
+
+namespace
+{
+    // Closest point on triangle abc to p (Ericson, Real-Time Collision Detection 5.1.5).
+    float PointTriangleDistance(XMVECTOR p, XMVECTOR a, XMVECTOR b, XMVECTOR c)
+    {
+        XMVECTOR ab = XMVectorSubtract(b, a);
+        XMVECTOR ac = XMVectorSubtract(c, a);
+        XMVECTOR ap = XMVectorSubtract(p, a);
+        float d1 = XMVectorGetX(XMVector3Dot(ab, ap));
+        float d2 = XMVectorGetX(XMVector3Dot(ac, ap));
+        if (d1 <= 0.0f && d2 <= 0.0f)
+        {
+            return XMVectorGetX(XMVector3Length(ap));
+        }
+
+        XMVECTOR bp = XMVectorSubtract(p, b);
+        float d3 = XMVectorGetX(XMVector3Dot(ab, bp));
+        float d4 = XMVectorGetX(XMVector3Dot(ac, bp));
+        if (d3 >= 0.0f && d4 <= d3)
+        {
+            return XMVectorGetX(XMVector3Length(bp));
+        }
+
+        XMVECTOR closest;
+        XMVECTOR cp = XMVectorSubtract(p, c);
+        float d5 = XMVectorGetX(XMVector3Dot(ab, cp));
+        float d6 = XMVectorGetX(XMVector3Dot(ac, cp));
+        float vc = d1 * d4 - d3 * d2;
+        float vb = d5 * d2 - d1 * d6;
+        float va = d3 * d6 - d5 * d4;
+        if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+        {
+            closest = XMVectorAdd(a, XMVectorScale(ab, d1 / (d1 - d3)));
+        }
+        else if (d6 >= 0.0f && d5 <= d6)
+        {
+            closest = c;
+        }
+        else if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+        {
+            closest = XMVectorAdd(a, XMVectorScale(ac, d2 / (d2 - d6)));
+        }
+        else if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+        {
+            closest = XMVectorAdd(b, XMVectorScale(XMVectorSubtract(c, b), (d4 - d3) / ((d4 - d3) + (d5 - d6))));
+        }
+        else
+        {
+            float denominator = 1.0f / (va + vb + vc);
+            closest = XMVectorAdd(a, XMVectorAdd(XMVectorScale(ab, vb * denominator), XMVectorScale(ac, vc * denominator)));
+        }
+
+        return XMVectorGetX(XMVector3Length(XMVectorSubtract(p, closest)));
+    }
+
+    // Largest distance from a vertex of one mesh to the surface of the other, both ways.
+    float MeasureHausdorff(const GeometryGenerator::MeshData& a, const GeometryGenerator::MeshData& b)
+    {
+        float distance = 0.0f;
+        for (uint32_t pass = 0; pass < 2; pass++)
+        {
+            auto& from = pass == 0 ? a : b;
+            auto& to = pass == 0 ? b : a;
+            for (auto& vertex : from.Vertices)
+            {
+                XMVECTOR p = XMLoadFloat3(&vertex.Position);
+                float closest = 1e30f;
+                for (size_t i = 0; i < to.GetIndexCount(); i += 3)
+                {
+                    closest = (std::min)(closest, PointTriangleDistance(p, XMLoadFloat3(&to.Vertices[to.GetIndex(i)].Position),
+                        XMLoadFloat3(&to.Vertices[to.GetIndex(i + 1)].Position), XMLoadFloat3(&to.Vertices[to.GetIndex(i + 2)].Position)));
+                }
+
+                distance = (std::max)(distance, closest);
+            }
+        }
+
+        return distance;
+    }
+
+    // Quality: every level with its triangle count, the error BuildLodChain reports and the
+    // Hausdorff distance to level 0 measured by brute force.
+    void RunQuality(const char* name, const GeometryGenerator::MeshData& mesh)
+    {
+        MeshSimplifier simplifier;
+        auto lods = simplifier.BuildLodChain(mesh, 6);
+        std::printf("%s\n", name);
+        for (size_t level = 0; level < lods.size(); level++)
+        {
+            auto& lod = lods[level];
+            std::printf("  lod %zu %7zu tris %6zu verts  error %.5f  measured %.5f\n", level, lod.mesh.GetIndexCount() / 3, lod.mesh.Vertices.size(),
+                lod.error, MeasureHausdorff(mesh, lod.mesh));
+        }
+    }
+
+    // Throughput: a full chain of halving levels over input triangles per second.
+    void RunThroughput(const char* name, const GeometryGenerator::MeshData& mesh)
+    {
+        MeshSimplifier simplifier;
+        std::vector<MeshLod> lods;
+        double chain_ms = D3D::Test::MeasureMilliseconds(2, [&]()
+        {
+            lods = simplifier.BuildLodChain(mesh, 6);
+        });
+
+        std::vector<uint32_t> source(mesh.GetIndexCount());
+        std::vector<uint32_t> destination(source.size());
+        for (size_t i = 0; i < source.size(); i++)
+        {
+            source[i] = mesh.GetIndex(i);
+        }
+
+        uint32_t index_count = static_cast<uint32_t>(source.size());
+        uint32_t simplified_count = 0;
+        double quarter_ms = D3D::Test::MeasureMilliseconds(2, [&]()
+        {
+            simplified_count = simplifier.Simplify(source.data(), index_count, &mesh.Vertices[0].Position.x, sizeof(GeometryGenerator::Vertex),
+                static_cast<uint32_t>(mesh.Vertices.size()), index_count / 4, 1e30f, destination.data());
+        });
+
+        double triangle_count = index_count / 3.0;
+        std::printf("%-14s %8.0f %6zu %10.1f %10.1f %8.2f %8u\n", name, triangle_count, lods.size(), chain_ms, quarter_ms,
+            triangle_count / quarter_ms / 1000.0, simplified_count / 3);
+    }
+}
+
+int main()
+{
+    GeometryGenerator generator;
+
+    auto wavy_grid = generator.CreateGrid(10.0f, 10.0f, 41, 41);
+    for (auto& vertex : wavy_grid.Vertices)
+    {
+        vertex.Position.y = std::sin(vertex.Position.x * 0.5f) * std::cos(vertex.Position.z * 0.5f);
+    }
+
+    RunQuality("wavy grid 41", wavy_grid);
+    RunQuality("geosphere 4", generator.CreateGeosphere(1.0f, 4));
+    RunQuality("sphere 64", generator.CreateSphere(1.0f, 64, 64));
+    RunQuality("cylinder 64", generator.CreateCylinder(1.0f, 0.5f, 3.0f, 64, 16));
+
+    std::printf("\n%-14s %8s %6s %10s %10s %8s %8s\n", "mesh", "tris", "levels", "chain ms", "1/4 ms", "Mtri/s", "1/4 tris");
+    RunThroughput("geosphere 6", generator.CreateGeosphere(1.0f, 6));
+    RunThroughput("geosphere 7", generator.CreateGeosphere(1.0f, 7));
+    RunThroughput("sphere 512", generator.CreateSphere(1.0f, 512, 512));
+    RunThroughput("cylinder 256", generator.CreateCylinder(1.0f, 0.5f, 3.0f, 256, 256));
+    return 0;
+}
@@ -0,0 +1,483 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace D3D
+{
+    namespace
+    {
+        // Forsyth's scoring: the three most recent vertices score LAST_TRIANGLE_SCORE, so the
+        // triangle just emitted is not favoured over its neighbours, older entries decay with
+        // their age, and vertices with few triangles left get a boost so they are finished off.
+        const float CACHE_DECAY_POWER = 1.5f;
+        const float LAST_TRIANGLE_SCORE = 0.75f;
+        const float VALENCE_BOOST_SCALE = 2.0f;
+        const float VALENCE_BOOST_POWER = 0.5f;
+        const uint32_t VALENCE_TABLE_SIZE = 32;
+
+        const uint32_t INVALID_TRIANGLE = 0xffffffff;
+
+        // Cache of the overdraw pass, where a triangle missing all of its vertices starts a cluster.
+        const uint32_t CLUSTER_CACHE_SIZE = 16;
+
+        struct ScoreTables
+        {
+            float cache[MeshOptimizer::CACHE_SIZE];
+            float valence[VALENCE_TABLE_SIZE];
+
+            ScoreTables()
+            {
+                for (uint32_t i = 0; i < MeshOptimizer::CACHE_SIZE; i++)
+                {
+                    float age = (i - 3.0f) / (MeshOptimizer::CACHE_SIZE - 3);
+                    cache[i] = i < 3 ? LAST_TRIANGLE_SCORE : ::powf(1.0f - age, CACHE_DECAY_POWER);
+                }
+
+                for (uint32_t i = 1; i < VALENCE_TABLE_SIZE; i++)
+                {
+                    valence[i] = VALENCE_BOOST_SCALE * ::powf(static_cast<float>(i), -VALENCE_BOOST_POWER);
+                }
+
+                valence[0] = 0.0f;
+            }
+        };
+
+        const ScoreTables& GetScoreTables()
+        {
+            static ScoreTables tables;
+            return tables;
+        }
+
+        inline float VertexScore(const ScoreTables& tables, int32_t cache_position, uint32_t triangles_left)
+        {
+            if (triangles_left == 0)
+            {
+                return -1.0f;
+            }
+
+            float score = cache_position < 0 ? 0.0f : tables.cache[cache_position];
+            if (triangles_left < VALENCE_TABLE_SIZE)
+            {
+                return score + tables.valence[triangles_left];
+            }
+
+            return score + VALENCE_BOOST_SCALE * ::powf(static_cast<float>(triangles_left), -VALENCE_BOOST_POWER);
+        }
+
+        inline const float* GetPosition(const float* positions, uint32_t position_stride, uint32_t vertex)
+        {
+            return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + static_cast<size_t>(vertex) * position_stride);
+        }
+    }
+
+    void MeshOptimizer::OptimizeVertexCache(uint16_t* indices, uint32_t index_count, uint32_t vertex_count)
+    {
+        OptimizeVertexCacheImpl(indices, index_count, vertex_count);
+    }
+
+    void MeshOptimizer::OptimizeVertexCache(uint32_t* indices, uint32_t index_count, uint32_t vertex_count)
+    {
+        OptimizeVertexCacheImpl(indices, index_count, vertex_count);
+    }
+
+    void MeshOptimizer::OptimizeOverdraw(uint16_t* indices, uint32_t index_count, const float* positions, uint32_t position_stride, uint32_t vertex_count)
+    {
+        OptimizeOverdrawImpl(indices, index_count, positions, position_stride, vertex_count);
+    }
+
+    void MeshOptimizer::OptimizeOverdraw(uint32_t* indices, uint32_t index_count, const float* positions, uint32_t position_stride, uint32_t vertex_count)
+    {
+        OptimizeOverdrawImpl(indices, index_count, positions, position_stride, vertex_count);
+    }
+
+    uint32_t MeshOptimizer::OptimizeVertexFetch(uint16_t* indices, uint32_t index_count, uint32_t vertex_count, uint32_t* remap)
+    {
+        return OptimizeVertexFetchImpl(indices, index_count, vertex_count, remap);
+    }
+
+    uint32_t MeshOptimizer::OptimizeVertexFetch(uint32_t* indices, uint32_t index_count, uint32_t vertex_count, uint32_t* remap)
+    {
+        return OptimizeVertexFetchImpl(indices, index_count, vertex_count, remap);
+    }
+
+    void MeshOptimizer::Optimize(GeometryGenerator::MeshData& mesh, bool optimize_overdraw)
+    {
+        uint32_t index_count = static_cast<uint32_t>(mesh.GetIndexCount());
+        uint32_t vertex_count = static_cast<uint32_t>(mesh.Vertices.size());
+        if (index_count == 0)
+        {
+            return;
+        }
+
+        const float* positions = &mesh.Vertices[0].Position.x;
+        std::vector<uint32_t> remap(vertex_count);
+        uint32_t used_count = 0;
+        if (mesh.Use32BitIndices)
+        {
+            OptimizeVertexCache(mesh.Indices32.data(), index_count, vertex_count);
+            if (optimize_overdraw)
+            {
+                OptimizeOverdraw(mesh.Indices32.data(), index_count, positions, sizeof(GeometryGenerator::Vertex), vertex_count);
+            }
+
+            used_count = OptimizeVertexFetch(mesh.Indices32.data(), index_count, vertex_count, remap.data());
+        }
+        else
+        {
+            OptimizeVertexCache(mesh.Indices16.data(), index_count, vertex_count);
+            if (optimize_overdraw)
+            {
+                OptimizeOverdraw(mesh.Indices16.data(), index_count, positions, sizeof(GeometryGenerator::Vertex), vertex_count);
+            }
+
+            used_count = OptimizeVertexFetch(mesh.Indices16.data(), index_count, vertex_count, remap.data());
+        }
+
+        std::vector<GeometryGenerator::Vertex> vertices(used_count);
+        for (uint32_t i = 0; i < vertex_count; i++)
+        {
+            if (remap[i] != INVALID_VERTEX)
+            {
+                vertices[remap[i]] = mesh.Vertices[i];
+            }
+        }
+
+        mesh.Vertices.swap(vertices);
+    }
+
+    VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache(const uint16_t* indices, uint32_t index_count, uint32_t vertex_count, uint32_t cache_size)
+    {
+        return AnalyzeVertexCacheImpl(indices, index_count, vertex_count, cache_size);
+    }
+
+    VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache(const uint32_t* indices, uint32_t index_count, uint32_t vertex_count, uint32_t cache_size)
+    {
+        return AnalyzeVertexCacheImpl(indices, index_count, vertex_count, cache_size);
+    }
+
+    VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache(const GeometryGenerator::MeshData& mesh, uint32_t cache_size)
+    {
+        uint32_t index_count = static_cast<uint32_t>(mesh.GetIndexCount());
+        uint32_t vertex_count = static_cast<uint32_t>(mesh.Vertices.size());
+        if (mesh.Use32BitIndices)
+        {
+            return AnalyzeVertexCacheImpl(mesh.Indices32.data(), index_count, vertex_count, cache_size);
+        }
+
+        return AnalyzeVertexCacheImpl(mesh.Indices16.data(), index_count, vertex_count, cache_size);
+    }
+
+    template<typename TIndex>
+    void MeshOptimizer::OptimizeVertexCacheImpl(TIndex* indices, uint32_t index_count, uint32_t vertex_count)
+    {
+        assert(index_count % 3 == 0);
+
+        const ScoreTables& tables = GetScoreTables();
+        uint32_t triangle_count = index_count / 3;
+        if (triangle_count == 0)
+        {
+            return;
+        }
+
+        // Triangles of every vertex, the ones already emitted are swapped past the count.
+        triangle_counts_.assign(vertex_count, 0);
+        for (uint32_t i = 0; i < index_count; i++)
+        {
+            triangle_counts_[indices[i]]++;
+        }
+
+        triangle_offsets_.resize(vertex_count);
+        vertex_scratch_.resize(vertex_count);
+        uint32_t offset = 0;
+        for (uint32_t v = 0; v < vertex_count; v++)
+        {
+            triangle_offsets_[v] = offset;
+            vertex_scratch_[v] = offset;
+            offset += triangle_counts_[v];
+        }
+
+        vertex_triangles_.resize(index_count);
+        for (uint32_t i = 0; i < index_count; i++)
+        {
+            vertex_triangles_[vertex_scratch_[indices[i]]++] = i / 3;
+        }
+
+        cache_positions_.assign(vertex_count, -1);
+        vertex_scores_.resize(vertex_count);
+        for (uint32_t v = 0; v < vertex_count; v++)
+        {
+            vertex_scores_[v] = VertexScore(tables, -1, triangle_counts_[v]);
+        }
+
+        // Emitted triangles score -1, every live one scores more than zero.
+        triangle_scores_.resize(triangle_count);
+        uint32_t best_triangle = 0;
+        for (uint32_t t = 0; t < triangle_count; t++)
+        {
+            triangle_scores_[t] = vertex_scores_[indices[t * 3]] + vertex_scores_[indices[t * 3 + 1]] + vertex_scores_[indices[t * 3 + 2]];
+            if (triangle_scores_[t] > triangle_scores_[best_triangle])
+            {
+                best_triangle = t;
+            }
+        }
+
+        scratch_indices_.resize(index_count);
+        uint32_t cache[CACHE_SIZE + 3];
+        uint32_t cache_count = 0;
+        uint32_t input_cursor = 0;
+
+        for (uint32_t emitted = 0; emitted < triangle_count; emitted++)
+        {
+            // Nothing left around the cache, carry on in input order.
+            if (best_triangle == INVALID_TRIANGLE)
+            {
+                while (triangle_scores_[input_cursor] < 0.0f)
+                {
+                    input_cursor++;
+                }
+
+                best_triangle = input_cursor;
+            }
+
+            uint32_t* corners = &scratch_indices_[emitted * 3];
+            corners[0] = indices[best_triangle * 3];
+            corners[1] = indices[best_triangle * 3 + 1];
+            corners[2] = indices[best_triangle * 3 + 2];
+            triangle_scores_[best_triangle] = -1.0f;
+
+            for (uint32_t i = 0; i < 3; i++)
+            {
+                uint32_t v = corners[i];
+                uint32_t* triangles = &vertex_triangles_[triangle_offsets_[v]];
+                uint32_t* last = triangles + triangle_counts_[v];
+                uint32_t* found = std::find(triangles, last, best_triangle);
+                if (found != last)
+                {
+                    std::swap(*found, *(last - 1));
+                    triangle_counts_[v]--;
+                }
+            }
+
+            // The emitted vertices move to the front, the rest of the cache shifts back and
+            // whatever falls past CACHE_SIZE is evicted.
+            uint32_t new_cache[CACHE_SIZE + 3];
+            uint32_t new_count = 0;
+            for (uint32_t i = 0; i < 3; i++)
+            {
+                if (std::find(new_cache, new_cache + new_count, corners[i]) == new_cache + new_count)
+                {
+                    new_cache[new_count++] = corners[i];
+                }
+            }
+
+            for (uint32_t i = 0; i < cache_count; i++)
+            {
+                uint32_t v = cache[i];
+                if (v != corners[0] && v != corners[1] && v != corners[2])
+                {
+                    new_cache[new_count++] = v;
+                }
+            }
+
+            for (uint32_t i = 0; i < new_count; i++)
+            {
+                uint32_t v = new_cache[i];
+                cache_positions_[v] = i < CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+
+                float score = VertexScore(tables, cache_positions_[v], triangle_counts_[v]);
+                float delta = score - vertex_scores_[v];
+                vertex_scores_[v] = score;
+
+                const uint32_t* triangles = &vertex_triangles_[triangle_offsets_[v]];
+                for (uint32_t j = 0; j < triangle_counts_[v]; j++)
+                {
+                    triangle_scores_[triangles[j]] += delta;
+                }
+            }
+
+            best_triangle = INVALID_TRIANGLE;
+            float best_score = 0.0f;
+            cache_count = (std::min)(new_count, CACHE_SIZE);
+            for (uint32_t i = 0; i < cache_count; i++)
+            {
+                uint32_t v = new_cache[i];
+                cache[i] = v;
+
+                const uint32_t* triangles = &vertex_triangles_[triangle_offsets_[v]];
+                for (uint32_t j = 0; j < triangle_counts_[v]; j++)
+                {
+                    if (triangle_scores_[triangles[j]] > best_score)
+                    {
+                        best_score = triangle_scores_[triangles[j]];
+                        best_triangle = triangles[j];
+                    }
+                }
+            }
+        }
+
+        for (uint32_t i = 0; i < index_count; i++)
+        {
+            indices[i] = static_cast<TIndex>(scratch_indices_[i]);
+        }
+    }
+
+    template<typename TIndex>
+    void MeshOptimizer::OptimizeOverdrawImpl(TIndex* indices, uint32_t index_count, const float* positions, uint32_t position_stride, uint32_t vertex_count)
+    {
+        uint32_t triangle_count = index_count / 3;
+        if (triangle_count == 0)
+        {
+            return;
+        }
+
+        // A cluster starts wherever the cache would have to start over.
+        vertex_scratch_.assign(vertex_count, 0);
+        cluster_offsets_.clear();
+        uint32_t time = CLUSTER_CACHE_SIZE + 1;
+        for (uint32_t t = 0; t < triangle_count; t++)
+        {
+            uint32_t misses = 0;
+            for (uint32_t i = 0; i < 3; i++)
+            {
+                uint32_t v = indices[t * 3 + i];
+                if (time - vertex_scratch_[v] > CLUSTER_CACHE_SIZE)
+                {
+                    vertex_scratch_[v] = time++;
+                    misses++;
+                }
+            }
+
+            if (misses == 3 || t == 0)
+            {
+                cluster_offsets_.push_back(t);
+            }
+        }
+
+        uint32_t cluster_count = static_cast<uint32_t>(cluster_offsets_.size());
+        cluster_offsets_.push_back(triangle_count);
+
+        // Area weighted centroid and normal of every cluster and of the whole mesh.
+        std::vector<float> cluster_data(cluster_count * 6, 0.0f);
+        float mesh_centroid[3] = {};
+        float mesh_area = 0.0f;
+        for (uint32_t c = 0; c < cluster_count; c++)
+        {
+            float* data = &cluster_data[c * 6];
+            float area = 0.0f;
+            for (uint32_t t = cluster_offsets_[c]; t < cluster_offsets_[c + 1]; t++)
+            {
+                const float* p0 = GetPosition(positions, position_stride, indices[t * 3]);
+                const float* p1 = GetPosition(positions, position_stride, indices[t * 3 + 1]);
+                const float* p2 = GetPosition(positions, position_stride, indices[t * 3 + 2]);
+
+                float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+                float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+                float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+                float triangle_area = ::sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+                for (uint32_t k = 0; k < 3; k++)
+                {
+                    data[k] += (p0[k] + p1[k] + p2[k]) * triangle_area;
+                    data[3 + k] += n[k];
+                }
+
+                area += triangle_area;
+            }
+
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                mesh_centroid[k] += data[k];
+                data[k] /= area * 3.0f > 0.0f ? area * 3.0f : 1.0f;
+            }
+
+            mesh_area += area;
+        }
+
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            mesh_centroid[k] /= mesh_area * 3.0f > 0.0f ? mesh_area * 3.0f : 1.0f;
+        }
+
+        // Clusters facing away from the center the most are the likeliest to be in front.
+        cluster_keys_.resize(cluster_count);
+        cluster_order_.resize(cluster_count);
+        for (uint32_t c = 0; c < cluster_count; c++)
+        {
+            const float* data = &cluster_data[c * 6];
+            float length = ::sqrtf(data[3] * data[3] + data[4] * data[4] + data[5] * data[5]);
+            float dot = (data[0] - mesh_centroid[0]) * data[3] + (data[1] - mesh_centroid[1]) * data[4] + (data[2] - mesh_centroid[2]) * data[5];
+
+            cluster_keys_[c] = length > 0.0f ? dot / length : 0.0f;
+            cluster_order_[c] = c;
+        }
+
+        std::stable_sort(cluster_order_.begin(), cluster_order_.end(), [this](uint32_t a, uint32_t b)
+        {
+            return cluster_keys_[a] > cluster_keys_[b];
+        });
+
+        scratch_indices_.resize(index_count);
+        uint32_t* destination = scratch_indices_.data();
+        for (uint32_t c : cluster_order_)
+        {
+            for (uint32_t i = cluster_offsets_[c] * 3; i < cluster_offsets_[c + 1] * 3; i++)
+            {
+                *destination++ = indices[i];
+            }
+        }
+
+        for (uint32_t i = 0; i < index_count; i++)
+        {
+            indices[i] = static_cast<TIndex>(scratch_indices_[i]);
+        }
+    }
+
+    template<typename TIndex>
+    uint32_t MeshOptimizer::OptimizeVertexFetchImpl(TIndex* indices, uint32_t index_count, uint32_t vertex_count, uint32_t* remap)
+    {
+        std::fill(remap, remap + vertex_count, INVALID_VERTEX);
+
+        uint32_t used_count = 0;
+        for (uint32_t i = 0; i < index_count; i++)
+        {
+            uint32_t& vertex = remap[indices[i]];
+            if (vertex == INVALID_VERTEX)
+            {
+                vertex = used_count++;
+            }
+
+            indices[i] = static_cast<TIndex>(vertex);
+        }
+
+        return used_count;
+    }
+
+    template<typename TIndex>
+    VertexCacheStatistics MeshOptimizer::AnalyzeVertexCacheImpl(const TIndex* indices, uint32_t index_count, uint32_t vertex_count, uint32_t cache_size)
+    {
+        VertexCacheStatistics statistics;
+        if (index_count == 0 || vertex_count == 0)
+        {
+            return statistics;
+        }
+
+        // A vertex is still cached while fewer than cache_size others were loaded after it.
+        std::vector<uint32_t> timestamps(vertex_count, 0);
+        uint32_t time = cache_size + 1;
+        for (uint32_t i = 0; i < index_count; i++)
+        {
+            uint32_t v = indices[i];
+            if (time - timestamps[v] > cache_size)
+            {
+                timestamps[v] = time++;
+                statistics.vertices_transformed++;
+            }
+        }
+
+        statistics.acmr = static_cast<float>(statistics.vertices_transformed) / (index_count / 3);
+        statistics.atvr = static_cast<float>(statistics.vertices_transformed) / vertex_count;
+        return statistics;
+    }
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "GeometryGenerator.h"
+
+namespace D3D
+{
+    struct VertexCacheStatistics
+    {
+        uint32_t vertices_transformed = 0;                  // cache misses
+        float acmr = 0.0f;                                  // misses per triangle, 0.5 at best
+        float atvr = 0.0f;                                  // misses per vertex, 1 at best
+    };
+
+    // Index and vertex reordering for triangle lists, run offline or once after generation:
+    //  - OptimizeVertexCache reorders triangles for post transform cache reuse with Forsyth's
+    //    linear speed algorithm, which models an LRU cache of CACHE_SIZE entries and always
+    //    emits the best scoring triangle next to the vertices just used.
+    //  - OptimizeOverdraw then cuts the result into clusters where the cache starts over and sorts
+    //    the clusters outside in (Sander et al.'s Tipsify ordering), so front faces are likely
+    //    drawn first. The cache efficiency inside every cluster is kept.
+    //  - OptimizeVertexFetch renumbers vertices in the order the indices first use them, so
+    //    vertex fetches walk memory forwards.
+    // Scratch memory is kept between calls. Indices come in 16 and 32 bit.
+    class MeshOptimizer
+    {
+    public:
+        static const uint32_t CACHE_SIZE = 32;
+        static const uint32_t INVALID_VERTEX = 0xffffffff;
+
+        void OptimizeVertexCache(uint16_t* indices, uint32_t index_count, uint32_t vertex_count);
+        void OptimizeVertexCache(uint32_t* indices, uint32_t index_count, uint32_t vertex_count);
+
+        // positions are x, y, z floats position_stride bytes apart.
+        void OptimizeOverdraw(uint16_t* indices, uint32_t index_count, const float* positions, uint32_t position_stride, uint32_t vertex_count);
+        void OptimizeOverdraw(uint32_t* indices, uint32_t index_count, const float* positions, uint32_t position_stride, uint32_t vertex_count);
+
+        // Rewrites the indices and fills remap, old vertex to new, unused vertices get
+        // INVALID_VERTEX. Returns the number of vertices used.
+        uint32_t OptimizeVertexFetch(uint16_t* indices, uint32_t index_count, uint32_t vertex_count, uint32_t* remap);
+        uint32_t OptimizeVertexFetch(uint32_t* indices, uint32_t index_count, uint32_t vertex_count, uint32_t* remap);
+
+        // All of the above on a generated mesh, unused vertices are dropped.
+        void Optimize(GeometryGenerator::MeshData& mesh, bool optimize_overdraw = false);
+
+        // Simulates a FIFO cache of cache_size vertices, as most GPUs behave.
+        static VertexCacheStatistics AnalyzeVertexCache(const uint16_t* indices, uint32_t index_count, uint32_t vertex_count, uint32_t cache_size = 16);
+        static VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, uint32_t index_count, uint32_t vertex_count, uint32_t cache_size = 16);
+        static VertexCacheStatistics AnalyzeVertexCache(const GeometryGenerator::MeshData& mesh, uint32_t cache_size = 16);
+
+    private:
+        template<typename TIndex>
+        void OptimizeVertexCacheImpl(TIndex* indices, uint32_t index_count, uint32_t vertex_count);
+
+        template<typename TIndex>
+        void OptimizeOverdrawImpl(TIndex* indices, uint32_t index_count, const float* positions, uint32_t position_stride, uint32_t vertex_count);
+
+        template<typename TIndex>
+        uint32_t OptimizeVertexFetchImpl(TIndex* indices, uint32_t index_count, uint32_t vertex_count, uint32_t* remap);
+
+        template<typename TIndex>
+        static VertexCacheStatistics AnalyzeVertexCacheImpl(const TIndex* indices, uint32_t index_count, uint32_t vertex_count, uint32_t cache_size);
+
+        // Per vertex.
+        std::vector<uint32_t>                               triangle_offsets_;
+        std::vector<uint32_t>                               triangle_counts_;   // not yet emitted
+        std::vector<int32_t>                                cache_positions_;
+        std::vector<float>                                  vertex_scores_;
+        std::vector<uint32_t>                               vertex_scratch_;
+
+        // Per triangle.
+        std::vector<uint32_t>                               vertex_triangles_;  // triangles of every vertex
+        std::vector<float>                                  triangle_scores_;
+        std::vector<uint32_t>                               cluster_offsets_;
+        std::vector<float>                                  cluster_keys_;
+        std::vector<uint32_t>                               cluster_order_;
+        std::vector<uint32_t>                               scratch_indices_;
+    };
+};
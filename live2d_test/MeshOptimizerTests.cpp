@@ -0,0 +1,149 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+
+#include "TestHarness.h"
+
+using namespace D3D;
+
+namespace
+{
+    typedef std::array<float, 9> TrianglePositions;
+
+    // Triangles by their corner positions, rotated to start at the smallest corner and sorted,
+    // so two meshes compare equal whatever order their triangles and vertices come in.
+    std::vector<TrianglePositions> GetTriangles(const GeometryGenerator::MeshData& mesh)
+    {
+        std::vector<TrianglePositions> triangles;
+        for (size_t i = 0; i < mesh.GetIndexCount(); i += 3)
+        {
+            std::array<std::array<float, 3>, 3> corners;
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                auto& position = mesh.Vertices[mesh.GetIndex(i + k)].Position;
+                corners[k] = { position.x, position.y, position.z };
+            }
+
+            size_t first = std::min_element(corners.begin(), corners.end()) - corners.begin();
+            TrianglePositions triangle;
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                for (uint32_t c = 0; c < 3; c++)
+                {
+                    triangle[k * 3 + c] = corners[(first + k) % 3][c];
+                }
+            }
+
+            triangles.push_back(triangle);
+        }
+
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    }
+
+    // Vertices are first used in order after OptimizeVertexFetch.
+    bool IsFetchOrdered(const GeometryGenerator::MeshData& mesh)
+    {
+        uint32_t next_vertex = 0;
+        for (size_t i = 0; i < mesh.GetIndexCount(); i++)
+        {
+            uint32_t vertex = mesh.GetIndex(i);
+            if (vertex > next_vertex)
+            {
+                return false;
+            }
+
+            next_vertex = (std::max)(next_vertex, vertex + 1);
+        }
+
+        return next_vertex == mesh.Vertices.size();
+    }
+
+    // max_acmr and max_atvr hold with a 16 entry FIFO cache, generated meshes start at about 1
+    // and 2. They are a little above what the optimizer reaches today and catch a regression.
+    void CheckOptimize(const char* name, const GeometryGenerator::MeshData& source, float max_acmr, float max_atvr)
+    {
+        auto before = MeshOptimizer::AnalyzeVertexCache(source);
+        auto triangles = GetTriangles(source);
+
+        MeshOptimizer optimizer;
+        for (uint32_t overdraw = 0; overdraw < 2; overdraw++)
+        {
+            auto mesh = source;
+            optimizer.Optimize(mesh, overdraw != 0);
+
+            auto after = MeshOptimizer::AnalyzeVertexCache(mesh);
+            bool passed = after.acmr <= before.acmr + 1e-6f && after.acmr <= max_acmr && after.atvr <= max_atvr && after.atvr >= 1.0f;
+            if (!passed)
+            {
+                std::printf("%s overdraw %u: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", name, overdraw, before.acmr, after.acmr, before.atvr, after.atvr);
+            }
+
+            TEST_CHECK(passed);
+            TEST_CHECK(mesh.Use32BitIndices == source.Use32BitIndices);
+            TEST_CHECK(mesh.Vertices.size() == source.Vertices.size());
+            TEST_CHECK(GetTriangles(mesh) == triangles);
+            TEST_CHECK(IsFetchOrdered(mesh));
+        }
+    }
+
+    void TestGeneratorMeshes()
+    {
+        GeometryGenerator generator;
+        CheckOptimize("box", generator.CreateBox(1.0f, 1.0f, 1.0f, 3), 0.75f, 1.2f);
+        CheckOptimize("sphere", generator.CreateSphere(1.0f, 128, 128), 0.72f, 1.45f);
+        CheckOptimize("sphere 32 bit", generator.CreateSphere(1.0f, 300, 300), 0.72f, 1.45f);
+        CheckOptimize("geosphere", generator.CreateGeosphere(1.0f, 5), 0.75f, 1.5f);
+        CheckOptimize("cylinder", generator.CreateCylinder(1.0f, 0.5f, 3.0f, 64, 64), 0.72f, 1.4f);
+        CheckOptimize("grid", generator.CreateGrid(10.0f, 10.0f, 200, 200), 0.72f, 1.4f);
+        CheckOptimize("quad", generator.CreateQuad(0.0f, 0.0f, 1.0f, 1.0f, 0.0f), 2.0f, 1.0f);
+    }
+
+    void TestShuffledTriangles()
+    {
+        GeometryGenerator generator;
+        auto mesh = generator.CreateSphere(1.0f, 128, 128);
+
+        // Random triangle order is the worst case the optimizer has to recover from.
+        uint32_t triangle_count = static_cast<uint32_t>(mesh.GetIndexCount() / 3);
+        uint32_t seed = 1;
+        for (uint32_t i = triangle_count - 1; i > 0; i--)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            uint32_t j = (seed >> 8) % (i + 1);
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                std::swap(mesh.Indices16[i * 3 + k], mesh.Indices16[j * 3 + k]);
+            }
+        }
+
+        TEST_CHECK(MeshOptimizer::AnalyzeVertexCache(mesh).acmr > 2.5f);
+        CheckOptimize("shuffled sphere", mesh, 0.72f, 1.45f);
+    }
+
+    void TestUnusedVertices()
+    {
+        GeometryGenerator generator;
+        auto mesh = generator.CreateGrid(4.0f, 4.0f, 8, 8);
+        auto triangles = GetTriangles(mesh);
+
+        // Vertices no triangle uses are dropped.
+        mesh.Vertices.push_back(mesh.Vertices[0]);
+        mesh.Vertices.push_back(mesh.Vertices[1]);
+
+        MeshOptimizer optimizer;
+        optimizer.Optimize(mesh);
+        TEST_CHECK(mesh.Vertices.size() == 64);
+        TEST_CHECK(GetTriangles(mesh) == triangles);
+    }
+}
+
+int main()
+{
+    TestGeneratorMeshes();
+    TestShuffledTriangles();
+    TestUnusedVertices();
+    return D3D::Test::Finish("MeshOptimizerTests");
+}
@@ -0,0 +1,370 @@
+#include "Meshlet.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace D3D
+{
+    namespace
+    {
+        const uint32_t INVALID_TRIANGLE = 0xffffffff;
+        const uint8_t INVALID_SLOT = 0xff;
+
+        // Below this the normals spread over more than about 84 degrees from the axis and the cone
+        // is left out, it would only cull from a sliver of directions.
+        const float CONE_MIN_DOT = 0.1f;
+
+        inline const float* GetPosition(const float* positions, uint32_t position_stride, uint32_t vertex)
+        {
+            return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + static_cast<size_t>(vertex) * position_stride);
+        }
+
+        inline float Dot(const float a[3], const float b[3])
+        {
+            return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+        }
+    }
+
+    void MeshletBuilder::Build(const uint16_t* indices, uint32_t index_count, const float* positions, uint32_t position_stride, uint32_t vertex_count, MeshletData& meshlets)
+    {
+        BuildImpl(indices, index_count, vertex_count, meshlets);
+        ComputeBounds(positions, position_stride, meshlets);
+    }
+
+    void MeshletBuilder::Build(const uint32_t* indices, uint32_t index_count, const float* positions, uint32_t position_stride, uint32_t vertex_count, MeshletData& meshlets)
+    {
+        BuildImpl(indices, index_count, vertex_count, meshlets);
+        ComputeBounds(positions, position_stride, meshlets);
+    }
+
+    void MeshletBuilder::Build(const GeometryGenerator::MeshData& mesh, MeshletData& meshlets)
+    {
+        uint32_t index_count = static_cast<uint32_t>(mesh.GetIndexCount());
+        uint32_t vertex_count = static_cast<uint32_t>(mesh.Vertices.size());
+        const float* positions = vertex_count > 0 ? &mesh.Vertices[0].Position.x : nullptr;
+        if (mesh.Use32BitIndices)
+        {
+            Build(mesh.Indices32.data(), index_count, positions, sizeof(GeometryGenerator::Vertex), vertex_count, meshlets);
+        }
+        else
+        {
+            Build(mesh.Indices16.data(), index_count, positions, sizeof(GeometryGenerator::Vertex), vertex_count, meshlets);
+        }
+    }
+
+    template<typename TIndex>
+    void MeshletBuilder::BuildImpl(const TIndex* indices, uint32_t index_count, uint32_t vertex_count, MeshletData& meshlets)
+    {
+        assert(index_count % 3 == 0);
+
+        uint32_t triangle_count = index_count / 3;
+        meshlets.meshlets.clear();
+        meshlets.vertices.clear();
+        meshlets.triangles.resize(index_count);
+        meshlets.indices.resize(index_count);
+
+        // Triangles of every vertex, the ones already placed are swapped past the count.
+        triangle_counts_.assign(vertex_count, 0);
+        for (uint32_t i = 0; i < index_count; i++)
+        {
+            triangle_counts_[indices[i]]++;
+        }
+
+        triangle_offsets_.resize(vertex_count);
+        uint32_t offset = 0;
+        for (uint32_t v = 0; v < vertex_count; v++)
+        {
+            triangle_offsets_[v] = offset;
+            offset += triangle_counts_[v];
+        }
+
+        vertex_triangles_.resize(index_count);
+        for (uint32_t i = 0; i < index_count; i++)
+        {
+            uint32_t v = indices[i];
+            vertex_triangles_[triangle_offsets_[v]++] = i / 3;
+        }
+
+        for (uint32_t v = 0; v < vertex_count; v++)
+        {
+            triangle_offsets_[v] -= triangle_counts_[v];
+        }
+
+        meshlet_slots_.assign(vertex_count, INVALID_SLOT);
+        emitted_.assign(triangle_count, 0);
+
+        Meshlet meshlet;
+        uint32_t input_cursor = 0;
+        uint32_t next_triangle = INVALID_TRIANGLE;
+        for (uint32_t emitted = 0; emitted < triangle_count;)
+        {
+            if (next_triangle == INVALID_TRIANGLE)
+            {
+                next_triangle = FindNeighbour(indices, meshlets, meshlet);
+            }
+
+            // Nothing left around the meshlet, carry on in input order.
+            if (next_triangle == INVALID_TRIANGLE)
+            {
+                while (emitted_[input_cursor] != 0)
+                {
+                    input_cursor++;
+                }
+
+                next_triangle = input_cursor;
+            }
+
+            const TIndex* triangle = &indices[next_triangle * 3];
+            uint32_t new_vertices = (meshlet_slots_[triangle[0]] == INVALID_SLOT) + (meshlet_slots_[triangle[1]] == INVALID_SLOT) + (meshlet_slots_[triangle[2]] == INVALID_SLOT);
+
+            // Full, the triangle that did not fit seeds the next meshlet.
+            if (meshlet.vertex_count + new_vertices > MAX_VERTICES || meshlet.triangle_count == MAX_TRIANGLES)
+            {
+                for (uint32_t k = 0; k < meshlet.vertex_count; k++)
+                {
+                    meshlet_slots_[meshlets.vertices[meshlet.vertex_offset + k]] = INVALID_SLOT;
+                }
+
+                meshlets.meshlets.push_back(meshlet);
+                meshlet.vertex_offset = static_cast<uint32_t>(meshlets.vertices.size());
+                meshlet.triangle_offset = emitted;
+                meshlet.vertex_count = 0;
+                meshlet.triangle_count = 0;
+                continue;
+            }
+
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                uint32_t v = triangle[c];
+                if (meshlet_slots_[v] == INVALID_SLOT)
+                {
+                    meshlet_slots_[v] = static_cast<uint8_t>(meshlet.vertex_count++);
+                    meshlets.vertices.push_back(v);
+                }
+
+                meshlets.triangles[emitted * 3 + c] = meshlet_slots_[v];
+                meshlets.indices[emitted * 3 + c] = v;
+
+                uint32_t* vertex_triangles = vertex_triangles_.data() + triangle_offsets_[v];
+                uint32_t& live_count = triangle_counts_[v];
+                for (uint32_t i = 0; i < live_count; i++)
+                {
+                    if (vertex_triangles[i] == next_triangle)
+                    {
+                        std::swap(vertex_triangles[i], vertex_triangles[live_count - 1]);
+                        live_count--;
+                        break;
+                    }
+                }
+            }
+
+            emitted_[next_triangle] = 1;
+            meshlet.triangle_count++;
+            emitted++;
+            next_triangle = INVALID_TRIANGLE;
+        }
+
+        if (meshlet.triangle_count > 0)
+        {
+            for (uint32_t k = 0; k < meshlet.vertex_count; k++)
+            {
+                meshlet_slots_[meshlets.vertices[meshlet.vertex_offset + k]] = INVALID_SLOT;
+            }
+
+            meshlets.meshlets.push_back(meshlet);
+        }
+    }
+
+    template<typename TIndex>
+    uint32_t MeshletBuilder::FindNeighbour(const TIndex* indices, const MeshletData& meshlets, const Meshlet& meshlet) const
+    {
+        uint32_t best_triangle = INVALID_TRIANGLE;
+        uint32_t best_new_vertices = 4;
+        uint32_t best_live_count = 0;
+        for (uint32_t k = 0; k < meshlet.vertex_count; k++)
+        {
+            uint32_t v = meshlets.vertices[meshlet.vertex_offset + k];
+            const uint32_t* vertex_triangles = vertex_triangles_.data() + triangle_offsets_[v];
+            for (uint32_t i = 0; i < triangle_counts_[v]; i++)
+            {
+                uint32_t t = vertex_triangles[i];
+                const TIndex* triangle = &indices[t * 3];
+                uint32_t new_vertices = (meshlet_slots_[triangle[0]] == INVALID_SLOT) + (meshlet_slots_[triangle[1]] == INVALID_SLOT) + (meshlet_slots_[triangle[2]] == INVALID_SLOT);
+                uint32_t live_count = triangle_counts_[triangle[0]] + triangle_counts_[triangle[1]] + triangle_counts_[triangle[2]];
+                if (new_vertices < best_new_vertices || (new_vertices == best_new_vertices && live_count < best_live_count))
+                {
+                    best_triangle = t;
+                    best_new_vertices = new_vertices;
+                    best_live_count = live_count;
+                }
+            }
+        }
+
+        return best_triangle;
+    }
+
+    void MeshletBuilder::ComputeBounds(const float* positions, uint32_t position_stride, MeshletData& meshlets)
+    {
+        auto& bounds = meshlets.bounds;
+        uint32_t meshlet_count = static_cast<uint32_t>(meshlets.meshlets.size());
+        for (auto* values : { &bounds.center_x, &bounds.center_y, &bounds.center_z, &bounds.radius, &bounds.apex_x, &bounds.apex_y, &bounds.apex_z,
+            &bounds.axis_x, &bounds.axis_y, &bounds.axis_z, &bounds.cutoff })
+        {
+            values->resize(meshlet_count);
+        }
+
+        float normals[MAX_TRIANGLES][3];
+        uint32_t normal_vertices[MAX_TRIANGLES];
+        for (uint32_t m = 0; m < meshlet_count; m++)
+        {
+            auto& meshlet = meshlets.meshlets[m];
+
+            // Sphere around the center of the box of the vertices.
+            float box_min[3] = { INFINITY, INFINITY, INFINITY };
+            float box_max[3] = { -INFINITY, -INFINITY, -INFINITY };
+            for (uint32_t k = 0; k < meshlet.vertex_count; k++)
+            {
+                const float* p = GetPosition(positions, position_stride, meshlets.vertices[meshlet.vertex_offset + k]);
+                for (uint32_t c = 0; c < 3; c++)
+                {
+                    box_min[c] = (std::min)(box_min[c], p[c]);
+                    box_max[c] = (std::max)(box_max[c], p[c]);
+                }
+            }
+
+            float center[3] = { (box_min[0] + box_max[0]) * 0.5f, (box_min[1] + box_max[1]) * 0.5f, (box_min[2] + box_max[2]) * 0.5f };
+            float radius_sq = 0.0f;
+            for (uint32_t k = 0; k < meshlet.vertex_count; k++)
+            {
+                const float* p = GetPosition(positions, position_stride, meshlets.vertices[meshlet.vertex_offset + k]);
+                float d[3] = { p[0] - center[0], p[1] - center[1], p[2] - center[2] };
+                radius_sq = (std::max)(radius_sq, Dot(d, d));
+            }
+
+            bounds.center_x[m] = center[0];
+            bounds.center_y[m] = center[1];
+            bounds.center_z[m] = center[2];
+            bounds.radius[m] = std::sqrt(radius_sq);
+
+            // Front face normals, clockwise as in every pass of the renderer. Degenerate triangles
+            // are never drawn and do not count.
+            float axis[3] = {};
+            uint32_t normal_count = 0;
+            const uint32_t* triangle_indices = &meshlets.indices[meshlet.triangle_offset * 3];
+            for (uint32_t t = 0; t < meshlet.triangle_count; t++)
+            {
+                const float* p0 = GetPosition(positions, position_stride, triangle_indices[t * 3]);
+                const float* p1 = GetPosition(positions, position_stride, triangle_indices[t * 3 + 1]);
+                const float* p2 = GetPosition(positions, position_stride, triangle_indices[t * 3 + 2]);
+                float e0[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+                float e1[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+                float* n = normals[normal_count];
+                n[0] = e0[1] * e1[2] - e0[2] * e1[1];
+                n[1] = e0[2] * e1[0] - e0[0] * e1[2];
+                n[2] = e0[0] * e1[1] - e0[1] * e1[0];
+
+                float length = std::sqrt(Dot(n, n));
+                if (length > 0.0f)
+                {
+                    n[0] /= length;
+                    n[1] /= length;
+                    n[2] /= length;
+                    axis[0] += n[0];
+                    axis[1] += n[1];
+                    axis[2] += n[2];
+                    normal_vertices[normal_count++] = triangle_indices[t * 3];
+                }
+            }
+
+            float axis_length = std::sqrt(Dot(axis, axis));
+            float min_dot = 1.0f;
+            if (axis_length > 0.0f)
+            {
+                axis[0] /= axis_length;
+                axis[1] /= axis_length;
+                axis[2] /= axis_length;
+                for (uint32_t t = 0; t < normal_count; t++)
+                {
+                    min_dot = (std::min)(min_dot, Dot(axis, normals[t]));
+                }
+            }
+
+            if (normal_count == 0 || axis_length == 0.0f || min_dot <= CONE_MIN_DOT)
+            {
+                bounds.apex_x[m] = center[0];
+                bounds.apex_y[m] = center[1];
+                bounds.apex_z[m] = center[2];
+                bounds.axis_x[m] = 0.0f;
+                bounds.axis_y[m] = 0.0f;
+                bounds.axis_z[m] = 0.0f;
+                bounds.cutoff[m] = 1.0f;
+                continue;
+            }
+
+            // The apex goes back along the axis until it is behind every triangle plane, so any
+            // camera inside the cone opened around it is behind all of them too.
+            float max_t = 0.0f;
+            for (uint32_t t = 0; t < normal_count; t++)
+            {
+                const float* p0 = GetPosition(positions, position_stride, normal_vertices[t]);
+                float d[3] = { center[0] - p0[0], center[1] - p0[1], center[2] - p0[2] };
+                max_t = (std::max)(max_t, Dot(d, normals[t]) / Dot(axis, normals[t]));
+            }
+
+            bounds.apex_x[m] = center[0] - axis[0] * max_t;
+            bounds.apex_y[m] = center[1] - axis[1] * max_t;
+            bounds.apex_z[m] = center[2] - axis[2] * max_t;
+            bounds.axis_x[m] = axis[0];
+            bounds.axis_y[m] = axis[1];
+            bounds.axis_z[m] = axis[2];
+            bounds.cutoff[m] = std::sqrt(1.0f - min_dot * min_dot);
+        }
+    }
+
+    uint32_t ClusterCuller::Cull(const MeshletData& meshlets, const Frustum& frustum, const float camera_position[3], ClusterDrawRange* ranges, TaskScheduler* scheduler)
+    {
+        auto& bounds = meshlets.bounds;
+        uint32_t meshlet_count = static_cast<uint32_t>(meshlets.meshlets.size());
+        visible_meshlets_.resize(meshlet_count);
+        uint32_t frustum_count = frustum_culler_.CullSpheres(frustum, bounds.center_x.data(), bounds.center_y.data(), bounds.center_z.data(), bounds.radius.data(),
+            meshlet_count, visible_meshlets_.data(), scheduler);
+
+        // The survivors come in ascending order, so neighbours in the index buffer are next to
+        // each other here as well.
+        uint32_t range_count = 0;
+        visible_count_ = 0;
+        for (uint32_t v = 0; v < frustum_count; v++)
+        {
+            uint32_t m = visible_meshlets_[v];
+            float d[3] = { bounds.apex_x[m] - camera_position[0], bounds.apex_y[m] - camera_position[1], bounds.apex_z[m] - camera_position[2] };
+            float axis[3] = { bounds.axis_x[m], bounds.axis_y[m], bounds.axis_z[m] };
+            if (Dot(d, axis) > bounds.cutoff[m] * std::sqrt(Dot(d, d)))
+            {
+                continue;
+            }
+
+            auto& meshlet = meshlets.meshlets[m];
+            uint32_t start_index = meshlet.triangle_offset * 3;
+            if (range_count > 0 && ranges[range_count - 1].start_index + ranges[range_count - 1].index_count == start_index)
+            {
+                ranges[range_count - 1].index_count += meshlet.triangle_count * 3;
+            }
+            else
+            {
+                ranges[range_count].start_index = start_index;
+                ranges[range_count].index_count = meshlet.triangle_count * 3;
+                range_count++;
+            }
+
+            visible_count_++;
+        }
+
+        return range_count;
+    }
+
+    uint32_t ClusterCuller::GetVisibleCount() const
+    {
+        return visible_count_;
+    }
+};
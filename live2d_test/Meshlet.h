@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "FrustumCulling.h"
+#include "GeometryGenerator.h"
+
+namespace D3D
+{
+    class TaskScheduler;
+
+    // A cluster of up to MeshletBuilder::MAX_VERTICES vertices and MAX_TRIANGLES triangles. Mesh
+    // shaders read its vertex list and local triangles, the input assembler draws it as the index
+    // range [triangle_offset * 3, (triangle_offset + triangle_count) * 3) of MeshletData::indices.
+    struct Meshlet
+    {
+        uint32_t vertex_offset = 0;                         // into MeshletData::vertices
+        uint32_t triangle_offset = 0;                       // into MeshletData::triangles and indices, in triangles
+        uint32_t vertex_count = 0;
+        uint32_t triangle_count = 0;
+    };
+
+    // Per meshlet culling volumes, structure of arrays as FrustumCuller reads them. Every triangle
+    // of meshlet i faces away from a camera at c when
+    //     dot(normalize(apex - c), axis) > cutoff
+    // Meshlets whose normals spread too far get a zero axis and a cutoff of 1, which never culls.
+    struct MeshletBounds
+    {
+        std::vector<float> center_x;
+        std::vector<float> center_y;
+        std::vector<float> center_z;
+        std::vector<float> radius;
+        std::vector<float> apex_x;
+        std::vector<float> apex_y;
+        std::vector<float> apex_z;
+        std::vector<float> axis_x;
+        std::vector<float> axis_y;
+        std::vector<float> axis_z;
+        std::vector<float> cutoff;
+    };
+
+    struct MeshletData
+    {
+        std::vector<Meshlet> meshlets;
+        std::vector<uint32_t> vertices;                     // mesh vertex of every meshlet vertex
+        std::vector<uint8_t> triangles;                     // three meshlet local vertices per triangle
+        std::vector<uint32_t> indices;                      // the same triangles in mesh vertices
+        MeshletBounds bounds;
+    };
+
+    // Splits triangle lists into meshlets. A meshlet grows by the live triangle around its
+    // vertices that adds the fewest new vertices, preferring vertices with few triangles left so
+    // regions are finished off instead of leaving holes, and starts over once the next triangle
+    // does not fit. Without a neighbour the first triangle left in input order is taken, so a
+    // mesh that went through MeshOptimizer first gives the most compact meshlets.
+    class MeshletBuilder
+    {
+    public:
+        static const uint32_t MAX_VERTICES = 64;
+        static const uint32_t MAX_TRIANGLES = 124;
+
+        // positions are x, y, z floats position_stride bytes apart.
+        void Build(const uint16_t* indices, uint32_t index_count, const float* positions, uint32_t position_stride, uint32_t vertex_count, MeshletData& meshlets);
+        void Build(const uint32_t* indices, uint32_t index_count, const float* positions, uint32_t position_stride, uint32_t vertex_count, MeshletData& meshlets);
+        void Build(const GeometryGenerator::MeshData& mesh, MeshletData& meshlets);
+
+    private:
+        template<typename TIndex>
+        void BuildImpl(const TIndex* indices, uint32_t index_count, uint32_t vertex_count, MeshletData& meshlets);
+
+        template<typename TIndex>
+        uint32_t FindNeighbour(const TIndex* indices, const MeshletData& meshlets, const Meshlet& meshlet) const;
+
+        static void ComputeBounds(const float* positions, uint32_t position_stride, MeshletData& meshlets);
+
+        // Per vertex.
+        std::vector<uint32_t>                               triangle_offsets_;
+        std::vector<uint32_t>                               triangle_counts_;   // not yet in a meshlet
+        std::vector<uint8_t>                                meshlet_slots_;     // local index in the open meshlet
+
+        // Per triangle.
+        std::vector<uint32_t>                               vertex_triangles_;  // triangles of every vertex
+        std::vector<uint8_t>                                emitted_;
+    };
+
+    // Index range of consecutive visible meshlets, laid out as the index fields of
+    // D3D12_DRAW_INDEXED_ARGUMENTS so the ranges can be written straight into indirect arguments.
+    struct ClusterDrawRange
+    {
+        uint32_t index_count = 0;
+        uint32_t start_index = 0;
+    };
+
+    // Per view meshlet culling on the CPU: a frustum test of the bounding spheres through
+    // FrustumCuller, then the normal cone test on the survivors. Visible meshlets that follow
+    // each other in MeshletData::indices are merged into one range.
+    class ClusterCuller
+    {
+    public:
+        // Both frustum and camera_position are in the space of the mesh: build the frustum from
+        // world * view * proj and move the camera by the inverse world matrix. ranges must hold one
+        // entry per meshlet, returns the number written.
+        uint32_t Cull(const MeshletData& meshlets, const Frustum& frustum, const float camera_position[3], ClusterDrawRange* ranges, TaskScheduler* scheduler = nullptr);
+
+        // Meshlets in the ranges of the last Cull.
+        uint32_t GetVisibleCount() const;
+
+    private:
+        FrustumCuller                                       frustum_culler_;
+        std::vector<uint32_t>                               visible_meshlets_;
+        uint32_t                                            visible_count_ = 0;
+    };
+};
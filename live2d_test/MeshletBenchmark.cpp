@@ -0,0 +1,64 @@
+#include "Meshlet.h"
+
+#include "MeshOptimizer.h"
+#include "PortableMath.h"
+#include "TestHarness.h"
+
+using namespace D3D;
+using namespace DirectX;
+
+namespace
+{
+    void Run(const char* name, GeometryGenerator::MeshData mesh, bool optimize)
+    {
+        if (optimize)
+        {
+            MeshOptimizer optimizer;
+            optimizer.Optimize(mesh);
+        }
+
+        MeshletBuilder builder;
+        MeshletData data;
+        double build_ms = D3D::Test::MeasureMilliseconds(2, [&]()
+        {
+            builder.Build(mesh, data);
+        });
+
+        // A camera outside the mesh looking at its center, closed meshes turn about half away.
+        float camera[3] = { 0.0f, 5.0f, -40.0f };
+        XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(camera[0], camera[1], camera[2], 1.0f), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+        XMFLOAT4X4 view_proj;
+        XMStoreFloat4x4(&view_proj, view * XMMatrixPerspectiveFovLH(0.8f, 1.5f, 0.1f, 1000.0f));
+        Frustum frustum = Frustum::FromViewProj(&view_proj._11);
+
+        ClusterCuller culler;
+        std::vector<ClusterDrawRange> ranges(data.meshlets.size());
+        uint32_t range_count = 0;
+        double cull_ms = D3D::Test::MeasureMilliseconds(20, [&]()
+        {
+            range_count = culler.Cull(data, frustum, camera, ranges.data());
+        });
+
+        uint32_t triangle_count = static_cast<uint32_t>(mesh.GetIndexCount() / 3);
+        double meshlet_count = static_cast<double>(data.meshlets.size());
+        std::printf("%-16s %8u %7zu %6.1f %6.1f %9.2f %7.2f %7.3f %7.1f%% %6u\n", name, triangle_count, data.meshlets.size(),
+            data.vertices.size() / meshlet_count, triangle_count / meshlet_count, build_ms, triangle_count / build_ms / 1000.0, cull_ms,
+            100.0 * culler.GetVisibleCount() / meshlet_count, range_count);
+    }
+}
+
+// Build time, meshlet fill and per view cull time on generator meshes, with and without
+// MeshOptimizer run first.
+int main()
+{
+    GeometryGenerator generator;
+    std::printf("%-16s %8s %7s %6s %6s %9s %7s %7s %8s %6s\n", "mesh", "tris", "lets", "avg v", "avg t", "build ms", "Mtri/s", "cull ms", "visible", "ranges");
+    Run("geosphere 5", generator.CreateGeosphere(10.0f, 5), false);
+    Run("geosphere 7", generator.CreateGeosphere(10.0f, 7), false);
+    Run("geosphere 7 opt", generator.CreateGeosphere(10.0f, 7), true);
+    Run("sphere 512", generator.CreateSphere(10.0f, 512, 512), false);
+    Run("sphere 512 opt", generator.CreateSphere(10.0f, 512, 512), true);
+    Run("cylinder 256", generator.CreateCylinder(10.0f, 5.0f, 20.0f, 256, 256), false);
+    Run("grid 1024", generator.CreateGrid(20.0f, 20.0f, 1024, 1024), false);
+    return 0;
+}
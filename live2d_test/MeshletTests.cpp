@@ -0,0 +1,256 @@
+#include "Meshlet.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "MeshOptimizer.h"
+#include "PortableMath.h"
+#include "TestHarness.h"
+
+using namespace D3D;
+using namespace DirectX;
+
+namespace
+{
+    typedef std::array<uint32_t, 3> Triangle;
+
+    struct Random
+    {
+        uint32_t seed = 1;
+
+        // In [-1, 1).
+        float Next()
+        {
+            seed = seed * 1664525u + 1013904223u;
+            return static_cast<float>(seed >> 8) / 8388608.0f - 1.0f;
+        }
+    };
+
+    Triangle MakeTriangle(uint32_t a, uint32_t b, uint32_t c)
+    {
+        // Rotated to start at the smallest index, the winding is kept.
+        Triangle triangle = { a, b, c };
+        while (triangle[0] > triangle[1] || triangle[0] > triangle[2])
+        {
+            triangle = { triangle[1], triangle[2], triangle[0] };
+        }
+
+        return triangle;
+    }
+
+    XMVECTOR LoadPosition(const GeometryGenerator::MeshData& mesh, uint32_t vertex)
+    {
+        return XMLoadFloat3(&mesh.Vertices[vertex].Position);
+    }
+
+    float GetExtent(const GeometryGenerator::MeshData& mesh)
+    {
+        float extent = 0.0f;
+        for (auto& vertex : mesh.Vertices)
+        {
+            extent = (std::max)(extent, (std::max)(std::fabs(vertex.Position.x), (std::max)(std::fabs(vertex.Position.y), std::fabs(vertex.Position.z))));
+        }
+
+        return extent;
+    }
+
+    void CheckStructure(const GeometryGenerator::MeshData& mesh, const MeshletData& data)
+    {
+        uint32_t index_count = static_cast<uint32_t>(mesh.GetIndexCount());
+        TEST_CHECK(data.indices.size() == index_count);
+        TEST_CHECK(data.triangles.size() == index_count);
+        TEST_CHECK(data.bounds.radius.size() == data.meshlets.size() && data.bounds.cutoff.size() == data.meshlets.size());
+
+        uint32_t triangle_total = 0;
+        uint32_t vertex_total = 0;
+        bool valid = true;
+        for (auto& meshlet : data.meshlets)
+        {
+            valid = valid && meshlet.triangle_count > 0 && meshlet.vertex_count > 0;
+            valid = valid && meshlet.vertex_count <= MeshletBuilder::MAX_VERTICES && meshlet.triangle_count <= MeshletBuilder::MAX_TRIANGLES;
+            valid = valid && meshlet.triangle_offset == triangle_total && meshlet.vertex_offset == vertex_total;
+            triangle_total += meshlet.triangle_count;
+            vertex_total += meshlet.vertex_count;
+
+            // Local triangles and mesh indices name the same vertices, every vertex listed once.
+            std::vector<uint32_t> vertices(data.vertices.begin() + meshlet.vertex_offset, data.vertices.begin() + meshlet.vertex_offset + meshlet.vertex_count);
+            std::sort(vertices.begin(), vertices.end());
+            valid = valid && std::adjacent_find(vertices.begin(), vertices.end()) == vertices.end();
+            for (uint32_t i = meshlet.triangle_offset * 3; i < (meshlet.triangle_offset + meshlet.triangle_count) * 3; i++)
+            {
+                uint8_t local = data.triangles[i];
+                valid = valid && local < meshlet.vertex_count && data.vertices[meshlet.vertex_offset + local] == data.indices[i];
+            }
+        }
+
+        TEST_CHECK(valid);
+        TEST_CHECK(triangle_total * 3 == index_count && vertex_total == data.vertices.size());
+
+        // Every input triangle ends up in exactly one meshlet, with its winding.
+        std::vector<Triangle> input;
+        std::vector<Triangle> output;
+        for (uint32_t i = 0; i < index_count; i += 3)
+        {
+            input.push_back(MakeTriangle(mesh.GetIndex(i), mesh.GetIndex(i + 1), mesh.GetIndex(i + 2)));
+            output.push_back(MakeTriangle(data.indices[i], data.indices[i + 1], data.indices[i + 2]));
+        }
+
+        std::sort(input.begin(), input.end());
+        std::sort(output.begin(), output.end());
+        TEST_CHECK(input == output);
+    }
+
+    void CheckBounds(const GeometryGenerator::MeshData& mesh, const MeshletData& data)
+    {
+        auto& bounds = data.bounds;
+        float extent = GetExtent(mesh);
+
+        // Every vertex lies inside the sphere of its meshlet.
+        bool contained = true;
+        for (size_t m = 0; m < data.meshlets.size(); m++)
+        {
+            auto& meshlet = data.meshlets[m];
+            XMVECTOR center = XMVectorSet(bounds.center_x[m], bounds.center_y[m], bounds.center_z[m], 0.0f);
+            for (uint32_t k = 0; k < meshlet.vertex_count; k++)
+            {
+                float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(LoadPosition(mesh, data.vertices[meshlet.vertex_offset + k]), center)));
+                contained = contained && distance <= bounds.radius[m] * 1.0001f + 1e-6f;
+            }
+        }
+
+        TEST_CHECK(contained);
+
+        // A camera the cone says is behind a meshlet sees no front face of it. Cameras are
+        // placed all around the mesh, some close to the surface where the cone is tightest.
+        Random random;
+        uint32_t culled_count = 0;
+        bool conservative = true;
+        for (uint32_t c = 0; c < 200; c++)
+        {
+            float distance = c % 2 == 0 ? extent * 3.0f : extent * 1.2f;
+            XMVECTOR camera = XMVectorScale(XMVector3Normalize(XMVectorSet(random.Next(), random.Next(), random.Next(), 0.0f)), distance);
+            for (size_t m = 0; m < data.meshlets.size(); m++)
+            {
+                XMVECTOR apex = XMVectorSet(bounds.apex_x[m], bounds.apex_y[m], bounds.apex_z[m], 0.0f);
+                XMVECTOR axis = XMVectorSet(bounds.axis_x[m], bounds.axis_y[m], bounds.axis_z[m], 0.0f);
+                float cone = XMVectorGetX(XMVector3Dot(XMVector3Normalize(XMVectorSubtract(apex, camera)), axis));
+                if (cone <= bounds.cutoff[m])
+                {
+                    continue;
+                }
+
+                culled_count++;
+                auto& meshlet = data.meshlets[m];
+                for (uint32_t i = meshlet.triangle_offset * 3; i < (meshlet.triangle_offset + meshlet.triangle_count) * 3; i += 3)
+                {
+                    XMVECTOR p0 = LoadPosition(mesh, data.indices[i]);
+                    XMVECTOR normal = XMVector3Cross(XMVectorSubtract(LoadPosition(mesh, data.indices[i + 1]), p0), XMVectorSubtract(LoadPosition(mesh, data.indices[i + 2]), p0));
+                    float facing = XMVectorGetX(XMVector3Dot(normal, XMVectorSubtract(camera, p0)));
+                    conservative = conservative && facing <= 1e-4f * XMVectorGetX(XMVector3Length(normal)) * extent;
+                }
+            }
+        }
+
+        TEST_CHECK(conservative);
+
+        // A few meshlets over a whole closed mesh are too curved for any cone to cull.
+        TEST_CHECK(culled_count > 0 || data.meshlets.size() < 8);
+    }
+
+    void CheckCuller(const GeometryGenerator::MeshData& mesh, const MeshletData& data)
+    {
+        // Drawn meshlets pass the frustum test, ranges are sorted and merged as far as they can be.
+        float extent = GetExtent(mesh);
+        Random random;
+        ClusterCuller culler;
+        std::vector<ClusterDrawRange> ranges(data.meshlets.size());
+        bool valid = true;
+        for (uint32_t c = 0; c < 50; c++)
+        {
+            float camera[3] = { random.Next() * extent * 3.0f, random.Next() * extent * 3.0f + extent * 0.5f, random.Next() * extent * 3.0f };
+            XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(camera[0], camera[1], camera[2], 1.0f), XMVectorSet(random.Next() * extent * 0.5f, 0.0f, 0.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+            XMFLOAT4X4 view_proj;
+            XMStoreFloat4x4(&view_proj, view * XMMatrixPerspectiveFovLH(1.0f, 1.5f, 0.1f, 1000.0f));
+            Frustum frustum = Frustum::FromViewProj(&view_proj._11);
+
+            uint32_t range_count = culler.Cull(data, frustum, camera, ranges.data());
+            std::vector<uint8_t> drawn(mesh.GetIndexCount() / 3, 0);
+            for (uint32_t r = 0; r < range_count; r++)
+            {
+                valid = valid && ranges[r].index_count > 0 && ranges[r].index_count % 3 == 0;
+                valid = valid && (r == 0 || ranges[r].start_index > ranges[r - 1].start_index + ranges[r - 1].index_count);
+                std::fill(drawn.begin() + ranges[r].start_index / 3, drawn.begin() + (ranges[r].start_index + ranges[r].index_count) / 3, 1);
+            }
+
+            uint32_t visible_count = 0;
+            for (size_t m = 0; m < data.meshlets.size(); m++)
+            {
+                auto& bounds = data.bounds;
+                if (drawn[data.meshlets[m].triangle_offset])
+                {
+                    visible_count++;
+                    valid = valid && frustum.IntersectsSphere(bounds.center_x[m], bounds.center_y[m], bounds.center_z[m], bounds.radius[m]);
+                }
+            }
+
+            valid = valid && visible_count == culler.GetVisibleCount();
+        }
+
+        TEST_CHECK(valid);
+    }
+
+    void Check(const GeometryGenerator::MeshData& mesh)
+    {
+        MeshletBuilder builder;
+        MeshletData data;
+        builder.Build(mesh, data);
+        CheckStructure(mesh, data);
+        CheckBounds(mesh, data);
+        CheckCuller(mesh, data);
+
+        // Optimized meshes take the other path through the builder's neighbour search.
+        auto optimized = mesh;
+        MeshOptimizer optimizer;
+        optimizer.Optimize(optimized);
+        builder.Build(optimized, data);
+        CheckStructure(optimized, data);
+        CheckBounds(optimized, data);
+    }
+
+    void TestGeneratorMeshes()
+    {
+        GeometryGenerator generator;
+        for (uint32_t depth = 0; depth <= 5; depth++)
+        {
+            Check(generator.CreateGeosphere(10.0f, depth));
+        }
+
+        Check(generator.CreateGrid(100.0f, 100.0f, 64, 64));
+        Check(generator.CreateGrid(100.0f, 60.0f, 301, 17));
+        Check(generator.CreateCylinder(5.0f, 2.0f, 10.0f, 64, 32));
+        Check(generator.CreateCylinder(5.0f, 5.0f, 1.0f, 7, 1));
+        Check(generator.CreateSphere(10.0f, 100, 100));
+        Check(generator.CreateBox(10.0f, 10.0f, 10.0f, 2));
+    }
+
+    void TestLargeIndexCount()
+    {
+        // 32 bit indices go through the other Build overload.
+        GeometryGenerator generator;
+        auto mesh = generator.CreateGrid(100.0f, 100.0f, 300, 300);
+        TEST_CHECK(mesh.Use32BitIndices);
+
+        MeshletBuilder builder;
+        MeshletData data;
+        builder.Build(mesh, data);
+        CheckStructure(mesh, data);
+    }
+}
+
+int main()
+{
+    TestGeneratorMeshes();
+    TestLargeIndexCount();
+    return D3D::Test::Finish("MeshletTests");
+}
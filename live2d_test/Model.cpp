@@ -1,5 +1,7 @@
 #include "Model.h"
 
+#include "TaskScheduler.h"
+
 namespace D3D
 {
     using namespace DirectX;
@@ -19,11 +21,15 @@ namespace D3D
         matrix_dirty_ = true;
     }
 
-    void Model::SetOriention(const DirectX::XMFLOAT3& oriention)
+    void Model::SetRotation(const DirectX::XMFLOAT4& rotation)
     {
-        auto v_oriention = XMLoadFloat3(&oriention);
-        XMStoreFloat3(&oriention_, XMVector3Normalize(v_oriention));
+        XMStoreFloat4(&rotation_, XMQuaternionNormalize(XMLoadFloat4(&rotation)));
+        matrix_dirty_ = true;
+    }
 
+    void Model::SetRotationRollPitchYaw(const DirectX::XMFLOAT3& pitch_yaw_roll)
+    {
+        XMStoreFloat4(&rotation_, XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&pitch_yaw_roll)));
         matrix_dirty_ = true;
     }
 
@@ -58,9 +64,9 @@ namespace D3D
         return scale_;
     }
 
-    const DirectX::XMFLOAT3& Model::GetOriention()
+    const DirectX::XMFLOAT4& Model::GetRotation()
     {
-        return oriention_;
+        return rotation_;
     }
 
     const DirectX::XMFLOAT3& Model::GetLocation()
@@ -77,11 +83,11 @@ namespace D3D
         matrix_dirty_ = true;
     }
 
-    void Model::AddOriention(const DirectX::XMFLOAT3& oriention)
+    void Model::AddRotation(const DirectX::XMFLOAT4& rotation)
     {
-        oriention_.x += oriention.x;
-        oriention_.y += oriention.y;
-        oriention_.z += oriention.z;
+        // Renormalized so repeated small rotations do not drift away from unit length.
+        auto v_rotation = XMQuaternionMultiply(XMLoadFloat4(&rotation_), XMLoadFloat4(&rotation));
+        XMStoreFloat4(&rotation_, XMQuaternionNormalize(v_rotation));
 
         matrix_dirty_ = true;
     }
@@ -95,13 +101,33 @@ namespace D3D
         matrix_dirty_ = true;
     }
 
+    void Model::UpdateModelMatrices(Model* models, uint32_t count)
+    {
+        const uint32_t MODEL_GRAIN_SIZE = 256;
+
+        TaskScheduler::GetScheduler().ParallelFor(count, MODEL_GRAIN_SIZE, [models](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t i = begin; i < end; i++)
+            {
+                if (models[i].matrix_dirty_)
+                {
+                    models[i].UpdateMatrix();
+                }
+            }
+        });
+    }
+
     void Model::UpdateMatrix()
     {
-        auto xm_scale = XMMatrixScaling(scale_.x, scale_.y, scale_.z);
-        auto xm_oriention = XMMatrixRotationRollPitchYaw(oriention_.x, oriention_.y, oriention_.z);
-        auto xm_location = XMMatrixTranslation(location_.x, location_.y, location_.z);
-        model_matrix_ = xm_scale * xm_oriention * xm_location;
+        // scale * rotation * translation without the matrix products: the rotation rows are
+        // scaled in place and the translation becomes the last row.
+        model_matrix_ = XMMatrixRotationQuaternion(XMLoadFloat4(&rotation_));
+        model_matrix_.r[0] = XMVectorScale(model_matrix_.r[0], scale_.x);
+        model_matrix_.r[1] = XMVectorScale(model_matrix_.r[1], scale_.y);
+        model_matrix_.r[2] = XMVectorScale(model_matrix_.r[2], scale_.z);
+        model_matrix_.r[3] = XMVectorSet(location_.x, location_.y, location_.z, 1.0f);
 
         XMStoreFloat4x4(&model_matrix_4x4_, model_matrix_);
+        matrix_dirty_ = false;
     }
 };
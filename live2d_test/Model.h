@@ -1,5 +1,6 @@
 #pragma once
-#include <DirectXMath.h>
+#include <cstdint>
+#include "PortableMath.h"
 #include "MathHelper.h"
 
 namespace D3D
@@ -11,22 +12,27 @@ namespace D3D
         ~Model();
 
         void SetScale(const DirectX::XMFLOAT3& scale);
-        void SetOriention(const DirectX::XMFLOAT3& oriention);
+        void SetRotation(const DirectX::XMFLOAT4& rotation);
+        void SetRotationRollPitchYaw(const DirectX::XMFLOAT3& pitch_yaw_roll);
         void SetLocation(const DirectX::XMFLOAT3& location);
 
         void AddScale(const DirectX::XMFLOAT3& scale);
-        void AddOriention(const DirectX::XMFLOAT3& oriention);
+        // Applies rotation after the current one.
+        void AddRotation(const DirectX::XMFLOAT4& rotation);
         void AddLocation(const DirectX::XMFLOAT3& location);
 
         const DirectX::XMFLOAT3& GetScale();
-        const DirectX::XMFLOAT3& GetOriention();
+        const DirectX::XMFLOAT4& GetRotation();
         const DirectX::XMFLOAT3& GetLocation();
         const DirectX::XMFLOAT4X4& GetModelMatrix4x4();
         const DirectX::XMMATRIX& GetModelMatrix();
 
+        // Refreshes the dirty matrices of many models at once, spread over the task scheduler.
+        static void UpdateModelMatrices(Model* models, uint32_t count);
+
     private:
         DirectX::XMFLOAT3 scale_ = { 1.0f, 1.0f, 1.0f };
-        DirectX::XMFLOAT3 oriention_ = { 0.0f, 0.0f, 1.0f };
+        DirectX::XMFLOAT4 rotation_ = { 0.0f, 0.0f, 0.0f, 1.0f };      // unit quaternion
         DirectX::XMFLOAT3 location_ = { 0.0f, 0.0f, 0.0f };
         DirectX::XMFLOAT4X4 model_matrix_4x4_ = MathHelper::Identity4x4();
         DirectX::XMMATRIX model_matrix_ = {};
@@ -0,0 +1,352 @@
+#include "MotionClip.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "SimdMath.h"
+
+namespace D3D
+{
+    namespace
+    {
+        const uint32_t SIMD_WIDTH = 4;
+
+        const float MAX_QUANTIZED = 65535.0f;
+
+        // Bézier segments are split at most this deep, 2^10 keys per segment.
+        const uint32_t MAX_BEZIER_DEPTH = 10;
+
+        struct CurvePoint
+        {
+            float time;
+            float value;
+        };
+
+        inline CurvePoint EvaluateBezier(const CurvePoint* points, float u)
+        {
+            float s = 1.0f - u;
+            float b0 = s * s * s;
+            float b1 = 3.0f * s * s * u;
+            float b2 = 3.0f * s * u * u;
+            float b3 = u * u * u;
+
+            CurvePoint result;
+            result.time = points[0].time * b0 + points[1].time * b1 + points[2].time * b2 + points[3].time * b3;
+            result.value = points[0].value * b0 + points[1].value * b1 + points[2].value * b2 + points[3].value * b3;
+            return result;
+        }
+
+        // Appends the points after start up to and including end, splitting until the chord
+        // stays within tolerance of the curve at a quarter, half and three quarters of the way.
+        void FlattenBezier(const CurvePoint* points, float u0, const CurvePoint& start, float u1, const CurvePoint& end,
+            float tolerance, uint32_t depth, std::vector<float>& times, std::vector<float>& values)
+        {
+            bool flat = depth >= MAX_BEZIER_DEPTH;
+            if (!flat)
+            {
+                flat = true;
+                float time_span = end.time - start.time;
+                for (uint32_t i = 1; i <= 3 && flat; i++)
+                {
+                    CurvePoint point = EvaluateBezier(points, u0 + (u1 - u0) * 0.25f * i);
+                    float t = time_span > 0.0f ? (point.time - start.time) / time_span : 0.0f;
+                    float chord_value = start.value + (end.value - start.value) * t;
+                    flat = ::fabsf(point.value - chord_value) <= tolerance;
+                }
+            }
+
+            if (flat)
+            {
+                times.push_back(end.time);
+                values.push_back(end.value);
+                return;
+            }
+
+            float u_mid = (u0 + u1) * 0.5f;
+            CurvePoint mid = EvaluateBezier(points, u_mid);
+            FlattenBezier(points, u0, start, u_mid, mid, tolerance, depth + 1, times, values);
+            FlattenBezier(points, u_mid, mid, u1, end, tolerance, depth + 1, times, values);
+        }
+
+        inline uint16_t Quantize(float value, float minimum, float inv_scale)
+        {
+            float quantized = (value - minimum) * inv_scale + 0.5f;
+            return static_cast<uint16_t>((std::min)((std::max)(quantized, 0.0f), MAX_QUANTIZED));
+        }
+    }
+
+    void MotionClip::Clear()
+    {
+        duration_ = 0.0f;
+        looping_ = false;
+        ticks_per_second_ = 0.0f;
+
+        curves_.clear();
+        value_minimums_.clear();
+        value_scales_.clear();
+        key_ticks_.clear();
+        key_values_.clear();
+        segment_table_.clear();
+    }
+
+    void MotionClip::SetDuration(float duration)
+    {
+        assert(duration > 0.0f && curves_.empty());
+
+        duration_ = duration;
+        ticks_per_second_ = MAX_QUANTIZED / duration;
+    }
+
+    float MotionClip::GetDuration() const
+    {
+        return duration_;
+    }
+
+    void MotionClip::SetLooping(bool looping)
+    {
+        looping_ = looping;
+    }
+
+    bool MotionClip::IsLooping() const
+    {
+        return looping_;
+    }
+
+    uint32_t MotionClip::AddCurve(const MotionTarget& target, const float* segments, uint32_t count, float tolerance)
+    {
+        assert(count >= 2);
+
+        std::vector<float> times;
+        std::vector<float> values;
+        times.push_back(segments[0]);
+        values.push_back(segments[1]);
+
+        uint32_t i = 2;
+        while (i < count)
+        {
+            CurvePoint last = { times.back(), values.back() };
+            switch (static_cast<MotionSegmentType>(static_cast<int32_t>(segments[i])))
+            {
+            case kMotionSegmentLinear:
+                assert(i + 2 < count);
+                times.push_back(segments[i + 1]);
+                values.push_back(segments[i + 2]);
+                i += 3;
+                break;
+            case kMotionSegmentBezier:
+            {
+                assert(i + 6 < count);
+                CurvePoint points[4] =
+                {
+                    last,
+                    { segments[i + 1], segments[i + 2] },
+                    { segments[i + 3], segments[i + 4] },
+                    { segments[i + 5], segments[i + 6] },
+                };
+                FlattenBezier(points, 0.0f, points[0], 1.0f, points[3], tolerance, 0, times, values);
+                i += 7;
+                break;
+            }
+            case kMotionSegmentStepped:
+                // Holds the old value up to the end of the segment. Keys at the same time are
+                // never interpolated between.
+                assert(i + 2 < count);
+                times.push_back(segments[i + 1]);
+                values.push_back(last.value);
+                times.push_back(segments[i + 1]);
+                values.push_back(segments[i + 2]);
+                i += 3;
+                break;
+            case kMotionSegmentInverseStepped:
+                assert(i + 2 < count);
+                times.push_back(last.time);
+                values.push_back(segments[i + 2]);
+                times.push_back(segments[i + 1]);
+                values.push_back(segments[i + 2]);
+                i += 3;
+                break;
+            default:
+                assert(false && "unknown motion segment type");
+                i = count;
+                break;
+            }
+        }
+
+        return AddKeys(target, times, values);
+    }
+
+    uint32_t MotionClip::AddLinearCurve(const MotionTarget& target, const float* times, const float* values, uint32_t key_count)
+    {
+        assert(key_count >= 1);
+        return AddKeys(target, std::vector<float>(times, times + key_count), std::vector<float>(values, values + key_count));
+    }
+
+    uint32_t MotionClip::GetCurveCount() const
+    {
+        return static_cast<uint32_t>(curves_.size());
+    }
+
+    const MotionTarget& MotionClip::GetCurveTarget(uint32_t curve) const
+    {
+        return curves_[curve].target;
+    }
+
+    uint32_t MotionClip::GetKeyCount(uint32_t curve) const
+    {
+        return curves_[curve].key_count;
+    }
+
+    size_t MotionClip::GetCompressedSize() const
+    {
+        return (key_ticks_.size() + key_values_.size() + segment_table_.size()) * sizeof(uint16_t) +
+            (value_minimums_.size() + value_scales_.size()) * sizeof(float) + curves_.size() * sizeof(Curve);
+    }
+
+    float MotionClip::SampleCurve(uint32_t curve, float time) const
+    {
+        MotionCursor cursor = 0;
+        return SampleCurve(curve, time, cursor);
+    }
+
+    float MotionClip::SampleCurve(uint32_t curve, float time, MotionCursor& cursor) const
+    {
+        const Curve& data = curves_[curve];
+        float tick = TimeToTick(time);
+        cursor = FindKey(curve, static_cast<uint32_t>(tick), cursor);
+
+        const uint16_t* ticks = key_ticks_.data() + data.key_offset;
+        const uint16_t* values = key_values_.data() + data.key_offset;
+        float value = values[cursor];
+        if (cursor + 1 < data.key_count && tick > ticks[cursor])
+        {
+            float t = (tick - ticks[cursor]) / (ticks[cursor + 1] - ticks[cursor]);
+            value += (values[cursor + 1] - value) * (std::min)(t, 1.0f);
+        }
+
+        return value_minimums_[curve] + value * value_scales_[curve];
+    }
+
+    void MotionClip::SampleCurves(float time, MotionCursor* cursors, float* values) const
+    {
+        float tick = TimeToTick(time);
+        uint32_t whole_tick = static_cast<uint32_t>(tick);
+        uint32_t curve_count = GetCurveCount();
+
+        for (uint32_t i = 0; i < curve_count; i += SIMD_WIDTH)
+        {
+            // The key search is scalar, the interpolation and dequantization run on all lanes.
+            float start_ticks[SIMD_WIDTH] = {};
+            float end_ticks[SIMD_WIDTH] = {};
+            float start_values[SIMD_WIDTH] = {};
+            float end_values[SIMD_WIDTH] = {};
+
+            uint32_t lane_count = (std::min)(curve_count - i, SIMD_WIDTH);
+            for (uint32_t lane = 0; lane < lane_count; lane++)
+            {
+                uint32_t curve = i + lane;
+                const Curve& data = curves_[curve];
+                uint32_t key = FindKey(curve, whole_tick, cursors[curve]);
+                uint32_t next = (std::min)(key + 1, data.key_count - 1);
+                cursors[curve] = key;
+
+                start_ticks[lane] = key_ticks_[data.key_offset + key];
+                end_ticks[lane] = key_ticks_[data.key_offset + next];
+                start_values[lane] = key_values_[data.key_offset + key];
+                end_values[lane] = key_values_[data.key_offset + next];
+            }
+
+            // Past the last key the span is empty and the start value is kept.
+            Simd::Float4 start_tick = Simd::Load(start_ticks);
+            Simd::Float4 span = Simd::Sub(Simd::Load(end_ticks), start_tick);
+            Simd::Float4 t = Simd::Div(Simd::Sub(Simd::Set1(tick), start_tick), Simd::Max(span, Simd::Set1(1.0f)));
+            t = Simd::Min(Simd::Max(t, Simd::Zero()), Simd::Set1(1.0f));
+
+            Simd::Float4 start_value = Simd::Load(start_values);
+            Simd::Float4 quantized = Simd::MulAdd(Simd::Sub(Simd::Load(end_values), start_value), t, start_value);
+            Simd::Float4 value = Simd::MulAdd(quantized, Simd::LoadPartial(&value_scales_[i], curve_count - i), Simd::LoadPartial(&value_minimums_[i], curve_count - i));
+            Simd::StorePartial(values + i, value, curve_count - i);
+        }
+    }
+
+    uint32_t MotionClip::AddKeys(const MotionTarget& target, const std::vector<float>& times, const std::vector<float>& values)
+    {
+        assert(duration_ > 0.0f && "SetDuration before adding curves");
+        assert(times.size() == values.size() && times.size() <= 65536);
+        assert(std::is_sorted(times.begin(), times.end()));
+
+        uint32_t key_count = static_cast<uint32_t>(times.size());
+        auto range = std::minmax_element(values.begin(), values.end());
+        float minimum = *range.first;
+        float scale = (*range.second - minimum) / MAX_QUANTIZED;
+        float inv_scale = scale > 0.0f ? 1.0f / scale : 0.0f;
+
+        Curve curve{};
+        curve.target = target;
+        curve.key_offset = static_cast<uint32_t>(key_ticks_.size());
+        curve.key_count = key_count;
+        curve.table_offset = static_cast<uint32_t>(segment_table_.size());
+
+        for (uint32_t key = 0; key < key_count; key++)
+        {
+            assert(times[key] >= 0.0f && times[key] <= duration_ * 1.0001f);
+            key_ticks_.push_back(static_cast<uint16_t>((std::min)(TimeToTick(times[key]) + 0.5f, MAX_QUANTIZED)));
+            key_values_.push_back(Quantize(values[key], minimum, inv_scale));
+        }
+
+        // The last key at or before the start of every window.
+        uint32_t window_count = 1;
+        curve.window_shift = 16;
+        while (window_count * KEYS_PER_WINDOW < key_count)
+        {
+            window_count *= 2;
+            curve.window_shift--;
+        }
+
+        const uint16_t* ticks = key_ticks_.data() + curve.key_offset;
+        uint32_t key = 0;
+        for (uint32_t window = 0; window < window_count; window++)
+        {
+            uint32_t window_tick = window << curve.window_shift;
+            while (key + 1 < key_count && ticks[key + 1] <= window_tick)
+            {
+                key++;
+            }
+
+            segment_table_.push_back(static_cast<uint16_t>(key));
+        }
+
+        curves_.push_back(curve);
+        value_minimums_.push_back(minimum);
+        value_scales_.push_back(scale);
+
+        return GetCurveCount() - 1;
+    }
+
+    uint32_t MotionClip::FindKey(uint32_t curve, uint32_t tick, MotionCursor cursor) const
+    {
+        const Curve& data = curves_[curve];
+        const uint16_t* ticks = key_ticks_.data() + data.key_offset;
+
+        // The window's first key and a cursor not past tick both lie at or before the key
+        // looked for, the scan starts from the later one. Random access and backward jumps
+        // start from the table, forward playback from the cursor unless it fell a window behind.
+        uint32_t key = segment_table_[data.table_offset + (tick >> data.window_shift)];
+        if (cursor < data.key_count && ticks[cursor] <= tick)
+        {
+            key = (std::max)(key, static_cast<uint32_t>(cursor));
+        }
+
+        while (key + 1 < data.key_count && ticks[key + 1] <= tick)
+        {
+            key++;
+        }
+
+        return key;
+    }
+
+    float MotionClip::TimeToTick(float time) const
+    {
+        return (std::min)((std::max)(time * ticks_per_second_, 0.0f), MAX_QUANTIZED);
+    }
+};
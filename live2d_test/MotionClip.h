@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace D3D
+{
+    enum MotionTargetType
+    {
+        kMotionTargetParameter,                             // Live2DModel parameter
+        kMotionTargetTranslationX,                          // TransformHierarchy node, local
+        kMotionTargetTranslationY,
+        kMotionTargetTranslationZ,
+        kMotionTargetRotationX,                             // degrees, applied as pitch, yaw, roll
+        kMotionTargetRotationY,
+        kMotionTargetRotationZ,
+        kMotionTargetScaleX,
+        kMotionTargetScaleY,
+        kMotionTargetScaleZ,
+        kMotionTargetTypeCount,
+    };
+
+    struct MotionTarget
+    {
+        MotionTargetType type = kMotionTargetParameter;
+        uint32_t index = 0;                                 // parameter or node
+    };
+
+    // Segment types of the "Segments" arrays in Cubism motion3.json files.
+    enum MotionSegmentType
+    {
+        kMotionSegmentLinear = 0,
+        kMotionSegmentBezier = 1,
+        kMotionSegmentStepped = 2,
+        kMotionSegmentInverseStepped = 3,
+    };
+
+    // Clip-relative state for forward playback, one per curve. Starts at zero.
+    using MotionCursor = uint32_t;
+
+    // An animation clip of curves that each drive one target, stored compressed. Every curve is
+    // baked to linear keys, Bézier segments are flattened to within a tolerance, and each key
+    // is quantized to a 16 bit time (of the clip duration) and a 16 bit value (of the curve's
+    // range). A segment table splits the clip into power of two windows of ticks, sized so about
+    // KEYS_PER_WINDOW keys fall into each, and holds the key at the start of every window. Random
+    // access costs a table lookup and a short forward scan, and playback with cursors only steps
+    // over the keys passed since the last sample.
+    class MotionClip
+    {
+    public:
+        static const uint32_t KEYS_PER_WINDOW = 4;
+
+        void Clear();
+
+        // Curves must not reach past the duration, set it first.
+        void SetDuration(float duration);
+        float GetDuration() const;
+        void SetLooping(bool looping);
+        bool IsLooping() const;
+
+        // A Cubism segment array: the first point (time, value), then for every segment its type
+        // followed by its points, one for linear and stepped segments, three for Bézier.
+        uint32_t AddCurve(const MotionTarget& target, const float* segments, uint32_t count, float tolerance = 0.001f);
+
+        // Linear keys with ascending times.
+        uint32_t AddLinearCurve(const MotionTarget& target, const float* times, const float* values, uint32_t key_count);
+
+        uint32_t GetCurveCount() const;
+        const MotionTarget& GetCurveTarget(uint32_t curve) const;
+        uint32_t GetKeyCount(uint32_t curve) const;
+        size_t GetCompressedSize() const;
+
+        // Random access.
+        float SampleCurve(uint32_t curve, float time) const;
+
+        // Forward playback, cursor is reset through the segment table when time went backwards.
+        float SampleCurve(uint32_t curve, float time, MotionCursor& cursor) const;
+
+        // All curves at once, four per SIMD iteration. cursors and values hold GetCurveCount().
+        void SampleCurves(float time, MotionCursor* cursors, float* values) const;
+
+    private:
+        struct Curve
+        {
+            MotionTarget target;
+            uint32_t key_offset;
+            uint32_t key_count;
+            uint32_t table_offset;
+            uint32_t window_shift;                          // ticks per window, log2
+        };
+
+        uint32_t AddKeys(const MotionTarget& target, const std::vector<float>& times, const std::vector<float>& values);
+        uint32_t FindKey(uint32_t curve, uint32_t tick, MotionCursor cursor) const;
+        float TimeToTick(float time) const;
+
+        float                                               duration_ = 0.0f;
+        bool                                                looping_ = false;
+        float                                               ticks_per_second_ = 0.0f;
+
+        std::vector<Curve>                                  curves_;
+
+        // Dequantization, value = minimum + key * scale, per curve.
+        std::vector<float>                                  value_minimums_;
+        std::vector<float>                                  value_scales_;
+
+        std::vector<uint16_t>                               key_ticks_;
+        std::vector<uint16_t>                               key_values_;
+        std::vector<uint16_t>                               segment_table_;
+    };
+};
@@ -0,0 +1,132 @@
+#include "MotionClip.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "TestHarness.h"
+
+using namespace D3D;
+
+namespace
+{
+    float Random(uint32_t& seed)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / 16777216.0f;
+    }
+
+    // A ten second clip of curves made of Bézier segments every half second with the odd
+    // linear and stepped one, as exported from Cubism.
+    void BuildClip(MotionClip& clip, uint32_t curve_count, uint32_t& seed)
+    {
+        const float duration = 10.0f;
+        const float segment_time = 0.5f;
+        clip.SetDuration(duration);
+
+        std::vector<float> segments;
+        for (uint32_t curve = 0; curve < curve_count; curve++)
+        {
+            segments.clear();
+            float value = Random(seed) * 2.0f - 1.0f;
+            segments.push_back(0.0f);
+            segments.push_back(value);
+            for (float time = 0.0f; time + segment_time <= duration + 1e-3f; time += segment_time)
+            {
+                float end_value = Random(seed) * 2.0f - 1.0f;
+                float type = Random(seed);
+                if (type < 0.8f)
+                {
+                    float control[4] = { time + segment_time / 3.0f, value + Random(seed) - 0.5f, time + segment_time * 2.0f / 3.0f, end_value + Random(seed) - 0.5f };
+                    segments.insert(segments.end(), { static_cast<float>(kMotionSegmentBezier), control[0], control[1], control[2], control[3], time + segment_time, end_value });
+                }
+                else
+                {
+                    MotionSegmentType segment_type = type < 0.9f ? kMotionSegmentLinear : kMotionSegmentStepped;
+                    segments.insert(segments.end(), { static_cast<float>(segment_type), time + segment_time, end_value });
+                }
+
+                value = end_value;
+            }
+
+            MotionTarget target;
+            target.index = curve;
+            clip.AddCurve(target, segments.data(), static_cast<uint32_t>(segments.size()));
+        }
+    }
+}
+
+// Samples per microsecond for thousands of curves: random access through the segment table,
+// playback at 60 fps with a cursor per curve, one curve at a time and four per SIMD iteration
+// with SampleCurves, and the clip size against float time and value pairs.
+int main()
+{
+    std::printf("%-7s %8s %10s %10s %12s %12s %12s\n", "curves", "keys", "KiB", "float KiB", "random /us", "cursor /us", "batch /us");
+
+    for (uint32_t curve_count : { 1000u, 4000u, 16000u })
+    {
+        uint32_t seed = 3;
+        MotionClip clip;
+        BuildClip(clip, curve_count, seed);
+
+        size_t key_count = 0;
+        for (uint32_t curve = 0; curve < curve_count; curve++)
+        {
+            key_count += clip.GetKeyCount(curve);
+        }
+
+        std::vector<float> random_times(curve_count);
+        for (float& time : random_times)
+        {
+            time = Random(seed) * clip.GetDuration();
+        }
+
+        const uint32_t frame_count = 60;
+        const float frame_time = 1.0f / 60.0f;
+        std::vector<MotionCursor> cursors(curve_count);
+        std::vector<float> values(curve_count);
+        float sink = 0.0f;
+
+        double random_ms = D3D::Test::MeasureMilliseconds(5, [&]()
+        {
+            for (uint32_t curve = 0; curve < curve_count; curve++)
+            {
+                sink += clip.SampleCurve(curve, random_times[curve]);
+            }
+        });
+
+        double cursor_ms = D3D::Test::MeasureMilliseconds(5, [&]()
+        {
+            std::fill(cursors.begin(), cursors.end(), 0);
+            for (uint32_t frame = 0; frame < frame_count; frame++)
+            {
+                for (uint32_t curve = 0; curve < curve_count; curve++)
+                {
+                    sink += clip.SampleCurve(curve, frame * frame_time, cursors[curve]);
+                }
+            }
+        });
+
+        double batch_ms = D3D::Test::MeasureMilliseconds(5, [&]()
+        {
+            std::fill(cursors.begin(), cursors.end(), 0);
+            for (uint32_t frame = 0; frame < frame_count; frame++)
+            {
+                clip.SampleCurves(frame * frame_time, cursors.data(), values.data());
+                sink += values[frame % curve_count];
+            }
+        });
+
+        double samples = static_cast<double>(curve_count);
+        std::printf("%-7u %8zu %10.1f %10.1f %12.1f %12.1f %12.1f\n", curve_count, key_count, clip.GetCompressedSize() / 1024.0,
+            key_count * 2 * sizeof(float) / 1024.0, samples / (random_ms * 1000.0), samples * frame_count / (cursor_ms * 1000.0),
+            samples * frame_count / (batch_ms * 1000.0));
+
+        if (sink == 12345.0f)
+        {
+            std::printf("\n");
+        }
+    }
+
+    return 0;
+}
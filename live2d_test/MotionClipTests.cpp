@@ -0,0 +1,377 @@
+#include "MotionClip.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "Live2DModel.h"
+#include "MotionPlayer.h"
+#include "TestHarness.h"
+
+using namespace D3D;
+
+namespace
+{
+    float Random(uint32_t& seed)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / 16777216.0f;
+    }
+
+    float EaseSine(float t)
+    {
+        return 0.5f - 0.5f * std::cos(3.14159265f * t);
+    }
+
+    // Evaluates a Cubism segment array at time without baking it, Bézier segments are solved
+    // for their parameter by bisection in double precision.
+    double EvaluateSegments(const float* segments, uint32_t count, double time)
+    {
+        double last_time = segments[0];
+        double last_value = segments[1];
+        uint32_t i = 2;
+        while (i < count)
+        {
+            int32_t type = static_cast<int32_t>(segments[i]);
+            uint32_t point_count = type == kMotionSegmentBezier ? 3 : 1;
+            double end_time = segments[i + point_count * 2 - 1];
+            double end_value = segments[i + point_count * 2];
+            if (time < end_time)
+            {
+                switch (type)
+                {
+                case kMotionSegmentLinear:
+                    return last_value + (end_value - last_value) * (time - last_time) / (end_time - last_time);
+                case kMotionSegmentBezier:
+                {
+                    double times[4] = { last_time, segments[i + 1], segments[i + 3], end_time };
+                    double values[4] = { last_value, segments[i + 2], segments[i + 4], end_value };
+                    double u0 = 0.0;
+                    double u1 = 1.0;
+                    double u = 0.5;
+                    for (uint32_t step = 0; step < 60; step++)
+                    {
+                        u = (u0 + u1) * 0.5;
+                        double s = 1.0 - u;
+                        double t = times[0] * s * s * s + 3.0 * times[1] * s * s * u + 3.0 * times[2] * s * u * u + times[3] * u * u * u;
+                        if (t < time)
+                        {
+                            u0 = u;
+                        }
+                        else
+                        {
+                            u1 = u;
+                        }
+                    }
+
+                    double s = 1.0 - u;
+                    return values[0] * s * s * s + 3.0 * values[1] * s * s * u + 3.0 * values[2] * s * u * u + values[3] * u * u * u;
+                }
+                case kMotionSegmentStepped:
+                    return last_value;
+                default:
+                    return end_value;
+                }
+            }
+
+            last_time = end_time;
+            last_value = end_value;
+            i += point_count * 2 + 1;
+        }
+
+        return last_value;
+    }
+
+    void TestSegmentTypes()
+    {
+        const float duration = 4.0f;
+        const float segments[] =
+        {
+            0.0f, 0.0f,
+            kMotionSegmentLinear, 1.0f, 1.0f,
+            kMotionSegmentBezier, 1.333f, 1.6f, 1.667f, -1.6f, 2.0f, -1.0f,
+            kMotionSegmentStepped, 3.0f, 0.5f,
+            kMotionSegmentInverseStepped, 4.0f, -0.5f,
+        };
+        const uint32_t count = sizeof(segments) / sizeof(segments[0]);
+        const float tolerance = 0.001f;
+
+        MotionClip clip;
+        clip.SetDuration(duration);
+        uint32_t curve = clip.AddCurve(MotionTarget(), segments, count, tolerance);
+        TEST_CHECK(clip.GetCurveCount() == 1);
+
+        // Two keys for the linear segment and the first point, the Bézier is flattened, the
+        // stepped segments add two keys each.
+        TEST_CHECK(clip.GetKeyCount(curve) > 2 + 4 + 4);
+
+        // Flattening tolerance, half a value step of a range of about 2.4, and half a tick of
+        // time error on the steepest slope, about 5 per second.
+        const float tick_time = duration / 65535.0f;
+        const float bound = 2.0f * tolerance + 2.4f / 65535.0f + 5.0f * tick_time;
+
+        float max_error = 0.0f;
+        uint32_t sample_count = 4000;
+        for (uint32_t i = 0; i <= sample_count; i++)
+        {
+            float time = duration * i / sample_count;
+
+            // The stepped segments jump at 2 and 3, the tick holding the step goes either way.
+            if (std::fabs(time - 2.0f) < 2.0f * tick_time || std::fabs(time - 3.0f) < 2.0f * tick_time)
+            {
+                continue;
+            }
+
+            float value = clip.SampleCurve(curve, time);
+            max_error = (std::max)(max_error, static_cast<float>(std::fabs(value - EvaluateSegments(segments, count, time))));
+        }
+
+        TEST_CHECK(max_error <= bound);
+
+        // Stepped holds up to the step, inverse stepped takes the new value right after the start.
+        TEST_CHECK(std::fabs(clip.SampleCurve(curve, 2.99f) + 1.0f) <= bound);
+        TEST_CHECK(std::fabs(clip.SampleCurve(curve, 3.01f) + 0.5f) <= bound);
+        TEST_CHECK(std::fabs(clip.SampleCurve(curve, duration) + 0.5f) <= bound);
+
+        // A tighter tolerance takes more keys.
+        MotionClip fine_clip;
+        fine_clip.SetDuration(duration);
+        fine_clip.AddCurve(MotionTarget(), segments, count, tolerance * 0.1f);
+        TEST_CHECK(fine_clip.GetKeyCount(0) > clip.GetKeyCount(curve));
+    }
+
+    void TestQuantization()
+    {
+        // 1024 ticks per second and keys on whole 64ths of a second, so key and sample times
+        // are exact and only the 16 bit values are left to round.
+        const float duration = 65535.0f / 1024.0f;
+        const uint32_t key_count = 4000;
+        const float minimum = -3.0f;
+        const float maximum = 5.0f;
+
+        uint32_t seed = 11;
+        std::vector<float> times(key_count);
+        std::vector<float> values(key_count);
+        for (uint32_t key = 0; key < key_count; key++)
+        {
+            times[key] = key / 64.0f;
+            values[key] = minimum + (maximum - minimum) * Random(seed);
+        }
+
+        values[0] = minimum;
+        values[1] = maximum;
+
+        MotionClip clip;
+        clip.SetDuration(duration);
+        uint32_t curve = clip.AddLinearCurve(MotionTarget(), times.data(), values.data(), key_count);
+        TEST_CHECK(clip.GetKeyCount(curve) == key_count);
+
+        // Four bytes a key instead of eight, plus the segment table.
+        TEST_CHECK(clip.GetCompressedSize() < key_count * 2 * sizeof(float) * 3 / 4);
+
+        float step = (maximum - minimum) / 65535.0f;
+        float bound = step * 0.5f + 1e-6f * (maximum - minimum);
+        float max_key_error = 0.0f;
+        float max_mid_error = 0.0f;
+        for (uint32_t key = 0; key + 1 < key_count; key++)
+        {
+            max_key_error = (std::max)(max_key_error, std::fabs(clip.SampleCurve(curve, times[key]) - values[key]));
+
+            float mid_value = (values[key] + values[key + 1]) * 0.5f;
+            max_mid_error = (std::max)(max_mid_error, std::fabs(clip.SampleCurve(curve, times[key] + 1.0f / 128.0f) - mid_value));
+        }
+
+        TEST_CHECK(max_key_error <= bound);
+        TEST_CHECK(max_mid_error <= bound);
+
+        // The end points of the range are exact.
+        TEST_CHECK(clip.SampleCurve(curve, times[0]) == minimum);
+        TEST_CHECK(std::fabs(clip.SampleCurve(curve, times[1]) - maximum) <= 1e-6f * maximum);
+    }
+
+    void TestRandomAccessMatchesPlayback()
+    {
+        const float duration = 30.0f;
+        MotionClip clip;
+        clip.SetDuration(duration);
+
+        // Curves from a single key to far more keys than windows, so cursors fall behind and the
+        // segment table has to take over.
+        uint32_t seed = 5;
+        for (uint32_t key_count : { 1u, 2u, 7u, 64u, 1000u, 20000u })
+        {
+            std::vector<float> times(key_count);
+            std::vector<float> values(key_count);
+            float time = 0.0f;
+            for (uint32_t key = 0; key < key_count; key++)
+            {
+                times[key] = time;
+                values[key] = Random(seed) * 10.0f - 5.0f;
+                time = (std::min)(time + Random(seed) * 2.0f * duration / key_count, duration);
+            }
+
+            clip.AddLinearCurve(MotionTarget(), times.data(), values.data(), key_count);
+        }
+
+        uint32_t curve_count = clip.GetCurveCount();
+        std::vector<MotionCursor> cursors(curve_count, 0);
+        std::vector<MotionCursor> batch_cursors(curve_count, 0);
+        std::vector<float> batch_values(curve_count);
+
+        bool playback_matches = true;
+        bool batch_matches = true;
+        float time = 0.0f;
+        for (uint32_t frame = 0; frame < 3000; frame++)
+        {
+            // Mostly small steps forward, now and then a long jump ahead or back.
+            float jump = Random(seed);
+            if (jump < 0.05f)
+            {
+                time = Random(seed) * duration;
+            }
+            else
+            {
+                time = (std::min)(time + jump * jump * 0.05f, duration);
+            }
+
+            clip.SampleCurves(time, batch_cursors.data(), batch_values.data());
+            for (uint32_t curve = 0; curve < curve_count; curve++)
+            {
+                float expected = clip.SampleCurve(curve, time);
+                playback_matches = playback_matches && clip.SampleCurve(curve, time, cursors[curve]) == expected;
+                batch_matches = batch_matches && std::fabs(batch_values[curve] - expected) <= 1e-5f;
+                batch_matches = batch_matches && batch_cursors[curve] == cursors[curve];
+            }
+        }
+
+        TEST_CHECK(playback_matches);
+        TEST_CHECK(batch_matches);
+
+        // Outside the clip the first and last keys hold.
+        MotionCursor cursor = 0;
+        TEST_CHECK(clip.SampleCurve(curve_count - 1, -1.0f, cursor) == clip.SampleCurve(curve_count - 1, 0.0f));
+        TEST_CHECK(clip.SampleCurve(curve_count - 1, duration * 2.0f, cursor) == clip.SampleCurve(curve_count - 1, duration));
+    }
+
+    void TestLooping()
+    {
+        const float times[] = { 0.0f, 1.0f, 2.0f };
+        const float values[] = { 0.0f, 10.0f, 0.0f };
+
+        MotionClip looping_clip;
+        looping_clip.SetDuration(2.0f);
+        looping_clip.SetLooping(true);
+        looping_clip.AddLinearCurve(MotionTarget(), times, values, 3);
+
+        MotionClip once_clip;
+        once_clip.SetDuration(2.0f);
+        once_clip.AddLinearCurve(MotionTarget(), times, values, 3);
+
+        Live2DModel model;
+        model.AddParameter(-100.0f, 100.0f, 0.0f);
+
+        MotionPlayer player;
+        uint32_t layer = player.AddLayer();
+        player.Play(layer, &looping_clip);
+        player.Update(2.5f);
+        TEST_CHECK(player.IsPlaying(layer));
+        TEST_CHECK(std::fabs(player.GetTime(layer) - 0.5f) <= 1e-5f);
+
+        model.SetParameter(0, 0.0f);
+        player.Apply(&model, nullptr);
+        TEST_CHECK(std::fabs(model.GetParameter(0) - 5.0f) <= 1e-3f);
+
+        // Several loops in one step.
+        player.Update(5.0f);
+        TEST_CHECK(std::fabs(player.GetTime(layer) - 1.5f) <= 1e-5f);
+
+        // A clip that does not loop stops on its last pose.
+        player.Play(layer, &once_clip);
+        player.Update(2.5f);
+        TEST_CHECK(!player.IsPlaying(layer));
+        TEST_CHECK(player.GetTime(layer) == 2.0f);
+
+        model.SetParameter(0, 3.0f);
+        player.Apply(&model, nullptr);
+        TEST_CHECK(std::fabs(model.GetParameter(0)) <= 1e-3f);
+    }
+
+    void TestLayerBlendingAndFades()
+    {
+        MotionClip clip_a;
+        clip_a.SetDuration(1.0f);
+        clip_a.SetLooping(true);
+        const float time = 0.0f;
+        const float value_a = 10.0f;
+        clip_a.AddLinearCurve(MotionTarget(), &time, &value_a, 1);
+
+        MotionClip clip_b;
+        clip_b.SetDuration(1.0f);
+        clip_b.SetLooping(true);
+        const float value_b = 4.0f;
+        clip_b.AddLinearCurve(MotionTarget(), &time, &value_b, 1);
+
+        Live2DModel model;
+        model.AddParameter(-100.0f, 100.0f, 0.0f);
+        const float base = 2.0f;
+
+        MotionPlayer player;
+        uint32_t override_layer = player.AddLayer(kMotionBlendOverride, 1.0f);
+        uint32_t additive_layer = player.AddLayer(kMotionBlendAdditive, 0.5f);
+        player.Play(override_layer, &clip_a);
+        player.Play(additive_layer, &clip_b);
+
+        auto apply = [&]()
+        {
+            model.SetParameter(0, base);
+            player.Update(0.25f);
+            player.Apply(&model, nullptr);
+            return model.GetParameter(0);
+        };
+
+        TEST_CHECK(std::fabs(apply() - (value_a + value_b * 0.5f)) <= 1e-5f);
+
+        // Cross fade over a second, a quarter of the way the old clip has 0.75 before easing and
+        // the new one 0.25, the old one is blended first.
+        player.Play(override_layer, &clip_b, 1.0f);
+        float expected = base;
+        expected += (value_a - expected) * EaseSine(0.75f);
+        expected += (value_b - expected) * EaseSine(0.25f);
+        expected += value_b * 0.5f;
+        TEST_CHECK(std::fabs(apply() - expected) <= 1e-4f);
+
+        // Half way both weigh 0.5.
+        expected = base;
+        expected += (value_a - expected) * 0.5f;
+        expected += (value_b - expected) * 0.5f;
+        expected += value_b * 0.5f;
+        TEST_CHECK(std::fabs(apply() - expected) <= 1e-4f);
+
+        player.Update(0.5f);
+        TEST_CHECK(std::fabs(apply() - (value_b + value_b * 0.5f)) <= 1e-5f);
+
+        // Layer weights scale the eased fade.
+        player.SetLayerWeight(override_layer, 0.5f);
+        TEST_CHECK(std::fabs(apply() - (base + (value_b - base) * 0.5f + value_b * 0.5f)) <= 1e-5f);
+        player.SetLayerWeight(override_layer, 1.0f);
+
+        // Fading out the additive layer, it no longer counts as playing and is gone once faded.
+        player.Stop(additive_layer, 0.5f);
+        TEST_CHECK(!player.IsPlaying(additive_layer));
+        TEST_CHECK(std::fabs(apply() - (value_b + value_b * 0.5f * EaseSine(0.5f))) <= 1e-5f);
+        TEST_CHECK(std::fabs(apply() - value_b) <= 1e-5f);
+
+        player.Stop(override_layer);
+        TEST_CHECK(apply() == base);
+    }
+}
+
+int main()
+{
+    TestSegmentTypes();
+    TestQuantization();
+    TestRandomAccessMatchesPlayback();
+    TestLooping();
+    TestLayerBlendingAndFades();
+    return D3D::Test::Finish("MotionClipTests");
+}
@@ -0,0 +1,273 @@
+#include "MotionPlayer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "Live2DModel.h"
+#include "PortableMath.h"
+#include "TransformHierarchy.h"
+
+namespace D3D
+{
+    namespace
+    {
+        inline float EaseSine(float t)
+        {
+            return 0.5f - 0.5f * ::cosf(DirectX::XM_PI * t);
+        }
+
+        inline bool IsNodeTarget(MotionTargetType type)
+        {
+            return type != kMotionTargetParameter;
+        }
+
+        // The x channel of the translation, rotation or scale a node target belongs to.
+        inline MotionTargetType ChannelBase(MotionTargetType type)
+        {
+            if (type >= kMotionTargetScaleX)
+            {
+                return kMotionTargetScaleX;
+            }
+
+            return type >= kMotionTargetRotationX ? kMotionTargetRotationX : kMotionTargetTranslationX;
+        }
+    }
+
+    void MotionPlayer::Clear()
+    {
+        layers_.clear();
+        tracks_.clear();
+        slot_targets_.clear();
+        slot_rest_values_.clear();
+        slot_values_.clear();
+        slot_rest_captured_.clear();
+        slot_map_.clear();
+    }
+
+    uint32_t MotionPlayer::AddLayer(MotionBlendMode mode, float weight)
+    {
+        layers_.push_back({ mode, weight });
+        return GetLayerCount() - 1;
+    }
+
+    void MotionPlayer::SetLayerWeight(uint32_t layer, float weight)
+    {
+        layers_[layer].weight = weight;
+    }
+
+    uint32_t MotionPlayer::GetLayerCount() const
+    {
+        return static_cast<uint32_t>(layers_.size());
+    }
+
+    void MotionPlayer::Play(uint32_t layer, const MotionClip* clip, float fade_time)
+    {
+        assert(layer < GetLayerCount() && clip != nullptr);
+
+        Stop(layer, fade_time);
+
+        Track track{};
+        track.layer = layer;
+        track.clip = clip;
+        track.fade = fade_time > 0.0f ? 0.0f : 1.0f;
+        track.fade_rate = fade_time > 0.0f ? 1.0f / fade_time : 0.0f;
+
+        uint32_t curve_count = clip->GetCurveCount();
+        track.cursors.assign(curve_count, 0);
+        track.values.resize(curve_count);
+        track.slots.resize(curve_count);
+        for (uint32_t curve = 0; curve < curve_count; curve++)
+        {
+            track.slots[curve] = FindSlot(clip->GetCurveTarget(curve));
+        }
+
+        clip->SampleCurves(0.0f, track.cursors.data(), track.values.data());
+
+        auto position = std::find_if(tracks_.begin(), tracks_.end(), [layer](const Track& other) { return other.layer > layer; });
+        tracks_.insert(position, std::move(track));
+    }
+
+    void MotionPlayer::Stop(uint32_t layer, float fade_time)
+    {
+        if (fade_time <= 0.0f)
+        {
+            tracks_.erase(std::remove_if(tracks_.begin(), tracks_.end(), [layer](const Track& track) { return track.layer == layer; }), tracks_.end());
+            return;
+        }
+
+        for (Track& track : tracks_)
+        {
+            if (track.layer == layer)
+            {
+                track.fade_rate = (std::min)(track.fade_rate, -1.0f / fade_time);
+            }
+        }
+    }
+
+    bool MotionPlayer::IsPlaying(uint32_t layer) const
+    {
+        for (auto it = tracks_.rbegin(); it != tracks_.rend(); ++it)
+        {
+            if (it->layer == layer)
+            {
+                return it->fade_rate >= 0.0f && (it->clip->IsLooping() || it->time < it->clip->GetDuration());
+            }
+        }
+
+        return false;
+    }
+
+    float MotionPlayer::GetTime(uint32_t layer) const
+    {
+        for (auto it = tracks_.rbegin(); it != tracks_.rend(); ++it)
+        {
+            if (it->layer == layer)
+            {
+                return it->time;
+            }
+        }
+
+        return 0.0f;
+    }
+
+    void MotionPlayer::Update(float delta_time)
+    {
+        for (Track& track : tracks_)
+        {
+            track.fade = (std::min)((std::max)(track.fade + track.fade_rate * delta_time, 0.0f), 1.0f);
+
+            float duration = track.clip->GetDuration();
+            if (track.clip->IsLooping())
+            {
+                track.time = ::fmodf(track.time + delta_time, duration);
+            }
+            else
+            {
+                track.time = (std::min)(track.time + delta_time, duration);
+            }
+        }
+
+        tracks_.erase(std::remove_if(tracks_.begin(), tracks_.end(), [](const Track& track) { return track.fade_rate < 0.0f && track.fade <= 0.0f; }), tracks_.end());
+
+        for (Track& track : tracks_)
+        {
+            track.clip->SampleCurves(track.time, track.cursors.data(), track.values.data());
+        }
+    }
+
+    void MotionPlayer::Apply(Live2DModel* model, TransformHierarchy* hierarchy)
+    {
+        uint32_t slot_count = static_cast<uint32_t>(slot_targets_.size());
+        for (uint32_t slot = 0; slot < slot_count; slot++)
+        {
+            const MotionTarget& target = slot_targets_[slot];
+            if (target.type == kMotionTargetParameter)
+            {
+                slot_values_[slot] = model != nullptr ? model->GetParameter(target.index) : 0.0f;
+                continue;
+            }
+
+            if (hierarchy != nullptr && !slot_rest_captured_[slot] && target.type == ChannelBase(target.type))
+            {
+                float* rest = &slot_rest_values_[slot];
+                if (target.type == kMotionTargetTranslationX)
+                {
+                    hierarchy->GetLocalTranslation(target.index, rest[0], rest[1], rest[2]);
+                }
+                else if (target.type == kMotionTargetScaleX)
+                {
+                    hierarchy->GetLocalScale(target.index, rest[0], rest[1], rest[2]);
+                }
+
+                slot_rest_captured_[slot] = slot_rest_captured_[slot + 1] = slot_rest_captured_[slot + 2] = true;
+            }
+
+            slot_values_[slot] = slot_rest_values_[slot];
+        }
+
+        for (const Track& track : tracks_)
+        {
+            const Layer& layer = layers_[track.layer];
+            float weight = layer.weight * EaseSine(track.fade);
+            uint32_t curve_count = static_cast<uint32_t>(track.values.size());
+            if (layer.mode == kMotionBlendOverride)
+            {
+                for (uint32_t curve = 0; curve < curve_count; curve++)
+                {
+                    float& value = slot_values_[track.slots[curve]];
+                    value += (track.values[curve] - value) * weight;
+                }
+            }
+            else
+            {
+                for (uint32_t curve = 0; curve < curve_count; curve++)
+                {
+                    slot_values_[track.slots[curve]] += track.values[curve] * weight;
+                }
+            }
+        }
+
+        for (uint32_t slot = 0; slot < slot_count; slot++)
+        {
+            const MotionTarget& target = slot_targets_[slot];
+            const float* value = &slot_values_[slot];
+            if (target.type == kMotionTargetParameter)
+            {
+                if (model != nullptr)
+                {
+                    model->SetParameter(target.index, value[0]);
+                }
+            }
+            else if (hierarchy != nullptr)
+            {
+                switch (target.type)
+                {
+                case kMotionTargetTranslationX:
+                    hierarchy->SetLocalTranslation(target.index, value[0], value[1], value[2]);
+                    break;
+                case kMotionTargetRotationX:
+                {
+                    DirectX::XMFLOAT4 rotation;
+                    DirectX::XMStoreFloat4(&rotation, DirectX::XMQuaternionRotationRollPitchYaw(DirectX::XMConvertToRadians(value[0]),
+                        DirectX::XMConvertToRadians(value[1]), DirectX::XMConvertToRadians(value[2])));
+                    hierarchy->SetLocalRotation(target.index, rotation.x, rotation.y, rotation.z, rotation.w);
+                    break;
+                }
+                case kMotionTargetScaleX:
+                    hierarchy->SetLocalScale(target.index, value[0], value[1], value[2]);
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+    }
+
+    uint32_t MotionPlayer::FindSlot(const MotionTarget& target)
+    {
+        MotionTargetType base_type = IsNodeTarget(target.type) ? ChannelBase(target.type) : target.type;
+        uint64_t key = (static_cast<uint64_t>(base_type) << 32) | target.index;
+
+        auto it = slot_map_.find(key);
+        if (it == slot_map_.end())
+        {
+            uint32_t slot_count = IsNodeTarget(target.type) ? 3 : 1;
+            it = slot_map_.emplace(key, static_cast<uint32_t>(slot_targets_.size())).first;
+            for (uint32_t i = 0; i < slot_count; i++)
+            {
+                MotionTarget slot_target{};
+                slot_target.type = static_cast<MotionTargetType>(base_type + i);
+                slot_target.index = target.index;
+                slot_targets_.push_back(slot_target);
+
+                // Unit scale until the node's own is read.
+                slot_rest_values_.push_back(base_type == kMotionTargetScaleX ? 1.0f : 0.0f);
+                slot_values_.push_back(0.0f);
+                slot_rest_captured_.push_back(false);
+            }
+        }
+
+        return it->second + (target.type - base_type);
+    }
+};
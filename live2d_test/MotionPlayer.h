@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "MotionClip.h"
+
+namespace D3D
+{
+    class Live2DModel;
+    class TransformHierarchy;
+
+    enum MotionBlendMode
+    {
+        kMotionBlendOverride,                               // lerps from the layers below by the weight
+        kMotionBlendAdditive,                               // adds value * weight
+    };
+
+    // Plays motion clips on layers that are blended bottom to top, e.g. a looping idle with an
+    // additive breathing layer and an override layer for one-off expressions. Playing a clip on
+    // a layer fades in the new clip while the old one fades out, with sine easing.
+    //
+    // Parameters blend onto whatever the model holds when Apply runs, reset them or write the
+    // tracked inputs first. Node translation and scale blend onto the values the node had when
+    // first targeted, rotations onto identity.
+    class MotionPlayer
+    {
+    public:
+        void Clear();
+
+        uint32_t AddLayer(MotionBlendMode mode = kMotionBlendOverride, float weight = 1.0f);
+        void SetLayerWeight(uint32_t layer, float weight);
+        uint32_t GetLayerCount() const;
+
+        // clip has to outlive its playback.
+        void Play(uint32_t layer, const MotionClip* clip, float fade_time = 0.0f);
+        void Stop(uint32_t layer, float fade_time = 0.0f);
+
+        // False once a clip that does not loop has reached its end, the last pose is kept.
+        bool IsPlaying(uint32_t layer) const;
+        float GetTime(uint32_t layer) const;
+
+        // Advances time and fades and samples the curves of every clip.
+        void Update(float delta_time);
+
+        // Writes the blended values, either target may be null to skip it.
+        void Apply(Live2DModel* model, TransformHierarchy* hierarchy);
+
+    private:
+        struct Layer
+        {
+            MotionBlendMode mode;
+            float weight;
+        };
+
+        struct Track
+        {
+            uint32_t layer;
+            const MotionClip* clip;
+            float time;
+            float fade;                                     // 0 to 1, before easing
+            float fade_rate;                                // per second, negative when fading out
+            std::vector<MotionCursor> cursors;
+            std::vector<float> values;
+            std::vector<uint32_t> slots;                    // per curve
+        };
+
+        // Node channels get three consecutive slots, x, y and z.
+        uint32_t FindSlot(const MotionTarget& target);
+
+        std::vector<Layer>                                  layers_;
+        std::vector<Track>                                  tracks_;        // by layer, oldest first
+
+        std::vector<MotionTarget>                           slot_targets_;
+        std::vector<float>                                  slot_rest_values_;
+        std::vector<float>                                  slot_values_;
+        std::vector<bool>                                   slot_rest_captured_;
+        std::unordered_map<uint64_t, uint32_t>              slot_map_;
+    };
+};
@@ -0,0 +1,416 @@
+#include "PendulumPhysics.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "Live2DModel.h"
+#include "SimdMath.h"
+#include "TaskScheduler.h"
+
+namespace D3D
+{
+    namespace
+    {
+        const uint32_t SIMD_WIDTH = 4;
+
+        // Groups of four chains simulated per task.
+        const uint32_t GROUP_GRAIN_SIZE = 16;
+
+        const float DEGREES_TO_RADIANS = 3.14159265358979f / 180.0f;
+        const float RADIANS_TO_DEGREES = 180.0f / 3.14159265358979f;
+
+        // Keeps a particle that lands exactly on its parent from dividing by zero.
+        const float MIN_SEGMENT_LENGTH_SQ = 1e-12f;
+
+        inline uint32_t GroupCount(uint32_t chain_count)
+        {
+            return (chain_count + SIMD_WIDTH - 1) / SIMD_WIDTH;
+        }
+    }
+
+    void PendulumPhysics::Clear()
+    {
+        accumulated_time_ = 0.0;
+
+        chains_.clear();
+        chain_lengths_.clear();
+        chain_inputs_.clear();
+        chain_outputs_.clear();
+        layout_dirty_ = false;
+
+        damping_.clear();
+        rest_gravity_x_.clear();
+        rest_gravity_y_.clear();
+        gravity_x_.clear();
+        gravity_y_.clear();
+        root_x_.clear();
+        root_y_.clear();
+        previous_root_x_.clear();
+        previous_root_y_.clear();
+
+        group_offsets_.clear();
+        group_particle_counts_.clear();
+        lengths_.clear();
+        position_x_.clear();
+        position_y_.clear();
+        previous_x_.clear();
+        previous_y_.clear();
+    }
+
+    uint32_t PendulumPhysics::AddChain(const PendulumChainDesc& desc)
+    {
+        assert(desc.model != nullptr);
+        assert(!desc.lengths.empty() && desc.lengths.size() < MAX_CHAIN_PARTICLES);
+
+        Chain chain{};
+        chain.model = desc.model;
+        chain.particle_count = static_cast<uint32_t>(desc.lengths.size()) + 1;
+        chain.length_offset = static_cast<uint32_t>(chain_lengths_.size());
+        chain.input_offset = static_cast<uint32_t>(chain_inputs_.size());
+        chain.input_count = static_cast<uint32_t>(desc.inputs.size());
+        chain.output_offset = static_cast<uint32_t>(chain_outputs_.size());
+        chain.output_count = static_cast<uint32_t>(desc.outputs.size());
+
+        for (const auto& input : desc.inputs)
+        {
+            assert(input.parameter < desc.model->GetParameterCount());
+            (void)input;
+        }
+
+        for (const auto& output : desc.outputs)
+        {
+            assert(output.parameter < desc.model->GetParameterCount());
+            assert(output.particle >= 1 && output.particle < chain.particle_count);
+            (void)output;
+        }
+
+        chain_lengths_.insert(chain_lengths_.end(), desc.lengths.begin(), desc.lengths.end());
+        chain_inputs_.insert(chain_inputs_.end(), desc.inputs.begin(), desc.inputs.end());
+        chain_outputs_.insert(chain_outputs_.end(), desc.outputs.begin(), desc.outputs.end());
+
+        // The per chain arrays are padded to whole groups in RebuildLayout.
+        uint32_t index = GetChainCount();
+        damping_.resize(index);
+        rest_gravity_x_.resize(index);
+        rest_gravity_y_.resize(index);
+        damping_.push_back(desc.damping);
+        rest_gravity_x_.push_back(desc.gravity_x);
+        rest_gravity_y_.push_back(desc.gravity_y);
+
+        chains_.push_back(chain);
+        layout_dirty_ = true;
+
+        return index;
+    }
+
+    void PendulumPhysics::Reset()
+    {
+        if (layout_dirty_)
+        {
+            RebuildLayout();
+        }
+
+        accumulated_time_ = 0.0;
+
+        for (uint32_t index = 0; index < GetChainCount(); index++)
+        {
+            ReadInputs(index, root_x_[index], root_y_[index], gravity_x_[index], gravity_y_[index]);
+            previous_root_x_[index] = root_x_[index];
+            previous_root_y_[index] = root_y_[index];
+
+            float gravity_length = ::sqrtf(gravity_x_[index] * gravity_x_[index] + gravity_y_[index] * gravity_y_[index]);
+            float down_x = gravity_length > 0.0f ? gravity_x_[index] / gravity_length : 0.0f;
+            float down_y = gravity_length > 0.0f ? gravity_y_[index] / gravity_length : -1.0f;
+
+            // The particles past the end of the chain have zero length and sit on its last one.
+            uint32_t group = index / SIMD_WIDTH;
+            uint32_t lane = index % SIMD_WIDTH;
+            float x = root_x_[index];
+            float y = root_y_[index];
+            for (uint32_t particle = 0; particle < group_particle_counts_[group]; particle++)
+            {
+                uint32_t element = (group_offsets_[group] + particle) * SIMD_WIDTH + lane;
+                x += down_x * lengths_[element];
+                y += down_y * lengths_[element];
+                position_x_[element] = x;
+                position_y_[element] = y;
+                previous_x_[element] = x;
+                previous_y_[element] = y;
+            }
+        }
+    }
+
+    void PendulumPhysics::SetStepTime(float step_time)
+    {
+        assert(step_time > 0.0f);
+        step_time_ = step_time;
+    }
+
+    float PendulumPhysics::GetStepTime() const
+    {
+        return step_time_;
+    }
+
+    uint32_t PendulumPhysics::GetChainCount() const
+    {
+        return static_cast<uint32_t>(chains_.size());
+    }
+
+    void PendulumPhysics::GetParticlePosition(uint32_t chain, uint32_t particle, float& x, float& y) const
+    {
+        assert(!layout_dirty_ && particle < chains_[chain].particle_count);
+
+        uint32_t group = chain / SIMD_WIDTH;
+        uint32_t element = (group_offsets_[group] + particle) * SIMD_WIDTH + chain % SIMD_WIDTH;
+        x = position_x_[element];
+        y = position_y_[element];
+    }
+
+    void PendulumPhysics::Update(float delta_time, TaskScheduler* scheduler)
+    {
+        if (layout_dirty_)
+        {
+            RebuildLayout();
+        }
+
+        uint32_t chain_count = GetChainCount();
+        for (uint32_t index = 0; index < chain_count; index++)
+        {
+            previous_root_x_[index] = root_x_[index];
+            previous_root_y_[index] = root_y_[index];
+            ReadInputs(index, root_x_[index], root_y_[index], gravity_x_[index], gravity_y_[index]);
+        }
+
+        // The steps lag the frame by the carried time, step k lands k * step_time_ - carried into
+        // this frame. The root is placed there between last frame's inputs and this frame's, so
+        // it moves at the same speed in frames that get more or fewer steps.
+        double carried_time = accumulated_time_;
+        accumulated_time_ += delta_time;
+        uint32_t step_count = static_cast<uint32_t>(accumulated_time_ / step_time_);
+        float root_first_t = static_cast<float>((step_time_ - carried_time) / delta_time);
+        float root_step_t = static_cast<float>(step_time_ / delta_time);
+        if (step_count > MAX_STEPS_PER_UPDATE)
+        {
+            step_count = MAX_STEPS_PER_UPDATE;
+            accumulated_time_ = 0.0;
+            root_first_t = 1.0f / step_count;
+            root_step_t = 1.0f / step_count;
+        }
+        else
+        {
+            accumulated_time_ -= step_count * static_cast<double>(step_time_);
+        }
+
+        if (step_count > 0)
+        {
+            Simulate(step_count, root_first_t, root_step_t, scheduler);
+        }
+
+        // The outputs trail the frame by one step, blended between the last two steps so the lag
+        // stays the same whether a frame ended right after a step or just before the next one.
+        // Serial, several chains usually write to the same model.
+        float output_t = (std::min)(static_cast<float>(accumulated_time_ / step_time_), 1.0f);
+        for (uint32_t index = 0; index < chain_count; index++)
+        {
+            WriteOutputs(index, output_t);
+        }
+    }
+
+    void PendulumPhysics::Simulate(uint32_t step_count, float root_first_t, float root_step_t, TaskScheduler* scheduler)
+    {
+        uint32_t group_count = GroupCount(GetChainCount());
+        auto simulate_groups = [this, step_count, root_first_t, root_step_t](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t group = begin; group < end; group++)
+            {
+                SimulateGroup(group, step_count, root_first_t, root_step_t);
+            }
+        };
+
+        if (scheduler != nullptr && group_count > GROUP_GRAIN_SIZE)
+        {
+            scheduler->ParallelFor(group_count, GROUP_GRAIN_SIZE, simulate_groups);
+        }
+        else
+        {
+            simulate_groups(0, group_count);
+        }
+    }
+
+    void PendulumPhysics::RebuildLayout()
+    {
+        uint32_t chain_count = GetChainCount();
+        uint32_t group_count = GroupCount(chain_count);
+        uint32_t padded_count = group_count * SIMD_WIDTH;
+
+        // Padding lanes get no gravity and no damping, they stay where they are.
+        damping_.resize(padded_count, 0.0f);
+        rest_gravity_x_.resize(padded_count, 0.0f);
+        rest_gravity_y_.resize(padded_count, 0.0f);
+        gravity_x_.assign(padded_count, 0.0f);
+        gravity_y_.assign(padded_count, 0.0f);
+        root_x_.assign(padded_count, 0.0f);
+        root_y_.assign(padded_count, 0.0f);
+        previous_root_x_.assign(padded_count, 0.0f);
+        previous_root_y_.assign(padded_count, 0.0f);
+
+        group_offsets_.resize(group_count);
+        group_particle_counts_.resize(group_count);
+
+        uint32_t particle_offset = 0;
+        for (uint32_t group = 0; group < group_count; group++)
+        {
+            uint32_t particle_count = 0;
+            for (uint32_t index = group * SIMD_WIDTH; index < (std::min)(chain_count, (group + 1) * SIMD_WIDTH); index++)
+            {
+                particle_count = (std::max)(particle_count, chains_[index].particle_count);
+            }
+
+            group_offsets_[group] = particle_offset;
+            group_particle_counts_[group] = particle_count;
+            particle_offset += particle_count;
+        }
+
+        size_t element_count = static_cast<size_t>(particle_offset) * SIMD_WIDTH;
+        lengths_.assign(element_count, 0.0f);
+        position_x_.assign(element_count, 0.0f);
+        position_y_.assign(element_count, 0.0f);
+        previous_x_.assign(element_count, 0.0f);
+        previous_y_.assign(element_count, 0.0f);
+
+        for (uint32_t index = 0; index < chain_count; index++)
+        {
+            const Chain& chain = chains_[index];
+            uint32_t group = index / SIMD_WIDTH;
+            for (uint32_t particle = 1; particle < chain.particle_count; particle++)
+            {
+                uint32_t element = (group_offsets_[group] + particle) * SIMD_WIDTH + index % SIMD_WIDTH;
+                lengths_[element] = chain_lengths_[chain.length_offset + particle - 1];
+            }
+        }
+
+        layout_dirty_ = false;
+        Reset();
+    }
+
+    void PendulumPhysics::ReadInputs(uint32_t index, float& root_x, float& root_y, float& gravity_x, float& gravity_y) const
+    {
+        const Chain& chain = chains_[index];
+
+        root_x = 0.0f;
+        root_y = 0.0f;
+        float angle = 0.0f;
+        for (uint32_t i = 0; i < chain.input_count; i++)
+        {
+            const PendulumInput& input = chain_inputs_[chain.input_offset + i];
+            float value = chain.model->GetParameter(input.parameter) * input.weight;
+            switch (input.type)
+            {
+            case kPendulumInputX:
+                root_x += value;
+                break;
+            case kPendulumInputY:
+                root_y += value;
+                break;
+            case kPendulumInputAngle:
+                angle += value;
+                break;
+            }
+        }
+
+        float sin_angle = ::sinf(angle * DEGREES_TO_RADIANS);
+        float cos_angle = ::cosf(angle * DEGREES_TO_RADIANS);
+        gravity_x = rest_gravity_x_[index] * cos_angle - rest_gravity_y_[index] * sin_angle;
+        gravity_y = rest_gravity_x_[index] * sin_angle + rest_gravity_y_[index] * cos_angle;
+    }
+
+    void PendulumPhysics::SimulateGroup(uint32_t group, uint32_t step_count, float root_first_t, float root_step_t)
+    {
+        uint32_t first_chain = group * SIMD_WIDTH;
+        float step_time_sq = step_time_ * step_time_;
+
+        Simd::Float4 damping = Simd::Load(&damping_[first_chain]);
+        Simd::Float4 gravity_x = Simd::Mul(Simd::Load(&gravity_x_[first_chain]), Simd::Set1(step_time_sq));
+        Simd::Float4 gravity_y = Simd::Mul(Simd::Load(&gravity_y_[first_chain]), Simd::Set1(step_time_sq));
+        Simd::Float4 root_begin_x = Simd::Load(&previous_root_x_[first_chain]);
+        Simd::Float4 root_begin_y = Simd::Load(&previous_root_y_[first_chain]);
+        Simd::Float4 root_delta_x = Simd::Sub(Simd::Load(&root_x_[first_chain]), root_begin_x);
+        Simd::Float4 root_delta_y = Simd::Sub(Simd::Load(&root_y_[first_chain]), root_begin_y);
+        Simd::Float4 min_length_sq = Simd::Set1(MIN_SEGMENT_LENGTH_SQ);
+
+        uint32_t first_element = group_offsets_[group] * SIMD_WIDTH;
+        uint32_t particle_count = group_particle_counts_[group];
+        float* position_x = position_x_.data() + first_element;
+        float* position_y = position_y_.data() + first_element;
+        float* previous_x = previous_x_.data() + first_element;
+        float* previous_y = previous_y_.data() + first_element;
+        const float* lengths = lengths_.data() + first_element;
+
+        for (uint32_t step = 0; step < step_count; step++)
+        {
+            // The root moves in a straight line from last frame's inputs to this frame's.
+            Simd::Float4 t = Simd::Set1(root_first_t + root_step_t * step);
+            Simd::Float4 parent_x = Simd::MulAdd(root_delta_x, t, root_begin_x);
+            Simd::Float4 parent_y = Simd::MulAdd(root_delta_y, t, root_begin_y);
+            Simd::Store(previous_x, Simd::Load(position_x));
+            Simd::Store(previous_y, Simd::Load(position_y));
+            Simd::Store(position_x, parent_x);
+            Simd::Store(position_y, parent_y);
+
+            for (uint32_t particle = 1; particle < particle_count; particle++)
+            {
+                uint32_t element = particle * SIMD_WIDTH;
+                Simd::Float4 x = Simd::Load(position_x + element);
+                Simd::Float4 y = Simd::Load(position_y + element);
+
+                // Verlet: the last step's motion, damped, plus gravity.
+                Simd::Float4 next_x = Simd::Add(Simd::MulAdd(Simd::Sub(x, Simd::Load(previous_x + element)), damping, x), gravity_x);
+                Simd::Float4 next_y = Simd::Add(Simd::MulAdd(Simd::Sub(y, Simd::Load(previous_y + element)), damping, y), gravity_y);
+
+                // Back onto the circle around the parent.
+                Simd::Float4 dx = Simd::Sub(next_x, parent_x);
+                Simd::Float4 dy = Simd::Sub(next_y, parent_y);
+                Simd::Float4 length_sq = Simd::Max(Simd::MulAdd(dx, dx, Simd::Mul(dy, dy)), min_length_sq);
+                Simd::Float4 scale = Simd::Div(Simd::Load(lengths + element), Simd::Sqrt(length_sq));
+                next_x = Simd::MulAdd(dx, scale, parent_x);
+                next_y = Simd::MulAdd(dy, scale, parent_y);
+
+                Simd::Store(previous_x + element, x);
+                Simd::Store(previous_y + element, y);
+                Simd::Store(position_x + element, next_x);
+                Simd::Store(position_y + element, next_y);
+                parent_x = next_x;
+                parent_y = next_y;
+            }
+        }
+    }
+
+    float PendulumPhysics::SegmentAngle(const std::vector<float>& x, const std::vector<float>& y, uint32_t chain, uint32_t particle) const
+    {
+        uint32_t element = (group_offsets_[chain / SIMD_WIDTH] + particle) * SIMD_WIDTH + chain % SIMD_WIDTH;
+        float dx = x[element] - x[element - SIMD_WIDTH];
+        float dy = y[element] - y[element - SIMD_WIDTH];
+        float gravity_x = gravity_x_[chain];
+        float gravity_y = gravity_y_[chain];
+
+        return ::atan2f(gravity_x * dy - gravity_y * dx, gravity_x * dx + gravity_y * dy) * RADIANS_TO_DEGREES;
+    }
+
+    void PendulumPhysics::WriteOutputs(uint32_t index, float t)
+    {
+        const Chain& chain = chains_[index];
+        for (uint32_t i = 0; i < chain.output_count; i++)
+        {
+            const PendulumOutput& output = chain_outputs_[chain.output_offset + i];
+            float previous_angle = SegmentAngle(previous_x_, previous_y_, index, output.particle);
+            float angle = SegmentAngle(position_x_, position_y_, index, output.particle);
+
+            // The short way round when the segment crossed straight up between the two steps.
+            float delta = angle - previous_angle;
+            delta -= 360.0f * ::floorf((delta + 180.0f) / 360.0f);
+
+            chain.model->SetParameter(output.parameter, (previous_angle + delta * t) * output.scale);
+        }
+    }
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace D3D
+{
+    class Live2DModel;
+    class TaskScheduler;
+
+    enum PendulumInputType
+    {
+        kPendulumInputX,                                    // moves the root sideways
+        kPendulumInputY,                                    // moves the root up and down
+        kPendulumInputAngle,                                // tilts gravity, in degrees
+    };
+
+    // Adds parameter * weight to the root position or gravity angle of a chain.
+    struct PendulumInput
+    {
+        uint32_t parameter = 0;
+        PendulumInputType type = kPendulumInputX;
+        float weight = 1.0f;
+    };
+
+    // Sets parameter to scale * the angle in degrees between the segment ending at particle and
+    // the direction of gravity, counter clockwise.
+    struct PendulumOutput
+    {
+        uint32_t parameter = 0;
+        uint32_t particle = 1;
+        float scale = 1.0f;
+    };
+
+    // A chain of particles hanging from a root that follows the inputs of a model, e.g. a strand
+    // of hair swaying when the head turns. Lengths are in the units the inputs move the root in.
+    struct PendulumChainDesc
+    {
+        Live2DModel* model = nullptr;
+        std::vector<float> lengths;                         // one segment per particle below the root
+        float damping = 0.95f;                              // part of the velocity kept per step
+        float gravity_x = 0.0f;
+        float gravity_y = -9.8f;
+        std::vector<PendulumInput> inputs;
+        std::vector<PendulumOutput> outputs;
+    };
+
+    // Verlet pendulum chains for secondary motion, driving Live2DModel parameters. The simulation
+    // advances in fixed steps independent of the frame rate, the left over time is carried to
+    // the next Update. Chains are packed four to a group, one chain per SIMD lane, with the
+    // particles stored structure-of-arrays by group. Groups are independent and are spread
+    // across the task scheduler, every group takes all of the steps of a frame at once.
+    //
+    // Particles are only pulled towards their parent, never the other way, so the particles of
+    // a group past the end of a shorter chain do not affect it. With the same build, chains and
+    // sequence of parameters and delta times, the outputs are bit for bit the same no matter how
+    // many threads run the update.
+    class PendulumPhysics
+    {
+    public:
+        static const uint32_t MAX_CHAIN_PARTICLES = 16;
+        static const uint32_t MAX_STEPS_PER_UPDATE = 8;
+
+        void Clear();
+
+        // Adding a chain resets the simulation of all chains.
+        uint32_t AddChain(const PendulumChainDesc& desc);
+
+        // Puts every chain back at rest, hanging straight down from its current root.
+        void Reset();
+
+        // Length of one fixed step. Time beyond MAX_STEPS_PER_UPDATE steps is dropped, so a long
+        // stall does not have to be caught up on.
+        void SetStepTime(float step_time);
+        float GetStepTime() const;
+
+        uint32_t GetChainCount() const;
+        void GetParticlePosition(uint32_t chain, uint32_t particle, float& x, float& y) const;
+
+        // Reads the inputs from the models, simulates delta_time and writes the outputs back. The
+        // outputs run one step behind, blended between the last two steps.
+        void Update(float delta_time, TaskScheduler* scheduler = nullptr);
+
+    private:
+        struct Chain
+        {
+            Live2DModel* model;
+            uint32_t particle_count;                        // root included
+            uint32_t length_offset;                         // into chain_lengths_
+            uint32_t input_offset;
+            uint32_t input_count;
+            uint32_t output_offset;
+            uint32_t output_count;
+        };
+
+        void RebuildLayout();
+        void ReadInputs(uint32_t chain, float& root_x, float& root_y, float& gravity_x, float& gravity_y) const;
+        void Simulate(uint32_t step_count, float root_first_t, float root_step_t, TaskScheduler* scheduler);
+        void SimulateGroup(uint32_t group, uint32_t step_count, float root_first_t, float root_step_t);
+        float SegmentAngle(const std::vector<float>& x, const std::vector<float>& y, uint32_t chain, uint32_t particle) const;
+        void WriteOutputs(uint32_t chain, float t);
+
+        float                                               step_time_ = 1.0f / 120.0f;
+        double                                              accumulated_time_ = 0.0;
+
+        std::vector<Chain>                                  chains_;
+        std::vector<float>                                  chain_lengths_;
+        std::vector<PendulumInput>                          chain_inputs_;
+        std::vector<PendulumOutput>                         chain_outputs_;
+        bool                                                layout_dirty_ = false;
+
+        // Per chain, padded to whole groups.
+        std::vector<float>                                  damping_;
+        std::vector<float>                                  rest_gravity_x_;
+        std::vector<float>                                  rest_gravity_y_;
+        std::vector<float>                                  gravity_x_;
+        std::vector<float>                                  gravity_y_;
+        std::vector<float>                                  root_x_;
+        std::vector<float>                                  root_y_;
+        std::vector<float>                                  previous_root_x_;
+        std::vector<float>                                  previous_root_y_;
+
+        // Per group and particle, four lanes each: element (group_offsets_[group] + particle) * 4 + lane.
+        std::vector<uint32_t>                               group_offsets_;
+        std::vector<uint32_t>                               group_particle_counts_;
+        std::vector<float>                                  lengths_;
+        std::vector<float>                                  position_x_;
+        std::vector<float>                                  position_y_;
+        std::vector<float>                                  previous_x_;
+        std::vector<float>                                  previous_y_;
+    };
+};
@@ -0,0 +1,89 @@
+#include "PendulumPhysics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "Live2DModel.h"
+#include "TaskScheduler.h"
+#include "TestHarness.h"
+
+using namespace D3D;
+
+// Chains updated per millisecond, eight particles each at the default 120 Hz step, over
+// chain counts and thread counts. Every frame is 1/60 s, two steps. Worker count 0 updates
+// without a scheduler.
+int main()
+{
+    const uint32_t worker_counts[] = { 0, 1, 2, 4, 8 };
+    std::printf("%-8s", "chains");
+    for (uint32_t worker_count : worker_counts)
+    {
+        std::printf(" %8u w", worker_count);
+    }
+
+    std::printf("   (chains / ms)\n");
+
+    for (uint32_t chain_count : { 100u, 1000u, 10000u, 100000u })
+    {
+        // Sixteen chains per model, as hair strands of one character.
+        uint32_t model_count = (chain_count + 15) / 16;
+        std::vector<std::unique_ptr<Live2DModel>> models;
+        for (uint32_t m = 0; m < model_count; m++)
+        {
+            models.emplace_back(new Live2DModel());
+            models[m]->AddParameter(-30.0f, 30.0f, 0.0f);
+        }
+
+        PendulumPhysics physics;
+        for (uint32_t c = 0; c < chain_count; c++)
+        {
+            Live2DModel* model = models[c / 16].get();
+
+            PendulumChainDesc desc;
+            desc.model = model;
+            desc.lengths.assign(7, 0.5f);
+            desc.inputs.push_back(PendulumInput());
+
+            PendulumOutput output;
+            output.parameter = model->AddParameter(-1000.0f, 1000.0f, 0.0f);
+            output.particle = 7;
+            desc.outputs.push_back(output);
+            physics.AddChain(desc);
+        }
+
+        std::printf("%-8u", chain_count);
+
+        uint32_t frame_count = (std::max)(200000u / chain_count, 10u);
+        for (uint32_t worker_count : worker_counts)
+        {
+            std::unique_ptr<TaskScheduler> scheduler;
+            if (worker_count > 0)
+            {
+                scheduler.reset(new TaskScheduler(worker_count));
+            }
+
+            uint32_t frame = 0;
+            double ms = D3D::Test::MeasureMilliseconds(5, [&]()
+            {
+                for (uint32_t i = 0; i < frame_count; i++, frame++)
+                {
+                    for (auto& model : models)
+                    {
+                        model->SetParameter(0, 20.0f * std::sin(frame * 0.05f));
+                    }
+
+                    physics.Update(1.0f / 60.0f, scheduler.get());
+                }
+            });
+
+            std::printf(" %10.0f", chain_count * static_cast<double>(frame_count) / ms);
+        }
+
+        std::printf("\n");
+    }
+
+    return 0;
+}
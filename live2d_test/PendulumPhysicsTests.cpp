@@ -0,0 +1,202 @@
+#include "PendulumPhysics.h"
+
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "Live2DModel.h"
+#include "TaskScheduler.h"
+#include "TestHarness.h"
+
+using namespace D3D;
+
+namespace
+{
+    const uint32_t MODEL_COUNT = 8;
+    const uint32_t CHAIN_COUNT = 501;
+    const uint32_t FRAME_COUNT = 240;
+
+    // Per model: three input parameters, then one output per chain.
+    const uint32_t INPUT_PARAMETER_COUNT = 3;
+
+    float Random(uint32_t& seed)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / 16777216.0f;
+    }
+
+    struct Scene
+    {
+        std::vector<std::unique_ptr<Live2DModel>> models;
+        PendulumPhysics physics;
+    };
+
+    // Chains of every length from 1 to MAX_CHAIN_PARTICLES - 1 segments, with different
+    // damping and gravity, spread over the models. The chain count leaves a partial group.
+    void BuildScene(Scene& scene)
+    {
+        uint32_t seed = 1;
+        for (uint32_t m = 0; m < MODEL_COUNT; m++)
+        {
+            scene.models.emplace_back(new Live2DModel());
+            for (uint32_t p = 0; p < INPUT_PARAMETER_COUNT; p++)
+            {
+                scene.models[m]->AddParameter(-30.0f, 30.0f, 0.0f);
+            }
+        }
+
+        for (uint32_t c = 0; c < CHAIN_COUNT; c++)
+        {
+            Live2DModel* model = scene.models[c % MODEL_COUNT].get();
+
+            PendulumChainDesc desc;
+            desc.model = model;
+            uint32_t segment_count = 1 + c % (PendulumPhysics::MAX_CHAIN_PARTICLES - 1);
+            for (uint32_t s = 0; s < segment_count; s++)
+            {
+                desc.lengths.push_back(0.2f + Random(seed));
+            }
+
+            desc.damping = 0.8f + 0.19f * Random(seed);
+            desc.gravity_x = Random(seed) - 0.5f;
+
+            PendulumInput input;
+            input.parameter = 0;
+            input.type = kPendulumInputX;
+            input.weight = 0.05f + 0.1f * Random(seed);
+            desc.inputs.push_back(input);
+            input.parameter = 1;
+            input.type = kPendulumInputY;
+            desc.inputs.push_back(input);
+            input.parameter = 2;
+            input.type = kPendulumInputAngle;
+            input.weight = 0.5f;
+            desc.inputs.push_back(input);
+
+            PendulumOutput output;
+            output.parameter = model->AddParameter(-1000.0f, 1000.0f, 0.0f);
+            output.particle = segment_count;
+            output.scale = 0.5f + Random(seed);
+            desc.outputs.push_back(output);
+
+            scene.physics.AddChain(desc);
+        }
+    }
+
+    // Runs the same parameter and delta time sequence, frame rate swings and a long stall
+    // included, and returns every output parameter and particle position after every frame.
+    std::vector<float> Record(TaskScheduler* scheduler)
+    {
+        Scene scene;
+        BuildScene(scene);
+
+        uint32_t seed = 2;
+        std::vector<float> record;
+        for (uint32_t frame = 0; frame < FRAME_COUNT; frame++)
+        {
+            float delta_time = frame == 100 ? 0.5f : (1.0f / 240.0f) + Random(seed) * (1.0f / 30.0f);
+            float t = frame / 60.0f;
+            for (uint32_t m = 0; m < MODEL_COUNT; m++)
+            {
+                Live2DModel* model = scene.models[m].get();
+                model->SetParameter(0, 20.0f * std::sin(t * (1.0f + m)));
+                model->SetParameter(1, 5.0f * std::cos(t * 3.0f));
+                model->SetParameter(2, frame < 120 ? 15.0f : -10.0f);
+            }
+
+            scene.physics.Update(delta_time, scheduler);
+
+            for (uint32_t m = 0; m < MODEL_COUNT; m++)
+            {
+                Live2DModel* model = scene.models[m].get();
+                for (uint32_t p = INPUT_PARAMETER_COUNT; p < model->GetParameterCount(); p++)
+                {
+                    record.push_back(model->GetParameter(p));
+                }
+            }
+
+            for (uint32_t c = 0; c < CHAIN_COUNT; c++)
+            {
+                uint32_t particle_count = 2 + c % (PendulumPhysics::MAX_CHAIN_PARTICLES - 1);
+                for (uint32_t p = 0; p < particle_count; p++)
+                {
+                    float x, y;
+                    scene.physics.GetParticlePosition(c, p, x, y);
+                    record.push_back(x);
+                    record.push_back(y);
+                }
+            }
+        }
+
+        return record;
+    }
+
+    void TestDeterminism()
+    {
+        std::vector<float> serial = Record(nullptr);
+
+        // The chains have to actually swing for the comparison to mean anything.
+        bool moving = false;
+        bool finite = true;
+        for (float value : serial)
+        {
+            finite = finite && std::isfinite(value);
+        }
+
+        size_t frame_size = serial.size() / FRAME_COUNT;
+        for (size_t i = 0; i < CHAIN_COUNT && !moving; i++)
+        {
+            moving = std::fabs(serial[(FRAME_COUNT - 1) * frame_size + i] - serial[(FRAME_COUNT / 2) * frame_size + i]) > 1.0f;
+        }
+
+        TEST_CHECK(finite);
+        TEST_CHECK(moving);
+
+        // Again without a scheduler, then with 1, 4 and 8 workers.
+        TEST_CHECK(::memcmp(serial.data(), Record(nullptr).data(), serial.size() * sizeof(float)) == 0);
+        for (uint32_t worker_count : { 1u, 4u, 8u })
+        {
+            TaskScheduler scheduler(worker_count);
+            std::vector<float> threaded = Record(&scheduler);
+            TEST_CHECK(threaded.size() == serial.size());
+            TEST_CHECK(::memcmp(serial.data(), threaded.data(), serial.size() * sizeof(float)) == 0);
+        }
+    }
+
+    void TestRestPose()
+    {
+        // Without input a chain hangs straight along gravity and the output angle stays zero.
+        Live2DModel model;
+        model.AddParameter(-30.0f, 30.0f, 0.0f);
+
+        PendulumChainDesc desc;
+        desc.model = &model;
+        desc.lengths = { 1.0f, 2.0f, 0.5f };
+        desc.inputs.push_back(PendulumInput());
+
+        PendulumOutput output;
+        output.parameter = model.AddParameter(-1000.0f, 1000.0f, 0.0f);
+        output.particle = 3;
+        desc.outputs.push_back(output);
+
+        PendulumPhysics physics;
+        physics.AddChain(desc);
+        for (uint32_t frame = 0; frame < 60; frame++)
+        {
+            physics.Update(1.0f / 60.0f);
+        }
+
+        float x, y;
+        physics.GetParticlePosition(0, 3, x, y);
+        TEST_CHECK(std::fabs(x) <= 1e-4f && std::fabs(y + 3.5f) <= 1e-3f);
+        TEST_CHECK(std::fabs(model.GetParameter(output.parameter)) <= 1e-3f);
+    }
+}
+
+int main()
+{
+    TestRestPose();
+    TestDeterminism();
+    return D3D::Test::Finish("PendulumPhysicsTests");
+}
@@ -1 +1,32 @@
 #include "PointLight.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace D3D
+{
+    float PointLight::CalcRange() const
+    {
+        const float CUTOFF_SCALE = 256.0f;
+
+        float max_color = (std::max)((std::max)(color.x, color.y), color.z);
+        float c = k_const - CUTOFF_SCALE * max_color;
+        if (c >= 0.0f)
+        {
+            return 0.0f;
+        }
+
+        if (quadratic > 0.0f)
+        {
+            return (-k_linear + std::sqrt(k_linear * k_linear - 4.0f * quadratic * c)) / (2.0f * quadratic);
+        }
+
+        if (k_linear > 0.0f)
+        {
+            return -c / k_linear;
+        }
+
+        // No falloff at all, the light reaches everything.
+        return 3.0e38f;
+    }
+};
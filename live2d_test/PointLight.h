@@ -1,5 +1,24 @@
 #pragma once
-class PointLight
+
+#include "D3DUtil.h"
+
+#include <DirectXMath.h>
+
+namespace D3D
 {
-};
+#pragma pack(push,1)
+    // Mirrors OrgePointLight in Light.hlsi, attenuation = 1 / (k_const + k_linear * d + quadratic * d * d).
+    class PointLight
+    {
+    public:
+        DirectX::XMFLOAT3 position = {};
+        DirectX::XMFLOAT3 color = {};
+        float k_const = 1.0f;
+        float k_linear = 0.0f;
+        float quadratic = 0.0f;
 
+        // Distance at which the light's contribution drops below one 8 bit step.
+        float CalcRange() const;
+    };
+#pragma pack(pop)
+};
@@ -0,0 +1,663 @@
+#pragma once
+
+// CPU side math for code that has to build without the Windows SDK. On Windows this is just
+// DirectXMath. Everywhere else it provides the subset of the DirectXMath API the engine uses,
+// with the same types, names, row-vector conventions and results, implemented on the 4-wide
+// SimdMath Float4 (SSE, with FMA when the build targets it, NEON or scalar).
+
+#if defined(_WIN32)
+
+#include <DirectXMath.h>
+
+#else
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "SimdMath.h"
+
+namespace DirectX
+{
+    const float XM_PI = 3.141592654f;
+    const float XM_2PI = 6.283185307f;
+    const float XM_1DIVPI = 0.318309886f;
+    const float XM_1DIV2PI = 0.159154943f;
+    const float XM_PIDIV2 = 1.570796327f;
+    const float XM_PIDIV4 = 0.785398163f;
+
+    inline float XMConvertToRadians(float degrees) { return degrees * (XM_PI / 180.0f); }
+    inline float XMConvertToDegrees(float radians) { return radians * (180.0f / XM_PI); }
+
+    struct XMVECTOR
+    {
+        D3D::Simd::Float4 v;
+    };
+
+    using FXMVECTOR = const XMVECTOR;
+    using GXMVECTOR = const XMVECTOR;
+    using HXMVECTOR = const XMVECTOR;
+    using CXMVECTOR = const XMVECTOR&;
+
+    struct XMMATRIX
+    {
+        XMVECTOR r[4];
+
+        XMMATRIX() = default;
+        XMMATRIX(FXMVECTOR r0, FXMVECTOR r1, FXMVECTOR r2, CXMVECTOR r3) : r{ r0, r1, r2, r3 } {}
+        XMMATRIX(float m00, float m01, float m02, float m03,
+                 float m10, float m11, float m12, float m13,
+                 float m20, float m21, float m22, float m23,
+                 float m30, float m31, float m32, float m33);
+
+        XMMATRIX& operator*=(const XMMATRIX& m);
+        XMMATRIX operator*(const XMMATRIX& m) const;
+    };
+
+    using FXMMATRIX = const XMMATRIX;
+    using CXMMATRIX = const XMMATRIX&;
+
+    struct XMFLOAT2
+    {
+        float x;
+        float y;
+
+        XMFLOAT2() = default;
+        XMFLOAT2(float _x, float _y) : x(_x), y(_y) {}
+        explicit XMFLOAT2(const float* array) : x(array[0]), y(array[1]) {}
+    };
+
+    struct XMFLOAT3
+    {
+        float x;
+        float y;
+        float z;
+
+        XMFLOAT3() = default;
+        XMFLOAT3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+        explicit XMFLOAT3(const float* array) : x(array[0]), y(array[1]), z(array[2]) {}
+    };
+
+    struct XMFLOAT4
+    {
+        float x;
+        float y;
+        float z;
+        float w;
+
+        XMFLOAT4() = default;
+        XMFLOAT4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+        explicit XMFLOAT4(const float* array) : x(array[0]), y(array[1]), z(array[2]), w(array[3]) {}
+    };
+
+    struct XMUINT2
+    {
+        uint32_t x;
+        uint32_t y;
+
+        XMUINT2() = default;
+        XMUINT2(uint32_t _x, uint32_t _y) : x(_x), y(_y) {}
+    };
+
+    struct XMUINT3
+    {
+        uint32_t x;
+        uint32_t y;
+        uint32_t z;
+
+        XMUINT3() = default;
+        XMUINT3(uint32_t _x, uint32_t _y, uint32_t _z) : x(_x), y(_y), z(_z) {}
+    };
+
+    struct XMFLOAT4X4
+    {
+        union
+        {
+            struct
+            {
+                float _11, _12, _13, _14;
+                float _21, _22, _23, _24;
+                float _31, _32, _33, _34;
+                float _41, _42, _43, _44;
+            };
+            float m[4][4];
+        };
+
+        XMFLOAT4X4() = default;
+        XMFLOAT4X4(float m00, float m01, float m02, float m03,
+                   float m10, float m11, float m12, float m13,
+                   float m20, float m21, float m22, float m23,
+                   float m30, float m31, float m32, float m33)
+            : _11(m00), _12(m01), _13(m02), _14(m03),
+              _21(m10), _22(m11), _23(m12), _24(m13),
+              _31(m20), _32(m21), _33(m22), _34(m23),
+              _41(m30), _42(m31), _43(m32), _44(m33) {}
+
+        float operator()(size_t row, size_t column) const { return m[row][column]; }
+        float& operator()(size_t row, size_t column) { return m[row][column]; }
+    };
+
+    //-------------------------------------------------------------------------------------------
+    // Load / store
+
+    inline XMVECTOR XMLoadFloat2(const XMFLOAT2* source) { return { D3D::Simd::Set(source->x, source->y, 0.0f, 0.0f) }; }
+    inline XMVECTOR XMLoadFloat3(const XMFLOAT3* source) { return { D3D::Simd::Set(source->x, source->y, source->z, 0.0f) }; }
+    inline XMVECTOR XMLoadFloat4(const XMFLOAT4* source) { return { D3D::Simd::Load(&source->x) }; }
+
+    inline XMMATRIX XMLoadFloat4x4(const XMFLOAT4X4* source)
+    {
+        XMMATRIX m;
+        for (int32_t row = 0; row < 4; row++)
+        {
+            m.r[row].v = D3D::Simd::Load(source->m[row]);
+        }
+
+        return m;
+    }
+
+    inline void XMStoreFloat2(XMFLOAT2* destination, FXMVECTOR v)
+    {
+        float lanes[4];
+        D3D::Simd::Store(lanes, v.v);
+        destination->x = lanes[0];
+        destination->y = lanes[1];
+    }
+
+    inline void XMStoreFloat3(XMFLOAT3* destination, FXMVECTOR v)
+    {
+        float lanes[4];
+        D3D::Simd::Store(lanes, v.v);
+        destination->x = lanes[0];
+        destination->y = lanes[1];
+        destination->z = lanes[2];
+    }
+
+    inline void XMStoreFloat4(XMFLOAT4* destination, FXMVECTOR v) { D3D::Simd::Store(&destination->x, v.v); }
+
+    inline void XMStoreFloat4x4(XMFLOAT4X4* destination, FXMMATRIX m)
+    {
+        for (int32_t row = 0; row < 4; row++)
+        {
+            D3D::Simd::Store(destination->m[row], m.r[row].v);
+        }
+    }
+
+    //-------------------------------------------------------------------------------------------
+    // Vector
+
+    inline XMVECTOR XMVectorSet(float x, float y, float z, float w) { return { D3D::Simd::Set(x, y, z, w) }; }
+    inline XMVECTOR XMVectorZero() { return { D3D::Simd::Zero() }; }
+    inline XMVECTOR XMVectorReplicate(float value) { return { D3D::Simd::Set1(value) }; }
+
+    inline XMVECTOR XMVectorSplatX(FXMVECTOR v) { return { D3D::Simd::Splat<0>(v.v) }; }
+    inline XMVECTOR XMVectorSplatY(FXMVECTOR v) { return { D3D::Simd::Splat<1>(v.v) }; }
+    inline XMVECTOR XMVectorSplatZ(FXMVECTOR v) { return { D3D::Simd::Splat<2>(v.v) }; }
+    inline XMVECTOR XMVectorSplatW(FXMVECTOR v) { return { D3D::Simd::Splat<3>(v.v) }; }
+
+    inline float XMVectorGetX(FXMVECTOR v) { return D3D::Simd::GetX(v.v); }
+    inline float XMVectorGetY(FXMVECTOR v) { return D3D::Simd::GetX(D3D::Simd::Splat<1>(v.v)); }
+    inline float XMVectorGetZ(FXMVECTOR v) { return D3D::Simd::GetX(D3D::Simd::Splat<2>(v.v)); }
+    inline float XMVectorGetW(FXMVECTOR v) { return D3D::Simd::GetX(D3D::Simd::Splat<3>(v.v)); }
+
+    inline XMVECTOR XMVectorSetW(FXMVECTOR v, float w)
+    {
+        // (x, y, z, w) from (x, y) and (z, w).
+        D3D::Simd::Float4 zw = D3D::Simd::Shuffle<2, 2, 0, 0>(v.v, D3D::Simd::Set1(w));
+        return { D3D::Simd::Shuffle<0, 1, 0, 2>(v.v, zw) };
+    }
+
+    inline XMVECTOR XMVectorAdd(FXMVECTOR a, FXMVECTOR b) { return { D3D::Simd::Add(a.v, b.v) }; }
+    inline XMVECTOR XMVectorSubtract(FXMVECTOR a, FXMVECTOR b) { return { D3D::Simd::Sub(a.v, b.v) }; }
+    inline XMVECTOR XMVectorMultiply(FXMVECTOR a, FXMVECTOR b) { return { D3D::Simd::Mul(a.v, b.v) }; }
+    inline XMVECTOR XMVectorDivide(FXMVECTOR a, FXMVECTOR b) { return { D3D::Simd::Div(a.v, b.v) }; }
+    inline XMVECTOR XMVectorMultiplyAdd(FXMVECTOR a, FXMVECTOR b, FXMVECTOR c) { return { D3D::Simd::MulAdd(a.v, b.v, c.v) }; }
+    inline XMVECTOR XMVectorScale(FXMVECTOR v, float scale) { return { D3D::Simd::Mul(v.v, D3D::Simd::Set1(scale)) }; }
+    inline XMVECTOR XMVectorNegate(FXMVECTOR v) { return { D3D::Simd::Sub(D3D::Simd::Zero(), v.v) }; }
+    inline XMVECTOR XMVectorMin(FXMVECTOR a, FXMVECTOR b) { return { D3D::Simd::Min(a.v, b.v) }; }
+    inline XMVECTOR XMVectorMax(FXMVECTOR a, FXMVECTOR b) { return { D3D::Simd::Max(a.v, b.v) }; }
+    inline XMVECTOR XMVectorSqrt(FXMVECTOR v) { return { D3D::Simd::Sqrt(v.v) }; }
+    inline XMVECTOR XMVectorLerp(FXMVECTOR a, FXMVECTOR b, float t) { return { D3D::Simd::MulAdd(D3D::Simd::Sub(b.v, a.v), D3D::Simd::Set1(t), a.v) }; }
+
+    inline XMVECTOR operator+(FXMVECTOR v) { return v; }
+    inline XMVECTOR operator-(FXMVECTOR v) { return XMVectorNegate(v); }
+    inline XMVECTOR operator+(FXMVECTOR a, FXMVECTOR b) { return XMVectorAdd(a, b); }
+    inline XMVECTOR operator-(FXMVECTOR a, FXMVECTOR b) { return XMVectorSubtract(a, b); }
+    inline XMVECTOR operator*(FXMVECTOR a, FXMVECTOR b) { return XMVectorMultiply(a, b); }
+    inline XMVECTOR operator/(FXMVECTOR a, FXMVECTOR b) { return XMVectorDivide(a, b); }
+    inline XMVECTOR operator*(FXMVECTOR v, float s) { return XMVectorScale(v, s); }
+    inline XMVECTOR operator*(float s, FXMVECTOR v) { return XMVectorScale(v, s); }
+    inline XMVECTOR operator/(FXMVECTOR v, float s) { return { D3D::Simd::Div(v.v, D3D::Simd::Set1(s)) }; }
+    inline XMVECTOR& operator+=(XMVECTOR& a, FXMVECTOR b) { a = XMVectorAdd(a, b); return a; }
+    inline XMVECTOR& operator-=(XMVECTOR& a, FXMVECTOR b) { a = XMVectorSubtract(a, b); return a; }
+    inline XMVECTOR& operator*=(XMVECTOR& a, FXMVECTOR b) { a = XMVectorMultiply(a, b); return a; }
+    inline XMVECTOR& operator/=(XMVECTOR& a, FXMVECTOR b) { a = XMVectorDivide(a, b); return a; }
+    inline XMVECTOR& operator*=(XMVECTOR& v, float s) { v = XMVectorScale(v, s); return v; }
+    inline XMVECTOR& operator/=(XMVECTOR& v, float s) { v = v / s; return v; }
+
+    //-------------------------------------------------------------------------------------------
+    // 3D and 4D vector, the scalar results are replicated into every lane
+
+    inline XMVECTOR XMVector3Dot(FXMVECTOR a, FXMVECTOR b)
+    {
+        D3D::Simd::Float4 products = D3D::Simd::Mul(a.v, b.v);
+        D3D::Simd::Float4 sum = D3D::Simd::Add(products, D3D::Simd::Splat<1>(products));
+        sum = D3D::Simd::Add(sum, D3D::Simd::Splat<2>(products));
+        return { D3D::Simd::Splat<0>(sum) };
+    }
+
+    inline XMVECTOR XMVector4Dot(FXMVECTOR a, FXMVECTOR b)
+    {
+        D3D::Simd::Float4 products = D3D::Simd::Mul(a.v, b.v);
+        D3D::Simd::Float4 sum = D3D::Simd::Add(products, D3D::Simd::Swizzle<1, 0, 3, 2>(products));
+        return { D3D::Simd::Add(sum, D3D::Simd::Swizzle<2, 3, 0, 1>(sum)) };
+    }
+
+    inline XMVECTOR XMVector3Cross(FXMVECTOR a, FXMVECTOR b)
+    {
+        // a.yzx * b.zxy - a.zxy * b.yzx, w ends up 0.
+        D3D::Simd::Float4 left = D3D::Simd::Mul(D3D::Simd::Swizzle<1, 2, 0, 3>(a.v), D3D::Simd::Swizzle<2, 0, 1, 3>(b.v));
+        D3D::Simd::Float4 right = D3D::Simd::Mul(D3D::Simd::Swizzle<2, 0, 1, 3>(a.v), D3D::Simd::Swizzle<1, 2, 0, 3>(b.v));
+        return { D3D::Simd::Sub(left, right) };
+    }
+
+    inline XMVECTOR XMVector3LengthSq(FXMVECTOR v) { return XMVector3Dot(v, v); }
+    inline XMVECTOR XMVector3Length(FXMVECTOR v) { return XMVectorSqrt(XMVector3Dot(v, v)); }
+    inline XMVECTOR XMVector4LengthSq(FXMVECTOR v) { return XMVector4Dot(v, v); }
+    inline XMVECTOR XMVector4Length(FXMVECTOR v) { return XMVectorSqrt(XMVector4Dot(v, v)); }
+
+    namespace Internal
+    {
+        // Zero length vectors normalize to zero, as in DirectXMath.
+        inline XMVECTOR NormalizeByLength(FXMVECTOR v, FXMVECTOR length)
+        {
+            D3D::Simd::Float4 non_zero = D3D::Simd::CmpGt(length.v, D3D::Simd::Zero());
+            return { D3D::Simd::And(non_zero, D3D::Simd::Div(v.v, length.v)) };
+        }
+    }
+
+    inline XMVECTOR XMVector3Normalize(FXMVECTOR v) { return Internal::NormalizeByLength(v, XMVector3Length(v)); }
+    inline XMVECTOR XMVector4Normalize(FXMVECTOR v) { return Internal::NormalizeByLength(v, XMVector4Length(v)); }
+
+    inline bool XMVector3Greater(FXMVECTOR a, FXMVECTOR b) { return (D3D::Simd::MoveMask(D3D::Simd::CmpGt(a.v, b.v)) & 0x7) == 0x7; }
+    inline bool XMVector3GreaterOrEqual(FXMVECTOR a, FXMVECTOR b) { return (D3D::Simd::MoveMask(D3D::Simd::CmpGe(a.v, b.v)) & 0x7) == 0x7; }
+    inline bool XMVector3Less(FXMVECTOR a, FXMVECTOR b) { return (D3D::Simd::MoveMask(D3D::Simd::CmpLt(a.v, b.v)) & 0x7) == 0x7; }
+    inline bool XMVector3LessOrEqual(FXMVECTOR a, FXMVECTOR b) { return (D3D::Simd::MoveMask(D3D::Simd::CmpLe(a.v, b.v)) & 0x7) == 0x7; }
+
+    inline XMVECTOR XMVector4Transform(FXMVECTOR v, FXMMATRIX m)
+    {
+        D3D::Simd::Float4 result = D3D::Simd::Mul(D3D::Simd::Splat<0>(v.v), m.r[0].v);
+        result = D3D::Simd::MulAdd(D3D::Simd::Splat<1>(v.v), m.r[1].v, result);
+        result = D3D::Simd::MulAdd(D3D::Simd::Splat<2>(v.v), m.r[2].v, result);
+        return { D3D::Simd::MulAdd(D3D::Simd::Splat<3>(v.v), m.r[3].v, result) };
+    }
+
+    // (x, y, z, 1) * m
+    inline XMVECTOR XMVector3Transform(FXMVECTOR v, FXMMATRIX m)
+    {
+        D3D::Simd::Float4 result = D3D::Simd::MulAdd(D3D::Simd::Splat<0>(v.v), m.r[0].v, m.r[3].v);
+        result = D3D::Simd::MulAdd(D3D::Simd::Splat<1>(v.v), m.r[1].v, result);
+        return { D3D::Simd::MulAdd(D3D::Simd::Splat<2>(v.v), m.r[2].v, result) };
+    }
+
+    // (x, y, z, 1) * m divided by w.
+    inline XMVECTOR XMVector3TransformCoord(FXMVECTOR v, FXMMATRIX m)
+    {
+        XMVECTOR result = XMVector3Transform(v, m);
+        return { D3D::Simd::Div(result.v, D3D::Simd::Splat<3>(result.v)) };
+    }
+
+    // (x, y, z, 0) * m
+    inline XMVECTOR XMVector3TransformNormal(FXMVECTOR v, FXMMATRIX m)
+    {
+        D3D::Simd::Float4 result = D3D::Simd::Mul(D3D::Simd::Splat<0>(v.v), m.r[0].v);
+        result = D3D::Simd::MulAdd(D3D::Simd::Splat<1>(v.v), m.r[1].v, result);
+        return { D3D::Simd::MulAdd(D3D::Simd::Splat<2>(v.v), m.r[2].v, result) };
+    }
+
+    // Batch version of XMVector3TransformCoord over strided XMFLOAT3 arrays.
+    inline XMFLOAT3* XMVector3TransformCoordStream(XMFLOAT3* output, size_t output_stride, const XMFLOAT3* input, size_t input_stride,
+        size_t count, FXMMATRIX m)
+    {
+        const uint8_t* source = reinterpret_cast<const uint8_t*>(input);
+        uint8_t* destination = reinterpret_cast<uint8_t*>(output);
+        for (size_t i = 0; i < count; i++)
+        {
+            XMVECTOR v = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(source));
+            XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(destination), XMVector3TransformCoord(v, m));
+            source += input_stride;
+            destination += output_stride;
+        }
+
+        return output;
+    }
+
+    //-------------------------------------------------------------------------------------------
+    // Matrix
+
+    inline XMMATRIX::XMMATRIX(float m00, float m01, float m02, float m03,
+                              float m10, float m11, float m12, float m13,
+                              float m20, float m21, float m22, float m23,
+                              float m30, float m31, float m32, float m33)
+        : r{ XMVectorSet(m00, m01, m02, m03), XMVectorSet(m10, m11, m12, m13), XMVectorSet(m20, m21, m22, m23), XMVectorSet(m30, m31, m32, m33) }
+    {
+    }
+
+    inline XMMATRIX XMMatrixIdentity()
+    {
+        return XMMATRIX(
+            1.0f, 0.0f, 0.0f, 0.0f,
+            0.0f, 1.0f, 0.0f, 0.0f,
+            0.0f, 0.0f, 1.0f, 0.0f,
+            0.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+    inline XMMATRIX XMMatrixMultiply(FXMMATRIX a, CXMMATRIX b)
+    {
+        XMMATRIX result;
+        for (int32_t row = 0; row < 4; row++)
+        {
+            result.r[row] = XMVector4Transform(a.r[row], b);
+        }
+
+        return result;
+    }
+
+    inline XMMATRIX& XMMATRIX::operator*=(const XMMATRIX& m) { *this = XMMatrixMultiply(*this, m); return *this; }
+    inline XMMATRIX XMMATRIX::operator*(const XMMATRIX& m) const { return XMMatrixMultiply(*this, m); }
+
+    inline XMMATRIX XMMatrixTranspose(FXMMATRIX m)
+    {
+        XMMATRIX result = m;
+        D3D::Simd::Transpose(result.r[0].v, result.r[1].v, result.r[2].v, result.r[3].v);
+        return result;
+    }
+
+    namespace Internal
+    {
+        // 2x2 blocks stored row major in one register: (m00, m01, m10, m11).
+        inline D3D::Simd::Float4 Mat2Mul(D3D::Simd::Float4 a, D3D::Simd::Float4 b)
+        {
+            using namespace D3D::Simd;
+            return Add(Mul(a, Swizzle<0, 3, 0, 3>(b)), Mul(Swizzle<1, 0, 3, 2>(a), Swizzle<2, 1, 2, 1>(b)));
+        }
+
+        // adjugate(a) * b
+        inline D3D::Simd::Float4 Mat2AdjMul(D3D::Simd::Float4 a, D3D::Simd::Float4 b)
+        {
+            using namespace D3D::Simd;
+            return Sub(Mul(Swizzle<3, 3, 0, 0>(a), b), Mul(Swizzle<1, 1, 2, 2>(a), Swizzle<2, 3, 0, 1>(b)));
+        }
+
+        // a * adjugate(b)
+        inline D3D::Simd::Float4 Mat2MulAdj(D3D::Simd::Float4 a, D3D::Simd::Float4 b)
+        {
+            using namespace D3D::Simd;
+            return Sub(Mul(a, Swizzle<3, 0, 3, 0>(b)), Mul(Swizzle<1, 0, 3, 2>(a), Swizzle<2, 1, 2, 1>(b)));
+        }
+
+        // Block-wise inverse of [A B; C D] through 2x2 adjugates, so no scalar cofactors.
+        inline XMMATRIX InverseBlocks(FXMMATRIX m, XMVECTOR* determinant, bool want_inverse)
+        {
+            using namespace D3D::Simd;
+
+            Float4 a = Shuffle<0, 1, 0, 1>(m.r[0].v, m.r[1].v);
+            Float4 b = Shuffle<2, 3, 2, 3>(m.r[0].v, m.r[1].v);
+            Float4 c = Shuffle<0, 1, 0, 1>(m.r[2].v, m.r[3].v);
+            Float4 d = Shuffle<2, 3, 2, 3>(m.r[2].v, m.r[3].v);
+
+            // (|A|, |B|, |C|, |D|)
+            Float4 block_det = Sub(
+                Mul(Shuffle<0, 2, 0, 2>(m.r[0].v, m.r[2].v), Shuffle<1, 3, 1, 3>(m.r[1].v, m.r[3].v)),
+                Mul(Shuffle<1, 3, 1, 3>(m.r[0].v, m.r[2].v), Shuffle<0, 2, 0, 2>(m.r[1].v, m.r[3].v)));
+            Float4 det_a = Splat<0>(block_det);
+            Float4 det_b = Splat<1>(block_det);
+            Float4 det_c = Splat<2>(block_det);
+            Float4 det_d = Splat<3>(block_det);
+
+            Float4 d_c = Mat2AdjMul(d, c);
+            Float4 a_b = Mat2AdjMul(a, b);
+
+            // |M| = |A||D| + |B||C| - tr((A#B)(D#C))
+            Float4 trace = Mul(a_b, Swizzle<0, 2, 1, 3>(d_c));
+            trace = Add(trace, Swizzle<1, 0, 3, 2>(trace));
+            trace = Add(trace, Swizzle<2, 3, 0, 1>(trace));
+            Float4 det_m = Sub(Add(Mul(det_a, det_d), Mul(det_b, det_c)), trace);
+
+            if (determinant != nullptr)
+            {
+                determinant->v = det_m;
+            }
+
+            XMMATRIX result;
+            if (!want_inverse)
+            {
+                return result;
+            }
+
+            Float4 x = Sub(Mul(det_d, a), Mat2Mul(b, d_c));
+            Float4 w = Sub(Mul(det_a, d), Mat2Mul(c, a_b));
+            Float4 y = Sub(Mul(det_b, c), Mat2MulAdj(d, a_b));
+            Float4 z = Sub(Mul(det_c, b), Mat2MulAdj(a, d_c));
+
+            Float4 inv_det = Div(Set(1.0f, -1.0f, -1.0f, 1.0f), det_m);
+            x = Mul(x, inv_det);
+            y = Mul(y, inv_det);
+            z = Mul(z, inv_det);
+            w = Mul(w, inv_det);
+
+            // The adjugate swaps and the final row layout folded into one shuffle per row.
+            result.r[0].v = Shuffle<3, 1, 3, 1>(x, y);
+            result.r[1].v = Shuffle<2, 0, 2, 0>(x, y);
+            result.r[2].v = Shuffle<3, 1, 3, 1>(z, w);
+            result.r[3].v = Shuffle<2, 0, 2, 0>(z, w);
+            return result;
+        }
+    }
+
+    inline XMVECTOR XMMatrixDeterminant(FXMMATRIX m)
+    {
+        XMVECTOR determinant;
+        Internal::InverseBlocks(m, &determinant, false);
+        return determinant;
+    }
+
+    inline XMMATRIX XMMatrixInverse(XMVECTOR* determinant, FXMMATRIX m)
+    {
+        return Internal::InverseBlocks(m, determinant, true);
+    }
+
+    inline XMMATRIX XMMatrixScaling(float x, float y, float z)
+    {
+        return XMMATRIX(
+            x, 0.0f, 0.0f, 0.0f,
+            0.0f, y, 0.0f, 0.0f,
+            0.0f, 0.0f, z, 0.0f,
+            0.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+    inline XMMATRIX XMMatrixTranslation(float x, float y, float z)
+    {
+        return XMMATRIX(
+            1.0f, 0.0f, 0.0f, 0.0f,
+            0.0f, 1.0f, 0.0f, 0.0f,
+            0.0f, 0.0f, 1.0f, 0.0f,
+            x, y, z, 1.0f);
+    }
+
+    inline XMMATRIX XMMatrixRotationX(float angle)
+    {
+        float s = sinf(angle);
+        float c = cosf(angle);
+        return XMMATRIX(
+            1.0f, 0.0f, 0.0f, 0.0f,
+            0.0f, c, s, 0.0f,
+            0.0f, -s, c, 0.0f,
+            0.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+    inline XMMATRIX XMMatrixRotationY(float angle)
+    {
+        float s = sinf(angle);
+        float c = cosf(angle);
+        return XMMATRIX(
+            c, 0.0f, -s, 0.0f,
+            0.0f, 1.0f, 0.0f, 0.0f,
+            s, 0.0f, c, 0.0f,
+            0.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+    inline XMMATRIX XMMatrixRotationZ(float angle)
+    {
+        float s = sinf(angle);
+        float c = cosf(angle);
+        return XMMATRIX(
+            c, s, 0.0f, 0.0f,
+            -s, c, 0.0f, 0.0f,
+            0.0f, 0.0f, 1.0f, 0.0f,
+            0.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+    // normal must be unit length.
+    inline XMMATRIX XMMatrixRotationNormal(FXMVECTOR normal, float angle)
+    {
+        XMFLOAT3 n;
+        XMStoreFloat3(&n, normal);
+        float s = sinf(angle);
+        float c = cosf(angle);
+        float t = 1.0f - c;
+
+        return XMMATRIX(
+            t * n.x * n.x + c, t * n.x * n.y + s * n.z, t * n.x * n.z - s * n.y, 0.0f,
+            t * n.x * n.y - s * n.z, t * n.y * n.y + c, t * n.y * n.z + s * n.x, 0.0f,
+            t * n.x * n.z + s * n.y, t * n.y * n.z - s * n.x, t * n.z * n.z + c, 0.0f,
+            0.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+    inline XMMATRIX XMMatrixRotationAxis(FXMVECTOR axis, float angle)
+    {
+        return XMMatrixRotationNormal(XMVector3Normalize(axis), angle);
+    }
+
+    inline XMMATRIX XMMatrixRotationQuaternion(FXMVECTOR quaternion)
+    {
+        XMFLOAT4 q;
+        XMStoreFloat4(&q, quaternion);
+
+        float xx = 2.0f * q.x * q.x;
+        float yy = 2.0f * q.y * q.y;
+        float zz = 2.0f * q.z * q.z;
+        float xy = 2.0f * q.x * q.y;
+        float xz = 2.0f * q.x * q.z;
+        float yz = 2.0f * q.y * q.z;
+        float wx = 2.0f * q.w * q.x;
+        float wy = 2.0f * q.w * q.y;
+        float wz = 2.0f * q.w * q.z;
+
+        return XMMATRIX(
+            1.0f - yy - zz, xy + wz, xz - wy, 0.0f,
+            xy - wz, 1.0f - xx - zz, yz + wx, 0.0f,
+            xz + wy, yz - wx, 1.0f - xx - yy, 0.0f,
+            0.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+    inline XMMATRIX XMMatrixPerspectiveFovLH(float fov_y, float aspect_ratio, float near_z, float far_z)
+    {
+        float height = cosf(0.5f * fov_y) / sinf(0.5f * fov_y);
+        float width = height / aspect_ratio;
+        float range = far_z / (far_z - near_z);
+
+        return XMMATRIX(
+            width, 0.0f, 0.0f, 0.0f,
+            0.0f, height, 0.0f, 0.0f,
+            0.0f, 0.0f, range, 1.0f,
+            0.0f, 0.0f, -range * near_z, 0.0f);
+    }
+
+    inline XMMATRIX XMMatrixLookToLH(FXMVECTOR eye_position, FXMVECTOR eye_direction, FXMVECTOR up_direction)
+    {
+        XMVECTOR r2 = XMVector3Normalize(eye_direction);
+        XMVECTOR r0 = XMVector3Normalize(XMVector3Cross(up_direction, r2));
+        XMVECTOR r1 = XMVector3Cross(r2, r0);
+        XMVECTOR neg_eye = XMVectorNegate(eye_position);
+
+        XMMATRIX m(
+            XMVectorSetW(r0, XMVectorGetX(XMVector3Dot(r0, neg_eye))),
+            XMVectorSetW(r1, XMVectorGetX(XMVector3Dot(r1, neg_eye))),
+            XMVectorSetW(r2, XMVectorGetX(XMVector3Dot(r2, neg_eye))),
+            XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f));
+        return XMMatrixTranspose(m);
+    }
+
+    inline XMMATRIX XMMatrixLookAtLH(FXMVECTOR eye_position, FXMVECTOR focus_position, FXMVECTOR up_direction)
+    {
+        return XMMatrixLookToLH(eye_position, XMVectorSubtract(focus_position, eye_position), up_direction);
+    }
+
+    //-------------------------------------------------------------------------------------------
+    // Quaternion
+
+    inline XMVECTOR XMQuaternionIdentity() { return XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f); }
+    inline XMVECTOR XMQuaternionDot(FXMVECTOR a, FXMVECTOR b) { return XMVector4Dot(a, b); }
+    inline XMVECTOR XMQuaternionNormalize(FXMVECTOR q) { return XMVector4Normalize(q); }
+    inline XMVECTOR XMQuaternionConjugate(FXMVECTOR q) { return { D3D::Simd::Mul(q.v, D3D::Simd::Set(-1.0f, -1.0f, -1.0f, 1.0f)) }; }
+
+    // The rotation a followed by b, i.e. b * a in quaternion algebra.
+    inline XMVECTOR XMQuaternionMultiply(FXMVECTOR a, FXMVECTOR b)
+    {
+        using namespace D3D::Simd;
+
+        Float4 result = Mul(Splat<3>(b.v), a.v);
+        result = MulAdd(Mul(Splat<0>(b.v), Swizzle<3, 2, 1, 0>(a.v)), Set(1.0f, -1.0f, 1.0f, -1.0f), result);
+        result = MulAdd(Mul(Splat<1>(b.v), Swizzle<2, 3, 0, 1>(a.v)), Set(1.0f, 1.0f, -1.0f, -1.0f), result);
+        result = MulAdd(Mul(Splat<2>(b.v), Swizzle<1, 0, 3, 2>(a.v)), Set(-1.0f, 1.0f, 1.0f, -1.0f), result);
+        return { result };
+    }
+
+    inline XMVECTOR XMQuaternionRotationNormal(FXMVECTOR normal, float angle)
+    {
+        float s = sinf(0.5f * angle);
+        float c = cosf(0.5f * angle);
+        return XMVectorSetW(XMVectorScale(normal, s), c);
+    }
+
+    inline XMVECTOR XMQuaternionRotationAxis(FXMVECTOR axis, float angle)
+    {
+        return XMQuaternionRotationNormal(XMVector3Normalize(axis), angle);
+    }
+
+    // Roll about z, then pitch about x, then yaw about y.
+    inline XMVECTOR XMQuaternionRotationRollPitchYaw(float pitch, float yaw, float roll)
+    {
+        float sp = sinf(0.5f * pitch);
+        float cp = cosf(0.5f * pitch);
+        float sy = sinf(0.5f * yaw);
+        float cy = cosf(0.5f * yaw);
+        float sr = sinf(0.5f * roll);
+        float cr = cosf(0.5f * roll);
+
+        return XMVectorSet(
+            cr * sp * cy + sr * cp * sy,
+            cr * cp * sy - sr * sp * cy,
+            sr * cp * cy - cr * sp * sy,
+            cr * cp * cy + sr * sp * sy);
+    }
+
+    inline XMVECTOR XMQuaternionRotationRollPitchYawFromVector(FXMVECTOR angles)
+    {
+        XMFLOAT3 a;
+        XMStoreFloat3(&a, angles);
+        return XMQuaternionRotationRollPitchYaw(a.x, a.y, a.z);
+    }
+
+    inline XMMATRIX XMMatrixRotationRollPitchYaw(float pitch, float yaw, float roll)
+    {
+        return XMMatrixRotationQuaternion(XMQuaternionRotationRollPitchYaw(pitch, yaw, roll));
+    }
+
+    inline XMMATRIX XMMatrixRotationRollPitchYawFromVector(FXMVECTOR angles)
+    {
+        return XMMatrixRotationQuaternion(XMQuaternionRotationRollPitchYawFromVector(angles));
+    }
+};
+
+#endif
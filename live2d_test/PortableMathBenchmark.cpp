@@ -0,0 +1,125 @@
+#include "PortableMath.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "TestHarness.h"
+
+using namespace DirectX;
+
+namespace
+{
+    float Random(uint32_t& seed)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / 16777216.0f;
+    }
+
+    // The plain loops the SIMD versions replace.
+    void MultiplyScalar(const XMFLOAT4X4& a, const XMFLOAT4X4& b, XMFLOAT4X4& result)
+    {
+        for (uint32_t row = 0; row < 4; row++)
+        {
+            for (uint32_t column = 0; column < 4; column++)
+            {
+                result.m[row][column] = a.m[row][0] * b.m[0][column] + a.m[row][1] * b.m[1][column] + a.m[row][2] * b.m[2][column] + a.m[row][3] * b.m[3][column];
+            }
+        }
+    }
+
+    void TransformCoordScalar(const XMFLOAT3& v, const XMFLOAT4X4& m, XMFLOAT3& result)
+    {
+        float x = v.x * m._11 + v.y * m._21 + v.z * m._31 + m._41;
+        float y = v.x * m._12 + v.y * m._22 + v.z * m._32 + m._42;
+        float z = v.x * m._13 + v.y * m._23 + v.z * m._33 + m._43;
+        float w = v.x * m._14 + v.y * m._24 + v.z * m._34 + m._44;
+        result = XMFLOAT3(x / w, y / w, z / w);
+    }
+}
+
+// Millions per second of 4x4 matrix multiplies and inverses over 4096 matrices, and of points
+// run through XMVector3TransformCoordStream, each against the plain scalar loop where there is
+// one. Build with -DLIVE2D_SIMD=SSE2, AVX2 or SCALAR to compare backends.
+int main()
+{
+#if defined(SIMD_MATH_AVX)
+    const char* backend = "AVX";
+#elif defined(SIMD_MATH_SCALAR)
+    const char* backend = "scalar";
+#else
+    const char* backend = "SSE/NEON";
+#endif
+    std::printf("PortableMath on %s\n", backend);
+
+    const uint32_t matrix_count = 4096;
+    uint32_t seed = 4;
+    std::vector<XMFLOAT4X4> matrices(matrix_count), results(matrix_count);
+    for (auto& matrix : matrices)
+    {
+        XMMATRIX m = XMMatrixScaling(0.5f + Random(seed), 0.5f + Random(seed), 0.5f + Random(seed)) *
+            XMMatrixRotationRollPitchYaw(Random(seed) * 6.0f, Random(seed) * 6.0f, Random(seed) * 6.0f) *
+            XMMatrixTranslation(Random(seed) * 10.0f, Random(seed) * 10.0f, Random(seed) * 10.0f);
+        XMStoreFloat4x4(&matrix, m);
+    }
+
+    XMFLOAT4X4 view_proj;
+    XMStoreFloat4x4(&view_proj, XMMatrixLookAtLH(XMVectorSet(0.0f, 2.0f, -10.0f, 1.0f), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)) *
+        XMMatrixPerspectiveFovLH(0.8f, 16.0f / 9.0f, 0.1f, 100.0f));
+
+    double million = matrix_count / 1000.0;
+    double multiply_ms = D3D::Test::MeasureMilliseconds(200, [&]()
+    {
+        XMMATRIX b = XMLoadFloat4x4(&view_proj);
+        for (uint32_t i = 0; i < matrix_count; i++)
+        {
+            XMStoreFloat4x4(&results[i], XMMatrixMultiply(XMLoadFloat4x4(&matrices[i]), b));
+        }
+    });
+
+    double multiply_scalar_ms = D3D::Test::MeasureMilliseconds(200, [&]()
+    {
+        for (uint32_t i = 0; i < matrix_count; i++)
+        {
+            MultiplyScalar(matrices[i], view_proj, results[i]);
+        }
+    });
+
+    double inverse_ms = D3D::Test::MeasureMilliseconds(200, [&]()
+    {
+        for (uint32_t i = 0; i < matrix_count; i++)
+        {
+            XMStoreFloat4x4(&results[i], XMMatrixInverse(nullptr, XMLoadFloat4x4(&matrices[i])));
+        }
+    });
+
+    std::printf("%-16s %10.1f M/s   scalar %10.1f M/s\n", "multiply", million / multiply_ms, million / multiply_scalar_ms);
+    std::printf("%-16s %10.1f M/s\n", "inverse", million / inverse_ms);
+
+    for (uint32_t point_count : { 1000u, 100000u, 1000000u })
+    {
+        std::vector<XMFLOAT3> points(point_count), transformed(point_count);
+        for (auto& point : points)
+        {
+            point = XMFLOAT3(Random(seed) * 10.0f - 5.0f, Random(seed) * 10.0f - 5.0f, Random(seed) * 10.0f - 5.0f);
+        }
+
+        uint32_t repeat = (std::max)(20000000u / point_count, 5u);
+        double stream_ms = D3D::Test::MeasureMilliseconds(repeat, [&]()
+        {
+            XMVector3TransformCoordStream(transformed.data(), sizeof(XMFLOAT3), points.data(), sizeof(XMFLOAT3), point_count, XMLoadFloat4x4(&view_proj));
+        });
+
+        double scalar_ms = D3D::Test::MeasureMilliseconds(repeat, [&]()
+        {
+            for (uint32_t i = 0; i < point_count; i++)
+            {
+                TransformCoordScalar(points[i], view_proj, transformed[i]);
+            }
+        });
+
+        std::printf("transform %-7u %9.1f M/s   scalar %10.1f M/s\n", point_count, point_count / 1000.0 / stream_ms, point_count / 1000.0 / scalar_ms);
+    }
+
+    return 0;
+}
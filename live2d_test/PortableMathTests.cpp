@@ -0,0 +1,320 @@
+#include "PortableMath.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "D3DCamera.h"
+#include "TestHarness.h"
+
+using namespace DirectX;
+
+namespace
+{
+    float Random(uint32_t& seed)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / 16777216.0f;
+    }
+
+    typedef double Matrix[4][4];
+
+    void ToDouble(FXMMATRIX m, Matrix& result)
+    {
+        XMFLOAT4X4 values;
+        XMStoreFloat4x4(&values, m);
+        for (uint32_t row = 0; row < 4; row++)
+        {
+            for (uint32_t column = 0; column < 4; column++)
+            {
+                result[row][column] = values.m[row][column];
+            }
+        }
+    }
+
+    bool IsNear(FXMMATRIX m, const Matrix& expected, double tolerance)
+    {
+        Matrix values;
+        ToDouble(m, values);
+        bool near = true;
+        for (uint32_t row = 0; row < 4; row++)
+        {
+            for (uint32_t column = 0; column < 4; column++)
+            {
+                near = near && std::fabs(values[row][column] - expected[row][column]) <= tolerance * (1.0 + std::fabs(expected[row][column]));
+            }
+        }
+
+        return near;
+    }
+
+    bool IsNear(FXMMATRIX a, CXMMATRIX b, double tolerance)
+    {
+        Matrix expected;
+        ToDouble(b, expected);
+        return IsNear(a, expected, tolerance);
+    }
+
+    double MaxAbs(const Matrix& m)
+    {
+        double result = 0.0;
+        for (uint32_t row = 0; row < 4; row++)
+        {
+            for (uint32_t column = 0; column < 4; column++)
+            {
+                result = (std::max)(result, std::fabs(m[row][column]));
+            }
+        }
+
+        return result;
+    }
+
+    void Multiply(const Matrix& a, const Matrix& b, Matrix& result)
+    {
+        for (uint32_t row = 0; row < 4; row++)
+        {
+            for (uint32_t column = 0; column < 4; column++)
+            {
+                result[row][column] = 0.0;
+                for (uint32_t k = 0; k < 4; k++)
+                {
+                    result[row][column] += a[row][k] * b[k][column];
+                }
+            }
+        }
+    }
+
+    // Gauss-Jordan with partial pivoting in double, returns the determinant. The inverse of a
+    // singular matrix is garbage.
+    double InverseReference(const Matrix& m, Matrix& inverse)
+    {
+        double a[4][8];
+        for (uint32_t row = 0; row < 4; row++)
+        {
+            for (uint32_t column = 0; column < 4; column++)
+            {
+                a[row][column] = m[row][column];
+                a[row][column + 4] = row == column ? 1.0 : 0.0;
+            }
+        }
+
+        double determinant = 1.0;
+        for (uint32_t column = 0; column < 4; column++)
+        {
+            uint32_t pivot = column;
+            for (uint32_t row = column + 1; row < 4; row++)
+            {
+                pivot = std::fabs(a[row][column]) > std::fabs(a[pivot][column]) ? row : pivot;
+            }
+
+            if (pivot != column)
+            {
+                std::swap(a[pivot], a[column]);
+                determinant = -determinant;
+            }
+
+            determinant *= a[column][column];
+            if (a[column][column] == 0.0)
+            {
+                break;
+            }
+
+            double inv_pivot = 1.0 / a[column][column];
+            for (uint32_t k = 0; k < 8; k++)
+            {
+                a[column][k] *= inv_pivot;
+            }
+
+            for (uint32_t row = 0; row < 4; row++)
+            {
+                double factor = a[row][column];
+                if (row != column && factor != 0.0)
+                {
+                    for (uint32_t k = 0; k < 8; k++)
+                    {
+                        a[row][k] -= factor * a[column][k];
+                    }
+                }
+            }
+        }
+
+        for (uint32_t row = 0; row < 4; row++)
+        {
+            for (uint32_t column = 0; column < 4; column++)
+            {
+                inverse[row][column] = a[row][column + 4];
+            }
+        }
+
+        return determinant;
+    }
+
+    XMVECTOR RandomQuaternion(uint32_t& seed)
+    {
+        return XMQuaternionNormalize(XMVectorSet(Random(seed) - 0.5f, Random(seed) - 0.5f, Random(seed) - 0.5f, Random(seed) - 0.5f));
+    }
+
+    // Affine transforms, a projection times a view, and plain random matrices, against the
+    // double reference. The product with the original has to give the identity.
+    void TestInverse()
+    {
+        uint32_t seed = 5;
+        for (uint32_t i = 0; i < 300; i++)
+        {
+            XMMATRIX m;
+            if (i % 3 == 0)
+            {
+                m = XMMatrixScaling(0.2f + Random(seed) * 5.0f, 0.2f + Random(seed) * 5.0f, 0.2f + Random(seed) * 5.0f) *
+                    XMMatrixRotationQuaternion(RandomQuaternion(seed)) * XMMatrixTranslation(Random(seed) * 100.0f, Random(seed) * 100.0f, -Random(seed) * 100.0f);
+            }
+            else if (i % 3 == 1)
+            {
+                m = XMMatrixLookAtLH(XMVectorSet(Random(seed) * 10.0f, 5.0f, -20.0f, 1.0f), XMVectorSet(0.0f, Random(seed), 0.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)) *
+                    XMMatrixPerspectiveFovLH(0.5f + Random(seed), 16.0f / 9.0f, 0.1f + Random(seed), 1000.0f);
+            }
+            else
+            {
+                XMFLOAT4X4 values;
+                for (uint32_t k = 0; k < 16; k++)
+                {
+                    (&values._11)[k] = Random(seed) * 2.0f - 1.0f + (k % 5 == 0 ? 2.0f : 0.0f);
+                }
+
+                m = XMLoadFloat4x4(&values);
+            }
+
+            Matrix values, expected;
+            ToDouble(m, values);
+            double expected_determinant = InverseReference(values, expected);
+
+            XMVECTOR determinant;
+            XMMATRIX inverse = XMMatrixInverse(&determinant, m);
+            TEST_CHECK(std::fabs(XMVectorGetX(determinant) - expected_determinant) <= 1e-4 * std::fabs(expected_determinant));
+            TEST_CHECK(std::fabs(XMVectorGetX(XMMatrixDeterminant(m)) - expected_determinant) <= 1e-4 * std::fabs(expected_determinant));
+            TEST_CHECK(IsNear(inverse, expected, 1e-4));
+
+            // Float rounding of the product grows with the size of the entries, up to ~1000 for
+            // the projections.
+            TEST_CHECK(IsNear(m * inverse, XMMatrixIdentity(), 1e-6 * MaxAbs(values) * MaxAbs(expected)));
+        }
+
+        // Singular: two equal rows.
+        XMMATRIX singular(
+            1.0f, 2.0f, 3.0f, 4.0f,
+            5.0f, 6.0f, 7.0f, 8.0f,
+            1.0f, 2.0f, 3.0f, 4.0f,
+            0.0f, 1.0f, 0.0f, 1.0f);
+        TEST_CHECK(XMVectorGetX(XMMatrixDeterminant(singular)) == 0.0f);
+    }
+
+    // Roll about z first, then pitch about x, then yaw about y, as DirectXMath.
+    void TestRollPitchYaw()
+    {
+        uint32_t seed = 6;
+        for (uint32_t i = 0; i < 200; i++)
+        {
+            float pitch = (Random(seed) - 0.5f) * 7.0f;
+            float yaw = (Random(seed) - 0.5f) * 7.0f;
+            float roll = (Random(seed) - 0.5f) * 7.0f;
+
+            XMMATRIX expected = XMMatrixRotationZ(roll) * XMMatrixRotationX(pitch) * XMMatrixRotationY(yaw);
+            TEST_CHECK(IsNear(XMMatrixRotationRollPitchYaw(pitch, yaw, roll), expected, 1e-5));
+            TEST_CHECK(IsNear(XMMatrixRotationRollPitchYawFromVector(XMVectorSet(pitch, yaw, roll, 0.0f)), expected, 1e-5));
+
+            XMVECTOR q = XMQuaternionRotationRollPitchYaw(pitch, yaw, roll);
+            TEST_CHECK(std::fabs(XMVectorGetX(XMVector4Length(q)) - 1.0f) <= 1e-6f);
+        }
+
+        // A quarter turn of yaw takes +z to +x, of pitch +y to +z, of roll +x to +y.
+        const float quarter = XM_PI * 0.5f;
+        Matrix yaw = { { 0, 0, -1, 0 }, { 0, 1, 0, 0 }, { 1, 0, 0, 0 }, { 0, 0, 0, 1 } };
+        Matrix pitch = { { 1, 0, 0, 0 }, { 0, 0, 1, 0 }, { 0, -1, 0, 0 }, { 0, 0, 0, 1 } };
+        Matrix roll = { { 0, 1, 0, 0 }, { -1, 0, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, 0, 1 } };
+        TEST_CHECK(IsNear(XMMatrixRotationRollPitchYaw(0.0f, quarter, 0.0f), yaw, 1e-6));
+        TEST_CHECK(IsNear(XMMatrixRotationRollPitchYaw(quarter, 0.0f, 0.0f), pitch, 1e-6));
+        TEST_CHECK(IsNear(XMMatrixRotationRollPitchYaw(0.0f, 0.0f, quarter), roll, 1e-6));
+    }
+
+    // The Hamilton product b * a in double, and the rotation matrices composed in the same order.
+    void TestQuaternionMultiply()
+    {
+        uint32_t seed = 7;
+        for (uint32_t i = 0; i < 200; i++)
+        {
+            XMVECTOR a = RandomQuaternion(seed);
+            XMVECTOR b = RandomQuaternion(seed);
+            XMFLOAT4 qa, qb, product;
+            XMStoreFloat4(&qa, a);
+            XMStoreFloat4(&qb, b);
+            XMStoreFloat4(&product, XMQuaternionMultiply(a, b));
+
+            double x = static_cast<double>(qb.w) * qa.x + static_cast<double>(qb.x) * qa.w + static_cast<double>(qb.y) * qa.z - static_cast<double>(qb.z) * qa.y;
+            double y = static_cast<double>(qb.w) * qa.y - static_cast<double>(qb.x) * qa.z + static_cast<double>(qb.y) * qa.w + static_cast<double>(qb.z) * qa.x;
+            double z = static_cast<double>(qb.w) * qa.z + static_cast<double>(qb.x) * qa.y - static_cast<double>(qb.y) * qa.x + static_cast<double>(qb.z) * qa.w;
+            double w = static_cast<double>(qb.w) * qa.w - static_cast<double>(qb.x) * qa.x - static_cast<double>(qb.y) * qa.y - static_cast<double>(qb.z) * qa.z;
+            TEST_CHECK(std::fabs(product.x - x) <= 1e-6 && std::fabs(product.y - y) <= 1e-6 && std::fabs(product.z - z) <= 1e-6 && std::fabs(product.w - w) <= 1e-6);
+
+            XMMATRIX expected = XMMatrixRotationQuaternion(a) * XMMatrixRotationQuaternion(b);
+            TEST_CHECK(IsNear(XMMatrixRotationQuaternion(XMQuaternionMultiply(a, b)), expected, 1e-5));
+
+            // A rotation followed by its inverse is the identity.
+            XMFLOAT4 identity;
+            XMStoreFloat4(&identity, XMQuaternionMultiply(a, XMQuaternionConjugate(a)));
+            TEST_CHECK(std::fabs(identity.x) <= 1e-6f && std::fabs(identity.y) <= 1e-6f && std::fabs(identity.z) <= 1e-6f && std::fabs(identity.w - 1.0f) <= 1e-6f);
+        }
+    }
+
+    // The view matrix takes the eye to the origin and the focus onto +z, its rows are
+    // orthonormal with up in the y, z plane. Camera::LookAt builds the same matrix.
+    void TestLookAt()
+    {
+        uint32_t seed = 9;
+        for (uint32_t i = 0; i < 200; i++)
+        {
+            XMFLOAT3 eye(Random(seed) * 40.0f - 20.0f, Random(seed) * 40.0f - 20.0f, Random(seed) * 40.0f - 20.0f);
+            XMFLOAT3 focus(Random(seed) * 4.0f - 2.0f, Random(seed) * 4.0f - 2.0f, Random(seed) * 4.0f - 2.0f);
+            XMFLOAT3 up(0.0f, 1.0f, 0.0f);
+            XMVECTOR eye_position = XMLoadFloat3(&eye);
+            XMVECTOR focus_position = XMLoadFloat3(&focus);
+            XMVECTOR up_direction = XMLoadFloat3(&up);
+            XMMATRIX view = XMMatrixLookAtLH(eye_position, focus_position, up_direction);
+
+            float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(focus_position, eye_position)));
+            XMFLOAT3 eye_view, focus_view, up_view;
+            XMStoreFloat3(&eye_view, XMVector3TransformCoord(eye_position, view));
+            XMStoreFloat3(&focus_view, XMVector3TransformCoord(focus_position, view));
+            XMStoreFloat3(&up_view, XMVector3TransformNormal(up_direction, view));
+            TEST_CHECK(std::fabs(eye_view.x) <= 1e-4f && std::fabs(eye_view.y) <= 1e-4f && std::fabs(eye_view.z) <= 1e-4f);
+            TEST_CHECK(std::fabs(focus_view.x) <= 1e-4f && std::fabs(focus_view.y) <= 1e-4f && std::fabs(focus_view.z - distance) <= 1e-4f * distance);
+            TEST_CHECK(std::fabs(up_view.x) <= 1e-5f && up_view.y > 0.0f);
+
+            Matrix values, product;
+            ToDouble(view, values);
+            Matrix transposed;
+            for (uint32_t row = 0; row < 4; row++)
+            {
+                for (uint32_t column = 0; column < 4; column++)
+                {
+                    transposed[row][column] = row < 3 && column < 3 ? values[column][row] : (row == column ? 1.0 : 0.0);
+                    values[row][column] = row < 3 && column < 3 ? values[row][column] : (row == column ? 1.0 : 0.0);
+                }
+            }
+
+            Multiply(values, transposed, product);
+            TEST_CHECK(IsNear(XMMatrixIdentity(), product, 1e-5));
+
+            Camera camera;
+            camera.LookAt(eye, focus, up);
+            camera.UpdateViewMatrix();
+            TEST_CHECK(IsNear(camera.GetView(), view, 1e-4));
+        }
+    }
+}
+
+int main()
+{
+    TestInverse();
+    TestRollPitchYaw();
+    TestQuaternionMultiply();
+    TestLookAt();
+    return D3D::Test::Finish("PortableMathTests");
+}
@@ -0,0 +1,116 @@
+#include "RadixSort.h"
+
+#include <cstring>
+
+namespace D3D
+{
+    namespace
+    {
+        const uint32_t RADIX_BUCKETS = 256;
+
+        // Below this size an insertion sort beats the histogram passes.
+        const uint32_t INSERTION_SORT_THRESHOLD = 64;
+
+        template<typename TKey>
+        void InsertionSort(TKey* keys, uint32_t* values, uint32_t count)
+        {
+            for (uint32_t i = 1; i < count; i++)
+            {
+                TKey key = keys[i];
+                uint32_t value = values[i];
+
+                uint32_t j = i;
+                while (j > 0 && keys[j - 1] > key)
+                {
+                    keys[j] = keys[j - 1];
+                    values[j] = values[j - 1];
+                    j--;
+                }
+
+                keys[j] = key;
+                values[j] = value;
+            }
+        }
+    }
+
+    template<typename TKey>
+    void RadixSorter::SortImpl(TKey* keys, uint32_t* values, uint32_t count, std::vector<TKey>& key_scratch)
+    {
+        if (count < INSERTION_SORT_THRESHOLD)
+        {
+            InsertionSort(keys, values, count);
+            return;
+        }
+
+        const uint32_t PASS_COUNT = sizeof(TKey);
+
+        // All histograms come out of a single read of the keys.
+        histograms_.assign(RADIX_BUCKETS * PASS_COUNT, 0);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            TKey key = keys[i];
+            for (uint32_t pass = 0; pass < PASS_COUNT; pass++)
+            {
+                histograms_[pass * RADIX_BUCKETS + ((key >> (pass * 8)) & 0xff)]++;
+            }
+        }
+
+        key_scratch.resize(count);
+        value_scratch_.resize(count);
+
+        TKey* src_keys = keys;
+        uint32_t* src_values = values;
+        TKey* dst_keys = key_scratch.data();
+        uint32_t* dst_values = value_scratch_.data();
+
+        for (uint32_t pass = 0; pass < PASS_COUNT; pass++)
+        {
+            uint32_t* histogram = histograms_.data() + pass * RADIX_BUCKETS;
+            uint32_t first_byte = static_cast<uint32_t>(src_keys[0] >> (pass * 8)) & 0xff;
+            if (histogram[first_byte] == count)
+            {
+                continue;
+            }
+
+            uint32_t offset{ 0 };
+            for (uint32_t bucket = 0; bucket < RADIX_BUCKETS; bucket++)
+            {
+                uint32_t bucket_count = histogram[bucket];
+                histogram[bucket] = offset;
+                offset += bucket_count;
+            }
+
+            for (uint32_t i = 0; i < count; i++)
+            {
+                uint32_t bucket = static_cast<uint32_t>(src_keys[i] >> (pass * 8)) & 0xff;
+                uint32_t dst = histogram[bucket]++;
+                dst_keys[dst] = src_keys[i];
+                dst_values[dst] = src_values[i];
+            }
+
+            TKey* tmp_keys = src_keys;
+            src_keys = dst_keys;
+            dst_keys = tmp_keys;
+
+            uint32_t* tmp_values = src_values;
+            src_values = dst_values;
+            dst_values = tmp_values;
+        }
+
+        if (src_keys != keys)
+        {
+            ::memcpy(keys, src_keys, sizeof(TKey) * count);
+            ::memcpy(values, src_values, sizeof(uint32_t) * count);
+        }
+    }
+
+    void RadixSorter::Sort(uint64_t* keys, uint32_t* values, uint32_t count)
+    {
+        SortImpl(keys, values, count, key_scratch_64_);
+    }
+
+    void RadixSorter::Sort(uint32_t* keys, uint32_t* values, uint32_t count)
+    {
+        SortImpl(keys, values, count, key_scratch_32_);
+    }
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace D3D
+{
+    // Stable LSD radix sort of integer keys carrying a 32 bit payload, one byte per pass.
+    // Passes in which every key has the same byte are skipped, so keys that only use their low
+    // bits cost only as many passes as they need. Scratch memory is kept between calls.
+    class RadixSorter
+    {
+    public:
+        void Sort(uint64_t* keys, uint32_t* values, uint32_t count);
+        void Sort(uint32_t* keys, uint32_t* values, uint32_t count);
+
+    private:
+        template<typename TKey>
+        void SortImpl(TKey* keys, uint32_t* values, uint32_t count, std::vector<TKey>& key_scratch);
+
+        std::vector<uint64_t>                               key_scratch_64_;
+        std::vector<uint32_t>                               key_scratch_32_;
+        std::vector<uint32_t>                               value_scratch_;
+        std::vector<uint32_t>                               histograms_;
+    };
+};
@@ -0,0 +1,76 @@
+#include "RadixSort.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "TestHarness.h"
+
+using namespace D3D;
+
+namespace
+{
+    uint32_t Next(uint32_t& seed)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return seed;
+    }
+
+    // Sorts keys drawn by make_key with the radix sorter and with std::stable_sort on (key,
+    // value) pairs whose values are the positions they started at. Equal keys have to come out
+    // in their original order, so the values have to match exactly.
+    template<typename TKey, typename MakeKey>
+    bool MatchesStableSort(uint32_t count, RadixSorter& sorter, MakeKey make_key)
+    {
+        uint32_t seed = count + 1;
+        std::vector<TKey> keys(count);
+        std::vector<uint32_t> values(count);
+        std::vector<std::pair<TKey, uint32_t>> reference(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            keys[i] = make_key(seed);
+            values[i] = i;
+            reference[i] = std::make_pair(keys[i], i);
+        }
+
+        std::stable_sort(reference.begin(), reference.end(), [](const std::pair<TKey, uint32_t>& a, const std::pair<TKey, uint32_t>& b)
+        {
+            return a.first < b.first;
+        });
+
+        sorter.Sort(keys.data(), values.data(), count);
+
+        bool same = true;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            same = same && keys[i] == reference[i].first && values[i] == reference[i].second;
+        }
+
+        return same;
+    }
+
+    // Counts on both sides of the insertion sort threshold, few distinct keys so that most
+    // keys repeat, and keys that differ only in their low bytes, only in their high bytes, or
+    // not at all, which skips passes.
+    void TestMatchesStableSort()
+    {
+        RadixSorter sorter;
+        for (uint32_t count : { 0u, 1u, 2u, 63u, 64u, 65u, 1000u, 100000u })
+        {
+            TEST_CHECK(MatchesStableSort<uint32_t>(count, sorter, [](uint32_t& seed) { return Next(seed) % 7; }));
+            TEST_CHECK(MatchesStableSort<uint32_t>(count, sorter, [](uint32_t& seed) { return Next(seed) & 0xff000000u; }));
+            TEST_CHECK(MatchesStableSort<uint32_t>(count, sorter, [](uint32_t& seed) { return Next(seed) >> 12; }));
+            TEST_CHECK(MatchesStableSort<uint32_t>(count, sorter, [](uint32_t&) { return 42u; }));
+
+            TEST_CHECK(MatchesStableSort<uint64_t>(count, sorter, [](uint32_t& seed) { return static_cast<uint64_t>(Next(seed) % 5) << 32 | Next(seed) % 3; }));
+            TEST_CHECK(MatchesStableSort<uint64_t>(count, sorter, [](uint32_t& seed) { return static_cast<uint64_t>(Next(seed) >> 16) << 40; }));
+            TEST_CHECK(MatchesStableSort<uint64_t>(count, sorter, [](uint32_t& seed) { return static_cast<uint64_t>(Next(seed)) << 32 | Next(seed); }));
+            TEST_CHECK(MatchesStableSort<uint64_t>(count, sorter, [](uint32_t&) { return ~0ull; }));
+        }
+    }
+}
+
+int main()
+{
+    TestMatchesStableSort();
+    return D3D::Test::Finish("RadixSortTests");
+}
@@ -0,0 +1,160 @@
+#include "RenderQueue.h"
+
+#include <cassert>
+
+#include "TaskScheduler.h"
+
+namespace D3D
+{
+    namespace
+    {
+        const uint32_t BLEND_MODE_BITS = 2;
+
+        // Parts whose indices are rebased per task.
+        const uint32_t PART_GRAIN_SIZE = 256;
+
+        // Flips the sign bit so negative draw orders sort before positive ones.
+        inline uint64_t MakeSortKey(int32_t draw_order, uint32_t material_id)
+        {
+            return (static_cast<uint64_t>(static_cast<uint32_t>(draw_order) ^ 0x80000000u) << 32) | material_id;
+        }
+    }
+
+    uint32_t RenderQueue::MakeMaterialKey(uint32_t texture_id, PartBlendMode blend_mode)
+    {
+        assert(texture_id < (1u << (32 - BLEND_MODE_BITS)));
+        return (texture_id << BLEND_MODE_BITS) | static_cast<uint32_t>(blend_mode);
+    }
+
+    void RenderQueue::Clear()
+    {
+        parts_.clear();
+        keys_.clear();
+        part_order_.clear();
+        indices_.clear();
+        batches_.clear();
+    }
+
+    void RenderQueue::Reserve(uint32_t part_count, uint32_t index_count)
+    {
+        parts_.reserve(part_count);
+        keys_.reserve(part_count);
+        part_order_.reserve(part_count);
+        indices_.reserve(index_count);
+    }
+
+    void RenderQueue::AddPart(const RenderPart& part)
+    {
+        keys_.push_back(MakeSortKey(part.draw_order, part.material_id));
+        part_order_.push_back(GetPartCount());
+        parts_.push_back(part);
+    }
+
+    void RenderQueue::Build(TaskScheduler* scheduler)
+    {
+        batches_.clear();
+        indices_.clear();
+
+        uint32_t count = GetPartCount();
+        if (count == 0)
+        {
+            return;
+        }
+
+        sorter_.Sort(keys_.data(), part_order_.data(), count);
+
+        // Batches and index offsets first, the indices themselves are independent per part.
+        index_offsets_.resize(count);
+        uint32_t index_count = 0;
+
+        RenderBatch batch;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const RenderPart& part = parts_[part_order_[i]];
+            index_offsets_[i] = index_count;
+            if (!IsVisible(part))
+            {
+                continue;
+            }
+
+            if (batch.part_count == 0 || batch.material_id != part.material_id || batch.opacity != part.opacity)
+            {
+                if (batch.part_count != 0)
+                {
+                    batches_.push_back(batch);
+                }
+
+                batch.material_id = part.material_id;
+                batch.opacity = part.opacity;
+                batch.first_index = index_count;
+                batch.index_count = 0;
+                batch.first_part = i;
+            }
+
+            index_count += part.index_count;
+            batch.index_count += part.index_count;
+            batch.part_count = i - batch.first_part + 1;
+        }
+
+        if (batch.part_count != 0)
+        {
+            batches_.push_back(batch);
+        }
+
+        indices_.resize(index_count);
+        if (scheduler != nullptr && count > PART_GRAIN_SIZE)
+        {
+            scheduler->ParallelFor(count, PART_GRAIN_SIZE, [this](uint32_t begin, uint32_t end)
+            {
+                WriteIndices(begin, end);
+            });
+        }
+        else
+        {
+            WriteIndices(0, count);
+        }
+    }
+
+    uint32_t RenderQueue::GetPartCount() const
+    {
+        return static_cast<uint32_t>(parts_.size());
+    }
+
+    const std::vector<RenderBatch>& RenderQueue::GetBatches() const
+    {
+        return batches_;
+    }
+
+    const std::vector<uint32_t>& RenderQueue::GetPartOrder() const
+    {
+        return part_order_;
+    }
+
+    const std::vector<uint32_t>& RenderQueue::GetIndices() const
+    {
+        return indices_;
+    }
+
+    bool RenderQueue::IsVisible(const RenderPart& part) const
+    {
+        return part.index_count != 0 && part.opacity > 0.0f;
+    }
+
+    void RenderQueue::WriteIndices(uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            const RenderPart& part = parts_[part_order_[i]];
+            if (!IsVisible(part))
+            {
+                continue;
+            }
+
+            uint32_t* destination = indices_.data() + index_offsets_[i];
+            for (uint32_t j = 0; j < part.index_count; j++)
+            {
+                destination[j] = part.base_vertex + part.indices[j];
+            }
+        }
+    }
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "RadixSort.h"
+
+namespace D3D
+{
+    class TaskScheduler;
+
+    // Blend modes of Live2D art meshes, all with premultiplied alpha. Normal is
+    // TransparentBlendDesc(ONE, INV_SRC_ALPHA), additive (ONE, ONE) and multiply
+    // (DEST_COLOR, INV_SRC_ALPHA).
+    enum PartBlendMode
+    {
+        kPartBlendNormal,
+        kPartBlendAdditive,
+        kPartBlendMultiply,
+    };
+
+    struct RenderPart
+    {
+        int32_t draw_order = 0;                             // back to front
+        uint32_t material_id = 0;                           // see MakeMaterialKey
+        float opacity = 1.0f;
+        uint32_t base_vertex = 0;                           // of the part in the shared vertex buffer
+        const uint16_t* indices = nullptr;                  // relative to base_vertex, kept until Build
+        uint32_t index_count = 0;
+    };
+
+    // One draw over GetIndices(), with the material and opacity of all of its parts.
+    struct RenderBatch
+    {
+        uint32_t material_id = 0;
+        float opacity = 1.0f;
+        uint32_t first_index = 0;
+        uint32_t index_count = 0;
+        uint32_t first_part = 0;                            // into GetPartOrder()
+        uint32_t part_count = 0;
+    };
+
+    // Builds the draws for layered, alpha blended 2D parts whose draw order changes every frame.
+    // Parts are stable radix sorted by (draw order, material), so parts with the same draw order
+    // keep the order they were added in, then runs of neighbours that share a material and an
+    // opacity are merged into one draw. Their indices are rebased onto the shared vertex buffer
+    // and written to a single dynamic 32 bit index range. Parts are never reordered across draw
+    // orders, so blending stays correct, only equal draw orders are grouped by material.
+    class RenderQueue
+    {
+    public:
+        static uint32_t MakeMaterialKey(uint32_t texture_id, PartBlendMode blend_mode);
+
+        void Clear();
+        void Reserve(uint32_t part_count, uint32_t index_count);
+        void AddPart(const RenderPart& part);
+
+        // Rebasing the indices is spread across the scheduler when one is given.
+        void Build(TaskScheduler* scheduler = nullptr);
+
+        uint32_t GetPartCount() const;
+        const std::vector<RenderBatch>& GetBatches() const;
+
+        // Part indices in draw order.
+        const std::vector<uint32_t>& GetPartOrder() const;
+
+        // Rebased indices of all batches, to be uploaded once per frame.
+        const std::vector<uint32_t>& GetIndices() const;
+
+    private:
+        bool IsVisible(const RenderPart& part) const;
+        void WriteIndices(uint32_t begin, uint32_t end);
+
+        std::vector<RenderPart>                             parts_;
+        std::vector<uint64_t>                               keys_;
+        std::vector<uint32_t>                               part_order_;
+        std::vector<uint32_t>                               index_offsets_; // by draw position
+        std::vector<uint32_t>                               indices_;
+        std::vector<RenderBatch>                            batches_;
+        RadixSorter                                         sorter_;
+    };
+};
@@ -0,0 +1,93 @@
+#include "RenderQueue.h"
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "TaskScheduler.h"
+#include "TestHarness.h"
+
+using namespace D3D;
+
+namespace
+{
+    float Random(uint32_t& seed)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / 16777216.0f;
+    }
+}
+
+// Milliseconds per frame to queue and Build the draws of layered parts of 60 indices each,
+// 5000 being a screen full of characters. Every frame draw orders change, as a motion
+// reorders the parts. Most parts share one texture and the normal blend mode, the rest use
+// 7 more textures and the other two blend modes. Worker count 0 builds without a scheduler.
+int main()
+{
+    const uint32_t worker_counts[] = { 0, 1, 2, 4, 8 };
+    std::printf("%-8s %8s", "parts", "batches");
+    for (uint32_t worker_count : worker_counts)
+    {
+        std::printf(" %8u w", worker_count);
+    }
+
+    std::printf("\n");
+
+    const uint32_t index_count = 60;
+    std::vector<uint16_t> indices(index_count);
+    for (uint32_t i = 0; i < index_count; i++)
+    {
+        indices[i] = static_cast<uint16_t>(i % 32);
+    }
+
+    for (uint32_t part_count : { 1000u, 5000u, 20000u })
+    {
+        uint32_t seed = 3;
+        std::vector<RenderPart> parts(part_count);
+        for (uint32_t i = 0; i < part_count; i++)
+        {
+            uint32_t texture_id = Random(seed) < 0.8f ? 0 : static_cast<uint32_t>(Random(seed) * 8.0f);
+            parts[i].material_id = RenderQueue::MakeMaterialKey(texture_id, static_cast<PartBlendMode>(i % 7 == 0 ? i % 3 : 0));
+            parts[i].opacity = Random(seed) < 0.05f ? 0.5f : 1.0f;
+            parts[i].base_vertex = i * 32;
+            parts[i].indices = indices.data();
+            parts[i].index_count = index_count;
+        }
+
+        RenderQueue queue;
+        queue.Reserve(part_count, part_count * index_count);
+
+        uint32_t frame = 0;
+        auto run_frame = [&](TaskScheduler* scheduler)
+        {
+            queue.Clear();
+            for (uint32_t i = 0; i < part_count; i++)
+            {
+                parts[i].draw_order = static_cast<int32_t>((i * 37 + frame * 11) % 1000) - 500;
+                queue.AddPart(parts[i]);
+            }
+
+            queue.Build(scheduler);
+            frame++;
+        };
+
+        run_frame(nullptr);
+        std::printf("%-8u %8u", part_count, static_cast<uint32_t>(queue.GetBatches().size()));
+
+        for (uint32_t worker_count : worker_counts)
+        {
+            std::unique_ptr<TaskScheduler> scheduler;
+            if (worker_count > 0)
+            {
+                scheduler.reset(new TaskScheduler(worker_count));
+            }
+
+            double ms = D3D::Test::MeasureMilliseconds(50, [&]() { run_frame(scheduler.get()); });
+            std::printf(" %10.3f", ms);
+        }
+
+        std::printf("\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,293 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <climits>
+#include <vector>
+
+#include "TaskScheduler.h"
+#include "TestHarness.h"
+
+using namespace D3D;
+
+namespace
+{
+    float Random(uint32_t& seed)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / 16777216.0f;
+    }
+
+    // Parts and the index data they point at, which has to outlive the queue's Build.
+    struct Scene
+    {
+        std::vector<RenderPart> parts;
+        std::vector<std::vector<uint16_t>> indices;
+
+        void Add(int32_t draw_order, uint32_t material_id, float opacity, uint32_t index_count, uint32_t base_vertex)
+        {
+            std::vector<uint16_t> part_indices;
+            for (uint32_t i = 0; i < index_count; i++)
+            {
+                part_indices.push_back(static_cast<uint16_t>((i * 7 + parts.size()) % 300));
+            }
+
+            indices.push_back(part_indices);
+
+            RenderPart part;
+            part.draw_order = draw_order;
+            part.material_id = material_id;
+            part.opacity = opacity;
+            part.base_vertex = base_vertex;
+            part.index_count = index_count;
+            parts.push_back(part);
+        }
+
+        void Build(RenderQueue& queue, TaskScheduler* scheduler = nullptr)
+        {
+            queue.Clear();
+            for (size_t i = 0; i < parts.size(); i++)
+            {
+                RenderPart part = parts[i];
+                part.indices = indices[i].data();
+                queue.AddPart(part);
+            }
+
+            queue.Build(scheduler);
+        }
+    };
+
+    // Every field of every batch, in order.
+    bool IsSameBatches(const std::vector<RenderBatch>& a, const std::vector<RenderBatch>& b)
+    {
+        bool same = a.size() == b.size();
+        for (size_t i = 0; i < a.size() && same; i++)
+        {
+            same = a[i].material_id == b[i].material_id && a[i].opacity == b[i].opacity && a[i].first_index == b[i].first_index &&
+                a[i].index_count == b[i].index_count && a[i].first_part == b[i].first_part && a[i].part_count == b[i].part_count;
+        }
+
+        return same;
+    }
+
+    // The queue's result the plain way: std::stable_sort by draw order then material, runs of
+    // visible neighbours with the same material and opacity merged, hidden parts skipped
+    // without ending a run, and the indices written part by part with the base vertex added.
+    void BuildReference(const Scene& scene, std::vector<uint32_t>& order, std::vector<RenderBatch>& batches, std::vector<uint32_t>& indices)
+    {
+        uint32_t count = static_cast<uint32_t>(scene.parts.size());
+        order.resize(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            order[i] = i;
+        }
+
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+        {
+            const RenderPart& pa = scene.parts[a];
+            const RenderPart& pb = scene.parts[b];
+            return pa.draw_order != pb.draw_order ? pa.draw_order < pb.draw_order : pa.material_id < pb.material_id;
+        });
+
+        batches.clear();
+        indices.clear();
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const RenderPart& part = scene.parts[order[i]];
+            if (part.index_count == 0 || part.opacity <= 0.0f)
+            {
+                continue;
+            }
+
+            if (batches.empty() || batches.back().material_id != part.material_id || batches.back().opacity != part.opacity)
+            {
+                RenderBatch batch;
+                batch.material_id = part.material_id;
+                batch.opacity = part.opacity;
+                batch.first_index = static_cast<uint32_t>(indices.size());
+                batch.first_part = i;
+                batches.push_back(batch);
+            }
+
+            RenderBatch& batch = batches.back();
+            batch.index_count += part.index_count;
+            batch.part_count = i - batch.first_part + 1;
+            for (uint16_t index : scene.indices[order[i]])
+            {
+                indices.push_back(part.base_vertex + index);
+            }
+        }
+    }
+
+    void CheckAgainstReference(const Scene& scene, const RenderQueue& queue)
+    {
+        std::vector<uint32_t> order, indices;
+        std::vector<RenderBatch> batches;
+        BuildReference(scene, order, batches, indices);
+
+        TEST_CHECK(queue.GetPartCount() == scene.parts.size());
+        TEST_CHECK(queue.GetPartOrder() == order);
+        TEST_CHECK(IsSameBatches(queue.GetBatches(), batches));
+        TEST_CHECK(queue.GetIndices() == indices);
+    }
+
+    // Few draw orders and materials so that most keys repeat, both below and above the
+    // insertion sort threshold of the radix sorter.
+    void TestStableOrder()
+    {
+        for (uint32_t count : { 10u, 63u, 64u, 1000u })
+        {
+            uint32_t seed = count;
+            Scene scene;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                int32_t draw_order = static_cast<int32_t>(Random(seed) * 6.0f) * 100;
+                uint32_t material_id = RenderQueue::MakeMaterialKey(static_cast<uint32_t>(Random(seed) * 3.0f), kPartBlendNormal);
+                scene.Add(draw_order, material_id, 1.0f, 3, i * 4);
+            }
+
+            RenderQueue queue;
+            scene.Build(queue);
+            CheckAgainstReference(scene, queue);
+
+            // Within equal keys the parts stay in the order they were added.
+            const std::vector<uint32_t>& order = queue.GetPartOrder();
+            bool stable = true;
+            for (uint32_t i = 1; i < count; i++)
+            {
+                const RenderPart& a = scene.parts[order[i - 1]];
+                const RenderPart& b = scene.parts[order[i]];
+                if (a.draw_order == b.draw_order && a.material_id == b.material_id)
+                {
+                    stable = stable && order[i - 1] < order[i];
+                }
+            }
+
+            TEST_CHECK(stable);
+        }
+    }
+
+    void TestNegativeDrawOrders()
+    {
+        const int32_t draw_orders[] = { 5, -1, INT_MAX, 0, -1000, INT_MIN, 1, -2 };
+        const uint32_t expected[] = { 5, 4, 7, 1, 3, 6, 0, 2 };
+
+        Scene scene;
+        for (int32_t draw_order : draw_orders)
+        {
+            scene.Add(draw_order, 0, 1.0f, 3, 0);
+        }
+
+        RenderQueue queue;
+        scene.Build(queue);
+        TEST_CHECK(std::equal(queue.GetPartOrder().begin(), queue.GetPartOrder().end(), expected));
+        CheckAgainstReference(scene, queue);
+
+        // The same above the insertion sort threshold.
+        for (uint32_t i = 0; i < 100; i++)
+        {
+            scene.Add(static_cast<int32_t>(i % 7) - 3, 0, 1.0f, 3, 0);
+        }
+
+        scene.Build(queue);
+        CheckAgainstReference(scene, queue);
+    }
+
+    void TestBatchBoundaries()
+    {
+        uint32_t texture_a = RenderQueue::MakeMaterialKey(1, kPartBlendNormal);
+        uint32_t texture_b = RenderQueue::MakeMaterialKey(2, kPartBlendNormal);
+        uint32_t additive_a = RenderQueue::MakeMaterialKey(1, kPartBlendAdditive);
+        TEST_CHECK(texture_a != additive_a);
+
+        Scene scene;
+        scene.Add(0, texture_a, 1.0f, 3, 0);             // batch 0
+        scene.Add(1, texture_a, 1.0f, 6, 10);            // batch 0, merged across draw orders
+        scene.Add(2, texture_a, 0.0f, 3, 20);            // hidden, batch 0 goes on
+        scene.Add(3, texture_a, 1.0f, 0, 30);            // empty, batch 0 goes on
+        scene.Add(4, texture_a, 1.0f, 3, 40);            // batch 0
+        scene.Add(5, additive_a, 1.0f, 3, 50);           // batch 1, blend mode changed
+        scene.Add(6, texture_a, 1.0f, 3, 60);            // batch 2
+        scene.Add(7, texture_a, 0.5f, 3, 70);            // batch 3, opacity changed
+        scene.Add(8, texture_b, 0.5f, 3, 80);            // batch 4, texture changed
+        scene.Add(9, texture_a, 0.5f, 3, 90);            // batch 5, not merged with batch 3
+
+        RenderQueue queue;
+        scene.Build(queue);
+        CheckAgainstReference(scene, queue);
+
+        const std::vector<RenderBatch>& batches = queue.GetBatches();
+        TEST_CHECK(batches.size() == 6);
+        if (batches.size() == 6)
+        {
+            TEST_CHECK(batches[0].first_part == 0 && batches[0].part_count == 5 && batches[0].index_count == 12);
+            TEST_CHECK(batches[1].material_id == additive_a && batches[1].first_index == 12);
+            TEST_CHECK(batches[3].opacity == 0.5f && batches[3].material_id == texture_a);
+            TEST_CHECK(batches[5].first_part == 9 && batches[5].first_index == 24 && batches[5].index_count == 3);
+        }
+
+        TEST_CHECK(queue.GetIndices().size() == 27);
+    }
+
+    void TestRebasedIndices()
+    {
+        Scene scene;
+        scene.Add(1, 0, 1.0f, 6, 1000);
+        scene.Add(0, 0, 1.0f, 3, 70000);
+
+        RenderQueue queue;
+        scene.Build(queue);
+        CheckAgainstReference(scene, queue);
+
+        // Drawn second part first, its 16 bit indices land past 65535.
+        const std::vector<uint32_t>& indices = queue.GetIndices();
+        TEST_CHECK(indices.size() == 9);
+        if (indices.size() == 9)
+        {
+            TEST_CHECK(indices[0] == 70000u + scene.indices[1][0] && indices[2] == 70000u + scene.indices[1][2]);
+            TEST_CHECK(indices[3] == 1000u + scene.indices[0][0] && indices[8] == 1000u + scene.indices[0][5]);
+        }
+
+        // A queue used again after Clear keeps nothing of the previous frame.
+        queue.Clear();
+        TEST_CHECK(queue.GetPartCount() == 0);
+        queue.Build();
+        TEST_CHECK(queue.GetBatches().empty() && queue.GetIndices().empty());
+    }
+
+    void TestScheduler()
+    {
+        uint32_t seed = 5;
+        Scene scene;
+        for (uint32_t i = 0; i < 5000; i++)
+        {
+            int32_t draw_order = static_cast<int32_t>(Random(seed) * 400.0f) - 200;
+            uint32_t material_id = RenderQueue::MakeMaterialKey(static_cast<uint32_t>(Random(seed) * 4.0f), static_cast<PartBlendMode>(i % 3));
+            float opacity = Random(seed) < 0.1f ? 0.0f : (Random(seed) < 0.5f ? 1.0f : 0.5f);
+            scene.Add(draw_order, material_id, opacity, 3 * static_cast<uint32_t>(Random(seed) * 20.0f), i * 50);
+        }
+
+        RenderQueue serial;
+        scene.Build(serial);
+        CheckAgainstReference(scene, serial);
+
+        for (uint32_t worker_count : { 1u, 4u, 8u })
+        {
+            TaskScheduler scheduler(worker_count);
+            RenderQueue threaded;
+            scene.Build(threaded, &scheduler);
+            TEST_CHECK(threaded.GetPartOrder() == serial.GetPartOrder());
+            TEST_CHECK(IsSameBatches(threaded.GetBatches(), serial.GetBatches()));
+            TEST_CHECK(threaded.GetIndices() == serial.GetIndices());
+        }
+    }
+}
+
+int main()
+{
+    TestStableOrder();
+    TestNegativeDrawOrders();
+    TestBatchBoundaries();
+    TestRebasedIndices();
+    TestScheduler();
+    return D3D::Test::Finish("RenderQueueTests");
+}
@@ -11,12 +11,12 @@ cbuffer VS_MatrixBuffer : register(b0)
     float4x4 TEX_TRANSFORM;
 };
 
-VertexOut VS_Main(VertexIn vin)
+VertexOut VS_Main(VertexIn vin, InstanceIn iin)
 {
 	VertexOut vout;
 
-    vout.PosW = mul(float4(vin.PosL, 1.0f), MODEL_MAT).xyz;
-    vout.NormalW = mul(vin.NormalL, (float3x3) MODEL_MAT);
+    vout.PosW = mul(float4(vin.PosL, 1.0f), iin.ModelMat).xyz;
+    vout.NormalW = mul(vin.NormalL, (float3x3) iin.ModelMat);
     vout.PosH = mul(float4(vout.PosW, 1.0f), VIEW_PROJ_MAT);
     vout.TexC = mul(float4(vin.TexC, 0.0f, 1.0f), TEX_TRANSFORM);
 
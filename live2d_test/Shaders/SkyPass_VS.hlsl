@@ -1,5 +1,11 @@
 #include "CommonDefine.hlsi"
 
+// Only the position stream is bound for the sky.
+struct SkyPassVertexIn
+{
+    float3 PosL : POSITION;
+};
+
 struct SkyPassVertexOut
 {
     float4 sv_position : SV_POSITION;
@@ -11,7 +17,7 @@ cbuffer VS_MatrixBuffer : register(b0)
     float4x4 VIEW_MAT;
 };
 
-SkyPassVertexOut VS_Main(VertexIn vin)
+SkyPassVertexOut VS_Main(SkyPassVertexIn vin)
 {
     SkyPassVertexOut vo = (SkyPassVertexOut) 0.0f;
     vo.sv_position = mul(float4(vin.PosL, 0.0f), VIEW_MAT).xyww;
@@ -5,6 +5,10 @@ cbuffer LightConstBuffer : register(b1)
 {
     uint DIRECTIONAL_LIGHT_NUM;
     uint POINT_LIGHT_NUM;
+    uint2 CLUSTER_TILE_SIZE;        // pixels covered by one cluster tile
+    uint3 CLUSTER_DIM;              // tiles x, tiles y, depth slices
+    float CLUSTER_Z_SCALE;          // slice = log(view z) * scale + bias
+    float CLUSTER_Z_BIAS;
 };
 
 StructuredBuffer<DirectionalLight> DIRECTIONAL_LIGHT_BUFFER : register(t0);
@@ -13,6 +17,18 @@ StructuredBuffer<OrgePointLight> POINT_LIGHT_BUFFER : register(t1);
 Texture2D TEXTURE : register(t2);
 SamplerState SAMPLER : register(s0);
 
+StructuredBuffer<uint2> LIGHT_CLUSTER_BUFFER : register(t3);     // (offset, count) into LIGHT_INDEX_BUFFER
+StructuredBuffer<uint> LIGHT_INDEX_BUFFER : register(t4);
+
+uint2 GetLightCluster(float4 pos_h)
+{
+    // SV_POSITION.w holds the view space depth.
+    float slice = log(pos_h.w) * CLUSTER_Z_SCALE + CLUSTER_Z_BIAS;
+    uint cluster_z = (uint)clamp(slice, 0.0f, CLUSTER_DIM.z - 1.0f);
+    uint2 cluster_xy = min((uint2)pos_h.xy / CLUSTER_TILE_SIZE, CLUSTER_DIM.xy - 1);
+    return LIGHT_CLUSTER_BUFFER[(cluster_z * CLUSTER_DIM.y + cluster_xy.y) * CLUSTER_DIM.x + cluster_xy.x];
+}
+
 float4 PS_Main(VertexOut pin) : SV_Target
 {
     float3 text_color = TEXTURE.Sample(SAMPLER, pin.TexC);
@@ -24,6 +40,17 @@ float4 PS_Main(VertexOut pin) : SV_Target
         out_color += text_color * dir_color;
     }
 
+    uint2 cluster = GetLightCluster(pin.PosH);
+    for (uint j = 0; j < cluster.y; j++)
+    {
+        OrgePointLight point_light = POINT_LIGHT_BUFFER[LIGHT_INDEX_BUFFER[cluster.x + j]];
+        float3 to_light = point_light.position - pin.PosW;
+        float distance = length(to_light);
+        float attenuation = 1.0f / (point_light.k_const + point_light.k_linear * distance + point_light.quadratic * distance * distance);
+        float point_coe = max(dot(normalize(pin.NormalW), to_light / distance), 0.0f);
+        out_color += text_color * point_light.color * point_coe * attenuation;
+    }
+
     return float4(out_color, 1.0f);
 }
 
@@ -0,0 +1,476 @@
+#pragma once
+
+// Thin SIMD wrappers used by the CPU batch kernels. Float4 is SSE on x86/x64, NEON on ARM and
+// plain arrays everywhere else, so the kernels also build on machines without DirectXMath.
+// Float8 is one __m256 when the build targets AVX (/arch:AVX2, -mavx2) and two Float4 halves
+// otherwise. FMA is used on both when the build targets it. Defining SIMD_MATH_FORCE_SCALAR
+// picks the plain array backend on any machine, for comparisons.
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(SIMD_MATH_FORCE_SCALAR)
+    #define SIMD_MATH_SCALAR 1
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+    #define SIMD_MATH_SSE 1
+    #include <emmintrin.h>
+    #if defined(__AVX__)
+        #define SIMD_MATH_AVX 1
+        #include <immintrin.h>
+    #endif
+    #if defined(__FMA__) || (defined(_MSC_VER) && defined(__AVX2__))
+        #define SIMD_MATH_FMA 1
+        #include <immintrin.h>
+    #endif
+    #if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+        #define SIMD_MATH_F16C 1
+        #include <immintrin.h>
+    #endif
+#elif defined(_M_ARM64) || defined(__ARM_NEON)
+    #define SIMD_MATH_NEON 1
+    #include <arm_neon.h>
+#else
+    #define SIMD_MATH_SCALAR 1
+#endif
+
+namespace D3D
+{
+    namespace Simd
+    {
+#if defined(SIMD_MATH_SSE)
+        using Float4 = __m128;
+
+        inline Float4 Load(const float* p) { return _mm_loadu_ps(p); }
+        inline void Store(float* p, Float4 v) { _mm_storeu_ps(p, v); }
+        inline Float4 Set1(float v) { return _mm_set1_ps(v); }
+        inline Float4 Set(float x, float y, float z, float w) { return _mm_setr_ps(x, y, z, w); }
+        inline Float4 Zero() { return _mm_setzero_ps(); }
+
+        inline Float4 Add(Float4 a, Float4 b) { return _mm_add_ps(a, b); }
+        inline Float4 Sub(Float4 a, Float4 b) { return _mm_sub_ps(a, b); }
+        inline Float4 Mul(Float4 a, Float4 b) { return _mm_mul_ps(a, b); }
+        inline Float4 Div(Float4 a, Float4 b) { return _mm_div_ps(a, b); }
+#if defined(SIMD_MATH_FMA)
+        inline Float4 MulAdd(Float4 a, Float4 b, Float4 c) { return _mm_fmadd_ps(a, b, c); }
+#else
+        inline Float4 MulAdd(Float4 a, Float4 b, Float4 c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+#endif
+        inline Float4 Min(Float4 a, Float4 b) { return _mm_min_ps(a, b); }
+        inline Float4 Max(Float4 a, Float4 b) { return _mm_max_ps(a, b); }
+        inline Float4 Sqrt(Float4 a) { return _mm_sqrt_ps(a); }
+
+        inline Float4 CmpLt(Float4 a, Float4 b) { return _mm_cmplt_ps(a, b); }
+        inline Float4 CmpLe(Float4 a, Float4 b) { return _mm_cmple_ps(a, b); }
+        inline Float4 CmpGt(Float4 a, Float4 b) { return _mm_cmpgt_ps(a, b); }
+        inline Float4 CmpGe(Float4 a, Float4 b) { return _mm_cmpge_ps(a, b); }
+        inline Float4 And(Float4 a, Float4 b) { return _mm_and_ps(a, b); }
+        inline Float4 Or(Float4 a, Float4 b) { return _mm_or_ps(a, b); }
+        inline Float4 Select(Float4 mask, Float4 a, Float4 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+        inline uint32_t MoveMask(Float4 mask) { return static_cast<uint32_t>(_mm_movemask_ps(mask)); }
+        inline void Transpose(Float4& a, Float4& b, Float4& c, Float4& d) { _MM_TRANSPOSE4_PS(a, b, c, d); }
+
+        inline float GetX(Float4 v) { return _mm_cvtss_f32(v); }
+
+        // Non-temporal store for write-combined upload memory, p must be 16 byte aligned. Call
+        // StreamFence before the data is handed to another thread or the GPU.
+        inline void StoreStream(float* p, Float4 v) { _mm_stream_ps(p, v); }
+        inline void StreamFence() { _mm_sfence(); }
+
+        // (a[X], a[Y], b[Z], b[W]), the lane order of _mm_shuffle_ps.
+        template<uint32_t X, uint32_t Y, uint32_t Z, uint32_t W>
+        inline Float4 Shuffle(Float4 a, Float4 b) { return _mm_shuffle_ps(a, b, _MM_SHUFFLE(W, Z, Y, X)); }
+
+        // Four 16 bit integers, rounded to nearest and saturated on the way out.
+        inline Float4 LoadInt16(const int16_t* p)
+        {
+            __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+            return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+        }
+
+        inline void StoreInt16(int16_t* p, Float4 v)
+        {
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_packs_epi32(_mm_cvtps_epi32(v), _mm_setzero_si128()));
+        }
+
+        // Four IEEE half floats, rounded to nearest even. Without F16C the conversions are
+        // done on the bits, overflow goes to infinity and NaNs stay NaNs.
+#if defined(SIMD_MATH_F16C)
+        inline Float4 LoadHalf(const uint16_t* p) { return _mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))); }
+        inline void StoreHalf(uint16_t* p, Float4 v) { _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT)); }
+#else
+        inline Float4 LoadHalf(const uint16_t* p)
+        {
+            __m128i h = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)), _mm_setzero_si128());
+            __m128i exponent_mantissa = _mm_and_si128(h, _mm_set1_epi32(0x7fff));
+            __m128i sign = _mm_slli_epi32(_mm_xor_si128(h, exponent_mantissa), 16);
+
+            // Rebiasing the exponent by 2^112 also normalizes subnormals.
+            __m128 scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(exponent_mantissa, 13)), _mm_castsi128_ps(_mm_set1_epi32(0x77800000)));
+            __m128i inf_nan = _mm_and_si128(_mm_cmpgt_epi32(exponent_mantissa, _mm_set1_epi32(0x7bff)), _mm_set1_epi32(0x7f800000));
+            return _mm_or_ps(scaled, _mm_castsi128_ps(_mm_or_si128(sign, inf_nan)));
+        }
+
+        inline void StoreHalf(uint16_t* p, Float4 v)
+        {
+            __m128 sign = _mm_and_ps(v, _mm_castsi128_ps(_mm_set1_epi32(0x80000000)));
+            __m128 abs = _mm_xor_ps(v, sign);
+            __m128i abs_bits = _mm_castps_si128(abs);
+
+            __m128i is_nan = _mm_castps_si128(_mm_cmpunord_ps(abs, abs));
+            __m128i is_regular = _mm_cmpgt_epi32(_mm_set1_epi32(0x47800000), abs_bits);
+            __m128i is_subnormal = _mm_cmpgt_epi32(_mm_set1_epi32(0x38800000), abs_bits);
+            __m128i inf_nan = _mm_or_si128(_mm_and_si128(is_nan, _mm_set1_epi32(0x200)), _mm_set1_epi32(0x7c00));
+
+            // Adding 0.5 lines the subnormal mantissa up with the float's, rounding it.
+            __m128i subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(abs, _mm_castsi128_ps(_mm_set1_epi32(0x3f000000)))), _mm_set1_epi32(0x3f000000));
+
+            // Rebias, add just under half an ulp and the odd bit for ties to even, then shift.
+            __m128i odd = _mm_srai_epi32(_mm_slli_epi32(abs_bits, 18), 31);
+            __m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(abs_bits, _mm_set1_epi32(static_cast<int32_t>(0xc8000fffu))), odd), 13);
+
+            __m128i finite = _mm_or_si128(_mm_and_si128(is_subnormal, subnormal), _mm_andnot_si128(is_subnormal, normal));
+            __m128i h = _mm_or_si128(_mm_and_si128(is_regular, finite), _mm_andnot_si128(is_regular, inf_nan));
+            h = _mm_or_si128(h, _mm_srli_epi32(_mm_castps_si128(sign), 16));
+
+            // Sign extending the low halves keeps the signed saturating pack exact.
+            h = _mm_srai_epi32(_mm_slli_epi32(h, 16), 16);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_packs_epi32(h, _mm_setzero_si128()));
+        }
+#endif
+#elif defined(SIMD_MATH_NEON)
+        using Float4 = float32x4_t;
+
+        inline Float4 Load(const float* p) { return vld1q_f32(p); }
+        inline void Store(float* p, Float4 v) { vst1q_f32(p, v); }
+        inline Float4 Set1(float v) { return vdupq_n_f32(v); }
+        inline Float4 Set(float x, float y, float z, float w) { float v[4] = { x, y, z, w }; return vld1q_f32(v); }
+        inline Float4 Zero() { return vdupq_n_f32(0.0f); }
+
+        inline Float4 Add(Float4 a, Float4 b) { return vaddq_f32(a, b); }
+        inline Float4 Sub(Float4 a, Float4 b) { return vsubq_f32(a, b); }
+        inline Float4 Mul(Float4 a, Float4 b) { return vmulq_f32(a, b); }
+        inline Float4 Div(Float4 a, Float4 b) { return vdivq_f32(a, b); }
+        inline Float4 MulAdd(Float4 a, Float4 b, Float4 c) { return vmlaq_f32(c, a, b); }
+        inline Float4 Min(Float4 a, Float4 b) { return vminq_f32(a, b); }
+        inline Float4 Max(Float4 a, Float4 b) { return vmaxq_f32(a, b); }
+        inline Float4 Sqrt(Float4 a) { return vsqrtq_f32(a); }
+
+        inline Float4 CmpLt(Float4 a, Float4 b) { return vreinterpretq_f32_u32(vcltq_f32(a, b)); }
+        inline Float4 CmpLe(Float4 a, Float4 b) { return vreinterpretq_f32_u32(vcleq_f32(a, b)); }
+        inline Float4 CmpGt(Float4 a, Float4 b) { return vreinterpretq_f32_u32(vcgtq_f32(a, b)); }
+        inline Float4 CmpGe(Float4 a, Float4 b) { return vreinterpretq_f32_u32(vcgeq_f32(a, b)); }
+        inline Float4 And(Float4 a, Float4 b) { return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b))); }
+        inline Float4 Or(Float4 a, Float4 b) { return vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b))); }
+        inline Float4 Select(Float4 mask, Float4 a, Float4 b) { return vbslq_f32(vreinterpretq_u32_f32(mask), a, b); }
+        inline uint32_t MoveMask(Float4 mask)
+        {
+            static const int32_t shift[4] = { 0, 1, 2, 3 };
+            uint32x4_t bits = vshrq_n_u32(vreinterpretq_u32_f32(mask), 31);
+            return vaddvq_u32(vshlq_u32(bits, vld1q_s32(shift)));
+        }
+
+        inline void Transpose(Float4& a, Float4& b, Float4& c, Float4& d)
+        {
+            float32x4x2_t ab = vtrnq_f32(a, b);
+            float32x4x2_t cd = vtrnq_f32(c, d);
+            a = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+            b = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+            c = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+            d = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+        }
+
+        inline float GetX(Float4 v) { return vgetq_lane_f32(v, 0); }
+
+        inline void StoreStream(float* p, Float4 v) { vst1q_f32(p, v); }
+        inline void StreamFence() {}
+
+        template<uint32_t X, uint32_t Y, uint32_t Z, uint32_t W>
+        inline Float4 Shuffle(Float4 a, Float4 b)
+        {
+            float lanes_a[4];
+            float lanes_b[4];
+            vst1q_f32(lanes_a, a);
+            vst1q_f32(lanes_b, b);
+            float lanes[4] = { lanes_a[X], lanes_a[Y], lanes_b[Z], lanes_b[W] };
+            return vld1q_f32(lanes);
+        }
+
+        inline Float4 LoadInt16(const int16_t* p) { return vcvtq_f32_s32(vmovl_s16(vld1_s16(p))); }
+        inline void StoreInt16(int16_t* p, Float4 v) { vst1_s16(p, vqmovn_s32(vcvtnq_s32_f32(v))); }
+
+        inline Float4 LoadHalf(const uint16_t* p) { return vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(p))); }
+        inline void StoreHalf(uint16_t* p, Float4 v) { vst1_u16(p, vreinterpret_u16_f16(vcvt_f16_f32(v))); }
+#else
+        struct Float4
+        {
+            float v[4];
+        };
+
+        inline Float4 Load(const float* p) { return { { p[0], p[1], p[2], p[3] } }; }
+        inline void Store(float* p, Float4 a) { p[0] = a.v[0]; p[1] = a.v[1]; p[2] = a.v[2]; p[3] = a.v[3]; }
+        inline Float4 Set1(float v) { return { { v, v, v, v } }; }
+        inline Float4 Set(float x, float y, float z, float w) { return { { x, y, z, w } }; }
+        inline Float4 Zero() { return Set1(0.0f); }
+
+        #define SIMD_MATH_SCALAR_OP(name, expr)                 \
+        inline Float4 name(Float4 a, Float4 b)                  \
+        {                                                       \
+            Float4 r;                                           \
+            for (int i = 0; i < 4; i++) { r.v[i] = (expr); }    \
+            return r;                                           \
+        }
+
+        #define SIMD_MATH_SCALAR_CMP(name, op)                  \
+        inline Float4 name(Float4 a, Float4 b)                  \
+        {                                                       \
+            Float4 r;                                           \
+            for (int i = 0; i < 4; i++)                         \
+            {                                                   \
+                uint32_t m = a.v[i] op b.v[i] ? 0xffffffffu : 0u; \
+                ::memcpy(&r.v[i], &m, sizeof(m));               \
+            }                                                   \
+            return r;                                           \
+        }
+
+        SIMD_MATH_SCALAR_OP(Add, a.v[i] + b.v[i])
+        SIMD_MATH_SCALAR_OP(Sub, a.v[i] - b.v[i])
+        SIMD_MATH_SCALAR_OP(Mul, a.v[i] * b.v[i])
+        SIMD_MATH_SCALAR_OP(Div, a.v[i] / b.v[i])
+        SIMD_MATH_SCALAR_OP(Min, a.v[i] < b.v[i] ? a.v[i] : b.v[i])
+        SIMD_MATH_SCALAR_OP(Max, a.v[i] > b.v[i] ? a.v[i] : b.v[i])
+        SIMD_MATH_SCALAR_CMP(CmpLt, <)
+        SIMD_MATH_SCALAR_CMP(CmpLe, <=)
+        SIMD_MATH_SCALAR_CMP(CmpGt, >)
+        SIMD_MATH_SCALAR_CMP(CmpGe, >=)
+
+        #undef SIMD_MATH_SCALAR_OP
+        #undef SIMD_MATH_SCALAR_CMP
+
+        inline Float4 MulAdd(Float4 a, Float4 b, Float4 c) { return Add(Mul(a, b), c); }
+        inline Float4 Sqrt(Float4 a) { return { { std::sqrt(a.v[0]), std::sqrt(a.v[1]), std::sqrt(a.v[2]), std::sqrt(a.v[3]) } }; }
+
+        inline uint32_t Bits(float f) { uint32_t u; ::memcpy(&u, &f, sizeof(u)); return u; }
+        inline float Float(uint32_t u) { float f; ::memcpy(&f, &u, sizeof(f)); return f; }
+
+        inline Float4 And(Float4 a, Float4 b)
+        {
+            return { { Float(Bits(a.v[0]) & Bits(b.v[0])), Float(Bits(a.v[1]) & Bits(b.v[1])), Float(Bits(a.v[2]) & Bits(b.v[2])), Float(Bits(a.v[3]) & Bits(b.v[3])) } };
+        }
+
+        inline Float4 Or(Float4 a, Float4 b)
+        {
+            return { { Float(Bits(a.v[0]) | Bits(b.v[0])), Float(Bits(a.v[1]) | Bits(b.v[1])), Float(Bits(a.v[2]) | Bits(b.v[2])), Float(Bits(a.v[3]) | Bits(b.v[3])) } };
+        }
+
+        inline Float4 Select(Float4 mask, Float4 a, Float4 b)
+        {
+            Float4 r;
+            for (int i = 0; i < 4; i++) { r.v[i] = (Bits(mask.v[i]) >> 31) ? a.v[i] : b.v[i]; }
+            return r;
+        }
+
+        inline uint32_t MoveMask(Float4 mask)
+        {
+            return (Bits(mask.v[0]) >> 31) | ((Bits(mask.v[1]) >> 31) << 1) | ((Bits(mask.v[2]) >> 31) << 2) | ((Bits(mask.v[3]) >> 31) << 3);
+        }
+
+        inline void Transpose(Float4& a, Float4& b, Float4& c, Float4& d)
+        {
+            Float4 rows[4] = { a, b, c, d };
+            a = { { rows[0].v[0], rows[1].v[0], rows[2].v[0], rows[3].v[0] } };
+            b = { { rows[0].v[1], rows[1].v[1], rows[2].v[1], rows[3].v[1] } };
+            c = { { rows[0].v[2], rows[1].v[2], rows[2].v[2], rows[3].v[2] } };
+            d = { { rows[0].v[3], rows[1].v[3], rows[2].v[3], rows[3].v[3] } };
+        }
+
+        inline float GetX(Float4 v) { return v.v[0]; }
+
+        inline void StoreStream(float* p, Float4 v) { Store(p, v); }
+        inline void StreamFence() {}
+
+        template<uint32_t X, uint32_t Y, uint32_t Z, uint32_t W>
+        inline Float4 Shuffle(Float4 a, Float4 b) { return { { a.v[X], a.v[Y], b.v[Z], b.v[W] } }; }
+
+        inline Float4 LoadInt16(const int16_t* p) { return { { static_cast<float>(p[0]), static_cast<float>(p[1]), static_cast<float>(p[2]), static_cast<float>(p[3]) } }; }
+
+        inline void StoreInt16(int16_t* p, Float4 v)
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                float r = std::nearbyint(v.v[i]);
+                p[i] = static_cast<int16_t>(r < -32768.0f ? -32768.0f : (r > 32767.0f ? 32767.0f : r));
+            }
+        }
+
+        inline Float4 LoadHalf(const uint16_t* p)
+        {
+            Float4 r;
+            for (int i = 0; i < 4; i++)
+            {
+                uint32_t exponent_mantissa = p[i] & 0x7fffu;
+                uint32_t bits = Bits(Float(exponent_mantissa << 13) * Float(0x77800000u));
+                bits |= exponent_mantissa > 0x7bffu ? 0x7f800000u : 0u;
+                r.v[i] = Float(bits | (static_cast<uint32_t>(p[i] & 0x8000u) << 16));
+            }
+            return r;
+        }
+
+        inline void StoreHalf(uint16_t* p, Float4 v)
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                uint32_t bits = Bits(v.v[i]);
+                uint32_t abs = bits & 0x7fffffffu;
+                uint32_t h;
+                if (abs >= 0x47800000u)
+                {
+                    h = abs > 0x7f800000u ? 0x7e00u : 0x7c00u;
+                }
+                else if (abs < 0x38800000u)
+                {
+                    h = Bits(Float(abs) + Float(0x3f000000u)) - 0x3f000000u;
+                }
+                else
+                {
+                    h = (abs + 0xc8000fffu + ((abs >> 13) & 1u)) >> 13;
+                }
+
+                p[i] = static_cast<uint16_t>(h | ((bits >> 16) & 0x8000u));
+            }
+        }
+#endif
+
+        template<uint32_t X, uint32_t Y, uint32_t Z, uint32_t W>
+        inline Float4 Swizzle(Float4 v) { return Shuffle<X, Y, Z, W>(v, v); }
+
+        template<uint32_t I>
+        inline Float4 Splat(Float4 v) { return Shuffle<I, I, I, I>(v, v); }
+
+        // Tails of arrays whose length is not a multiple of four, missing lanes read as zero.
+        inline Float4 LoadPartial(const float* p, uint32_t count)
+        {
+            if (count >= 4)
+            {
+                return Load(p);
+            }
+
+            float lanes[4] = {};
+            ::memcpy(lanes, p, sizeof(float) * count);
+            return Load(lanes);
+        }
+
+        inline void StorePartial(float* p, Float4 v, uint32_t count)
+        {
+            if (count >= 4)
+            {
+                Store(p, v);
+                return;
+            }
+
+            float lanes[4];
+            Store(lanes, v);
+            ::memcpy(p, lanes, sizeof(float) * count);
+        }
+
+        // Eight lanes, for kernels that run the same math over long structure-of-arrays streams.
+        // Loads and stores that cannot be told apart by their arguments carry an 8 suffix.
+#if defined(SIMD_MATH_AVX)
+        using Float8 = __m256;
+
+        inline Float8 Load8(const float* p) { return _mm256_loadu_ps(p); }
+        inline void Store8(float* p, Float8 v) { _mm256_storeu_ps(p, v); }
+        inline Float8 Set1x8(float v) { return _mm256_set1_ps(v); }
+        inline Float8 Zero8() { return _mm256_setzero_ps(); }
+
+        // (low[0..3], high[0..3])
+        inline Float8 Combine(Float4 low, Float4 high) { return _mm256_insertf128_ps(_mm256_castps128_ps256(low), high, 1); }
+        inline Float4 GetLow(Float8 v) { return _mm256_castps256_ps128(v); }
+        inline Float4 GetHigh(Float8 v) { return _mm256_extractf128_ps(v, 1); }
+
+        inline Float8 Add(Float8 a, Float8 b) { return _mm256_add_ps(a, b); }
+        inline Float8 Sub(Float8 a, Float8 b) { return _mm256_sub_ps(a, b); }
+        inline Float8 Mul(Float8 a, Float8 b) { return _mm256_mul_ps(a, b); }
+        inline Float8 Div(Float8 a, Float8 b) { return _mm256_div_ps(a, b); }
+#if defined(SIMD_MATH_FMA)
+        inline Float8 MulAdd(Float8 a, Float8 b, Float8 c) { return _mm256_fmadd_ps(a, b, c); }
+#else
+        inline Float8 MulAdd(Float8 a, Float8 b, Float8 c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+#endif
+        inline Float8 Min(Float8 a, Float8 b) { return _mm256_min_ps(a, b); }
+        inline Float8 Max(Float8 a, Float8 b) { return _mm256_max_ps(a, b); }
+        inline Float8 Sqrt(Float8 a) { return _mm256_sqrt_ps(a); }
+
+        inline Float8 CmpLt(Float8 a, Float8 b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+        inline Float8 CmpLe(Float8 a, Float8 b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+        inline Float8 CmpGt(Float8 a, Float8 b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+        inline Float8 CmpGe(Float8 a, Float8 b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+        inline Float8 And(Float8 a, Float8 b) { return _mm256_and_ps(a, b); }
+        inline Float8 Or(Float8 a, Float8 b) { return _mm256_or_ps(a, b); }
+        inline Float8 Select(Float8 mask, Float8 a, Float8 b) { return _mm256_or_ps(_mm256_and_ps(mask, a), _mm256_andnot_ps(mask, b)); }
+        inline uint32_t MoveMask(Float8 mask) { return static_cast<uint32_t>(_mm256_movemask_ps(mask)); }
+
+        inline void StoreStream8(float* p, Float8 v) { _mm256_stream_ps(p, v); }
+#else
+        struct Float8
+        {
+            Float4 low;
+            Float4 high;
+        };
+
+        inline Float8 Load8(const float* p) { return { Load(p), Load(p + 4) }; }
+        inline void Store8(float* p, Float8 v) { Store(p, v.low); Store(p + 4, v.high); }
+        inline Float8 Set1x8(float v) { return { Set1(v), Set1(v) }; }
+        inline Float8 Zero8() { return { Zero(), Zero() }; }
+
+        inline Float8 Combine(Float4 low, Float4 high) { return { low, high }; }
+        inline Float4 GetLow(Float8 v) { return v.low; }
+        inline Float4 GetHigh(Float8 v) { return v.high; }
+
+        inline Float8 Add(Float8 a, Float8 b) { return { Add(a.low, b.low), Add(a.high, b.high) }; }
+        inline Float8 Sub(Float8 a, Float8 b) { return { Sub(a.low, b.low), Sub(a.high, b.high) }; }
+        inline Float8 Mul(Float8 a, Float8 b) { return { Mul(a.low, b.low), Mul(a.high, b.high) }; }
+        inline Float8 Div(Float8 a, Float8 b) { return { Div(a.low, b.low), Div(a.high, b.high) }; }
+        inline Float8 MulAdd(Float8 a, Float8 b, Float8 c) { return { MulAdd(a.low, b.low, c.low), MulAdd(a.high, b.high, c.high) }; }
+        inline Float8 Min(Float8 a, Float8 b) { return { Min(a.low, b.low), Min(a.high, b.high) }; }
+        inline Float8 Max(Float8 a, Float8 b) { return { Max(a.low, b.low), Max(a.high, b.high) }; }
+        inline Float8 Sqrt(Float8 a) { return { Sqrt(a.low), Sqrt(a.high) }; }
+
+        inline Float8 CmpLt(Float8 a, Float8 b) { return { CmpLt(a.low, b.low), CmpLt(a.high, b.high) }; }
+        inline Float8 CmpLe(Float8 a, Float8 b) { return { CmpLe(a.low, b.low), CmpLe(a.high, b.high) }; }
+        inline Float8 CmpGt(Float8 a, Float8 b) { return { CmpGt(a.low, b.low), CmpGt(a.high, b.high) }; }
+        inline Float8 CmpGe(Float8 a, Float8 b) { return { CmpGe(a.low, b.low), CmpGe(a.high, b.high) }; }
+        inline Float8 And(Float8 a, Float8 b) { return { And(a.low, b.low), And(a.high, b.high) }; }
+        inline Float8 Or(Float8 a, Float8 b) { return { Or(a.low, b.low), Or(a.high, b.high) }; }
+        inline Float8 Select(Float8 mask, Float8 a, Float8 b) { return { Select(mask.low, a.low, b.low), Select(mask.high, a.high, b.high) }; }
+        inline uint32_t MoveMask(Float8 mask) { return MoveMask(mask.low) | (MoveMask(mask.high) << 4); }
+
+        inline void StoreStream8(float* p, Float8 v) { StoreStream(p, v.low); StoreStream(p + 4, v.high); }
+#endif
+
+        inline Float8 LoadPartial8(const float* p, uint32_t count)
+        {
+            if (count >= 8)
+            {
+                return Load8(p);
+            }
+
+            float lanes[8] = {};
+            ::memcpy(lanes, p, sizeof(float) * count);
+            return Load8(lanes);
+        }
+
+        inline void StorePartial8(float* p, Float8 v, uint32_t count)
+        {
+            if (count >= 8)
+            {
+                Store8(p, v);
+                return;
+            }
+
+            float lanes[8];
+            Store8(lanes, v);
+            ::memcpy(p, lanes, sizeof(float) * count);
+        }
+    };
+};
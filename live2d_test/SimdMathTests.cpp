@@ -0,0 +1,125 @@
+#include "SimdMath.h"
+
+#include <cstring>
+
+#include "TestHarness.h"
+
+using namespace D3D;
+
+namespace
+{
+    float Random(uint32_t& seed)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / 16777216.0f * 8.0f - 4.0f;
+    }
+
+    // Runs the Float4 and the Float8 version of an operation over the same lanes, the Float8 one
+    // has to give the same bits as the two Float4 halves.
+    template<typename Float4Op, typename Float8Op>
+    bool MatchesHalves(const float* a, const float* b, const float* c, Float4Op float4_op, Float8Op float8_op)
+    {
+        float expected[8];
+        Simd::Store(expected, float4_op(Simd::Load(a), Simd::Load(b), Simd::Load(c)));
+        Simd::Store(expected + 4, float4_op(Simd::Load(a + 4), Simd::Load(b + 4), Simd::Load(c + 4)));
+
+        float result[8];
+        Simd::Store8(result, float8_op(Simd::Load8(a), Simd::Load8(b), Simd::Load8(c)));
+        return ::memcmp(expected, result, sizeof(result)) == 0;
+    }
+
+    void TestFloat8MatchesFloat4()
+    {
+        uint32_t seed = 1;
+        for (uint32_t round = 0; round < 64; round++)
+        {
+            float a[8];
+            float b[8];
+            float c[8];
+            for (uint32_t i = 0; i < 8; i++)
+            {
+                a[i] = Random(seed);
+                b[i] = (i & 3) == 0 ? a[i] : Random(seed);
+                c[i] = Random(seed);
+            }
+
+            TEST_CHECK(MatchesHalves(a, b, c, [](Simd::Float4 x, Simd::Float4 y, Simd::Float4) { return Simd::Add(x, y); }, [](Simd::Float8 x, Simd::Float8 y, Simd::Float8) { return Simd::Add(x, y); }));
+            TEST_CHECK(MatchesHalves(a, b, c, [](Simd::Float4 x, Simd::Float4 y, Simd::Float4) { return Simd::Sub(x, y); }, [](Simd::Float8 x, Simd::Float8 y, Simd::Float8) { return Simd::Sub(x, y); }));
+            TEST_CHECK(MatchesHalves(a, b, c, [](Simd::Float4 x, Simd::Float4 y, Simd::Float4) { return Simd::Mul(x, y); }, [](Simd::Float8 x, Simd::Float8 y, Simd::Float8) { return Simd::Mul(x, y); }));
+            TEST_CHECK(MatchesHalves(a, b, c, [](Simd::Float4 x, Simd::Float4 y, Simd::Float4) { return Simd::Div(x, y); }, [](Simd::Float8 x, Simd::Float8 y, Simd::Float8) { return Simd::Div(x, y); }));
+            TEST_CHECK(MatchesHalves(a, b, c, [](Simd::Float4 x, Simd::Float4 y, Simd::Float4 z) { return Simd::MulAdd(x, y, z); }, [](Simd::Float8 x, Simd::Float8 y, Simd::Float8 z) { return Simd::MulAdd(x, y, z); }));
+            TEST_CHECK(MatchesHalves(a, b, c, [](Simd::Float4 x, Simd::Float4 y, Simd::Float4) { return Simd::Min(x, y); }, [](Simd::Float8 x, Simd::Float8 y, Simd::Float8) { return Simd::Min(x, y); }));
+            TEST_CHECK(MatchesHalves(a, b, c, [](Simd::Float4 x, Simd::Float4 y, Simd::Float4) { return Simd::Max(x, y); }, [](Simd::Float8 x, Simd::Float8 y, Simd::Float8) { return Simd::Max(x, y); }));
+            TEST_CHECK(MatchesHalves(a, b, c, [](Simd::Float4 x, Simd::Float4 y, Simd::Float4) { return Simd::Sqrt(Simd::Mul(x, y)); }, [](Simd::Float8 x, Simd::Float8 y, Simd::Float8) { return Simd::Sqrt(Simd::Mul(x, y)); }));
+            TEST_CHECK(MatchesHalves(a, b, c, [](Simd::Float4 x, Simd::Float4 y, Simd::Float4) { return Simd::CmpLt(x, y); }, [](Simd::Float8 x, Simd::Float8 y, Simd::Float8) { return Simd::CmpLt(x, y); }));
+            TEST_CHECK(MatchesHalves(a, b, c, [](Simd::Float4 x, Simd::Float4 y, Simd::Float4) { return Simd::CmpLe(x, y); }, [](Simd::Float8 x, Simd::Float8 y, Simd::Float8) { return Simd::CmpLe(x, y); }));
+            TEST_CHECK(MatchesHalves(a, b, c, [](Simd::Float4 x, Simd::Float4 y, Simd::Float4) { return Simd::CmpGt(x, y); }, [](Simd::Float8 x, Simd::Float8 y, Simd::Float8) { return Simd::CmpGt(x, y); }));
+            TEST_CHECK(MatchesHalves(a, b, c, [](Simd::Float4 x, Simd::Float4 y, Simd::Float4) { return Simd::CmpGe(x, y); }, [](Simd::Float8 x, Simd::Float8 y, Simd::Float8) { return Simd::CmpGe(x, y); }));
+            TEST_CHECK(MatchesHalves(a, b, c, [](Simd::Float4 x, Simd::Float4 y, Simd::Float4 z) { return Simd::Or(Simd::And(Simd::CmpLt(x, y), z), Simd::CmpGe(z, x)); },
+                [](Simd::Float8 x, Simd::Float8 y, Simd::Float8 z) { return Simd::Or(Simd::And(Simd::CmpLt(x, y), z), Simd::CmpGe(z, x)); }));
+            TEST_CHECK(MatchesHalves(a, b, c, [](Simd::Float4 x, Simd::Float4 y, Simd::Float4 z) { return Simd::Select(Simd::CmpLt(x, y), y, z); },
+                [](Simd::Float8 x, Simd::Float8 y, Simd::Float8 z) { return Simd::Select(Simd::CmpLt(x, y), y, z); }));
+
+            uint32_t expected_mask = 0;
+            for (uint32_t i = 0; i < 8; i++)
+            {
+                expected_mask |= a[i] < c[i] ? 1u << i : 0u;
+            }
+
+            TEST_CHECK(Simd::MoveMask(Simd::CmpLt(Simd::Load8(a), Simd::Load8(c))) == expected_mask);
+        }
+    }
+
+    void TestLanes()
+    {
+        float values[8] = { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f };
+        Simd::Float8 v = Simd::Combine(Simd::Load(values), Simd::Load(values + 4));
+
+        float lanes[8];
+        Simd::Store8(lanes, v);
+        TEST_CHECK(::memcmp(lanes, values, sizeof(values)) == 0);
+        TEST_CHECK(Simd::GetX(Simd::GetLow(v)) == 1.0f && Simd::GetX(Simd::GetHigh(v)) == 5.0f);
+
+        Simd::Store8(lanes, Simd::Set1x8(3.0f));
+        TEST_CHECK(lanes[0] == 3.0f && lanes[7] == 3.0f);
+        TEST_CHECK(Simd::MoveMask(Simd::CmpLt(Simd::Zero8(), Simd::Set1x8(1.0f))) == 0xff);
+
+        // Missing lanes read as zero, lanes past count are left alone.
+        for (uint32_t count = 0; count <= 8; count++)
+        {
+            Simd::Store8(lanes, Simd::LoadPartial8(values, count));
+            bool loaded = true;
+            for (uint32_t i = 0; i < 8; i++)
+            {
+                loaded = loaded && lanes[i] == (i < count ? values[i] : 0.0f);
+            }
+
+            TEST_CHECK(loaded);
+
+            float stored[9];
+            for (auto& value : stored)
+            {
+                value = -1.0f;
+            }
+
+            Simd::StorePartial8(stored, Simd::Load8(values), count);
+            bool kept = stored[8] == -1.0f;
+            for (uint32_t i = 0; i < 8; i++)
+            {
+                kept = kept && stored[i] == (i < count ? values[i] : -1.0f);
+            }
+
+            TEST_CHECK(kept);
+        }
+    }
+}
+
+int main()
+{
+#if defined(SIMD_MATH_AVX)
+    std::printf("Float8 on AVX\n");
+#endif
+    TestFloat8MatchesFloat4();
+    TestLanes();
+    return D3D::Test::Finish("SimdMathTests");
+}
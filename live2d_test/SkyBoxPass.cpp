@@ -44,11 +44,17 @@ namespace D3D
         cmd->SetPipelineState(pso_.Get());
         cmd->SetGraphicsRootSignature(root_signature_);
         cmd->SetDescriptorHeaps(_countof(heap), heap);
-        cmd->SetGraphicsRootDescriptorTable(0, bund_resource_manager_.GetSrvUavCbvDescriptorHeap()->GetGPUDescriptorHandleForHeapStart());
+        cmd->SetGraphicsRootDescriptorTable(0, bund_resource_manager_.GetSrvUavCbvTableGpuHandle());
         cmd->SetGraphicsRootDescriptorTable(1, bund_resource_manager_.GetSampleDescriptorHeap()->GetGPUDescriptorHandleForHeapStart());
-        cmd->IASetVertexBuffers(0, 1, &vert_buffer_view_);
+        for (uint32_t i = 0; i < VertexFormatDesc::MAX_STREAM_COUNT; i++)
+        {
+            if (vert_stream_mask_ & (1u << i))
+            {
+                cmd->IASetVertexBuffers(i, 1, &vert_buffer_views_[i]);
+            }
+        }
         cmd->IASetIndexBuffer(&index_buffer_view_);
-        cmd->DrawIndexedInstanced(mesh_data_.Indices16.size(), 1, 0, 0, 0);
+        cmd->DrawIndexedInstanced(mesh_data_.GetIndexCount(), 1, 0, 0, 0);
     }
 
     void SkyBoxPass::Initialize()
@@ -57,7 +63,8 @@ namespace D3D
         ps_shader_ = D3D12Manager::CompileShader(L"./Shaders/SkyPass_PS.hlsl", "PS_Main", "ps_5_0");
 
         ID3DBlob* shader_arr[5] = { vs_shader_.Get(), ps_shader_.Get() };
-        bund_resource_manager_.Initialize(shader_arr);
+        auto vertex_format = VertexFormatDesc::Full().SplitPosition();
+        bund_resource_manager_.Initialize(shader_arr, vertex_format);
 
         root_signature_ = bund_resource_manager_.GetRootSignature();
 
@@ -77,27 +84,38 @@ namespace D3D
         DXGI_FORMAT rt_format{ DXGI_FORMAT_R8G8B8A8_UNORM };
         pso_ = D3D12Manager::CreatePipeLineStateObject({ input_layout.data(), (UINT)input_layout.size() }, root_signature_, shader_byte, D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE, &rt_format, 1, DXGI_FORMAT_D24_UNORM_S8_UINT, rast_desc, blend_desc, depth_stencil_desc);
 
-        uint64_t vertexSize = mesh_data_.Vertices.size() * sizeof(GeometryGenerator::Vertex);
-        uint64_t indexSize = mesh_data_.Indices16.size() * sizeof(uint16_t);
-
-        vert_buffer = D3D12Manager::CreateBuffer(D3D12_HEAP_TYPE_UPLOAD, vertexSize * 1.5f);
-        index_buffer = D3D12Manager::CreateBuffer(D3D12_HEAP_TYPE_UPLOAD, indexSize * 1.5f);
+        VertexStreams streams;
+        vert_stream_mask_ = bund_resource_manager_.GetVertexStreamMask();
+        VertexCodec::EncodeMesh(vertex_format, mesh_data_, vert_stream_mask_, streams);
 
         uint8_t* map_data{ nullptr };
-        vert_buffer->Map(0, nullptr, reinterpret_cast<void**>(&map_data));
-        ::memcpy(map_data, mesh_data_.Vertices.data(), vertexSize);
-        vert_buffer->Unmap(0, nullptr);
+        for (uint32_t i = 0; i < VertexFormatDesc::MAX_STREAM_COUNT; i++)
+        {
+            uint64_t stream_size = streams.data[i].size();
+            if (stream_size == 0)
+            {
+                continue;
+            }
+
+            vert_buffers_[i] = D3D12Manager::CreateBuffer(D3D12_HEAP_TYPE_UPLOAD, stream_size);
+            vert_buffers_[i]->Map(0, nullptr, reinterpret_cast<void**>(&map_data));
+            ::memcpy(map_data, streams.data[i].data(), stream_size);
+            vert_buffers_[i]->Unmap(0, nullptr);
+
+            vert_buffer_views_[i].BufferLocation = vert_buffers_[i]->GetGPUVirtualAddress();
+            vert_buffer_views_[i].SizeInBytes = static_cast<UINT>(stream_size);
+            vert_buffer_views_[i].StrideInBytes = vertex_format.strides[i];
+        }
+
+        uint64_t indexSize = mesh_data_.GetIndexCount() * mesh_data_.GetIndexSize();
+        index_buffer = D3D12Manager::CreateBuffer(D3D12_HEAP_TYPE_UPLOAD, indexSize * 1.5f);
 
         index_buffer->Map(0, nullptr, reinterpret_cast<void**>(&map_data));
-        ::memcpy(map_data, mesh_data_.Indices16.data(), indexSize);
+        ::memcpy(map_data, mesh_data_.GetIndexData(), indexSize);
         index_buffer->Unmap(0, nullptr);
 
-        vert_buffer_view_.BufferLocation = vert_buffer->GetGPUVirtualAddress();
-        vert_buffer_view_.SizeInBytes = vertexSize;
-        vert_buffer_view_.StrideInBytes = sizeof(GeometryGenerator::Vertex);
-
         index_buffer_view_.BufferLocation = index_buffer->GetGPUVirtualAddress();
-        index_buffer_view_.Format = DXGI_FORMAT_R16_UINT;
+        index_buffer_view_.Format = mesh_data_.Use32BitIndices ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT;
         index_buffer_view_.SizeInBytes = indexSize;
 
         sky_texture_ = D3D12Manager::CreateTexture(1024, 1024, DXGI_FORMAT_R8G8B8A8_UNORM, 6);
@@ -141,18 +159,20 @@ namespace D3D
         srv_desc.TextureCube.MostDetailedMip = 0;
         srv_desc.TextureCube.MipLevels = sky_texture_->GetDesc().MipLevels;
         srv_desc.TextureCube.ResourceMinLODClamp = 0.0f;
-        D3D12Manager::GetDevice()->CreateShaderResourceView(sky_texture_.Get(), &srv_desc, bund_resource_manager_.GetDescriptorHandle("CUBE_TEXTURE", 0));
+        bund_resource_manager_.BindShaderResourceView("CUBE_TEXTURE", 0, sky_texture_.Get(), srv_desc);
         //D3D12Manager::GetDevice()->CreateShaderResourceView(sky_texture_.Get(), &srv_desc, dx_cbv_heap.GetCpuHandle(0));
 
         view_proj_buffer_ = D3D12Manager::CreateBuffer(D3D12_HEAP_TYPE_UPLOAD, CalcConstantBufferByteSize(sizeof(DirectX::XMFLOAT4X4)));
         D3D12_CONSTANT_BUFFER_VIEW_DESC const_buff_view{};
         const_buff_view.BufferLocation = view_proj_buffer_->GetGPUVirtualAddress();
         const_buff_view.SizeInBytes = CalcConstantBufferByteSize(sizeof(DirectX::XMFLOAT4X4));
-        D3D12Manager::GetDevice()->CreateConstantBufferView(&const_buff_view, bund_resource_manager_.GetDescriptorHandle("VS_MatrixBuffer", 0));
+        bund_resource_manager_.BindConstantBufferView("VS_MatrixBuffer", 0, const_buff_view);
         //D3D12Manager::GetDevice()->CreateConstantBufferView(&const_buff_view, dx_cbv_heap.GetCpuHandle(1));
 
         bund_resource_manager_.BindDefaultSampler("SAMPLER", 0, D3D12BoundResourceManager::kLinearWrap);
 
+        // The sky views never change, so the first version of the table stays bound.
+        bund_resource_manager_.CommitDescriptorTable(0, 0);
     }
 };
 
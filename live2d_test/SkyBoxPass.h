@@ -26,10 +26,12 @@ namespace D3D
         Microsoft::WRL::ComPtr<ID3D12Resource>              sky_texture_;
         Microsoft::WRL::ComPtr<ID3D12Resource>              view_proj_buffer_;
 
-        D3D12_VERTEX_BUFFER_VIEW                            vert_buffer_view_ = {};
+        // Only the streams the sky shader reads are uploaded, which is the position stream.
+        D3D12_VERTEX_BUFFER_VIEW                            vert_buffer_views_[VertexFormatDesc::MAX_STREAM_COUNT] = {};
         D3D12_INDEX_BUFFER_VIEW                             index_buffer_view_ = {};
-        Microsoft::WRL::ComPtr<ID3D12Resource>              vert_buffer;
+        Microsoft::WRL::ComPtr<ID3D12Resource>              vert_buffers_[VertexFormatDesc::MAX_STREAM_COUNT];
         Microsoft::WRL::ComPtr<ID3D12Resource>              index_buffer;
+        uint32_t                                            vert_stream_mask_ = 0;
 
         D3D12BoundResourceManager                           bund_resource_manager_;
 
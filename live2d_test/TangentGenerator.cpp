@@ -0,0 +1,412 @@
+#include "TangentGenerator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#include "TaskScheduler.h"
+
+namespace D3D
+{
+    namespace
+    {
+        using Vertex = GeometryGenerator::Vertex;
+
+        const uint32_t INVALID_VERTEX = 0xffffffff;
+
+        // Triangles and vertices per ParallelFor chunk.
+        const uint32_t PARALLEL_GRAIN = 4096;
+
+        // Corner flags.
+        const uint8_t CORNER_VALID = 1;                     // the triangle has a u direction at this corner
+        const uint8_t CORNER_PRESERVING = 2;                // uv winding matches the position winding
+
+        // A sum shorter than this part of its corner weights cancelled out, as around the pole
+        // of a uv sphere, and is left to PerpendicularTangent instead of float noise.
+        const float CANCEL_THRESHOLD = 1e-4f;
+
+        // Vertex flags, of the orientation with the most corners.
+        const uint8_t VERTEX_PRESERVING = 1;
+        const uint8_t VERTEX_SPLIT = 2;                     // corners of the other orientation move to a copy
+
+        template<typename Function>
+        void RunParallel(TaskScheduler* scheduler, uint32_t count, Function body)
+        {
+            if (scheduler != nullptr && count > PARALLEL_GRAIN)
+            {
+                scheduler->ParallelFor(count, PARALLEL_GRAIN, body);
+            }
+            else if (count > 0)
+            {
+                body(0, count);
+            }
+        }
+
+        inline float Dot(const float a[3], const float b[3])
+        {
+            return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+        }
+
+        // Leaves zero vectors as they are, as MikkTSpace does.
+        inline bool Normalize(float v[3])
+        {
+            float length_sq = Dot(v, v);
+            if (!(length_sq > 0.0f))
+            {
+                return false;
+            }
+
+            float inv_length = 1.0f / sqrtf(length_sq);
+            v[0] *= inv_length;
+            v[1] *= inv_length;
+            v[2] *= inv_length;
+            return true;
+        }
+
+        // v minus its part along the unit vector n.
+        inline void ProjectOnPlane(const float n[3], float v[3])
+        {
+            float d = Dot(n, v);
+            v[0] -= n[0] * d;
+            v[1] -= n[1] * d;
+            v[2] -= n[2] * d;
+        }
+
+        // Any unit vector perpendicular to normal, for vertices no triangle gives a direction.
+        void PerpendicularTangent(const DirectX::XMFLOAT3& normal, float tangent[3])
+        {
+            float n[3] = { normal.x, normal.y, normal.z };
+            if (!Normalize(n))
+            {
+                tangent[0] = 1.0f;
+                tangent[1] = 0.0f;
+                tangent[2] = 0.0f;
+                return;
+            }
+
+            // Crossed with the axis it is least aligned with.
+            float axis[3] = {};
+            float ax = fabsf(n[0]), ay = fabsf(n[1]), az = fabsf(n[2]);
+            axis[ax <= ay && ax <= az ? 0 : (ay <= az ? 1 : 2)] = 1.0f;
+            tangent[0] = axis[1] * n[2] - axis[2] * n[1];
+            tangent[1] = axis[2] * n[0] - axis[0] * n[2];
+            tangent[2] = axis[0] * n[1] - axis[1] * n[0];
+            Normalize(tangent);
+        }
+
+        inline uint32_t HashWords(const float* values, uint32_t count, uint32_t hash)
+        {
+            for (uint32_t i = 0; i < count; i++)
+            {
+                uint32_t word;
+                ::memcpy(&word, &values[i], sizeof(word));
+                word *= 0xcc9e2d51;
+                word = (word << 15) | (word >> 17);
+                hash ^= word * 0x1b873593;
+                hash = ((hash << 13) | (hash >> 19)) * 5 + 0xe6546b64;
+            }
+
+            return hash;
+        }
+
+        inline uint32_t HashVertex(const Vertex& vertex)
+        {
+            uint32_t hash = HashWords(&vertex.Position.x, 3, 0);
+            hash = HashWords(&vertex.Normal.x, 3, hash);
+            hash = HashWords(&vertex.TexC.x, 2, hash);
+            hash ^= hash >> 16;
+            hash *= 0x85ebca6b;
+            return hash ^ (hash >> 13);
+        }
+
+        // Bitwise, the tangent is not part of the key.
+        inline bool SameVertex(const Vertex& a, const Vertex& b)
+        {
+            return ::memcmp(&a.Position, &b.Position, sizeof(a.Position)) == 0 &&
+                ::memcmp(&a.Normal, &b.Normal, sizeof(a.Normal)) == 0 &&
+                ::memcmp(&a.TexC, &b.TexC, sizeof(a.TexC)) == 0;
+        }
+    }
+
+    uint32_t TangentGenerator::Generate(GeometryGenerator::MeshData& mesh, TaskScheduler* scheduler, std::vector<float>* bitangent_signs)
+    {
+        uint32_t vertex_count = static_cast<uint32_t>(mesh.Vertices.size());
+        uint32_t index_count = static_cast<uint32_t>(mesh.GetIndexCount());
+        assert(index_count % 3 == 0);
+
+        indices_.resize(index_count);
+        if (mesh.Use32BitIndices)
+        {
+            std::copy(mesh.Indices32.begin(), mesh.Indices32.end(), indices_.begin());
+        }
+        else
+        {
+            std::copy(mesh.Indices16.begin(), mesh.Indices16.end(), indices_.begin());
+        }
+
+        WeldVertices(mesh.Vertices);
+        ComputeCornerTangents(mesh.Vertices, scheduler);
+        GatherCorners(vertex_count);
+        SumCorners(mesh.Vertices, scheduler);
+
+        // Split vertices get their copy in vertex order, so the output is the same every run.
+        uint32_t split_count = 0;
+        for (uint32_t v = 0; v < vertex_count; v++)
+        {
+            split_count += (vertex_flags_[v] & VERTEX_SPLIT) != 0 ? 1 : 0;
+        }
+
+        mesh.Vertices.resize(vertex_count + split_count);
+        if (bitangent_signs != nullptr)
+        {
+            bitangent_signs->resize(vertex_count + split_count);
+        }
+
+        uint32_t split_vertex = vertex_count;
+        for (uint32_t v = 0; v < vertex_count && split_count > 0; v++)
+        {
+            if ((vertex_flags_[v] & VERTEX_SPLIT) == 0)
+            {
+                continue;
+            }
+
+            uint8_t preserving = (vertex_flags_[v] & VERTEX_PRESERVING) != 0 ? CORNER_PRESERVING : 0;
+            for (uint32_t k = corner_offsets_[v]; k < corner_offsets_[v + 1]; k++)
+            {
+                uint32_t corner = vertex_corners_[k];
+                if ((corner_flags_[corner] & CORNER_VALID) != 0 && (corner_flags_[corner] & CORNER_PRESERVING) != preserving)
+                {
+                    indices_[corner] = split_vertex;
+                }
+            }
+
+            Vertex& copy = mesh.Vertices[split_vertex];
+            copy = mesh.Vertices[v];
+            copy.TangentU = { split_tangents_[v * 3 + 0], split_tangents_[v * 3 + 1], split_tangents_[v * 3 + 2] };
+            if (bitangent_signs != nullptr)
+            {
+                (*bitangent_signs)[split_vertex] = preserving != 0 ? -1.0f : 1.0f;
+            }
+
+            split_vertex++;
+        }
+
+        // Welded vertices take the tangent of the first one.
+        RunParallel(scheduler, vertex_count, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t v = begin; v < end; v++)
+            {
+                uint32_t first = welded_[v];
+                mesh.Vertices[v].TangentU = { tangents_[first * 3 + 0], tangents_[first * 3 + 1], tangents_[first * 3 + 2] };
+                if (bitangent_signs != nullptr)
+                {
+                    (*bitangent_signs)[v] = (vertex_flags_[first] & VERTEX_PRESERVING) != 0 ? 1.0f : -1.0f;
+                }
+            }
+        });
+
+        if (split_count > 0)
+        {
+            mesh.ResizeIndices(index_count, vertex_count + split_count);
+            if (mesh.Use32BitIndices)
+            {
+                std::copy(indices_.begin(), indices_.end(), mesh.Indices32.begin());
+            }
+            else
+            {
+                std::transform(indices_.begin(), indices_.end(), mesh.Indices16.begin(), [](uint32_t index) { return static_cast<uint16_t>(index); });
+            }
+        }
+
+        return split_count;
+    }
+
+    void TangentGenerator::WeldVertices(const std::vector<GeometryGenerator::Vertex>& vertices)
+    {
+        uint32_t vertex_count = static_cast<uint32_t>(vertices.size());
+        uint32_t table_size = 1;
+        while (table_size < vertex_count * 2)
+        {
+            table_size *= 2;
+        }
+
+        weld_table_.assign(table_size, INVALID_VERTEX);
+        welded_.resize(vertex_count);
+        for (uint32_t v = 0; v < vertex_count; v++)
+        {
+            uint32_t slot = HashVertex(vertices[v]) & (table_size - 1);
+            while (weld_table_[slot] != INVALID_VERTEX && !SameVertex(vertices[weld_table_[slot]], vertices[v]))
+            {
+                slot = (slot + 1) & (table_size - 1);
+            }
+
+            if (weld_table_[slot] == INVALID_VERTEX)
+            {
+                weld_table_[slot] = v;
+            }
+
+            welded_[v] = weld_table_[slot];
+        }
+    }
+
+    void TangentGenerator::ComputeCornerTangents(const std::vector<GeometryGenerator::Vertex>& vertices, TaskScheduler* scheduler)
+    {
+        uint32_t triangle_count = static_cast<uint32_t>(indices_.size() / 3);
+        corner_tangents_.resize(indices_.size() * 3);
+        corner_flags_.resize(indices_.size());
+
+        RunParallel(scheduler, triangle_count, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t t = begin; t < end; t++)
+            {
+                const Vertex* corners[3] = { &vertices[indices_[t * 3 + 0]], &vertices[indices_[t * 3 + 1]], &vertices[indices_[t * 3 + 2]] };
+                const float* p0 = &corners[0]->Position.x;
+                const float* p1 = &corners[1]->Position.x;
+                const float* p2 = &corners[2]->Position.x;
+                float d1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+                float d2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+                float t21x = corners[1]->TexC.x - corners[0]->TexC.x;
+                float t21y = corners[1]->TexC.y - corners[0]->TexC.y;
+                float t31x = corners[2]->TexC.x - corners[0]->TexC.x;
+                float t31y = corners[2]->TexC.y - corners[0]->TexC.y;
+
+                // The u direction, dP/du up to a positive factor. Triangles flat in uv or in
+                // space have none and leave their corners to the other triangles of the vertex.
+                float signed_area = t21x * t31y - t21y * t31x;
+                float sign = signed_area > 0.0f ? 1.0f : -1.0f;
+                float os[3] =
+                {
+                    (t31y * d1[0] - t21y * d2[0]) * sign,
+                    (t31y * d1[1] - t21y * d2[1]) * sign,
+                    (t31y * d1[2] - t21y * d2[2]) * sign,
+                };
+
+                float face_normal[3] = { d1[1] * d2[2] - d1[2] * d2[1], d1[2] * d2[0] - d1[0] * d2[2], d1[0] * d2[1] - d1[1] * d2[0] };
+                bool valid = signed_area != 0.0f && Dot(face_normal, face_normal) > 0.0f && Normalize(os);
+                uint8_t flags = signed_area > 0.0f ? CORNER_PRESERVING : 0;
+
+                for (uint32_t k = 0; k < 3; k++)
+                {
+                    uint32_t corner = t * 3 + k;
+                    float* tangent = &corner_tangents_[corner * 3];
+                    tangent[0] = tangent[1] = tangent[2] = 0.0f;
+                    corner_flags_[corner] = flags;
+                    if (!valid)
+                    {
+                        continue;
+                    }
+
+                    float n[3] = { corners[k]->Normal.x, corners[k]->Normal.y, corners[k]->Normal.z };
+                    Normalize(n);
+
+                    float u[3] = { os[0], os[1], os[2] };
+                    ProjectOnPlane(n, u);
+                    if (!Normalize(u))
+                    {
+                        continue;
+                    }
+
+                    // Angle between the two edges at the corner, measured in the tangent plane.
+                    const float* p = &corners[k]->Position.x;
+                    const float* prev = &corners[(k + 2) % 3]->Position.x;
+                    const float* next = &corners[(k + 1) % 3]->Position.x;
+                    float e0[3] = { prev[0] - p[0], prev[1] - p[1], prev[2] - p[2] };
+                    float e1[3] = { next[0] - p[0], next[1] - p[1], next[2] - p[2] };
+                    ProjectOnPlane(n, e0);
+                    ProjectOnPlane(n, e1);
+                    float length_product_sq = Dot(e0, e0) * Dot(e1, e1);
+                    float cos_angle = length_product_sq > 0.0f ? Dot(e0, e1) / sqrtf(length_product_sq) : 0.0f;
+                    float angle = acosf((std::min)((std::max)(cos_angle, -1.0f), 1.0f));
+
+                    tangent[0] = u[0] * angle;
+                    tangent[1] = u[1] * angle;
+                    tangent[2] = u[2] * angle;
+                    corner_flags_[corner] = flags | CORNER_VALID;
+                }
+            }
+        });
+    }
+
+    void TangentGenerator::GatherCorners(uint32_t vertex_count)
+    {
+        corner_offsets_.assign(vertex_count + 1, 0);
+        for (uint32_t index : indices_)
+        {
+            corner_offsets_[welded_[index] + 1]++;
+        }
+
+        for (uint32_t v = 0; v < vertex_count; v++)
+        {
+            corner_offsets_[v + 1] += corner_offsets_[v];
+        }
+
+        corner_cursors_.assign(corner_offsets_.begin(), corner_offsets_.end() - 1);
+        vertex_corners_.resize(indices_.size());
+        for (uint32_t corner = 0; corner < indices_.size(); corner++)
+        {
+            vertex_corners_[corner_cursors_[welded_[indices_[corner]]]++] = corner;
+        }
+    }
+
+    void TangentGenerator::SumCorners(const std::vector<GeometryGenerator::Vertex>& vertices, TaskScheduler* scheduler)
+    {
+        uint32_t vertex_count = static_cast<uint32_t>(vertices.size());
+        tangents_.resize(vertex_count * 3);
+        split_tangents_.resize(vertex_count * 3);
+        vertex_flags_.resize(vertex_count);
+
+        RunParallel(scheduler, vertex_count, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t v = begin; v < end; v++)
+            {
+                vertex_flags_[v] = 0;
+                if (welded_[v] != v)
+                {
+                    continue;
+                }
+
+                // [0] reversed, [1] preserving.
+                float sums[2][3] = {};
+                float weights[2] = {};
+                uint32_t counts[2] = {};
+                for (uint32_t k = corner_offsets_[v]; k < corner_offsets_[v + 1]; k++)
+                {
+                    uint32_t corner = vertex_corners_[k];
+                    if ((corner_flags_[corner] & CORNER_VALID) == 0)
+                    {
+                        continue;
+                    }
+
+                    uint32_t side = (corner_flags_[corner] & CORNER_PRESERVING) != 0 ? 1 : 0;
+                    sums[side][0] += corner_tangents_[corner * 3 + 0];
+                    sums[side][1] += corner_tangents_[corner * 3 + 1];
+                    sums[side][2] += corner_tangents_[corner * 3 + 2];
+                    weights[side] += sqrtf(Dot(&corner_tangents_[corner * 3], &corner_tangents_[corner * 3]));
+                    counts[side]++;
+                }
+
+                uint32_t major = counts[1] >= counts[0] ? 1 : 0;
+                float* tangent = &tangents_[v * 3];
+                std::copy(sums[major], sums[major] + 3, tangent);
+                if (Dot(tangent, tangent) <= weights[major] * weights[major] * CANCEL_THRESHOLD * CANCEL_THRESHOLD || !Normalize(tangent))
+                {
+                    PerpendicularTangent(vertices[v].Normal, tangent);
+                }
+
+                vertex_flags_[v] = major != 0 ? VERTEX_PRESERVING : 0;
+                if (counts[1 - major] > 0)
+                {
+                    float* split_tangent = &split_tangents_[v * 3];
+                    std::copy(sums[1 - major], sums[1 - major] + 3, split_tangent);
+                    if (Dot(split_tangent, split_tangent) <= weights[1 - major] * weights[1 - major] * CANCEL_THRESHOLD * CANCEL_THRESHOLD || !Normalize(split_tangent))
+                    {
+                        PerpendicularTangent(vertices[v].Normal, split_tangent);
+                    }
+
+                    vertex_flags_[v] |= VERTEX_SPLIT;
+                }
+            }
+        });
+    }
+};
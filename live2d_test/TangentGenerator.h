@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "GeometryGenerator.h"
+
+namespace D3D
+{
+    class TaskScheduler;
+
+    // Per vertex tangents for indexed triangle lists, following MikkTSpace: every triangle corner
+    // gives the u direction of its triangle, projected onto the plane of the vertex normal and
+    // weighted by the corner angle, and the corners of a vertex are summed per uv orientation.
+    // Vertices with equal position, normal and texcoord share their tangent, vertices split by a
+    // uv seam do not. A vertex used by triangles of both orientations, as where a mirrored uv
+    // island meets its other half, is split and the copy takes the triangles of the smaller side.
+    // Triangles and vertices run in parallel, every corner writes its own slot and every vertex
+    // gathers its corners in index order, so the result does not depend on the thread count.
+    // Scratch memory is kept between calls.
+    class TangentGenerator
+    {
+    public:
+        // Fills TangentU of every vertex from Position, Normal and TexC. Vertices without a usable
+        // triangle get a tangent perpendicular to their normal. bitangent_signs, when not null,
+        // gets one sign per vertex for bitangent = sign * cross(normal, tangent). Returns the
+        // number of vertices added by splits, indices turn 32 bit if the new count needs it.
+        uint32_t Generate(GeometryGenerator::MeshData& mesh, TaskScheduler* scheduler = nullptr, std::vector<float>* bitangent_signs = nullptr);
+
+    private:
+        void WeldVertices(const std::vector<GeometryGenerator::Vertex>& vertices);
+        void ComputeCornerTangents(const std::vector<GeometryGenerator::Vertex>& vertices, TaskScheduler* scheduler);
+        void GatherCorners(uint32_t vertex_count);
+        void SumCorners(const std::vector<GeometryGenerator::Vertex>& vertices, TaskScheduler* scheduler);
+
+        // Per vertex.
+        std::vector<uint32_t>                               weld_table_;        // open addressing, twice the vertex count
+        std::vector<uint32_t>                               welded_;            // first vertex with the same attributes
+        std::vector<uint32_t>                               corner_offsets_;
+        std::vector<uint32_t>                               corner_cursors_;
+        std::vector<float>                                  tangents_;          // x, y, z of the larger orientation
+        std::vector<float>                                  split_tangents_;    // of the smaller one, when there is one
+        std::vector<uint8_t>                                vertex_flags_;
+
+        // Per index.
+        std::vector<uint32_t>                               indices_;
+        std::vector<uint32_t>                               vertex_corners_;    // corners of every welded vertex
+        std::vector<float>                                  corner_tangents_;   // x, y, z weighted by the corner angle
+        std::vector<uint8_t>                                corner_flags_;
+    };
+};
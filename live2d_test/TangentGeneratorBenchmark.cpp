@@ -0,0 +1,64 @@
+#include "TangentGenerator.h"
+
+#include <cmath>
+#include <cstdio>
+
+#include "TaskScheduler.h"
+#include "TestHarness.h"
+
+using namespace D3D;
+
+namespace
+{
+    void Run(const char* name, const GeometryGenerator::MeshData& source, TaskScheduler& scheduler)
+    {
+        TangentGenerator tangent_generator;
+        GeometryGenerator::MeshData mesh;
+        uint32_t split_count = 0;
+
+        // Every run starts from the unsplit mesh, the copy is timed apart and taken out.
+        double copy_ms = D3D::Test::MeasureMilliseconds(3, [&]()
+        {
+            mesh = source;
+        });
+
+        double serial_ms = D3D::Test::MeasureMilliseconds(3, [&]()
+        {
+            mesh = source;
+            split_count = tangent_generator.Generate(mesh);
+        }) - copy_ms;
+
+        double parallel_ms = D3D::Test::MeasureMilliseconds(3, [&]()
+        {
+            mesh = source;
+            tangent_generator.Generate(mesh, &scheduler);
+        }) - copy_ms;
+
+        uint32_t triangle_count = static_cast<uint32_t>(source.GetIndexCount() / 3);
+        std::printf("%-20s %8u %8zu %7u %9.2f %7.2f %9.2f %7.2f %6.2fx\n", name, triangle_count, source.Vertices.size(), split_count,
+            serial_ms, triangle_count / serial_ms / 1000.0, parallel_ms, triangle_count / parallel_ms / 1000.0, serial_ms / parallel_ms);
+    }
+}
+
+// Tangent generation on meshes of about a million triangles, serial and on a TaskScheduler with
+// one worker per hardware thread besides the caller. The mirrored grid has a vertex column at x = 0
+// and splits one vertex per row there.
+int main()
+{
+    GeometryGenerator generator;
+    TaskScheduler scheduler;
+    std::printf("%u threads\n", scheduler.GetThreadCount());
+    std::printf("%-20s %8s %8s %7s %9s %7s %9s %7s %7s\n", "mesh", "tris", "verts", "splits", "serial ms", "Mtri/s", "sched ms", "Mtri/s", "speedup");
+
+    Run("sphere 1024x512", generator.CreateSphere(10.0f, 1024, 512), scheduler);
+    Run("geosphere 8", generator.CreateGeosphere(10.0f, 8), scheduler);
+
+    auto mirrored = generator.CreateGrid(20.0f, 20.0f, 725, 725);
+    for (auto& vertex : mirrored.Vertices)
+    {
+        vertex.TexC.x = std::fabs(vertex.Position.x);
+    }
+
+    Run("mirrored grid 725", mirrored, scheduler);
+    return 0;
+}
@@ -0,0 +1,396 @@
+#include "TangentGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "TaskScheduler.h"
+#include "TestHarness.h"
+
+using namespace D3D;
+
+namespace
+{
+    typedef GeometryGenerator::Vertex Vertex;
+    typedef GeometryGenerator::MeshData MeshData;
+
+    const double PI = 3.14159265358979323846;
+
+    double GetAngle(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b)
+    {
+        double dot = double(a.x) * b.x + double(a.y) * b.y + double(a.z) * b.z;
+        double length_a = std::sqrt(double(a.x) * a.x + double(a.y) * a.y + double(a.z) * a.z);
+        double length_b = std::sqrt(double(b.x) * b.x + double(b.y) * b.y + double(b.z) * b.z);
+        return std::acos((std::max)(-1.0, (std::min)(1.0, dot / (length_a * length_b)))) * 180.0 / PI;
+    }
+
+    void Normalize(double v[3])
+    {
+        double length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            v[i] = length > 0.0 ? v[i] / length : 0.0;
+        }
+    }
+
+    // Straight double precision MikkTSpace sum without welding or splitting: per corner, the u
+    // direction of the triangle projected onto the corner normal, weighted by the corner angle.
+    std::vector<double> ComputeReference(const MeshData& mesh)
+    {
+        std::vector<double> tangents(mesh.Vertices.size() * 3, 0.0);
+        for (size_t t = 0; t < mesh.GetIndexCount(); t += 3)
+        {
+            const Vertex* corners[3];
+            uint32_t ids[3];
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                ids[k] = mesh.GetIndex(t + k);
+                corners[k] = &mesh.Vertices[ids[k]];
+            }
+
+            const float* p0 = &corners[0]->Position.x;
+            const float* p1 = &corners[1]->Position.x;
+            const float* p2 = &corners[2]->Position.x;
+            double s1 = double(corners[1]->TexC.x) - corners[0]->TexC.x;
+            double t1 = double(corners[1]->TexC.y) - corners[0]->TexC.y;
+            double s2 = double(corners[2]->TexC.x) - corners[0]->TexC.x;
+            double t2 = double(corners[2]->TexC.y) - corners[0]->TexC.y;
+            double area = s1 * t2 - t1 * s2;
+            if (area == 0.0)
+            {
+                continue;
+            }
+
+            double direction[3];
+            for (uint32_t j = 0; j < 3; j++)
+            {
+                direction[j] = (t2 * (double(p1[j]) - p0[j]) - t1 * (double(p2[j]) - p0[j])) / area;
+            }
+
+            Normalize(direction);
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                double normal[3] = { corners[k]->Normal.x, corners[k]->Normal.y, corners[k]->Normal.z };
+                Normalize(normal);
+
+                double along = direction[0] * normal[0] + direction[1] * normal[1] + direction[2] * normal[2];
+                double u[3];
+                for (uint32_t j = 0; j < 3; j++)
+                {
+                    u[j] = direction[j] - normal[j] * along;
+                }
+
+                Normalize(u);
+
+                // The corner angle measured in the plane of the normal.
+                const float* p = &corners[k]->Position.x;
+                const float* previous = &corners[(k + 2) % 3]->Position.x;
+                const float* next = &corners[(k + 1) % 3]->Position.x;
+                double e0[3];
+                double e1[3];
+                for (uint32_t j = 0; j < 3; j++)
+                {
+                    e0[j] = double(previous[j]) - p[j];
+                    e1[j] = double(next[j]) - p[j];
+                }
+
+                double a0 = e0[0] * normal[0] + e0[1] * normal[1] + e0[2] * normal[2];
+                double a1 = e1[0] * normal[0] + e1[1] * normal[1] + e1[2] * normal[2];
+                for (uint32_t j = 0; j < 3; j++)
+                {
+                    e0[j] -= normal[j] * a0;
+                    e1[j] -= normal[j] * a1;
+                }
+
+                Normalize(e0);
+                Normalize(e1);
+                double angle = std::acos((std::max)(-1.0, (std::min)(1.0, e0[0] * e1[0] + e0[1] * e1[1] + e0[2] * e1[2])));
+                for (uint32_t j = 0; j < 3; j++)
+                {
+                    tangents[ids[k] * 3 + j] += u[j] * angle;
+                }
+            }
+        }
+
+        return tangents;
+    }
+
+    // Largest angle between the bitangent sign * cross(N, T) of every corner and the v direction
+    // of its triangle. Vertices at |y| >= skip_abs_y are left out, as poles have no v direction.
+    double GetMaxBitangentAngle(const MeshData& mesh, const std::vector<float>& signs, float skip_abs_y)
+    {
+        double worst = 0.0;
+        for (size_t t = 0; t < mesh.GetIndexCount(); t += 3)
+        {
+            const Vertex* corners[3];
+            uint32_t ids[3];
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                ids[k] = mesh.GetIndex(t + k);
+                corners[k] = &mesh.Vertices[ids[k]];
+            }
+
+            float s1 = corners[1]->TexC.x - corners[0]->TexC.x;
+            float t1 = corners[1]->TexC.y - corners[0]->TexC.y;
+            float s2 = corners[2]->TexC.x - corners[0]->TexC.x;
+            float t2 = corners[2]->TexC.y - corners[0]->TexC.y;
+            float area = s1 * t2 - t1 * s2;
+            if (area == 0.0f)
+            {
+                continue;
+            }
+
+            const float* p0 = &corners[0]->Position.x;
+            const float* p1 = &corners[1]->Position.x;
+            const float* p2 = &corners[2]->Position.x;
+            DirectX::XMFLOAT3 v_direction(
+                (s1 * (p2[0] - p0[0]) - s2 * (p1[0] - p0[0])) / area,
+                (s1 * (p2[1] - p0[1]) - s2 * (p1[1] - p0[1])) / area,
+                (s1 * (p2[2] - p0[2]) - s2 * (p1[2] - p0[2])) / area);
+
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                if (std::fabs(corners[k]->Position.y) >= skip_abs_y)
+                {
+                    continue;
+                }
+
+                auto& n = corners[k]->Normal;
+                auto& u = corners[k]->TangentU;
+                float sign = signs[ids[k]];
+                DirectX::XMFLOAT3 bitangent(sign * (n.y * u.z - n.z * u.y), sign * (n.z * u.x - n.x * u.z), sign * (n.x * u.y - n.y * u.x));
+                worst = (std::max)(worst, GetAngle(bitangent, v_direction));
+            }
+        }
+
+        return worst;
+    }
+
+    // A grid whose u runs away from x = 0 on both sides, a mirrored uv island.
+    MeshData CreateMirroredGrid(GeometryGenerator& generator, uint32_t n)
+    {
+        auto mesh = generator.CreateGrid(2.0f, 2.0f, n, n);
+        for (auto& vertex : mesh.Vertices)
+        {
+            vertex.TexC.x = std::fabs(vertex.Position.x);
+        }
+
+        return mesh;
+    }
+
+    bool IsUnitAndPerpendicular(const MeshData& mesh)
+    {
+        for (auto& vertex : mesh.Vertices)
+        {
+            auto& u = vertex.TangentU;
+            auto& n = vertex.Normal;
+            float length = std::sqrt(u.x * u.x + u.y * u.y + u.z * u.z);
+            if (std::fabs(length - 1.0f) > 1e-5f || std::fabs(u.x * n.x + u.y * n.y + u.z * n.z) > 1e-5f)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void TestGeneratorMeshes()
+    {
+        // The generators write analytic tangents. Sphere and cylinder tangents follow the slices,
+        // so on the uv seam column the one-sided sum is off by half a slice, and at the poles and
+        // cap rims the triangle u directions cancel; those vertices are checked separately.
+        struct Case
+        {
+            MeshData mesh;
+            float skip_abs_y;
+            double seam_tolerance;
+        };
+
+        GeometryGenerator generator;
+        Case cases[] =
+        {
+            { generator.CreateGrid(4.0f, 3.0f, 17, 9), 1e30f, 0.0 },
+            { generator.CreateBox(2.0f, 3.0f, 4.0f, 2), 1e30f, 0.0 },
+            { generator.CreateSphere(1.5f, 32, 24), 1.48f, 180.0 / 32 + 0.01 },
+            { generator.CreateCylinder(1.0f, 1.0f, 2.0f, 24, 4), 0.999f, 180.0 / 24 + 0.01 },
+        };
+
+        TangentGenerator tangent_generator;
+        for (auto& test_case : cases)
+        {
+            auto mesh = test_case.mesh;
+            std::vector<float> signs;
+            TEST_CHECK(tangent_generator.Generate(mesh, nullptr, &signs) == 0);
+            TEST_CHECK(mesh.Vertices.size() == test_case.mesh.Vertices.size() && signs.size() == mesh.Vertices.size());
+            TEST_CHECK(IsUnitAndPerpendicular(mesh));
+
+            double analytic = 0.0;
+            double seam = 0.0;
+            for (size_t i = 0; i < mesh.Vertices.size(); i++)
+            {
+                auto& vertex = test_case.mesh.Vertices[i];
+                if (std::fabs(vertex.Position.y) >= test_case.skip_abs_y)
+                {
+                    continue;
+                }
+
+                double angle = GetAngle(vertex.TangentU, mesh.Vertices[i].TangentU);
+                bool on_seam = test_case.seam_tolerance > 0.0 && (vertex.TexC.x == 0.0f || vertex.TexC.x == 1.0f);
+                (on_seam ? seam : analytic) = (std::max)(on_seam ? seam : analytic, angle);
+            }
+
+            TEST_CHECK(analytic < 0.01);
+            TEST_CHECK(seam <= test_case.seam_tolerance);
+
+            // Against the double precision sum wherever it does not cancel.
+            auto reference = ComputeReference(test_case.mesh);
+            double worst = 0.0;
+            for (size_t i = 0; i < mesh.Vertices.size(); i++)
+            {
+                DirectX::XMFLOAT3 expected(float(reference[i * 3]), float(reference[i * 3 + 1]), float(reference[i * 3 + 2]));
+                if (expected.x * expected.x + expected.y * expected.y + expected.z * expected.z > 1e-8f)
+                {
+                    worst = (std::max)(worst, GetAngle(expected, mesh.Vertices[i].TangentU));
+                }
+            }
+
+            TEST_CHECK(worst < 1e-3);
+            TEST_CHECK(GetMaxBitangentAngle(mesh, signs, test_case.skip_abs_y) < 45.0);
+        }
+
+        // Pole tangents cancel and fall back to one perpendicular to the normal.
+        auto sphere = generator.CreateSphere(1.0f, 32, 24);
+        tangent_generator.Generate(sphere);
+        auto& pole = sphere.Vertices[0].TangentU;
+        TEST_CHECK(std::fabs(pole.y) < 1e-6f && std::fabs(pole.x * pole.x + pole.z * pole.z - 1.0f) < 1e-5f);
+    }
+
+    void TestMirroredUvs()
+    {
+        // The middle column is used by triangles of both orientations and splits, one vertex
+        // per row. Each side then gets the tangent of its own u direction.
+        GeometryGenerator generator;
+        auto mesh = CreateMirroredGrid(generator, 9);
+        size_t vertex_count = mesh.Vertices.size();
+
+        TangentGenerator tangent_generator;
+        std::vector<float> signs;
+        TEST_CHECK(tangent_generator.Generate(mesh, nullptr, &signs) == 9);
+        TEST_CHECK(mesh.Vertices.size() == vertex_count + 9);
+
+        bool sides = true;
+        for (size_t t = 0; t < mesh.GetIndexCount(); t += 3)
+        {
+            float center_x = 0.0f;
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                center_x += mesh.Vertices[mesh.GetIndex(t + k)].Position.x;
+            }
+
+            float expected = center_x > 0.0f ? 1.0f : -1.0f;
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                sides = sides && std::fabs(mesh.Vertices[mesh.GetIndex(t + k)].TangentU.x - expected) < 1e-5f;
+            }
+        }
+
+        TEST_CHECK(sides);
+        TEST_CHECK(GetMaxBitangentAngle(mesh, signs, 1e30f) < 1e-3);
+    }
+
+    void TestSplitWidensIndices()
+    {
+        // 65536 vertices plus the splits no longer fit 16 bit indices.
+        GeometryGenerator generator;
+        auto mesh = CreateMirroredGrid(generator, 256);
+        TEST_CHECK(!mesh.Use32BitIndices);
+
+        TangentGenerator tangent_generator;
+        TEST_CHECK(tangent_generator.Generate(mesh) == 256);
+        TEST_CHECK(mesh.Use32BitIndices && mesh.Indices16.empty());
+        TEST_CHECK(*std::max_element(mesh.Indices32.begin(), mesh.Indices32.end()) == mesh.Vertices.size() - 1);
+    }
+
+    void TestWelding()
+    {
+        // One vertex per corner gives the same tangents as the indexed mesh.
+        GeometryGenerator generator;
+        auto indexed = generator.CreateSphere(1.0f, 24, 16);
+        MeshData unwelded;
+        for (size_t i = 0; i < indexed.GetIndexCount(); i++)
+        {
+            unwelded.Vertices.push_back(indexed.Vertices[indexed.GetIndex(i)]);
+        }
+
+        unwelded.ResizeIndices(indexed.GetIndexCount(), unwelded.Vertices.size());
+        for (size_t i = 0; i < indexed.GetIndexCount(); i++)
+        {
+            unwelded.Indices16[i] = static_cast<uint16_t>(i);
+        }
+
+        TangentGenerator tangent_generator;
+        tangent_generator.Generate(indexed);
+        tangent_generator.Generate(unwelded);
+
+        double worst = 0.0;
+        for (size_t i = 0; i < indexed.GetIndexCount(); i++)
+        {
+            worst = (std::max)(worst, GetAngle(unwelded.Vertices[i].TangentU, indexed.Vertices[indexed.GetIndex(i)].TangentU));
+        }
+
+        TEST_CHECK(worst < 1e-3);
+    }
+
+    void TestDegenerate()
+    {
+        // No uv area, the tangent still ends up perpendicular to the normal.
+        MeshData mesh;
+        Vertex vertex(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+        mesh.Vertices.push_back(vertex);
+        vertex.Position = DirectX::XMFLOAT3(1.0f, 0.0f, 0.0f);
+        mesh.Vertices.push_back(vertex);
+        vertex.Position = DirectX::XMFLOAT3(0.0f, 0.0f, 1.0f);
+        mesh.Vertices.push_back(vertex);
+        mesh.Indices16 = { 0, 1, 2 };
+
+        TangentGenerator tangent_generator;
+        TEST_CHECK(tangent_generator.Generate(mesh) == 0);
+        TEST_CHECK(IsUnitAndPerpendicular(mesh));
+
+        MeshData empty;
+        TEST_CHECK(tangent_generator.Generate(empty) == 0);
+    }
+
+    void TestThreadCountIndependence()
+    {
+        GeometryGenerator generator;
+        MeshData meshes[] = { generator.CreateSphere(1.0f, 256, 128), CreateMirroredGrid(generator, 300) };
+        for (auto& source : meshes)
+        {
+            TangentGenerator tangent_generator;
+            auto serial = source;
+            tangent_generator.Generate(serial);
+
+            for (uint32_t worker_count : { 1u, 3u })
+            {
+                TaskScheduler scheduler(worker_count);
+                auto parallel = source;
+                tangent_generator.Generate(parallel, &scheduler);
+                TEST_CHECK(parallel.Vertices.size() == serial.Vertices.size());
+                TEST_CHECK(::memcmp(parallel.Vertices.data(), serial.Vertices.data(), serial.Vertices.size() * sizeof(Vertex)) == 0);
+                TEST_CHECK(parallel.Indices16 == serial.Indices16 && parallel.Indices32 == serial.Indices32);
+            }
+        }
+    }
+}
+
+int main()
+{
+    TestGeneratorMeshes();
+    TestMirroredUvs();
+    TestSplitWidensIndices();
+    TestWelding();
+    TestDegenerate();
+    TestThreadCountIndependence();
+    return D3D::Test::Finish("TangentGeneratorTests");
+}
@@ -0,0 +1,147 @@
+#include "TaskScheduler.h"
+
+#include <algorithm>
+
+namespace D3D
+{
+    namespace
+    {
+        thread_local bool in_parallel_job = false;
+
+        // Chunks per thread, so uneven chunks still balance out.
+        const uint32_t CHUNKS_PER_THREAD = 4;
+    }
+
+    TaskScheduler& TaskScheduler::GetScheduler()
+    {
+        static TaskScheduler scheduler;
+        return scheduler;
+    }
+
+    TaskScheduler::TaskScheduler(uint32_t worker_count)
+    {
+        if (worker_count == 0)
+        {
+            uint32_t hardware_count = std::thread::hardware_concurrency();
+            worker_count = hardware_count > 1 ? hardware_count - 1 : 0;
+        }
+
+        workers_.reserve(worker_count);
+        for (uint32_t i = 0; i < worker_count; i++)
+        {
+            workers_.emplace_back(&TaskScheduler::WorkerLoop, this);
+        }
+    }
+
+    TaskScheduler::~TaskScheduler()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            shutdown_ = true;
+        }
+
+        work_cv_.notify_all();
+        for (auto& worker : workers_)
+        {
+            worker.join();
+        }
+    }
+
+    uint32_t TaskScheduler::GetThreadCount() const
+    {
+        return static_cast<uint32_t>(workers_.size()) + 1;
+    }
+
+    void TaskScheduler::ParallelFor(uint32_t count, uint32_t grain_size, const RangeFunction& func)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        grain_size = (std::max)(grain_size, 1u);
+        uint32_t thread_count = GetThreadCount();
+        if (in_parallel_job || thread_count == 1 || count <= grain_size)
+        {
+            func(0, count);
+            return;
+        }
+
+        uint32_t chunk_size = (count + thread_count * CHUNKS_PER_THREAD - 1) / (thread_count * CHUNKS_PER_THREAD);
+        chunk_size = (std::max)(chunk_size, grain_size);
+
+        std::lock_guard<std::mutex> submit_lock(submit_mutex_);
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+
+            // A worker that woke up late for the previous job may still be reading its fields.
+            done_cv_.wait(lock, [this]() { return busy_workers_ == 0; });
+
+            job_func_ = &func;
+            job_count_ = count;
+            job_chunk_size_ = chunk_size;
+            job_chunk_count_ = (count + chunk_size - 1) / chunk_size;
+            job_next_chunk_.store(0);
+            job_finished_chunks_.store(0);
+            generation_++;
+        }
+
+        work_cv_.notify_all();
+
+        in_parallel_job = true;
+        RunChunks();
+        in_parallel_job = false;
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_cv_.wait(lock, [this]() { return job_finished_chunks_.load() == job_chunk_count_ && busy_workers_ == 0; });
+        job_func_ = nullptr;
+    }
+
+    void TaskScheduler::WorkerLoop()
+    {
+        uint64_t seen_generation{ 0 };
+        in_parallel_job = true;
+
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                work_cv_.wait(lock, [&]() { return shutdown_ || generation_ != seen_generation; });
+                if (shutdown_)
+                {
+                    return;
+                }
+
+                seen_generation = generation_;
+                busy_workers_++;
+            }
+
+            RunChunks();
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                busy_workers_--;
+            }
+
+            done_cv_.notify_all();
+        }
+    }
+
+    void TaskScheduler::RunChunks()
+    {
+        for (;;)
+        {
+            uint32_t chunk = job_next_chunk_.fetch_add(1);
+            if (chunk >= job_chunk_count_)
+            {
+                return;
+            }
+
+            uint32_t begin = chunk * job_chunk_size_;
+            uint32_t end = (std::min)(begin + job_chunk_size_, job_count_);
+            (*job_func_)(begin, end);
+
+            job_finished_chunks_.fetch_add(1);
+        }
+    }
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace D3D
+{
+    // Small fixed pool of worker threads for data parallel CPU work. ParallelFor splits a range
+    // into chunks, the calling thread takes chunks as well and returns once all of them ran.
+    // Calls made from inside a running job execute serially on the calling thread.
+    class TaskScheduler
+    {
+    public:
+        using RangeFunction = std::function<void(uint32_t begin, uint32_t end)>;
+
+        static TaskScheduler& GetScheduler();
+
+        // worker_count == 0 uses one worker per hardware thread besides the caller.
+        explicit TaskScheduler(uint32_t worker_count = 0);
+        ~TaskScheduler();
+
+        TaskScheduler(const TaskScheduler&) = delete;
+        TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+        // Threads that take part in a ParallelFor, the caller included.
+        uint32_t GetThreadCount() const;
+
+        void ParallelFor(uint32_t count, uint32_t grain_size, const RangeFunction& func);
+
+    private:
+        void WorkerLoop();
+        void RunChunks();
+
+        std::vector<std::thread>                            workers_;
+        std::mutex                                          mutex_;
+        std::mutex                                          submit_mutex_;
+        std::condition_variable                             work_cv_;
+        std::condition_variable                             done_cv_;
+        uint64_t                                            generation_ = 0;
+        uint32_t                                            busy_workers_ = 0;
+        bool                                                shutdown_ = false;
+
+        const RangeFunction*                                job_func_ = nullptr;
+        uint32_t                                            job_count_ = 0;
+        uint32_t                                            job_chunk_size_ = 0;
+        uint32_t                                            job_chunk_count_ = 0;
+        std::atomic<uint32_t>                               job_next_chunk_{ 0 };
+        std::atomic<uint32_t>                               job_finished_chunks_{ 0 };
+    };
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// Minimal checks and timing for the Linux test executables. A test is a main() that runs its
+// checks and returns D3D::Test::Finish(), ctest treats a non zero exit code as a failure.
+namespace D3D
+{
+    namespace Test
+    {
+        inline int& GetFailureCount()
+        {
+            static int failure_count = 0;
+            return failure_count;
+        }
+
+        inline void Fail(const char* file, int line, const char* expression)
+        {
+            std::printf("%s:%d: check failed: %s\n", file, line, expression);
+            GetFailureCount()++;
+        }
+
+        inline int Finish(const char* name)
+        {
+            int failure_count = GetFailureCount();
+            std::printf("%s: %s\n", name, failure_count == 0 ? "passed" : "FAILED");
+            return failure_count == 0 ? 0 : 1;
+        }
+
+        // Fastest of repeat_count runs of fn in milliseconds, the first run warms the caches.
+        template<typename Fn>
+        double MeasureMilliseconds(uint32_t repeat_count, Fn fn)
+        {
+            double best = 1e30;
+            for (uint32_t i = 0; i < repeat_count + 1; i++)
+            {
+                auto start = std::chrono::steady_clock::now();
+                fn();
+                std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+                if (i > 0 || repeat_count == 0)
+                {
+                    best = (std::min)(best, elapsed.count());
+                }
+            }
+
+            return best;
+        }
+    }
+};
+
+#define TEST_CHECK(expression) \
+    do { if (!(expression)) D3D::Test::Fail(__FILE__, __LINE__, #expression); } while (0)
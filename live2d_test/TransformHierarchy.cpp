@@ -0,0 +1,411 @@
+#include "TransformHierarchy.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "SimdMath.h"
+#include "TaskScheduler.h"
+
+namespace D3D
+{
+    namespace
+    {
+        const uint32_t SIMD_WIDTH = 4;
+
+        // In groups of four nodes, levels smaller than this are updated on the calling thread.
+        const uint32_t GROUP_GRAIN_SIZE = 64;
+
+        const TransformMatrix IDENTITY_MATRIX =
+        {
+            {
+                { 1.0f, 0.0f, 0.0f, 0.0f },
+                { 0.0f, 1.0f, 0.0f, 0.0f },
+                { 0.0f, 0.0f, 1.0f, 0.0f },
+                { 0.0f, 0.0f, 0.0f, 1.0f },
+            }
+        };
+
+        template<typename T>
+        void Permute(std::vector<T>& values, const std::vector<uint32_t>& order)
+        {
+            std::vector<T> sorted(values.size());
+            for (size_t i = 0; i < order.size(); i++)
+            {
+                sorted[i] = values[order[i]];
+            }
+
+            values.swap(sorted);
+        }
+    }
+
+    void TransformHierarchy::Clear()
+    {
+        scale_x_.clear();
+        scale_y_.clear();
+        scale_z_.clear();
+        rotation_x_.clear();
+        rotation_y_.clear();
+        rotation_z_.clear();
+        rotation_w_.clear();
+        translation_x_.clear();
+        translation_y_.clear();
+        translation_z_.clear();
+
+        world_matrices_.clear();
+        parent_slots_.clear();
+        depths_.clear();
+        dirty_.clear();
+
+        node_slots_.clear();
+        slot_nodes_.clear();
+        level_offsets_.clear();
+        layout_dirty_ = false;
+        depths_dirty_ = false;
+    }
+
+    void TransformHierarchy::Reserve(uint32_t node_count)
+    {
+        scale_x_.reserve(node_count);
+        scale_y_.reserve(node_count);
+        scale_z_.reserve(node_count);
+        rotation_x_.reserve(node_count);
+        rotation_y_.reserve(node_count);
+        rotation_z_.reserve(node_count);
+        rotation_w_.reserve(node_count);
+        translation_x_.reserve(node_count);
+        translation_y_.reserve(node_count);
+        translation_z_.reserve(node_count);
+
+        world_matrices_.reserve(node_count);
+        parent_slots_.reserve(node_count);
+        depths_.reserve(node_count);
+        dirty_.reserve(node_count);
+
+        node_slots_.reserve(node_count);
+        slot_nodes_.reserve(node_count);
+    }
+
+    uint32_t TransformHierarchy::AddNode(uint32_t parent)
+    {
+        assert(parent == INVALID_NODE || parent < GetNodeCount());
+
+        uint32_t node = GetNodeCount();
+        uint32_t parent_slot = parent == INVALID_NODE ? INVALID_NODE : node_slots_[parent];
+
+        scale_x_.push_back(1.0f);
+        scale_y_.push_back(1.0f);
+        scale_z_.push_back(1.0f);
+        rotation_x_.push_back(0.0f);
+        rotation_y_.push_back(0.0f);
+        rotation_z_.push_back(0.0f);
+        rotation_w_.push_back(1.0f);
+        translation_x_.push_back(0.0f);
+        translation_y_.push_back(0.0f);
+        translation_z_.push_back(0.0f);
+
+        world_matrices_.push_back(IDENTITY_MATRIX);
+        parent_slots_.push_back(parent_slot);
+        depths_.push_back(parent_slot == INVALID_NODE ? 0 : depths_[parent_slot] + 1);
+        dirty_.push_back(1);
+
+        // New nodes are appended to the storage, the depth order is restored lazily.
+        node_slots_.push_back(node);
+        slot_nodes_.push_back(node);
+        layout_dirty_ = true;
+
+        return node;
+    }
+
+    void TransformHierarchy::SetParent(uint32_t node, uint32_t parent)
+    {
+        assert(parent == INVALID_NODE || parent < GetNodeCount());
+
+        uint32_t slot = node_slots_[node];
+        uint32_t parent_slot = parent == INVALID_NODE ? INVALID_NODE : node_slots_[parent];
+#ifndef NDEBUG
+        for (uint32_t ancestor = parent_slot; ancestor != INVALID_NODE; ancestor = parent_slots_[ancestor])
+        {
+            assert(ancestor != slot);
+        }
+#endif
+
+        parent_slots_[slot] = parent_slot;
+        dirty_[slot] = 1;
+
+        // The depths of the whole subtree change, they are worked out again with the layout.
+        depths_dirty_ = true;
+        layout_dirty_ = true;
+    }
+
+    void TransformHierarchy::SetLocalScale(uint32_t node, float x, float y, float z)
+    {
+        uint32_t slot = node_slots_[node];
+        scale_x_[slot] = x;
+        scale_y_[slot] = y;
+        scale_z_[slot] = z;
+        dirty_[slot] = 1;
+    }
+
+    void TransformHierarchy::SetLocalRotation(uint32_t node, float x, float y, float z, float w)
+    {
+        uint32_t slot = node_slots_[node];
+        rotation_x_[slot] = x;
+        rotation_y_[slot] = y;
+        rotation_z_[slot] = z;
+        rotation_w_[slot] = w;
+        dirty_[slot] = 1;
+    }
+
+    void TransformHierarchy::SetLocalTranslation(uint32_t node, float x, float y, float z)
+    {
+        uint32_t slot = node_slots_[node];
+        translation_x_[slot] = x;
+        translation_y_[slot] = y;
+        translation_z_[slot] = z;
+        dirty_[slot] = 1;
+    }
+
+    void TransformHierarchy::GetLocalScale(uint32_t node, float& x, float& y, float& z) const
+    {
+        uint32_t slot = node_slots_[node];
+        x = scale_x_[slot];
+        y = scale_y_[slot];
+        z = scale_z_[slot];
+    }
+
+    void TransformHierarchy::GetLocalTranslation(uint32_t node, float& x, float& y, float& z) const
+    {
+        uint32_t slot = node_slots_[node];
+        x = translation_x_[slot];
+        y = translation_y_[slot];
+        z = translation_z_[slot];
+    }
+
+    uint32_t TransformHierarchy::GetNodeCount() const
+    {
+        return static_cast<uint32_t>(node_slots_.size());
+    }
+
+    uint32_t TransformHierarchy::GetParent(uint32_t node) const
+    {
+        uint32_t parent_slot = parent_slots_[node_slots_[node]];
+        return parent_slot == INVALID_NODE ? INVALID_NODE : slot_nodes_[parent_slot];
+    }
+
+    const TransformMatrix& TransformHierarchy::GetWorldMatrix(uint32_t node) const
+    {
+        return world_matrices_[node_slots_[node]];
+    }
+
+    void TransformHierarchy::Update(TaskScheduler* scheduler)
+    {
+        if (layout_dirty_)
+        {
+            RebuildLayout();
+        }
+
+        // A level only reads the world matrices and dirty flags of the one above it.
+        for (size_t level = 0; level + 1 < level_offsets_.size(); level++)
+        {
+            uint32_t level_begin = level_offsets_[level];
+            uint32_t level_end = level_offsets_[level + 1];
+            uint32_t group_count = (level_end - level_begin + SIMD_WIDTH - 1) / SIMD_WIDTH;
+
+            auto update_groups = [this, level_begin, level_end](uint32_t begin, uint32_t end)
+            {
+                for (uint32_t group = begin; group < end; group++)
+                {
+                    uint32_t first_slot = level_begin + group * SIMD_WIDTH;
+                    UpdateGroup(first_slot, (std::min)(SIMD_WIDTH, level_end - first_slot));
+                }
+            };
+
+            if (scheduler != nullptr && group_count > GROUP_GRAIN_SIZE)
+            {
+                scheduler->ParallelFor(group_count, GROUP_GRAIN_SIZE, update_groups);
+            }
+            else
+            {
+                update_groups(0, group_count);
+            }
+        }
+
+        if (!dirty_.empty())
+        {
+            ::memset(dirty_.data(), 0, dirty_.size());
+        }
+    }
+
+    void TransformHierarchy::RebuildLayout()
+    {
+        if (depths_dirty_)
+        {
+            RebuildDepths();
+        }
+
+        uint32_t count = GetNodeCount();
+
+        // A stable sort by depth keeps siblings in the order they were added.
+        sort_keys_.assign(depths_.begin(), depths_.end());
+        sort_slots_.resize(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            sort_slots_[i] = i;
+        }
+
+        sorter_.Sort(sort_keys_.data(), sort_slots_.data(), count);
+
+        // Parent links are moved to the new slots while slot_nodes_ still describes the old ones.
+        for (uint32_t slot = 0; slot < count; slot++)
+        {
+            node_slots_[slot_nodes_[sort_slots_[slot]]] = slot;
+        }
+
+        for (uint32_t slot = 0; slot < count; slot++)
+        {
+            uint32_t parent_slot = parent_slots_[slot];
+            if (parent_slot != INVALID_NODE)
+            {
+                parent_slots_[slot] = node_slots_[slot_nodes_[parent_slot]];
+            }
+        }
+
+        Permute(scale_x_, sort_slots_);
+        Permute(scale_y_, sort_slots_);
+        Permute(scale_z_, sort_slots_);
+        Permute(rotation_x_, sort_slots_);
+        Permute(rotation_y_, sort_slots_);
+        Permute(rotation_z_, sort_slots_);
+        Permute(rotation_w_, sort_slots_);
+        Permute(translation_x_, sort_slots_);
+        Permute(translation_y_, sort_slots_);
+        Permute(translation_z_, sort_slots_);
+        Permute(world_matrices_, sort_slots_);
+        Permute(parent_slots_, sort_slots_);
+        Permute(dirty_, sort_slots_);
+        Permute(slot_nodes_, sort_slots_);
+        depths_.swap(sort_keys_);
+
+        level_offsets_.clear();
+        for (uint32_t slot = 0; slot < count; slot++)
+        {
+            while (level_offsets_.size() <= depths_[slot])
+            {
+                level_offsets_.push_back(slot);
+            }
+        }
+
+        level_offsets_.push_back(count);
+        layout_dirty_ = false;
+    }
+
+    void TransformHierarchy::RebuildDepths()
+    {
+        uint32_t count = GetNodeCount();
+        depths_.assign(count, INVALID_NODE);
+
+        // Walks up to the first ancestor whose depth is known, then numbers the path back down,
+        // so every node is visited once however the slots are ordered.
+        std::vector<uint32_t> path;
+        for (uint32_t slot = 0; slot < count; slot++)
+        {
+            uint32_t ancestor = slot;
+            while (ancestor != INVALID_NODE && depths_[ancestor] == INVALID_NODE)
+            {
+                path.push_back(ancestor);
+                ancestor = parent_slots_[ancestor];
+            }
+
+            uint32_t depth = ancestor == INVALID_NODE ? 0 : depths_[ancestor] + 1;
+            for (size_t i = path.size(); i-- > 0; depth++)
+            {
+                depths_[path[i]] = depth;
+            }
+
+            path.clear();
+        }
+
+        depths_dirty_ = false;
+    }
+
+    void TransformHierarchy::UpdateGroup(uint32_t first_slot, uint32_t lane_count)
+    {
+        uint32_t dirty_lanes{ 0 };
+        for (uint32_t lane = 0; lane < lane_count; lane++)
+        {
+            uint32_t slot = first_slot + lane;
+            uint32_t parent_slot = parent_slots_[slot];
+            if (parent_slot != INVALID_NODE && dirty_[parent_slot])
+            {
+                dirty_[slot] = 1;
+            }
+
+            dirty_lanes |= dirty_[slot] << lane;
+        }
+
+        if (dirty_lanes == 0)
+        {
+            return;
+        }
+
+        Simd::Float4 rows[9];
+        TransformKernels::ScaledRotationRows(
+            Simd::LoadPartial(&scale_x_[first_slot], lane_count), Simd::LoadPartial(&scale_y_[first_slot], lane_count), Simd::LoadPartial(&scale_z_[first_slot], lane_count),
+            Simd::LoadPartial(&rotation_x_[first_slot], lane_count), Simd::LoadPartial(&rotation_y_[first_slot], lane_count),
+            Simd::LoadPartial(&rotation_z_[first_slot], lane_count), Simd::LoadPartial(&rotation_w_[first_slot], lane_count),
+            rows);
+
+        float local[9][SIMD_WIDTH];
+        for (uint32_t i = 0; i < 9; i++)
+        {
+            Simd::Store(local[i], rows[i]);
+        }
+
+        for (uint32_t lane = 0; lane < lane_count; lane++)
+        {
+            if ((dirty_lanes & (1u << lane)) == 0)
+            {
+                continue;
+            }
+
+            uint32_t slot = first_slot + lane;
+            auto& world = world_matrices_[slot];
+            uint32_t parent_slot = parent_slots_[slot];
+
+            if (parent_slot == INVALID_NODE)
+            {
+                for (uint32_t row = 0; row < 3; row++)
+                {
+                    Simd::Store(world.m[row], Simd::Set(local[row * 3][lane], local[row * 3 + 1][lane], local[row * 3 + 2][lane], 0.0f));
+                }
+
+                Simd::Store(world.m[3], Simd::Set(translation_x_[slot], translation_y_[slot], translation_z_[slot], 1.0f));
+                continue;
+            }
+
+            // world = local * parent_world, one matrix row per SIMD register.
+            auto& parent = world_matrices_[parent_slot];
+            Simd::Float4 parent_rows[4] =
+            {
+                Simd::Load(parent.m[0]),
+                Simd::Load(parent.m[1]),
+                Simd::Load(parent.m[2]),
+                Simd::Load(parent.m[3]),
+            };
+
+            for (uint32_t row = 0; row < 3; row++)
+            {
+                Simd::Float4 value = Simd::Mul(Simd::Set1(local[row * 3][lane]), parent_rows[0]);
+                value = Simd::MulAdd(Simd::Set1(local[row * 3 + 1][lane]), parent_rows[1], value);
+                value = Simd::MulAdd(Simd::Set1(local[row * 3 + 2][lane]), parent_rows[2], value);
+                Simd::Store(world.m[row], value);
+            }
+
+            Simd::Float4 value = Simd::MulAdd(Simd::Set1(translation_x_[slot]), parent_rows[0], parent_rows[3]);
+            value = Simd::MulAdd(Simd::Set1(translation_y_[slot]), parent_rows[1], value);
+            value = Simd::MulAdd(Simd::Set1(translation_z_[slot]), parent_rows[2], value);
+            Simd::Store(world.m[3], value);
+        }
+    }
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "RadixSort.h"
+#include "TransformKernels.h"
+
+namespace D3D
+{
+    class TaskScheduler;
+
+    // Parent/child transforms for parts that move together. Local scale, rotation (unit
+    // quaternion) and translation are kept as structure-of-arrays and the nodes are stored sorted
+    // by depth, so parents always come before their children and every depth level can be
+    // updated in parallel, four nodes per SIMD batch. Update only recomputes the world matrices
+    // of the nodes that changed and of everything below them.
+    class TransformHierarchy
+    {
+    public:
+        static const uint32_t INVALID_NODE = 0xffffffff;
+
+        void Clear();
+        void Reserve(uint32_t node_count);
+
+        // parent is INVALID_NODE for a root or a node added earlier. Node ids stay stable, the
+        // storage is re-sorted by depth on the next Update.
+        uint32_t AddNode(uint32_t parent = INVALID_NODE);
+
+        // Moves a node and everything below it under another parent, or makes it a root. parent
+        // must not be the node itself or one of its descendants. The local transform is kept,
+        // so the world matrices follow the new parent.
+        void SetParent(uint32_t node, uint32_t parent);
+
+        void SetLocalScale(uint32_t node, float x, float y, float z);
+        void SetLocalRotation(uint32_t node, float x, float y, float z, float w);
+        void SetLocalTranslation(uint32_t node, float x, float y, float z);
+        void GetLocalScale(uint32_t node, float& x, float& y, float& z) const;
+        void GetLocalTranslation(uint32_t node, float& x, float& y, float& z) const;
+
+        uint32_t GetNodeCount() const;
+        uint32_t GetParent(uint32_t node) const;
+
+        // Valid after Update.
+        const TransformMatrix& GetWorldMatrix(uint32_t node) const;
+
+        void Update(TaskScheduler* scheduler = nullptr);
+
+    private:
+        void RebuildLayout();
+        void RebuildDepths();
+        void UpdateGroup(uint32_t first_slot, uint32_t lane_count);
+
+        // Local transforms by slot.
+        std::vector<float>                                  scale_x_;
+        std::vector<float>                                  scale_y_;
+        std::vector<float>                                  scale_z_;
+        std::vector<float>                                  rotation_x_;
+        std::vector<float>                                  rotation_y_;
+        std::vector<float>                                  rotation_z_;
+        std::vector<float>                                  rotation_w_;
+        std::vector<float>                                  translation_x_;
+        std::vector<float>                                  translation_y_;
+        std::vector<float>                                  translation_z_;
+
+        std::vector<TransformMatrix>                        world_matrices_;
+        std::vector<uint32_t>                               parent_slots_;
+        std::vector<uint32_t>                               depths_;
+        std::vector<uint8_t>                                dirty_;
+
+        std::vector<uint32_t>                               node_slots_;
+        std::vector<uint32_t>                               slot_nodes_;
+        std::vector<uint32_t>                               level_offsets_;
+        bool                                                layout_dirty_ = false;
+        bool                                                depths_dirty_ = false;
+
+        RadixSorter                                         sorter_;
+        std::vector<uint32_t>                               sort_keys_;
+        std::vector<uint32_t>                               sort_slots_;
+    };
+};
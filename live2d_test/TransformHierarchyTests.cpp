@@ -0,0 +1,273 @@
+#include "TransformHierarchy.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "TaskScheduler.h"
+#include "TestHarness.h"
+
+using namespace D3D;
+
+namespace
+{
+    float Random(uint32_t& seed)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / 16777216.0f;
+    }
+
+    struct Transform
+    {
+        float scale[3];
+        float rotation[4];
+        float translation[3];
+    };
+
+    typedef double Matrix[4][4];
+
+    // What the hierarchy is told, kept on the side: parents by node id and local transforms.
+    struct Scene
+    {
+        TransformHierarchy hierarchy;
+        std::vector<uint32_t> parents;
+        std::vector<Transform> locals;
+
+        void Add(uint32_t parent, uint32_t& seed)
+        {
+            uint32_t node = hierarchy.AddNode(parent);
+            parents.push_back(parent);
+            locals.push_back(Transform());
+            Set(node, seed);
+        }
+
+        void Set(uint32_t node, uint32_t& seed)
+        {
+            Transform& local = locals[node];
+            for (uint32_t i = 0; i < 3; i++)
+            {
+                local.scale[i] = 0.8f + 0.4f * Random(seed);
+                local.translation[i] = Random(seed) * 2.0f - 1.0f;
+            }
+
+            float length = 0.0f;
+            for (uint32_t i = 0; i < 4; i++)
+            {
+                local.rotation[i] = Random(seed) * 2.0f - 1.0f;
+                length += local.rotation[i] * local.rotation[i];
+            }
+
+            length = std::sqrt(length);
+            for (uint32_t i = 0; i < 4; i++)
+            {
+                local.rotation[i] /= length;
+            }
+
+            hierarchy.SetLocalScale(node, local.scale[0], local.scale[1], local.scale[2]);
+            hierarchy.SetLocalRotation(node, local.rotation[0], local.rotation[1], local.rotation[2], local.rotation[3]);
+            hierarchy.SetLocalTranslation(node, local.translation[0], local.translation[1], local.translation[2]);
+        }
+
+        bool IsBelow(uint32_t node, uint32_t ancestor) const
+        {
+            for (; node != TransformHierarchy::INVALID_NODE; node = parents[node])
+            {
+                if (node == ancestor)
+                {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        // The last node added that is not in the subtree of node, to move node under.
+        uint32_t FindParentFor(uint32_t node) const
+        {
+            uint32_t parent = static_cast<uint32_t>(parents.size()) - 1;
+            while (IsBelow(parent, node))
+            {
+                parent--;
+            }
+
+            return parent;
+        }
+
+        void SetParent(uint32_t node, uint32_t parent)
+        {
+            hierarchy.SetParent(node, parent);
+            parents[node] = parent;
+        }
+    };
+
+    // scale * rotation * translation built as three matrices in double, row vectors.
+    void LocalMatrix(const Transform& local, Matrix& result)
+    {
+        double x = local.rotation[0], y = local.rotation[1], z = local.rotation[2], w = local.rotation[3];
+        double rotation[3][3] =
+        {
+            { 1.0 - 2.0 * (y * y + z * z), 2.0 * (x * y + z * w), 2.0 * (x * z - y * w) },
+            { 2.0 * (x * y - z * w), 1.0 - 2.0 * (x * x + z * z), 2.0 * (y * z + x * w) },
+            { 2.0 * (x * z + y * w), 2.0 * (y * z - x * w), 1.0 - 2.0 * (x * x + y * y) },
+        };
+
+        for (uint32_t row = 0; row < 3; row++)
+        {
+            for (uint32_t column = 0; column < 3; column++)
+            {
+                result[row][column] = local.scale[row] * rotation[row][column];
+            }
+
+            result[row][3] = 0.0;
+            result[3][row] = local.translation[row];
+        }
+
+        result[3][3] = 1.0;
+    }
+
+    // world = local * parent world, recursing up to the root every time.
+    void WorldMatrix(const Scene& scene, uint32_t node, Matrix& result)
+    {
+        Matrix local;
+        LocalMatrix(scene.locals[node], local);
+        if (scene.parents[node] == TransformHierarchy::INVALID_NODE)
+        {
+            ::memcpy(result, local, sizeof(Matrix));
+            return;
+        }
+
+        Matrix parent;
+        WorldMatrix(scene, scene.parents[node], parent);
+        for (uint32_t row = 0; row < 4; row++)
+        {
+            for (uint32_t column = 0; column < 4; column++)
+            {
+                result[row][column] = 0.0;
+                for (uint32_t k = 0; k < 4; k++)
+                {
+                    result[row][column] += local[row][k] * parent[k][column];
+                }
+            }
+        }
+    }
+
+    bool MatchesReference(const Scene& scene)
+    {
+        bool near = true;
+        for (uint32_t node = 0; node < scene.hierarchy.GetNodeCount(); node++)
+        {
+            near = near && scene.hierarchy.GetParent(node) == scene.parents[node];
+
+            Matrix expected;
+            WorldMatrix(scene, node, expected);
+            const TransformMatrix& world = scene.hierarchy.GetWorldMatrix(node);
+            for (uint32_t row = 0; row < 4; row++)
+            {
+                for (uint32_t column = 0; column < 4; column++)
+                {
+                    double value = expected[row][column];
+                    near = near && std::fabs(world.m[row][column] - value) <= 1e-4 * (1.0 + std::fabs(value));
+                }
+            }
+        }
+
+        return near;
+    }
+
+    bool IsSameWorldMatrices(const TransformHierarchy& a, const TransformHierarchy& b)
+    {
+        bool same = a.GetNodeCount() == b.GetNodeCount();
+        for (uint32_t node = 0; node < a.GetNodeCount() && same; node++)
+        {
+            same = ::memcmp(&a.GetWorldMatrix(node), &b.GetWorldMatrix(node), sizeof(TransformMatrix)) == 0;
+        }
+
+        return same;
+    }
+
+    // A forest up to 12 levels deep with levels wide enough to go wide across the scheduler,
+    // then subtrees moved deeper, shallower, to the root and under nodes added after them, with
+    // and without changes to their local transforms in the same frame.
+    void BuildAndReparent(Scene& scene, TaskScheduler* scheduler, bool& matches)
+    {
+        uint32_t seed = 3;
+        std::vector<uint32_t> depths;
+        for (uint32_t node = 0; node < 3000; node++)
+        {
+            uint32_t parent = TransformHierarchy::INVALID_NODE;
+            if (node >= 4)
+            {
+                parent = static_cast<uint32_t>(Random(seed) * node);
+                if (depths[parent] >= 11)
+                {
+                    parent = scene.parents[parent];
+                }
+            }
+
+            depths.push_back(parent == TransformHierarchy::INVALID_NODE ? 0 : depths[parent] + 1);
+            scene.Add(parent, seed);
+        }
+
+        scene.hierarchy.Update(scheduler);
+        matches = MatchesReference(scene);
+
+        // Only the changed nodes and what is below them are recomputed.
+        for (uint32_t i = 0; i < 50; i++)
+        {
+            scene.Set(static_cast<uint32_t>(Random(seed) * 3000), seed);
+        }
+
+        scene.hierarchy.Update(scheduler);
+        matches = matches && MatchesReference(scene);
+
+        // A deep subtree to a root, and two roots under nodes added after them, which moves their
+        // subtrees to other levels.
+        uint32_t deep = 2999;
+        while (scene.parents[deep] != TransformHierarchy::INVALID_NODE && scene.parents[scene.parents[deep]] != TransformHierarchy::INVALID_NODE)
+        {
+            deep = scene.parents[deep];
+        }
+
+        scene.SetParent(deep, TransformHierarchy::INVALID_NODE);
+        scene.SetParent(1, scene.FindParentFor(1));
+        scene.SetParent(2, scene.FindParentFor(2));
+        scene.hierarchy.Update(scheduler);
+        matches = matches && MatchesReference(scene);
+
+        // Reparented and moved in the same frame, nodes added under a moved node, then back.
+        scene.SetParent(deep, scene.IsBelow(2, deep) ? TransformHierarchy::INVALID_NODE : 2);
+        scene.Set(deep, seed);
+        scene.Add(deep, seed);
+        scene.Add(3000, seed);
+        scene.hierarchy.Update(scheduler);
+        matches = matches && MatchesReference(scene);
+
+        scene.SetParent(1, TransformHierarchy::INVALID_NODE);
+        scene.SetParent(2, TransformHierarchy::INVALID_NODE);
+        scene.hierarchy.Update(scheduler);
+        matches = matches && MatchesReference(scene);
+    }
+
+    void TestMatchesReference()
+    {
+        Scene serial;
+        bool matches = false;
+        BuildAndReparent(serial, nullptr, matches);
+        TEST_CHECK(matches);
+
+        for (uint32_t worker_count : { 1u, 4u, 8u })
+        {
+            TaskScheduler scheduler(worker_count);
+            Scene threaded;
+            BuildAndReparent(threaded, &scheduler, matches);
+            TEST_CHECK(matches);
+            TEST_CHECK(IsSameWorldMatrices(serial.hierarchy, threaded.hierarchy));
+        }
+    }
+}
+
+int main()
+{
+    TestMatchesReference();
+    return D3D::Test::Finish("TransformHierarchyTests");
+}
@@ -0,0 +1,183 @@
+#include "TransformKernels.h"
+
+namespace D3D
+{
+    namespace
+    {
+        const uint32_t SIMD_WIDTH = 4;
+
+        // Eberly, "A Fast and Accurate Algorithm for Computing SLERP": u[i] = 1 / (i (2i + 1)),
+        // v[i] = i / (2i + 1) for i = 1..8, the last pair scaled by mu to absorb the truncation
+        // error of the series.
+        const uint32_t SLERP_TERM_COUNT = 8;
+        const float SLERP_MU = 1.85298109240830f;
+        const float SLERP_U[SLERP_TERM_COUNT] =
+        {
+            1.0f / (1.0f * 3.0f), 1.0f / (2.0f * 5.0f), 1.0f / (3.0f * 7.0f), 1.0f / (4.0f * 9.0f),
+            1.0f / (5.0f * 11.0f), 1.0f / (6.0f * 13.0f), 1.0f / (7.0f * 15.0f), SLERP_MU / (8.0f * 17.0f),
+        };
+        const float SLERP_V[SLERP_TERM_COUNT] =
+        {
+            1.0f / 3.0f, 2.0f / 5.0f, 3.0f / 7.0f, 4.0f / 9.0f,
+            5.0f / 11.0f, 6.0f / 13.0f, 7.0f / 15.0f, SLERP_MU * 8.0f / 17.0f,
+        };
+
+        struct QuaternionLanes
+        {
+            Simd::Float4 x;
+            Simd::Float4 y;
+            Simd::Float4 z;
+            Simd::Float4 w;
+        };
+
+        inline QuaternionLanes LoadQuaternions(const float* const q[4], uint32_t offset, uint32_t lane_count)
+        {
+            QuaternionLanes lanes;
+            lanes.x = Simd::LoadPartial(q[0] + offset, lane_count);
+            lanes.y = Simd::LoadPartial(q[1] + offset, lane_count);
+            lanes.z = Simd::LoadPartial(q[2] + offset, lane_count);
+            lanes.w = Simd::LoadPartial(q[3] + offset, lane_count);
+            return lanes;
+        }
+
+        inline void StoreQuaternions(float* const q[4], uint32_t offset, uint32_t lane_count, const QuaternionLanes& lanes)
+        {
+            Simd::StorePartial(q[0] + offset, lanes.x, lane_count);
+            Simd::StorePartial(q[1] + offset, lanes.y, lane_count);
+            Simd::StorePartial(q[2] + offset, lanes.z, lane_count);
+            Simd::StorePartial(q[3] + offset, lanes.w, lane_count);
+        }
+
+        inline Simd::Float4 Dot(const QuaternionLanes& a, const QuaternionLanes& b)
+        {
+            return Simd::MulAdd(a.x, b.x, Simd::MulAdd(a.y, b.y, Simd::MulAdd(a.z, b.z, Simd::Mul(a.w, b.w))));
+        }
+
+        // Flips the lanes of to that lie on the far side of from, returns |dot(from, to)|.
+        inline Simd::Float4 TakeShorterArc(const QuaternionLanes& from, QuaternionLanes& to)
+        {
+            Simd::Float4 dot = Dot(from, to);
+            Simd::Float4 sign = Simd::Select(Simd::CmpLt(dot, Simd::Zero()), Simd::Set1(-1.0f), Simd::Set1(1.0f));
+            to.x = Simd::Mul(to.x, sign);
+            to.y = Simd::Mul(to.y, sign);
+            to.z = Simd::Mul(to.z, sign);
+            to.w = Simd::Mul(to.w, sign);
+            return Simd::Mul(dot, sign);
+        }
+
+        inline QuaternionLanes Combine(const QuaternionLanes& a, Simd::Float4 weight_a, const QuaternionLanes& b, Simd::Float4 weight_b)
+        {
+            QuaternionLanes result;
+            result.x = Simd::MulAdd(a.x, weight_a, Simd::Mul(b.x, weight_b));
+            result.y = Simd::MulAdd(a.y, weight_a, Simd::Mul(b.y, weight_b));
+            result.z = Simd::MulAdd(a.z, weight_a, Simd::Mul(b.z, weight_b));
+            result.w = Simd::MulAdd(a.w, weight_a, Simd::Mul(b.w, weight_b));
+            return result;
+        }
+
+        // t * (1 + b[0] * (1 + b[1] * (... (1 + b[7])))) with b[i] = (u[i] t^2 - v[i]) (cos - 1).
+        inline Simd::Float4 SlerpWeight(Simd::Float4 t, Simd::Float4 cos_minus_one)
+        {
+            Simd::Float4 one = Simd::Set1(1.0f);
+            Simd::Float4 t_sq = Simd::Mul(t, t);
+
+            Simd::Float4 weight = one;
+            for (int32_t i = SLERP_TERM_COUNT - 1; i >= 0; i--)
+            {
+                Simd::Float4 term = Simd::Mul(Simd::Sub(Simd::Mul(Simd::Set1(SLERP_U[i]), t_sq), Simd::Set1(SLERP_V[i])), cos_minus_one);
+                weight = Simd::MulAdd(term, weight, one);
+            }
+
+            return Simd::Mul(t, weight);
+        }
+    }
+
+    void TransformKernels::NlerpQuaternions(const float* const from[4], const float* const to[4], float t, uint32_t count, float* const result[4])
+    {
+        Simd::Float4 weight_from = Simd::Set1(1.0f - t);
+        Simd::Float4 weight_to = Simd::Set1(t);
+        Simd::Float4 one = Simd::Set1(1.0f);
+
+        for (uint32_t i = 0; i < count; i += SIMD_WIDTH)
+        {
+            uint32_t lane_count = count - i;
+            QuaternionLanes a = LoadQuaternions(from, i, lane_count);
+            QuaternionLanes b = LoadQuaternions(to, i, lane_count);
+            TakeShorterArc(a, b);
+
+            QuaternionLanes q = Combine(a, weight_from, b, weight_to);
+            Simd::Float4 inv_length = Simd::Div(one, Simd::Sqrt(Dot(q, q)));
+            q.x = Simd::Mul(q.x, inv_length);
+            q.y = Simd::Mul(q.y, inv_length);
+            q.z = Simd::Mul(q.z, inv_length);
+            q.w = Simd::Mul(q.w, inv_length);
+
+            StoreQuaternions(result, i, lane_count, q);
+        }
+    }
+
+    void TransformKernels::SlerpQuaternions(const float* const from[4], const float* const to[4], float t, uint32_t count, float* const result[4])
+    {
+        Simd::Float4 weight_t = Simd::Set1(t);
+        Simd::Float4 weight_d = Simd::Set1(1.0f - t);
+        Simd::Float4 one = Simd::Set1(1.0f);
+
+        for (uint32_t i = 0; i < count; i += SIMD_WIDTH)
+        {
+            uint32_t lane_count = count - i;
+            QuaternionLanes a = LoadQuaternions(from, i, lane_count);
+            QuaternionLanes b = LoadQuaternions(to, i, lane_count);
+            Simd::Float4 cos_minus_one = Simd::Sub(TakeShorterArc(a, b), one);
+
+            QuaternionLanes q = Combine(a, SlerpWeight(weight_d, cos_minus_one), b, SlerpWeight(weight_t, cos_minus_one));
+            StoreQuaternions(result, i, lane_count, q);
+        }
+    }
+
+    void TransformKernels::ComposeMatrices(const float* const scale[3], const float* const rotation[4], const float* const translation[3],
+        uint32_t count, TransformMatrix* matrices)
+    {
+        Simd::Float4 zero = Simd::Zero();
+        Simd::Float4 one = Simd::Set1(1.0f);
+
+        for (uint32_t i = 0; i < count; i += SIMD_WIDTH)
+        {
+            uint32_t lane_count = count - i;
+            Simd::Float4 rows[9];
+            ScaledRotationRows(
+                Simd::LoadPartial(scale[0] + i, lane_count), Simd::LoadPartial(scale[1] + i, lane_count), Simd::LoadPartial(scale[2] + i, lane_count),
+                Simd::LoadPartial(rotation[0] + i, lane_count), Simd::LoadPartial(rotation[1] + i, lane_count),
+                Simd::LoadPartial(rotation[2] + i, lane_count), Simd::LoadPartial(rotation[3] + i, lane_count),
+                rows);
+
+            // Each transpose turns one matrix row of four transforms into four matrix rows.
+            Simd::Float4 matrix_rows[4][4];
+            for (uint32_t row = 0; row < 3; row++)
+            {
+                Simd::Float4* lanes = matrix_rows[row];
+                lanes[0] = rows[row * 3];
+                lanes[1] = rows[row * 3 + 1];
+                lanes[2] = rows[row * 3 + 2];
+                lanes[3] = zero;
+                Simd::Transpose(lanes[0], lanes[1], lanes[2], lanes[3]);
+            }
+
+            Simd::Float4* lanes = matrix_rows[3];
+            lanes[0] = Simd::LoadPartial(translation[0] + i, lane_count);
+            lanes[1] = Simd::LoadPartial(translation[1] + i, lane_count);
+            lanes[2] = Simd::LoadPartial(translation[2] + i, lane_count);
+            lanes[3] = one;
+            Simd::Transpose(lanes[0], lanes[1], lanes[2], lanes[3]);
+
+            uint32_t store_count = lane_count < SIMD_WIDTH ? lane_count : SIMD_WIDTH;
+            for (uint32_t lane = 0; lane < store_count; lane++)
+            {
+                auto& matrix = matrices[i + lane];
+                for (uint32_t row = 0; row < 4; row++)
+                {
+                    Simd::Store(matrix.m[row], matrix_rows[row][lane]);
+                }
+            }
+        }
+    }
+};
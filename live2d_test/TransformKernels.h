@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+
+#include "SimdMath.h"
+
+namespace D3D
+{
+    // Row major with row vectors (p' = p * m), the layout of DirectX::XMFLOAT4X4.
+    struct TransformMatrix
+    {
+        float m[4][4];
+    };
+
+    // Batch kernels over transforms kept as structure-of-arrays. Quaternions are passed as four
+    // component arrays (x, y, z, w), scales and translations as three, each holding count values.
+    // The output may alias either input.
+    class TransformKernels
+    {
+    public:
+        // Normalized linear interpolation along the shorter arc. Cheap, but the angular speed is
+        // not constant.
+        static void NlerpQuaternions(const float* const from[4], const float* const to[4], float t, uint32_t count, float* const result[4]);
+
+        // Spherical interpolation along the shorter arc, evaluated with a polynomial instead of
+        // acos / sin so the whole batch stays in SIMD registers. Within 3e-5 of the exact slerp,
+        // the error peaks when the two rotations are 180 degrees apart.
+        static void SlerpQuaternions(const float* const from[4], const float* const to[4], float t, uint32_t count, float* const result[4]);
+
+        // scale * rotation * translation written straight into the matrix rows, without building
+        // and multiplying the three matrices.
+        static void ComposeMatrices(const float* const scale[3], const float* const rotation[4], const float* const translation[3],
+            uint32_t count, TransformMatrix* matrices);
+
+        // The nine scale * rotation terms of four transforms, rows[row * 3 + column] holds one
+        // element for each lane. Same terms as XMMatrixRotationQuaternion.
+        static void ScaledRotationRows(Simd::Float4 sx, Simd::Float4 sy, Simd::Float4 sz,
+            Simd::Float4 qx, Simd::Float4 qy, Simd::Float4 qz, Simd::Float4 qw, Simd::Float4 rows[9]);
+    };
+
+    inline void TransformKernels::ScaledRotationRows(Simd::Float4 sx, Simd::Float4 sy, Simd::Float4 sz,
+        Simd::Float4 qx, Simd::Float4 qy, Simd::Float4 qz, Simd::Float4 qw, Simd::Float4 rows[9])
+    {
+        Simd::Float4 one = Simd::Set1(1.0f);
+        Simd::Float4 x2 = Simd::Add(qx, qx);
+        Simd::Float4 y2 = Simd::Add(qy, qy);
+        Simd::Float4 z2 = Simd::Add(qz, qz);
+        Simd::Float4 xx = Simd::Mul(qx, x2);
+        Simd::Float4 yy = Simd::Mul(qy, y2);
+        Simd::Float4 zz = Simd::Mul(qz, z2);
+        Simd::Float4 xy = Simd::Mul(qx, y2);
+        Simd::Float4 xz = Simd::Mul(qx, z2);
+        Simd::Float4 yz = Simd::Mul(qy, z2);
+        Simd::Float4 wx = Simd::Mul(qw, x2);
+        Simd::Float4 wy = Simd::Mul(qw, y2);
+        Simd::Float4 wz = Simd::Mul(qw, z2);
+
+        rows[0] = Simd::Mul(sx, Simd::Sub(one, Simd::Add(yy, zz)));
+        rows[1] = Simd::Mul(sx, Simd::Add(xy, wz));
+        rows[2] = Simd::Mul(sx, Simd::Sub(xz, wy));
+        rows[3] = Simd::Mul(sy, Simd::Sub(xy, wz));
+        rows[4] = Simd::Mul(sy, Simd::Sub(one, Simd::Add(xx, zz)));
+        rows[5] = Simd::Mul(sy, Simd::Add(yz, wx));
+        rows[6] = Simd::Mul(sz, Simd::Add(xz, wy));
+        rows[7] = Simd::Mul(sz, Simd::Sub(yz, wx));
+        rows[8] = Simd::Mul(sz, Simd::Sub(one, Simd::Add(xx, yy)));
+    }
+};
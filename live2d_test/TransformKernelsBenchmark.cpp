@@ -0,0 +1,119 @@
+#include "TransformKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "PortableMath.h"
+#include "TestHarness.h"
+
+using namespace D3D;
+using namespace DirectX;
+
+namespace
+{
+    float Random(uint32_t& seed)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / 16777216.0f;
+    }
+}
+
+// Millions of transforms per second. ComposeMatrices against one
+// XMMatrixScaling * XMMatrixRotationQuaternion * XMMatrixTranslation per transform, and the
+// polynomial SlerpQuaternions and NlerpQuaternions against a per quaternion slerp with acos
+// and sin.
+int main()
+{
+    std::printf("%-8s %12s %12s %12s %12s %12s\n", "count", "compose", "xm multiply", "slerp", "nlerp", "acos slerp");
+
+    for (uint32_t count : { 1000u, 10000u, 100000u })
+    {
+        uint32_t seed = 2;
+        std::vector<float> scale[3], translation[3], from[4], to[4], result[4];
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            for (uint32_t i = 0; i < count; i++)
+            {
+                from[c].push_back(Random(seed) - 0.5f);
+                to[c].push_back(Random(seed) - 0.5f);
+                if (c < 3)
+                {
+                    scale[c].push_back(0.5f + Random(seed));
+                    translation[c].push_back(Random(seed) * 10.0f);
+                }
+            }
+
+            result[c].resize(count);
+        }
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            float from_length = std::sqrt(from[0][i] * from[0][i] + from[1][i] * from[1][i] + from[2][i] * from[2][i] + from[3][i] * from[3][i]);
+            float to_length = std::sqrt(to[0][i] * to[0][i] + to[1][i] * to[1][i] + to[2][i] * to[2][i] + to[3][i] * to[3][i]);
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                from[c][i] /= from_length;
+                to[c][i] /= to_length;
+            }
+        }
+
+        const float* scale_pointers[3] = { scale[0].data(), scale[1].data(), scale[2].data() };
+        const float* translation_pointers[3] = { translation[0].data(), translation[1].data(), translation[2].data() };
+        const float* from_pointers[4] = { from[0].data(), from[1].data(), from[2].data(), from[3].data() };
+        const float* to_pointers[4] = { to[0].data(), to[1].data(), to[2].data(), to[3].data() };
+        float* result_pointers[4] = { result[0].data(), result[1].data(), result[2].data(), result[3].data() };
+        std::vector<TransformMatrix> matrices(count);
+        std::vector<XMFLOAT4X4> xm_matrices(count);
+
+        uint32_t repeat = 1000000 / count;
+        double compose_ms = D3D::Test::MeasureMilliseconds(repeat, [&]()
+        {
+            TransformKernels::ComposeMatrices(scale_pointers, from_pointers, translation_pointers, count, matrices.data());
+        });
+
+        double multiply_ms = D3D::Test::MeasureMilliseconds(repeat, [&]()
+        {
+            for (uint32_t i = 0; i < count; i++)
+            {
+                XMMATRIX matrix = XMMatrixScaling(scale[0][i], scale[1][i], scale[2][i]) *
+                    XMMatrixRotationQuaternion(XMVectorSet(from[0][i], from[1][i], from[2][i], from[3][i])) *
+                    XMMatrixTranslation(translation[0][i], translation[1][i], translation[2][i]);
+                XMStoreFloat4x4(&xm_matrices[i], matrix);
+            }
+        });
+
+        double slerp_ms = D3D::Test::MeasureMilliseconds(repeat, [&]()
+        {
+            TransformKernels::SlerpQuaternions(from_pointers, to_pointers, 0.3f, count, result_pointers);
+        });
+
+        double nlerp_ms = D3D::Test::MeasureMilliseconds(repeat, [&]()
+        {
+            TransformKernels::NlerpQuaternions(from_pointers, to_pointers, 0.3f, count, result_pointers);
+        });
+
+        double acos_ms = D3D::Test::MeasureMilliseconds(repeat, [&]()
+        {
+            for (uint32_t i = 0; i < count; i++)
+            {
+                float dot = from[0][i] * to[0][i] + from[1][i] * to[1][i] + from[2][i] * to[2][i] + from[3][i] * to[3][i];
+                float sign = dot < 0.0f ? -1.0f : 1.0f;
+                float angle = std::acos((std::min)(dot * sign, 1.0f));
+                float inv_sin = 1.0f / std::sin(angle);
+                float weight_from = std::sin(0.7f * angle) * inv_sin;
+                float weight_to = std::sin(0.3f * angle) * inv_sin * sign;
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    result[c][i] = from[c][i] * weight_from + to[c][i] * weight_to;
+                }
+            }
+        });
+
+        double million = count / 1000.0;
+        std::printf("%-8u %12.1f %12.1f %12.1f %12.1f %12.1f\n", count, million / compose_ms, million / multiply_ms, million / slerp_ms, million / nlerp_ms, million / acos_ms);
+    }
+
+    return 0;
+}
@@ -0,0 +1,302 @@
+#include "TransformKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "PortableMath.h"
+#include "TestHarness.h"
+
+using namespace D3D;
+using namespace DirectX;
+
+namespace
+{
+    float Random(uint32_t& seed)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / 16777216.0f;
+    }
+
+    // Quaternions as four component arrays, the layout the kernels take.
+    struct Quaternions
+    {
+        std::vector<float> components[4];
+
+        explicit Quaternions(uint32_t count)
+        {
+            for (auto& component : components)
+            {
+                component.assign(count, 0.0f);
+            }
+        }
+
+        void Set(uint32_t i, double x, double y, double z, double w)
+        {
+            double length = std::sqrt(x * x + y * y + z * z + w * w);
+            components[0][i] = static_cast<float>(x / length);
+            components[1][i] = static_cast<float>(y / length);
+            components[2][i] = static_cast<float>(z / length);
+            components[3][i] = static_cast<float>(w / length);
+        }
+
+        double Get(uint32_t i, uint32_t component) const
+        {
+            return components[component][i];
+        }
+
+        void GetPointers(const float* pointers[4]) const
+        {
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                pointers[c] = components[c].data();
+            }
+        }
+
+        void GetPointers(float* pointers[4])
+        {
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                pointers[c] = components[c].data();
+            }
+        }
+    };
+
+    // Pairs of rotations from identical through 90 and 179.9 degrees apart up to 180 degrees,
+    // half of them with to on the far side of from so the shorter arc has to be taken.
+    void MakePairs(uint32_t count, Quaternions& from, Quaternions& to)
+    {
+        uint32_t seed = 31;
+        const double angles[] = { 0.0, 1e-3, 0.3, 1.5707963, 2.5, 3.1398, 3.14159265 };
+        for (uint32_t i = 0; i < count; i++)
+        {
+            double x = Random(seed) * 2.0 - 1.0, y = Random(seed) * 2.0 - 1.0, z = Random(seed) * 2.0 - 1.0, w = Random(seed) * 2.0 - 1.0;
+            from.Set(i, x, y, z, w);
+
+            // Rotated by angle around a random axis: to = from * (axis sin(angle / 2), cos(angle / 2)).
+            double angle = angles[i % 7];
+            double ax = Random(seed) * 2.0 - 1.0, ay = Random(seed) * 2.0 - 1.0, az = Random(seed) * 2.0 - 1.0;
+            double axis_length = std::sqrt(ax * ax + ay * ay + az * az);
+            double s = std::sin(angle * 0.5) / axis_length, c = std::cos(angle * 0.5);
+            double fx = from.Get(i, 0), fy = from.Get(i, 1), fz = from.Get(i, 2), fw = from.Get(i, 3);
+            double rx = ax * s, ry = ay * s, rz = az * s;
+            double tx = fw * rx + fx * c + fy * rz - fz * ry;
+            double ty = fw * ry - fx * rz + fy * c + fz * rx;
+            double tz = fw * rz + fx * ry - fy * rx + fz * c;
+            double tw = fw * c - fx * rx - fy * ry - fz * rz;
+            double sign = (i / 7) % 2 == 0 ? 1.0 : -1.0;
+            to.Set(i, tx * sign, ty * sign, tz * sign, tw * sign);
+        }
+    }
+
+    double Dot(const Quaternions& from, const Quaternions& to, uint32_t i)
+    {
+        double dot = 0.0;
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            dot += from.Get(i, c) * to.Get(i, c);
+        }
+
+        return dot;
+    }
+
+    // The textbook slerp in double, along the shorter arc when sign is that of the dot product.
+    void SlerpReference(const Quaternions& from, const Quaternions& to, uint32_t i, double sign, double t, double result[4])
+    {
+        double dot = (std::min)(Dot(from, to, i) * sign, 1.0);
+        double angle = std::acos(dot);
+        double weight_from = 1.0 - t, weight_to = t;
+        if (angle > 1e-6)
+        {
+            weight_from = std::sin((1.0 - t) * angle) / std::sin(angle);
+            weight_to = std::sin(t * angle) / std::sin(angle);
+        }
+
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            result[c] = from.Get(i, c) * weight_from + to.Get(i, c) * sign * weight_to;
+        }
+    }
+
+    void TestSlerp()
+    {
+        // Counts that leave every partial group of four.
+        for (uint32_t count : { 1u, 2u, 3u, 5u, 700u })
+        {
+            Quaternions from(count), to(count), result(count);
+            MakePairs(count, from, to);
+
+            const float* from_pointers[4];
+            const float* to_pointers[4];
+            float* result_pointers[4];
+            from.GetPointers(from_pointers);
+            to.GetPointers(to_pointers);
+            result.GetPointers(result_pointers);
+
+            double max_error = 0.0;
+            for (float t : { 0.0f, 0.1f, 0.25f, 0.5f, 0.75f, 0.99f, 1.0f })
+            {
+                TransformKernels::SlerpQuaternions(from_pointers, to_pointers, t, count, result_pointers);
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    // Rotations 180 degrees apart have two arcs of the same length, and rounding
+                    // decides which one the kernel takes, so either is right.
+                    double dot = Dot(from, to, i);
+                    double error = 1e30;
+                    for (double sign : { -1.0, 1.0 })
+                    {
+                        if (std::fabs(dot) > 1e-6 && (dot < 0.0) != (sign < 0.0))
+                        {
+                            continue;
+                        }
+
+                        double expected[4];
+                        SlerpReference(from, to, i, sign, t, expected);
+                        double sign_error = 0.0;
+                        for (uint32_t c = 0; c < 4; c++)
+                        {
+                            sign_error = (std::max)(sign_error, std::fabs(result.Get(i, c) - expected[c]));
+                        }
+
+                        error = (std::min)(error, sign_error);
+                    }
+
+                    max_error = (std::max)(max_error, error);
+                }
+            }
+
+            // The bound given in TransformKernels.h.
+            TEST_CHECK(max_error <= 3e-5);
+        }
+    }
+
+    void TestNlerp()
+    {
+        const uint32_t count = 701;
+        Quaternions from(count), to(count), result(count);
+        MakePairs(count, from, to);
+
+        const float* from_pointers[4];
+        const float* to_pointers[4];
+        float* result_pointers[4];
+        from.GetPointers(from_pointers);
+        to.GetPointers(to_pointers);
+        result.GetPointers(result_pointers);
+
+        // Normalized double lerp along the shorter arc. Rotations 180 degrees apart have no
+        // shorter arc, and their halfway point no length to normalize, so they are skipped.
+        double max_error = 0.0;
+        for (float t : { 0.0f, 0.3f, 0.5f, 1.0f })
+        {
+            TransformKernels::NlerpQuaternions(from_pointers, to_pointers, t, count, result_pointers);
+            for (uint32_t i = 0; i < count; i++)
+            {
+                if (i % 7 == 6)
+                {
+                    continue;
+                }
+
+                double sign = Dot(from, to, i) < 0.0 ? -1.0 : 1.0;
+                double expected[4];
+                double length = 0.0;
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    expected[c] = from.Get(i, c) * (1.0 - t) + to.Get(i, c) * sign * t;
+                    length += expected[c] * expected[c];
+                }
+
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    max_error = (std::max)(max_error, std::fabs(result.Get(i, c) - expected[c] / std::sqrt(length)));
+                }
+            }
+        }
+
+        TEST_CHECK(max_error <= 1e-6);
+
+        // The result may overwrite from.
+        TransformKernels::NlerpQuaternions(from_pointers, to_pointers, 0.5f, count, result_pointers);
+        float* from_output[4] = { from.components[0].data(), from.components[1].data(), from.components[2].data(), from.components[3].data() };
+        TransformKernels::NlerpQuaternions(from_pointers, to_pointers, 0.5f, count, from_output);
+        bool same = true;
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            same = same && from.components[c] == result.components[c];
+        }
+
+        TEST_CHECK(same);
+    }
+
+    // The fused rows against building the three matrices and multiplying them, for counts that
+    // leave every partial group of four. Matrices past count are left alone.
+    void TestComposeMatrices()
+    {
+        uint32_t seed = 8;
+        for (uint32_t count : { 1u, 2u, 3u, 4u, 5u, 6u, 7u, 9u, 1001u })
+        {
+            std::vector<float> scale[3], translation[3];
+            Quaternions rotation(count);
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                scale[c].resize(count);
+                translation[c].resize(count);
+            }
+
+            for (uint32_t i = 0; i < count; i++)
+            {
+                for (uint32_t c = 0; c < 3; c++)
+                {
+                    scale[c][i] = 0.1f + Random(seed) * 4.0f;
+                    translation[c][i] = Random(seed) * 200.0f - 100.0f;
+                }
+
+                rotation.Set(i, Random(seed) * 2.0f - 1.0f, Random(seed) * 2.0f - 1.0f, Random(seed) * 2.0f - 1.0f, Random(seed) * 2.0f - 1.0f);
+            }
+
+            const float* scale_pointers[3] = { scale[0].data(), scale[1].data(), scale[2].data() };
+            const float* translation_pointers[3] = { translation[0].data(), translation[1].data(), translation[2].data() };
+            const float* rotation_pointers[4];
+            rotation.GetPointers(rotation_pointers);
+
+            TransformMatrix sentinel;
+            std::fill(&sentinel.m[0][0], &sentinel.m[0][0] + 16, -7.0f);
+            std::vector<TransformMatrix> matrices(count + 3, sentinel);
+            TransformKernels::ComposeMatrices(scale_pointers, rotation_pointers, translation_pointers, count, matrices.data());
+
+            bool near = true;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                XMMATRIX reference = XMMatrixScaling(scale[0][i], scale[1][i], scale[2][i]) *
+                    XMMatrixRotationQuaternion(XMVectorSet(rotation_pointers[0][i], rotation_pointers[1][i], rotation_pointers[2][i], rotation_pointers[3][i])) *
+                    XMMatrixTranslation(translation[0][i], translation[1][i], translation[2][i]);
+                XMFLOAT4X4 expected;
+                XMStoreFloat4x4(&expected, reference);
+                for (uint32_t row = 0; row < 4; row++)
+                {
+                    for (uint32_t column = 0; column < 4; column++)
+                    {
+                        float value = expected.m[row][column];
+                        near = near && std::fabs(matrices[i].m[row][column] - value) <= 2e-6f * (1.0f + std::fabs(value));
+                    }
+                }
+            }
+
+            bool untouched = true;
+            for (uint32_t i = count; i < count + 3; i++)
+            {
+                untouched = untouched && std::equal(&matrices[i].m[0][0], &matrices[i].m[0][0] + 16, &sentinel.m[0][0]);
+            }
+
+            TEST_CHECK(near);
+            TEST_CHECK(untouched);
+        }
+    }
+}
+
+int main()
+{
+    TestSlerp();
+    TestNlerp();
+    TestComposeMatrices();
+    return D3D::Test::Finish("TransformKernelsTests");
+}
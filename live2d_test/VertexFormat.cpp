@@ -0,0 +1,599 @@
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+
+#include "SimdMath.h"
+
+namespace D3D
+{
+    namespace
+    {
+        using Vertex = GeometryGenerator::Vertex;
+
+        const float SNORM16_MAX = 32767.0f;
+
+        // Vertices run through all elements at a time, so both sides stay in L1.
+        const uint32_t CHUNK_SIZE = 256;
+
+        // Vertex inputs whose semantic starts with this prefix are read per instance.
+        const char INSTANCE_SEMANTIC_PREFIX[] = "INSTANCE_";
+
+        struct InstanceElement
+        {
+            const char* semantic_name;
+            VertexElementFormat format;
+        };
+
+        const InstanceElement INSTANCE_ELEMENTS[] =
+        {
+            { "INSTANCE_MODEL", kVertexFloat4 },            // one row per semantic index
+        };
+
+        inline const float* GetField(const Vertex* vertices, uint32_t index, uint32_t field_offset)
+        {
+            return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(vertices + index) + field_offset);
+        }
+
+        inline float* GetField(Vertex* vertices, uint32_t index, uint32_t field_offset)
+        {
+            return reinterpret_cast<float*>(reinterpret_cast<uint8_t*>(vertices + index) + field_offset);
+        }
+
+        inline Simd::Float4 Abs(Simd::Float4 v)
+        {
+            return Simd::Max(v, Simd::Sub(Simd::Zero(), v));
+        }
+
+        // Projects unit vectors onto the octahedron |x| + |y| + |z| = 1 and unfolds the lower
+        // half over the corners of the upper one, four vectors per call.
+        inline void OctahedralEncode(Simd::Float4 x, Simd::Float4 y, Simd::Float4 z, Simd::Float4& u, Simd::Float4& v)
+        {
+            Simd::Float4 one = Simd::Set1(1.0f);
+            Simd::Float4 sum = Simd::Add(Simd::Add(Abs(x), Abs(y)), Abs(z));
+            Simd::Float4 inv_sum = Simd::Div(one, Simd::Max(sum, Simd::Set1(FLT_MIN)));
+            u = Simd::Mul(x, inv_sum);
+            v = Simd::Mul(y, inv_sum);
+
+            Simd::Float4 sign_u = Simd::Select(Simd::CmpGe(u, Simd::Zero()), one, Simd::Set1(-1.0f));
+            Simd::Float4 sign_v = Simd::Select(Simd::CmpGe(v, Simd::Zero()), one, Simd::Set1(-1.0f));
+            Simd::Float4 folded_u = Simd::Mul(Simd::Sub(one, Abs(v)), sign_u);
+            Simd::Float4 folded_v = Simd::Mul(Simd::Sub(one, Abs(u)), sign_v);
+
+            Simd::Float4 lower = Simd::CmpLt(z, Simd::Zero());
+            u = Simd::Select(lower, folded_u, u);
+            v = Simd::Select(lower, folded_v, v);
+        }
+
+        inline void OctahedralDecode(Simd::Float4 u, Simd::Float4 v, Simd::Float4& x, Simd::Float4& y, Simd::Float4& z)
+        {
+            z = Simd::Sub(Simd::Sub(Simd::Set1(1.0f), Abs(u)), Abs(v));
+            Simd::Float4 fold = Simd::Max(Simd::Sub(Simd::Zero(), z), Simd::Zero());
+            Simd::Float4 negative_fold = Simd::Sub(Simd::Zero(), fold);
+            x = Simd::Add(u, Simd::Select(Simd::CmpGe(u, Simd::Zero()), negative_fold, fold));
+            y = Simd::Add(v, Simd::Select(Simd::CmpGe(v, Simd::Zero()), negative_fold, fold));
+
+            Simd::Float4 length_sq = Simd::MulAdd(x, x, Simd::MulAdd(y, y, Simd::Mul(z, z)));
+            Simd::Float4 inv_length = Simd::Div(Simd::Set1(1.0f), Simd::Sqrt(length_sq));
+            x = Simd::Mul(x, inv_length);
+            y = Simd::Mul(y, inv_length);
+            z = Simd::Mul(z, inv_length);
+        }
+
+        void EncodeFloats(const Vertex* vertices, uint32_t count, uint32_t field_offset, uint32_t component_count, uint8_t* destination, uint32_t stride)
+        {
+            for (uint32_t i = 0; i < count; i++)
+            {
+                ::memcpy(destination + static_cast<size_t>(i) * stride, GetField(vertices, i, field_offset), sizeof(float) * component_count);
+            }
+        }
+
+        void DecodeFloats(const uint8_t* source, uint32_t stride, uint32_t count, uint32_t field_offset, uint32_t component_count, Vertex* vertices)
+        {
+            for (uint32_t i = 0; i < count; i++)
+            {
+                ::memcpy(GetField(vertices, i, field_offset), source + static_cast<size_t>(i) * stride, sizeof(float) * component_count);
+            }
+        }
+
+        // Three component fields are followed by at least one more float inside the vertex, so
+        // a whole register is loaded and the fourth lane replaced.
+        void EncodeHalf4(const Vertex* vertices, uint32_t count, uint32_t field_offset, uint8_t* destination, uint32_t stride)
+        {
+            Simd::Float4 w_lane = Simd::CmpGt(Simd::Set(0.0f, 0.0f, 0.0f, 1.0f), Simd::Zero());
+            Simd::Float4 one = Simd::Set1(1.0f);
+            for (uint32_t i = 0; i < count; i++)
+            {
+                Simd::Float4 value = Simd::Select(w_lane, one, Simd::Load(GetField(vertices, i, field_offset)));
+                Simd::StoreHalf(reinterpret_cast<uint16_t*>(destination + static_cast<size_t>(i) * stride), value);
+            }
+        }
+
+        void DecodeHalf4(const uint8_t* source, uint32_t stride, uint32_t count, uint32_t field_offset, Vertex* vertices)
+        {
+            for (uint32_t i = 0; i < count; i++)
+            {
+                Simd::Float4 value = Simd::LoadHalf(reinterpret_cast<const uint16_t*>(source + static_cast<size_t>(i) * stride));
+                Simd::StorePartial(GetField(vertices, i, field_offset), value, 3);
+            }
+        }
+
+        void EncodeSnorm16x4(const Vertex* vertices, uint32_t count, uint32_t field_offset, const VertexQuantization& quantization,
+            uint8_t* destination, uint32_t stride)
+        {
+            float inv_scale[3];
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                inv_scale[k] = quantization.scale[k] > 0.0f ? SNORM16_MAX / quantization.scale[k] : 0.0f;
+            }
+
+            Simd::Float4 offset = Simd::Set(quantization.offset[0], quantization.offset[1], quantization.offset[2], 0.0f);
+            Simd::Float4 scale = Simd::Set(inv_scale[0], inv_scale[1], inv_scale[2], 0.0f);
+            Simd::Float4 maximum = Simd::Set1(SNORM16_MAX);
+            Simd::Float4 minimum = Simd::Set1(-SNORM16_MAX);
+            for (uint32_t i = 0; i < count; i++)
+            {
+                Simd::Float4 value = Simd::Mul(Simd::Sub(Simd::Load(GetField(vertices, i, field_offset)), offset), scale);
+                value = Simd::Min(Simd::Max(value, minimum), maximum);
+                Simd::StoreInt16(reinterpret_cast<int16_t*>(destination + static_cast<size_t>(i) * stride), value);
+            }
+        }
+
+        void DecodeSnorm16x4(const uint8_t* source, uint32_t stride, uint32_t count, uint32_t field_offset,
+            const VertexQuantization& quantization, Vertex* vertices)
+        {
+            Simd::Float4 offset = Simd::Set(quantization.offset[0], quantization.offset[1], quantization.offset[2], 0.0f);
+            Simd::Float4 scale = Simd::Set(quantization.scale[0], quantization.scale[1], quantization.scale[2], 0.0f);
+            scale = Simd::Mul(scale, Simd::Set1(1.0f / SNORM16_MAX));
+            for (uint32_t i = 0; i < count; i++)
+            {
+                Simd::Float4 value = Simd::LoadInt16(reinterpret_cast<const int16_t*>(source + static_cast<size_t>(i) * stride));
+                Simd::StorePartial(GetField(vertices, i, field_offset), Simd::MulAdd(value, scale, offset), 3);
+            }
+        }
+
+        // Two vertices per register.
+        void EncodeHalf2(const Vertex* vertices, uint32_t count, uint32_t field_offset, uint8_t* destination, uint32_t stride)
+        {
+            uint16_t lanes[4];
+            for (uint32_t i = 0; i < count; i += 2)
+            {
+                const float* a = GetField(vertices, i, field_offset);
+                const float* b = GetField(vertices, (std::min)(i + 1, count - 1), field_offset);
+                Simd::StoreHalf(lanes, Simd::Set(a[0], a[1], b[0], b[1]));
+
+                ::memcpy(destination + static_cast<size_t>(i) * stride, lanes, sizeof(uint16_t) * 2);
+                if (i + 1 < count)
+                {
+                    ::memcpy(destination + static_cast<size_t>(i + 1) * stride, lanes + 2, sizeof(uint16_t) * 2);
+                }
+            }
+        }
+
+        void DecodeHalf2(const uint8_t* source, uint32_t stride, uint32_t count, uint32_t field_offset, Vertex* vertices)
+        {
+            uint16_t lanes[4] = {};
+            float values[4];
+            for (uint32_t i = 0; i < count; i += 2)
+            {
+                ::memcpy(lanes, source + static_cast<size_t>(i) * stride, sizeof(uint16_t) * 2);
+                if (i + 1 < count)
+                {
+                    ::memcpy(lanes + 2, source + static_cast<size_t>(i + 1) * stride, sizeof(uint16_t) * 2);
+                }
+
+                Simd::Store(values, Simd::LoadHalf(lanes));
+                ::memcpy(GetField(vertices, i, field_offset), values, sizeof(float) * 2);
+                if (i + 1 < count)
+                {
+                    ::memcpy(GetField(vertices, i + 1, field_offset), values + 2, sizeof(float) * 2);
+                }
+            }
+        }
+
+        // Four vertices per iteration, transposed to x, y, z registers. The lanes past the end
+        // repeat the last vertex and are not written.
+        void EncodeOctahedral16(const Vertex* vertices, uint32_t count, uint32_t field_offset, uint8_t* destination, uint32_t stride)
+        {
+            Simd::Float4 scale = Simd::Set1(SNORM16_MAX);
+            int16_t lanes[8];
+            for (uint32_t i = 0; i < count; i += 4)
+            {
+                uint32_t block = (std::min)(count - i, 4u);
+                Simd::Float4 x = Simd::Load(GetField(vertices, i, field_offset));
+                Simd::Float4 y = Simd::Load(GetField(vertices, i + (std::min)(1u, block - 1), field_offset));
+                Simd::Float4 z = Simd::Load(GetField(vertices, i + (std::min)(2u, block - 1), field_offset));
+                Simd::Float4 w = Simd::Load(GetField(vertices, i + (std::min)(3u, block - 1), field_offset));
+                Simd::Transpose(x, y, z, w);
+
+                Simd::Float4 u;
+                Simd::Float4 v;
+                OctahedralEncode(x, y, z, u, v);
+                u = Simd::Mul(u, scale);
+                v = Simd::Mul(v, scale);
+
+                // (u0, v0, u1, v1) and (u2, v2, u3, v3)
+                Simd::StoreInt16(lanes, Simd::Swizzle<0, 2, 1, 3>(Simd::Shuffle<0, 1, 0, 1>(u, v)));
+                Simd::StoreInt16(lanes + 4, Simd::Swizzle<0, 2, 1, 3>(Simd::Shuffle<2, 3, 2, 3>(u, v)));
+                for (uint32_t j = 0; j < block; j++)
+                {
+                    ::memcpy(destination + static_cast<size_t>(i + j) * stride, lanes + j * 2, sizeof(int16_t) * 2);
+                }
+            }
+        }
+
+        void DecodeOctahedral16(const uint8_t* source, uint32_t stride, uint32_t count, uint32_t field_offset, Vertex* vertices)
+        {
+            Simd::Float4 scale = Simd::Set1(1.0f / SNORM16_MAX);
+            Simd::Float4 minimum = Simd::Set1(-1.0f);
+            int16_t lanes[8] = {};
+            for (uint32_t i = 0; i < count; i += 4)
+            {
+                uint32_t block = (std::min)(count - i, 4u);
+                for (uint32_t j = 0; j < block; j++)
+                {
+                    ::memcpy(lanes + j * 2, source + static_cast<size_t>(i + j) * stride, sizeof(int16_t) * 2);
+                }
+
+                // snorm -32768 reads as -1, like the input assembler.
+                Simd::Float4 a = Simd::Max(Simd::Mul(Simd::LoadInt16(lanes), scale), minimum);
+                Simd::Float4 b = Simd::Max(Simd::Mul(Simd::LoadInt16(lanes + 4), scale), minimum);
+                Simd::Float4 u = Simd::Shuffle<0, 2, 0, 2>(a, b);
+                Simd::Float4 v = Simd::Shuffle<1, 3, 1, 3>(a, b);
+
+                Simd::Float4 x;
+                Simd::Float4 y;
+                Simd::Float4 z;
+                OctahedralDecode(u, v, x, y, z);
+
+                Simd::Float4 w = Simd::Zero();
+                Simd::Transpose(x, y, z, w);
+                Simd::Float4 rows[4] = { x, y, z, w };
+                for (uint32_t j = 0; j < block; j++)
+                {
+                    Simd::StorePartial(GetField(vertices, i + j, field_offset), rows[j], 3);
+                }
+            }
+        }
+
+        void EncodeElement(const VertexElementDesc& element, uint32_t field_offset, uint32_t component_count, const VertexQuantization& quantization,
+            const Vertex* vertices, uint32_t count, uint8_t* destination, uint32_t stride)
+        {
+            destination += element.offset;
+            switch (element.format)
+            {
+            case kVertexFloat2:
+            case kVertexFloat3:
+                EncodeFloats(vertices, count, field_offset, component_count, destination, stride);
+                break;
+
+            case kVertexHalf2:
+                EncodeHalf2(vertices, count, field_offset, destination, stride);
+                break;
+
+            case kVertexHalf4:
+                EncodeHalf4(vertices, count, field_offset, destination, stride);
+                break;
+
+            case kVertexSnorm16x4:
+                EncodeSnorm16x4(vertices, count, field_offset, quantization, destination, stride);
+                break;
+
+            case kVertexOctahedral16:
+                EncodeOctahedral16(vertices, count, field_offset, destination, stride);
+                break;
+
+            case kVertexFloat4:
+                assert(false);
+                break;
+            }
+        }
+
+        void DecodeElement(const VertexElementDesc& element, uint32_t field_offset, uint32_t component_count, const VertexQuantization& quantization,
+            const uint8_t* source, uint32_t stride, uint32_t count, Vertex* vertices)
+        {
+            source += element.offset;
+            switch (element.format)
+            {
+            case kVertexFloat2:
+            case kVertexFloat3:
+                DecodeFloats(source, stride, count, field_offset, component_count, vertices);
+                break;
+
+            case kVertexHalf2:
+                DecodeHalf2(source, stride, count, field_offset, vertices);
+                break;
+
+            case kVertexHalf4:
+                DecodeHalf4(source, stride, count, field_offset, vertices);
+                break;
+
+            case kVertexSnorm16x4:
+                DecodeSnorm16x4(source, stride, count, field_offset, quantization, vertices);
+                break;
+
+            case kVertexOctahedral16:
+                DecodeOctahedral16(source, stride, count, field_offset, vertices);
+                break;
+
+            case kVertexFloat4:
+                assert(false);
+                break;
+            }
+        }
+
+#ifndef NDEBUG
+        // Two component fields only come as floats or halves, the quantization bounds are
+        // only meaningful for positions.
+        bool IsValidFormat(const VertexFormatDesc& format)
+        {
+            auto is_vector = [](VertexElementFormat element)
+            {
+                return element == kVertexFloat3 || element == kVertexHalf4 || element == kVertexOctahedral16;
+            };
+
+            const VertexElementDesc* elements[] = { &format.position, &format.normal, &format.tangent, &format.texcoord };
+            for (const VertexElementDesc* element : elements)
+            {
+                if (element->stream >= format.stream_count || element->offset + VertexFormatDesc::GetElementSize(element->format) > format.strides[element->stream])
+                {
+                    return false;
+                }
+            }
+
+            return (is_vector(format.position.format) || format.position.format == kVertexSnorm16x4) &&
+                is_vector(format.normal.format) && is_vector(format.tangent.format) &&
+                (format.texcoord.format == kVertexFloat2 || format.texcoord.format == kVertexHalf2);
+        }
+#endif
+
+        template<typename TStream>
+        inline TStream* GetChunk(TStream* const streams[], const VertexFormatDesc& format, const VertexElementDesc& element, uint32_t begin)
+        {
+            TStream* stream = streams[element.stream];
+            return stream != nullptr ? stream + static_cast<size_t>(begin) * format.strides[element.stream] : nullptr;
+        }
+    }
+
+    const VertexElementDesc* VertexFormatDesc::FindElement(const char* semantic_name) const
+    {
+        const VertexElementDesc* elements[ELEMENT_COUNT] = { &position, &normal, &tangent, &texcoord };
+        for (const VertexElementDesc* element : elements)
+        {
+            if (element->semantic_name != nullptr && ::strcmp(element->semantic_name, semantic_name) == 0)
+            {
+                return element;
+            }
+        }
+
+        return nullptr;
+    }
+
+    VertexFormatDesc VertexFormatDesc::SplitPosition() const
+    {
+        VertexFormatDesc desc = *this;
+        desc.position.stream = 0;
+        desc.position.offset = 0;
+        desc.strides[0] = GetElementSize(position.format);
+
+        uint32_t offset = 0;
+        VertexElementDesc* attributes[] = { &desc.normal, &desc.tangent, &desc.texcoord };
+        for (VertexElementDesc* attribute : attributes)
+        {
+            attribute->stream = 1;
+            attribute->offset = offset;
+            offset += GetElementSize(attribute->format);
+        }
+
+        desc.strides[1] = offset;
+        desc.stream_count = 2;
+        return desc;
+    }
+
+    bool VertexFormatDesc::BuildInputLayout(const VertexInputParameter* parameters, uint32_t count, VertexInputLayout& layout) const
+    {
+        layout.elements.clear();
+        layout.stream_mask = 0;
+        layout.instance_slot = stream_count;
+        layout.instance_stride = 0;
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const VertexInputParameter& parameter = parameters[i];
+
+            VertexInputElement input;
+            input.semantic_name = parameter.semantic_name;
+            input.semantic_index = parameter.semantic_index;
+
+            if (::strncmp(parameter.semantic_name, INSTANCE_SEMANTIC_PREFIX, sizeof(INSTANCE_SEMANTIC_PREFIX) - 1) == 0)
+            {
+                const InstanceElement* instance = std::find_if(std::begin(INSTANCE_ELEMENTS), std::end(INSTANCE_ELEMENTS),
+                    [&parameter](const InstanceElement& element) { return ::strcmp(element.semantic_name, parameter.semantic_name) == 0; });
+                if (instance == std::end(INSTANCE_ELEMENTS))
+                {
+                    return false;
+                }
+
+                input.format = instance->format;
+                input.slot = layout.instance_slot;
+                input.offset = layout.instance_stride;
+                input.per_instance = true;
+                layout.instance_stride += GetElementSize(input.format);
+            }
+            else
+            {
+                const VertexElementDesc* element = FindElement(parameter.semantic_name);
+                if (element == nullptr || parameter.semantic_index != 0)
+                {
+                    return false;
+                }
+
+                input.format = element->format;
+                input.slot = element->stream;
+                input.offset = element->offset;
+                layout.stream_mask |= 1u << element->stream;
+            }
+
+            layout.elements.push_back(input);
+        }
+
+        return true;
+    }
+
+    uint32_t VertexFormatDesc::GetElementSize(VertexElementFormat format)
+    {
+        switch (format)
+        {
+        case kVertexFloat2:
+            return 8;
+
+        case kVertexFloat3:
+            return 12;
+
+        case kVertexHalf2:
+        case kVertexOctahedral16:
+            return 4;
+
+        case kVertexHalf4:
+        case kVertexSnorm16x4:
+            return 8;
+
+        case kVertexFloat4:
+            return 16;
+        }
+
+        return 0;
+    }
+
+    VertexFormatDesc VertexFormatDesc::Full()
+    {
+        VertexFormatDesc desc;
+        desc.position = { "POSITION", kVertexFloat3, static_cast<uint32_t>(offsetof(Vertex, Position)) };
+        desc.normal = { "NORMAL", kVertexFloat3, static_cast<uint32_t>(offsetof(Vertex, Normal)) };
+        desc.tangent = { "TANGENT", kVertexFloat3, static_cast<uint32_t>(offsetof(Vertex, TangentU)) };
+        desc.texcoord = { "TEXCOORD", kVertexFloat2, static_cast<uint32_t>(offsetof(Vertex, TexC)) };
+        desc.strides[0] = sizeof(Vertex);
+        return desc;
+    }
+
+    VertexFormatDesc VertexFormatDesc::Compact(VertexElementFormat position_format)
+    {
+        assert(position_format == kVertexHalf4 || position_format == kVertexSnorm16x4);
+
+        VertexFormatDesc desc;
+        desc.position = { "POSITION", position_format, 0 };
+        desc.normal = { "NORMAL", kVertexOctahedral16, 8 };
+        desc.tangent = { "TANGENT", kVertexOctahedral16, 12 };
+        desc.texcoord = { "TEXCOORD", kVertexHalf2, 16 };
+        desc.strides[0] = 20;
+        return desc;
+    }
+
+    VertexQuantization VertexCodec::ComputeQuantization(const GeometryGenerator::Vertex* vertices, uint32_t count)
+    {
+        VertexQuantization quantization;
+        if (count == 0)
+        {
+            return quantization;
+        }
+
+        Simd::Float4 minimum = Simd::Set1(FLT_MAX);
+        Simd::Float4 maximum = Simd::Set1(-FLT_MAX);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            Simd::Float4 position = Simd::Load(&vertices[i].Position.x);
+            minimum = Simd::Min(minimum, position);
+            maximum = Simd::Max(maximum, position);
+        }
+
+        float lanes[8];
+        Simd::Store(lanes, minimum);
+        Simd::Store(lanes + 4, maximum);
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            quantization.offset[k] = (lanes[k] + lanes[4 + k]) * 0.5f;
+            quantization.scale[k] = (lanes[4 + k] - lanes[k]) * 0.5f;
+        }
+
+        return quantization;
+    }
+
+    void VertexCodec::Encode(const VertexFormatDesc& format, const VertexQuantization& quantization,
+        const GeometryGenerator::Vertex* vertices, uint32_t count, void* const streams[])
+    {
+        assert(IsValidFormat(format));
+
+        uint8_t* bytes[VertexFormatDesc::MAX_STREAM_COUNT] = {};
+        for (uint32_t i = 0; i < format.stream_count; i++)
+        {
+            bytes[i] = static_cast<uint8_t*>(streams[i]);
+        }
+
+        const VertexElementDesc* elements[] = { &format.position, &format.normal, &format.tangent, &format.texcoord };
+        const uint32_t field_offsets[] = { offsetof(Vertex, Position), offsetof(Vertex, Normal), offsetof(Vertex, TangentU), offsetof(Vertex, TexC) };
+        const uint32_t component_counts[] = { 3, 3, 3, 2 };
+        for (uint32_t begin = 0; begin < count; begin += CHUNK_SIZE)
+        {
+            uint32_t chunk = (std::min)(count - begin, CHUNK_SIZE);
+            for (uint32_t e = 0; e < VertexFormatDesc::ELEMENT_COUNT; e++)
+            {
+                uint8_t* destination = GetChunk(bytes, format, *elements[e], begin);
+                if (destination != nullptr)
+                {
+                    EncodeElement(*elements[e], field_offsets[e], component_counts[e], quantization, vertices + begin, chunk,
+                        destination, format.strides[elements[e]->stream]);
+                }
+            }
+        }
+    }
+
+    void VertexCodec::Decode(const VertexFormatDesc& format, const VertexQuantization& quantization,
+        const void* const streams[], uint32_t count, GeometryGenerator::Vertex* vertices)
+    {
+        assert(IsValidFormat(format));
+
+        const uint8_t* bytes[VertexFormatDesc::MAX_STREAM_COUNT] = {};
+        for (uint32_t i = 0; i < format.stream_count; i++)
+        {
+            bytes[i] = static_cast<const uint8_t*>(streams[i]);
+        }
+
+        const VertexElementDesc* elements[] = { &format.position, &format.normal, &format.tangent, &format.texcoord };
+        const uint32_t field_offsets[] = { offsetof(Vertex, Position), offsetof(Vertex, Normal), offsetof(Vertex, TangentU), offsetof(Vertex, TexC) };
+        const uint32_t component_counts[] = { 3, 3, 3, 2 };
+        for (uint32_t begin = 0; begin < count; begin += CHUNK_SIZE)
+        {
+            uint32_t chunk = (std::min)(count - begin, CHUNK_SIZE);
+            for (uint32_t e = 0; e < VertexFormatDesc::ELEMENT_COUNT; e++)
+            {
+                const uint8_t* source = GetChunk(bytes, format, *elements[e], begin);
+                if (source != nullptr)
+                {
+                    DecodeElement(*elements[e], field_offsets[e], component_counts[e], quantization, source,
+                        format.strides[elements[e]->stream], chunk, vertices + begin);
+                }
+            }
+        }
+    }
+
+    void VertexCodec::EncodeMesh(const VertexFormatDesc& format, const GeometryGenerator::MeshData& mesh, uint32_t stream_mask, VertexStreams& streams)
+    {
+        uint32_t vertex_count = static_cast<uint32_t>(mesh.Vertices.size());
+        streams.vertex_count = vertex_count;
+        streams.quantization = ComputeQuantization(mesh.Vertices.data(), vertex_count);
+
+        void* destinations[VertexFormatDesc::MAX_STREAM_COUNT] = {};
+        for (uint32_t i = 0; i < VertexFormatDesc::MAX_STREAM_COUNT; i++)
+        {
+            bool used = i < format.stream_count && (stream_mask & (1u << i)) != 0;
+            streams.data[i].resize(used ? static_cast<size_t>(vertex_count) * format.strides[i] : 0);
+            destinations[i] = used ? streams.data[i].data() : nullptr;
+        }
+
+        Encode(format, streams.quantization, mesh.Vertices.data(), vertex_count, destinations);
+    }
+};
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "GeometryGenerator.h"
+
+namespace D3D
+{
+    enum VertexElementFormat
+    {
+        kVertexFloat2,
+        kVertexFloat3,
+        kVertexHalf2,
+        kVertexHalf4,                                       // x, y, z, 1
+        kVertexSnorm16x4,                                   // x, y, z, 0 over the quantization bounds
+        kVertexOctahedral16,                                // unit vector, two snorm16
+        kVertexFloat4,                                      // per instance data only
+    };
+
+    struct VertexElementDesc
+    {
+        const char* semantic_name = nullptr;
+        VertexElementFormat format = kVertexFloat3;
+        uint32_t offset = 0;                                // in its stream
+        uint32_t stream = 0;                                // input slot
+    };
+
+    // A vertex shader input as reflected, system values left out.
+    struct VertexInputParameter
+    {
+        const char* semantic_name = nullptr;
+        uint32_t semantic_index = 0;
+    };
+
+    struct VertexInputElement
+    {
+        const char* semantic_name = nullptr;
+        uint32_t semantic_index = 0;
+        VertexElementFormat format = kVertexFloat3;
+        uint32_t slot = 0;
+        uint32_t offset = 0;
+        bool per_instance = false;
+    };
+
+    struct VertexInputLayout
+    {
+        std::vector<VertexInputElement> elements;
+        uint32_t stream_mask = 0;                           // vertex streams the shader reads
+        uint32_t instance_slot = 0;                         // right after the vertex streams
+        uint32_t instance_stride = 0;                       // 0 without per instance inputs
+    };
+
+    // Layout of the four GeometryGenerator::Vertex attributes in up to MAX_STREAM_COUNT vertex
+    // buffers, one per input slot. The input layout of a pass is built from it, so every shader
+    // input semantic has to be described here; a pass whose shader reads only some attributes
+    // only binds the streams holding them.
+    struct VertexFormatDesc
+    {
+        static const uint32_t ELEMENT_COUNT = 4;
+        static const uint32_t MAX_STREAM_COUNT = 2;
+
+        VertexElementDesc position;
+        VertexElementDesc normal;
+        VertexElementDesc tangent;
+        VertexElementDesc texcoord;
+        uint32_t strides[MAX_STREAM_COUNT] = {};
+        uint32_t stream_count = 1;
+
+        const VertexElementDesc* FindElement(const char* semantic_name) const;
+
+        // Position alone in stream 0, for depth only and shadow passes, and the other attributes
+        // packed in the same order in stream 1.
+        VertexFormatDesc SplitPosition() const;
+
+        // Vertex inputs go to the stream of their element, inputs whose semantic starts with
+        // INSTANCE_ are read per instance from the slot after the last vertex stream. False
+        // when a semantic is not known.
+        bool BuildInputLayout(const VertexInputParameter* parameters, uint32_t count, VertexInputLayout& layout) const;
+
+        static uint32_t GetElementSize(VertexElementFormat format);
+
+        // GeometryGenerator::Vertex as is, 44 bytes.
+        static VertexFormatDesc Full();
+
+        // 20 bytes: position in kVertexHalf4 or kVertexSnorm16x4, octahedral normal and tangent,
+        // half uv. Snorm positions keep 16 bits everywhere in the bounds, halves lose precision
+        // away from the origin. A storage format for now: the renderer's passes all read Full,
+        // compact data is expanded with VertexCodec::Decode before it is uploaded.
+        static VertexFormatDesc Compact(VertexElementFormat position_format = kVertexSnorm16x4);
+    };
+
+    // Maps snorm16 positions back into the mesh bounds, position = value * scale + offset.
+    struct VertexQuantization
+    {
+        float scale[3] = { 1.0f, 1.0f, 1.0f };
+        float offset[3] = {};
+    };
+
+    // Vertex buffers of one mesh, stream i holds strides[i] bytes per vertex.
+    struct VertexStreams
+    {
+        std::vector<uint8_t> data[VertexFormatDesc::MAX_STREAM_COUNT];
+        VertexQuantization quantization;
+        uint32_t vertex_count = 0;
+    };
+
+    // Converts GeometryGenerator vertices to and from any VertexFormatDesc. Positions, half uvs
+    // and the octahedral mapping are done four lanes at a time with SimdMath. streams has one
+    // pointer per stream of the format, elements of null streams are skipped.
+    class VertexCodec
+    {
+    public:
+        static VertexQuantization ComputeQuantization(const GeometryGenerator::Vertex* vertices, uint32_t count);
+
+        static void Encode(const VertexFormatDesc& format, const VertexQuantization& quantization,
+            const GeometryGenerator::Vertex* vertices, uint32_t count, void* const streams[]);
+
+        static void Decode(const VertexFormatDesc& format, const VertexQuantization& quantization,
+            const void* const streams[], uint32_t count, GeometryGenerator::Vertex* vertices);
+
+        // Generated meshes straight into their streams, only the streams in stream_mask are filled.
+        static void EncodeMesh(const VertexFormatDesc& format, const GeometryGenerator::MeshData& mesh, uint32_t stream_mask, VertexStreams& streams);
+    };
+};
@@ -0,0 +1,89 @@
+#include "VertexFormat.h"
+
+#include <cstring>
+
+#include "TestHarness.h"
+
+using namespace D3D;
+
+namespace
+{
+    const uint32_t VERTEX_COUNT = 1 << 20;
+
+    // Sums the buffer 8 bytes at a time, what a pass that streams every vertex has to read.
+    uint64_t ReadStreams(const std::vector<uint8_t>* streams, uint32_t stream_count)
+    {
+        uint64_t sum = 0;
+        for (uint32_t s = 0; s < stream_count; s++)
+        {
+            const uint8_t* data = streams[s].data();
+            for (size_t i = 0; i + 8 <= streams[s].size(); i += 8)
+            {
+                uint64_t value;
+                ::memcpy(&value, data + i, sizeof(value));
+                sum += value;
+            }
+        }
+
+        return sum;
+    }
+
+    void Run(const char* name, const VertexFormatDesc& format, const std::vector<GeometryGenerator::Vertex>& vertices, uint32_t read_stream_count)
+    {
+        auto quantization = VertexCodec::ComputeQuantization(vertices.data(), VERTEX_COUNT);
+
+        std::vector<uint8_t> streams[VertexFormatDesc::MAX_STREAM_COUNT];
+        void* destinations[VertexFormatDesc::MAX_STREAM_COUNT] = {};
+        const void* sources[VertexFormatDesc::MAX_STREAM_COUNT] = {};
+        size_t size = 0;
+        for (uint32_t i = 0; i < format.stream_count; i++)
+        {
+            streams[i].resize(static_cast<size_t>(VERTEX_COUNT) * format.strides[i]);
+            destinations[i] = streams[i].data();
+            sources[i] = streams[i].data();
+            size += i < read_stream_count ? streams[i].size() : 0;
+        }
+
+        std::vector<GeometryGenerator::Vertex> decoded(VERTEX_COUNT);
+        double encode_ms = D3D::Test::MeasureMilliseconds(3, [&]()
+        {
+            VertexCodec::Encode(format, quantization, vertices.data(), VERTEX_COUNT, destinations);
+        });
+
+        double decode_ms = D3D::Test::MeasureMilliseconds(3, [&]()
+        {
+            VertexCodec::Decode(format, quantization, sources, VERTEX_COUNT, decoded.data());
+        });
+
+        volatile uint64_t sink = 0;
+        double read_ms = D3D::Test::MeasureMilliseconds(5, [&]()
+        {
+            sink = ReadStreams(streams, read_stream_count);
+        });
+
+        (void)sink;
+        std::printf("%-16s %6.1f %9.2f %9.2f %9.2f %8.2f\n", name, size / 1048576.0, encode_ms, decode_ms, read_ms, size / read_ms / 1e6);
+    }
+}
+
+// Encode and decode time of 1M vertices per format, the bytes a pass has to fetch and how long
+// a linear read of them takes. The position only row reads just stream 0 of the split format,
+// as a depth pass does.
+int main()
+{
+    GeometryGenerator generator;
+    auto sphere = generator.CreateSphere(10.0f, 1024, 1024);
+    std::vector<GeometryGenerator::Vertex> vertices(VERTEX_COUNT);
+    for (uint32_t i = 0; i < VERTEX_COUNT; i++)
+    {
+        vertices[i] = sphere.Vertices[i % sphere.Vertices.size()];
+    }
+
+    std::printf("%-16s %6s %9s %9s %9s %8s\n", "format", "MB", "encode ms", "decode ms", "read ms", "GB/s");
+    Run("full", VertexFormatDesc::Full(), vertices, 1);
+    Run("compact snorm", VertexFormatDesc::Compact(kVertexSnorm16x4), vertices, 1);
+    Run("compact half", VertexFormatDesc::Compact(kVertexHalf4), vertices, 1);
+    Run("split all", VertexFormatDesc::Compact().SplitPosition(), vertices, 2);
+    Run("split position", VertexFormatDesc::Compact().SplitPosition(), vertices, 1);
+    return 0;
+}
@@ -0,0 +1,289 @@
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#include "TestHarness.h"
+
+using namespace D3D;
+
+namespace
+{
+    typedef GeometryGenerator::Vertex Vertex;
+
+    struct CodecError
+    {
+        float position = 0.0f;                              // largest absolute difference
+        float position_step = 0.0f;                         // over the quantization scale, or in half ulps
+        float normal = 0.0f;                                // degrees
+        float tangent = 0.0f;
+        float texcoord = 0.0f;
+    };
+
+    float GetAngle(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b)
+    {
+        double length_a = std::sqrt(double(a.x) * a.x + double(a.y) * a.y + double(a.z) * a.z);
+        double length_b = std::sqrt(double(b.x) * b.x + double(b.y) * b.y + double(b.z) * b.z);
+        double cosine = (double(a.x) * b.x + double(a.y) * b.y + double(a.z) * b.z) / (length_a * length_b);
+        return static_cast<float>(std::acos((std::min)(1.0, (std::max)(-1.0, cosine))) * 180.0 / 3.14159265358979);
+    }
+
+    // Spacing of halves around value.
+    float GetHalfUlp(float value)
+    {
+        int exponent = 0;
+        std::frexp((std::max)(std::fabs(value), 6.1035156e-5f), &exponent);
+        return std::ldexp(1.0f, exponent - 11);
+    }
+
+    CodecError RoundTrip(const VertexFormatDesc& format, const std::vector<Vertex>& vertices, std::vector<Vertex>& decoded)
+    {
+        uint32_t count = static_cast<uint32_t>(vertices.size());
+        auto quantization = VertexCodec::ComputeQuantization(vertices.data(), count);
+
+        std::vector<uint8_t> streams[VertexFormatDesc::MAX_STREAM_COUNT];
+        void* destinations[VertexFormatDesc::MAX_STREAM_COUNT] = {};
+        const void* sources[VertexFormatDesc::MAX_STREAM_COUNT] = {};
+        for (uint32_t i = 0; i < format.stream_count; i++)
+        {
+            streams[i].resize(static_cast<size_t>(count) * format.strides[i]);
+            destinations[i] = streams[i].data();
+            sources[i] = streams[i].data();
+        }
+
+        decoded.resize(count);
+        VertexCodec::Encode(format, quantization, vertices.data(), count, destinations);
+        VertexCodec::Decode(format, quantization, sources, count, decoded.data());
+
+        CodecError error;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const float* a = &vertices[i].Position.x;
+            const float* b = &decoded[i].Position.x;
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                float difference = std::fabs(a[c] - b[c]);
+                float step = format.position.format == kVertexSnorm16x4 ? quantization.scale[c] : GetHalfUlp(a[c]);
+                error.position = (std::max)(error.position, difference);
+                error.position_step = (std::max)(error.position_step, difference / step);
+            }
+
+            error.normal = (std::max)(error.normal, GetAngle(vertices[i].Normal, decoded[i].Normal));
+            error.tangent = (std::max)(error.tangent, GetAngle(vertices[i].TangentU, decoded[i].TangentU));
+            error.texcoord = (std::max)(error.texcoord, std::fabs(vertices[i].TexC.x - decoded[i].TexC.x));
+            error.texcoord = (std::max)(error.texcoord, std::fabs(vertices[i].TexC.y - decoded[i].TexC.y));
+        }
+
+        return error;
+    }
+
+    // Positions in a 100 unit box off the origin, random unit normals with a perpendicular tangent.
+    std::vector<Vertex> CreateRandomVertices(uint32_t count)
+    {
+        std::vector<Vertex> vertices(count);
+        uint32_t seed = 7;
+        auto next = [&seed]()
+        {
+            seed = seed * 1664525u + 1013904223u;
+            return static_cast<float>(seed >> 8) / 16777216.0f;
+        };
+
+        for (auto& vertex : vertices)
+        {
+            float z = next() * 2.0f - 1.0f;
+            float phi = next() * 6.2831853f;
+            float r = std::sqrt((std::max)(1.0f - z * z, 0.0f));
+            float nx = r * std::cos(phi);
+            float ny = r * std::sin(phi);
+            vertex = Vertex(next() * 100.0f + 20.0f, next() * 100.0f - 50.0f, next() * 10.0f, nx, ny, z, -ny, nx, 0.0f, next(), next());
+            if (r < 1e-3f)
+            {
+                vertex.TangentU = DirectX::XMFLOAT3(1.0f, 0.0f, 0.0f);
+            }
+        }
+
+        return vertices;
+    }
+
+    void TestFormats()
+    {
+        auto full = VertexFormatDesc::Full();
+        auto compact = VertexFormatDesc::Compact();
+        auto split = compact.SplitPosition();
+        TEST_CHECK(full.strides[0] == sizeof(Vertex) && full.stream_count == 1);
+        TEST_CHECK(compact.strides[0] == 20 && compact.stream_count == 1);
+        TEST_CHECK(split.stream_count == 2 && split.strides[0] == 8 && split.strides[1] == 12);
+        TEST_CHECK(split.position.stream == 0 && split.normal.stream == 1 && split.texcoord.offset == 8);
+        TEST_CHECK(compact.FindElement("TANGENT") == &compact.tangent);
+        TEST_CHECK(compact.FindElement("COLOR") == nullptr);
+    }
+
+    void TestFullIsExact()
+    {
+        auto vertices = CreateRandomVertices(1001);
+        std::vector<Vertex> decoded;
+        RoundTrip(VertexFormatDesc::Full(), vertices, decoded);
+        TEST_CHECK(::memcmp(vertices.data(), decoded.data(), vertices.size() * sizeof(Vertex)) == 0);
+    }
+
+    void TestCompactAccuracy()
+    {
+        GeometryGenerator generator;
+        std::vector<Vertex> meshes[] =
+        {
+            CreateRandomVertices(100003),
+            generator.CreateSphere(10.0f, 200, 200).Vertices,
+            generator.CreateGrid(100.0f, 100.0f, 300, 300).Vertices,
+            generator.CreateCylinder(1.0f, 0.5f, 3.0f, 50, 50).Vertices,
+        };
+
+        for (auto& vertices : meshes)
+        {
+            std::vector<Vertex> decoded;
+
+            // Snorm positions are rounded to the nearest of the steps of scale / 32767, the float
+            // math around it adds a little on positions far from the origin.
+            auto snorm = RoundTrip(VertexFormatDesc::Compact(kVertexSnorm16x4), vertices, decoded);
+            TEST_CHECK(snorm.position_step * 32767.0f <= 0.51f);
+            TEST_CHECK(snorm.normal < 0.05f && snorm.tangent < 0.05f);
+            TEST_CHECK(snorm.texcoord <= GetHalfUlp(1.0f) * 0.5f);
+
+            // Halves round to the nearest, half an ulp.
+            auto half = RoundTrip(VertexFormatDesc::Compact(kVertexHalf4), vertices, decoded);
+            TEST_CHECK(half.position_step <= 0.5f);
+            TEST_CHECK(half.normal < 0.05f && half.tangent < 0.05f);
+
+            // Two streams decode the same as one.
+            std::vector<Vertex> split_decoded;
+            RoundTrip(VertexFormatDesc::Compact().SplitPosition(), vertices, split_decoded);
+            RoundTrip(VertexFormatDesc::Compact(), vertices, decoded);
+            TEST_CHECK(::memcmp(decoded.data(), split_decoded.data(), decoded.size() * sizeof(Vertex)) == 0);
+        }
+    }
+
+    void TestHalfTexcoords()
+    {
+        // Texcoords go through the half conversion as they are.
+        const float values[] = { 0.0f, -0.0f, 1.0f, -2.5f, 65504.0f, 6.1035156e-5f, 5.9604645e-8f, 1e-6f, 3.1415927f };
+        std::vector<Vertex> vertices;
+        for (float value : values)
+        {
+            vertices.push_back(Vertex(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, value, -value));
+        }
+
+        // Too large for a half.
+        vertices.push_back(Vertex(0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1e6f, 0.0f));
+
+        std::vector<Vertex> decoded;
+        RoundTrip(VertexFormatDesc::Compact(), vertices, decoded);
+        for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+        {
+            float tolerance = values[i] < 6.1035156e-5f ? 2.9802322e-8f : GetHalfUlp(values[i]) * 0.5f;
+            TEST_CHECK(std::fabs(decoded[i].TexC.x - values[i]) <= tolerance);
+            TEST_CHECK(decoded[i].TexC.y == -decoded[i].TexC.x);
+        }
+
+        TEST_CHECK(std::signbit(decoded[1].TexC.x));
+        TEST_CHECK(decoded[2].TexC.x == 1.0f && decoded[4].TexC.x == 65504.0f);
+        TEST_CHECK(std::isinf(decoded.back().TexC.x));
+    }
+
+    void TestOctahedralAxes()
+    {
+        // The folds of the octahedral mapping sit on the axes and the xy diagonals.
+        const float axes[][3] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
+            { 0.70710678f, 0.70710678f, 0 }, { -0.70710678f, 0, -0.70710678f }, { 0, -0.70710678f, -0.70710678f } };
+
+        std::vector<Vertex> vertices;
+        for (auto& axis : axes)
+        {
+            vertices.push_back(Vertex(0.0f, 0.0f, 0.0f, axis[0], axis[1], axis[2], axis[1], axis[2], axis[0], 0.0f, 0.0f));
+        }
+
+        std::vector<Vertex> decoded;
+        auto error = RoundTrip(VertexFormatDesc::Compact(), vertices, decoded);
+        TEST_CHECK(error.normal < 0.01f && error.tangent < 0.01f);
+    }
+    bool IsInput(const VertexInputElement& input, uint32_t slot, uint32_t offset, VertexElementFormat format, bool per_instance)
+    {
+        return input.slot == slot && input.offset == offset && input.format == format && input.per_instance == per_instance;
+    }
+
+    void TestBuildInputLayout()
+    {
+        const VertexInputParameter all[] = { { "POSITION", 0 }, { "NORMAL", 0 }, { "TANGENT", 0 }, { "TEXCOORD", 0 } };
+        VertexInputLayout layout;
+
+        // One interleaved stream at the offsets of the generator's vertex.
+        auto full = VertexFormatDesc::Full();
+        TEST_CHECK(full.BuildInputLayout(all, 4, layout));
+        TEST_CHECK(layout.elements.size() == 4 && layout.stream_mask == 1 && layout.instance_slot == 1 && layout.instance_stride == 0);
+        if (layout.elements.size() == 4)
+        {
+            TEST_CHECK(IsInput(layout.elements[0], 0, offsetof(Vertex, Position), kVertexFloat3, false));
+            TEST_CHECK(IsInput(layout.elements[1], 0, offsetof(Vertex, Normal), kVertexFloat3, false));
+            TEST_CHECK(IsInput(layout.elements[2], 0, offsetof(Vertex, TangentU), kVertexFloat3, false));
+            TEST_CHECK(IsInput(layout.elements[3], 0, offsetof(Vertex, TexC), kVertexFloat2, false));
+            TEST_CHECK(::strcmp(layout.elements[2].semantic_name, "TANGENT") == 0);
+        }
+
+        // Position alone in slot 0, the rest packed in slot 1, in shader order rather than format order.
+        auto split = full.SplitPosition();
+        const VertexInputParameter reordered[] = { { "TEXCOORD", 0 }, { "POSITION", 0 }, { "TANGENT", 0 }, { "NORMAL", 0 } };
+        TEST_CHECK(split.BuildInputLayout(reordered, 4, layout));
+        TEST_CHECK(layout.elements.size() == 4 && layout.stream_mask == 3 && layout.instance_slot == 2);
+        if (layout.elements.size() == 4)
+        {
+            TEST_CHECK(IsInput(layout.elements[0], 1, 24, kVertexFloat2, false));
+            TEST_CHECK(IsInput(layout.elements[1], 0, 0, kVertexFloat3, false));
+            TEST_CHECK(IsInput(layout.elements[2], 1, 12, kVertexFloat3, false));
+            TEST_CHECK(IsInput(layout.elements[3], 1, 0, kVertexFloat3, false));
+        }
+
+        // A depth pass only binds the position stream.
+        TEST_CHECK(split.BuildInputLayout(all, 1, layout));
+        TEST_CHECK(layout.elements.size() == 1 && layout.stream_mask == 1 && layout.instance_slot == 2);
+
+        // Per instance rows go in the slot after the vertex streams, one after the other.
+        auto compact = VertexFormatDesc::Compact();
+        const VertexInputParameter instanced[] = { { "POSITION", 0 }, { "INSTANCE_MODEL", 0 }, { "INSTANCE_MODEL", 1 },
+            { "INSTANCE_MODEL", 2 }, { "INSTANCE_MODEL", 3 }, { "TEXCOORD", 0 } };
+        TEST_CHECK(compact.SplitPosition().BuildInputLayout(instanced, 6, layout));
+        TEST_CHECK(layout.elements.size() == 6 && layout.stream_mask == 3 && layout.instance_slot == 2 && layout.instance_stride == 64);
+        if (layout.elements.size() == 6)
+        {
+            TEST_CHECK(IsInput(layout.elements[0], 0, 0, kVertexSnorm16x4, false));
+            for (uint32_t row = 0; row < 4; row++)
+            {
+                TEST_CHECK(IsInput(layout.elements[1 + row], 2, row * 16, kVertexFloat4, true));
+                TEST_CHECK(layout.elements[1 + row].semantic_index == row);
+            }
+
+            TEST_CHECK(IsInput(layout.elements[5], 1, 8, kVertexHalf2, false));
+        }
+
+        TEST_CHECK(compact.BuildInputLayout(instanced, 5, layout));
+        TEST_CHECK(layout.stream_mask == 1 && layout.instance_slot == 1 && layout.instance_stride == 64);
+
+        // Semantics the format does not describe, and indices past the single set of attributes.
+        const VertexInputParameter unknown[] = { { "POSITION", 0 }, { "COLOR", 0 } };
+        const VertexInputParameter unknown_instance[] = { { "POSITION", 0 }, { "INSTANCE_COLOR", 0 } };
+        const VertexInputParameter second_set[] = { { "POSITION", 0 }, { "TEXCOORD", 1 } };
+        TEST_CHECK(!full.BuildInputLayout(unknown, 2, layout));
+        TEST_CHECK(!full.BuildInputLayout(unknown_instance, 2, layout));
+        TEST_CHECK(!split.BuildInputLayout(second_set, 2, layout));
+    }
+}
+
+int main()
+{
+    TestFormats();
+    TestFullIsExact();
+    TestCompactAccuracy();
+    TestHalfTexcoords();
+    TestOctahedralAxes();
+    TestBuildInputLayout();
+    return D3D::Test::Finish("VertexFormatTests");
+}
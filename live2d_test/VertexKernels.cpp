@@ -0,0 +1,320 @@
+#include "VertexKernels.h"
+
+#include <cstring>
+
+#include "GeometryGenerator.h"
+#include "SimdMath.h"
+
+namespace D3D
+{
+    namespace
+    {
+        // Transform and skinning kernels run eight vertices per iteration, packing and unpacking
+        // four, as four vertices fill whole 16 byte blocks and go through 4x4 transposes.
+        const uint32_t SIMD_WIDTH = 8;
+        const uint32_t PACK_WIDTH = 4;
+        const uint32_t PACKED_VERTEX_FLOATS = VertexKernels::PACKED_VERTEX_STRIDE / sizeof(float);
+
+        // Four packed vertices.
+        const uint32_t PACKED_GROUP_FLOATS = PACKED_VERTEX_FLOATS * PACK_WIDTH;
+        const uint32_t PACKED_GROUP_BLOCKS = PACKED_GROUP_FLOATS / PACK_WIDTH;
+
+        static_assert(sizeof(GeometryGenerator::Vertex) == VertexKernels::PACKED_VERTEX_STRIDE, "PackVertices writes GeometryGenerator::Vertex");
+        static_assert(PACKED_GROUP_FLOATS % PACK_WIDTH == 0, "four packed vertices must fill whole SIMD blocks");
+
+        // Null stream arrays read as zero.
+        inline Simd::Float4 LoadComponent(const float* const* streams, uint32_t component, uint32_t offset, uint32_t lane_count)
+        {
+            return streams != nullptr ? Simd::LoadPartial(streams[component] + offset, lane_count) : Simd::Zero();
+        }
+
+        inline void StoreComponent(float* const* streams, uint32_t component, uint32_t offset, uint32_t lane_count, Simd::Float4 value)
+        {
+            if (streams != nullptr)
+            {
+                Simd::StorePartial(streams[component] + offset, value, lane_count);
+            }
+        }
+
+        inline void Normalize(Simd::Float8& x, Simd::Float8& y, Simd::Float8& z)
+        {
+            Simd::Float8 length_sq = Simd::MulAdd(x, x, Simd::MulAdd(y, y, Simd::Mul(z, z)));
+            Simd::Float8 inv_length = Simd::Div(Simd::Set1x8(1.0f), Simd::Sqrt(length_sq));
+            inv_length = Simd::And(Simd::CmpGt(length_sq, Simd::Zero8()), inv_length);
+
+            x = Simd::Mul(x, inv_length);
+            y = Simd::Mul(y, inv_length);
+            z = Simd::Mul(z, inv_length);
+        }
+
+        // Matrix elements of eight vertices, m[row][column] holds one element per lane.
+        struct MatrixLanes
+        {
+            Simd::Float8 m[4][3];
+        };
+
+        inline MatrixLanes BroadcastMatrix(const TransformMatrix& matrix)
+        {
+            MatrixLanes lanes;
+            for (uint32_t row = 0; row < 4; row++)
+            {
+                for (uint32_t column = 0; column < 3; column++)
+                {
+                    lanes.m[row][column] = Simd::Set1x8(matrix.m[row][column]);
+                }
+            }
+
+            return lanes;
+        }
+
+        inline void TransformPoint(const MatrixLanes& matrix, Simd::Float8& x, Simd::Float8& y, Simd::Float8& z)
+        {
+            Simd::Float8 rx = Simd::MulAdd(x, matrix.m[0][0], Simd::MulAdd(y, matrix.m[1][0], Simd::MulAdd(z, matrix.m[2][0], matrix.m[3][0])));
+            Simd::Float8 ry = Simd::MulAdd(x, matrix.m[0][1], Simd::MulAdd(y, matrix.m[1][1], Simd::MulAdd(z, matrix.m[2][1], matrix.m[3][1])));
+            Simd::Float8 rz = Simd::MulAdd(x, matrix.m[0][2], Simd::MulAdd(y, matrix.m[1][2], Simd::MulAdd(z, matrix.m[2][2], matrix.m[3][2])));
+            x = rx;
+            y = ry;
+            z = rz;
+        }
+
+        inline void TransformDirection(const MatrixLanes& matrix, Simd::Float8& x, Simd::Float8& y, Simd::Float8& z)
+        {
+            Simd::Float8 rx = Simd::MulAdd(x, matrix.m[0][0], Simd::MulAdd(y, matrix.m[1][0], Simd::Mul(z, matrix.m[2][0])));
+            Simd::Float8 ry = Simd::MulAdd(x, matrix.m[0][1], Simd::MulAdd(y, matrix.m[1][1], Simd::Mul(z, matrix.m[2][1])));
+            Simd::Float8 rz = Simd::MulAdd(x, matrix.m[0][2], Simd::MulAdd(y, matrix.m[1][2], Simd::Mul(z, matrix.m[2][2])));
+            x = rx;
+            y = ry;
+            z = rz;
+        }
+
+        // Sum of weight * bone matrix for eight vertices. Each bone row is loaded per lane and
+        // transposed four lanes at a time, so the blend itself runs across vertices.
+        inline MatrixLanes BlendBones(const SkinnedVertexStreams& input, uint32_t offset, uint32_t lane_count, const TransformMatrix* bones)
+        {
+            MatrixLanes blended;
+            for (uint32_t row = 0; row < 4; row++)
+            {
+                for (uint32_t column = 0; column < 3; column++)
+                {
+                    blended.m[row][column] = Simd::Zero8();
+                }
+            }
+
+            for (uint32_t influence = 0; influence < input.influence_count; influence++)
+            {
+                Simd::Float8 weight = Simd::LoadPartial8(input.bone_weight[influence] + offset, lane_count);
+
+                const TransformMatrix* matrices[SIMD_WIDTH];
+                const uint16_t* indices = input.bone_index[influence] + offset;
+                for (uint32_t lane = 0; lane < SIMD_WIDTH; lane++)
+                {
+                    matrices[lane] = &bones[indices[lane < lane_count ? lane : 0]];
+                }
+
+                for (uint32_t row = 0; row < 4; row++)
+                {
+                    Simd::Float4 low[4];
+                    Simd::Float4 high[4];
+                    for (uint32_t lane = 0; lane < 4; lane++)
+                    {
+                        low[lane] = Simd::Load(matrices[lane]->m[row]);
+                        high[lane] = Simd::Load(matrices[lane + 4]->m[row]);
+                    }
+
+                    Simd::Transpose(low[0], low[1], low[2], low[3]);
+                    Simd::Transpose(high[0], high[1], high[2], high[3]);
+
+                    for (uint32_t column = 0; column < 3; column++)
+                    {
+                        blended.m[row][column] = Simd::MulAdd(Simd::Combine(low[column], high[column]), weight, blended.m[row][column]);
+                    }
+                }
+            }
+
+            return blended;
+        }
+    }
+
+    void VertexKernels::TransformPositions(const float* const positions[3], uint32_t count, const TransformMatrix& matrix, float* const result[3])
+    {
+        MatrixLanes lanes = BroadcastMatrix(matrix);
+
+        for (uint32_t i = 0; i < count; i += SIMD_WIDTH)
+        {
+            uint32_t lane_count = count - i;
+            Simd::Float8 x = Simd::LoadPartial8(positions[0] + i, lane_count);
+            Simd::Float8 y = Simd::LoadPartial8(positions[1] + i, lane_count);
+            Simd::Float8 z = Simd::LoadPartial8(positions[2] + i, lane_count);
+
+            TransformPoint(lanes, x, y, z);
+
+            Simd::StorePartial8(result[0] + i, x, lane_count);
+            Simd::StorePartial8(result[1] + i, y, lane_count);
+            Simd::StorePartial8(result[2] + i, z, lane_count);
+        }
+    }
+
+    void VertexKernels::TransformNormals(const float* const normals[3], uint32_t count, const TransformMatrix& matrix, float* const result[3])
+    {
+        MatrixLanes lanes = BroadcastMatrix(matrix);
+
+        for (uint32_t i = 0; i < count; i += SIMD_WIDTH)
+        {
+            uint32_t lane_count = count - i;
+            Simd::Float8 x = Simd::LoadPartial8(normals[0] + i, lane_count);
+            Simd::Float8 y = Simd::LoadPartial8(normals[1] + i, lane_count);
+            Simd::Float8 z = Simd::LoadPartial8(normals[2] + i, lane_count);
+
+            TransformDirection(lanes, x, y, z);
+            Normalize(x, y, z);
+
+            Simd::StorePartial8(result[0] + i, x, lane_count);
+            Simd::StorePartial8(result[1] + i, y, lane_count);
+            Simd::StorePartial8(result[2] + i, z, lane_count);
+        }
+    }
+
+    void VertexKernels::SkinVertices(const SkinnedVertexStreams& input, uint32_t count, const TransformMatrix* bones,
+        float* const positions[3], float* const normals[3])
+    {
+        bool has_normals = input.normal[0] != nullptr && normals != nullptr;
+
+        for (uint32_t i = 0; i < count; i += SIMD_WIDTH)
+        {
+            uint32_t lane_count = count - i;
+            MatrixLanes blended = BlendBones(input, i, lane_count, bones);
+
+            Simd::Float8 x = Simd::LoadPartial8(input.position[0] + i, lane_count);
+            Simd::Float8 y = Simd::LoadPartial8(input.position[1] + i, lane_count);
+            Simd::Float8 z = Simd::LoadPartial8(input.position[2] + i, lane_count);
+            TransformPoint(blended, x, y, z);
+
+            if (has_normals)
+            {
+                Simd::Float8 nx = Simd::LoadPartial8(input.normal[0] + i, lane_count);
+                Simd::Float8 ny = Simd::LoadPartial8(input.normal[1] + i, lane_count);
+                Simd::Float8 nz = Simd::LoadPartial8(input.normal[2] + i, lane_count);
+                TransformDirection(blended, nx, ny, nz);
+                Normalize(nx, ny, nz);
+
+                Simd::StorePartial8(normals[0] + i, nx, lane_count);
+                Simd::StorePartial8(normals[1] + i, ny, lane_count);
+                Simd::StorePartial8(normals[2] + i, nz, lane_count);
+            }
+
+            Simd::StorePartial8(positions[0] + i, x, lane_count);
+            Simd::StorePartial8(positions[1] + i, y, lane_count);
+            Simd::StorePartial8(positions[2] + i, z, lane_count);
+        }
+    }
+
+    void VertexKernels::PackVertices(const float* const positions[3], const float* const normals[3], const float* const tangents[3],
+        const float* const uvs[2], uint32_t count, void* destination)
+    {
+        float* output = static_cast<float*>(destination);
+        bool streaming = (reinterpret_cast<uintptr_t>(destination) & 15) == 0;
+
+        for (uint32_t i = 0; i < count; i += PACK_WIDTH)
+        {
+            uint32_t lane_count = count - i;
+
+            // Three transposes turn the eleven streams into the rows of four vertices.
+            Simd::Float4 a0 = LoadComponent(positions, 0, i, lane_count);
+            Simd::Float4 a1 = LoadComponent(positions, 1, i, lane_count);
+            Simd::Float4 a2 = LoadComponent(positions, 2, i, lane_count);
+            Simd::Float4 a3 = LoadComponent(normals, 0, i, lane_count);
+            Simd::Float4 b0 = LoadComponent(normals, 1, i, lane_count);
+            Simd::Float4 b1 = LoadComponent(normals, 2, i, lane_count);
+            Simd::Float4 b2 = LoadComponent(tangents, 0, i, lane_count);
+            Simd::Float4 b3 = LoadComponent(tangents, 1, i, lane_count);
+            Simd::Float4 c0 = LoadComponent(tangents, 2, i, lane_count);
+            Simd::Float4 c1 = LoadComponent(uvs, 0, i, lane_count);
+            Simd::Float4 c2 = LoadComponent(uvs, 1, i, lane_count);
+            Simd::Float4 c3 = Simd::Zero();
+            Simd::Transpose(a0, a1, a2, a3);
+            Simd::Transpose(b0, b1, b2, b3);
+            Simd::Transpose(c0, c1, c2, c3);
+
+            // Each vertex is 11 floats, the 12th float of a row is overwritten by the next vertex
+            // and the one of the last vertex lands in the extra float.
+            float packed[PACKED_GROUP_FLOATS + 1];
+            Simd::Float4 rows[PACK_WIDTH][3] = { { a0, b0, c0 }, { a1, b1, c1 }, { a2, b2, c2 }, { a3, b3, c3 } };
+            for (uint32_t vertex = 0; vertex < PACK_WIDTH; vertex++)
+            {
+                float* row = packed + vertex * PACKED_VERTEX_FLOATS;
+                Simd::Store(row, rows[vertex][0]);
+                Simd::Store(row + 4, rows[vertex][1]);
+                Simd::Store(row + 8, rows[vertex][2]);
+            }
+
+            if (lane_count < PACK_WIDTH)
+            {
+                ::memcpy(output, packed, sizeof(float) * PACKED_VERTEX_FLOATS * lane_count);
+                break;
+            }
+
+            for (uint32_t block = 0; block < PACKED_GROUP_BLOCKS; block++)
+            {
+                Simd::Float4 value = Simd::Load(packed + block * PACK_WIDTH);
+                if (streaming)
+                {
+                    Simd::StoreStream(output + block * PACK_WIDTH, value);
+                }
+                else
+                {
+                    Simd::Store(output + block * PACK_WIDTH, value);
+                }
+            }
+
+            output += PACKED_GROUP_FLOATS;
+        }
+
+        if (streaming)
+        {
+            Simd::StreamFence();
+        }
+    }
+
+    void VertexKernels::UnpackVertices(const void* source, uint32_t count, float* const positions[3], float* const normals[3],
+        float* const tangents[3], float* const uvs[2])
+    {
+        const float* input = static_cast<const float*>(source);
+
+        for (uint32_t i = 0; i < count; i += PACK_WIDTH)
+        {
+            uint32_t lane_count = count - i;
+            uint32_t vertex_count = lane_count < PACK_WIDTH ? lane_count : PACK_WIDTH;
+
+            // A local copy so the last row of a group never reads past the source.
+            float packed[PACKED_GROUP_FLOATS + 1] = {};
+            ::memcpy(packed, input + i * PACKED_VERTEX_FLOATS, sizeof(float) * PACKED_VERTEX_FLOATS * vertex_count);
+
+            Simd::Float4 a[PACK_WIDTH];
+            Simd::Float4 b[PACK_WIDTH];
+            Simd::Float4 c[PACK_WIDTH];
+            for (uint32_t vertex = 0; vertex < PACK_WIDTH; vertex++)
+            {
+                const float* row = packed + vertex * PACKED_VERTEX_FLOATS;
+                a[vertex] = Simd::Load(row);
+                b[vertex] = Simd::Load(row + 4);
+                c[vertex] = Simd::Load(row + 8);
+            }
+
+            Simd::Transpose(a[0], a[1], a[2], a[3]);
+            Simd::Transpose(b[0], b[1], b[2], b[3]);
+            Simd::Transpose(c[0], c[1], c[2], c[3]);
+
+            StoreComponent(positions, 0, i, lane_count, a[0]);
+            StoreComponent(positions, 1, i, lane_count, a[1]);
+            StoreComponent(positions, 2, i, lane_count, a[2]);
+            StoreComponent(normals, 0, i, lane_count, a[3]);
+            StoreComponent(normals, 1, i, lane_count, b[0]);
+            StoreComponent(normals, 2, i, lane_count, b[1]);
+            StoreComponent(tangents, 0, i, lane_count, b[2]);
+            StoreComponent(tangents, 1, i, lane_count, b[3]);
+            StoreComponent(tangents, 2, i, lane_count, c[0]);
+            StoreComponent(uvs, 0, i, lane_count, c[1]);
+            StoreComponent(uvs, 1, i, lane_count, c[2]);
+        }
+    }
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+#include "TransformKernels.h"
+
+namespace D3D
+{
+    // Linear blend skinning input. Every array holds count values, only the first
+    // influence_count index / weight arrays are read and the weights of a vertex sum to one.
+    struct SkinnedVertexStreams
+    {
+        const float* position[3] = {};
+        const float* normal[3] = {};                        // all null to skip normals
+        const uint16_t* bone_index[4] = {};
+        const float* bone_weight[4] = {};
+        uint32_t influence_count = 0;                       // 1 to 4
+    };
+
+    // Batch vertex kernels over structure-of-arrays streams (separate x, y, z arrays). Transform
+    // and skinning run eight vertices per iteration on Simd::Float8, one AVX register in AVX2
+    // builds; packing and unpacking run four, the width of their 4x4 transposes. Results may be
+    // written back over their inputs.
+    class VertexKernels
+    {
+    public:
+        // Size of GeometryGenerator::Vertex: position, normal, tangent and uv, 11 floats.
+        static const uint32_t PACKED_VERTEX_STRIDE = 44;
+
+        // (x, y, z, 1) * matrix
+        static void TransformPositions(const float* const positions[3], uint32_t count, const TransformMatrix& matrix, float* const result[3]);
+
+        // (x, y, z, 0) * matrix, renormalized. Pass the inverse transpose for non uniform scales.
+        static void TransformNormals(const float* const normals[3], uint32_t count, const TransformMatrix& matrix, float* const result[3]);
+
+        // Blends up to four bone matrices per vertex and transforms positions and normals with
+        // the result. Normals are renormalized, normals may be null when the input has none.
+        static void SkinVertices(const SkinnedVertexStreams& input, uint32_t count, const TransformMatrix* bones,
+            float* const positions[3], float* const normals[3]);
+
+        // Interleaves the streams into the GeometryGenerator::Vertex layout. Four vertices make up
+        // exactly eleven 16 byte blocks, which are written front to back with streaming stores
+        // when destination is 16 byte aligned, so upload heaps are never read back. Null normal,
+        // tangent or uv streams are written as zero.
+        static void PackVertices(const float* const positions[3], const float* const normals[3], const float* const tangents[3],
+            const float* const uvs[2], uint32_t count, void* destination);
+
+        // The reverse of PackVertices, for getting generated meshes into streams.
+        static void UnpackVertices(const void* source, uint32_t count, float* const positions[3], float* const normals[3],
+            float* const tangents[3], float* const uvs[2]);
+    };
+};
@@ -0,0 +1,128 @@
+#include "VertexKernels.h"
+
+#include <vector>
+
+#include "TestHarness.h"
+
+using namespace D3D;
+
+namespace
+{
+    float Random(uint32_t& seed)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / 16777216.0f;
+    }
+}
+
+// Million vertices per second of the batch kernels at 1k, 100k and 1M vertices. Build with
+// -DLIVE2D_SIMD=SSE2, AVX2 or SCALAR to compare backends.
+int main()
+{
+#if defined(SIMD_MATH_AVX)
+    const char* backend = "AVX";
+#elif defined(SIMD_MATH_SCALAR)
+    const char* backend = "scalar";
+#else
+    const char* backend = "SSE/NEON";
+#endif
+    std::printf("Float8 on %s\n", backend);
+    std::printf("%9s %10s %10s %10s %10s %10s\n", "vertices", "positions", "normals", "skin 1", "skin 4", "pack");
+
+    const uint32_t bone_count = 64;
+    std::vector<TransformMatrix> bones(bone_count);
+    uint32_t seed = 5;
+    for (auto& bone : bones)
+    {
+        for (auto& row : bone.m)
+        {
+            for (auto& value : row)
+            {
+                value = Random(seed);
+            }
+        }
+    }
+
+    for (uint32_t count : { 1000u, 100000u, 1000000u })
+    {
+        std::vector<float> streams[11];
+        std::vector<float> results[6];
+        for (auto& stream : streams)
+        {
+            for (uint32_t i = 0; i < count; i++)
+            {
+                stream.push_back(Random(seed));
+            }
+        }
+
+        for (auto& result : results)
+        {
+            result.resize(count);
+        }
+
+        std::vector<uint16_t> indices[4];
+        std::vector<float> weights[4];
+        for (uint32_t k = 0; k < 4; k++)
+        {
+            for (uint32_t i = 0; i < count; i++)
+            {
+                seed = seed * 1664525u + 1013904223u;
+                indices[k].push_back(static_cast<uint16_t>((seed >> 8) % bone_count));
+                weights[k].push_back(0.25f);
+            }
+        }
+
+        const float* positions[3] = { streams[0].data(), streams[1].data(), streams[2].data() };
+        const float* normals[3] = { streams[3].data(), streams[4].data(), streams[5].data() };
+        const float* tangents[3] = { streams[6].data(), streams[7].data(), streams[8].data() };
+        const float* uvs[2] = { streams[9].data(), streams[10].data() };
+        float* out_positions[3] = { results[0].data(), results[1].data(), results[2].data() };
+        float* out_normals[3] = { results[3].data(), results[4].data(), results[5].data() };
+
+        SkinnedVertexStreams input;
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            input.position[c] = positions[c];
+            input.normal[c] = normals[c];
+        }
+
+        for (uint32_t k = 0; k < 4; k++)
+        {
+            input.bone_index[k] = indices[k].data();
+            input.bone_weight[k] = weights[k].data();
+        }
+
+        std::vector<float> packed(count * 11 + 4);
+        uint32_t repeat = 20000000u / count;
+        double positions_ms = D3D::Test::MeasureMilliseconds(repeat, [&]()
+        {
+            VertexKernels::TransformPositions(positions, count, bones[0], out_positions);
+        });
+
+        double normals_ms = D3D::Test::MeasureMilliseconds(repeat, [&]()
+        {
+            VertexKernels::TransformNormals(normals, count, bones[0], out_normals);
+        });
+
+        double skin_ms[2];
+        for (uint32_t influence_count : { 1u, 4u })
+        {
+            input.influence_count = influence_count;
+            skin_ms[influence_count / 4] = D3D::Test::MeasureMilliseconds(repeat / 4 + 1, [&]()
+            {
+                VertexKernels::SkinVertices(input, count, bones.data(), out_positions, out_normals);
+            });
+        }
+
+        double pack_ms = D3D::Test::MeasureMilliseconds(repeat / 4 + 1, [&]()
+        {
+            VertexKernels::PackVertices(positions, normals, tangents, uvs, count, packed.data());
+        });
+
+        double vertices = count / 1000.0;
+        std::printf("%9u %10.1f %10.1f %10.1f %10.1f %10.1f\n", count, vertices / positions_ms, vertices / normals_ms,
+            vertices / skin_ms[0], vertices / skin_ms[1], vertices / pack_ms);
+    }
+
+    return 0;
+}
@@ -0,0 +1,257 @@
+#include "VertexKernels.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "GeometryGenerator.h"
+#include "TestHarness.h"
+
+using namespace D3D;
+
+namespace
+{
+    float Random(uint32_t& seed)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / 16777216.0f * 2.0f - 1.0f;
+    }
+
+    TransformMatrix RandomMatrix(uint32_t& seed)
+    {
+        TransformMatrix matrix;
+        for (auto& row : matrix.m)
+        {
+            for (auto& value : row)
+            {
+                value = Random(seed);
+            }
+        }
+
+        return matrix;
+    }
+
+    struct Streams
+    {
+        std::vector<float> data[3];
+        float* pointers[3];
+
+        Streams(uint32_t count, uint32_t& seed)
+        {
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    data[c].push_back(Random(seed) * 10.0f);
+                }
+
+                pointers[c] = data[c].data();
+            }
+        }
+    };
+
+    // (x, y, z, w) * matrix for one vertex, in double precision.
+    void Transform(const TransformMatrix& matrix, const float* const streams[3], uint32_t i, float w, double result[3])
+    {
+        for (uint32_t column = 0; column < 3; column++)
+        {
+            result[column] = double(streams[0][i]) * matrix.m[0][column] + double(streams[1][i]) * matrix.m[1][column] +
+                double(streams[2][i]) * matrix.m[2][column] + double(w) * matrix.m[3][column];
+        }
+    }
+
+    bool IsClose(const float* const streams[3], uint32_t i, const double expected[3], double tolerance)
+    {
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            if (std::fabs(streams[c][i] - expected[c]) > tolerance * (1.0 + std::fabs(expected[c])))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void Normalize(double v[3])
+    {
+        double length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            v[c] /= length;
+        }
+    }
+
+    // Counts around the eight vertex iterations, so every tail length runs.
+    const uint32_t COUNTS[] = { 0, 1, 3, 4, 7, 8, 9, 15, 16, 17, 1001 };
+
+    void TestTransform()
+    {
+        uint32_t seed = 3;
+        for (uint32_t count : COUNTS)
+        {
+            TransformMatrix matrix = RandomMatrix(seed);
+            Streams input(count, seed);
+            Streams output(count + 1, seed);
+            output.data[0][count] = 123.0f;
+
+            VertexKernels::TransformPositions(input.pointers, count, matrix, output.pointers);
+            bool positions = output.data[0][count] == 123.0f;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                double expected[3];
+                Transform(matrix, input.pointers, i, 1.0f, expected);
+                positions = positions && IsClose(output.pointers, i, expected, 1e-5);
+            }
+
+            TEST_CHECK(positions);
+
+            // In place.
+            VertexKernels::TransformNormals(input.pointers, count, matrix, output.pointers);
+            Streams normals = input;
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                normals.pointers[c] = normals.data[c].data();
+            }
+
+            VertexKernels::TransformNormals(normals.pointers, count, matrix, normals.pointers);
+            bool directions = true;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                double expected[3];
+                Transform(matrix, input.pointers, i, 0.0f, expected);
+                Normalize(expected);
+                directions = directions && IsClose(output.pointers, i, expected, 1e-5) && IsClose(normals.pointers, i, expected, 1e-5);
+            }
+
+            TEST_CHECK(directions);
+        }
+    }
+
+    void TestSkinning()
+    {
+        uint32_t seed = 11;
+        const uint32_t bone_count = 37;
+        std::vector<TransformMatrix> bones;
+        for (uint32_t b = 0; b < bone_count; b++)
+        {
+            bones.push_back(RandomMatrix(seed));
+        }
+
+        for (uint32_t influence_count = 1; influence_count <= 4; influence_count++)
+        {
+            for (uint32_t count : COUNTS)
+            {
+                Streams positions(count, seed);
+                Streams normals(count, seed);
+                std::vector<uint16_t> indices[4];
+                std::vector<float> weights[4];
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    float sum = 0.0f;
+                    for (uint32_t k = 0; k < influence_count; k++)
+                    {
+                        seed = seed * 1664525u + 1013904223u;
+                        indices[k].push_back(static_cast<uint16_t>((seed >> 8) % bone_count));
+                        weights[k].push_back(Random(seed) + 1.5f);
+                        sum += weights[k].back();
+                    }
+
+                    for (uint32_t k = 0; k < influence_count; k++)
+                    {
+                        weights[k].back() /= sum;
+                    }
+                }
+
+                SkinnedVertexStreams input;
+                for (uint32_t c = 0; c < 3; c++)
+                {
+                    input.position[c] = positions.pointers[c];
+                    input.normal[c] = normals.pointers[c];
+                }
+
+                for (uint32_t k = 0; k < influence_count; k++)
+                {
+                    input.bone_index[k] = indices[k].data();
+                    input.bone_weight[k] = weights[k].data();
+                }
+
+                input.influence_count = influence_count;
+
+                Streams skinned_positions(count, seed);
+                Streams skinned_normals(count, seed);
+                VertexKernels::SkinVertices(input, count, bones.data(), skinned_positions.pointers, skinned_normals.pointers);
+
+                bool matches = true;
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    TransformMatrix blended = {};
+                    for (uint32_t k = 0; k < influence_count; k++)
+                    {
+                        for (uint32_t row = 0; row < 4; row++)
+                        {
+                            for (uint32_t column = 0; column < 4; column++)
+                            {
+                                blended.m[row][column] += weights[k][i] * bones[indices[k][i]].m[row][column];
+                            }
+                        }
+                    }
+
+                    double expected_position[3];
+                    double expected_normal[3];
+                    Transform(blended, positions.pointers, i, 1.0f, expected_position);
+                    Transform(blended, normals.pointers, i, 0.0f, expected_normal);
+                    Normalize(expected_normal);
+                    matches = matches && IsClose(skinned_positions.pointers, i, expected_position, 1e-4) && IsClose(skinned_normals.pointers, i, expected_normal, 1e-4);
+                }
+
+                TEST_CHECK(matches);
+            }
+        }
+    }
+
+    void TestPacking()
+    {
+        GeometryGenerator generator;
+        auto mesh = generator.CreateSphere(1.0f, 13, 7);
+        uint32_t count = static_cast<uint32_t>(mesh.Vertices.size());
+
+        std::vector<float> streams[11];
+        for (auto& stream : streams)
+        {
+            stream.resize(count);
+        }
+
+        float* positions[3] = { streams[0].data(), streams[1].data(), streams[2].data() };
+        float* normals[3] = { streams[3].data(), streams[4].data(), streams[5].data() };
+        float* tangents[3] = { streams[6].data(), streams[7].data(), streams[8].data() };
+        float* uvs[2] = { streams[9].data(), streams[10].data() };
+        VertexKernels::UnpackVertices(mesh.Vertices.data(), count, positions, normals, tangents, uvs);
+        TEST_CHECK(streams[9][5] == mesh.Vertices[5].TexC.x && streams[5][count - 1] == mesh.Vertices[count - 1].Normal.z);
+
+        // Aligned output takes the streaming stores, the one float offset the plain ones.
+        std::vector<float> packed(count * 11 + 8, -1.0f);
+        float* aligned = packed.data();
+        while ((reinterpret_cast<uintptr_t>(aligned) & 15) != 0)
+        {
+            aligned++;
+        }
+
+        for (float* destination : { aligned, aligned + 1 })
+        {
+            VertexKernels::PackVertices(positions, normals, tangents, uvs, count, destination);
+            TEST_CHECK(::memcmp(destination, mesh.Vertices.data(), count * sizeof(GeometryGenerator::Vertex)) == 0);
+        }
+
+        VertexKernels::PackVertices(positions, nullptr, nullptr, uvs, 3, aligned);
+        TEST_CHECK(aligned[0] == positions[0][0] && aligned[3] == 0.0f && aligned[8] == 0.0f && aligned[9] == uvs[0][0]);
+    }
+}
+
+int main()
+{
+    TestTransform();
+    TestSkinning();
+    TestPacking();
+    return D3D::Test::Finish("VertexKernelsTests");
+}